@@ -370,6 +370,67 @@ int SLPVerifyDigest(SLPSpiHandle hspi,
 }
 
 
+/*-------------------------------------------------------------------------*/
+static int SLPAuthVerifyBlock(SLPSpiHandle hspi,
+                              unsigned char* digest,
+                              const SLPAuthBlock* authblock)
+/* Verify the signature of an authblock over the digest of what it signs.  */
+/* The digest covers the SPI and the expiry of the authblock too, so a     */
+/* signature that verified before with hspi is taken without the DSA check */
+/*                                                                         */
+/* Returns: 0 if the signature is valid, SLP_ERROR_AUTHENTICATION_UNKNOWN  */
+/*          if hspi has no key for the SPI, SLP_ERROR_AUTHENTICATION_FAILED*/
+/*          otherwise                                                      */
+/*-------------------------------------------------------------------------*/
+{
+    int                 signaturelen;
+    int                 valid;
+    SLPCryptoDSAKey*    key;
+
+    /*------------------------------------------------------------*/
+    /* Calculate the size of the DSA signature from the authblock */
+    /*------------------------------------------------------------*/
+    /* we have to calculate the signature length since            */
+    /* authblock->length is (stupidly) the length of the entire   */
+    /* authblock                                                  */
+    signaturelen = authblock->length - (authblock->spistrlen + 10);
+
+    if(SLPSpiVerifiedFind(hspi,digest,authblock->authstruct,signaturelen))
+    {
+        return 0;
+    }
+
+    /*-------------------------------*/
+    /* Get a public key for the SPI  */
+    /*-------------------------------*/
+    key = SLPSpiGetDSAKey(hspi,
+                          SLPSPI_KEY_TYPE_PUBLIC,
+                          authblock->spistrlen,
+                          authblock->spistr,
+                          &key);
+    if(key == 0)
+    {
+        return SLP_ERROR_AUTHENTICATION_UNKNOWN;
+    }
+
+    /*----------------------*/
+    /* Verify the signature */
+    /*----------------------*/
+    valid = SLPCryptoDSAVerify(key,
+                               digest,
+                               SLPAUTH_SHA1_DIGEST_SIZE,
+                               authblock->authstruct,
+                               signaturelen);
+    SLPCryptoDSAKeyDestroy(key);
+    if(valid == 0)
+    {
+        return SLP_ERROR_AUTHENTICATION_FAILED;
+    }
+
+    SLPSpiVerifiedAdd(hspi,digest,authblock->authstruct,signaturelen);
+    return 0;
+}
+
 
 /*=========================================================================*/
 int SLPAuthVerifyString(SLPSpiHandle hspi,
@@ -392,10 +453,9 @@ int SLPAuthVerifyString(SLPSpiHandle hspi,
 /*=========================================================================*/
 {
     int                 i;
-    int                 signaturelen;
+    int                 err;
     int                 result;
     unsigned long       timestamp;
-    SLPCryptoDSAKey*    key = 0;
     unsigned char       digest[SLPAUTH_SHA1_DIGEST_SIZE];
     
     /*-----------------------------------*/
@@ -422,57 +482,36 @@ int SLPAuthVerifyString(SLPSpiHandle hspi,
     /* accept it                                            */
     for(i=0;i<authcount;i++)
     {
-        /*-------------------------------*/
-        /* Get a public key for the SPI  */
-        /*-------------------------------*/
-        key = SLPSpiGetDSAKey(hspi,
-                              SLPSPI_KEY_TYPE_PUBLIC,
-                              autharray[i].spistrlen,
-                              autharray[i].spistr,
-                              &key);
-        
-        /* Continue if we have a key and if the authenticator is not */
-        /* timed out                                                 */
-        if(key && timestamp <= autharray[i].timestamp)
+        /* Continue if the authenticator is not timed out */
+        if(timestamp <= autharray[i].timestamp)
         {
         
             /*--------------------------*/
             /* Generate the SHA1 digest */
             /*--------------------------*/
-            result = SLPAuthDigestString(autharray[i].spistrlen,
-                                         autharray[i].spistr,
-                                         stringlen,
-                                         string,
-                                         autharray[i].timestamp,
-                                         digest);
-            if(result == 0)
+            err = SLPAuthDigestString(autharray[i].spistrlen,
+                                      autharray[i].spistr,
+                                      stringlen,
+                                      string,
+                                      autharray[i].timestamp,
+                                      digest);
+            if(err == 0)
             {
-                /*------------------------------------------------------------*/
-                /* Calculate the size of the DSA signature from the authblock */
-                /*------------------------------------------------------------*/
-                /* we have to calculate the signature length since            */
-                /* autharray[i].length is (stupidly) the length of the entire */
-                /* authblock                                                  */
-                signaturelen = autharray[i].length - (autharray[i].spistrlen + 10);
-        
-                /*----------------------*/
-                /* Verify the signature */
-                /*----------------------*/
-                if(SLPCryptoDSAVerify(key,
-                                      digest,
-                                      sizeof(digest),
-                                      autharray[i].authstruct,
-                                      signaturelen))
+                err = SLPAuthVerifyBlock(hspi,digest,&(autharray[i]));
+                if(err == 0)
                 {
+                    result = 0;
                     break;
                 }
-    
-                result = SLP_ERROR_AUTHENTICATION_FAILED;
+            }
+
+            /* authblocks with an SPI we have no key for are skipped */
+            if(err != SLP_ERROR_AUTHENTICATION_UNKNOWN)
+            {
+                result = err;
             }
         }
     }
-    
-    if(key) SLPCryptoDSAKeyDestroy(key);
    
     return result;
 }
@@ -518,12 +557,11 @@ int SLPAuthVerifyDAAdvert(SLPSpiHandle hspi,
 /*=========================================================================*/
 {
     int                 i;
-    int                 signaturelen;
+    int                 err;
     int                 result;
     unsigned long       timestamp;
     const SLPAuthBlock* autharray;
     int                 authcount;
-    SLPCryptoDSAKey*    key = 0;
     unsigned char       digest[SLPAUTH_SHA1_DIGEST_SIZE];
     
     /*-----------------------------------*/
@@ -552,64 +590,43 @@ int SLPAuthVerifyDAAdvert(SLPSpiHandle hspi,
     autharray = daadvert->autharray;
     for(i=0;i<authcount;i++)
     {
-        /*-------------------------------*/
-        /* Get a public key for the SPI  */
-        /*-------------------------------*/
-        key = SLPSpiGetDSAKey(hspi,
-                              SLPSPI_KEY_TYPE_PUBLIC,
-                              autharray[i].spistrlen,
-                              autharray[i].spistr,
-                              &key);
-        
-        /* Continue if we have a key and if the authenticator is not */
-        /* timed out                                                 */
-        if(key && timestamp <= autharray[i].timestamp)
+        /* Continue if the authenticator is not timed out */
+        if(timestamp <= autharray[i].timestamp)
         {
         
             /*--------------------------*/
             /* Generate the SHA1 digest */
             /*--------------------------*/
-            result = SLPAuthDigestDAAdvert(autharray[i].spistrlen,
-                                           autharray[i].spistr,
-                                           autharray[i].timestamp,
-                                           daadvert->bootstamp,
-                                           daadvert->urllen,
-                                           daadvert->url,
-                                           daadvert->attrlistlen,
-                                           daadvert->attrlist,
-                                           daadvert->scopelistlen,
-                                           daadvert->scopelist,
-                                           daadvert->spilistlen,
-                                           daadvert->spilist,
-                                           digest);
-            if(result == 0)
+            err = SLPAuthDigestDAAdvert(autharray[i].spistrlen,
+                                        autharray[i].spistr,
+                                        autharray[i].timestamp,
+                                        daadvert->bootstamp,
+                                        daadvert->urllen,
+                                        daadvert->url,
+                                        daadvert->attrlistlen,
+                                        daadvert->attrlist,
+                                        daadvert->scopelistlen,
+                                        daadvert->scopelist,
+                                        daadvert->spilistlen,
+                                        daadvert->spilist,
+                                        digest);
+            if(err == 0)
             {
-                /*------------------------------------------------------------*/
-                /* Calculate the size of the DSA signature from the authblock */
-                /*------------------------------------------------------------*/
-                /* we have to calculate the signature length since            */
-                /* autharray[i].length is (stupidly) the length of the entire */
-                /* authblock                                                  */
-                signaturelen = autharray[i].length - (autharray[i].spistrlen + 10);
-        
-                /*----------------------*/
-                /* Verify the signature */
-                /*----------------------*/
-                if(SLPCryptoDSAVerify(key,
-                                      digest,
-                                      sizeof(digest),
-                                      autharray[i].authstruct,
-                                      signaturelen))
+                err = SLPAuthVerifyBlock(hspi,digest,&(autharray[i]));
+                if(err == 0)
                 {
+                    result = 0;
                     break;
                 }
-    
-                result = SLP_ERROR_AUTHENTICATION_FAILED;
+            }
+
+            /* authblocks with an SPI we have no key for are skipped */
+            if(err != SLP_ERROR_AUTHENTICATION_UNKNOWN)
+            {
+                result = err;
             }
         }
     }
-    
-    if(key) SLPCryptoDSAKeyDestroy(key);
    
     return result;
 }
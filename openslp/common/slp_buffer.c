@@ -67,6 +67,118 @@ void* memdup(const void* src, int srclen)
     return result;
 }
 
+/*-------------------------------------------------------------------------*/
+typedef struct _SLPBufferPoolClass
+/*-------------------------------------------------------------------------*/
+{
+    SLPBuffer       freelist;
+    int             lowfree;    /* fewest pooled buffers since last trim */
+    SLPPoolStats    stats;
+}SLPBufferPoolClass;
+
+/*-------------------------------------------------------------------------*/
+static SLPBufferPoolClass G_SLPBufferPool[SLP_BUFFER_POOL_CLASSES];
+static int G_SLPBufferPoolLimit = 0;
+/*-------------------------------------------------------------------------*/
+
+#define SLP_BUFFER_POOL_MIN_SIZE    64
+
+
+/*-------------------------------------------------------------------------*/
+static int SLPBufferSizeClass(size_t size)
+/* Returns the smallest size class that holds size bytes or -1 if there is */
+/* none                                                                    */
+/*-------------------------------------------------------------------------*/
+{
+    int     sizeclass   = 0;
+    size_t  classsize   = SLP_BUFFER_POOL_MIN_SIZE;
+
+    while(classsize < size)
+    {
+        classsize <<= 1;
+        sizeclass ++;
+    }
+
+    return sizeclass < SLP_BUFFER_POOL_CLASSES ? sizeclass : -1;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPBuffer SLPBufferPoolGet(size_t size)
+/* Gets an uninitialized buffer that can hold at least size bytes, from the*/
+/* pools if possible.  The allocated member is set.  With the pools off    */
+/* neither the free lists nor the statistics are touched, so that threads  */
+/* of libslp can allocate buffers at the same time.                        */
+/*-------------------------------------------------------------------------*/
+{
+    SLPBufferPoolClass* pool;
+    SLPBuffer           result;
+    int                 sizeclass;
+
+    sizeclass = SLPBufferSizeClass(size);
+    if(sizeclass < 0 || G_SLPBufferPoolLimit == 0)
+    {
+        /* allocate an extra byte for null terminating strings */
+        result = (SLPBuffer)xmalloc(sizeof(struct _SLPBuffer) + size + 1);
+        if(result)
+        {
+            result->allocated = size;
+        }
+        return result;
+    }
+
+    pool = &G_SLPBufferPool[sizeclass];
+    result = pool->freelist;
+    if(result)
+    {
+        pool->freelist = (SLPBuffer)result->listitem.next;
+        pool->stats.pooled --;
+        if(pool->stats.pooled < pool->lowfree)
+        {
+            pool->lowfree = pool->stats.pooled;
+        }
+        pool->stats.hits ++;
+    }
+    else
+    {
+        size = SLP_BUFFER_POOL_MIN_SIZE << sizeclass;
+        result = (SLPBuffer)xmalloc(sizeof(struct _SLPBuffer) + size + 1);
+        if(result == 0)
+        {
+            return 0;
+        }
+        result->allocated = size;
+    }
+
+    pool->stats.allocs ++;
+    pool->stats.inuse ++;
+    if(pool->stats.inuse > pool->stats.maxinuse)
+    {
+        pool->stats.maxinuse = pool->stats.inuse;
+    }
+
+    return result;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int SLPBufferPoolClassOf(SLPBuffer buf)
+/* Returns the size class buf was allocated from or -1 if it was not       */
+/*-------------------------------------------------------------------------*/
+{
+    int sizeclass;
+
+    sizeclass = SLPBufferSizeClass(buf->allocated);
+    if(sizeclass >= 0 &&
+       buf->allocated == (size_t)SLP_BUFFER_POOL_MIN_SIZE << sizeclass)
+    {
+        return sizeclass;
+    }
+
+    return -1;
+}
+
+
 /*=========================================================================*/
 SLPBuffer SLPBufferAlloc(size_t size)                                         
 /* Must be called to initially allocate a SLPBuffer                        */
@@ -80,14 +192,14 @@ SLPBuffer SLPBufferAlloc(size_t size)
 {
     SLPBuffer result;
 
-    /* allocate an extra byte for null terminating strings */
-    result = (SLPBuffer)xmalloc(sizeof(struct _SLPBuffer) + size + 1);
+    result = SLPBufferPoolGet(size);
     if(result)
     {
-        result->allocated = size;
         result->start = (unsigned char*)(result + 1);
         result->curpos = result->start;
         result->end = result->start + size; 
+        result->shared = 0;
+        result->refcount = 0;
 
 #if(defined DEBUG)
         memset(result->start,0x4d,size + 1);
@@ -109,18 +221,47 @@ SLPBuffer SLPBufferRealloc(SLPBuffer buf, size_t size)
 /*=========================================================================*/
 {
     SLPBuffer result;
-    if(buf)
+    size_t    keep;
+    if(buf && (buf->shared || buf->refcount))
+    {
+        /* shared data is never written, give the caller its own copy */
+        result = SLPBufferAlloc(size);
+        if(result)
+        {
+            keep = buf->end - buf->start;
+            memcpy(result->start, buf->start, keep < size ? keep : size);
+            SLPBufferFree(buf);
+        }
+    }
+    else if(buf)
     {
         if(buf->allocated >= size)
         {
             result = buf;
         }
-        else
+        else if(G_SLPBufferPoolLimit == 0 ||
+                (SLPBufferPoolClassOf(buf) < 0 &&
+                 SLPBufferSizeClass(size) < 0))
         {
             /* allocate an extra byte for null terminating strings */
             result = (SLPBuffer)xrealloc(buf, sizeof(struct _SLPBuffer) +
                                         size + 1);
-            result->allocated = size;
+            if(result)
+            {
+                result->allocated = size;
+            }
+        }
+        else
+        {
+            /* move to a buffer of a bigger size class */
+            result = SLPBufferPoolGet(size);
+            if(result)
+            {
+                memcpy(result + 1, buf + 1, buf->allocated + 1);
+                result->shared = 0;
+                result->refcount = 0;
+                SLPBufferFree(buf);
+            }
         }
 
         if(result)
@@ -165,6 +306,40 @@ SLPBuffer SLPBufferDup(SLPBuffer buf)
 }
 
 
+/*=========================================================================*/
+SLPBuffer SLPBufferRef(SLPBuffer buf)
+/* Returns a reference to the data of a buffer instead of a copy.  The     */
+/* reference has its own curpos, end and list item, so the same message    */
+/* can be queued on many sockets and sent from each at its own pace.  The  */
+/* data is freed when the buffer and all references have been passed to    */
+/* SLPBufferFree().                                                        */
+/*                                                                         */
+/* The data must not be written once it is shared.  SLPBufferRealloc() of  */
+/* a shared buffer or of a reference returns a private copy instead.       */
+/*                                                                         */
+/* buf      - (IN) buffer (or reference) to share                          */
+/*                                                                         */
+/* returns  - a new reference or NULL on ENOMEM                            */
+/*=========================================================================*/
+{
+    SLPBuffer ref;
+
+    ref = (SLPBuffer)xmalloc(sizeof(struct _SLPBuffer));
+    if(ref)
+    {
+        ref->allocated = 0;
+        ref->start = buf->start;
+        ref->curpos = buf->start;
+        ref->end = buf->end;
+        ref->shared = buf->shared ? buf->shared : buf;
+        ref->refcount = 0;
+        ref->shared->refcount ++;
+    }
+
+    return ref;
+}
+
+
 /*=========================================================================*/
 void SLPBufferFree(SLPBuffer buf)
 /* Free a previously allocated SLPBuffer                                   */
@@ -174,8 +349,128 @@ void SLPBufferFree(SLPBuffer buf)
 /* returns  - none                                                         */
 /*=========================================================================*/
 {
+    SLPBufferPoolClass* pool;
+    int                 sizeclass;
+
     if(buf)
     {
+        if(buf->refcount)
+        {
+            /* still referenced, the last SLPBufferFree() releases it */
+            buf->refcount --;
+            return;
+        }
+
+        if(buf->shared)
+        {
+            /* a reference, release it and then drop the data */
+            SLPBufferFree(buf->shared);
+            xfree(buf);
+            return;
+        }
+
+        sizeclass = SLPBufferPoolClassOf(buf);
+        if(sizeclass < 0 || G_SLPBufferPoolLimit == 0)
+        {
+            xfree(buf);
+            return;
+        }
+
+        pool = &G_SLPBufferPool[sizeclass];
+        pool->stats.frees ++;
+        pool->stats.inuse --;
+        if(pool->stats.pooled < G_SLPBufferPoolLimit)
+        {
+            buf->listitem.next = (SLPListItem*)pool->freelist;
+            pool->freelist = buf;
+            pool->stats.pooled ++;
+        }
+        else
+        {
+            xfree(buf);
+        }
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void SLPBufferPoolRelease(SLPBufferPoolClass* pool, int count)
+/* Releases count buffers from the free list of pool                       */
+/*-------------------------------------------------------------------------*/
+{
+    SLPBuffer buf;
+
+    while(count > 0 && pool->freelist)
+    {
+        buf = pool->freelist;
+        pool->freelist = (SLPBuffer)buf->listitem.next;
         xfree(buf);
+        pool->stats.pooled --;
+        pool->stats.trimmed ++;
+        count --;
+    }
+}
+
+
+/*=========================================================================*/
+void SLPBufferPoolSetLimit(int limit)
+/* Sets how many freed buffers of each size class are kept for reuse.  The */
+/* pools are not thread safe and are off (limit 0) until a single threaded */
+/* program like slpd turns them on.  Only buffers allocated while the      */
+/* pools are on are counted, so turn them on before the first allocation.  */
+/*                                                                         */
+/* limit    - (IN) buffers kept per size class.  Zero releases all pooled  */
+/*            buffers and turns pooling off                                */
+/*=========================================================================*/
+{
+    int i;
+
+    G_SLPBufferPoolLimit = limit;
+    for(i = 0; i < SLP_BUFFER_POOL_CLASSES; i++)
+    {
+        SLPBufferPoolRelease(&G_SLPBufferPool[i],
+                             G_SLPBufferPool[i].stats.pooled - limit);
+        G_SLPBufferPool[i].lowfree = G_SLPBufferPool[i].stats.pooled;
     }
 }
+
+
+/*=========================================================================*/
+void SLPBufferPoolTrim(void)
+/* Releases the pooled buffers that were not needed since the last trim.   */
+/* Meant to be called periodically so that the pools shrink back after a   */
+/* burst of traffic.                                                       */
+/*=========================================================================*/
+{
+    int i;
+
+    for(i = 0; i < SLP_BUFFER_POOL_CLASSES; i++)
+    {
+        SLPBufferPoolRelease(&G_SLPBufferPool[i],
+                             G_SLPBufferPool[i].lowfree);
+        G_SLPBufferPool[i].lowfree = G_SLPBufferPool[i].stats.pooled;
+    }
+}
+
+
+/*=========================================================================*/
+size_t SLPBufferPoolGetStats(int sizeclass, SLPPoolStats* stats)
+/* Gets the statistics of one buffer size class                            */
+/*                                                                         */
+/* sizeclass - (IN) 0 to SLP_BUFFER_POOL_CLASSES - 1                       */
+/*                                                                         */
+/* stats    - (OUT) the statistics                                         */
+/*                                                                         */
+/* returns  - the size of the buffers in the class or 0 if sizeclass is    */
+/*            out of range                                                 */
+/*=========================================================================*/
+{
+    if(sizeclass < 0 || sizeclass >= SLP_BUFFER_POOL_CLASSES)
+    {
+        return 0;
+    }
+
+    memcpy(stats,&G_SLPBufferPool[sizeclass].stats,sizeof(SLPPoolStats));
+
+    return (size_t)SLP_BUFFER_POOL_MIN_SIZE << sizeclass;
+}
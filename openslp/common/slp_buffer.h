@@ -77,9 +77,38 @@ typedef struct _SLPBuffer
     unsigned char*   end;
     /* ALWAYS set to point to the byte after the last meaningful byte */
     /* Data beyond this index may not be valid */
+
+    struct _SLPBuffer* shared;
+    /* For a reference made by SLPBufferRef() the buffer that holds the */
+    /* data, NULL otherwise */
+
+    int     refcount;
+    /* number of references made by SLPBufferRef() that are still alive */
 }*SLPBuffer;   
 
 
+/*=========================================================================*/
+#define SLP_BUFFER_POOL_CLASSES     8
+/* Number of buffer size classes kept in free lists: 64 bytes, 128 bytes,  */
+/* and so on up to 8k.  Larger buffers always come from xmalloc()          */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+typedef struct _SLPPoolStats
+/* Statistics of a free-list pool                                          */
+/*=========================================================================*/
+{
+    unsigned long   allocs;     /* objects handed out                     */
+    unsigned long   hits;       /* ... of which came from the free list   */
+    unsigned long   frees;      /* objects given back                     */
+    unsigned long   trimmed;    /* pooled objects released by a trim      */
+    int             inuse;      /* objects currently handed out           */
+    int             maxinuse;   /* most objects ever handed out at once   */
+    int             pooled;     /* objects currently in the free list     */
+}SLPPoolStats;
+
+
 /*=========================================================================*/
 SLPBuffer SLPBufferAlloc(size_t size); 
 /* Must be called to initially allocate a SLPBuffer                        */
@@ -114,6 +143,23 @@ SLPBuffer SLPBufferDup(SLPBuffer buf);
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+SLPBuffer SLPBufferRef(SLPBuffer buf);
+/* Returns a reference to the data of a buffer instead of a copy.  The     */
+/* reference has its own curpos, end and list item, so the same message    */
+/* can be queued on many sockets and sent from each at its own pace.  The  */
+/* data is freed when the buffer and all references have been passed to    */
+/* SLPBufferFree().                                                        */
+/*                                                                         */
+/* The data must not be written once it is shared.  SLPBufferRealloc() of  */
+/* a shared buffer or of a reference returns a private copy instead.       */
+/*                                                                         */
+/* buf      - (IN) buffer (or reference) to share                          */
+/*                                                                         */
+/* returns  - a new reference or NULL on ENOMEM                            */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 void SLPBufferFree(SLPBuffer buf);
 /* Free a previously allocated SLPBuffer                                   */
@@ -148,6 +194,38 @@ SLPBuffer SLPBufferListAdd(SLPBuffer* list, SLPBuffer buf);
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+void SLPBufferPoolSetLimit(int limit);
+/* Sets how many freed buffers of each size class are kept for reuse.  The */
+/* pools are not thread safe and are off (limit 0) until a single threaded */
+/* program like slpd turns them on.                                        */
+/*                                                                         */
+/* limit    - (IN) buffers kept per size class.  Zero releases all pooled  */
+/*            buffers and turns pooling off                                */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void SLPBufferPoolTrim(void);
+/* Releases the pooled buffers that were not needed since the last trim.   */
+/* Meant to be called periodically so that the pools shrink back after a   */
+/* burst of traffic.                                                       */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+size_t SLPBufferPoolGetStats(int sizeclass, SLPPoolStats* stats);
+/* Gets the statistics of one buffer size class                            */
+/*                                                                         */
+/* sizeclass - (IN) 0 to SLP_BUFFER_POOL_CLASSES - 1                       */
+/*                                                                         */
+/* stats    - (OUT) the statistics                                         */
+/*                                                                         */
+/* returns  - the size of the buffers in the class or 0 if sizeclass is    */
+/*            out of range                                                 */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 void* memdup(const void* src, int srclen);
 /*=========================================================================*/
@@ -51,6 +51,20 @@
 #include <ctype.h>
 
 #include "slp_compare.h"
+#include "slp_xmalloc.h"
+
+/* SSE2 is part of the base x86-64 ABI so it can be used unconditionally   */
+/* when the compiler says it is there.  AVX2 is only compiled in when the  */
+/* compiler can target it per function, and is picked at runtime.          */
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+# define SLP_SCAN_SSE2 1
+# include <emmintrin.h>
+# if (__GNUC__ >= 5) || defined(__clang__)
+#  define SLP_SCAN_AVX2 1
+#  include <immintrin.h>
+# endif
+#endif
 
 
 #ifndef _WIN32
@@ -83,6 +97,246 @@ strcasecmp(const char *s1, const char *s2)
 #endif 
 
 
+/* Characters that the escape/unescape routines and the attribute parser   */
+/* may have to look at: control characters, DEL, the RFC 2608 reserved     */
+/* characters "(),\!<=>~" and the bad tag characters "*_".                 */
+#define SLP_SCAN_IS_SPECIAL(c) \
+    ((c) < 0x20 || (c) == 0x7F || (c) == '!' || \
+     ((c) >= '(' && (c) <= '*') || (c) == ',' || \
+     ((c) >= '<' && (c) <= '>') || (c) == '\\' || (c) == '_' || (c) == '~')
+
+/*-------------------------------------------------------------------------*/
+static const char* SLPScanSpecialScalar(const char* start, const char* end)
+/*-------------------------------------------------------------------------*/
+{
+    const unsigned char* cur = (const unsigned char*)start;
+
+    while(cur < (const unsigned char*)end)
+    {
+        if(SLP_SCAN_IS_SPECIAL(*cur))
+        {
+            break;
+        }
+        cur++;
+    }
+
+    return (const char*)cur;
+}
+
+#ifdef SLP_SCAN_SSE2
+/*-------------------------------------------------------------------------*/
+static const char* SLPScanSpecialSSE2(const char* start, const char* end)
+/*-------------------------------------------------------------------------*/
+{
+    const char* cur = start;
+    const __m128i ctrlmax = _mm_set1_epi8(0x1F);
+    const __m128i paren   = _mm_set1_epi8('(');
+    const __m128i cmpop   = _mm_set1_epi8('<');
+    const __m128i two     = _mm_set1_epi8(2);
+    const __m128i tilde   = _mm_set1_epi8('~');
+    const __m128i one     = _mm_set1_epi8(1);
+    const __m128i bang    = _mm_set1_epi8('!');
+    const __m128i comma   = _mm_set1_epi8(',');
+    const __m128i bslash  = _mm_set1_epi8('\\');
+    const __m128i uscore  = _mm_set1_epi8('_');
+    __m128i v, t, hit;
+    int     mask;
+
+    while(end - cur >= 16)
+    {
+        v = _mm_loadu_si128((const __m128i*)cur);
+
+        /* unsigned v <= 0x1F */
+        hit = _mm_cmpeq_epi8(_mm_min_epu8(v, ctrlmax), v);
+
+        /* '(' ')' '*' */
+        t = _mm_sub_epi8(v, paren);
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_min_epu8(t, two), t));
+
+        /* '<' '=' '>' */
+        t = _mm_sub_epi8(v, cmpop);
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_min_epu8(t, two), t));
+
+        /* '~' DEL */
+        t = _mm_sub_epi8(v, tilde);
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_min_epu8(t, one), t));
+
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, bang));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, comma));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, bslash));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, uscore));
+
+        mask = _mm_movemask_epi8(hit);
+        if(mask)
+        {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 16;
+    }
+
+    return SLPScanSpecialScalar(cur, end);
+}
+#endif
+
+#ifdef SLP_SCAN_AVX2
+/*-------------------------------------------------------------------------*/
+__attribute__((target("avx2")))
+static const char* SLPScanSpecialAVX2(const char* start, const char* end)
+/*-------------------------------------------------------------------------*/
+{
+    const char* cur = start;
+    const __m256i ctrlmax = _mm256_set1_epi8(0x1F);
+    const __m256i paren   = _mm256_set1_epi8('(');
+    const __m256i cmpop   = _mm256_set1_epi8('<');
+    const __m256i two     = _mm256_set1_epi8(2);
+    const __m256i tilde   = _mm256_set1_epi8('~');
+    const __m256i one     = _mm256_set1_epi8(1);
+    const __m256i bang    = _mm256_set1_epi8('!');
+    const __m256i comma   = _mm256_set1_epi8(',');
+    const __m256i bslash  = _mm256_set1_epi8('\\');
+    const __m256i uscore  = _mm256_set1_epi8('_');
+    __m256i v, t, hit;
+    unsigned int mask;
+
+    while(end - cur >= 32)
+    {
+        v = _mm256_loadu_si256((const __m256i*)cur);
+
+        hit = _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctrlmax), v);
+
+        t = _mm256_sub_epi8(v, paren);
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(_mm256_min_epu8(t, two), t));
+
+        t = _mm256_sub_epi8(v, cmpop);
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(_mm256_min_epu8(t, two), t));
+
+        t = _mm256_sub_epi8(v, tilde);
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(_mm256_min_epu8(t, one), t));
+
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, bang));
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, comma));
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, bslash));
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, uscore));
+
+        mask = (unsigned int)_mm256_movemask_epi8(hit);
+        if(mask)
+        {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 32;
+    }
+
+    /* finish the last 0..31 bytes 16 at a time */
+    return SLPScanSpecialSSE2(cur, end);
+}
+#endif
+
+typedef const char* (*SLPScanSpecialFunc)(const char*, const char*);
+static SLPScanSpecialFunc G_SLPScanSpecialImpl = 0;
+
+/*-------------------------------------------------------------------------*/
+static SLPScanSpecialFunc SLPScanSpecialSelect(int kernel)
+/*-------------------------------------------------------------------------*/
+{
+#ifdef SLP_SCAN_AVX2
+    if(kernel == SLP_SCAN_KERNEL_AVX2 || kernel == SLP_SCAN_KERNEL_BEST)
+    {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+        {
+            return SLPScanSpecialAVX2;
+        }
+    }
+#endif
+#ifdef SLP_SCAN_SSE2
+    if(kernel != SLP_SCAN_KERNEL_SCALAR)
+    {
+        return SLPScanSpecialSSE2;
+    }
+#endif
+    return SLPScanSpecialScalar;
+}
+
+
+/*=========================================================================*/
+int SLPScanSetKernel(int kernel)
+/* Selects the implementation used by SLPScanSpecial()                     */
+/*                                                                         */
+/* kernel -     one of the SLP_SCAN_KERNEL_* constants                     */
+/*                                                                         */
+/* Returns -    the SLP_SCAN_KERNEL_* constant of the implementation that  */
+/*              was actually installed (the requested one may not be       */
+/*              supported by the compiler or the cpu)                      */
+/*=========================================================================*/
+{
+    G_SLPScanSpecialImpl = SLPScanSpecialSelect(kernel);
+
+#ifdef SLP_SCAN_AVX2
+    if(G_SLPScanSpecialImpl == SLPScanSpecialAVX2)
+    {
+        return SLP_SCAN_KERNEL_AVX2;
+    }
+#endif
+#ifdef SLP_SCAN_SSE2
+    if(G_SLPScanSpecialImpl == SLPScanSpecialSSE2)
+    {
+        return SLP_SCAN_KERNEL_SSE2;
+    }
+#endif
+    return SLP_SCAN_KERNEL_SCALAR;
+}
+
+
+/*=========================================================================*/
+const char* SLPScanSpecial(const char* start, const char* end)
+/* Finds the next character in [start,end) that may need attention from    */
+/* the escape, unescape or attribute parsing code.                         */
+/*                                                                         */
+/* start -      pointer to the first byte to scan                          */
+/*                                                                         */
+/* end -        pointer to the byte after the last byte to scan            */
+/*                                                                         */
+/* Returns -    pointer to the first special character or end if there is  */
+/*              none                                                       */
+/*=========================================================================*/
+{
+    /* Racing threads all store the same pointer, so no locking is needed */
+    if(G_SLPScanSpecialImpl == 0)
+    {
+        G_SLPScanSpecialImpl = SLPScanSpecialSelect(SLP_SCAN_KERNEL_BEST);
+    }
+
+    return G_SLPScanSpecialImpl(start, end);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static const char* SLPListItemEnd(const char* itembegin, const char* listend)
+/* Returns a pointer to the comma that ends the string-list item starting  */
+/* at itembegin or listend if it is the last item.  Escaped commas do not  */
+/* end an item.                                                            */
+/*-------------------------------------------------------------------------*/
+{
+    const char* itemend = itembegin;
+
+    while(itemend < listend)
+    {
+        itemend = memchr(itemend, ',', listend - itemend);
+        if(itemend == 0)
+        {
+            break;
+        }
+        if(itemend == itembegin || *(itemend - 1) != '\\')
+        {
+            return itemend;
+        }
+        itemend ++;
+    }
+
+    return listend;
+}
+
+
 /*=========================================================================*/
 int SLPCompareString(int str1len,
                      const char* str1,
@@ -199,12 +453,12 @@ int SLPCompareSrvType(int lsrvtypelen,
     char* colon;
 
     /* Skip "service:" */
-    if(strncasecmp(lsrvtype,"service:",lsrvtypelen > 8 ? 8 : lsrvtypelen) == 0)
+    if(lsrvtypelen >= 8 && strncasecmp(lsrvtype,"service:",8) == 0)
     {
         lsrvtypelen = lsrvtypelen - 8;
         lsrvtype = lsrvtype + 8;
     }
-    if(strncasecmp(rsrvtype,"service:",rsrvtypelen > 8 ? 8 : rsrvtypelen) == 0)
+    if(rsrvtypelen >= 8 && strncasecmp(rsrvtype,"service:",8) == 0)
     {
         rsrvtypelen = rsrvtypelen - 8;
         rsrvtype = rsrvtype + 8;
@@ -270,18 +524,7 @@ int SLPContainsStringList(int listlen,
         itembegin = itemend;
 
         /* seek to the end of the next list item */
-        while(1)
-        {
-            if(itemend == listend || *itemend == ',')
-            {
-                if(*(itemend - 1) != '\\')
-                {
-                    break;
-                }
-            }
-
-            itemend ++;
-        }
+        itemend = (char*)SLPListItemEnd(itembegin, listend);
 
         if(SLPCompareString(itemend - itembegin,
                             itembegin,
@@ -326,18 +569,7 @@ int SLPIntersectStringList(int list1len,
         itembegin = itemend;
 
         /* seek to the end of the next list item */
-        while(1)
-        {
-            if(itemend == listend || *itemend == ',')
-            {
-                if(*(itemend - 1) != '\\')
-                {
-                    break;
-                }
-            }
-
-            itemend ++;
-        }
+        itemend = (char*)SLPListItemEnd(itembegin, listend);
 
         if(SLPContainsStringList(list2len,
                                  list2,
@@ -415,18 +647,7 @@ int SLPUnionStringList(int list1len,
         itembegin = itemend;
 
         /* seek to the end of the next list item */
-        while(1)
-        {
-            if(itemend == listend || *itemend == ',')
-            {
-                if(*(itemend - 1) != '\\')
-                {
-                    break;
-                }
-            }
-
-            itemend ++;
-        }
+        itemend = (char*)SLPListItemEnd(itembegin, listend);
 
         itemlen = itemend - itembegin;
         if(SLPContainsStringList(list1len,
@@ -479,7 +700,7 @@ int SLPSubsetStringList(int listlen,
 /*=========================================================================*/
 {
     /* count the items in sublist */
-    int curpos;
+    const char* comma;
     int sublistcount;
 
     if(sublistlen ==0 || listlen == 0)
@@ -487,15 +708,12 @@ int SLPSubsetStringList(int listlen,
         return 0;
     }
 
-    curpos = 0;
     sublistcount = 1;
-    while(curpos < sublistlen)
+    comma = sublist;
+    while((comma = memchr(comma, ',', sublist + sublistlen - comma)) != 0)
     {
-        if(sublist[curpos] == ',')
-        {
-            sublistcount ++;
-        }
-        curpos ++;
+        sublistcount ++;
+        comma ++;
     }
 
     if(SLPIntersectStringList(listlen,
@@ -510,6 +728,277 @@ int SLPSubsetStringList(int listlen,
 }
 
 
+/*-------------------------------------------------------------------------*/
+static const char* SLPFoldInto(SLPFoldedString* folded,
+                               char* dest,
+                               const char* str,
+                               int len)
+/* Writes the lower case form of str to dest, hashes it (64 bit FNV-1a)    */
+/* and points folded at it.  Returns the byte after the folded copy.       */
+/*-------------------------------------------------------------------------*/
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int      i;
+
+    for(i = 0; i < len; i++)
+    {
+        dest[i] = tolower((unsigned char)str[i]);
+        hash = (hash ^ (unsigned char)dest[i]) * 0x100000001b3ULL;
+    }
+
+    folded->hash = hash;
+    folded->len = len;
+    folded->str = dest;
+
+    return dest + len;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void SLPFoldedSubString(SLPFoldedString* folded,
+                               const char* str,
+                               int len)
+/* Points folded at len bytes of an already folded string and hashes them  */
+/*-------------------------------------------------------------------------*/
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int      i;
+
+    for(i = 0; i < len; i++)
+    {
+        hash = (hash ^ (unsigned char)str[i]) * 0x100000001b3ULL;
+    }
+
+    folded->hash = hash;
+    folded->len = len;
+    folded->str = str;
+}
+
+
+/*=========================================================================*/
+SLPFoldedKeys* SLPFoldedKeysCreate(int srvtypelen,
+                                   const char* srvtype,
+                                   int namingauthlen,
+                                   const char* namingauth,
+                                   int urllen,
+                                   const char* url,
+                                   int scopelistlen,
+                                   const char* scopelist)
+/* Computes the folded form and hash of a service type, naming authority,  */
+/* URL and each scope of a scope list.  Any of them may be empty.          */
+/*                                                                         */
+/* Returns -    the keys or NULL if out of memory                          */
+/*=========================================================================*/
+{
+    SLPFoldedKeys*  keys;
+    const char*     listend;
+    const char*     itembegin;
+    const char*     itemend;
+    const char*     sep;
+    char*           cur;
+    int             hassrvtype;
+    int             foldednalen;
+    int             scopecount;
+    int             i;
+
+    /* the naming authority is part of the srvtype if there is one */
+    hassrvtype = (srvtypelen > 0);
+    if(hassrvtype || namingauthlen == 0xffff)
+    {
+        foldednalen = 0;
+    }
+    else
+    {
+        foldednalen = namingauthlen;
+    }
+
+    /* Skip "service:" */
+    if(srvtypelen >= 8 && strncasecmp(srvtype,"service:",8) == 0)
+    {
+        srvtypelen -= 8;
+        srvtype += 8;
+    }
+
+    /* count the scopes */
+    scopecount = 0;
+    listend = scopelist + scopelistlen;
+    itemend = scopelist;
+    while(itemend < listend)
+    {
+        itemend = SLPListItemEnd(itemend, listend) + 1;
+        scopecount ++;
+    }
+
+    /* one allocation for the keys, the scope array and the folded copies */
+    keys = (SLPFoldedKeys*)xmalloc(sizeof(SLPFoldedKeys) +
+                                   sizeof(SLPFoldedString) * scopecount +
+                                   srvtypelen + foldednalen +
+                                   urllen + scopelistlen);
+    if(keys == 0)
+    {
+        return 0;
+    }
+    memset(keys,0,sizeof(SLPFoldedKeys));
+    keys->scopecount = scopecount;
+    keys->scopes = (SLPFoldedString*)(keys + 1);
+    cur = (char*)(keys->scopes + scopecount);
+
+    cur = (char*)SLPFoldInto(&keys->srvtype, cur, srvtype, srvtypelen);
+    cur = (char*)SLPFoldInto(&keys->url, cur, url, urllen);
+
+    /* abstract type and naming authority come from the folded srvtype */
+    sep = memchr(keys->srvtype.str, ':', srvtypelen);
+    if(sep)
+    {
+        SLPFoldedSubString(&keys->abstracttype,
+                           keys->srvtype.str,
+                           sep - keys->srvtype.str);
+    }
+    else
+    {
+        keys->abstracttype = keys->srvtype;
+    }
+
+    if(hassrvtype)
+    {
+        /* naming authority follows the first '.' of the abstract type,   */
+        /* IANA (str stays NULL) if there is none                          */
+        sep = memchr(keys->abstracttype.str, '.', keys->abstracttype.len);
+        if(sep)
+        {
+            SLPFoldedSubString(&keys->namingauth,
+                               sep + 1,
+                               keys->abstracttype.len - (sep + 1 - keys->abstracttype.str));
+        }
+    }
+    else if(namingauthlen == 0xffff)
+    {
+        /* match all naming authorities */
+        keys->namingauth.len = 0xffff;
+    }
+    else if(foldednalen)
+    {
+        cur = (char*)SLPFoldInto(&keys->namingauth, cur, namingauth, foldednalen);
+    }
+
+    itemend = scopelist;
+    for(i = 0; i < scopecount; i++)
+    {
+        itembegin = itemend;
+        itemend = SLPListItemEnd(itembegin, listend);
+        cur = (char*)SLPFoldInto(&keys->scopes[i], cur, itembegin, itemend - itembegin);
+        itemend ++;
+    }
+
+    return keys;
+}
+
+
+/*=========================================================================*/
+void SLPFoldedKeysFree(SLPFoldedKeys* keys)
+/* Frees keys returned by SLPFoldedKeysCreate().  Ignored if NULL.         */
+/*=========================================================================*/
+{
+    if(keys)
+    {
+        xfree(keys);
+    }
+}
+
+
+/*=========================================================================*/
+int SLPFoldedCompareString(const SLPFoldedString* str1,
+                           const SLPFoldedString* str2)
+/* Same result as SLPCompareString() on the original strings, but only     */
+/* whether they are equal                                                  */
+/*                                                                         */
+/* Returns -    zero if strings are equal. Nonzero if they are not         */
+/*=========================================================================*/
+{
+    if(str1->hash != str2->hash || str1->len != str2->len)
+    {
+        return 1;
+    }
+
+    return memcmp(str1->str, str2->str, str1->len);
+}
+
+
+/*=========================================================================*/
+int SLPFoldedCompareSrvType(const SLPFoldedKeys* lkeys,
+                            const SLPFoldedKeys* rkeys)
+/* Same result as SLPCompareSrvType() on the service types of lkeys and    */
+/* rkeys                                                                   */
+/*                                                                         */
+/* Returns -    zero if srvtypes are equal. Nonzero if they are not        */
+/*=========================================================================*/
+{
+    if(lkeys->abstracttype.len != lkeys->srvtype.len)
+    {
+        /* lsrvtype is uses concrete type so strings must be identical */
+        return SLPFoldedCompareString(&lkeys->srvtype, &rkeys->srvtype);
+    }
+
+    /* lsrvtype is abstract only so only compare the abstract part of     */
+    /* rsrvtype (which is all of it if it is abstract too)                */
+    return SLPFoldedCompareString(&lkeys->srvtype, &rkeys->abstracttype);
+}
+
+
+/*=========================================================================*/
+int SLPFoldedCompareNamingAuth(const SLPFoldedKeys* srvtypekeys,
+                               const SLPFoldedKeys* namingauthkeys)
+/* Same result as SLPCompareNamingAuth() on the service type of            */
+/* srvtypekeys and the naming authority of namingauthkeys                  */
+/*                                                                         */
+/* Returns -    zero if srvtype matches the naming authority. Nonzero if   */
+/*              it doesn't                                                 */
+/*=========================================================================*/
+{
+    const SLPFoldedString* na = &namingauthkeys->namingauth;
+
+    if(na->len == 0xffff) /* match all naming authorities */
+        return 0;
+
+    if(na->len == 0)     /* IANA naming authority */
+        return srvtypekeys->namingauth.str ? 1 : 0;
+
+    if(srvtypekeys->namingauth.str == 0)
+        return 1;
+
+    return SLPFoldedCompareString(&srvtypekeys->namingauth, na) ? 1 : 0;
+}
+
+
+/*=========================================================================*/
+int SLPFoldedIntersectScopes(const SLPFoldedKeys* keys1,
+                             const SLPFoldedKeys* keys2)
+/* Same result as SLPIntersectStringList() on the scope lists of keys1 and */
+/* keys2                                                                   */
+/*                                                                         */
+/* Returns -    The number of scopes of keys1 that are also in keys2       */
+/*=========================================================================*/
+{
+    int result = 0;
+    int i;
+    int j;
+
+    for(i = 0; i < keys1->scopecount; i++)
+    {
+        for(j = 0; j < keys2->scopecount; j++)
+        {
+            if(SLPFoldedCompareString(&keys1->scopes[i], &keys2->scopes[j]) == 0)
+            {
+                result ++;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+
 /*=========================================================================*/
 int SLPCheckServiceUrlSyntax(const char* srvurl,
 			     int srvurllen)
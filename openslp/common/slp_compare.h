@@ -69,6 +69,55 @@ strcasecmp(const char *s1, const char *s2);
 # endif
 #endif 
 
+#ifdef _WIN32
+# ifndef UINT64_T_DEFINED
+# define UINT64_T_DEFINED
+typedef unsigned __int64 uint64_t;
+# endif
+#else
+# ifdef HAVE_STDINT_H
+#  include <stdint.h>
+# else
+#  include <inttypes.h>
+# endif
+#endif
+
+
+
+/* SLPScanSpecial() implementations, for SLPScanSetKernel()                */
+#define SLP_SCAN_KERNEL_BEST    0
+#define SLP_SCAN_KERNEL_SCALAR  1
+#define SLP_SCAN_KERNEL_SSE2    2
+#define SLP_SCAN_KERNEL_AVX2    3
+
+
+/*=========================================================================*/
+const char* SLPScanSpecial(const char* start, const char* end);
+/* Finds the next character in [start,end) that may need attention from    */
+/* the escape, unescape or attribute parsing code: control characters,     */
+/* DEL, the reserved characters "(),\!<=>~" and the bad tag characters     */
+/* "*_".  Callers classify the returned character themselves.  Uses SSE2   */
+/* or AVX2 when available to skip 16 or 32 ordinary bytes at a time.       */
+/*                                                                         */
+/* start -      pointer to the first byte to scan                          */
+/*                                                                         */
+/* end -        pointer to the byte after the last byte to scan            */
+/*                                                                         */
+/* Returns -    pointer to the first special character or end if there is  */
+/*              none                                                       */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int SLPScanSetKernel(int kernel);
+/* Selects the implementation used by SLPScanSpecial().  By default the    */
+/* fastest one supported by the cpu is picked on first use.                */
+/*                                                                         */
+/* kernel -     one of the SLP_SCAN_KERNEL_* constants                     */
+/*                                                                         */
+/* Returns -    the SLP_SCAN_KERNEL_* constant of the implementation that  */
+/*              was actually installed                                     */
+/*=========================================================================*/
 
 
 /*=========================================================================*/
@@ -233,6 +282,109 @@ int SLPSubsetStringList(int listlen,
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+typedef struct _SLPFoldedString
+/* A string in the canonical form used by SLPCompareString(), with a hash  */
+/* of that form so that most unequal strings are rejected without looking  */
+/* at them.                                                                */
+/*=========================================================================*/
+{
+    uint64_t    hash;
+    int         len;
+    const char* str;    /* folded copy, NOT null terminated */
+}SLPFoldedString;
+
+
+/*=========================================================================*/
+typedef struct _SLPFoldedKeys
+/* Folded forms of the strings a registration or a request is matched on.  */
+/* Built once with SLPFoldedKeysCreate() and freed with                    */
+/* SLPFoldedKeysFree().                                                    */
+/*=========================================================================*/
+{
+    SLPFoldedString     srvtype;      /* without the "service:" prefix    */
+    SLPFoldedString     abstracttype; /* srvtype up to the first ':'      */
+    SLPFoldedString     namingauth;   /* str is NULL for IANA, len is     */
+                                      /* 0xffff to match all authorities  */
+    SLPFoldedString     url;
+    int                 scopecount;
+    SLPFoldedString*    scopes;
+}SLPFoldedKeys;
+
+
+/*=========================================================================*/
+SLPFoldedKeys* SLPFoldedKeysCreate(int srvtypelen,
+                                   const char* srvtype,
+                                   int namingauthlen,
+                                   const char* namingauth,
+                                   int urllen,
+                                   const char* url,
+                                   int scopelistlen,
+                                   const char* scopelist);
+/* Computes the folded form and hash of a service type, naming authority,  */
+/* URL and each scope of a scope list.  Any of them may be empty.          */
+/*                                                                         */
+/* srvtype -    service type.  When not empty the naming authority is      */
+/*              taken from it and namingauth is ignored                    */
+/*                                                                         */
+/* namingauth - naming authority of a SrvTypeRqst.  A namingauthlen of     */
+/*              0xffff matches all naming authorities                      */
+/*                                                                         */
+/* url -        service URL                                                */
+/*                                                                         */
+/* scopelist -  scope list                                                 */
+/*                                                                         */
+/* Returns -    the keys or NULL if out of memory                          */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void SLPFoldedKeysFree(SLPFoldedKeys* keys);
+/* Frees keys returned by SLPFoldedKeysCreate().  Ignored if NULL.         */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int SLPFoldedCompareString(const SLPFoldedString* str1,
+                           const SLPFoldedString* str2);
+/* Same result as SLPCompareString() on the original strings, but only     */
+/* whether they are equal                                                  */
+/*                                                                         */
+/* Returns -    zero if strings are equal. Nonzero if they are not         */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int SLPFoldedCompareSrvType(const SLPFoldedKeys* lkeys,
+                            const SLPFoldedKeys* rkeys);
+/* Same result as SLPCompareSrvType() on the service types of lkeys and    */
+/* rkeys                                                                   */
+/*                                                                         */
+/* Returns -    zero if srvtypes are equal. Nonzero if they are not        */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int SLPFoldedCompareNamingAuth(const SLPFoldedKeys* srvtypekeys,
+                               const SLPFoldedKeys* namingauthkeys);
+/* Same result as SLPCompareNamingAuth() on the service type of            */
+/* srvtypekeys and the naming authority of namingauthkeys                  */
+/*                                                                         */
+/* Returns -    zero if srvtype matches the naming authority. Nonzero if   */
+/*              it doesn't                                                 */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int SLPFoldedIntersectScopes(const SLPFoldedKeys* keys1,
+                             const SLPFoldedKeys* keys2);
+/* Same result as SLPIntersectStringList() on the scope lists of keys1 and */
+/* keys2                                                                   */
+/*                                                                         */
+/* Returns -    The number of scopes of keys1 that are also in keys2       */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 int SLPCheckServiceUrlSyntax(const char* srvurl,
 			     int srvurllen);
@@ -117,6 +117,20 @@
 #define DHCP_MSG_RELEASE	7
 #define DHCP_MSG_INFORM		8
 
+/*=========================================================================*/ 
+struct _DHCPInform
+/*	A DHCPINFORM and the socket it is broadcast on.
+  =========================================================================*/ 
+{
+	int sockfd;
+	UINT32 xid;
+	int tries;
+	long waitusecs;				/* how long the last try waits */
+	struct sockaddr_in sendaddr;
+	size_t sndbufsz;
+	unsigned char sndbuf[512];
+};
+
 /*=========================================================================*/ 
 static int dhcpCreateBCSkt(struct sockaddr_in* peeraddr) 
 /*	Creates a socket and provides a broadcast addr to which DHCP requests
@@ -158,88 +172,6 @@ static int dhcpCreateBCSkt(struct sockaddr_in* peeraddr)
 }
 
 
-/*=========================================================================*/ 
-static int dhcpSendRequest(int sockfd, void *buf, size_t bufsz,
-		struct sockaddr* peeraddr, struct timeval* timeout)
-/*	Sends a buffer to PEERADDR, times out after period specified in TIMEOUT
-
-	Returns  -		zero on success non-zero on failure
-
-	errno				EPIPE error during write
-						ETIMEDOUT read timed out
-  =========================================================================*/ 
-{
-	fd_set writefds;
-	int xferbytes;
-	int flags = 0;
-
-#if defined(MSG_NOSIGNAL)
-	flags = MSG_NOSIGNAL;
-#endif
-
-	FD_ZERO(&writefds);
-	FD_SET(sockfd, &writefds);
-
-	if((xferbytes = select(sockfd + 1, 0, &writefds, 0, timeout)) > 0)
-	{
-		if((xferbytes = sendto(sockfd, (char*)buf, (int)bufsz, flags, 
-				peeraddr, sizeof(struct sockaddr_in))) <= 0)
-		{
-			errno = EPIPE;
-			return -1;
-		}
-	}
-	else if(xferbytes == 0)
-	{
-		errno = ETIMEDOUT;
-		return -1;
-	}
-	else
-	{
-		errno = EPIPE;
-		return -1;
-	}
-	return 0;
-}
-
-
-/*=========================================================================*/ 
-static int dhcpRecvResponse(int sockfd, void *buf, size_t bufsz,
-		struct timeval* timeout)
-/*	Receives a DHCP response from a DHCP server. Since DHCP responses are
-	broadcasts, we compare XID with received response to ensure we are
-	returning the correct response from a prior request.
-
-	Returns  -    	zero on success, non-zero on failure
-
-	errno         	ENOTCONN error during read
-						ETIMEDOUT read timed out
-  =========================================================================*/ 
-{
-	int xferbytes;
-	fd_set readfds;
-
-	FD_ZERO(&readfds);
-	FD_SET(sockfd, &readfds);
-
-	if((xferbytes = select(sockfd + 1, &readfds, 0 , 0, timeout)) > 0)
-	{
-		if((xferbytes = recvfrom(sockfd, (char*)buf, (int)bufsz, 0, 0, 0)) <= 0)
-		{
-			errno = ENOTCONN;
-			return -1;
-		}
-		return xferbytes;
-	}
-	else if(xferbytes == 0)
-	{
-		errno = ETIMEDOUT;
-		return -1;
-	}
-	errno = ENOTCONN;
-	return -1;
-}
-
 /*=========================================================================*/ 
 static int dhcpProcessOptions(unsigned char *data, size_t datasz,
 		DHCPInfoCallBack *dhcpInfoCB, void *context)
@@ -382,16 +314,11 @@ static int dhcpGetAddressInfo(unsigned char *ipaddr, unsigned char *chaddr,
 
 
 /*=========================================================================*/ 
-int DHCPGetOptionInfo(unsigned char *dhcpOptCodes, int dhcpOptCodeCnt, 
-		DHCPInfoCallBack *dhcpInfoCB, void *context)
-/* Calls dhcpInfoCB once for each requested option in dhcpOptCodes.
-
-	Returns  -    	zero on success, non-zero on failure
+DHCPInform* DHCPInformOpen(unsigned char *dhcpOptCodes, int dhcpOptCodeCnt)
+/*	Builds a DHCPINFORM asking for the options in dhcpOptCodes and opens
+	the broadcast socket it goes out on.
 
-	errno         	ENOTCONN error during read
-               	ETIME read timed out
-               	ENOMEM out of memory
-               	EINVAL parse error
+	Returns  -    	the inform, or NULL on failure
 
 	BOOTP/DHCP packet header format:
 
@@ -446,18 +373,12 @@ int DHCPGetOptionInfo(unsigned char *dhcpOptCodes, int dhcpOptCodeCnt,
 	followed by a length of remaining data value. 
   =========================================================================*/ 
 {
-	UINT32 xid;
 	time_t timer;
-	struct timeval tv;
-	int sockfd, retries;
-	struct sockaddr_in sendaddr;
+	DHCPInform* inform;
 	unsigned char chaddr[MAX_MACADDR_SIZE];
 	unsigned char hlen, htype;
-	unsigned char sndbuf[512];
-	unsigned char rcvbuf[512];
 	struct hostent *hep;
 	unsigned char *p;
-	size_t rcvbufsz = 0;
 	char host[256];
 
 	/* Get our IP and MAC addresses */
@@ -465,19 +386,24 @@ int DHCPGetOptionInfo(unsigned char *dhcpOptCodes, int dhcpOptCodeCnt,
 			|| !(hep = gethostbyname(host))
 			|| dhcpGetAddressInfo((unsigned char *)hep->h_addr, 
 					chaddr, &hlen, &htype))
-		return -1;
+		return 0;
+
+	if((inform = (DHCPInform*)xmalloc(sizeof(DHCPInform))) == 0)
+		return 0;
+	inform->tries = 0;
+	inform->waitusecs = 0;
 
 	/* get a reasonably random transaction id value */
-	xid = (UINT32)time(&timer);
+	inform->xid = (UINT32)time(&timer);
 
 	/* BOOTP request header */
-	memset(sndbuf, 0, 236);		/* clear bootp header */
-	p = sndbuf;
+	memset(inform->sndbuf, 0, 236);		/* clear bootp header */
+	p = inform->sndbuf;
 	*p++ = BOOTREQUEST;			/* opcode */
 	*p++ = htype;
 	*p++ = hlen;
 	p++;								/* hops */
-	ToUINT32(p, xid);
+	ToUINT32(p, inform->xid);
 	p += 2 * sizeof(UINT32);	/* xid, secs, flags */
 	memcpy(p, hep->h_addr, 4);
 	p += 4 * sizeof(UINT32);	/* ciaddr, yiaddr, siaddr, giaddr */
@@ -508,49 +434,145 @@ int DHCPGetOptionInfo(unsigned char *dhcpOptCodes, int dhcpOptCodeCnt,
 
 	/* End option */
 	*p++ = TAG_END;
+	inform->sndbufsz = p - inform->sndbuf;
 
 	/* get a broadcast send/recv socket and address */
-	if((sockfd = dhcpCreateBCSkt(&sendaddr)) < 0)
+	if((inform->sockfd = dhcpCreateBCSkt(&inform->sendaddr)) < 0)
+	{
+		xfree(inform);
+		return 0;
+	}
+
+	return inform;
+}
+
+
+/*=========================================================================*/ 
+int DHCPInformSocket(DHCPInform* inform)
+/*	Returns  -    	the socket the reply comes in on
+  =========================================================================*/ 
+{
+	return inform->sockfd;
+}
+
+
+/*=========================================================================*/ 
+int DHCPInformSend(DHCPInform* inform)
+/*	Broadcasts the DHCPINFORM, again if it was sent before.  Each try waits
+	twice as long as the one before.
+
+	Returns  -    	milliseconds to wait for the reply, or -1 once the
+						tries are used up or the send failed
+  =========================================================================*/ 
+{
+	int flags = 0;
+
+#if defined(MSG_NOSIGNAL)
+	flags = MSG_NOSIGNAL;
+#endif
+
+	if(inform->tries++ >= MAX_DHCP_RETRIES)
 		return -1;
 
-	/* setup select timeout */
-	tv.tv_sec = 0;
-	tv.tv_usec = INIT_TMOUT_USECS;
+	/* exponential backoff */
+	inform->waitusecs = inform->waitusecs? inform->waitusecs * 2: 
+			INIT_TMOUT_USECS;
 
-	retries = 0;
-	srand((unsigned)time(&timer));
-	while (retries++ < MAX_DHCP_RETRIES)
+	if(sendto(inform->sockfd, (char*)inform->sndbuf, (int)inform->sndbufsz, 
+			flags, (struct sockaddr *)&inform->sendaddr, 
+			sizeof(struct sockaddr_in)) <= 0)
 	{
-		if(dhcpSendRequest(sockfd, sndbuf, p - sndbuf, 
-				(struct sockaddr *)&sendaddr, &tv) < 0)
-		{
-			if (errno != ETIMEDOUT)
-			{
-				closesocket(sockfd);
-				return -1;
-			}
-		}
-		else if((rcvbufsz = dhcpRecvResponse(sockfd, rcvbuf, 
-				sizeof(rcvbuf), &tv)) < 0)
-		{
-			if (errno != ETIMEDOUT)
-			{
-				closesocket(sockfd);
-				return -1;
-			}
-		}
-		else if(rcvbufsz >= 236 && AsUINT32(&rcvbuf[4]) == xid)
-			break;
+		errno = EPIPE;
+		return -1;
+	}
+
+	return (int)(inform->waitusecs / USECS_PER_MSEC);
+}
+
+
+/*=========================================================================*/ 
+int DHCPInformRecv(DHCPInform* inform, DHCPInfoCallBack *dhcpInfoCB, 
+		void *context)
+/*	Reads a datagram that arrived on the socket.  DHCP responses are
+	broadcasts, so only the one with our XID is the reply; dhcpInfoCB is
+	called once for each option in it.
+
+	Returns  -    	zero once the reply is processed, positive if the
+						datagram was not the reply, negative on failure
+
+	errno				ENOTCONN error during read
+						EINVAL parse error
+  =========================================================================*/ 
+{
+	unsigned char rcvbuf[512];
+	int rcvbufsz;
 
-		/* exponential backoff randomized by a 
-			uniform number between -1 and 1 */
-		tv.tv_usec = tv.tv_usec * 2 + (rand() % 3) - 1;
-		tv.tv_sec = tv.tv_usec / USECS_PER_SEC;
-		tv.tv_usec %= USECS_PER_SEC;
+	if((rcvbufsz = recvfrom(inform->sockfd, (char*)rcvbuf, 
+			(int)sizeof(rcvbuf), 0, 0, 0)) <= 0)
+	{
+		errno = ENOTCONN;
+		return -1;
 	}
-	closesocket(sockfd);
-	return rcvbufsz? dhcpProcessOptions(rcvbuf + 236, rcvbufsz - 236, 
-			dhcpInfoCB, context): -1;
+	if(rcvbufsz < 236 || AsUINT32(&rcvbuf[4]) != inform->xid)
+		return 1;
+
+	return dhcpProcessOptions(rcvbuf + 236, rcvbufsz - 236, 
+			dhcpInfoCB, context)? -1: 0;
+}
+
+
+/*=========================================================================*/ 
+void DHCPInformClose(DHCPInform* inform)
+/*	Closes the socket and frees the inform.
+  =========================================================================*/ 
+{
+	closesocket(inform->sockfd);
+	xfree(inform);
+}
+
+
+/*=========================================================================*/ 
+int DHCPGetOptionInfo(unsigned char *dhcpOptCodes, int dhcpOptCodeCnt, 
+		DHCPInfoCallBack *dhcpInfoCB, void *context)
+/* Calls dhcpInfoCB once for each requested option in dhcpOptCodes.
+
+	Returns  -    	zero on success, non-zero on failure
+
+	errno         	ENOTCONN error during read
+               	ETIME read timed out
+               	ENOMEM out of memory
+               	EINVAL parse error
+  =========================================================================*/ 
+{
+	DHCPInform* inform;
+	struct timeval tv;
+	fd_set readfds;
+	int result = 1;
+	int wait;
+
+	if((inform = DHCPInformOpen(dhcpOptCodes, dhcpOptCodeCnt)) == 0)
+		return -1;
+
+	while(result > 0 && (wait = DHCPInformSend(inform)) >= 0)
+	{
+		tv.tv_sec = wait / MSECS_PER_SEC;
+		tv.tv_usec = (wait % MSECS_PER_SEC) * USECS_PER_MSEC;
+
+		/* skip the replies to other clients until this try times out */
+		do
+		{
+			FD_ZERO(&readfds);
+			FD_SET(inform->sockfd, &readfds);
+			if(select(inform->sockfd + 1, &readfds, 0, 0, &tv) <= 0)
+				break;
+			result = DHCPInformRecv(inform, dhcpInfoCB, context);
+		} while(result > 0);
+	}
+	DHCPInformClose(inform);
+
+	if(result > 0)
+		errno = ETIMEDOUT;
+	return result? -1: 0;
 }
 
 /*-------------------------------------------------------------------------*/
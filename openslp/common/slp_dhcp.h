@@ -90,6 +90,48 @@ typedef int DHCPInfoCallBack(int tag, void *optdata,
 /* Returns  -    zero on success, non-zero on 'stop processing options'.	*/
 /*=========================================================================*/
 
+/*=========================================================================*/
+typedef struct _DHCPInform DHCPInform;
+/* A DHCPINFORM for callers that wait for the reply in their own select()	*/
+/* loop.  DHCPGetOptionInfo() does it all in one blocking call.				*/
+/*=========================================================================*/
+
+/*=========================================================================*/
+DHCPInform* DHCPInformOpen(unsigned char *dhcpOptCodes, int dhcpOptCodeCnt);
+/* Builds a DHCPINFORM asking for the options in dhcpOptCodes and opens		*/
+/* the broadcast socket it goes out on.												*/
+/*                                                                         */
+/* Returns  -    the inform, or NULL on failure                            */
+/*=========================================================================*/
+
+/*=========================================================================*/
+int DHCPInformSocket(DHCPInform* inform);
+/* Returns  -    the socket to wait on for the reply                       */
+/*=========================================================================*/
+
+/*=========================================================================*/
+int DHCPInformSend(DHCPInform* inform);
+/* Broadcasts the DHCPINFORM, again if it was sent before.						*/
+/*                                                                         */
+/* Returns  -    milliseconds to wait for the reply, or -1 once the tries  */
+/*               are used up or the send failed                            */
+/*=========================================================================*/
+
+/*=========================================================================*/
+int DHCPInformRecv(DHCPInform* inform, DHCPInfoCallBack *dhcpInfoCB, 
+		void *context);
+/* Reads a datagram that arrived on the socket.  If it is the reply,			*/
+/* dhcpInfoCB is called once for each option in it.								*/
+/*                                                                         */
+/* Returns  -    zero once the reply is processed, positive if the         */
+/*               datagram was not the reply, negative on failure           */
+/*=========================================================================*/
+
+/*=========================================================================*/
+void DHCPInformClose(DHCPInform* inform);
+/* Closes the socket and frees the inform.											*/
+/*=========================================================================*/
+
 /*=========================================================================*/
 int DHCPGetOptionInfo(unsigned char *dhcpOptCodes, int dhcpOptCodeCnt, 
 		DHCPInfoCallBack *dhcpInfoCB, void *context);
@@ -0,0 +1,166 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol                                                   */
+/*                                                                         */
+/* File:        slp_histogram.c                                            */
+/*                                                                         */
+/* Abstract:    Log-linear latency histogram shared by slpd and slptool    */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+/***************************************************************************/
+
+#include "slp_histogram.h"
+
+
+/*-------------------------------------------------------------------------*/
+static int SLPHistogramBucket(unsigned long usecs)
+/* Returns the bucket usecs is counted in                                  */
+/*-------------------------------------------------------------------------*/
+{
+    int msb;
+    int bucket;
+
+    if(usecs < SLP_HISTOGRAM_SUBBUCKETS)
+    {
+        return usecs;
+    }
+
+    msb = SLP_HISTOGRAM_SUBBITS;
+    while(usecs >> (msb + 1))
+    {
+        msb++;
+    }
+
+    /* the power of two picks the row, the next bits the bucket in it */
+    bucket = (msb - SLP_HISTOGRAM_SUBBITS + 1) * SLP_HISTOGRAM_SUBBUCKETS +
+             ((usecs >> (msb - SLP_HISTOGRAM_SUBBITS)) &
+              (SLP_HISTOGRAM_SUBBUCKETS - 1));
+    if(bucket >= SLP_HISTOGRAM_BUCKETS)
+    {
+        bucket = SLP_HISTOGRAM_BUCKETS - 1;
+    }
+
+    return bucket;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static unsigned long SLPHistogramBucketTop(int bucket)
+/* Returns the largest latency counted in bucket                           */
+/*-------------------------------------------------------------------------*/
+{
+    int shift;
+    int sub;
+
+    if(bucket < SLP_HISTOGRAM_SUBBUCKETS)
+    {
+        return bucket;
+    }
+
+    shift = bucket / SLP_HISTOGRAM_SUBBUCKETS - 1;
+    sub = bucket % SLP_HISTOGRAM_SUBBUCKETS;
+
+    return ((unsigned long)(SLP_HISTOGRAM_SUBBUCKETS + sub + 1) << shift) - 1;
+}
+
+
+/*=========================================================================*/
+void SLPHistogramAdd(SLPHistogram* hist, unsigned long usecs)
+/* Description:
+ *    Counts one latency in a histogram.  A zeroed SLPHistogram is empty
+ *
+ * Parameters:
+ *    hist  (IN/OUT) the histogram to count usecs in
+ *    usecs (IN) the latency in microseconds
+ *
+ * Returns:
+ *    None
+ *=========================================================================*/
+{
+    hist->count++;
+    hist->total += usecs;
+    if(usecs > hist->max)
+    {
+        hist->max = usecs;
+    }
+    hist->buckets[SLPHistogramBucket(usecs)]++;
+}
+
+
+/*=========================================================================*/
+unsigned long SLPHistogramPercentile(SLPHistogram* hist, int permille)
+/* Description:
+ *    Estimates the latency a given share of the counted latencies took at
+ *    most.  The estimate is the top of a bucket, but never more than the
+ *    exact maximum
+ *
+ * Parameters:
+ *    hist     (IN) the histogram
+ *    permille (IN) the share in thousandths, 500 for the median
+ *
+ * Returns:
+ *    The latency in microseconds, 0 if hist is empty
+ *=========================================================================*/
+{
+    unsigned long   wanted;
+    unsigned long   seen;
+    unsigned long   top;
+    int             i;
+
+    if(hist->count == 0)
+    {
+        return 0;
+    }
+
+    wanted = (hist->count * permille + 999) / 1000;
+    seen = 0;
+    for(i = 0; i < SLP_HISTOGRAM_BUCKETS - 1; i++)
+    {
+        seen += hist->buckets[i];
+        if(seen >= wanted)
+        {
+            break;
+        }
+    }
+
+    /* the bucket is only an estimate, the maximum is exact */
+    top = SLPHistogramBucketTop(i);
+    return top < hist->max ? top : hist->max;
+}
@@ -0,0 +1,103 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol                                                   */
+/*                                                                         */
+/* File:        slp_histogram.h                                            */
+/*                                                                         */
+/* Abstract:    Log-linear latency histogram shared by slpd and slptool    */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+/***************************************************************************/
+
+#ifndef SLP_HISTOGRAM_H_INCLUDED
+#define SLP_HISTOGRAM_H_INCLUDED
+
+/*=========================================================================*/
+/* Latencies are kept in log-linear buckets, like an HDR histogram: eight  */
+/* buckets for every power of two, so a bucket is never more than 12.5%    */
+/* wide.  192 buckets reach 2^26 microseconds (67 seconds), anything       */
+/* slower goes in the last one.                                            */
+/*=========================================================================*/
+#define SLP_HISTOGRAM_SUBBITS       3
+#define SLP_HISTOGRAM_SUBBUCKETS    (1 << SLP_HISTOGRAM_SUBBITS)
+#define SLP_HISTOGRAM_BUCKETS       192
+
+
+/*=========================================================================*/
+typedef struct _SLPHistogram
+/*=========================================================================*/
+{
+    unsigned long   count;
+    double          total;      /* microseconds */
+    unsigned long   max;        /* microseconds */
+    unsigned long   buckets[SLP_HISTOGRAM_BUCKETS];
+}SLPHistogram;
+
+
+/*=========================================================================*/
+void SLPHistogramAdd(SLPHistogram* hist, unsigned long usecs);
+/* Description:
+ *    Counts one latency in a histogram.  A zeroed SLPHistogram is empty
+ *
+ * Parameters:
+ *    hist  (IN/OUT) the histogram to count usecs in
+ *    usecs (IN) the latency in microseconds
+ *
+ * Returns:
+ *    None
+ *=========================================================================*/
+
+
+/*=========================================================================*/
+unsigned long SLPHistogramPercentile(SLPHistogram* hist, int permille);
+/* Description:
+ *    Estimates the latency a given share of the counted latencies took at
+ *    most.  The estimate is the top of a bucket, but never more than the
+ *    exact maximum
+ *
+ * Parameters:
+ *    hist     (IN) the histogram
+ *    permille (IN) the share in thousandths, 500 for the median
+ *
+ * Returns:
+ *    The latency in microseconds, 0 if hist is empty
+ *=========================================================================*/
+
+#endif
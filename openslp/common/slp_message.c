@@ -49,6 +49,7 @@
 
 #include "slp_message.h"
 #include "slp_xmalloc.h"
+#include "slp_compare.h"
 
 #ifndef _WIN32
 #include <sys/types.h>
@@ -230,7 +231,8 @@ int ParseUrlEntry(SLPBuffer buffer, SLPUrlEntry* urlentry)
 
 
 /*--------------------------------------------------------------------------*/
-int ParseSrvRqst(SLPBuffer buffer, SLPSrvRqst* srvrqst)
+int ParseSrvRqstRouting(SLPBuffer buffer, SLPSrvRqst* srvrqst)
+/* Parses a SrvRqst up to and including the scope list                      */
 /*--------------------------------------------------------------------------*/
 {
     /* make sure that min size is met */
@@ -271,7 +273,15 @@ int ParseSrvRqst(SLPBuffer buffer, SLPSrvRqst* srvrqst)
     srvrqst->scopelist = buffer->curpos;
     buffer->curpos = buffer->curpos + srvrqst->scopelistlen;    
 
+    return 0;
+}
+
 
+/*--------------------------------------------------------------------------*/
+int ParseSrvRqstRemainder(SLPBuffer buffer, SLPSrvRqst* srvrqst)
+/* Parses what follows the scope list of a SrvRqst                          */
+/*--------------------------------------------------------------------------*/
+{
     /* parse the predicate string */
     srvrqst->predicatever = 2;  /* SLPv2 predicate (LDAPv3) */
     srvrqst->predicatelen = AsUINT16(buffer->curpos);
@@ -298,6 +308,22 @@ int ParseSrvRqst(SLPBuffer buffer, SLPSrvRqst* srvrqst)
 }
 
 
+/*--------------------------------------------------------------------------*/
+int ParseSrvRqst(SLPBuffer buffer, SLPSrvRqst* srvrqst)
+/*--------------------------------------------------------------------------*/
+{
+    int result;
+
+    result = ParseSrvRqstRouting(buffer,srvrqst);
+    if(result == 0)
+    {
+        result = ParseSrvRqstRemainder(buffer,srvrqst);
+    }
+
+    return result;
+}
+
+
 /*--------------------------------------------------------------------------*/
 int ParseSrvRply(SLPBuffer buffer, SLPSrvRply* srvrply)
 /*--------------------------------------------------------------------------*/
@@ -358,6 +384,9 @@ int ParseSrvReg(SLPBuffer buffer, SLPSrvReg* srvreg)
     int             result;
     int             i;
 
+    /* folded keys are computed later by whoever needs them */
+    srvreg->keys = 0;
+
     /* Parse out the url entry */
     result = ParseUrlEntry(buffer,&(srvreg->urlentry));
     if(result)
@@ -485,7 +514,8 @@ int ParseSrvAck(SLPBuffer buffer, SLPSrvAck* srvack)
 
 
 /*--------------------------------------------------------------------------*/
-int ParseAttrRqst(SLPBuffer buffer, SLPAttrRqst* attrrqst)
+int ParseAttrRqstRouting(SLPBuffer buffer, SLPAttrRqst* attrrqst)
+/* Parses an AttrRqst up to and including the scope list                    */
 /*--------------------------------------------------------------------------*/
 {
     /* make sure that min size is met */
@@ -525,7 +555,15 @@ int ParseAttrRqst(SLPBuffer buffer, SLPAttrRqst* attrrqst)
     attrrqst->scopelist = buffer->curpos;
     buffer->curpos = buffer->curpos + attrrqst->scopelistlen;    
 
+    return 0;
+}
+
 
+/*--------------------------------------------------------------------------*/
+int ParseAttrRqstRemainder(SLPBuffer buffer, SLPAttrRqst* attrrqst)
+/* Parses what follows the scope list of an AttrRqst                        */
+/*--------------------------------------------------------------------------*/
+{
     /* parse the taglist string */
     attrrqst->taglistlen = AsUINT16(buffer->curpos);
     buffer->curpos = buffer->curpos + 2;
@@ -551,6 +589,22 @@ int ParseAttrRqst(SLPBuffer buffer, SLPAttrRqst* attrrqst)
 }
 
 
+/*--------------------------------------------------------------------------*/
+int ParseAttrRqst(SLPBuffer buffer, SLPAttrRqst* attrrqst)
+/*--------------------------------------------------------------------------*/
+{
+    int result;
+
+    result = ParseAttrRqstRouting(buffer,attrrqst);
+    if(result == 0)
+    {
+        result = ParseAttrRqstRemainder(buffer,attrrqst);
+    }
+
+    return result;
+}
+
+
 /*--------------------------------------------------------------------------*/
 int ParseAttrRply(SLPBuffer buffer, SLPAttrRply* attrrply)
 /*--------------------------------------------------------------------------*/
@@ -959,6 +1013,11 @@ void SLPMessageFreeInternals(SLPMessage message)
             xfree(message->body.srvreg.autharray);
             message->body.srvreg.autharray = 0;
         }
+        if(message->body.srvreg.keys)
+        {
+            SLPFoldedKeysFree(message->body.srvreg.keys);
+            message->body.srvreg.keys = 0;
+        }
         break;
 
 
@@ -1004,8 +1063,20 @@ void SLPMessageFreeInternals(SLPMessage message)
         /* don't do anything */
         break;
     }
+
+    message->remainder = 0;
 }
 
+/*-------------------------------------------------------------------------*/
+static SLPMessage   G_SLPMessagePool        = 0;
+static int          G_SLPMessagePoolLimit   = 0;
+static int          G_SLPMessagePoolLowFree = 0;
+static SLPPoolStats G_SLPMessagePoolStats;
+/* Free list of message descriptors.  The first bytes of a pooled message  */
+/* hold the pointer to the next one.                                       */
+/*-------------------------------------------------------------------------*/
+
+
 /*=========================================================================*/
 SLPMessage SLPMessageAlloc()
 /* Allocates memory for a SLP message descriptor                           */
@@ -1013,10 +1084,45 @@ SLPMessage SLPMessageAlloc()
 /* Returns   - A newly allocated SLPMessage pointer of NULL on ENOMEM      */
 /*=========================================================================*/
 {
-    SLPMessage result = (SLPMessage)xmalloc(sizeof(struct _SLPMessage));
+    SLPMessage result;
+
+    if(G_SLPMessagePoolLimit == 0)
+    {
+        /* the pool is off, keep away from its unlocked statistics */
+        result = (SLPMessage)xmalloc(sizeof(struct _SLPMessage));
+        if(result)
+        {
+            memset(result,0,sizeof(struct _SLPMessage));
+        }
+        return result;
+    }
+
+    result = G_SLPMessagePool;
+    if(result)
+    {
+        G_SLPMessagePool = *(SLPMessage*)result;
+        G_SLPMessagePoolStats.pooled --;
+        if(G_SLPMessagePoolStats.pooled < G_SLPMessagePoolLowFree)
+        {
+            G_SLPMessagePoolLowFree = G_SLPMessagePoolStats.pooled;
+        }
+        G_SLPMessagePoolStats.hits ++;
+    }
+    else
+    {
+        result = (SLPMessage)xmalloc(sizeof(struct _SLPMessage));
+    }
+
     if(result)
     {
         memset(result,0,sizeof(struct _SLPMessage));
+
+        G_SLPMessagePoolStats.allocs ++;
+        G_SLPMessagePoolStats.inuse ++;
+        if(G_SLPMessagePoolStats.inuse > G_SLPMessagePoolStats.maxinuse)
+        {
+            G_SLPMessagePoolStats.maxinuse = G_SLPMessagePoolStats.inuse;
+        }
     }
 
     return result;
@@ -1058,11 +1164,86 @@ void SLPMessageFree(SLPMessage message)
     if(message)
     {
         SLPMessageFreeInternals(message);
+
+        if(G_SLPMessagePoolLimit == 0)
+        {
+            xfree(message);
+            return;
+        }
+
+        G_SLPMessagePoolStats.frees ++;
+        G_SLPMessagePoolStats.inuse --;
+        if(G_SLPMessagePoolStats.pooled < G_SLPMessagePoolLimit)
+        {
+            *(SLPMessage*)message = G_SLPMessagePool;
+            G_SLPMessagePool = message;
+            G_SLPMessagePoolStats.pooled ++;
+        }
+        else
+        {
+            xfree(message);
+        }
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void SLPMessagePoolRelease(int count)
+/* Releases count messages from the free list                              */
+/*-------------------------------------------------------------------------*/
+{
+    SLPMessage message;
+
+    while(count > 0 && G_SLPMessagePool)
+    {
+        message = G_SLPMessagePool;
+        G_SLPMessagePool = *(SLPMessage*)message;
         xfree(message);
+        G_SLPMessagePoolStats.pooled --;
+        G_SLPMessagePoolStats.trimmed ++;
+        count --;
     }
 }
 
 
+/*=========================================================================*/
+void SLPMessagePoolSetLimit(int limit)
+/* Sets how many freed message descriptors are kept for reuse.  Like the   */
+/* SLPBuffer pools this is not thread safe and is off until turned on, and */
+/* only descriptors allocated while it is on are counted.                  */
+/*                                                                         */
+/* limit    - (IN) descriptors kept.  Zero releases all pooled descriptors */
+/*            and turns pooling off                                        */
+/*=========================================================================*/
+{
+    G_SLPMessagePoolLimit = limit;
+    SLPMessagePoolRelease(G_SLPMessagePoolStats.pooled - limit);
+    G_SLPMessagePoolLowFree = G_SLPMessagePoolStats.pooled;
+}
+
+
+/*=========================================================================*/
+void SLPMessagePoolTrim(void)
+/* Releases the pooled message descriptors that were not needed since the  */
+/* last trim                                                               */
+/*=========================================================================*/
+{
+    SLPMessagePoolRelease(G_SLPMessagePoolLowFree);
+    G_SLPMessagePoolLowFree = G_SLPMessagePoolStats.pooled;
+}
+
+
+/*=========================================================================*/
+void SLPMessagePoolGetStats(SLPPoolStats* stats)
+/* Gets the statistics of the message descriptor pool                      */
+/*                                                                         */
+/* stats    - (OUT) the statistics                                         */
+/*=========================================================================*/
+{
+    memcpy(stats,&G_SLPMessagePoolStats,sizeof(SLPPoolStats));
+}
+
+
 /*=========================================================================*/
 int SLPMessageParseBuffer(struct sockaddr_in* peerinfo,
                           SLPBuffer buffer, 
@@ -1154,6 +1335,107 @@ int SLPMessageParseBuffer(struct sockaddr_in* peerinfo,
     return result;
 }
 
+
+/*=========================================================================*/
+int SLPMessageParseRouting(struct sockaddr_in* peerinfo,
+                           SLPBuffer buffer, 
+                           SLPMessage message)
+/* Like SLPMessageParseBuffer() but for SrvRqst, AttrRqst and SrvTypeRqst  */
+/* messages only parses the header, the prlist, the service type or URL,   */
+/* and the scope list.  These are enough to decide whether the request     */
+/* will be answered.  SLPMessageParseRemainder() must be called before any */
+/* other field of the message is used.  Other messages are parsed          */
+/* completely.                                                             */
+/*                                                                         */
+/* buffer   - (IN) pointer the SLPBuffer to parse                          */
+/*                                                                         */
+/* message  - (OUT) set to describe the message from the buffer            */
+/*                                                                         */
+/* Returns  - Same as SLPMessageParseBuffer()                              */
+/*=========================================================================*/
+{
+    int result;
+
+    /* Copy in the peer info */
+    memcpy(&message->peer,peerinfo,sizeof(message->peer));
+
+    /* Get ready to parse */
+    SLPMessageFreeInternals(message);
+    buffer->curpos = buffer->start;
+
+    result = SLPMessageParseHeader(buffer,&(message->header));
+    if(result == 0)
+    {
+        switch(message->header.functionid)
+        {
+        case SLP_FUNCT_SRVRQST:
+            result = ParseSrvRqstRouting(buffer,&(message->body.srvrqst));
+            break;
+
+        case SLP_FUNCT_ATTRRQST:
+            result = ParseAttrRqstRouting(buffer,&(message->body.attrrqst));
+            break;
+
+        case SLP_FUNCT_SRVTYPERQST:
+            /* everything but the extensions is needed to route it */
+            result = ParseSrvTypeRqst(buffer,&(message->body.srvtyperqst));
+            break;
+
+        default:
+            return SLPMessageParseBuffer(peerinfo,buffer,message);
+        }
+
+        if(result == 0)
+        {
+            message->remainder = buffer->curpos - buffer->start;
+        }
+    }
+
+    return result;
+}
+
+
+/*=========================================================================*/
+int SLPMessageParseRemainder(SLPBuffer buffer, SLPMessage message)
+/* Parses the rest of a message started with SLPMessageParseRouting()      */
+/*                                                                         */
+/* buffer   - (IN) the SLPBuffer passed to SLPMessageParseRouting()        */
+/*                                                                         */
+/* message  - (IN/OUT) the message to finish                               */
+/*                                                                         */
+/* Returns  - Same as SLPMessageParseBuffer().  Zero if the message was    */
+/*            already parsed completely.                                   */
+/*=========================================================================*/
+{
+    int result = 0;
+
+    if(message->remainder == 0)
+    {
+        return 0;
+    }
+
+    buffer->curpos = buffer->start + message->remainder;
+    message->remainder = 0;
+
+    switch(message->header.functionid)
+    {
+    case SLP_FUNCT_SRVRQST:
+        result = ParseSrvRqstRemainder(buffer,&(message->body.srvrqst));
+        break;
+
+    case SLP_FUNCT_ATTRRQST:
+        result = ParseAttrRqstRemainder(buffer,&(message->body.attrrqst));
+        break;
+    }
+
+    if(result == 0 && message->header.extoffset)
+    {
+        result = ParseExtension(buffer,message);
+    }
+
+    return result;
+}
+
 /*=========================================================================*/
 /* Functions used to parse buffers                                         */
 
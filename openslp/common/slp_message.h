@@ -98,6 +98,8 @@ typedef UINT32*         PUINT32;
 #define SLP_BCAST_ADDRESS       0xffffffff  /* 255.255.255.255 */
 #define SLPv1_DA_MCAST_ADDRESS  0xe0000123  /* 224.0.1.35 */
 #define LOOPBACK_ADDRESS        0x7f000001  /* 127.0.0.1 */
+#define SLP_LOCAL_SOCKET        "/var/run/slpd.sock" /* slpd's unix socket */
+#define SLP_STATS_SOCKET        "/var/run/slpd.stats" /* slpd's counters */
 #define SLP_MAX_DATAGRAM_SIZE   1400 
 #if(!defined SLP_LIFETIME_MAXIMUM) 
 #define SLP_LIFETIME_MAXIMUM    0xffff
@@ -280,6 +282,8 @@ typedef struct _SLPSrvReg
     /* The following are not part of the RFC protocol.  They are used by   */
     /* the OpenSLP implementation for convenience                          */
     int                 source;
+    struct _SLPFoldedKeys* keys; /* folded srvtype, url and scopes that   */
+                                 /* slpd matches registrations on         */
 }SLPSrvReg;
 
 
@@ -413,6 +417,10 @@ typedef struct _SLPMessage
         SLPSAAdvert       saadvert;
     }body; 
 
+    int                   remainder;
+    /* offset in the buffer of the part of the message not yet parsed by  */
+    /* SLPMessageParseRemainder(), zero if the message is fully parsed    */
+
 }*SLPMessage;
 
 
@@ -445,6 +453,31 @@ void SLPMessageFree(SLPMessage message);
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+void SLPMessagePoolSetLimit(int limit);
+/* Sets how many freed message descriptors are kept for reuse.  Like the   */
+/* SLPBuffer pools this is not thread safe and is off until turned on.     */
+/*                                                                         */
+/* limit    - (IN) descriptors kept.  Zero releases all pooled descriptors */
+/*            and turns pooling off                                        */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void SLPMessagePoolTrim(void);
+/* Releases the pooled message descriptors that were not needed since the  */
+/* last trim                                                               */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void SLPMessagePoolGetStats(SLPPoolStats* stats);
+/* Gets the statistics of the message descriptor pool                      */
+/*                                                                         */
+/* stats    - (OUT) the statistics                                         */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 int SLPMessageParseHeader(SLPBuffer buffer, SLPHeader* header);
 /* Fill out a header structure with what ever is in the buffer             */
@@ -477,6 +510,41 @@ int SLPMessageParseBuffer(struct sockaddr_in* peerinfo,
 /*            pointers in SLPMessage will be invalidated.                  */
 /*=========================================================================*/
 
+
+/*=========================================================================*/
+int SLPMessageParseRouting(struct sockaddr_in* peerinfo,
+                           SLPBuffer buffer, 
+                           SLPMessage message);
+/* Like SLPMessageParseBuffer() but for SrvRqst, AttrRqst and SrvTypeRqst  */
+/* messages only parses the header, the prlist, the service type or URL,   */
+/* and the scope list.  These are enough to decide whether the request     */
+/* will be answered.  SLPMessageParseRemainder() must be called before any */
+/* other field of the message is used.  Other messages are parsed          */
+/* completely.                                                             */
+/*                                                                         */
+/* peerinfo - (IN) pointer to the network address information that sent    */ 
+/*                 buffer                                                  */
+/*                                                                         */
+/* buffer   - (IN) pointer the SLPBuffer to parse                          */
+/*                                                                         */
+/* message  - (OUT) set to describe the message from the buffer            */
+/*                                                                         */
+/* Returns  - Same as SLPMessageParseBuffer()                              */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int SLPMessageParseRemainder(SLPBuffer buffer, SLPMessage message);
+/* Parses the rest of a message started with SLPMessageParseRouting()      */
+/*                                                                         */
+/* buffer   - (IN) the SLPBuffer passed to SLPMessageParseRouting()        */
+/*                                                                         */
+/* message  - (IN/OUT) the message to finish                               */
+/*                                                                         */
+/* Returns  - Same as SLPMessageParseBuffer().  Zero if the message was    */
+/*            already parsed completely.                                   */
+/*=========================================================================*/
+
 /*=========================================================================*/
 /* Functions used to parse buffers                                         */
 unsigned short AsUINT16(const char *charptr);
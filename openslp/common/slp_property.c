@@ -61,14 +61,117 @@
 #include "slp_property.h"
 #include "slp_xmalloc.h"
 
+/*=========================================================================*/
+typedef struct _SLPPropertySnapshot
+/* A complete set of properties.  Once published a set is never changed:   */
+/* SLPPropertySet() copies the current set, changes the copy and publishes */
+/* it in place of the original, so threads read properties without a lock. */
+/* The values are shared between the sets that have them                   */
+/*=========================================================================*/
+{
+    struct _SLPPropertySnapshot*    next;   /* on G_SLPPropertyRetired     */
+    SLPList                         list;
+}SLPPropertySnapshot;
+
+/*=========================================================================*/
+typedef struct _SLPPropertyValue
+/* A property value, the string follows it in the same allocation.  It     */
+/* goes with the last set it is in, which is only freed once no reader can */
+/* be looking at it                                                        */
+/*=========================================================================*/
+{
+    int                         refcount;   /* the sets it is in           */
+}SLPPropertyValue;
+
+#define PropertyValueOf(property) \
+    (((SLPPropertyValue*)(property)->propertyValue) - 1)
+
 /*=========================================================================*/
 /* Global Variables                                                        */
 /*=========================================================================*/
-SLPList G_SLPPropertyList = {0,0,0};
+/* G_SLPProperties is the published set.  A reader registers in            */
+/* G_SLPPropertyReaders for the current G_SLPPropertyEpoch while it looks  */
+/* at it.  Replaced sets wait on G_SLPPropertyRetired until the epoch is   */
+/* flipped, then on G_SLPPropertyDraining until the readers of the old     */
+/* epoch, G_SLPPropertyDrainEpoch, are gone                                */
+static SLPPropertySnapshot* volatile G_SLPProperties = 0;
+static SLPPropertySnapshot* volatile G_SLPPropertyRetired = 0;
+static SLPPropertySnapshot* volatile G_SLPPropertyDraining = 0;
+static volatile int     G_SLPPropertyDrainEpoch = 0;
+static volatile int     G_SLPPropertyReclaiming = 0;
+static volatile int     G_SLPPropertyEpoch      = 0;
+static volatile int     G_SLPPropertyReaders[2] = {0, 0};
+
+#if defined(__GNUC__)
+#define PropertyAtomicAdd(p,n)      __sync_add_and_fetch((p),(n))
+#define PropertyAtomicLoad(p)       __atomic_load_n((p),__ATOMIC_ACQUIRE)
+#define PropertyAtomicStore(p,v)    __atomic_store_n((p),(v),__ATOMIC_RELEASE)
+#define PropertyAtomicSwap(p,c,v)   __sync_bool_compare_and_swap((p),(c),(v))
+#define PropertyAtomicTake(p)       __atomic_exchange_n((p),0,__ATOMIC_ACQ_REL)
+#else
+/* without atomics, properties may only be set by one thread */
+#define PropertyAtomicAdd(p,n)      (*(p) += (n))
+#define PropertyAtomicLoad(p)       (*(p))
+#define PropertyAtomicStore(p,v)    (*(p) = (v))
+#define PropertyAtomicSwap(p,c,v)   (*(p) = (v), 1)
+#define PropertyAtomicTake(p)       PropertyTake((void**)(p))
+static void* PropertyTake(void** p)
+{
+    void* v = *p;
+    *p = 0;
+    return v;
+}
+#endif
+
+#define SLPPropertyCurrent() PropertyAtomicLoad(&G_SLPProperties)
+#define SLPPropertyPublish(current,snapshot) \
+    PropertyAtomicSwap(&G_SLPProperties,current,snapshot)
+
+#define PropertyDrained() \
+    (PropertyAtomicLoad(&G_SLPPropertyReaders[ \
+        PropertyAtomicLoad(&G_SLPPropertyDrainEpoch)]) == 0)
+
+static void SnapshotReclaim();
+
 
+/*-------------------------------------------------------------------------*/
+static int PropertyReaderEnter()
+/* Registers the caller as a reader of the published set                   */
+/*                                                                         */
+/* Returns: the epoch to pass to PropertyReaderLeave()                     */
+/*-------------------------------------------------------------------------*/
+{
+    int epoch;
+
+    while(1)
+    {
+        epoch = PropertyAtomicLoad(&G_SLPPropertyEpoch) & 1;
+        PropertyAtomicAdd(&G_SLPPropertyReaders[epoch],1);
+        if((PropertyAtomicLoad(&G_SLPPropertyEpoch) & 1) == epoch)
+        {
+            return epoch;
+        }
+        /* the epoch flipped under us */
+        PropertyAtomicAdd(&G_SLPPropertyReaders[epoch],-1);
+    }
+}
 
+
+/*-------------------------------------------------------------------------*/
+static void PropertyReaderLeave(int epoch)
+/* The last reader of an epoch frees the sets that waited for it           */
 /*-------------------------------------------------------------------------*/
-SLPProperty* Find(const char* pcName)
+{
+    if(PropertyAtomicAdd(&G_SLPPropertyReaders[epoch],-1) == 0 &&
+       PropertyAtomicLoad(&G_SLPPropertyDraining))
+    {
+        SnapshotReclaim();
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+SLPProperty* Find(SLPPropertySnapshot* snapshot, const char* pcName)
 /* Finds the property in the property list with the specified name.        */
 /*                                                                         */
 /* pcName   pointer to the property name                                   */
@@ -77,9 +180,12 @@ SLPProperty* Find(const char* pcName)
 /*          property was not found.                                        */
 /*-------------------------------------------------------------------------*/
 {
-    SLPProperty*  curProperty;
+    SLPProperty*  curProperty = 0;
 
-    curProperty = (SLPProperty*)G_SLPPropertyList.head;
+    if(snapshot)
+    {
+        curProperty = (SLPProperty*)snapshot->list.head;
+    }
     while(curProperty != 0)
     {
         if(strcmp(curProperty->propertyName,pcName) == 0)
@@ -93,29 +199,71 @@ SLPProperty* Find(const char* pcName)
 }
 
 
+/*-------------------------------------------------------------------------*/
+static void ValueRelease(SLPPropertyValue* value)
+/* Drops a set's reference to a value                                      */
+/*-------------------------------------------------------------------------*/
+{
+    if(PropertyAtomicAdd(&value->refcount,-1) == 0)
+    {
+        xfree(value);
+    }
+}
+
 
-/*=========================================================================*/
-const char* SLPPropertyGet(const char* pcName)
-/*=========================================================================*/
+/*-------------------------------------------------------------------------*/
+static int SnapshotSetValue(SLPPropertySnapshot* snapshot,
+                            const char *pcName,
+                            SLPPropertyValue* value)
+/* Sets a property in a set that is not published yet to a value, which    */
+/* the set takes a reference to                                            */
+/*-------------------------------------------------------------------------*/
 {
-    SLPProperty* existingProperty = Find(pcName);
-    if(existingProperty)
+    int             pcNameSize; 
+    SLPProperty*    newProperty; 
+
+    newProperty = Find(snapshot,pcName);
+    if(newProperty)
     {
-        return existingProperty->propertyValue;
+        /* property already exists in the list */
+        ValueRelease(PropertyValueOf(newProperty));
     }
+    else
+    {
+        /* property does not exist in the list */
+        pcNameSize = strlen(pcName) + 1;
+        newProperty = (SLPProperty*)xmalloc(sizeof(SLPProperty) + pcNameSize);
+        if(newProperty == 0)
+        {
+            /* out of memory */
+            errno = ENOMEM;
+            return -1;
+        }
+
+        /* the name follows the SLPProperty structure */
+        newProperty->propertyName = ((char*)newProperty) + sizeof(SLPProperty); 
+        memcpy(newProperty->propertyName,pcName,pcNameSize);
+
+        /* Link the new property into the list */
+        SLPListLinkHead(&(snapshot->list),(SLPListItem*)newProperty);
+    }
+
+    PropertyAtomicAdd(&value->refcount,1);
+    newProperty->propertyValue = (char*)(value + 1);
 
     return 0;
 }
 
 
-/*=========================================================================*/
-int SLPPropertySet(const char *pcName,
-                   const char *pcValue)
-/*=========================================================================*/
+/*-------------------------------------------------------------------------*/
+static int SnapshotSet(SLPPropertySnapshot* snapshot,
+                       const char *pcName,
+                       const char *pcValue)
+/* Sets a property in a set that is not published yet                      */
+/*-------------------------------------------------------------------------*/
 {
-    int             pcNameSize; 
-    int             pcValueSize;
-    SLPProperty*    newProperty; 
+    int                 pcValueSize;
+    SLPPropertyValue*   value;
 
     if(pcValue == 0)
     {
@@ -123,99 +271,372 @@ int SLPPropertySet(const char *pcName,
        return 0;
     }
     
-    newProperty = Find(pcName);
-    pcNameSize = strlen(pcName) + 1;
     pcValueSize = strlen(pcValue) + 1;
+    value = (SLPPropertyValue*)xmalloc(sizeof(SLPPropertyValue) + pcValueSize);
+    if(value == 0)
+    {
+        /* out of memory */
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(value,0,sizeof(SLPPropertyValue));
+    memcpy(value + 1,pcValue,pcValueSize);
 
-    if(newProperty == 0)
+    if(SnapshotSetValue(snapshot,pcName,value))
     {
-        /* property does not exist in the list */
-        newProperty = (SLPProperty*)xmalloc(sizeof(SLPProperty) + pcNameSize + pcValueSize);
-        if(newProperty == 0)
+        xfree(value);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void SnapshotClear(SLPPropertySnapshot* snapshot)
+/* Empties a set, releasing its values                                     */
+/*-------------------------------------------------------------------------*/
+{
+    SLPProperty*    property;
+
+    while(snapshot->list.head)
+    {
+        property = (SLPProperty*)SLPListUnlink(&(snapshot->list),
+                                               snapshot->list.head);
+        ValueRelease(PropertyValueOf(property));
+        xfree(property);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void SnapshotFree(SLPPropertySnapshot* snapshot)
+/*-------------------------------------------------------------------------*/
+{
+    SnapshotClear(snapshot);
+    xfree(snapshot);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPPropertySnapshot* SnapshotMerge(SLPPropertySnapshot* base,
+                                          SLPPropertySnapshot* changes)
+/* Returns a new set with the properties of base, if any, overridden by    */
+/* the ones in changes, or NULL if out of memory                           */
+/*-------------------------------------------------------------------------*/
+{
+    SLPPropertySnapshot*    snapshot;
+    SLPProperty*            property;
+
+    snapshot = (SLPPropertySnapshot*)xmalloc(sizeof(SLPPropertySnapshot));
+    if(snapshot == 0)
+    {
+        return 0;
+    }
+    memset(snapshot,0,sizeof(SLPPropertySnapshot));
+
+    property = base ? (SLPProperty*)base->list.tail : 0;
+    while(property)
+    {
+        if(SnapshotSetValue(snapshot,
+                            property->propertyName,
+                            PropertyValueOf(property)))
         {
-            /* out of memory */
-            errno = ENOMEM;
-            return -1;
+            SnapshotFree(snapshot);
+            return 0;
         }
+        property = (SLPProperty*)property->listitem.previous;
+    }
 
-        /* set the pointers in the SLPProperty structure to point to areas of    */
-        /* the previously allocated block of memory                              */
-        newProperty->propertyName   = ((char*)newProperty) + sizeof(SLPProperty); 
-        newProperty->propertyValue  = newProperty->propertyName + pcNameSize;
+    property = (SLPProperty*)changes->list.tail;
+    while(property)
+    {
+        if(SnapshotSetValue(snapshot,
+                            property->propertyName,
+                            PropertyValueOf(property)))
+        {
+            SnapshotFree(snapshot);
+            return 0;
+        }
+        property = (SLPProperty*)property->listitem.previous;
+    }
 
-        /* copy the passed in name and value */
-        memcpy(newProperty->propertyName,pcName,pcNameSize);
-        memcpy(newProperty->propertyValue,pcValue,pcValueSize);
+    return snapshot;
+}
 
-        /* Link the new property into the list */
-        SLPListLinkHead(&G_SLPPropertyList,(SLPListItem*)newProperty);
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotChanges(SLPPropertySnapshot* current,
+                           SLPPropertySnapshot* changes)
+/* Tells whether applying changes to the current set would change it       */
+/*-------------------------------------------------------------------------*/
+{
+    SLPProperty*    property;
+    SLPProperty*    existing;
+
+    property = (SLPProperty*)changes->list.head;
+    while(property)
+    {
+        existing = Find(current,property->propertyName);
+        if(existing == 0 ||
+           strcmp(existing->propertyValue,property->propertyValue))
+        {
+            return 1;
+        }
+        property = (SLPProperty*)property->listitem.next;
     }
-    else
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void SnapshotFreeList(SLPPropertySnapshot* snapshot)
+/*-------------------------------------------------------------------------*/
+{
+    SLPPropertySnapshot*    next;
+
+    while(snapshot)
     {
-        SLPListUnlink(&G_SLPPropertyList,(SLPListItem*)newProperty);
+        next = snapshot->next;
+        SnapshotFree(snapshot);
+        snapshot = next;
+    }
+}
 
-        /* property already exists in the list */
-        newProperty = (SLPProperty*)xrealloc(newProperty,sizeof(SLPProperty) + pcNameSize + pcValueSize);    
-        if(newProperty == 0)
+
+/*-------------------------------------------------------------------------*/
+static void SnapshotReclaim()
+/* Frees the replaced sets no reader can be looking at any more.  It never */
+/* waits for readers, who may hold the properties for a whole call:        */
+/* retired sets are moved to G_SLPPropertyDraining as the epoch flips and  */
+/* freed by whoever finds the old epoch empty, a writer or its last reader.*/
+/* One thread at a time does it, the others leave it to that one           */
+/*-------------------------------------------------------------------------*/
+{
+    SLPPropertySnapshot*    draining;
+
+    while(PropertyAtomicSwap(&G_SLPPropertyReclaiming,0,1))
+    {
+        while(1)
         {
-            /* out of memory */
+            draining = PropertyAtomicLoad(&G_SLPPropertyDraining);
+            if(draining)
+            {
+                if(PropertyDrained() == 0)
+                {
+                    /* its last reader comes back when it leaves */
+                    break;
+                }
+                PropertyAtomicStore(&G_SLPPropertyDraining,0);
+                SnapshotFreeList(draining);
+            }
+
+            /* readers that may have seen a retired set are gone once */
+            /* the epoch it was retired in has none left              */
+            draining = PropertyAtomicTake(&G_SLPPropertyRetired);
+            if(draining == 0)
+            {
+                break;
+            }
+            PropertyAtomicStore(&G_SLPPropertyDrainEpoch,
+                                G_SLPPropertyEpoch & 1);
+            PropertyAtomicStore(&G_SLPPropertyDraining,draining);
+            PropertyAtomicAdd(&G_SLPPropertyEpoch,1);
+        }
+
+        PropertyAtomicStore(&G_SLPPropertyReclaiming,0);
+
+        /* a reader that left while we held the flag found it taken */
+        draining = PropertyAtomicLoad(&G_SLPPropertyDraining);
+        if(draining == 0 || PropertyDrained() == 0)
+        {
+            break;
+        }
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void SnapshotRetire(SLPPropertySnapshot* snapshot)
+/* Hands a set that is no longer published to SnapshotReclaim()            */
+/*-------------------------------------------------------------------------*/
+{
+    do
+    {
+        snapshot->next = PropertyAtomicLoad(&G_SLPPropertyRetired);
+    }
+    while(PropertyAtomicSwap(&G_SLPPropertyRetired,
+                             snapshot->next,
+                             snapshot) == 0);
+
+    SnapshotReclaim();
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotPublish(SLPPropertySnapshot* changes)
+/* Publishes the current set with changes applied, unless they change      */
+/* nothing.  A set published by another thread in the meantime is merged   */
+/* with again, so no change is lost                                        */
+/*-------------------------------------------------------------------------*/
+{
+    SLPPropertySnapshot*    current;
+    SLPPropertySnapshot*    snapshot;
+    int                     epoch;
+    int                     published;
+
+    while(1)
+    {
+        /* the current set is only copied while it cannot be reclaimed */
+        epoch = PropertyReaderEnter();
+        current = SLPPropertyCurrent();
+        if(current && SnapshotChanges(current,changes) == 0)
+        {
+            /* keeps repeated reads of the same file from using memory */
+            PropertyReaderLeave(epoch);
+            return 0;
+        }
+
+        snapshot = SnapshotMerge(current,changes);
+        if(snapshot == 0)
+        {
+            PropertyReaderLeave(epoch);
             errno = ENOMEM;
             return -1;
         }
+        published = SLPPropertyPublish(current,snapshot);
+        if(published == 0)
+        {
+            SnapshotFree(snapshot);
+        }
+        PropertyReaderLeave(epoch);
 
-        /* set the pointers in the SLPProperty structure to point to areas of    */
-        /* the previously allocated block of memory                              */
-        newProperty->propertyName   = ((char*)newProperty) + sizeof(SLPProperty); 
-        newProperty->propertyValue  = newProperty->propertyName + pcNameSize;
+        if(published)
+        {
+            if(current)
+            {
+                SnapshotRetire(current);
+            }
+            return 0;
+        }
+    }
+}
 
-        /* copy the passed in name and value */
-        memcpy(newProperty->propertyName,pcName,pcNameSize);
-        memcpy(newProperty->propertyValue,pcValue,pcValueSize);
 
-        SLPListLinkHead(&G_SLPPropertyList,(SLPListItem*)newProperty);
+/*=========================================================================*/
+const char* SLPPropertyGet(const char* pcName)
+/*=========================================================================*/
+{
+    SLPProperty*    existingProperty;
+    const char*     result  = 0;
+    int             epoch;
+
+    epoch = PropertyReaderEnter();
+    existingProperty = Find(SLPPropertyCurrent(),pcName);
+    if(existingProperty)
+    {
+        result = existingProperty->propertyValue;
     }
+    PropertyReaderLeave(epoch);
 
-    return 0;
+    return result;
+}
+
+
+/*=========================================================================*/
+int SLPPropertyHold()
+/*=========================================================================*/
+{
+    return PropertyReaderEnter();
+}
+
+
+/*=========================================================================*/
+void SLPPropertyRelease(int hold)
+/*=========================================================================*/
+{
+    PropertyReaderLeave(hold);
+}
+
+
+/*=========================================================================*/
+int SLPPropertySet(const char *pcName,
+                   const char *pcValue)
+/*=========================================================================*/
+{
+    SLPPropertySnapshot     changes;
+    int                     result;
+
+    memset(&changes,0,sizeof(changes));
+    result = SnapshotSet(&changes,pcName,pcValue);
+    if(result == 0 && changes.list.head)
+    {
+        result = SnapshotPublish(&changes);
+    }
+    SnapshotClear(&changes);
+
+    return result;
+}
+
+
+/*=========================================================================*/
+int SLPPropertyIsLoaded()
+/*=========================================================================*/
+{
+    return SLPPropertyCurrent() != 0;
 }
 
 
 /*-------------------------------------------------------------------------*/
-int SetDefaultValues()
+int SetDefaultValues(SLPPropertySnapshot* snapshot)
 /*-------------------------------------------------------------------------*/
 {
     int result = 0;                                
 
-    result |= SLPPropertySet("net.slp.isBroadcastOnly","false");
-    result |= SLPPropertySet("net.slp.multicastTimeouts","500,750,1000,1500,2000,3000");
-    result |= SLPPropertySet("net.slp.multicastMaximumWait","5000");
-    result |= SLPPropertySet("net.slp.unicastTimeouts","500,750,1000,1500,2000,3000");
-    result |= SLPPropertySet("net.slp.unicastMaximumWait","5000");
-    result |= SLPPropertySet("net.slp.datagramTimeouts","");
-    result |= SLPPropertySet("net.slp.maxResults","256");
-    result |= SLPPropertySet("net.slp.DADiscoveryTimeouts","500,750,1000,1500,2000,3000");
-    result |= SLPPropertySet("net.slp.DADiscoveryMaximumWait","2000");
-    result |= SLPPropertySet("net.slp.DAActiveDiscoveryInterval","1");
-    result |= SLPPropertySet("net.slp.DAAddresses","");
-    result |= SLPPropertySet("net.slp.watchRegistrationPID","true");
-    result |= SLPPropertySet("net.slp.activeDADetection","true");
-    result |= SLPPropertySet("net.slp.passiveDADetection","true");
-    result |= SLPPropertySet("net.slp.useScopes","default");
-    result |= SLPPropertySet("net.slp.locale","en");
-    result |= SLPPropertySet("net.slp.randomWaitBound","5000");
-    result |= SLPPropertySet("net.slp.interfaces","");
-    result |= SLPPropertySet("net.slp.securityEnabled","false");
-    result |= SLPPropertySet("net.slp.multicastTTL","8");
-    result |= SLPPropertySet("net.slp.MTU","1400");
-    result |= SLPPropertySet("net.slp.traceMsg","false");
-    result |= SLPPropertySet("net.slp.traceReg","false");
-    result |= SLPPropertySet("net.slp.traceDrop","false");
-    result |= SLPPropertySet("net.slp.traceDATraffic","false");
-    result |= SLPPropertySet("net.slp.isDA","false");
-    result |= SLPPropertySet("net.slp.DAHeartBeat","10800");
-
-    result |= SLPPropertySet("net.slp.securityEnabled","false");
-    result |= SLPPropertySet("net.slp.checkSourceAddr","true");
-    result |= SLPPropertySet("net.slp.OpenSLPVersion", SLP_VERSION);
+    result |= SnapshotSet(snapshot,"net.slp.isBroadcastOnly","false");
+    result |= SnapshotSet(snapshot,"net.slp.multicastTimeouts","500,750,1000,1500,2000,3000");
+    result |= SnapshotSet(snapshot,"net.slp.multicastMaximumWait","5000");
+    result |= SnapshotSet(snapshot,"net.slp.multicastQuietWait","0");
+    result |= SnapshotSet(snapshot,"net.slp.unicastTimeouts","500,750,1000,1500,2000,3000");
+    result |= SnapshotSet(snapshot,"net.slp.unicastMaximumWait","5000");
+    result |= SnapshotSet(snapshot,"net.slp.datagramTimeouts","");
+    result |= SnapshotSet(snapshot,"net.slp.maxResults","256");
+    result |= SnapshotSet(snapshot,"net.slp.clientCache","false");
+    result |= SnapshotSet(snapshot,"net.slp.clientCacheMaxEntries","256");
+    result |= SnapshotSet(snapshot,"net.slp.clientCacheMaxLifetime","300");
+    result |= SnapshotSet(snapshot,"net.slp.clientCacheStaleTime","30");
+    result |= SnapshotSet(snapshot,"net.slp.DADiscoveryTimeouts","500,750,1000,1500,2000,3000");
+    result |= SnapshotSet(snapshot,"net.slp.DADiscoveryMaximumWait","2000");
+    result |= SnapshotSet(snapshot,"net.slp.DAActiveDiscoveryInterval","1");
+    result |= SnapshotSet(snapshot,"net.slp.DAAddresses","");
+    result |= SnapshotSet(snapshot,"net.slp.DAConnectionPoolSize","8");
+    result |= SnapshotSet(snapshot,"net.slp.DAConnectionIdleTimeout","20");
+    result |= SnapshotSet(snapshot,"net.slp.DAHedgeBudget","0");
+    result |= SnapshotSet(snapshot,"net.slp.DAHedgeDelay","0");
+    result |= SnapshotSet(snapshot,"net.slp.watchRegistrationPID","true");
+    result |= SnapshotSet(snapshot,"net.slp.refreshRegistrations","false");
+    result |= SnapshotSet(snapshot,"net.slp.activeDADetection","true");
+    result |= SnapshotSet(snapshot,"net.slp.passiveDADetection","true");
+    result |= SnapshotSet(snapshot,"net.slp.useScopes","default");
+    result |= SnapshotSet(snapshot,"net.slp.locale","en");
+    result |= SnapshotSet(snapshot,"net.slp.randomWaitBound","5000");
+    result |= SnapshotSet(snapshot,"net.slp.interfaces","");
+    result |= SnapshotSet(snapshot,"net.slp.securityEnabled","false");
+    result |= SnapshotSet(snapshot,"net.slp.multicastTTL","8");
+    result |= SnapshotSet(snapshot,"net.slp.MTU","1400");
+    result |= SnapshotSet(snapshot,"net.slp.traceMsg","false");
+    result |= SnapshotSet(snapshot,"net.slp.traceReg","false");
+    result |= SnapshotSet(snapshot,"net.slp.traceDrop","false");
+    result |= SnapshotSet(snapshot,"net.slp.traceDATraffic","false");
+    result |= SnapshotSet(snapshot,"net.slp.isDA","false");
+    result |= SnapshotSet(snapshot,"net.slp.DAHeartBeat","10800");
+    result |= SnapshotSet(snapshot,"net.slp.DARegistrationWindow","8");
+    result |= SnapshotSet(snapshot,"net.slp.DARestartOnStampChange","false");
+
+    result |= SnapshotSet(snapshot,"net.slp.securityEnabled","false");
+    result |= SnapshotSet(snapshot,"net.slp.checkSourceAddr","true");
+    result |= SnapshotSet(snapshot,"net.slp.OpenSLPVersion", SLP_VERSION);
 
     return result;
 }
@@ -238,10 +659,17 @@ int SLPPropertyReadFile(const char* conffile)
     char*   nameend;
     char*   valuestart;
     char*   valueend; 
+    int     result;
+    SLPPropertySnapshot changes;
 
-    if(SetDefaultValues())
+    /* collect the defaults and the file first, then publish them at once */
+    memset(&changes,0,sizeof(changes));
+    if(SetDefaultValues(&changes))
     {
-        return -1;
+        result = -1;
+        fp = 0;
+        alloced = 0;
+        goto CLEANUP;
     }
 
     alloced = xmalloc(4096);
@@ -249,7 +677,9 @@ int SLPPropertyReadFile(const char* conffile)
     {
         /* out of memory */
         errno = ENOMEM;
-        return -1;
+        result = -1;
+        fp = 0;
+        goto CLEANUP;
     }
 
     fp = fopen(conffile,"r");
@@ -259,7 +689,7 @@ int SLPPropertyReadFile(const char* conffile)
     }
 
     /* Set the property that keeps track of conffile */
-    SLPPropertySet("net.slp.OpenSLPConfigFile",conffile);
+    SnapshotSet(&changes,"net.slp.OpenSLPConfigFile",conffile);
 
     while(fgets(alloced,4096,fp))
     {
@@ -323,12 +753,18 @@ int SLPPropertyReadFile(const char* conffile)
         /* set the property */
         if(valuestart && *valuestart)
         {
-            SLPPropertySet(namestart, valuestart);
+            SnapshotSet(&changes,namestart, valuestart);
         }
     }   
 
 
     CLEANUP:
+    if(alloced)
+    {
+        result = SnapshotPublish(&changes);
+    }
+    SnapshotClear(&changes);
+
     if(fp)
     {
         fclose(fp);
@@ -339,7 +775,7 @@ int SLPPropertyReadFile(const char* conffile)
         xfree(alloced);
     }
 
-    return 0;
+    return result;
 }
 
 /*=========================================================================*/
@@ -415,19 +851,15 @@ int SLPPropertyAsIntegerVector(const char* property,
 void SLPPropertyFreeAll()
 /*=========================================================================*/
 {
-    SLPProperty* property;
-    SLPProperty* del;
-
+    SLPPropertySnapshot*    snapshot;
 
-    property = (SLPProperty*)G_SLPPropertyList.head;
-    while(property)
+    /* nothing reads properties any more, so nothing is left draining */
+    snapshot = G_SLPProperties;
+    G_SLPProperties = 0;
+    if(snapshot)
     {
-        del = property;
-        property = (SLPProperty*)property->listitem.next;
-        xfree(del);
+        SnapshotRetire(snapshot);
     }
-
-    memset(&G_SLPPropertyList,0,sizeof(G_SLPPropertyList));
 }
 
 #endif
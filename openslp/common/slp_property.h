@@ -51,8 +51,6 @@
 
 #include "slp_linkedlist.h"
 
-extern SLPList G_SLPPropertyList;
-
 /*=========================================================================*/
 typedef struct _SLPProperty
 /*=========================================================================*/
@@ -75,7 +73,28 @@ const char* SLPPropertyGet(const char* pcName);
 /* Returns: If no error, returns a pointer to a character buffer containing*/
 /*          the property value.  If the property was not set, returns the  */
 /*          default value.  If an error occurs, returns NULL. The returned */
-/*          string MUST NOT be freed.                                      */
+/*          string MUST NOT be freed.  It stays valid until the property   */
+/*          is set again, or, if it was read under SLPPropertyHold(),      */
+/*          until the matching SLPPropertyRelease()                        */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int SLPPropertyHold();
+/*                                                                         */
+/* Keeps every value SLPPropertyGet() returns from now on valid, even if   */
+/* another thread sets the property, until SLPPropertyRelease().  Holds    */
+/* never keep SLPPropertySet() waiting, the values it replaces are freed   */
+/* once the last hold that could have seen them is released.               */
+/*                                                                         */
+/* Returns: the hold to pass to SLPPropertyRelease()                       */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void SLPPropertyRelease(int hold);
+/*                                                                         */
+/* Ends a hold taken with SLPPropertyHold(), on any thread                 */
 /*=========================================================================*/
 
 
@@ -122,6 +141,13 @@ int SLPPropertyAsIntegerVector(const char* property,
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+int SLPPropertyIsLoaded();
+/*                                                                         */
+/* Returns: non-zero once properties were read or set                      */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 void SLPPropertyFreeAll();
 /*=========================================================================*/
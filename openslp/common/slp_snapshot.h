@@ -0,0 +1,127 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol                                                   */
+/*                                                                         */
+/* File:        slp_snapshot.h                                             */
+/*                                                                         */
+/* Abstract:    Layout of the read only snapshot of its registrations that */
+/*              slpd publishes for libslp in a memory mapped file          */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+/***************************************************************************/
+
+
+#ifndef SLP_SNAPSHOT_H_INCLUDED
+#define SLP_SNAPSHOT_H_INCLUDED
+
+/*=========================================================================*/
+/* The snapshot is a file that slpd maps read/write and libslp maps read   */
+/* only.  It starts with an SLPSnapshotHeader followed by slpd's scope     */
+/* list and then by one SLPSnapshotEntry per registration.                 */
+/*                                                                         */
+/* slpd makes the generation odd before it changes anything behind the     */
+/* header and even again when it is done.  A reader notes the generation,  */
+/* copies what it needs and then checks that the generation is still the   */
+/* same even number.  If it is not the copy may be torn and the reader     */
+/* must try again or ask slpd instead.                                     */
+/*=========================================================================*/
+#include "slp_message.h"
+
+#define SLP_SNAPSHOT_FILE       "/var/run/slpd.reg"
+#define SLP_SNAPSHOT_MAGIC      0x534c5031  /* "SLP1" */
+#define SLP_SNAPSHOT_DEAD       0xffffffff  /* generation of an abandoned  */
+                                            /* snapshot                    */
+#define SLP_SNAPSHOT_STALE      60          /* seconds without a heartbeat */
+                                            /* after which slpd is taken   */
+                                            /* for dead                    */
+
+#if defined(__GNUC__)
+#define SLP_SNAPSHOT_BARRIER()  __sync_synchronize()
+#elif defined(_WIN32)
+#define SLP_SNAPSHOT_BARRIER()  MemoryBarrier()
+#else
+#define SLP_SNAPSHOT_BARRIER()
+#endif
+
+
+/*=========================================================================*/
+typedef struct _SLPSnapshotHeader
+/*=========================================================================*/
+{
+    uint32_t            magic;
+    volatile uint32_t   generation;
+    volatile uint32_t   heartbeat;      /* time() slpd last looked at it  */
+    uint32_t            size;           /* size of the file               */
+    uint32_t            used;           /* bytes used, header included    */
+    uint32_t            count;          /* number of entries              */
+    uint32_t            isDA;           /* slpd is a DA for its scopes    */
+    uint32_t            scopelistlen;   /* slpd's scopes follow           */
+}SLPSnapshotHeader;
+
+
+/*=========================================================================*/
+typedef struct _SLPSnapshotEntry
+/*=========================================================================*/
+{
+    uint64_t            srvtypehash;    /* hashes of the folded strings   */
+    uint64_t            abstracttypehash; /* (see SLPFoldedKeysCreate())  */
+    uint64_t            urlhash;        /* so most entries are skipped    */
+                                        /* without looking at them        */
+    uint32_t            expires;        /* time() the registration times  */
+                                        /* out, 0 if it never does        */
+    uint32_t            urllen;
+    uint32_t            srvtypelen;
+    uint32_t            scopelistlen;
+    uint32_t            attrlistlen;
+    /* followed by url, srvtype, scopelist and attrlist, then padding to  */
+    /* a multiple of 8 bytes                                               */
+}SLPSnapshotEntry;
+
+
+/* Rounds a size up to keep entries aligned */
+#define SLP_SNAPSHOT_ALIGN(size)    (((size) + 7) & ~7)
+
+/* Size of an entry with the given string lengths */
+#define SLP_SNAPSHOT_ENTRY_SIZE(urllen,srvtypelen,scopelistlen,attrlistlen) \
+    SLP_SNAPSHOT_ALIGN(sizeof(SLPSnapshotEntry) + (urllen) +               \
+                       (srvtypelen) + (scopelistlen) + (attrlistlen))
+
+
+#endif
@@ -61,6 +61,24 @@
 #define PUBLIC_TOKEN        "PUBLIC"
 #define PRIVATE_TOKEN       "PRIVATE"
 
+/* hspi->verified is shared by the threads that verify with a libslp       */
+/* handle, so it is only looked at under hspi->verifiedlock                */
+#ifdef _WIN32
+#define SLPSpiLockInit(lock)        InitializeCriticalSection(lock)
+#define SLPSpiLockDestroy(lock)     DeleteCriticalSection(lock)
+#define SLPSpiVerifiedLock(hspi) \
+    EnterCriticalSection(&((hspi)->verifiedlock))
+#define SLPSpiVerifiedUnlock(hspi) \
+    LeaveCriticalSection(&((hspi)->verifiedlock))
+#else
+#define SLPSpiLockInit(lock)        pthread_mutex_init((lock),0)
+#define SLPSpiLockDestroy(lock)     pthread_mutex_destroy(lock)
+#define SLPSpiVerifiedLock(hspi) \
+    pthread_mutex_lock(&((hspi)->verifiedlock))
+#define SLPSpiVerifiedUnlock(hspi) \
+    pthread_mutex_unlock(&((hspi)->verifiedlock))
+#endif
+
 
 /*-------------------------------------------------------------------------*/
 void SLPSpiEntryFree(SLPSpiEntry* victim)
@@ -73,31 +91,56 @@ void SLPSpiEntryFree(SLPSpiEntry* victim)
 }
 
 /*-------------------------------------------------------------------------*/
-SLPSpiEntry* SLPSpiEntryFind(SLPList* cache,
+unsigned int SLPSpiHash(int spistrlen, const char* spistr)
+/* FNV-1a hash of an SPI string                                            */
+/*-------------------------------------------------------------------------*/
+{
+    unsigned int hash = 2166136261U;
+
+    while(spistrlen-- > 0)
+    {
+        hash = (hash ^ (unsigned char)*spistr++) * 16777619U;
+    }
+
+    return hash;
+}
+
+/*-------------------------------------------------------------------------*/
+SLPSpiEntry* SLPSpiEntryFind(SLPSpiHandle hspi,
                              int keytype,
                              int spistrlen,
                              const char* spistr)
 /* pass in null spistr to find the first Cached entry                      */
 /*-------------------------------------------------------------------------*/
 {
-    SLPSpiEntry* entry = (SLPSpiEntry*)cache->head;
-    while(entry)
+    SLPSpiEntry*    entry;
+    unsigned int    hash;
+
+    if(spistr)
     {
-        if(spistr)
+        hash = SLPSpiHash(spistrlen,spistr);
+        entry = hspi->buckets[hash & (SLPSPI_BUCKETS - 1)];
+        while(entry)
         {
-            if (entry->spistrlen == spistrlen &&
+            if (entry->hash == hash &&
+                entry->spistrlen == spistrlen &&
                 memcmp(entry->spistr,spistr,spistrlen) == 0 &&
                         entry->keytype == keytype)
             {
                 return entry;
             }
+            entry = entry->hashnext;
         }
-        else
+
+        return 0;
+    }
+
+    entry = (SLPSpiEntry*)hspi->cache.head;
+    while(entry)
+    {
+        if(keytype == SLPSPI_KEY_TYPE_ANY || entry->keytype == keytype)
         {
-            if(keytype == SLPSPI_KEY_TYPE_ANY || entry->keytype == keytype)
-            {
-                return entry;
-            }
+            return entry;
         }
         entry = (SLPSpiEntry*)entry->listitem.next;
     }
@@ -252,7 +295,9 @@ SUCCESS:
 
 /*=========================================================================*/
 SLPSpiHandle SLPSpiOpen(const char* spifile, int cacheprivate)
-/* Initializes SLP SPI data storage.                                       */
+/* Initializes SLP SPI data storage.  The key files of the public keys,    */
+/* and of the private keys if they are cached, are read here so that no    */
+/* file is read while messages are signed or verified                      */
 /*                                                                         */
 /* Parameters: spifile      (IN) path of slp.spi file                      */
 /*             cacheprivate (IN) should private keys be cached in handle   */
@@ -263,6 +308,7 @@ SLPSpiHandle SLPSpiOpen(const char* spifile, int cacheprivate)
     FILE*           fp;
     SLPSpiHandle    result = 0;
     SLPSpiEntry*    spientry;      
+    SLPSpiEntry**   bucket;
 
     fp = fopen(spifile,"r");
     if(fp)
@@ -273,16 +319,26 @@ SLPSpiHandle SLPSpiOpen(const char* spifile, int cacheprivate)
         
         result->spifile = xstrdup(spifile);
         result->cacheprivate = cacheprivate;
+        SLPSpiLockInit(&(result->verifiedlock));
         while(1)
         {
             spientry = SLPSpiReadSpiFile(fp, SLPSPI_KEY_TYPE_ANY);
             if(spientry == 0) break;
-            if(spientry->keytype == SLPSPI_KEY_TYPE_PRIVATE &&
-               cacheprivate == 0)
+            if(spientry->keytype == SLPSPI_KEY_TYPE_PUBLIC ||
+               cacheprivate)
             {
-                /* destroy the key cause we're not suppose to cache it */
-                SLPCryptoDSAKeyDestroy(spientry->key);
+                /* private keys we are not suppose to cache are read */
+                /* each time they are used                           */
+                spientry->key = SLPSpiReadKeyFile(spientry->keyfilename,
+                                                  spientry->keytype);
             }
+
+            spientry->hash = SLPSpiHash(spientry->spistrlen,
+                                        spientry->spistr);
+            bucket = &(result->buckets[spientry->hash &
+                                       (SLPSPI_BUCKETS - 1)]);
+            spientry->hashnext = *bucket;
+            *bucket = spientry;
             
             SLPListLinkHead(&(result->cache),(SLPListItem*)spientry);
         } 
@@ -303,6 +359,8 @@ void SLPSpiClose(SLPSpiHandle hspi)
     if(hspi)
     {
         if(hspi->spifile) xfree(hspi->spifile);
+        if(hspi->verified) xfree(hspi->verified);
+        SLPSpiLockDestroy(&(hspi->verifiedlock));
         while(hspi->cache.count)
         {
             SLPSpiEntryFree((SLPSpiEntry*)SLPListUnlink(&(hspi->cache),hspi->cache.head));
@@ -338,7 +396,7 @@ char* SLPSpiGetDefaultSPI(SLPSpiHandle hspi,
     if(hspi)
     {
             
-        entry = SLPSpiEntryFind(&(hspi->cache),keytype,0,0);
+        entry = SLPSpiEntryFind(hspi,keytype,0,0);
         if(entry)
         {
             *spistr = xmalloc(entry->spistrlen);
@@ -380,7 +438,8 @@ SLPCryptoDSAKey* SLPSpiGetDSAKey(SLPSpiHandle hspi,
 
     if(hspi)
     {
-        tmp = SLPSpiEntryFind(&(hspi->cache),
+        hspi->keylookups++;
+        tmp = SLPSpiEntryFind(hspi,
                               keytype,
                               spistrlen,
                               spistr);
@@ -391,12 +450,10 @@ SLPCryptoDSAKey* SLPSpiGetDSAKey(SLPSpiHandle hspi,
                 if(keytype == SLPSPI_KEY_TYPE_PRIVATE && hspi->cacheprivate == 0)
                 {
                     *key = SLPSpiReadKeyFile(tmp->keyfilename,SLPSPI_KEY_TYPE_PRIVATE);
-                    return *key;
                 }
                 
-                tmp->key = SLPSpiReadKeyFile(tmp->keyfilename,keytype);
-		if (tmp->key == 0)
-		    return 0;
+                /* other keys were read by SLPSpiOpen(), if they could be */
+                return *key;
             }
 
             *key = SLPCryptoDSAKeyDup(tmp->key);
@@ -431,7 +488,7 @@ int SLPSpiCanVerify(SLPSpiHandle hspi,
         return 1;
     }
 
-    return (SLPSpiEntryFind(&(hspi->cache), 
+    return (SLPSpiEntryFind(hspi, 
                             SLPSPI_KEY_TYPE_PUBLIC,
                             spistrlen, 
                             spistr) != 0);
@@ -452,10 +509,106 @@ int SLPSpiCanSign(SLPSpiHandle hspi,
 /* Returns     Non-zero if we sign using the specified SPI                 */
 /*=========================================================================*/
 {
-    return (SLPSpiEntryFind(&(hspi->cache), 
+    return (SLPSpiEntryFind(hspi, 
                             SLPSPI_KEY_TYPE_PRIVATE,
                             spistrlen, 
                             spistr) != 0);
 }
 
 
+/*-------------------------------------------------------------------------*/
+static SLPSpiVerified* SLPSpiVerifiedSlot(SLPSpiHandle hspi,
+                                          const unsigned char* digest)
+/* Caller holds hspi->verifiedlock                                         */
+/*-------------------------------------------------------------------------*/
+{
+    /* the digest is a SHA1 hash, any two bytes of it spread well */
+    return &(hspi->verified[(digest[0] | (digest[1] << 8)) &
+                            (SLPSPI_VERIFIED_SLOTS - 1)]);
+}
+
+
+/*=========================================================================*/
+int SLPSpiVerifiedFind(SLPSpiHandle hspi,
+                       const unsigned char* digest,
+                       const unsigned char* signature,
+                       int signaturelen)
+/* Determine if a signature was verified before with the keys of hspi.     */
+/* Refreshed registrations and adverts carry the same authblocks again,    */
+/* so their DSA verification is skipped                                    */
+/*                                                                         */
+/* Parameters: hspi         (IN) handle obtained from call to SLPSpiOpen() */
+/*             digest       (IN) SHA1 digest of the signed data            */
+/*             signature    (IN) the signature over digest                 */
+/*             signaturelen (IN) the length of the signature               */
+/*                                                                         */
+/* Returns     Non-zero if the same signature over the same digest passed  */
+/*             SLPSpiVerifiedAdd()                                         */
+/*=========================================================================*/
+{
+    SLPSpiVerified* slot;
+    int             result  = 0;
+
+    if(hspi == 0 || signaturelen <= 0)
+    {
+        return 0;
+    }
+
+    SLPSpiVerifiedLock(hspi);
+    if(hspi->verified)
+    {
+        slot = SLPSpiVerifiedSlot(hspi,digest);
+        result = (slot->signaturelen == signaturelen &&
+                  memcmp(slot->digest,digest,SLPSPI_DIGEST_SIZE) == 0 &&
+                  memcmp(slot->signature,signature,signaturelen) == 0);
+    }
+    SLPSpiVerifiedUnlock(hspi);
+
+    return result;
+}
+
+
+/*=========================================================================*/
+void SLPSpiVerifiedAdd(SLPSpiHandle hspi,
+                       const unsigned char* digest,
+                       const unsigned char* signature,
+                       int signaturelen)
+/* Remember a signature that was just verified with the keys of hspi.  The */
+/* memory is released by SLPSpiClose(), so a reloaded SPI file starts      */
+/* over                                                                    */
+/*                                                                         */
+/* Parameters: hspi         (IN) handle obtained from call to SLPSpiOpen() */
+/*             digest       (IN) SHA1 digest of the signed data            */
+/*             signature    (IN) the signature over digest                 */
+/*             signaturelen (IN) the length of the signature               */
+/*=========================================================================*/
+{
+    SLPSpiVerified* slot;
+
+    if(hspi == 0 || signaturelen <= 0 || signaturelen > SLPSPI_MAX_SIGNATURE)
+    {
+        return;
+    }
+
+    SLPSpiVerifiedLock(hspi);
+    if(hspi->verified == 0)
+    {
+        hspi->verified = (SLPSpiVerified*)xmalloc(SLPSPI_VERIFIED_SLOTS *
+                                                  sizeof(SLPSpiVerified));
+        if(hspi->verified)
+        {
+            memset(hspi->verified,0,SLPSPI_VERIFIED_SLOTS * sizeof(SLPSpiVerified));
+        }
+    }
+
+    if(hspi->verified)
+    {
+        slot = SLPSpiVerifiedSlot(hspi,digest);
+        memcpy(slot->digest,digest,SLPSPI_DIGEST_SIZE);
+        memcpy(slot->signature,signature,signaturelen);
+        slot->signaturelen = signaturelen;
+    }
+    SLPSpiVerifiedUnlock(hspi);
+}
+
+
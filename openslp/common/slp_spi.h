@@ -54,12 +54,22 @@
 #include "slp_linkedlist.h"
 #include "slp_crypto.h"
 
+#ifdef _WIN32
+#include <windows.h>
+typedef CRITICAL_SECTION    SLPSpiLock;
+#else
+#include <pthread.h>
+typedef pthread_mutex_t     SLPSpiLock;
+#endif
+
 
 /*-------------------------------------------------------------------------*/
 typedef struct _SLPSpiEntry
 /*-------------------------------------------------------------------------*/
 {
     SLPListItem         listitem;
+    struct _SLPSpiEntry* hashnext;  /* in the same bucket of the handle */
+    unsigned int        hash;       /* of spistr                        */
     int                 spistrlen;
     char*               spistr;
     char*               keyfilename;
@@ -76,19 +86,41 @@ typedef struct _SLPSpiEntry
 #define SLPSPI_KEY_TYPE_PRIVATE 2
 
 
+#define SLPSPI_BUCKETS          64  /* SPI entry hash buckets, a power of 2 */
+#define SLPSPI_VERIFIED_SLOTS   256 /* signatures remembered, a power of 2 */
+#define SLPSPI_MAX_SIGNATURE    80  /* longer ones are always verified     */
+#define SLPSPI_DIGEST_SIZE      20  /* same as SLPAUTH_SHA1_DIGEST_SIZE    */
+
+/*-------------------------------------------------------------------------*/
+typedef struct _SLPSpiVerified
+/* A signature that was verified with the keys of a handle                 */
+/*-------------------------------------------------------------------------*/
+{
+    unsigned char       digest[SLPSPI_DIGEST_SIZE];
+    int                 signaturelen;   /* 0 for an empty slot */
+    unsigned char       signature[SLPSPI_MAX_SIGNATURE];
+}SLPSpiVerified;
+
+
 /*=========================================================================*/
 typedef struct _SLPSpiHandle
 /*=========================================================================*/
 {
-    char*       spifile;
-    int         cacheprivate;
-    SLPList     cache;
+    char*           spifile;
+    int             cacheprivate;
+    SLPList         cache;
+    SLPSpiEntry*    buckets[SLPSPI_BUCKETS];    /* cache by spistr      */
+    SLPSpiVerified* verified;   /* SLPSPI_VERIFIED_SLOTS of them or NULL */
+    SLPSpiLock      verifiedlock; /* guards verified                       */
+    unsigned long   keylookups; /* calls to SLPSpiGetDSAKey()            */
 }* SLPSpiHandle;
 
 
 /*=========================================================================*/
 SLPSpiHandle SLPSpiOpen(const char* spifile, int cacheprivate);
-/* Initializes SLP SPI data storage.                                       */
+/* Initializes SLP SPI data storage.  The key files of the public keys,    */
+/* and of the private keys if they are cached, are read here so that no    */
+/* file is read while messages are signed or verified                      */
 /*                                                                         */
 /* Parameters: spifile      (IN) path of slp.spi file                      */
 /*             cacheprivate (IN) should private keys be cached in handle   */
@@ -172,6 +204,41 @@ int SLPSpiCanSign(SLPSpiHandle hspi,
 /* Returns     Non-zero if we sign using the specified SPI                 */
 /*=========================================================================*/
 
+
+/*=========================================================================*/
+int SLPSpiVerifiedFind(SLPSpiHandle hspi,
+                       const unsigned char* digest,
+                       const unsigned char* signature,
+                       int signaturelen);
+/* Determine if a signature was verified before with the keys of hspi.     */
+/* Refreshed registrations and adverts carry the same authblocks again,    */
+/* so their DSA verification is skipped                                    */
+/*                                                                         */
+/* Parameters: hspi         (IN) handle obtained from call to SLPSpiOpen() */
+/*             digest       (IN) SHA1 digest of the signed data            */
+/*             signature    (IN) the signature over digest                 */
+/*             signaturelen (IN) the length of the signature               */
+/*                                                                         */
+/* Returns     Non-zero if the same signature over the same digest passed  */
+/*             SLPSpiVerifiedAdd()                                         */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void SLPSpiVerifiedAdd(SLPSpiHandle hspi,
+                       const unsigned char* digest,
+                       const unsigned char* signature,
+                       int signaturelen);
+/* Remember a signature that was just verified with the keys of hspi.  The */
+/* memory is released by SLPSpiClose(), so a reloaded SPI file starts      */
+/* over                                                                    */
+/*                                                                         */
+/* Parameters: hspi         (IN) handle obtained from call to SLPSpiOpen() */
+/*             digest       (IN) SHA1 digest of the signed data            */
+/*             signature    (IN) the signature over digest                 */
+/*             signaturelen (IN) the length of the signature               */
+/*=========================================================================*/
+
 #endif
 
 
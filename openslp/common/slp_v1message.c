@@ -262,6 +262,9 @@ int v1ParseSrvReg(SLPBuffer buffer, SLPHeader* header, SLPSrvReg* srvreg)
     char           *tmp;
     int             result;
 
+    /* folded keys are computed later by whoever needs them */
+    srvreg->keys = 0;
+
     /* Parse out the url entry */
     result = v1ParseUrlEntry(buffer, header, &(srvreg->urlentry));
     if(result)
@@ -91,8 +91,13 @@ unsigned short SLPXidGenerate()
 /* Returns: A 16-bit value                                                 */
 /*=========================================================================*/
 {
+#if defined(__GNUC__)
+    /* handles on different threads must not share an XID */
+    return (unsigned short)__sync_add_and_fetch(&G_Xid,1);
+#else
     G_Xid++;
     return G_Xid;
+#endif
 }
 
 
@@ -63,6 +63,8 @@
 #include <unistd.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <netinet/in.h>
 #include <arpa/inet.h> 
@@ -91,9 +93,24 @@
 #include "slp_auth.h"
 #include "slp_spi.h"
 #endif
+#ifndef _WIN32
+/* libslp may be called from many threads at once, shared state is locked */
+#define LIBSLP_THREADS  1
+#include <pthread.h>
+#include <sched.h>
+#define SLPAtomicAdd(p,n)   __sync_add_and_fetch((p),(n))
+#define SLPAtomicLoad(p)    __atomic_load_n((p),__ATOMIC_ACQUIRE)
+#define SLPAtomicStore(p,v) __atomic_store_n((p),(v),__ATOMIC_RELEASE)
+#else
+#define SLPAtomicAdd(p,n)   (*(p) += (n))
+#define SLPAtomicLoad(p)    (*(p))
+#define SLPAtomicStore(p,v) (*(p) = (v))
+#endif
 
 #define MINIMUM_DISCOVERY_INTERVAL  300    /* 5 minutes */
 #define MAX_RETRANSMITS             5      /* we'll only re-xmit 5 times! */
+#define MAX_PARALLEL_DAS            8      /* DAs asked at once per request */
+#define MAX_PIPELINED_RQSTS         16     /* SLPD_MAX_PIPELINE in slpd.h */
 #define SLP_FUNCT_DASRVRQST         0x7f   /* fake id used internally */
 
 #if(!defined LIBSLP_CONFFILE)
@@ -123,14 +140,35 @@ typedef enum _SLPCallType
 }SLPCallType;
 
 /*=========================================================================*/
-typedef struct _SLPSrvUrlColatedItem
-/* Used to colate Service URLS                                             */
+typedef struct _SLPCollatedItem
+/* A service URL or service type already reported to the caller            */
 /*=========================================================================*/
 {
-    SLPListItem     listitem;
-    char*           srvurl;
-    unsigned short  lifetime;
-}SLPSrvUrlColatedItem;
+    struct _SLPCollatedItem*    chain;      /* next in the hash bucket    */
+    struct _SLPCollatedItem*    next;       /* next in the order added    */
+    unsigned int                hash;
+    int                         len;
+    char*                       str;
+    unsigned short              lifetime;
+}SLPCollatedItem;
+
+/*=========================================================================*/
+typedef struct _SLPCollation
+/* The results of one request, hashed so that duplicates are found without */
+/* walking them.  The items are carved from an arena of chunks freed all   */
+/* at once by SLPCollationFree().  All zero is an empty collation          */
+/*=========================================================================*/
+{
+    SLPCollatedItem**   buckets;
+    int                 bucketcount;
+    int                 count;
+    int                 totallen;   /* of every str, for joining them     */
+    SLPCollatedItem*    first;
+    SLPCollatedItem*    last;
+    char*               chunks;     /* arena chunks, linked by first word */
+    char*               arena;
+    int                 arenaleft;
+}SLPCollation;
 
 /*=========================================================================*/
 typedef struct _SLPRegParams
@@ -149,6 +187,8 @@ typedef struct _SLPRegParams
     int             attrlistlen;
     const char*     attrlist;
     SLPRegReport*   callback;
+    SLPRegBatchReport* batchcallback;   /* SLPRegBatch() only */
+    const SLPRegItem*  items;           /* SLPRegBatch() only */
     void*           cookie;
 }SLPRegParams,*PSLPRegParams;
 
@@ -164,6 +204,7 @@ typedef struct _SLPDeRegParams
     int             urllen;
     const char*     url;
     SLPRegReport*   callback;
+    SLPRegBatchReport* batchcallback;   /* SLPDeregBatch() only */
     void*           cookie;
 }SLPDeRegParams,*PSLPDeRegParams;
 
@@ -242,6 +283,9 @@ typedef struct _SLPHandleInfo
     unsigned int        sig;
     SLPBoolean          inUse;
     SLPBoolean          isAsync;
+#ifdef ENABLE_ASYNC_API
+    int                 asyncclose;     /* SLPClose() called while inUse */
+#endif
     int                 dasock;
     struct sockaddr_in  daaddr;
     char*               dascope;
@@ -263,8 +307,13 @@ typedef struct _SLPHandleInfo
     int                 langtaglen;
     char*               langtag;
     int                 callbackcount;
-    SLPList             collatedsrvurls;
-    char*               collatedsrvtypes;
+    SLPCollation        collation;
+    char*               cachekey;       /* of results to cache, see      */
+    int                 cachekeylen;    /* libslp_cache.c                */
+    char*               cachebuf;
+    int                 cachebuflen;
+    int                 cachebufsize;
+    int                 cacherefresh;   /* started by the cache itself   */
 #ifdef ENABLE_SLPv2_SECURITY
     SLPSpiHandle        hspi;
 #endif
@@ -279,7 +328,7 @@ typedef void* (*ThreadStartProc)(void *);
 
 /*=========================================================================*/
 SLPError ThreadCreate(ThreadStartProc startproc, void *arg);
-/* Creates a thread                                                        */
+/* Creates a detached thread                                               */
 /*                                                                         */
 /* startproc    (IN) Address of the thread start procedure.                */
 /*                                                                         */
@@ -297,7 +346,8 @@ int NetworkConnectToMulticast(struct sockaddr_in* peeraddr);
 
 /*=========================================================================*/
 int NetworkConnectToSlpd(struct sockaddr_in* peeraddr); 
-/* Connects to slpd and provides a peeraddr to send to                     */
+/* Connects to slpd, through its unix domain socket when it can and the    */
+/* loopback otherwise, and provides a peeraddr to send to                  */
 /*                                                                         */
 /* peeraddr         (OUT) pointer to receive the connected DA's address    */
 /*                                                                         */
@@ -406,6 +456,59 @@ SLPError NetworkRqstRply(int sock,
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+typedef struct _NetworkPipelineMsg
+/* One message body of a NetworkPipelineRqstRply() batch                   */
+/*=========================================================================*/
+{
+    char*   buf;        /* message body, NULL to skip the message          */
+    int     bufsize;
+    int     extoffset;  /* as for NetworkRqstRply()                        */
+}NetworkPipelineMsg;
+
+
+/*=========================================================================*/
+typedef void NetworkPipelineCallback(SLPError errorcode,
+                                     int index,
+                                     struct sockaddr_in* peerinfo,
+                                     SLPBuffer replybuf,
+                                     void* cookie);
+/* Function called by NetworkPipelineRqstRply once for every message that  */
+/* was not skipped                                                         */
+/*                                                                         */
+/* errorcode       (IN) error that kept the message from being answered.   */
+/*                      replybuf is not valid if it is set                 */
+/*                                                                         */
+/* index           (IN) index of the message in the batch                  */
+/*                                                                         */
+/* peerinfo        (IN) the peer that sent replybuf                        */
+/*                                                                         */
+/* replybuf        (IN) Buffer containing the reply                        */
+/*                                                                         */
+/* cookie          (IN) Pointer to opaque data from the caller of          */
+/*                      NetworkPipelineRqstRply()                          */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+SLPError NetworkPipelineRqstRply(int sock,
+                                 struct sockaddr_in* destaddr,
+                                 const char* langtag,
+                                 char buftype,
+                                 NetworkPipelineMsg* msgs,
+                                 int count,
+                                 NetworkPipelineCallback callback,
+                                 void* cookie);
+/* Sends a batch of messages of one type down a connected stream socket,   */
+/* keeping up to MAX_PIPELINED_RQSTS of them unanswered at a time, and     */
+/* matches the replies to them by XID                                      */
+/*                                                                         */
+/* Returns  -    SLP_OK on success, or the error that ended the batch.     */
+/*               Messages it left unanswered are reported with it through  */
+/*               the callback                                              */
+/*=========================================================================*/
+
+
 /*=========================================================================*/ 
 #ifndef MI_NOT_SUPPORTED
 SLPError NetworkMcastRqstRply(PSLPHandleInfo handle,
@@ -466,8 +569,270 @@ SLPError NetworkUcastRqstRply(PSLPHandleInfo handle,
 /* Returns  -    SLP_OK on success. SLP_ERROR on failure                   */
 /*=========================================================================*/
 #endif
+
+/*=========================================================================*/
+SLPError NetworkMultiRqstRply(PSLPHandleInfo handle,
+                              const char* scopelist,
+                              int scopelistlen,
+                              char* buf,
+                              char buftype,
+                              int bufsize,
+                              NetworkRplyCallback callback,
+                              void* cookie);
+/* Asks every DA needed for the scopes of a request, and multicasts for    */
+/* the scopes no DA supports, at the same time.  The replies reach the     */
+/* callback as one stream ended by a single SLP_LAST_CALL                  */
+/*                                                                         */
+/* scopelist    (IN) the scopes of the request                             */
+/*                                                                         */
+/* scopelistlen (IN) length of scopelist                                   */
+/*                                                                         */
+/* Returns  -    SLP_OK on success. SLP_ERROR on failure                   */
+/*=========================================================================*/
+
+/*=========================================================================*/
+typedef struct _NetworkConnect
+/* A non-blocking connect to a DA, or an SA asked over TCP.  When the      */
+/* peer's round trip time estimate passes without an answer the connect is */
+/* retried on another socket, keeping the earlier attempts in the race     */
+/*=========================================================================*/
+{
+    struct sockaddr_in  peeraddr;
+    int                 socks[MAX_RETRANSMITS];
+    struct timeval      started[MAX_RETRANSMITS];
+    int                 attempts;
+    int                 timeouts[MAX_RETRANSMITS]; /* net.slp.unicastTimeouts */
+    struct timeval      retry;      /* when the next attempt starts       */
+}NetworkConnect;
+
+
+/*=========================================================================*/
+int NetworkConnectStart(NetworkConnect* conn, struct sockaddr_in* peeraddr);
+/* Starts the first connect attempt                                        */
+/*                                                                         */
+/* peeraddr (IN) the peer to connect to                                    */
+/*                                                                         */
+/* Returns  -    zero on success, -1 if no socket could be made            */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int NetworkConnectFds(NetworkConnect* conn,
+                      fd_set* writefds,
+                      int highfd,
+                      struct timeval** earliest);
+/* Adds the pending attempts to the select() arguments                     */
+/*                                                                         */
+/* earliest (IN/OUT) moved to the time of the next attempt if sooner       */
+/*                                                                         */
+/* Returns  -    the new highest fd                                        */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int NetworkConnectService(NetworkConnect* conn,
+                          fd_set* writefds,
+                          struct timeval* now);
+/* Takes the first attempt that completed and closes the others, or starts */
+/* another attempt when it is time to                                      */
+/*                                                                         */
+/* Returns  -    a connected, non-blocking socket that now belongs to the  */
+/*               caller, -1 while connecting or -2 if the peer refused     */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void NetworkConnectAbort(NetworkConnect* conn);
+/* Closes the attempts of a connect that is given up                       */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int NetworkConnectStream(struct sockaddr_in* peeraddr,
+                         struct timeval* timeout);
+/* SLPNetworkConnectStream() with the retries above, honouring timeout     */
+/*                                                                         */
+/* Returns  -    a connected, blocking socket or -1                        */
+/*=========================================================================*/
+
+#ifdef ENABLE_ASYNC_API
+/*=========================================================================*/
+typedef SLPError (*AsyncProcessProc)(PSLPHandleInfo handle);
+/* Process*() function the I/O thread runs an async call with              */
+/*=========================================================================*/
+
+/*=========================================================================*/
+typedef void (*AsyncDoneProc)(PSLPHandleInfo handle);
+/* Called on the I/O thread when an async call is over to free the copied  */
+/* parameters and clear handle->inUse                                      */
+/*=========================================================================*/
+
+/*=========================================================================*/
+SLPError AsyncRqstStart(PSLPHandleInfo handle,
+                        AsyncProcessProc process,
+                        AsyncDoneProc done);
+/* Queues an async call to the I/O thread, starting the thread if needed   */
+/*                                                                         */
+/* handle   (IN) the async handle, marked in use by the API function       */
+/*                                                                         */
+/* process  (IN) the Process*() function that runs the call                */
+/*                                                                         */
+/* done     (IN) frees the copied parameters and releases the handle       */
+/*                                                                         */
+/* Returns  SLPError code                                                  */
+/*=========================================================================*/
+
+/*=========================================================================*/
+int AsyncRqstClose(PSLPHandleInfo handle);
+/* Stops the call outstanding on an async handle before SLPClose() frees   */
+/* the handle.  Waits for the I/O thread to let go of it unless called     */
+/* from a callback, which is running on the I/O thread itself              */
+/*                                                                         */
+/* handle   (IN) the async handle being closed                             */
+/*                                                                         */
+/* Returns  non-zero if the I/O thread will finish closing the handle      */
+/*=========================================================================*/
+
+/*=========================================================================*/
+int AsyncRqstCancelled(PSLPHandleInfo handle);
+/* Tells the Process*() callbacks whether SLPClose() was called on the     */
+/* handle while its call is outstanding, from a callback or from another   */
+/* thread.  The caller's callback must not be called again once it was     */
+/*                                                                         */
+/* Returns  non-zero if the call is being cancelled                        */
+/*=========================================================================*/
+
+#ifndef _WIN32
+/*=========================================================================*/
+int AsyncRqstIsStarting(void* cookie);
+/* Tells the network engines whether they were reached from the Process*() */
+/* function of an async call, identified by the handle it passes as cookie */
+/*                                                                         */
+/* Returns  non-zero if the engine should hand its conversation to the I/O */
+/*          thread instead of blocking                                     */
+/*=========================================================================*/
+
+/*=========================================================================*/
+SLPError AsyncRqstRply(int sock,
+                       struct sockaddr_in* destaddr,
+                       const char* langtag,
+                       int extoffset,
+                       char* buf,
+                       char buftype,
+                       int bufsize,
+                       NetworkRplyCallback callback,
+                       void * cookie);
+/* NetworkRqstRply() for a connected stream socket, without blocking.  The */
+/* callbacks are made from the I/O thread once the reply is in             */
+/*                                                                         */
+/* Returns  SLP_OK if the conversation was started                         */
+/*=========================================================================*/
+
+/*=========================================================================*/
+SLPError AsyncMcastRqstRply(const char* langtag,
+                            const char* iflist,
+                            char* buf,
+                            char buftype,
+                            int bufsize,
+                            NetworkRplyCallback callback,
+                            void * cookie);
+/* NetworkMcastRqstRply() without blocking.  The convergence rounds run on */
+/* the I/O thread, interleaved with every other outstanding conversation   */
+/*                                                                         */
+/* iflist   (IN) interfaces to multicast on, NULL for net.slp.interfaces   */
+/*                                                                         */
+/* Returns  SLP_OK if the conversation was started                         */
+/*=========================================================================*/
+
+#ifndef UNICAST_NOT_SUPPORTED
+/*=========================================================================*/
+SLPError AsyncUcastRqstRply(PSLPHandleInfo handle,
+                            char* buf,
+                            char buftype,
+                            int bufsize,
+                            NetworkRplyCallback callback,
+                            void * cookie);
+/* NetworkUcastRqstRply() without blocking                                 */
+/*                                                                         */
+/* Returns  SLP_OK if the conversation was started                         */
+/*=========================================================================*/
+#endif
+
+/*=========================================================================*/
+int AsyncDiscoverStarting();
+/* Tells KnownDAFromCache() whether it was reached from the Process*()     */
+/* function of an async call, on the I/O thread, which must not block to   */
+/* discover DAs                                                            */
+/*                                                                         */
+/* Returns  non-zero if AsyncDiscoverStart() should discover them          */
+/*=========================================================================*/
+
+/*=========================================================================*/
+SLPError AsyncDiscoverStart(int scopelistlen, const char* scopelist);
+/* Discovers DAs for the async call being started the way                  */
+/* KnownDAFromCache() does, with conversations the I/O thread multiplexes  */
+/* with every other.  The call starts none of its own meanwhile, its       */
+/* Process*() function runs again once the discovery is over               */
+/*                                                                         */
+/* Returns  SLP_OK if the discovery was started                            */
+/*=========================================================================*/
+
+/*=========================================================================*/
+SLPError AsyncMultiRqstRply(PSLPHandleInfo handle,
+                            const char* scopelist,
+                            int scopelistlen,
+                            struct in_addr* daaddrs,
+                            int dacount,
+                            int uncovered,
+                            char* buf,
+                            char buftype,
+                            int bufsize,
+                            NetworkRplyCallback callback,
+                            void * cookie);
+/* NetworkMultiRqstRply() without blocking, once the DAs are chosen        */
+/*                                                                         */
+/* daaddrs  (IN) the DAs to ask                                            */
+/*                                                                         */
+/* dacount  (IN) the number of addresses in daaddrs                        */
+/*                                                                         */
+/* uncovered (IN) non-zero to multicast for scopes no DA in daaddrs has    */
+/*                                                                         */
+/* Returns  SLP_OK if the conversation was started                         */
+/*=========================================================================*/
+#endif /* _WIN32 */
+#else
+#define AsyncRqstCancelled(handle) 0
+#endif /* ENABLE_ASYNC_API */
 			      
 
+/*=========================================================================*/
+int SLPCollationReserve(SLPCollation* coll, int count);
+/* Sizes the hash set for count more items so that adding them does not    */
+/* rehash.  Called with the number of results in each reply                */
+/*                                                                         */
+/* Returns  zero on success, non-zero if out of memory                     */
+/*=========================================================================*/
+
+/*=========================================================================*/
+SLPCollatedItem* SLPCollationAdd(SLPCollation* coll,
+                                 int foldcase,
+                                 int len,
+                                 const char* str);
+/* Adds a string to the collation unless it is already there               */
+/*                                                                         */
+/* foldcase (IN) non-zero to compare like SLPCompareString() does, zero    */
+/*               for an exact compare                                      */
+/*                                                                         */
+/* Returns  the new item, or NULL if str was collated before or memory     */
+/*          ran out                                                        */
+/*=========================================================================*/
+
+/*=========================================================================*/
+void SLPCollationFree(SLPCollation* coll);
+/* Frees the arena and the hash set of a collation, leaving it empty       */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 int KnownDAConnect(PSLPHandleInfo handle,
                    int scopelistlen,
@@ -488,6 +853,138 @@ int KnownDAConnect(PSLPHandleInfo handle,
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+int KnownDAFindForScopes(PSLPHandleInfo handle,
+                         int scopelistlen,
+                         const char* scopelist,
+                         struct in_addr* daaddrs,
+                         int maxdas,
+                         int* uncovered);
+/* Picks the DAs to ask for a request, one DA for every scope or a single  */
+/* DA that supports all of them                                            */
+/*                                                                         */
+/* daaddrs   (OUT) receives the addresses of the DAs                       */
+/*                                                                         */
+/* maxdas    (IN) room in daaddrs                                          */
+/*                                                                         */
+/* uncovered (OUT) non-zero if some scope has no DA in daaddrs             */
+/*                                                                         */
+/* returns: the number of DAs put in daaddrs                               */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int KnownDAFindHedge(PSLPHandleInfo handle,
+                     int scopelistlen,
+                     const char* scopelist,
+                     struct in_addr* primary,
+                     struct in_addr* daaddr);
+/* Picks a second DA that supports every scope of a request, to send it to */
+/* if the DA asked first is slow                                           */
+/*                                                                         */
+/* primary (IN) the DA asked first                                         */
+/*                                                                         */
+/* daaddr (OUT) address of the DA picked                                   */
+/*                                                                         */
+/* returns: non-zero if there is such a DA                                 */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int KnownDAPoolGet(struct in_addr* daaddr);
+/* Borrows an idle connection to a DA from the process wide pool           */
+/*                                                                         */
+/* daaddr (IN) address of the DA                                           */
+/*                                                                         */
+/* returns: a connected, blocking socket, or -1 if the pool has none that  */
+/*          is still good.  It belongs to the caller until given back with */
+/*          KnownDAPoolPut() or closed                                     */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void KnownDAPoolPut(int sock, struct in_addr* daaddr);
+/* Gives a connection to a DA to the process wide pool, or closes it if    */
+/* the pool is full.  The connection must be idle: every reply to a        */
+/* request sent on it has been read                                        */
+/*                                                                         */
+/* sock   (IN) the connected socket, which now belongs to the pool         */
+/*                                                                         */
+/* daaddr (IN) address of the DA                                           */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int KnownDARttTimeout(struct in_addr* addr);
+/* Estimates how long a peer takes to answer a connect, as TCP does for    */
+/* its retransmission timer                                                */
+/*                                                                         */
+/* addr (IN) address of the DA or SA                                       */
+/*                                                                         */
+/* returns: the time in msecs, or 0 if the peer was never timed            */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void KnownDARttSample(struct in_addr* addr, int msecs);
+/* Adds a measured round trip time to the estimate of a peer               */
+/*                                                                         */
+/* addr  (IN) address of the DA or SA                                      */
+/*                                                                         */
+/* msecs (IN) the time one connect attempt took to complete                */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void KnownDARttReply(struct in_addr* daaddr, int msecs);
+/* Adds the time a DA took to answer a request to its latency estimate,    */
+/* and the success to its failure rate                                     */
+/*                                                                         */
+/* daaddr (IN) address of the DA                                           */
+/*                                                                         */
+/* msecs  (IN) the time from starting the request to reading the reply     */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int KnownDAHedgeDelay(struct in_addr* daaddr);
+/* Tells how long to wait for a DA before sending its request to another   */
+/* DA as well.  net.slp.DAHedgeDelay sets it, or else it is the DA's 95th  */
+/* percentile latency, taken as its smoothed latency plus twice the mean   */
+/* deviation                                                               */
+/*                                                                         */
+/* daaddr (IN) address of the DA asked first                               */
+/*                                                                         */
+/* returns: the time in msecs, or 0 not to hedge                           */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+int KnownDAHedgeSpend();
+/* Accounts for a hedge about to be sent, unless that would exceed         */
+/* net.slp.DAHedgeBudget percent of the requests that could be hedged      */
+/*                                                                         */
+/* returns: non-zero if the hedge may be sent                              */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void KnownDARttRetransmit(int spurious);
+/* Counts a connect attempt retried because the estimate ran out, or one   */
+/* found to be spurious because the earlier attempt completed first        */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void KnownDARttCounters(int* retransmits, int* spurious);
+/* Reports how often connects were retried since the process started       */
+/*                                                                         */
+/* retransmits (OUT) the attempts started while an earlier one was pending */
+/*                                                                         */
+/* spurious    (OUT) the retries that turned out not to be needed          */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 void KnownDABadDA(struct in_addr* daaddr);
 /* Mark a KnownDA as a Bad DA.                                             */
@@ -516,6 +1013,29 @@ int KnownDAGetScopes(int* scopelistlen,
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+char* KnownDADiscoveryRqst(int scopelistlen,
+                           const char* scopelist,
+                           int* bufsize);
+/* Lays out the body of the SrvRqst for DAs that DA discovery sends        */
+/*                                                                         */
+/* bufsize (OUT) the size of the body                                      */
+/*                                                                         */
+/* Returns: the body, to be xfree()d, or NULL if out of memory             */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+SLPBoolean KnownDADiscoveryCallback(SLPError errorcode,
+                                    struct sockaddr_in* peerinfo,
+                                    SLPBuffer rplybuf, 
+                                    void* cookie);
+/* Adds the DAs that answer a DA discovery request to the known DAs        */
+/*                                                                         */
+/* cookie (IN/OUT) an int that counts them                                 */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 void KnownDAProcessSrvRqst(PSLPHandleInfo handle);
 /* Process a SrvRqst for service:directory-agent                           */
@@ -525,6 +1045,125 @@ void KnownDAProcessSrvRqst(PSLPHandleInfo handle);
 /* returns: none                                                           */
 /*=========================================================================*/
 
+
+/*=========================================================================*/
+SLPBoolean ColateSLPSrvURLCallback(SLPHandle hSLP,
+                                   const char* pcSrvURL,
+                                   unsigned short sLifetime,
+                                   SLPError errCode,
+                                   void *pvCookie);
+/* Passes a service URL to the caller of SLPFindSrvs() unless it was       */
+/* already passed on before                                                */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+SLPBoolean SnapshotProcessSrvRqst(PSLPHandleInfo handle);
+/* Answers a SrvRqst from the registrations slpd publishes when slpd is a  */
+/* DA for all of the requested scopes                                      */
+/*                                                                         */
+/* handle (IN) the handle used to make the SrvRqst                         */
+/*                                                                         */
+/* returns: SLP_TRUE if the request was answered and the callback called   */
+/*          with SLP_LAST_CALL, SLP_FALSE if slpd must be asked instead    */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+SLPBoolean SnapshotProcessAttrRqst(PSLPHandleInfo handle);
+/* Answers an AttrRqst without tags from the registrations slpd publishes  */
+/* when slpd is a DA for all of the requested scopes                       */
+/*                                                                         */
+/* handle (IN) the handle used to make the AttrRqst                        */
+/*                                                                         */
+/* returns: SLP_TRUE if the request was answered and the callback called   */
+/*          with SLP_LAST_CALL, SLP_FALSE if slpd must be asked instead    */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+SLPBoolean CacheProcessSrvRqst(PSLPHandleInfo handle);
+/* Answers a SrvRqst from the results of an earlier one.  When it can not, */
+/* it has the results of this one cached once SLP_LAST_CALL comes          */
+/*                                                                         */
+/* handle (IN) the handle used to make the SrvRqst                         */
+/*                                                                         */
+/* returns: SLP_TRUE if the request was answered and the callback called   */
+/*          with SLP_LAST_CALL, SLP_FALSE if the network must be asked     */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+SLPBoolean CacheProcessAttrRqst(PSLPHandleInfo handle);
+/* Answers an AttrRqst from the results of an earlier one.  When it can    */
+/* not, it has the results of this one cached once SLP_LAST_CALL comes     */
+/*                                                                         */
+/* handle (IN) the handle used to make the AttrRqst                        */
+/*                                                                         */
+/* returns: SLP_TRUE if the request was answered and the callback called   */
+/*          with SLP_LAST_CALL, SLP_FALSE if the network must be asked     */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void CacheAddResult(PSLPHandleInfo handle,
+                    const char* result,
+                    unsigned short lifetime);
+/* Collects a result passed to the caller for storing at SLP_LAST_CALL.    */
+/* Does nothing unless CacheProcess*() decided to cache the request        */
+/*                                                                         */
+/* handle   (IN) the handle of the request                                 */
+/*                                                                         */
+/* result   (IN) a service URL or attribute list                           */
+/*                                                                         */
+/* lifetime (IN) seconds the result is good for                            */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void CacheEndRqst(PSLPHandleInfo handle, int complete);
+/* Stores the results collected for a request, replacing the entry that    */
+/* was there, and forgets them.  A request without results removes the     */
+/* entry, the services are gone                                            */
+/*                                                                         */
+/* handle   (IN) the handle of the request                                 */
+/*                                                                         */
+/* complete (IN) zero if the request was stopped before SLP_LAST_CALL, in  */
+/*               which case nothing is stored                              */
+/*=========================================================================*/
+
+/*=========================================================================*/
+void RefreshAdd(PSLPHandleInfo handle,
+                const char* url,
+                const char* attrs,
+                unsigned short lifetime);
+/* Keeps refreshing a registration slpd just took, if                      */
+/* net.slp.refreshRegistrations asks for that.  Replaces what was kept for */
+/* the URL on the same handle                                              */
+/*                                                                         */
+/* handle   (IN) the handle the URL was registered through                 */
+/*                                                                         */
+/* url      (IN) the registered URL                                        */
+/*                                                                         */
+/* attrs    (IN) its attribute list                                        */
+/*                                                                         */
+/* lifetime (IN) its lifetime in seconds                                   */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void RefreshRemove(PSLPHandleInfo handle, const char* url);
+/* Stops refreshing a URL registered through a handle, it is being         */
+/* deregistered                                                            */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void RefreshForget(PSLPHandleInfo handle);
+/* Stops refreshing everything registered through a handle that is being   */
+/* closed.  The registrations live out their lifetime                      */
+/*=========================================================================*/
+
 #ifdef DEBUG
 /*=========================================================================*/
 void KnownDAFreeAll();
@@ -532,6 +1171,12 @@ void KnownDAFreeAll();
 /*                                                                         */
 /* returns: none                                                           */
 /*=========================================================================*/
+
+
+/*=========================================================================*/
+void CacheFreeAll();
+/* Frees every cached result                                               */
+/*=========================================================================*/
 #endif
 
 #endif /*LIBSLP_H_INCLUDED*/ 
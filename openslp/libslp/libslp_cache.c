@@ -0,0 +1,825 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol Version 2                                         */
+/*                                                                         */
+/* File:        libslp_cache.c                                             */
+/*                                                                         */
+/* Abstract:    The process wide cache of SLPFindSrvs() and SLPFindAttrs() */
+/*              results, turned on by net.slp.clientCache.  Results are    */
+/*              kept as long as the URLs in them live, and an expired      */
+/*              entry may still be answered while the I/O thread asks the  */
+/*              network again.                                             */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+/***************************************************************************/
+
+
+#include "slp.h"
+#include "libslp.h"
+
+#define CACHE_MIN_BUCKETS   32
+#define CACHE_SRVRQST       'S'
+#define CACHE_ATTRRQST      'A'
+
+#if defined(ENABLE_ASYNC_API) && !defined(_WIN32)
+#define CACHE_REFRESH       1   /* expired entries are refreshed in the   */
+                                /* background by the I/O thread           */
+#endif
+
+/*=========================================================================*/
+typedef struct _SLPCacheEntry
+/* The results of one request.  The key and the results follow the entry   */
+/* in the same allocation                                                  */
+/*=========================================================================*/
+{
+    SLPListItem             listitem;   /* in G_CacheLRU, newest first    */
+    struct _SLPCacheEntry*  chain;      /* next in the hash bucket        */
+    unsigned int            hash;
+    int                     keylen;
+    char*                   key;
+    time_t                  stored;
+    time_t                  expires;
+    int                     refreshing; /* a refresh is on its way        */
+    int                     resultslen;
+    char*                   results;    /* lifetime and string, each      */
+}SLPCacheEntry;
+
+/* G_CacheLock guards everything below.  Calls on sync handles look the    */
+/* cache up from any thread, while the I/O thread stores the results of    */
+/* async calls and of refreshes                                            */
+#ifdef LIBSLP_THREADS
+static pthread_mutex_t  G_CacheLock         = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static SLPCacheEntry**  G_CacheBuckets      = 0;
+static int              G_CacheBucketCount  = 0;
+static SLPList          G_CacheLRU          = {0, 0, 0};
+
+
+/*-------------------------------------------------------------------------*/
+static void CacheLock()
+/*-------------------------------------------------------------------------*/
+{
+#ifdef LIBSLP_THREADS
+    pthread_mutex_lock(&G_CacheLock);
+#endif
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void CacheUnlock()
+/*-------------------------------------------------------------------------*/
+{
+#ifdef LIBSLP_THREADS
+    pthread_mutex_unlock(&G_CacheLock);
+#endif
+}
+
+
+/*-------------------------------------------------------------------------*/
+static unsigned int CacheHash(const char* key, int keylen)
+/* 32 bit FNV-1a                                                           */
+/*-------------------------------------------------------------------------*/
+{
+    unsigned int    hash = 2166136261U;
+    int             i;
+
+    for(i = 0; i < keylen; i++)
+    {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int CacheStaleTime()
+/* Seconds an expired entry is still answered from while it is refreshed   */
+/*-------------------------------------------------------------------------*/
+{
+#ifdef CACHE_REFRESH
+    int staletime;
+
+    staletime = SLPPropertyAsInteger(SLPGetProperty("net.slp.clientCacheStaleTime"));
+    return staletime > 0 ? staletime : 0;
+#else
+    /* nobody to refresh it */
+    return 0;
+#endif
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPCacheEntry* CacheFind(const char* key, int keylen, unsigned int hash)
+/* Must be called with G_CacheLock held                                    */
+/*-------------------------------------------------------------------------*/
+{
+    SLPCacheEntry*  entry;
+
+    if(G_CacheBucketCount == 0)
+    {
+        return 0;
+    }
+
+    for(entry = G_CacheBuckets[hash & (G_CacheBucketCount - 1)];
+        entry;
+        entry = entry->chain)
+    {
+        if(entry->hash == hash &&
+           entry->keylen == keylen &&
+           memcmp(entry->key,key,keylen) == 0)
+        {
+            return entry;
+        }
+    }
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void CacheRemove(SLPCacheEntry* entry)
+/* Must be called with G_CacheLock held                                    */
+/*-------------------------------------------------------------------------*/
+{
+    SLPCacheEntry** link;
+
+    link = &(G_CacheBuckets[entry->hash & (G_CacheBucketCount - 1)]);
+    while(*link != entry)
+    {
+        link = &((*link)->chain);
+    }
+    *link = entry->chain;
+
+    SLPListUnlink(&G_CacheLRU,(SLPListItem*)entry);
+    xfree(entry);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int CacheInsert(SLPCacheEntry* entry)
+/* Adds an entry that is not in the cache yet.  Must be called with        */
+/* G_CacheLock held                                                        */
+/*-------------------------------------------------------------------------*/
+{
+    SLPCacheEntry** table;
+    SLPCacheEntry*  item;
+    int             buckets;
+    int             i;
+
+    /* keep the load factor under 3/4 */
+    buckets = G_CacheBucketCount ? G_CacheBucketCount : CACHE_MIN_BUCKETS;
+    while((G_CacheLRU.count + 1) * 4 > buckets * 3)
+    {
+        buckets *= 2;
+    }
+
+    if(buckets != G_CacheBucketCount)
+    {
+        table = (SLPCacheEntry**)xmalloc(buckets * sizeof(SLPCacheEntry*));
+        if(table == 0)
+        {
+            return -1;
+        }
+        memset(table,0,buckets * sizeof(SLPCacheEntry*));
+
+        /* every entry is on the LRU list once, rehash from there */
+        for(item = (SLPCacheEntry*)G_CacheLRU.head;
+            item;
+            item = (SLPCacheEntry*)item->listitem.next)
+        {
+            i = item->hash & (buckets - 1);
+            item->chain = table[i];
+            table[i] = item;
+        }
+
+        if(G_CacheBuckets) xfree(G_CacheBuckets);
+        G_CacheBuckets = table;
+        G_CacheBucketCount = buckets;
+    }
+
+    i = entry->hash & (G_CacheBucketCount - 1);
+    entry->chain = G_CacheBuckets[i];
+    G_CacheBuckets[i] = entry;
+    SLPListLinkHead(&G_CacheLRU,(SLPListItem*)entry);
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPBoolean CacheUsable(PSLPHandleInfo handle)
+/*-------------------------------------------------------------------------*/
+{
+    if(SLPPropertyAsBoolean(SLPGetProperty("net.slp.clientCache")) == 0)
+    {
+        return SLP_FALSE;
+    }
+
+#ifndef UNICAST_NOT_SUPPORTED
+    /* the answer of one particular agent */
+    if(handle->dounicast)
+    {
+        return SLP_FALSE;
+    }
+#endif
+
+    return SLP_TRUE;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int CacheBegin(PSLPHandleInfo handle,
+                      char type,
+                      int namelen,
+                      const char* name,
+                      int scopelistlen,
+                      const char* scopelist,
+                      int filterlen,
+                      const char* filter)
+/* Builds the key of a request in handle->cachekey.  The key is the type   */
+/* and whether net.slp.securityEnabled is set, followed by the language    */
+/* tag, scope list, service type or URL and the predicate or tag list,     */
+/* each null terminated                                                    */
+/*-------------------------------------------------------------------------*/
+{
+    char*   cur;
+
+    /* left over from a call that was stopped */
+    CacheEndRqst(handle,0);
+
+    handle->cachekeylen = 2 + handle->langtaglen + 1 +
+                          scopelistlen + 1 +
+                          namelen + 1 +
+                          filterlen + 1;
+    handle->cachekey = (char*)xmalloc(handle->cachekeylen);
+    if(handle->cachekey == 0)
+    {
+        return -1;
+    }
+
+    cur = handle->cachekey;
+    *cur++ = type;
+    /* results that were not authenticated must not answer when security */
+    /* is on, nor the other way round                                    */
+    *cur++ = SLPPropertyAsBoolean(SLPGetProperty("net.slp.securityEnabled")) ?
+             '1' : '0';
+    memcpy(cur,handle->langtag,handle->langtaglen);
+    cur += handle->langtaglen;
+    *cur++ = 0;
+    memcpy(cur,scopelist,scopelistlen);
+    cur += scopelistlen;
+    *cur++ = 0;
+    memcpy(cur,name,namelen);
+    cur += namelen;
+    *cur++ = 0;
+    memcpy(cur,filter,filterlen);
+    cur += filterlen;
+    *cur = 0;
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int CacheLookup(PSLPHandleInfo handle,
+                       char** results,
+                       int* resultslen,
+                       int* refresh)
+/* Copies the cached results for handle->cachekey, with the lifetimes      */
+/* that are left of them                                                   */
+/*                                                                         */
+/* Returns  non-zero if the results were found.  *refresh is set if the    */
+/*          entry has expired and the caller must start its refresh        */
+/*-------------------------------------------------------------------------*/
+{
+    SLPCacheEntry*  entry;
+    unsigned int    hash;
+    time_t          now;
+    int             lifetime;
+    int             age;
+    char*           cur;
+
+    *results = 0;
+    *refresh = 0;
+
+    hash = CacheHash(handle->cachekey,handle->cachekeylen);
+    now = time(0);
+
+    CacheLock();
+
+    entry = CacheFind(handle->cachekey,handle->cachekeylen,hash);
+    if(entry && now >= entry->expires + CacheStaleTime())
+    {
+        CacheRemove(entry);
+        entry = 0;
+    }
+
+    if(entry)
+    {
+        *results = (char*)xmalloc(entry->resultslen);
+        if(*results)
+        {
+            memcpy(*results,entry->results,entry->resultslen);
+            *resultslen = entry->resultslen;
+
+            age = (int)(now - entry->stored);
+            cur = *results;
+            while(cur < *results + *resultslen)
+            {
+                /* a stale result is still good until it is refreshed */
+                lifetime = AsUINT16(cur) - age;
+                ToUINT16(cur,lifetime > 0 ? lifetime : 1);
+                cur += 2;
+                cur += strlen(cur) + 1;
+            }
+
+            if(now >= entry->expires && entry->refreshing == 0)
+            {
+                entry->refreshing = 1;
+                *refresh = 1;
+            }
+
+            SLPListUnlink(&G_CacheLRU,(SLPListItem*)entry);
+            SLPListLinkHead(&G_CacheLRU,(SLPListItem*)entry);
+        }
+    }
+
+    CacheUnlock();
+
+    return *results != 0;
+}
+
+
+#ifdef CACHE_REFRESH
+/*-------------------------------------------------------------------------*/
+static SLPBoolean CacheRefreshSrvURLCallback(SLPHandle hSLP,
+                                             const char* pcSrvURL,
+                                             unsigned short sLifetime,
+                                             SLPError errCode,
+                                             void *pvCookie)
+/*-------------------------------------------------------------------------*/
+{
+    /* the results were stored by the time SLP_LAST_CALL gets here, */
+    /* any other error ends the request just the same               */
+    if(errCode != SLP_OK)
+    {
+        SLPClose(hSLP);
+        return SLP_FALSE;
+    }
+
+    return SLP_TRUE;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPBoolean CacheRefreshAttrCallback(SLPHandle hSLP,
+                                           const char* pcAttrList,
+                                           SLPError errCode,
+                                           void *pvCookie)
+/*-------------------------------------------------------------------------*/
+{
+    if(errCode != SLP_OK)
+    {
+        SLPClose(hSLP);
+        return SLP_FALSE;
+    }
+
+    return SLP_TRUE;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void CacheRefresh(const char* key, int keylen)
+/* Asks the network again for the results of an expired entry, on an async */
+/* handle of our own so that the I/O thread does it in the background      */
+/*-------------------------------------------------------------------------*/
+{
+    SLPCacheEntry*  entry;
+    PSLPHandleInfo  handle;
+    const char*     langtag;
+    const char*     scopelist;
+    const char*     name;
+    const char*     filter;
+    SLPError        result;
+
+    langtag = key + 2;
+    scopelist = langtag + strlen(langtag) + 1;
+    name = scopelist + strlen(scopelist) + 1;
+    filter = name + strlen(name) + 1;
+
+    result = SLPOpen(langtag,SLP_TRUE,(SLPHandle*)&handle);
+    if(result == SLP_OK)
+    {
+        /* not answered from the cache, but stored in it */
+        handle->cacherefresh = 1;
+
+        if(*key == CACHE_SRVRQST)
+        {
+            result = SLPFindSrvs((SLPHandle)handle,
+                                 name,
+                                 scopelist,
+                                 filter,
+                                 CacheRefreshSrvURLCallback,
+                                 0);
+        }
+        else
+        {
+            result = SLPFindAttrs((SLPHandle)handle,
+                                  name,
+                                  scopelist,
+                                  filter,
+                                  CacheRefreshAttrCallback,
+                                  0);
+        }
+
+        if(result)
+        {
+            SLPClose((SLPHandle)handle);
+        }
+    }
+
+    if(result)
+    {
+        /* let the next lookup try again */
+        CacheLock();
+        entry = CacheFind(key,keylen,CacheHash(key,keylen));
+        if(entry)
+        {
+            entry->refreshing = 0;
+        }
+        CacheUnlock();
+    }
+}
+#endif
+
+
+/*=========================================================================*/
+SLPBoolean CacheProcessSrvRqst(PSLPHandleInfo handle)
+/* Answers a SrvRqst from the results of an earlier one.  When it can not, */
+/* it has the results of this one cached once SLP_LAST_CALL comes          */
+/*                                                                         */
+/* handle (IN) the handle used to make the SrvRqst                         */
+/*                                                                         */
+/* returns: SLP_TRUE if the request was answered and the callback called   */
+/*          with SLP_LAST_CALL, SLP_FALSE if the network must be asked     */
+/*=========================================================================*/
+{
+    char*           results;
+    int             resultslen;
+    int             refresh;
+    char*           cur;
+    unsigned short  lifetime;
+
+    if(CacheUsable(handle) == SLP_FALSE ||
+       (handle->params.findsrvs.srvtypelen == strlen(SLP_SA_SERVICE_TYPE) &&
+        strncasecmp(handle->params.findsrvs.srvtype,
+                    SLP_SA_SERVICE_TYPE,
+                    handle->params.findsrvs.srvtypelen) == 0))
+    {
+        return SLP_FALSE;
+    }
+
+    if(CacheBegin(handle,
+                  CACHE_SRVRQST,
+                  handle->params.findsrvs.srvtypelen,
+                  handle->params.findsrvs.srvtype,
+                  handle->params.findsrvs.scopelistlen,
+                  handle->params.findsrvs.scopelist,
+                  handle->params.findsrvs.predicatelen,
+                  handle->params.findsrvs.predicate))
+    {
+        return SLP_FALSE;
+    }
+
+    if(handle->cacherefresh ||
+       CacheLookup(handle,&results,&resultslen,&refresh) == 0)
+    {
+        /* keep the key, CacheAddResult() collects the results */
+        return SLP_FALSE;
+    }
+
+#ifdef CACHE_REFRESH
+    if(refresh)
+    {
+        CacheRefresh(handle->cachekey,handle->cachekeylen);
+    }
+#endif
+    CacheEndRqst(handle,0);
+
+    cur = results;
+    while(cur < results + resultslen)
+    {
+        lifetime = AsUINT16(cur);
+        cur += 2;
+        if(ColateSLPSrvURLCallback((SLPHandle)handle,
+                                   cur,
+                                   lifetime,
+                                   SLP_OK,
+                                   handle->params.findsrvs.cookie) == SLP_FALSE)
+        {
+            /* the caller wants no more, not even SLP_LAST_CALL */
+            goto FINISHED;
+        }
+        cur += strlen(cur) + 1;
+    }
+
+    ColateSLPSrvURLCallback((SLPHandle)handle,
+                            0,
+                            0,
+                            SLP_LAST_CALL,
+                            handle->params.findsrvs.cookie);
+
+FINISHED:
+    xfree(results);
+
+    return SLP_TRUE;
+}
+
+
+/*=========================================================================*/
+SLPBoolean CacheProcessAttrRqst(PSLPHandleInfo handle)
+/* Answers an AttrRqst from the results of an earlier one.  When it can    */
+/* not, it has the results of this one cached once SLP_LAST_CALL comes     */
+/*                                                                         */
+/* handle (IN) the handle used to make the AttrRqst                        */
+/*                                                                         */
+/* returns: SLP_TRUE if the request was answered and the callback called   */
+/*          with SLP_LAST_CALL, SLP_FALSE if the network must be asked     */
+/*=========================================================================*/
+{
+    char*           results;
+    int             resultslen;
+    int             refresh;
+    char*           cur;
+
+    if(CacheUsable(handle) == SLP_FALSE)
+    {
+        return SLP_FALSE;
+    }
+
+    if(CacheBegin(handle,
+                  CACHE_ATTRRQST,
+                  handle->params.findattrs.urllen,
+                  handle->params.findattrs.url,
+                  handle->params.findattrs.scopelistlen,
+                  handle->params.findattrs.scopelist,
+                  handle->params.findattrs.taglistlen,
+                  handle->params.findattrs.taglist))
+    {
+        return SLP_FALSE;
+    }
+
+    if(handle->cacherefresh ||
+       CacheLookup(handle,&results,&resultslen,&refresh) == 0)
+    {
+        return SLP_FALSE;
+    }
+
+#ifdef CACHE_REFRESH
+    if(refresh)
+    {
+        CacheRefresh(handle->cachekey,handle->cachekeylen);
+    }
+#endif
+    CacheEndRqst(handle,0);
+
+    /* one attribute list for each reply that had one */
+    cur = results;
+    while(cur < results + resultslen)
+    {
+        cur += 2;
+        if(handle->params.findattrs.callback((SLPHandle)handle,
+                                             cur,
+                                             SLP_OK,
+                                             handle->params.findattrs.cookie) == SLP_FALSE ||
+           AsyncRqstCancelled(handle))
+        {
+            goto FINISHED;
+        }
+        cur += strlen(cur) + 1;
+    }
+
+    handle->params.findattrs.callback((SLPHandle)handle,
+                                      0,
+                                      SLP_LAST_CALL,
+                                      handle->params.findattrs.cookie);
+
+FINISHED:
+    xfree(results);
+
+    return SLP_TRUE;
+}
+
+
+/*=========================================================================*/
+void CacheAddResult(PSLPHandleInfo handle,
+                    const char* result,
+                    unsigned short lifetime)
+/* Collects a result passed to the caller for storing at SLP_LAST_CALL.    */
+/* Does nothing unless CacheProcess*() decided to cache the request        */
+/*                                                                         */
+/* handle   (IN) the handle of the request                                 */
+/*                                                                         */
+/* result   (IN) a service URL or attribute list                           */
+/*                                                                         */
+/* lifetime (IN) seconds the result is good for                            */
+/*=========================================================================*/
+{
+    int     len;
+    int     size;
+    char*   buf;
+
+    if(handle->cachekey == 0)
+    {
+        return;
+    }
+
+    len = strlen(result) + 1;
+    if(handle->cachebuflen + 2 + len > handle->cachebufsize)
+    {
+        size = handle->cachebufsize ? handle->cachebufsize * 2 : 1024;
+        while(handle->cachebuflen + 2 + len > size)
+        {
+            size *= 2;
+        }
+        buf = (char*)xrealloc(handle->cachebuf,size);
+        if(buf == 0)
+        {
+            /* only complete results are cached */
+            CacheEndRqst(handle,0);
+            return;
+        }
+        handle->cachebuf = buf;
+        handle->cachebufsize = size;
+    }
+
+    ToUINT16(handle->cachebuf + handle->cachebuflen,lifetime);
+    handle->cachebuflen += 2;
+    memcpy(handle->cachebuf + handle->cachebuflen,result,len);
+    handle->cachebuflen += len;
+}
+
+
+/*=========================================================================*/
+void CacheEndRqst(PSLPHandleInfo handle, int complete)
+/* Stores the results collected for a request, replacing the entry that    */
+/* was there, and forgets them.  A request without results removes the     */
+/* entry, the services are gone                                            */
+/*                                                                         */
+/* handle   (IN) the handle of the request                                 */
+/*                                                                         */
+/* complete (IN) zero if the request was stopped before SLP_LAST_CALL, in  */
+/*               which case nothing is stored                              */
+/*=========================================================================*/
+{
+    SLPCacheEntry*  entry;
+    SLPCacheEntry*  newentry    = 0;
+    unsigned int    hash;
+    int             maxlifetime;
+    int             maxentries;
+    int             lifetime;
+    char*           cur;
+
+    if(handle->cachekey == 0)
+    {
+        return;
+    }
+
+    hash = CacheHash(handle->cachekey,handle->cachekeylen);
+
+    if(complete && handle->cachebuflen)
+    {
+        /* the entry expires with the first of its results */
+        maxlifetime = SLPPropertyAsInteger(SLPGetProperty("net.slp.clientCacheMaxLifetime"));
+        lifetime = maxlifetime;
+        cur = handle->cachebuf;
+        while(cur < handle->cachebuf + handle->cachebuflen)
+        {
+            if(AsUINT16(cur) < lifetime)
+            {
+                lifetime = AsUINT16(cur);
+            }
+            cur += 2;
+            cur += strlen(cur) + 1;
+        }
+
+        if(lifetime > 0)
+        {
+            newentry = (SLPCacheEntry*)xmalloc(sizeof(SLPCacheEntry) +
+                                               handle->cachekeylen +
+                                               handle->cachebuflen);
+        }
+        if(newentry)
+        {
+            memset(newentry,0,sizeof(SLPCacheEntry));
+            newentry->hash = hash;
+            newentry->keylen = handle->cachekeylen;
+            newentry->key = (char*)(newentry + 1);
+            memcpy(newentry->key,handle->cachekey,handle->cachekeylen);
+            newentry->resultslen = handle->cachebuflen;
+            newentry->results = newentry->key + newentry->keylen;
+            memcpy(newentry->results,handle->cachebuf,handle->cachebuflen);
+            newentry->stored = time(0);
+            newentry->expires = newentry->stored + lifetime;
+        }
+    }
+
+    CacheLock();
+
+    entry = CacheFind(handle->cachekey,handle->cachekeylen,hash);
+    if(entry)
+    {
+        if(complete)
+        {
+            CacheRemove(entry);
+        }
+        else if(handle->cacherefresh)
+        {
+            /* let the next lookup try again */
+            entry->refreshing = 0;
+        }
+    }
+
+    if(newentry)
+    {
+        if(CacheInsert(newentry))
+        {
+            xfree(newentry);
+        }
+
+        /* make room by dropping the entries used longest ago */
+        maxentries = SLPPropertyAsInteger(SLPGetProperty("net.slp.clientCacheMaxEntries"));
+        while(G_CacheLRU.count > maxentries && G_CacheLRU.count)
+        {
+            CacheRemove((SLPCacheEntry*)G_CacheLRU.tail);
+        }
+    }
+
+    CacheUnlock();
+
+    xfree(handle->cachekey);
+    handle->cachekey = 0;
+    handle->cachekeylen = 0;
+    if(handle->cachebuf) xfree(handle->cachebuf);
+    handle->cachebuf = 0;
+    handle->cachebuflen = 0;
+    handle->cachebufsize = 0;
+}
+
+
+#ifdef DEBUG
+/*=========================================================================*/
+void CacheFreeAll()
+/* Frees every cached result                                               */
+/*=========================================================================*/
+{
+    CacheLock();
+    while(G_CacheLRU.count)
+    {
+        CacheRemove((SLPCacheEntry*)G_CacheLRU.head);
+    }
+    if(G_CacheBuckets) xfree(G_CacheBuckets);
+    G_CacheBuckets = 0;
+    G_CacheBucketCount = 0;
+    CacheUnlock();
+}
+#endif
@@ -0,0 +1,272 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol Version 2                                         */
+/*                                                                         */
+/* File:        libslp_collate.c                                           */
+/*                                                                         */
+/* Abstract:    Collation of the results of a request.  Results already    */
+/*              reported are found in a hash set whose items live in an    */
+/*              arena that is freed in one go when the request is over.    */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+/***************************************************************************/
+
+#include "slp.h"
+#include "libslp.h"
+
+#define COLLATION_MIN_BUCKETS   32
+#define COLLATION_CHUNK_SIZE    4096
+
+
+/*-------------------------------------------------------------------------*/
+static unsigned int CollationHash(const char* str, int len, int foldcase)
+/* 32 bit FNV-1a, over the lower case form when case does not matter       */
+/*-------------------------------------------------------------------------*/
+{
+    unsigned int    hash = 2166136261U;
+    int             i;
+
+    for(i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)(foldcase ? tolower((unsigned char)str[i]) : str[i]);
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void* CollationAlloc(SLPCollation* coll, int size)
+/* Carves size bytes out of the arena, starting a new chunk when the       */
+/* current one is used up.  Chunks are only freed by SLPCollationFree()    */
+/*-------------------------------------------------------------------------*/
+{
+    char*   chunk;
+    int     chunksize;
+    void*   result;
+
+    /* keep the items aligned */
+    size = (size + sizeof(void*) - 1) & ~(int)(sizeof(void*) - 1);
+
+    if(size > coll->arenaleft)
+    {
+        chunksize = COLLATION_CHUNK_SIZE;
+        if(size + (int)sizeof(void*) > chunksize)
+        {
+            chunksize = size + sizeof(void*);
+        }
+        chunk = (char*)xmalloc(chunksize);
+        if(chunk == 0)
+        {
+            return 0;
+        }
+
+        /* the first word links the chunks */
+        *(char**)chunk = coll->chunks;
+        coll->chunks = chunk;
+        coll->arena = chunk + sizeof(void*);
+        coll->arenaleft = chunksize - sizeof(void*);
+    }
+
+    result = coll->arena;
+    coll->arena += size;
+    coll->arenaleft -= size;
+
+    return result;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int CollationResize(SLPCollation* coll, int buckets)
+/* Rehashes the set into buckets buckets, a power of two                   */
+/*-------------------------------------------------------------------------*/
+{
+    SLPCollatedItem**   table;
+    SLPCollatedItem*    item;
+    int                 i;
+
+    table = (SLPCollatedItem**)xmalloc(buckets * sizeof(SLPCollatedItem*));
+    if(table == 0)
+    {
+        return -1;
+    }
+    memset(table,0,buckets * sizeof(SLPCollatedItem*));
+
+    /* the order list has every item once, rehash from there */
+    for(item = coll->first; item; item = item->next)
+    {
+        i = item->hash & (buckets - 1);
+        item->chain = table[i];
+        table[i] = item;
+    }
+
+    if(coll->buckets) xfree(coll->buckets);
+    coll->buckets = table;
+    coll->bucketcount = buckets;
+
+    return 0;
+}
+
+
+/*=========================================================================*/
+int SLPCollationReserve(SLPCollation* coll, int count)
+/* Sizes the hash set for count more items so that adding them does not    */
+/* rehash.  Called with the number of results in each reply                */
+/*                                                                         */
+/* coll     (IN) the collation of the request                              */
+/*                                                                         */
+/* count    (IN) the number of items about to be added                     */
+/*                                                                         */
+/* Returns  zero on success, non-zero if out of memory                     */
+/*=========================================================================*/
+{
+    int buckets;
+
+    /* keep the load factor under 3/4 */
+    buckets = coll->bucketcount ? coll->bucketcount : COLLATION_MIN_BUCKETS;
+    while((coll->count + count) * 4 > buckets * 3)
+    {
+        buckets *= 2;
+    }
+
+    if(buckets == coll->bucketcount)
+    {
+        return 0;
+    }
+
+    return CollationResize(coll,buckets);
+}
+
+
+/*=========================================================================*/
+SLPCollatedItem* SLPCollationAdd(SLPCollation* coll,
+                                 int foldcase,
+                                 int len,
+                                 const char* str)
+/* Adds a string to the collation unless it is already there               */
+/*                                                                         */
+/* coll     (IN) the collation of the request                              */
+/*                                                                         */
+/* foldcase (IN) non-zero to compare like SLPCompareString() does, zero    */
+/*               for an exact compare                                      */
+/*                                                                         */
+/* len      (IN) length of str in bytes                                    */
+/*                                                                         */
+/* str      (IN) the string to add                                         */
+/*                                                                         */
+/* Returns  the new item, or NULL if str was collated before or memory     */
+/*          ran out.  The item and its copy of str, which is null          */
+/*          terminated, stay valid until SLPCollationFree()                */
+/*=========================================================================*/
+{
+    SLPCollatedItem*    item;
+    unsigned int        hash;
+
+    if(SLPCollationReserve(coll,1))
+    {
+        return 0;
+    }
+
+    hash = CollationHash(str,len,foldcase);
+    for(item = coll->buckets[hash & (coll->bucketcount - 1)];
+        item;
+        item = item->chain)
+    {
+        if(item->hash == hash &&
+           item->len == len &&
+           (foldcase ? SLPCompareString(len,item->str,len,str)
+                     : memcmp(item->str,str,len)) == 0)
+        {
+            return 0;
+        }
+    }
+
+    item = (SLPCollatedItem*)CollationAlloc(coll,sizeof(SLPCollatedItem) + len + 1);
+    if(item == 0)
+    {
+        return 0;
+    }
+    item->str = (char*)(item + 1);
+    memcpy(item->str,str,len);
+    item->str[len] = 0;
+    item->len = len;
+    item->hash = hash;
+    item->lifetime = 0;
+
+    item->chain = coll->buckets[hash & (coll->bucketcount - 1)];
+    coll->buckets[hash & (coll->bucketcount - 1)] = item;
+
+    /* remember the order items came in */
+    item->next = 0;
+    if(coll->last)
+    {
+        coll->last->next = item;
+    }
+    else
+    {
+        coll->first = item;
+    }
+    coll->last = item;
+    coll->count++;
+    coll->totallen += len;
+
+    return item;
+}
+
+
+/*=========================================================================*/
+void SLPCollationFree(SLPCollation* coll)
+/* Frees the arena and the hash set of a collation, leaving it empty       */
+/*                                                                         */
+/* coll     (IN) the collation of the request that is over                 */
+/*=========================================================================*/
+{
+    char* chunk;
+
+    while(coll->chunks)
+    {
+        chunk = coll->chunks;
+        coll->chunks = *(char**)chunk;
+        xfree(chunk);
+    }
+    if(coll->buckets) xfree(coll->buckets);
+    memset(coll,0,sizeof(SLPCollation));
+}
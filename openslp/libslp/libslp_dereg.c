@@ -99,12 +99,13 @@ SLPBoolean CallbackSrvDeReg(SLPError errorcode,
 }
 
 
-/*-------------------------------------------------------------------------*/ 
-SLPError ProcessSrvDeReg(PSLPHandleInfo handle)
+/*-------------------------------------------------------------------------*/
+static SLPError SrvDeRegBuild(PSLPHandleInfo handle,
+                              char** bufp,
+                              int* bufsizep)
+/* Builds the body of a SRVDEREG for the URL in handle->params.dereg       */
 /*-------------------------------------------------------------------------*/
 {
-    int                 sock;
-    struct sockaddr_in  peeraddr;
     int                 bufsize     = 0;
     char*               buf         = 0;
     char*               curpos      = 0;
@@ -192,7 +193,36 @@ SLPError ProcessSrvDeReg(PSLPHandleInfo handle)
     /* TODO: No tag list for now put in taglist stuff */
     ToUINT16(curpos,0);
 
-   
+    result = SLP_OK;
+
+    FINISHED:
+#ifdef ENABLE_SLPv2_SECURITY
+    if(urlauth) xfree(urlauth);
+#endif
+
+    *bufp = buf;
+    *bufsizep = bufsize;
+
+    return result;
+}
+
+
+/*-------------------------------------------------------------------------*/ 
+SLPError ProcessSrvDeReg(PSLPHandleInfo handle)
+/*-------------------------------------------------------------------------*/
+{
+    int                 sock;
+    struct sockaddr_in  peeraddr;
+    int                 bufsize     = 0;
+    char*               buf         = 0;
+    SLPError            result      = 0;
+
+    result = SrvDeRegBuild(handle,&buf,&bufsize);
+    if(result)
+    {
+        return result;
+    }
+
     /*--------------------------*/
     /* Call the RqstRply engine */
     /*--------------------------*/
@@ -219,29 +249,21 @@ SLPError ProcessSrvDeReg(PSLPHandleInfo handle)
     else
     {
         result = SLP_NETWORK_INIT_FAILED;
-        goto FINISHED;
     }
-    
-    
-    FINISHED:
-    if(buf) xfree(buf);
-#ifdef ENABLE_SLPv2_SECURITY
-    if(urlauth) xfree(urlauth);
-#endif
+
+    xfree(buf);
 
     return result;
 }
 
 #ifdef ENABLE_ASYNC_API
 /*-------------------------------------------------------------------------*/ 
-SLPError AsyncProcessSrvDeReg(PSLPHandleInfo handle)
+void AsyncSrvDeRegDone(PSLPHandleInfo handle)
 /*-------------------------------------------------------------------------*/
 {
-    SLPError result = ProcessSrvDeReg(handle);
     xfree((void*)handle->params.dereg.scopelist);
     xfree((void*)handle->params.dereg.url);
     handle->inUse = SLP_FALSE;
-    return result;
 }
 #endif
 
@@ -257,6 +279,7 @@ SLPError SLPAPI SLPDereg(SLPHandle  hSLP,
     PSLPHandleInfo      handle      = 0;
     SLPError            result      = SLP_OK;
     SLPSrvURL*          parsedurl   = 0;
+    int                 hold        = 0;
 
     /*------------------------------*/
     /* check for invalid parameters */
@@ -284,6 +307,11 @@ SLPError SLPAPI SLPDereg(SLPHandle  hSLP,
     }
     handle->inUse = SLP_TRUE;
 
+    /* property values read from here on stay valid until we return */
+    hold = SLPPropertyHold();
+
+    /* whether or not slpd has it, it is not to be kept alive any more */
+    RefreshRemove(handle,srvUrl);
 
     /*------------------*/
     /* Parse the srvurl */
@@ -298,6 +326,7 @@ SLPError SLPAPI SLPDereg(SLPHandle  hSLP,
 
         if(parsedurl) SLPFree(parsedurl);
         handle->inUse = SLP_FALSE;
+        SLPPropertyRelease(hold);
         return result;
     }
 
@@ -329,7 +358,7 @@ SLPError SLPAPI SLPDereg(SLPHandle  hSLP,
         if(handle->params.dereg.scopelist &&
            handle->params.dereg.url)
         {
-            result = ThreadCreate((ThreadStartProc)AsyncProcessSrvDeReg,handle);
+            result = AsyncRqstStart(handle,ProcessSrvDeReg,AsyncSrvDeRegDone);
         }
         else
         {
@@ -353,5 +382,213 @@ SLPError SLPAPI SLPDereg(SLPHandle  hSLP,
 
     if(parsedurl) SLPFree(parsedurl);
 
+    SLPPropertyRelease(hold);
+    return result;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void CallbackSrvDeRegBatch(SLPError errorcode,
+                                  int index,
+                                  struct sockaddr_in* peerinfo,
+                                  SLPBuffer replybuf,
+                                  void* cookie)
+/*-------------------------------------------------------------------------*/
+{
+    SLPMessage      replymsg;
+    PSLPHandleInfo  handle      = (PSLPHandleInfo) cookie;
+
+    if(errorcode == 0)
+    {
+        replymsg = SLPMessageAlloc();
+        if(replymsg)
+        {
+            errorcode = SLPMessageParseBuffer(peerinfo,replybuf,replymsg);
+            if(errorcode == 0)
+            {
+                if(replymsg->header.functionid == SLP_FUNCT_SRVACK)
+                {
+                    errorcode = replymsg->body.srvack.errorcode * - 1;
+                }
+            }
+    
+            SLPMessageFree(replymsg);
+        }
+        else
+        {
+            errorcode = SLP_MEMORY_ALLOC_FAILED;
+        }
+    }
+
+    handle->params.dereg.batchcallback((SLPHandle)handle,
+                                       index,
+                                       errorcode,
+                                       handle->params.dereg.cookie);
+}
+
+
+/*=========================================================================*/
+SLPError SLPAPI SLPDeregBatch(SLPHandle  hSLP,
+                       const SLPRegItem *pItems,
+                       int iCount,
+                       SLPRegBatchReport callback,
+                       void *pvCookie)
+/*                                                                         */
+/* See slplib.h for detailed documentation                                 */
+/*=========================================================================*/
+{
+    PSLPHandleInfo      handle      = 0;
+    SLPError            result      = SLP_OK;
+    SLPSrvURL*          parsedurl   = 0;
+    NetworkPipelineMsg* msgs        = 0;
+    struct sockaddr_in  peeraddr;
+    int                 sock;
+    int                 i;
+    int                 hold        = 0;
+
+    /*------------------------------*/
+    /* check for invalid parameters */
+    /*------------------------------*/
+    if(hSLP        == 0 ||
+       *(unsigned int*)hSLP != SLP_HANDLE_SIG ||
+       pItems      == 0 ||
+       iCount      <= 0 ||
+       callback    == 0)
+    {
+        return SLP_PARAMETER_BAD;
+    }
+
+    handle = (PSLPHandleInfo)hSLP;
+
+    /*----------------------------------------------------*/
+    /* The pipeline needs the calling thread to drive it  */
+    /*----------------------------------------------------*/
+    if(handle->isAsync)
+    {
+        return SLP_NOT_IMPLEMENTED;
+    }
+
+    if(handle->inUse == SLP_TRUE)
+    {
+        return SLP_HANDLE_IN_USE;
+    }
+    handle->inUse = SLP_TRUE;
+
+    /* property values read from here on stay valid until we return */
+    hold = SLPPropertyHold();
+
+    msgs = (NetworkPipelineMsg*)xmalloc(iCount * sizeof(NetworkPipelineMsg));
+    if(msgs == 0)
+    {
+        handle->inUse = SLP_FALSE;
+        SLPPropertyRelease(hold);
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+    memset(msgs,0,iCount * sizeof(NetworkPipelineMsg));
+
+    handle->params.dereg.scopelist     = SLPGetProperty("net.slp.useScopes");
+    handle->params.dereg.scopelistlen  = 0;
+    if(handle->params.dereg.scopelist)
+    {
+        handle->params.dereg.scopelistlen  = strlen(handle->params.dereg.scopelist);
+    }
+    handle->params.dereg.callback      = 0;
+    handle->params.dereg.batchcallback = callback;
+    handle->params.dereg.cookie        = pvCookie;
+
+    /*-------------------------------------------------------------*/
+    /* Build every deregistration up front.  Items that are no     */
+    /* good are reported now and left out of the pipeline          */
+    /*-------------------------------------------------------------*/
+    for(i = 0; i < iCount; i++)
+    {
+        if(pItems[i].s_pcSrvURL == 0 || *pItems[i].s_pcSrvURL == 0)
+        {
+            callback(hSLP,i,SLP_PARAMETER_BAD,pvCookie);
+            continue;
+        }
+
+        RefreshRemove(handle,pItems[i].s_pcSrvURL);
+
+        if(SLPParseSrvURL(pItems[i].s_pcSrvURL,&parsedurl))
+        {
+            if(parsedurl) SLPFree(parsedurl);
+            parsedurl = 0;
+            callback(hSLP,i,SLP_INVALID_REGISTRATION,pvCookie);
+            continue;
+        }
+        SLPFree(parsedurl);
+        parsedurl = 0;
+
+        handle->params.dereg.urllen        = strlen(pItems[i].s_pcSrvURL);
+        handle->params.dereg.url           = pItems[i].s_pcSrvURL;
+
+        result = SrvDeRegBuild(handle,&msgs[i].buf,&msgs[i].bufsize);
+        if(result)
+        {
+            break;
+        }
+    }
+
+    if(result)
+    {
+        /* the items already built or not yet looked at are dropped */
+        for(; i < iCount; i++)
+        {
+            callback(hSLP,i,result,pvCookie);
+        }
+        for(i = 0; i < iCount; i++)
+        {
+            if(msgs[i].buf)
+            {
+                callback(hSLP,i,result,pvCookie);
+            }
+        }
+        goto FINISHED;
+    }
+
+    /*--------------------------*/
+    /* Call the pipeline engine */
+    /*--------------------------*/
+    sock = NetworkConnectToSA(handle,
+                              handle->params.dereg.scopelist,
+                              handle->params.dereg.scopelistlen,
+                              &peeraddr);
+    if(sock >= 0)
+    {
+        result = NetworkPipelineRqstRply(sock,
+                                         &peeraddr,
+                                         handle->langtag,
+                                         SLP_FUNCT_SRVDEREG,
+                                         msgs,
+                                         iCount,
+                                         CallbackSrvDeRegBatch,
+                                         handle);
+        if(result)
+        {
+            NetworkDisconnectSA(handle);
+        }
+    }
+    else
+    {
+        result = SLP_NETWORK_INIT_FAILED;
+        for(i = 0; i < iCount; i++)
+        {
+            if(msgs[i].buf)
+            {
+                callback(hSLP,i,result,pvCookie);
+            }
+        }
+    }
+
+    FINISHED:
+    for(i = 0; i < iCount; i++)
+    {
+        if(msgs[i].buf) xfree(msgs[i].buf);
+    }
+    xfree(msgs);
+    handle->inUse = SLP_FALSE;
+
+    SLPPropertyRelease(hold);
     return result;
 }
@@ -70,11 +70,19 @@ SLPBoolean ProcessAttrRplyCallback(SLPError errorcode,
     securityenabled = SLPPropertyAsBoolean(SLPGetProperty("net.slp.securityEnabled"));
 #endif
 
+    if(AsyncRqstCancelled(handle))
+    {
+        /* SLPClose() was called, the caller hears nothing more */
+        CacheEndRqst(handle,0);
+        return SLP_FALSE;
+    }
+
     /*-------------------------------------------*/
     /* Check the errorcode and bail if it is set */
     /*-------------------------------------------*/
     if(errorcode)
     {
+        CacheEndRqst(handle,errorcode == SLP_LAST_CALL);
         handle->params.findattrs.callback((SLPHandle)handle,
                                           0,
                                           errorcode,
@@ -121,10 +129,15 @@ SLPBoolean ProcessAttrRplyCallback(SLPError errorcode,
                 ((char*)(attrrply->attrlist))[attrrply->attrlistlen] = 0;
                 
                 /* Call the callback function */
+                CacheAddResult(handle,attrrply->attrlist,SLP_LIFETIME_MAXIMUM);
                 result = handle->params.findattrs.callback((SLPHandle)handle,
                                                            attrrply->attrlist,
                                                            attrrply->errorcode * -1,
                                                            handle->params.findattrs.cookie);
+                if(result == SLP_FALSE)
+                {
+                    CacheEndRqst(handle,0);
+                }
             }
         }
         
@@ -139,8 +152,6 @@ SLPBoolean ProcessAttrRplyCallback(SLPError errorcode,
 SLPError ProcessAttrRqst(PSLPHandleInfo handle)
 /*-------------------------------------------------------------------------*/
 {
-    int                 sock;
-    struct sockaddr_in  peeraddr;
     int                 bufsize     = 0;
     char*               buf         = 0;
     char*               curpos      = 0;
@@ -159,6 +170,22 @@ SLPError ProcessAttrRqst(PSLPHandleInfo handle)
     }
 #endif
 
+    /*--------------------------------------------------------*/
+    /* Can we read the answer from slpd's registrations?      */
+    /*--------------------------------------------------------*/
+    if(SnapshotProcessAttrRqst(handle))
+    {
+        goto FINISHED;
+    }
+
+    /*--------------------------------------------------------*/
+    /* Or from the results of an earlier request?             */
+    /*--------------------------------------------------------*/
+    if(CacheProcessAttrRqst(handle))
+    {
+        goto FINISHED;
+    }
+
     /*-------------------------------------------------------------------*/
     /* determine the size of the fixed portion of the ATTRRQST           */
     /*-------------------------------------------------------------------*/
@@ -214,64 +241,29 @@ SLPError ProcessAttrRqst(PSLPHandleInfo handle)
     /*--------------------------*/
     /* Call the RqstRply engine */
     /*--------------------------*/
-    do
+#ifndef UNICAST_NOT_SUPPORTED
+    if(handle->dounicast == 1)
     {
-
-        #ifndef UNICAST_NOT_SUPPORTED
-	if ( handle->dounicast == 1 ) 
-	{
-	    void *cookie = (PSLPHandleInfo) handle;
-	    result = NetworkUcastRqstRply(handle,
-                                          buf,
-                                          SLP_FUNCT_ATTRRQST,
-					  bufsize,
-                                          ProcessAttrRplyCallback,
-					  cookie);
-	    break;
-	}
-	else
-	#endif
-	sock = NetworkConnectToDA(handle,
-                                  handle->params.findattrs.scopelist,
-                                  handle->params.findattrs.scopelistlen,
-                                  &peeraddr);
-        if(sock == -1)
-        {
-            /* use multicast as a last resort */
-            
-            #ifndef MI_NOT_SUPPORTED
-            result = NetworkMcastRqstRply(handle,
-                                          buf,
-                                          SLP_FUNCT_ATTRRQST,
-                                          bufsize,
-                                          ProcessAttrRplyCallback,
-                                          NULL);
-            #else	
-	    result = NetworkMcastRqstRply(handle->langtag,
-                                          buf,
-                                          SLP_FUNCT_ATTRRQST,
-                                          bufsize,
-                                          ProcessAttrRplyCallback,
-                                          handle);
-            #endif /* MI_NOT_SUPPORTED */			
-            break;
-        }
-
-        result = NetworkRqstRply(sock,
-                                 &peeraddr,
-                                 handle->langtag,
-                                 0,
-                                 buf,
-                                 SLP_FUNCT_ATTRRQST,
-                                 bufsize,
-                                 ProcessAttrRplyCallback,
-                                 handle);
-        if(result)
-        {
-            NetworkDisconnectDA(handle);
-        }
-
-    }while(result == SLP_NETWORK_ERROR);
+        result = NetworkUcastRqstRply(handle,
+                                      buf,
+                                      SLP_FUNCT_ATTRRQST,
+                                      bufsize,
+                                      ProcessAttrRplyCallback,
+                                      handle);
+    }
+    else
+#endif
+    {
+        /* the DAs for the scopes and multicast, all at once */
+        result = NetworkMultiRqstRply(handle,
+                                      handle->params.findattrs.scopelist,
+                                      handle->params.findattrs.scopelistlen,
+                                      buf,
+                                      SLP_FUNCT_ATTRRQST,
+                                      bufsize,
+                                      ProcessAttrRplyCallback,
+                                      handle);
+    }
 
 
     FINISHED:
@@ -285,15 +277,13 @@ SLPError ProcessAttrRqst(PSLPHandleInfo handle)
 
 #ifdef ENABLE_ASYNC_API
 /*-------------------------------------------------------------------------*/ 
-SLPError AsyncProcessAttrRqst(PSLPHandleInfo handle)
+void AsyncAttrRqstDone(PSLPHandleInfo handle)
 /*-------------------------------------------------------------------------*/
 {
-    SLPError result = ProcessAttrRqst(handle);
     xfree((void*)handle->params.findattrs.url);
     xfree((void*)handle->params.findattrs.scopelist);
     xfree((void*)handle->params.findattrs.taglist);
     handle->inUse = SLP_FALSE;
-    return result;
 }
 #endif
 
@@ -348,6 +338,7 @@ SLPError SLPAPI SLPFindAttrs(SLPHandle   hSLP,
 {
     PSLPHandleInfo      handle;
     SLPError            result;
+    int                 hold;
 
     /*------------------------------*/
     /* check for invalid parameters */
@@ -375,6 +366,9 @@ SLPError SLPAPI SLPFindAttrs(SLPHandle   hSLP,
     }
     handle->inUse = SLP_TRUE;
 
+    /* property values read from here on stay valid until we return */
+    hold = SLPPropertyHold();
+
 
     /*-------------------------------------------*/
     /* Set the handle up to reference parameters */
@@ -421,7 +415,7 @@ SLPError SLPAPI SLPFindAttrs(SLPHandle   hSLP,
            handle->params.findattrs.scopelist &&
            handle->params.findattrs.taglist)
         {
-            result = ThreadCreate((ThreadStartProc)AsyncProcessAttrRqst,handle);
+            result = AsyncRqstStart(handle,ProcessAttrRqst,AsyncAttrRqstDone);
         }
         else
         {
@@ -446,6 +440,7 @@ SLPError SLPAPI SLPFindAttrs(SLPHandle   hSLP,
         handle->inUse = SLP_FALSE;
     }
 
+    SLPPropertyRelease(hold);
     return result;
 }
 
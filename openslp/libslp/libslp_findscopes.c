@@ -74,6 +74,8 @@ SLPError SLPAPI SLPFindScopes(SLPHandle hSLP,
 /*=========================================================================*/
 {
     int scopelistlen;
+    int hold;
+    int result;
 
     /*------------------------------*/
     /* check for invalid parameters */
@@ -89,11 +91,15 @@ SLPError SLPAPI SLPFindScopes(SLPHandle hSLP,
     *ppcScopeList = 0;
 
 
+    /* property values read from here on stay valid until we return */
+    hold = SLPPropertyHold();
 #ifndef MI_NOT_SUPPORTED
-    if(KnownDAGetScopes(&scopelistlen,ppcScopeList, hSLP))
+    result = KnownDAGetScopes(&scopelistlen,ppcScopeList, hSLP);
 #else
-    if(KnownDAGetScopes(&scopelistlen,ppcScopeList))
+    result = KnownDAGetScopes(&scopelistlen,ppcScopeList);
 #endif /* MI_NOT_SUPPORTED */
+    SLPPropertyRelease(hold);
+    if(result)
     {
         return SLP_MEMORY_ALLOC_FAILED;
     }
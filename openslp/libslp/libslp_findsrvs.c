@@ -57,29 +57,26 @@ SLPBoolean ColateSLPSrvURLCallback(SLPHandle hSLP,
                                    void *pvCookie)
 /*-------------------------------------------------------------------------*/
 {
-    SLPSrvUrlColatedItem*   collateditem;
+    SLPCollatedItem*        collateditem;
     PSLPHandleInfo          handle;
         
     handle = (PSLPHandleInfo) hSLP;
     handle->callbackcount ++;
-    
-#ifdef ENABLE_ASYNC_API
-    /* Do not colate for async calls */
-    if(handle->isAsync)
+
+    if(AsyncRqstCancelled(handle))
     {
-        return handle->params.findsrvs.callback(hSLP,
-                                                pcSrvURL,
-                                                sLifetime,
-                                                errCode,
-                                                pvCookie);
+        /* SLPClose() was called, the caller hears nothing more */
+        goto CLEANUP;
     }
-#endif
-    
+        
     if(errCode == SLP_LAST_CALL || 
        handle->callbackcount > SLPPropertyAsInteger(SLPGetProperty("net.slp.maxResults")))
     {
         /* We are done so call the caller's callback for each      */
         /* service URL colated item and clean up the colation list */
+        /* Results cut short by maxResults are not all there are,  */
+        /* they are only cached when the request ran its course    */
+        CacheEndRqst(handle,errCode == SLP_LAST_CALL);
         handle->params.findsrvs.callback((SLPHandle)handle,
                                          NULL,
                                          0,
@@ -92,55 +89,34 @@ SLPBoolean ColateSLPSrvURLCallback(SLPHandle hSLP,
         return SLP_TRUE;
     }
 
-    /* Add the service URL to the colation list */
-    collateditem = (SLPSrvUrlColatedItem*) handle->collatedsrvurls.head;
-    while(collateditem)
-    {
-        if(strcmp(collateditem->srvurl,pcSrvURL) == 0)
-        {
-            break;
-        }
-        collateditem = (SLPSrvUrlColatedItem*)collateditem->listitem.next;
-    }
-                                     
-    /* create a new item if none was found */
-    if(collateditem == NULL)
+    /* Add the service URL to the colation, the caller only hears of */
+    /* the ones that are new                                         */
+    collateditem = SLPCollationAdd(&(handle->collation),
+                                   0,
+                                   strlen(pcSrvURL),
+                                   pcSrvURL);
+    if(collateditem)
     {
-        collateditem = (SLPSrvUrlColatedItem*) xmalloc(sizeof(SLPSrvUrlColatedItem) + \
-                                                       strlen(pcSrvURL) + 1);
-        if(collateditem)
+        collateditem->lifetime = sLifetime;
+        CacheAddResult(handle,pcSrvURL,sLifetime);
+
+        /* Call the caller's callback */
+        if(handle->params.findsrvs.callback((SLPHandle)handle,
+                                            pcSrvURL,
+                                            sLifetime,
+                                            SLP_OK,
+                                            handle->params.findsrvs.cookie) == SLP_FALSE)
         {
-            memset(collateditem,0,sizeof(SLPSrvUrlColatedItem));
-            collateditem->srvurl = (char*)(collateditem + 1);
-            strcpy(collateditem->srvurl,pcSrvURL);
-            collateditem->lifetime = sLifetime;
-
-            /* Add the new item to the collated list */
-            SLPListLinkTail(&(handle->collatedsrvurls),
-                            (SLPListItem*)collateditem);
-
-            /* Call the caller's callback */
-            if(handle->params.findsrvs.callback((SLPHandle)handle,
-                                                pcSrvURL,
-                                                sLifetime,
-                                                SLP_OK,
-                                                handle->params.findsrvs.cookie) == SLP_FALSE)
-            {
-                goto CLEANUP;
-            }
+            goto CLEANUP;
         }
     }
     
     return SLP_TRUE;
 
 CLEANUP:
-    /* free the collation list */
-    while(handle->collatedsrvurls.count)
-    {
-        collateditem = (SLPSrvUrlColatedItem*)SLPListUnlink(&(handle->collatedsrvurls),
-                                                            handle->collatedsrvurls.head);
-        xfree(collateditem);
-    }   
+    /* free the colation */
+    SLPCollationFree(&(handle->collation));
+    CacheEndRqst(handle,0);
     handle->callbackcount = 0;
 
     return SLP_FALSE;
@@ -188,6 +164,10 @@ SLPBoolean ProcessSrvRplyCallback(SLPError errorcode,
                replymsg->body.srvrply.errorcode == 0)
             {
                 urlentry = replymsg->body.srvrply.urlarray;
+
+                /* size the colation for this reply up front */
+                SLPCollationReserve(&(handle->collation),
+                                    replymsg->body.srvrply.urlcount);
             
                 for(i=0;i<replymsg->body.srvrply.urlcount;i++)
                 {
@@ -280,8 +260,6 @@ SLPBoolean ProcessSrvRplyCallback(SLPError errorcode,
 SLPError ProcessSrvRqst(PSLPHandleInfo handle)
 /*-------------------------------------------------------------------------*/
 {
-    struct sockaddr_in  peeraddr;
-    int                 sock        = -1;
     int                 bufsize     = 0;
     char*               buf         = 0;
     char*               curpos      = 0;
@@ -295,7 +273,8 @@ SLPError ProcessSrvRqst(PSLPHandleInfo handle)
     /*------------------------------------------*/
     /* Is this a special attempt to locate DAs? */
     /*------------------------------------------*/
-    if(strncasecmp(handle->params.findsrvs.srvtype,
+    if(handle->params.findsrvs.srvtypelen == strlen(SLP_DA_SERVICE_TYPE) &&
+       strncasecmp(handle->params.findsrvs.srvtype,
                    SLP_DA_SERVICE_TYPE,
                    handle->params.findsrvs.srvtypelen) == 0)
     {
@@ -303,6 +282,22 @@ SLPError ProcessSrvRqst(PSLPHandleInfo handle)
         goto FINISHED;
     }
 
+    /*--------------------------------------------------------*/
+    /* Can we read the answer from slpd's registrations?      */
+    /*--------------------------------------------------------*/
+    if(SnapshotProcessSrvRqst(handle))
+    {
+        goto FINISHED;
+    }
+
+    /*--------------------------------------------------------*/
+    /* Or from the results of an earlier request?             */
+    /*--------------------------------------------------------*/
+    if(CacheProcessSrvRqst(handle))
+    {
+        goto FINISHED;
+    }
+
 #ifdef ENABLE_SLPv2_SECURITY
     if(SLPPropertyAsBoolean(SLPGetProperty("net.slp.securityEnabled")))
     {
@@ -367,69 +362,52 @@ SLPError ProcessSrvRqst(PSLPHandleInfo handle)
     /*--------------------------*/
     /* Call the RqstRply engine */
     /*--------------------------*/
-    do
+#ifndef UNICAST_NOT_SUPPORTED
+    if(handle->dounicast == 1)
     {
-
-        #ifndef UNICAST_NOT_SUPPORTED
-	if ( handle->dounicast == 1 ) 
-	{
-	    void *cookie = (PSLPHandleInfo) handle;
-	    result = NetworkUcastRqstRply(handle,
-                                          buf,
-                                          SLP_FUNCT_SRVRQST,
-					  bufsize,
-					  ProcessSrvRplyCallback,
-                                          cookie);
-            break;
-	}
-	else
-	#endif
-	if(strncasecmp(handle->params.findsrvs.srvtype,
-                       SLP_SA_SERVICE_TYPE,
-                       handle->params.findsrvs.srvtypelen))
-        {
-            sock = NetworkConnectToDA(handle,
+        result = NetworkUcastRqstRply(handle,
+                                      buf,
+                                      SLP_FUNCT_SRVRQST,
+                                      bufsize,
+                                      ProcessSrvRplyCallback,
+                                      handle);
+    }
+    else
+#endif
+    if(handle->params.findsrvs.srvtypelen == strlen(SLP_SA_SERVICE_TYPE) &&
+       strncasecmp(handle->params.findsrvs.srvtype,
+                   SLP_SA_SERVICE_TYPE,
+                   handle->params.findsrvs.srvtypelen) == 0)
+    {
+        /* SAs are found by multicast, DAs do not know them */
+#ifndef MI_NOT_SUPPORTED
+        result = NetworkMcastRqstRply(handle,
+                                      buf,
+                                      SLP_FUNCT_SRVRQST,
+                                      bufsize,
+                                      ProcessSrvRplyCallback,
+                                      NULL);
+#else
+        result = NetworkMcastRqstRply(handle->langtag,
+                                      buf,
+                                      SLP_FUNCT_SRVRQST,
+                                      bufsize,
+                                      ProcessSrvRplyCallback,
+                                      handle);
+#endif /* MI_NOT_SUPPORTED */
+    }
+    else
+    {
+        /* the DAs for the scopes and multicast, all at once */
+        result = NetworkMultiRqstRply(handle,
                                       handle->params.findsrvs.scopelist,
                                       handle->params.findsrvs.scopelistlen,
-                                      &peeraddr);
-        }
-
-        if(sock == -1)
-        {
-            /* use multicast as a last resort */
-            #ifndef MI_NOT_SUPPORTED
-	    result = NetworkMcastRqstRply(handle,
-					  buf,
-					  SLP_FUNCT_SRVRQST,
-					  bufsize,
-					  ProcessSrvRplyCallback,
-					  NULL);
-	    #else		
-	    result = NetworkMcastRqstRply(handle->langtag,
-                                          buf,
-                                          SLP_FUNCT_SRVRQST,
-                                          bufsize,
-                                          ProcessSrvRplyCallback,
-                                          handle);
-            #endif /* MI_NOT_SUPPORTED */
-	    break;
-        }
-
-        result = NetworkRqstRply(sock,
-                                 &peeraddr,
-                                 handle->langtag,
-                                 0,
-                                 buf,
-                                 SLP_FUNCT_SRVRQST,
-                                 bufsize,
-                                 ProcessSrvRplyCallback,
-                                 handle);
-        if(result)
-        {
-            NetworkDisconnectDA(handle);
-        }
-
-    }while(result == SLP_NETWORK_ERROR);
+                                      buf,
+                                      SLP_FUNCT_SRVRQST,
+                                      bufsize,
+                                      ProcessSrvRplyCallback,
+                                      handle);
+    }
 
     FINISHED:
     if(buf) xfree(buf);
@@ -443,15 +421,13 @@ SLPError ProcessSrvRqst(PSLPHandleInfo handle)
 
 #ifdef ENABLE_ASYNC_API
 /*-------------------------------------------------------------------------*/ 
-SLPError AsyncProcessSrvRqst(PSLPHandleInfo handle)
+void AsyncSrvRqstDone(PSLPHandleInfo handle)
 /*-------------------------------------------------------------------------*/
 {
-    SLPError result = ProcessSrvRqst(handle);
     xfree((void*)handle->params.findsrvs.srvtype);
     xfree((void*)handle->params.findsrvs.scopelist);
     xfree((void*)handle->params.findsrvs.predicate);
     handle->inUse = SLP_FALSE;
-    return result;
 }
 #endif
 
@@ -502,6 +478,7 @@ SLPError SLPAPI SLPFindSrvs(SLPHandle  hSLP,
 {
     PSLPHandleInfo      handle;
     SLPError            result;
+    int                 hold;
 
     /*------------------------------*/
     /* check for invalid parameters */
@@ -530,6 +507,9 @@ SLPError SLPAPI SLPFindSrvs(SLPHandle  hSLP,
     }
     handle->inUse = SLP_TRUE;
 
+    /* property values read from here on stay valid until we return */
+    hold = SLPPropertyHold();
+
 
     /*-------------------------------------------*/
     /* Set the handle up to reference parameters */
@@ -577,7 +557,7 @@ SLPError SLPAPI SLPFindSrvs(SLPHandle  hSLP,
            handle->params.findsrvs.scopelist &&
            handle->params.findsrvs.predicate)
         {
-            result = ThreadCreate((ThreadStartProc)AsyncProcessSrvRqst,handle);
+            result = AsyncRqstStart(handle,ProcessSrvRqst,AsyncSrvRqstDone);
         }
         else
         {
@@ -602,6 +582,7 @@ SLPError SLPAPI SLPFindSrvs(SLPHandle  hSLP,
         handle->inUse = SLP_FALSE;
     }
 
+    SLPPropertyRelease(hold);
     return result;
 }
 
@@ -56,50 +56,68 @@ SLPBoolean ColateSrvTypeCallback(SLPHandle hSLP,
 /*----------------------------------------------------------------------------*/
 {
     PSLPHandleInfo          handle;
+    SLPCollatedItem*        collateditem;
     SLPBoolean              result;
-    int		                srvtypeslen;
     char*                   srvtypes;
+    char*                   curpos;
+    const char*             itembegin;
+    const char*             itemend;
+    const char*             listend;
+    int                     count;
     
     handle = (PSLPHandleInfo) hSLP;
     handle->callbackcount ++;
 
-#ifdef ENABLE_ASYNC_API
-    /* Do not colate for async calls */
-    if(handle->isAsync)
+    if(AsyncRqstCancelled(handle))
     {
-        return handle->params.findsrvtypes.callback(hSLP,
-                                                    pcSrvTypes,
-                                                    errCode,
-                                                    pvCookie);
+        /* SLPClose() was called, the caller hears nothing more */
+        SLPCollationFree(&(handle->collation));
+        handle->callbackcount = 0;
+        return SLP_FALSE;
     }
-#endif
 
     if(errCode == SLP_LAST_CALL || 
        handle->callbackcount > SLPPropertyAsInteger(SLPGetProperty("net.slp.maxResults")))
     {
         /* We're done.  Send back the colated srvtype string */
         result = SLP_TRUE;
-        if(handle->collatedsrvtypes)
+        if(handle->collation.count)
         {
-            result = handle->params.findsrvtypes.callback((SLPHandle)handle,
-                                                          handle->collatedsrvtypes,
-                                                          SLP_OK,
-                                                          handle->params.findsrvtypes.cookie);
-            if(result == SLP_TRUE)
+            /* join the service types in the order they came in */
+            srvtypes = xmalloc(handle->collation.totallen + handle->collation.count);
+            if(srvtypes)
             {
-                handle->params.findsrvtypes.callback((SLPHandle)handle,
-                                                     NULL,
-                                                     SLP_LAST_CALL,
-                                                     handle->params.findsrvtypes.cookie);
+                curpos = srvtypes;
+                for(collateditem = handle->collation.first;
+                    collateditem;
+                    collateditem = collateditem->next)
+                {
+                    if(curpos != srvtypes)
+                    {
+                        *curpos++ = ',';
+                    }
+                    memcpy(curpos,collateditem->str,collateditem->len);
+                    curpos += collateditem->len;
+                }
+                *curpos = 0;
+
+                result = handle->params.findsrvtypes.callback((SLPHandle)handle,
+                                                              srvtypes,
+                                                              SLP_OK,
+                                                              handle->params.findsrvtypes.cookie);
+                if(result == SLP_TRUE && AsyncRqstCancelled(handle) == 0)
+                {
+                    handle->params.findsrvtypes.callback((SLPHandle)handle,
+                                                         NULL,
+                                                         SLP_LAST_CALL,
+                                                         handle->params.findsrvtypes.cookie);
+                }
+                xfree(srvtypes);
             }
         }
         
-        /* Free the colatedsrvtype string */
-        if(handle->collatedsrvtypes)
-        {
-            xfree(handle->collatedsrvtypes);
-            handle->collatedsrvtypes = NULL;
-        }
+        /* Free the colation */
+        SLPCollationFree(&(handle->collation));
 
         handle->callbackcount = 0;
         
@@ -110,44 +128,35 @@ SLPBoolean ColateSrvTypeCallback(SLPHandle hSLP,
         return SLP_TRUE;
     }
 
-    /* Add the service types to the colation */
-    srvtypeslen = strlen(pcSrvTypes) + 1; /* +1 - terminator */
-    if(handle->collatedsrvtypes)
+    /* Add the service types to the colation, size it for all of them */
+    /* first                                                          */
+    listend = pcSrvTypes + strlen(pcSrvTypes);
+    count = 1;
+    for(itembegin = pcSrvTypes; itembegin < listend; itembegin++)
     {
-        srvtypeslen += strlen(handle->collatedsrvtypes) + 1; /* +1 - comma */
+        if(*itembegin == ',')
+        {
+            count++;
+        }
     }
-    
-    srvtypes = xmalloc(srvtypeslen);
-    if(srvtypes)
+    SLPCollationReserve(&(handle->collation),count);
+
+    itembegin = pcSrvTypes;
+    while(itembegin < listend)
     {
-        if(handle->collatedsrvtypes)
+        itemend = memchr(itembegin,',',listend - itembegin);
+        if(itemend == 0)
         {
-            if(SLPUnionStringList(strlen(handle->collatedsrvtypes),
-                                  handle->collatedsrvtypes,
-                                  strlen(pcSrvTypes),
-                                  pcSrvTypes,
-                                  &srvtypeslen,
-                                  srvtypes) != srvtypeslen)
-            {
-                xfree(handle->collatedsrvtypes);
-                handle->collatedsrvtypes = srvtypes;
-            }
-            else
-            {
-                #ifndef COLLATION_CHANGES
-                xfree(handle->collatedsrvtypes);
-                handle->collatedsrvtypes = srvtypes;
-                handle->collatedsrvtypes[srvtypeslen] = '\0';
-                #else
-                xfree(srvtypes);
-                #endif /* COLLATION_CHANGES */
-            }   
+            itemend = listend;
         }
-        else
+        if(itemend > itembegin)
         {
-            strcpy(srvtypes,pcSrvTypes);
-            handle->collatedsrvtypes = srvtypes;
+            SLPCollationAdd(&(handle->collation),
+                            1,
+                            itemend - itembegin,
+                            itembegin);
         }
+        itembegin = itemend + 1;
     }
 
     return SLP_TRUE;
@@ -216,8 +225,6 @@ SLPBoolean ProcessSrvTypeRplyCallback(SLPError errorcode,
 SLPError ProcessSrvTypeRqst(PSLPHandleInfo handle)
 /*-------------------------------------------------------------------------*/
 {
-    int                 sock;
-    struct sockaddr_in  peeraddr;
     int                 bufsize     = 0;
     char*               buf         = 0;
     char*               curpos      = 0;
@@ -268,62 +275,29 @@ SLPError ProcessSrvTypeRqst(PSLPHandleInfo handle)
     /*--------------------------*/
     /* Call the RqstRply engine */
     /*--------------------------*/
-    do
+#ifndef UNICAST_NOT_SUPPORTED
+    if(handle->dounicast == 1)
     {
-        #ifndef UNICAST_NOT_SUPPORTED
-        if ( handle->dounicast == 1 ) 
-	{
-            void *cookie = (PSLPHandleInfo) handle;
-	    result = NetworkUcastRqstRply(handle,
-                                          buf,
-                                          SLP_FUNCT_SRVTYPERQST,
-                                          bufsize,
-					  ProcessSrvTypeRplyCallback,
-					  cookie);
-	    break;
-        }
-	else
-	#endif
-	sock = NetworkConnectToDA(handle,
-                                  handle->params.findsrvtypes.scopelist,
-                                  handle->params.findsrvtypes.scopelistlen,
-                                  &peeraddr);
-        if(sock == -1)
-        {
-            /* use multicast as a last resort */
-            #ifndef MI_NOT_SUPPORTED
-            result = NetworkMcastRqstRply(handle,
-                                          buf,
-					  SLP_FUNCT_SRVTYPERQST,
-					  bufsize,
-                                          ProcessSrvTypeRplyCallback,
-					  NULL);
-            #else
-            result = NetworkMcastRqstRply(handle->langtag,
-                                          buf,
-                                          SLP_FUNCT_SRVTYPERQST,
-                                          bufsize,
-                                          ProcessSrvTypeRplyCallback,
-                                          handle);
-            #endif /* MI_NOT_SUPPORTED */
-            break;
-        }
-
-        result = NetworkRqstRply(sock,
-                                 &peeraddr,
-                                 handle->langtag,
-                                 0,
-                                 buf,
-                                 SLP_FUNCT_SRVTYPERQST,
-                                 bufsize,
-                                 ProcessSrvTypeRplyCallback,
-                                 handle);
-        if(result)
-        {
-            NetworkDisconnectDA(handle);
-        }
-
-    }while(result == SLP_NETWORK_ERROR);
+        result = NetworkUcastRqstRply(handle,
+                                      buf,
+                                      SLP_FUNCT_SRVTYPERQST,
+                                      bufsize,
+                                      ProcessSrvTypeRplyCallback,
+                                      handle);
+    }
+    else
+#endif
+    {
+        /* the DAs for the scopes and multicast, all at once */
+        result = NetworkMultiRqstRply(handle,
+                                      handle->params.findsrvtypes.scopelist,
+                                      handle->params.findsrvtypes.scopelistlen,
+                                      buf,
+                                      SLP_FUNCT_SRVTYPERQST,
+                                      bufsize,
+                                      ProcessSrvTypeRplyCallback,
+                                      handle);
+    }
 
 
     FINISHED:
@@ -334,14 +308,12 @@ SLPError ProcessSrvTypeRqst(PSLPHandleInfo handle)
 
 #ifdef ENABLE_ASYNC_API
 /*-------------------------------------------------------------------------*/ 
-SLPError AsyncProcessSrvTypeRqst(PSLPHandleInfo handle)
+void AsyncSrvTypeRqstDone(PSLPHandleInfo handle)
 /*-------------------------------------------------------------------------*/
 {
-    SLPError result = ProcessSrvTypeRqst(handle);
     xfree((void*)handle->params.findsrvtypes.namingauth);
     xfree((void*)handle->params.findsrvtypes.scopelist);
     handle->inUse = SLP_FALSE;
-    return result;
 }
 #endif
 
@@ -380,6 +352,7 @@ SLPError SLPAPI SLPFindSrvTypes(SLPHandle    hSLP,
 {
     PSLPHandleInfo      handle;
     SLPError            result;
+    int                 hold;
 
     /*------------------------------*/
     /* check for invalid parameters */
@@ -407,6 +380,9 @@ SLPError SLPAPI SLPFindSrvTypes(SLPHandle    hSLP,
     }
     handle->inUse = SLP_TRUE;
 
+    /* property values read from here on stay valid until we return */
+    hold = SLPPropertyHold();
+
     /*-------------------------------------------*/
     /* Set the handle up to reference parameters */
     /*-------------------------------------------*/
@@ -440,7 +416,7 @@ SLPError SLPAPI SLPFindSrvTypes(SLPHandle    hSLP,
         if(handle->params.findsrvtypes.namingauth &&
            handle->params.findsrvtypes.scopelist)
         {
-            result = ThreadCreate((ThreadStartProc)AsyncProcessSrvTypeRqst,handle);
+            result = AsyncRqstStart(handle,ProcessSrvTypeRqst,AsyncSrvTypeRqstDone);
         }
         else
         {
@@ -464,6 +440,7 @@ SLPError SLPAPI SLPFindSrvTypes(SLPHandle    hSLP,
         handle->inUse = SLP_FALSE;
     }
 
+    SLPPropertyRelease(hold);
     return result;
 }
 
@@ -54,6 +54,19 @@ int G_OpenSLPHandleCount = 0;
 /* Global variable that keeps track of the number of handles that are open */
 /*=========================================================================*/
 
+#ifdef LIBSLP_THREADS
+/*=========================================================================*/
+static pthread_mutex_t G_OpenSLPHandleLock = PTHREAD_MUTEX_INITIALIZER;
+/* Guards G_OpenSLPHandleCount and what the first and last handle set up   */
+/* and free.  Handles themselves are never shared between threads          */
+/*=========================================================================*/
+#define HandleLock()    pthread_mutex_lock(&G_OpenSLPHandleLock)
+#define HandleUnlock()  pthread_mutex_unlock(&G_OpenSLPHandleLock)
+#else
+#define HandleLock()
+#define HandleUnlock()
+#endif
+
 
 /*=========================================================================*/
 SLPError SLPAPI SLPOpen(const char *pcLang, SLPBoolean isAsync, SLPHandle *phSLP)
@@ -95,6 +108,8 @@ SLPError SLPAPI SLPOpen(const char *pcLang, SLPBoolean isAsync, SLPHandle *phSLP
 {
     SLPError        result = SLP_OK;
     PSLPHandleInfo  handle = 0;
+    const char*     locale;
+    int             hold;
 
     /*------------------------------*/
     /* check for invalid parameters */
@@ -109,16 +124,8 @@ SLPError SLPAPI SLPOpen(const char *pcLang, SLPBoolean isAsync, SLPHandle *phSLP
     *phSLP = 0;
 
 
-#ifndef ENABLE_ASYNC_API   
-    if(isAsync == SLP_TRUE)
-    {
-        result =  SLP_NOT_IMPLEMENTED;
-        goto FINISHED;
-    }
-/*-------------------------------------------------------*/
-/* TODO: remove the #else when we implement async calls  */
-/*-------------------------------------------------------*/
-#else
+#if !defined(ENABLE_ASYNC_API) || defined(_WIN32)
+    /* async calls need the I/O thread in libslp_thread.c */
     if(isAsync == SLP_TRUE)
     {
         result =  SLP_NOT_IMPLEMENTED;
@@ -154,20 +161,28 @@ SLPError SLPAPI SLPOpen(const char *pcLang, SLPBoolean isAsync, SLPHandle *phSLP
     }
     else
     {
-        handle->langtaglen = strlen(SLPGetProperty("net.slp.locale"));
+        /* the locale may be set meanwhile, copy the one we measured */
+        hold = SLPPropertyHold();
+        locale = SLPGetProperty("net.slp.locale");
+        handle->langtaglen = strlen(locale);
         handle->langtag = (char*)xmalloc(handle->langtaglen + 1);
+        if(handle->langtag)
+        {
+            memcpy(handle->langtag,locale,handle->langtaglen + 1);
+        }
+        SLPPropertyRelease(hold);
         if(handle->langtag == 0)
         {
             xfree(handle);
             result =  SLP_PARAMETER_BAD;
             goto FINISHED;
         }
-        memcpy(handle->langtag,SLPGetProperty("net.slp.locale"),handle->langtaglen + 1);       
     }
 
     /*---------------------------------------------------------*/
     /* Seed the XID generator if this is the first open handle */
     /*---------------------------------------------------------*/
+    HandleLock();
     if(G_OpenSLPHandleCount == 0)
     {
 #ifdef _WIN32
@@ -175,6 +190,7 @@ SLPError SLPAPI SLPOpen(const char *pcLang, SLPBoolean isAsync, SLPHandle *phSLP
         WORD    wVersionRequested = MAKEWORD(1,1); 
         if(0 != WSAStartup(wVersionRequested, &wsaData))
         {
+            HandleUnlock();
             result = SLP_NETWORK_INIT_FAILED;
             goto FINISHED;
         }
@@ -186,6 +202,8 @@ SLPError SLPAPI SLPOpen(const char *pcLang, SLPBoolean isAsync, SLPHandle *phSLP
         
         SLPXidSeed();
     }
+    G_OpenSLPHandleCount ++;  
+    HandleUnlock();
 
 #ifdef ENABLE_SLPv2_SECURITY
     handle->hspi = SLPSpiOpen(LIBSLP_SPIFILE,0);
@@ -199,8 +217,6 @@ SLPError SLPAPI SLPOpen(const char *pcLang, SLPBoolean isAsync, SLPHandle *phSLP
 #ifndef UNICAST_NOT_SUPPORTED
     handle->unicastsock = -1;
 #endif
-		
-    G_OpenSLPHandleCount ++;  
 
     *phSLP = (SLPHandle)handle; 
 
@@ -227,6 +243,7 @@ void SLPAPI SLPClose(SLPHandle hSLP)
 /*=========================================================================*/
 {
     PSLPHandleInfo   handle;
+    int              hold;
 
     /*------------------------------*/
     /* check for invalid parameters */
@@ -238,24 +255,34 @@ void SLPAPI SLPClose(SLPHandle hSLP)
 
     handle = (PSLPHandleInfo)hSLP;
 
+#ifdef ENABLE_ASYNC_API
     if(handle->isAsync)
     {
-        /* TODO: stop the usage of this handle (kill threads, etc) */
+        /* stop the outstanding call before the handle goes away */
+        if(AsyncRqstClose(handle))
+        {
+            /* called from a callback, the I/O thread closes it later */
+            return;
+        }
     }
+#endif
+
+    /* what was registered through the handle is left to expire */
+    RefreshForget(handle);
+
+    /* results of a call closed before its SLP_LAST_CALL */
+    SLPCollationFree(&(handle->collation));
+    CacheEndRqst(handle,0);
 
     if(handle->langtag)
     {
         xfree(handle->langtag);
     }
 
-    if(handle->dasock >=0)
-    {
-#ifdef _WIN32
-        closesocket(handle->dasock);
-#else
-        close(handle->dasock);
-#endif
-    }
+    /* the next handle may use the DA connection */
+    hold = SLPPropertyHold();
+    KnownDAPoolPut(handle->dasock,&(handle->daaddr.sin_addr));
+    SLPPropertyRelease(hold);
 
     if(handle->dascope)
     {
@@ -284,6 +311,8 @@ void SLPAPI SLPClose(SLPHandle hSLP)
 
     xfree(hSLP);
 
+    HandleLock();
+
     G_OpenSLPHandleCount --;
     
 
@@ -296,11 +325,14 @@ void SLPAPI SLPClose(SLPHandle hSLP)
         SLPPropertyFreeAll();
         
         KnownDAFreeAll();
+
+        CacheFreeAll();
         
         xmalloc_deinit();
     }
 #endif
 
+    HandleUnlock();
 }
 
 
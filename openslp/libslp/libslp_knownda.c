@@ -63,69 +63,861 @@
 
 /*=========================================================================*/
 SLPDatabase G_KnownDACache ={0,0,0};
-/* The cache DAAdvert messages from known DAs.                             */
+/* The cache DAAdvert messages from known DAs.  Only changed and read with */
+/* G_KnownDALock held, other readers use G_KnownDASnapshot                 */
 /*=========================================================================*/
 
 /*=========================================================================*/
 int   G_KnownDAScopesLen = 0;
 char* G_KnownDAScopes   = 0;
-/* Cached known scope list                                                 */
+/* Cached known scope list, guarded by G_KnownDALock                       */
 /*=========================================================================*/
 
 
 /*=========================================================================*/
 time_t G_KnownDALastCacheRefresh = 0;
-/* The time of the last Multicast for known DAs                            */
+/* The time of the last Multicast for known DAs, guarded by                */
+/* G_KnownDADiscoverLock                                                   */
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+typedef struct _SLPKnownDA
+/* What readers need to know about a DA, its strings null terminated       */
+/*=========================================================================*/
+{
+    struct in_addr  addr;
+    int             urllen;
+    const char*     url;
+    int             scopelistlen;
+    const char*     scopelist;
+    int             spilistlen;
+    const char*     spilist;
+}SLPKnownDA;
+
+/*=========================================================================*/
+typedef struct _SLPKnownDASnapshot
+/* A copy of G_KnownDACache that never changes.  The strings follow the    */
+/* array in the same allocation                                            */
+/*=========================================================================*/
+{
+    int             refcount;   /* the published reference and readers'   */
+    int             count;
+    SLPKnownDA      das[1];
+}SLPKnownDASnapshot;
+
+/* G_KnownDASnapshot is replaced whenever G_KnownDACache changes, so DAs   */
+/* are looked up without a lock.  A reader registers in G_KnownDAReaders   */
+/* for the current G_KnownDAEpoch just long enough to take a reference;    */
+/* the writer flips the epoch and waits for the readers of the old one     */
+/* before it drops the published reference of the old snapshot             */
+#ifdef LIBSLP_THREADS
+static pthread_mutex_t  G_KnownDALock       = PTHREAD_MUTEX_INITIALIZER;
+#define KnownDALock()       pthread_mutex_lock(&G_KnownDALock)
+#define KnownDAUnlock()     pthread_mutex_unlock(&G_KnownDALock)
+#else
+#define KnownDALock()
+#define KnownDAUnlock()
+#endif
+static SLPKnownDASnapshot* volatile G_KnownDASnapshot   = 0;
+static volatile int     G_KnownDAEpoch      = 0;
+static volatile int     G_KnownDAReaders[2] = {0, 0};
+
+/* G_KnownDADiscoverLock lets one thread at a time discover DAs.  Threads  */
+/* that waited for it skip their own discovery if G_KnownDADiscoveries     */
+/* shows that one finished meanwhile                                       */
+#ifdef LIBSLP_THREADS
+static pthread_mutex_t  G_KnownDADiscoverLock = PTHREAD_MUTEX_INITIALIZER;
+#define KnownDADiscoverLock()   pthread_mutex_lock(&G_KnownDADiscoverLock)
+#define KnownDADiscoverTryLock() pthread_mutex_trylock(&G_KnownDADiscoverLock)
+#define KnownDADiscoverUnlock() pthread_mutex_unlock(&G_KnownDADiscoverLock)
+#else
+#define KnownDADiscoverLock()
+#define KnownDADiscoverTryLock() 0
+#define KnownDADiscoverUnlock()
+#endif
+static volatile int     G_KnownDADiscoveries = 0;
+
+
+/*-------------------------------------------------------------------------*/
+static SLPKnownDASnapshot* KnownDASnapshotGet()
+/* Takes a reference to the current snapshot                               */
+/*                                                                         */
+/* Returns: the snapshot, or NULL if there is none.  Release it with       */
+/*          KnownDASnapshotPut()                                           */
+/*-------------------------------------------------------------------------*/
+{
+    SLPKnownDASnapshot* snapshot;
+    int                 epoch;
+
+    while(1)
+    {
+        epoch = SLPAtomicLoad(&G_KnownDAEpoch) & 1;
+        SLPAtomicAdd(&G_KnownDAReaders[epoch],1);
+        if((SLPAtomicLoad(&G_KnownDAEpoch) & 1) == epoch)
+        {
+            break;
+        }
+        /* the writer flipped the epoch under us */
+        SLPAtomicAdd(&G_KnownDAReaders[epoch],-1);
+    }
+
+    snapshot = SLPAtomicLoad(&G_KnownDASnapshot);
+    if(snapshot)
+    {
+        SLPAtomicAdd(&snapshot->refcount,1);
+    }
+
+    SLPAtomicAdd(&G_KnownDAReaders[epoch],-1);
+
+    return snapshot;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDASnapshotPut(SLPKnownDASnapshot* snapshot)
+/* Drops a reference to a snapshot, freeing it with the last one           */
+/*-------------------------------------------------------------------------*/
+{
+    if(snapshot && SLPAtomicAdd(&snapshot->refcount,-1) == 0)
+    {
+        xfree(snapshot);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDASnapshotReplace(SLPKnownDASnapshot* snapshot)
+/* Publishes a snapshot in place of the current one.  Call with            */
+/* G_KnownDALock held                                                      */
+/*-------------------------------------------------------------------------*/
+{
+    SLPKnownDASnapshot* old;
+    int                 epoch;
+
+    old = G_KnownDASnapshot;
+    SLPAtomicStore(&G_KnownDASnapshot,snapshot);
+
+    /* readers that may have seen the old snapshot have taken a reference */
+    /* once the old epoch has none left                                   */
+    epoch = G_KnownDAEpoch & 1;
+    SLPAtomicAdd(&G_KnownDAEpoch,1);
+    while(SLPAtomicLoad(&G_KnownDAReaders[epoch]))
+    {
+#ifdef LIBSLP_THREADS
+        sched_yield();
+#endif
+    }
+
+    KnownDASnapshotPut(old);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDASnapshotPublish()
+/* Publishes a new snapshot of G_KnownDACache.  Call with G_KnownDALock    */
+/* held.  If out of memory the old snapshot stays                          */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDatabaseHandle   dh;
+    SLPDatabaseEntry*   entry;
+    SLPDAAdvert*        daadvert;
+    SLPKnownDASnapshot* snapshot;
+    SLPKnownDA*         da;
+    char*               strings;
+    int                 count;
+    int                 size;
+
+    dh = SLPDatabaseOpen(&G_KnownDACache);
+    if(dh == 0)
+    {
+        return;
+    }
+
+    count = 0;
+    size = 0;
+    while((entry = SLPDatabaseEnum(dh)) != 0)
+    {
+        daadvert = &(entry->msg->body.daadvert);
+        count += 1;
+        size += daadvert->urllen + daadvert->scopelistlen +
+                daadvert->spilistlen + 3;
+    }
+
+    snapshot = (SLPKnownDASnapshot*)xmalloc(sizeof(SLPKnownDASnapshot) +
+                                            count * sizeof(SLPKnownDA) +
+                                            size);
+    if(snapshot)
+    {
+        snapshot->refcount = 1;
+        snapshot->count = count;
+        strings = (char*)(snapshot->das + count);
+        da = snapshot->das;
+
+        SLPDatabaseRewind(dh);
+        while((entry = SLPDatabaseEnum(dh)) != 0)
+        {
+            daadvert = &(entry->msg->body.daadvert);
+            da->addr = entry->msg->peer.sin_addr;
+
+            da->urllen = daadvert->urllen;
+            da->url = strings;
+            memcpy(strings,daadvert->url,daadvert->urllen);
+            strings[daadvert->urllen] = 0;
+            strings += daadvert->urllen + 1;
+
+            da->scopelistlen = daadvert->scopelistlen;
+            da->scopelist = strings;
+            memcpy(strings,daadvert->scopelist,daadvert->scopelistlen);
+            strings[daadvert->scopelistlen] = 0;
+            strings += daadvert->scopelistlen + 1;
+
+            da->spilistlen = daadvert->spilistlen;
+            da->spilist = strings;
+            memcpy(strings,daadvert->spilist,daadvert->spilistlen);
+            strings[daadvert->spilistlen] = 0;
+            strings += daadvert->spilistlen + 1;
+
+            da++;
+        }
+
+        KnownDASnapshotReplace(snapshot);
+    }
+
+    SLPDatabaseClose(dh);
+}
+
+
+/*=========================================================================*/
+typedef struct _SLPDAPoolConn
+/* An idle connection to a DA that any handle may borrow                   */
+/*=========================================================================*/
+{
+    SLPListItem     listitem;
+    int             sock;
+    struct in_addr  daaddr;
+    time_t          idlesince;
+}SLPDAPoolConn;
+
+/* G_KnownDAPool holds the idle connections, the most recently returned at */
+/* its head.  G_KnownDAPoolLock guards it: the I/O thread and the threads  */
+/* making calls on sync handles borrow from it at the same time            */
+#ifdef LIBSLP_THREADS
+static pthread_mutex_t  G_KnownDAPoolLock   = PTHREAD_MUTEX_INITIALIZER;
+#define KnownDAPoolLock()   pthread_mutex_lock(&G_KnownDAPoolLock)
+#define KnownDAPoolUnlock() pthread_mutex_unlock(&G_KnownDAPoolLock)
+#else
+#define KnownDAPoolLock()
+#define KnownDAPoolUnlock()
+#endif
+static SLPList          G_KnownDAPool       = {0, 0, 0};
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDAPoolExpire(time_t now)
+/* Closes the connections idle for longer than                             */
+/* net.slp.DAConnectionIdleTimeout.  Must be called with the lock held     */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDAPoolConn*  conn;
+    int             idletimeout;
+
+    idletimeout = SLPPropertyAsInteger(SLPGetProperty("net.slp.DAConnectionIdleTimeout"));
+    while(G_KnownDAPool.tail)
+    {
+        conn = (SLPDAPoolConn*)G_KnownDAPool.tail;
+        if(now - conn->idlesince < idletimeout)
+        {
+            break;
+        }
+        SLPListUnlink(&G_KnownDAPool,(SLPListItem*)conn);
+        closesocket(conn->sock);
+        xfree(conn);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int KnownDAPoolHealthy(int sock)
+/* An idle connection has nothing to read.  If it has, the DA closed it or */
+/* it carries a reply nobody waited for                                    */
+/*-------------------------------------------------------------------------*/
+{
+    fd_set          readfds;
+    struct timeval  timeout;
+
+    FD_ZERO(&readfds);
+    FD_SET(sock,&readfds);
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+
+    return select(sock + 1,&readfds,0,0,&timeout) == 0;
+}
+
+
+/*=========================================================================*/
+int KnownDAPoolGet(struct in_addr* daaddr)
+/* Borrows an idle connection to a DA from the process wide pool           */
+/*                                                                         */
+/* daaddr (IN) address of the DA                                           */
+/*                                                                         */
+/* returns: a connected, blocking socket, or -1 if the pool has none that  */
+/*          is still good.  It belongs to the caller until given back with */
+/*          KnownDAPoolPut() or closed                                     */
+/*=========================================================================*/
+{
+    SLPDAPoolConn*  conn;
+    SLPDAPoolConn*  next;
+    int             sock    = -1;
+
+    KnownDAPoolLock();
+
+    KnownDAPoolExpire(time(0));
+
+    conn = (SLPDAPoolConn*)G_KnownDAPool.head;
+    while(conn && sock < 0)
+    {
+        next = (SLPDAPoolConn*)conn->listitem.next;
+        if(memcmp(&(conn->daaddr),daaddr,sizeof(struct in_addr)) == 0)
+        {
+            SLPListUnlink(&G_KnownDAPool,(SLPListItem*)conn);
+            if(KnownDAPoolHealthy(conn->sock))
+            {
+                sock = conn->sock;
+            }
+            else
+            {
+                closesocket(conn->sock);
+            }
+            xfree(conn);
+        }
+        conn = next;
+    }
+
+    KnownDAPoolUnlock();
+
+    return sock;
+}
+
+
+/*=========================================================================*/
+void KnownDAPoolPut(int sock, struct in_addr* daaddr)
+/* Gives a connection to a DA to the process wide pool, or closes it if    */
+/* the pool is full.  The connection must be idle: every reply to a        */
+/* request sent on it has been read                                        */
+/*                                                                         */
+/* sock   (IN) the connected socket, which now belongs to the pool         */
+/*                                                                         */
+/* daaddr (IN) address of the DA                                           */
+/*=========================================================================*/
+{
+    SLPDAPoolConn*  conn;
+    int             poolsize;
+#ifdef _WIN32
+    u_long          fdflags;
+#else
+    int             fdflags;
+#endif
+
+    if(sock < 0)
+    {
+        return;
+    }
+
+    conn = (SLPDAPoolConn*)xmalloc(sizeof(SLPDAPoolConn));
+    poolsize = SLPPropertyAsInteger(SLPGetProperty("net.slp.DAConnectionPoolSize"));
+    if(conn == 0 || poolsize <= 0)
+    {
+        if(conn) xfree(conn);
+        closesocket(sock);
+        return;
+    }
+
+    /* borrowers expect a blocking socket */
+#ifdef _WIN32
+    fdflags = 0;
+    ioctlsocket(sock, FIONBIO, &fdflags);
+#else
+    fdflags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock,F_SETFL, fdflags & ~O_NONBLOCK);
+#endif
+
+    conn->sock = sock;
+    memcpy(&(conn->daaddr),daaddr,sizeof(struct in_addr));
+    conn->idlesince = time(0);
+
+    KnownDAPoolLock();
+
+    KnownDAPoolExpire(conn->idlesince);
+    SLPListLinkHead(&G_KnownDAPool,(SLPListItem*)conn);
+    while(G_KnownDAPool.count > poolsize)
+    {
+        /* the one idle the longest makes room */
+        conn = (SLPDAPoolConn*)SLPListUnlink(&G_KnownDAPool,G_KnownDAPool.tail);
+        closesocket(conn->sock);
+        xfree(conn);
+    }
+
+    KnownDAPoolUnlock();
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDAPoolRemove(struct in_addr* daaddr)
+/* Closes the idle connections to a DA, or all of them if daaddr is NULL   */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDAPoolConn*  conn;
+    SLPDAPoolConn*  next;
+
+    KnownDAPoolLock();
+
+    conn = (SLPDAPoolConn*)G_KnownDAPool.head;
+    while(conn)
+    {
+        next = (SLPDAPoolConn*)conn->listitem.next;
+        if(daaddr == 0 ||
+           memcmp(&(conn->daaddr),daaddr,sizeof(struct in_addr)) == 0)
+        {
+            SLPListUnlink(&G_KnownDAPool,(SLPListItem*)conn);
+            closesocket(conn->sock);
+            xfree(conn);
+        }
+        conn = next;
+    }
+
+    KnownDAPoolUnlock();
+}
+
+
+/*=========================================================================*/
+typedef struct _SLPDARtt
+/* What a DA, or an SA asked over TCP, was measured to do: the round trip  */
+/* time of its connects, the time it took to answer requests and how       */
+/* often it failed                                                         */
+/*=========================================================================*/
+{
+    SLPListItem     listitem;
+    struct in_addr  addr;
+    int             rttsamples;
+    int             srtt;       /* smoothed RTT in msecs, times 8         */
+    int             rttvar;     /* its mean deviation in msecs, times 4   */
+    int             latsamples;
+    int             latency;    /* smoothed latency in msecs, times 8     */
+    int             latvar;     /* its mean deviation in msecs, times 4   */
+    int             failrate;   /* moving share of failures, times 1024   */
+}SLPDARtt;
+
+#define KNOWNDA_MAX_RTT     64  /* peers whose RTT is remembered          */
+#define KNOWNDA_MIN_RTO     50  /* msecs, below it timer noise dominates  */
+#define KNOWNDA_UNHEALTHY   512 /* failrate of a DA used only as a last   */
+                                /* resort: half its recent requests       */
+
+/* G_KnownDARtt holds the estimates, the most recently sampled at its      */
+/* head.  G_KnownDARetransmits counts connects retried because the         */
+/* estimate passed without an answer, G_KnownDASpurious the ones of those  */
+/* the earlier attempt won after all.  G_KnownDAHedgeRqsts counts the      */
+/* requests that could have been hedged, G_KnownDAHedges the hedges sent   */
+#ifdef LIBSLP_THREADS
+static pthread_mutex_t  G_KnownDARttLock    = PTHREAD_MUTEX_INITIALIZER;
+#define KnownDARttLock()    pthread_mutex_lock(&G_KnownDARttLock)
+#define KnownDARttUnlock()  pthread_mutex_unlock(&G_KnownDARttLock)
+#else
+#define KnownDARttLock()
+#define KnownDARttUnlock()
+#endif
+static SLPList          G_KnownDARtt        = {0, 0, 0};
+static int              G_KnownDARetransmits = 0;
+static int              G_KnownDASpurious   = 0;
+static int              G_KnownDAHedgeRqsts = 0;
+static int              G_KnownDAHedges     = 0;
+
+
+/*-------------------------------------------------------------------------*/
+static SLPDARtt* KnownDARttFind(struct in_addr* addr)
+/* Must be called with the lock held                                       */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDARtt* rtt;
+
+    rtt = (SLPDARtt*)G_KnownDARtt.head;
+    while(rtt)
+    {
+        if(memcmp(&(rtt->addr),addr,sizeof(struct in_addr)) == 0)
+        {
+            break;
+        }
+        rtt = (SLPDARtt*)rtt->listitem.next;
+    }
+
+    return rtt;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPDARtt* KnownDARttTouch(struct in_addr* addr)
+/* Finds or makes the estimates of a peer that is about to be sampled and  */
+/* moves them to the head.  Must be called with the lock held              */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDARtt* rtt;
+
+    rtt = KnownDARttFind(addr);
+    if(rtt)
+    {
+        SLPListUnlink(&G_KnownDARtt,(SLPListItem*)rtt);
+    }
+    else
+    {
+        if(G_KnownDARtt.count >= KNOWNDA_MAX_RTT)
+        {
+            /* forget the peer sampled the longest ago */
+            rtt = (SLPDARtt*)SLPListUnlink(&G_KnownDARtt,G_KnownDARtt.tail);
+        }
+        else
+        {
+            rtt = (SLPDARtt*)xmalloc(sizeof(SLPDARtt));
+        }
+        if(rtt == 0)
+        {
+            return 0;
+        }
+        memset(rtt,0,sizeof(SLPDARtt));
+        memcpy(&(rtt->addr),addr,sizeof(struct in_addr));
+    }
+    SLPListLinkHead(&G_KnownDARtt,(SLPListItem*)rtt);
+
+    return rtt;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDARttSmooth(int* smoothed,
+                             int* meandev,
+                             int* samples,
+                             int msecs)
+/* The estimator of TCP's retransmission timer.  smoothed is kept times 8  */
+/* and meandev times 4                                                     */
+/*-------------------------------------------------------------------------*/
+{
+    int delta;
+
+    if(*samples == 0)
+    {
+        /* the first sample: SRTT = R, RTTVAR = R/2 */
+        *smoothed = msecs << 3;
+        *meandev = msecs << 1;
+    }
+    else
+    {
+        /* RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R */
+        delta = msecs - (*smoothed >> 3);
+        *smoothed += delta;
+        if(delta < 0)
+        {
+            delta = -delta;
+        }
+        *meandev += delta - (*meandev >> 2);
+    }
+    *samples += 1;
+}
+
+
+/*=========================================================================*/
+int KnownDARttTimeout(struct in_addr* addr)
+/* Estimates how long a peer takes to answer a connect, as TCP does for    */
+/* its retransmission timer                                                */
+/*                                                                         */
+/* addr (IN) address of the DA or SA                                       */
+/*                                                                         */
+/* returns: the time in msecs, or 0 if the peer was never timed            */
+/*=========================================================================*/
+{
+    SLPDARtt*   rtt;
+    int         result  = 0;
+
+    KnownDARttLock();
+
+    rtt = KnownDARttFind(addr);
+    if(rtt && rtt->rttsamples)
+    {
+        /* SRTT + 4 * RTTVAR */
+        result = (rtt->srtt >> 3) + rtt->rttvar;
+        if(result < KNOWNDA_MIN_RTO)
+        {
+            result = KNOWNDA_MIN_RTO;
+        }
+    }
+
+    KnownDARttUnlock();
+
+    return result;
+}
+
+
+/*=========================================================================*/
+void KnownDARttSample(struct in_addr* addr, int msecs)
+/* Adds a measured round trip time to the estimate of a peer               */
+/*                                                                         */
+/* addr  (IN) address of the DA or SA                                      */
+/*                                                                         */
+/* msecs (IN) the time one connect attempt took to complete                */
+/*=========================================================================*/
+{
+    SLPDARtt*   rtt;
+
+    KnownDARttLock();
+
+    rtt = KnownDARttTouch(addr);
+    if(rtt)
+    {
+        KnownDARttSmooth(&(rtt->srtt),&(rtt->rttvar),&(rtt->rttsamples),msecs);
+    }
+
+    KnownDARttUnlock();
+}
+
+
+/*=========================================================================*/
+void KnownDARttReply(struct in_addr* daaddr, int msecs)
+/* Adds the time a DA took to answer a request to its latency estimate,    */
+/* and the success to its failure rate                                     */
+/*                                                                         */
+/* daaddr (IN) address of the DA                                           */
+/*                                                                         */
+/* msecs  (IN) the time from starting the request to reading the reply     */
+/*=========================================================================*/
+{
+    SLPDARtt*   rtt;
+
+    KnownDARttLock();
+
+    rtt = KnownDARttTouch(daaddr);
+    if(rtt)
+    {
+        KnownDARttSmooth(&(rtt->latency),&(rtt->latvar),&(rtt->latsamples),msecs);
+        rtt->failrate -= rtt->failrate >> 3;
+    }
+
+    KnownDARttUnlock();
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDARttFailure(struct in_addr* daaddr)
+/* Adds a failed request to the failure rate of a DA                       */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDARtt*   rtt;
+
+    KnownDARttLock();
+
+    rtt = KnownDARttTouch(daaddr);
+    if(rtt)
+    {
+        rtt->failrate += (1024 - rtt->failrate) >> 3;
+    }
+
+    KnownDARttUnlock();
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int KnownDARttScore(struct in_addr* daaddr)
+/* Ranks a DA for a request, lower is better: its latency divided by its   */
+/* chance of success.  A DA never asked scores best so it gets measured    */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDARtt*   rtt;
+    int         result  = 0;
+
+    KnownDARttLock();
+
+    rtt = KnownDARttFind(daaddr);
+    if(rtt)
+    {
+        result = rtt->latsamples ? (rtt->latency >> 3) + 1 : 1;
+        result = result * 1024 / (1024 - rtt->failrate);
+        if(rtt->failrate >= KNOWNDA_UNHEALTHY)
+        {
+            result += 1 << 20;
+        }
+    }
+
+    KnownDARttUnlock();
+
+    return result;
+}
+
+
+/*=========================================================================*/
+int KnownDAHedgeDelay(struct in_addr* daaddr)
+/* Tells how long to wait for a DA before sending its request to another   */
+/* DA as well.  net.slp.DAHedgeDelay sets it, or else it is the DA's 95th  */
+/* percentile latency, taken as its smoothed latency plus twice the mean   */
+/* deviation                                                               */
+/*                                                                         */
+/* daaddr (IN) address of the DA asked first                               */
+/*                                                                         */
+/* returns: the time in msecs, or 0 not to hedge                           */
+/*=========================================================================*/
+{
+    SLPDARtt*   rtt;
+    int         delay;
+
+    if(SLPPropertyAsInteger(SLPGetProperty("net.slp.DAHedgeBudget")) <= 0)
+    {
+        return 0;
+    }
+    delay = SLPPropertyAsInteger(SLPGetProperty("net.slp.DAHedgeDelay"));
+
+    KnownDARttLock();
+
+    G_KnownDAHedgeRqsts++;
+    if(delay <= 0)
+    {
+        delay = 0;
+        rtt = KnownDARttFind(daaddr);
+        if(rtt && rtt->latsamples)
+        {
+            delay = (rtt->latency >> 3) + (rtt->latvar >> 1) + 1;
+        }
+    }
+
+    KnownDARttUnlock();
+
+    return delay;
+}
+
+
+/*=========================================================================*/
+int KnownDAHedgeSpend()
+/* Accounts for a hedge about to be sent, unless that would exceed         */
+/* net.slp.DAHedgeBudget percent of the requests that could be hedged      */
+/*                                                                         */
+/* returns: non-zero if the hedge may be sent                              */
+/*=========================================================================*/
+{
+    int budget;
+    int result  = 0;
+
+    budget = SLPPropertyAsInteger(SLPGetProperty("net.slp.DAHedgeBudget"));
+
+    KnownDARttLock();
+
+    if(G_KnownDAHedges * 100 < budget * G_KnownDAHedgeRqsts)
+    {
+        G_KnownDAHedges++;
+        result = 1;
+    }
+
+    KnownDARttUnlock();
+
+    return result;
+}
+
+
+/*=========================================================================*/
+void KnownDARttRetransmit(int spurious)
+/* Counts a connect attempt retried because the estimate ran out, or one   */
+/* found to be spurious because the earlier attempt completed first        */
+/*=========================================================================*/
+{
+    KnownDARttLock();
+
+    if(spurious)
+    {
+        G_KnownDASpurious++;
+    }
+    else
+    {
+        G_KnownDARetransmits++;
+    }
+
+    KnownDARttUnlock();
+}
+
+
+/*=========================================================================*/
+void KnownDARttCounters(int* retransmits, int* spurious)
+/* Reports how often connects were retried since the process started       */
+/*                                                                         */
+/* retransmits (OUT) the attempts started while an earlier one was pending */
+/*                                                                         */
+/* spurious    (OUT) the retries that turned out not to be needed          */
+/*=========================================================================*/
+{
+    KnownDARttLock();
+
+    *retransmits = G_KnownDARetransmits;
+    *spurious = G_KnownDASpurious;
+
+    KnownDARttUnlock();
+}
+
+
 /*-------------------------------------------------------------------------*/
 SLPBoolean KnownDAListFind(int scopelistlen,
                            const char* scopelist,
                            int spistrlen,
                            const char* spistr,
+                           struct in_addr* exclude,
                            struct in_addr* daaddr)
+/* Picks the DA that supports the scopes and answered fastest lately,      */
+/* avoiding the ones that failed most of their recent requests             */
+/*                                                                         */
+/* exclude (IN) a DA not to pick, or NULL                                  */
+/*                                                                         */
 /* Returns: non-zero on success, zero if DA can not be found               */
 /*-------------------------------------------------------------------------*/
 {
-    SLPDatabaseHandle   dh;
-    SLPDatabaseEntry*   entry;
-    int result = SLP_FALSE;
+    SLPKnownDASnapshot* snapshot;
+    SLPKnownDA*         da;
+    int                 i;
+    int                 score;
+    int                 bestscore   = 0;
+    int                 result      = SLP_FALSE;
    
-    dh = SLPDatabaseOpen(&G_KnownDACache);
-    if(dh)
+    snapshot = KnownDASnapshotGet();
+    if(snapshot)
     {
         /*----------------------------------------*/
         /* Check to see if there a matching entry */
         /*----------------------------------------*/
-        while(1)
+        for(i = 0; i < snapshot->count; i++)
         {
-            entry = SLPDatabaseEnum(dh);
-            if(entry == NULL) break;
+            da = &(snapshot->das[i]);
             
+            if(exclude &&
+               memcmp(exclude,&(da->addr),sizeof(struct in_addr)) == 0)
+            {
+                continue;
+            }
+
             /* Check scopes */
-            if(SLPSubsetStringList(entry->msg->body.daadvert.scopelistlen,
-                                   entry->msg->body.daadvert.scopelist,
+            if(SLPSubsetStringList(da->scopelistlen,
+                                   da->scopelist,
                                    scopelistlen,
                                    scopelist))
             {
 #ifdef ENABLE_SLPv2_SECURITY
-                if(SLPCompareString(entry->msg->body.daadvert.spilistlen,
-                                    entry->msg->body.daadvert.spilist,
+                if(SLPCompareString(da->spilistlen,
+                                    da->spilist,
                                     spistrlen,
                                     spistr) == 0)
 #endif
                 {
-                    
-                    memcpy(daaddr, 
-                           &(entry->msg->peer.sin_addr),
-                           sizeof(struct in_addr));
-    
-                    result = SLP_TRUE;
+                    score = KnownDARttScore(&(da->addr));
+                    if(result == SLP_FALSE || score < bestscore)
+                    {
+                        memcpy(daaddr,&(da->addr),sizeof(struct in_addr));
+                        bestscore = score;
+                        result = SLP_TRUE;
+                    }
                 }
             }
         }
-        SLPDatabaseClose(dh);
+        KnownDASnapshotPut(snapshot);
     }
 
     return result;
@@ -147,6 +939,8 @@ int KnownDAAdd(SLPMessage msg, SLPBuffer buf)
 
     result = 0;
 
+    KnownDALock();
+
     dh = SLPDatabaseOpen(&G_KnownDACache);
     if(dh)
     {
@@ -187,17 +981,23 @@ int KnownDAAdd(SLPMessage msg, SLPBuffer buf)
         }
         
         SLPDatabaseClose(dh);
+        KnownDASnapshotPublish();
     }
+
+    KnownDAUnlock();
         
     return result;
 }
 
-/*-------------------------------------------------------------------------*/
+/*=========================================================================*/
 SLPBoolean KnownDADiscoveryCallback(SLPError errorcode,
                                     struct sockaddr_in* peerinfo,
                                     SLPBuffer rplybuf, 
                                     void* cookie)
-/*-------------------------------------------------------------------------*/
+/* Adds the DAs that answer a DA discovery request to the known DAs        */
+/*                                                                         */
+/* cookie (IN/OUT) an int that counts them                                 */
+/*=========================================================================*/
 {
     SLPMessage      replymsg;
     SLPBuffer       dupbuf;
@@ -271,41 +1071,37 @@ SLPBoolean KnownDADiscoveryCallback(SLPError errorcode,
 }
                
 
-/*-------------------------------------------------------------------------*/
-int KnownDADiscoveryRqstRply(int sock, 
-                             struct sockaddr_in* peeraddr,
-			     int scopelistlen,
-#ifndef MI_NOT_SUPPORTED
-                             const char* scopelist,
-                             PSLPHandleInfo handle)
-#else
-                             const char* scopelist)
-#endif /* MI_NOT_SUPPORTED */
-/* Returns: number of *new* DAEntries found                                */
-/*-------------------------------------------------------------------------*/
+/*=========================================================================*/
+char* KnownDADiscoveryRqst(int scopelistlen,
+                           const char* scopelist,
+                           int* bufsize)
+/* Lays out the body of the SrvRqst for DAs that DA discovery sends        */
+/*                                                                         */
+/* bufsize (OUT) the size of the body                                      */
+/*                                                                         */
+/* Returns: the body, to be xfree()d, or NULL if out of memory             */
+/*=========================================================================*/
 {
     char*   buf;
     char*   curpos;
-    int     bufsize;
-    int     result = 0;
 
     /*-------------------------------------------------------------------*/
     /* determine the size of the fixed portion of the SRVRQST            */
     /*-------------------------------------------------------------------*/
-    bufsize  = 31; /*  2 bytes for the srvtype length */
-                   /* 23 bytes for "service:directory-agent" srvtype */
-                   /*  2 bytes for scopelistlen */
-                   /*  2 bytes for predicatelen */
-                   /*  2 bytes for sprstrlen */
-    bufsize += scopelistlen;
+    *bufsize  = 31; /*  2 bytes for the srvtype length */
+                    /* 23 bytes for "service:directory-agent" srvtype */
+                    /*  2 bytes for scopelistlen */
+                    /*  2 bytes for predicatelen */
+                    /*  2 bytes for sprstrlen */
+    *bufsize += scopelistlen;
 
     /* TODO: make sure that we don't exceed the MTU */
-    buf = curpos = (char*)xmalloc(bufsize);
+    buf = curpos = (char*)xmalloc(*bufsize);
     if(buf == 0)
     {
         return 0;
     }
-    memset(buf,0,bufsize);
+    memset(buf,0,*bufsize);
 
     /*------------------------------------------------------------*/
     /* Build a buffer containing the fixed portion of the SRVRQST */
@@ -322,6 +1118,33 @@ int KnownDADiscoveryRqstRply(int sock,
     memcpy(curpos,scopelist,scopelistlen);
     /* predicate zero length */
     /* spi list zero length */
+
+    return buf;
+}
+
+
+/*-------------------------------------------------------------------------*/
+int KnownDADiscoveryRqstRply(int sock, 
+                             struct sockaddr_in* peeraddr,
+			     int scopelistlen,
+#ifndef MI_NOT_SUPPORTED
+                             const char* scopelist,
+                             PSLPHandleInfo handle)
+#else
+                             const char* scopelist)
+#endif /* MI_NOT_SUPPORTED */
+/* Returns: number of *new* DAEntries found                                */
+/*-------------------------------------------------------------------------*/
+{
+    char*   buf;
+    int     bufsize;
+    int     result = 0;
+
+    buf = KnownDADiscoveryRqst(scopelistlen,scopelist,&bufsize);
+    if(buf == 0)
+    {
+        return 0;
+    }
     
     if(sock == -1)
     {
@@ -435,7 +1258,7 @@ int KnownDADiscoverFromDHCP()
 		if(peeraddr.sin_addr.s_addr)
 		{
 			int sockfd;
-			if((sockfd = SLPNetworkConnectStream(&peeraddr, &timeout)) >= 0)
+			if((sockfd = NetworkConnectStream(&peeraddr, &timeout)) >= 0)
 			{
 				count = KnownDADiscoveryRqstRply(sockfd, 
                                                                  &peeraddr, 
@@ -510,7 +1333,7 @@ int KnownDADiscoverFromProperties(int scopelistlen,
             
             if (peeraddr.sin_addr.s_addr)
             {
-                sockfd = SLPNetworkConnectStream(&peeraddr,&timeout);
+                sockfd = NetworkConnectStream(&peeraddr,&timeout);
                 if(sockfd >= 0)
                 {
                     result = KnownDADiscoveryRqstRply(sockfd,
@@ -588,20 +1411,51 @@ SLPBoolean KnownDAFromCache(int scopelistlen,
 /*-------------------------------------------------------------------------*/
 {
     time_t          curtime;
+    int             discoveries;
+#if defined(ENABLE_ASYNC_API) && !defined(_WIN32)
+    int             async;
+#endif
     
     if(KnownDAListFind(scopelistlen,
                        scopelist,
                        spistrlen,
                        spistr,
+                       0,
                        daaddr) == SLP_FALSE)
     {
+        /* when many threads miss at once only the first discovers */
+        discoveries = SLPAtomicLoad(&G_KnownDADiscoveries);
+#if defined(ENABLE_ASYNC_API) && !defined(_WIN32)
+        async = AsyncDiscoverStarting();
+        if(async)
+        {
+            /* the I/O thread goes on without the DAs another thread is */
+            /* discovering rather than wait for them                    */
+            if(KnownDADiscoverTryLock())
+            {
+                return SLP_FALSE;
+            }
+        }
+        else
+#endif
+        KnownDADiscoverLock();
+
         curtime = time(&curtime);
-        if(G_KnownDALastCacheRefresh == 0 ||
-           curtime - G_KnownDALastCacheRefresh > MINIMUM_DISCOVERY_INTERVAL)
+        if(discoveries == G_KnownDADiscoveries &&
+           (G_KnownDALastCacheRefresh == 0 ||
+            curtime - G_KnownDALastCacheRefresh > MINIMUM_DISCOVERY_INTERVAL))
         {
             G_KnownDALastCacheRefresh = curtime;
 
             /* discover DAs */
+#if defined(ENABLE_ASYNC_API) && !defined(_WIN32)
+            if(async && AsyncDiscoverStart(scopelistlen,scopelist) == SLP_OK)
+            {
+                /* the I/O thread runs the steps below without blocking */
+                /* and then the call again                              */
+            }
+            else
+#endif
 #ifndef MI_NOT_SUPPORTED
             if(KnownDADiscoverFromIPC(handle) == 0)
                 if(KnownDADiscoverFromProperties(scopelistlen, scopelist, handle) == 0)
@@ -613,12 +1467,16 @@ SLPBoolean KnownDAFromCache(int scopelistlen,
                     if(KnownDADiscoverFromDHCP() == 0)
                         KnownDADiscoverFromMulticast(scopelistlen, scopelist);
 #endif		
+            G_KnownDADiscoveries++;
         }
 
+        KnownDADiscoverUnlock();
+
         return KnownDAListFind(scopelistlen,
                                scopelist,
                                spistrlen,
                                spistr,
+                               0,
                                daaddr);
     }
 
@@ -682,7 +1540,14 @@ int KnownDAConnect(PSLPHandleInfo handle,
         peeraddr->sin_family = PF_INET;
         peeraddr->sin_port = htons(SLP_RESERVED_PORT);
         
-        sock = SLPNetworkConnectStream(peeraddr,&timeout);
+        /* a connection another handle left in the pool saves connecting */
+        sock = KnownDAPoolGet(&(peeraddr->sin_addr));
+        if(sock >= 0)
+        {
+            break;
+        }
+
+        sock = NetworkConnectStream(peeraddr,&timeout);
         if(sock >= 0)
         {
             break;
@@ -699,6 +1564,166 @@ int KnownDAConnect(PSLPHandleInfo handle,
     return sock;
 }
 
+/*=========================================================================*/
+int KnownDAFindForScopes(PSLPHandleInfo handle,
+                         int scopelistlen,
+                         const char* scopelist,
+                         struct in_addr* daaddrs,
+                         int maxdas,
+                         int* uncovered)
+/* Picks known DAs that together support the scopes of a request, so the   */
+/* request can be sent to all of them at once.  A single DA that supports  */
+/* every scope is preferred over several                                   */
+/*                                                                         */
+/* scopelistlen (IN) stringlen of the scopelist                            */
+/*                                                                         */
+/* scopelist (IN) the scopes of the request                                */
+/*                                                                         */
+/* daaddrs (OUT) addresses of the DAs picked                               */
+/*                                                                         */
+/* maxdas (IN) the number of addresses daaddrs can hold                    */
+/*                                                                         */
+/* uncovered (OUT) non-zero if no DA was picked for some of the scopes     */
+/*                                                                         */
+/* returns: the number of DAs picked                                       */
+/*=========================================================================*/
+{
+    struct in_addr  daaddr;
+    const char*     scope;
+    const char*     scopeend;
+    const char*     listend = scopelist + scopelistlen;
+    int             spistrlen   = 0;
+    char*           spistr      = 0;
+    int             count       = 0;
+    int             i;
+
+#ifdef ENABLE_SLPv2_SECURITY
+    if(SLPPropertyAsBoolean(SLPGetProperty("net.slp.securityEnabled")))
+    {
+        SLPSpiGetDefaultSPI(handle->hspi,
+                            SLPSPI_KEY_TYPE_PUBLIC,
+                            &spistrlen,
+                            &spistr);
+    }
+#endif
+
+    *uncovered = 0;
+
+    /* this also discovers DAs if none is known for the whole list */
+    if(KnownDAFromCache(scopelistlen,
+                        scopelist,
+                        spistrlen,
+                        spistr,
+#ifndef MI_NOT_SUPPORTED
+                        &daaddr,
+                        handle))
+#else
+                        &daaddr))
+#endif /* MI_NOT_SUPPORTED */
+    {
+        daaddrs[count++] = daaddr;
+        goto FINISHED;
+    }
+
+    /* otherwise look for a DA for each scope on its own */
+    scope = scopelist;
+    while(scope < listend)
+    {
+        scopeend = scope;
+        while(scopeend < listend && *scopeend != ',')
+        {
+            scopeend++;
+        }
+
+        if(scopeend > scope &&
+           KnownDAListFind(scopeend - scope,
+                           scope,
+                           spistrlen,
+                           spistr,
+                           0,
+                           &daaddr))
+        {
+            for(i = 0; i < count; i++)
+            {
+                if(memcmp(&daaddr,&(daaddrs[i]),sizeof(daaddr)) == 0)
+                {
+                    break;
+                }
+            }
+            if(i == count)
+            {
+                if(count < maxdas)
+                {
+                    daaddrs[count++] = daaddr;
+                }
+                else
+                {
+                    *uncovered = 1;
+                }
+            }
+        }
+        else
+        {
+            *uncovered = 1;
+        }
+
+        scope = scopeend + 1;
+    }
+
+    FINISHED:
+#ifdef ENABLE_SLPv2_SECURITY
+    if(spistr) xfree(spistr);
+#endif
+
+    return count;
+}
+
+
+/*=========================================================================*/
+int KnownDAFindHedge(PSLPHandleInfo handle,
+                     int scopelistlen,
+                     const char* scopelist,
+                     struct in_addr* primary,
+                     struct in_addr* daaddr)
+/* Picks a second DA that supports every scope of a request, to send it to */
+/* if the DA asked first is slow                                           */
+/*                                                                         */
+/* primary (IN) the DA asked first                                         */
+/*                                                                         */
+/* daaddr (OUT) address of the DA picked                                   */
+/*                                                                         */
+/* returns: non-zero if there is such a DA                                 */
+/*=========================================================================*/
+{
+    int     spistrlen   = 0;
+    char*   spistr      = 0;
+    int     result;
+
+#ifdef ENABLE_SLPv2_SECURITY
+    if(SLPPropertyAsBoolean(SLPGetProperty("net.slp.securityEnabled")))
+    {
+        SLPSpiGetDefaultSPI(handle->hspi,
+                            SLPSPI_KEY_TYPE_PUBLIC,
+                            &spistrlen,
+                            &spistr);
+    }
+#endif
+
+    result = KnownDAListFind(scopelistlen,
+                             scopelist,
+                             spistrlen,
+                             spistr,
+                             primary,
+                             daaddr);
+
+#ifdef ENABLE_SLPv2_SECURITY
+    if(spistr) xfree(spistr);
+#endif
+
+    return result;
+}
+
+
 /*=========================================================================*/
 void KnownDABadDA(struct in_addr* daaddr)
 /* Mark a KnownDA as a Bad DA.                                             */
@@ -710,6 +1735,12 @@ void KnownDABadDA(struct in_addr* daaddr)
 {
     SLPDatabaseHandle   dh;
     SLPDatabaseEntry*   entry;
+
+    /* its idle connections are no good either */
+    KnownDAPoolRemove(daaddr);
+    KnownDARttFailure(daaddr);
+
+    KnownDALock();
     
     dh = SLPDatabaseOpen(&G_KnownDACache);
     if(dh)
@@ -731,7 +1762,49 @@ void KnownDABadDA(struct in_addr* daaddr)
         }
 
         SLPDatabaseClose(dh);
+        KnownDASnapshotPublish();
+    }
+
+    KnownDAUnlock();
+}
+
+
+/*-------------------------------------------------------------------------*/
+#ifndef MI_NOT_SUPPORTED
+static void KnownDADiscoverAll(PSLPHandleInfo handle)
+#else
+static void KnownDADiscoverAll()
+#endif
+/* Discovers all DAs, once for all the threads that ask at the same time   */
+/*-------------------------------------------------------------------------*/
+{
+    int discoveries;
+
+    discoveries = SLPAtomicLoad(&G_KnownDADiscoveries);
+    KnownDADiscoverLock();
+
+    if(discoveries == G_KnownDADiscoveries)
+    {
+#ifndef MI_NOT_SUPPORTED
+        if(KnownDADiscoverFromIPC(handle) == 0)
+#else
+        if(KnownDADiscoverFromIPC() == 0)
+#endif
+        {
+#ifndef MI_NOT_SUPPORTED
+            KnownDADiscoverFromDHCP(handle);
+            KnownDADiscoverFromProperties(0,"", handle);
+            KnownDADiscoverFromMulticast(0,"", handle);
+#else
+            KnownDADiscoverFromDHCP();
+            KnownDADiscoverFromProperties(0,"");
+            KnownDADiscoverFromMulticast(0,"");
+#endif
+        }
+        G_KnownDADiscoveries++;
     }
+
+    KnownDADiscoverUnlock();
 }
 
 
@@ -758,23 +1831,14 @@ int KnownDAGetScopes(int* scopelistlen,
     
     /* discover all DAs */
 #ifndef MI_NOT_SUPPORTED
-    if(KnownDADiscoverFromIPC(handle) == 0)
-#else
-    if(KnownDADiscoverFromIPC() == 0)
-#endif
-    {
-#ifndef MI_NOT_SUPPORTED
-        KnownDADiscoverFromDHCP(handle);
-        KnownDADiscoverFromProperties(0,"", handle);
-        KnownDADiscoverFromMulticast(0,"", handle);
+    KnownDADiscoverAll(handle);
 #else
-        KnownDADiscoverFromDHCP();
-	KnownDADiscoverFromProperties(0,"");
-        KnownDADiscoverFromMulticast(0,"");
+    KnownDADiscoverAll();
 #endif
-    }
 
 
+    KnownDALock();
+
     /* enumerate through all the knownda entries and generate a */
     /* scopelist                                                */
     dh = SLPDatabaseOpen(&G_KnownDACache);
@@ -832,14 +1896,17 @@ int KnownDAGetScopes(int* scopelistlen,
         *scopelist = xmalloc(G_KnownDAScopesLen + 1);
         if(*scopelist == 0)
         {
+            KnownDAUnlock();
             return -1;
         }
         memcpy(*scopelist,G_KnownDAScopes, G_KnownDAScopesLen);
         (*scopelist)[G_KnownDAScopesLen] = 0; 
         *scopelistlen = G_KnownDAScopesLen;
+        KnownDAUnlock();
     }
     else
     {
+        KnownDAUnlock();
         *scopelist = xstrdup("");
         if(*scopelist == 0)
         {
@@ -860,71 +1927,50 @@ void KnownDAProcessSrvRqst(PSLPHandleInfo handle)
 /* returns: none                                                           */
 /*=========================================================================*/
 {
-    SLPDatabaseHandle   dh;
-    SLPDatabaseEntry*   entry;
+    SLPKnownDASnapshot* snapshot;
     SLPBoolean          cb_result;
-    char                tmp;
+    int                 i;
 
     /* discover all DAs */
 #ifndef MI_NOT_SUPPORTED
-    if(KnownDADiscoverFromIPC(handle) == 0)
-#else
-    if(KnownDADiscoverFromIPC() == 0)
-#endif
-    {
-#ifndef MI_NOT_SUPPORTED
-        KnownDADiscoverFromDHCP(handle);
-        KnownDADiscoverFromProperties(0,"", handle);
-        KnownDADiscoverFromMulticast(0,"", handle);
+    KnownDADiscoverAll(handle);
 #else
-        KnownDADiscoverFromDHCP();
-	KnownDADiscoverFromProperties(0,"");
-        KnownDADiscoverFromMulticast(0,"");
+    KnownDADiscoverAll();
 #endif
-    }
 
-    /* Enumerate through knownDA database */
-    dh = SLPDatabaseOpen(&G_KnownDACache);
-    if(dh)
+    /* Enumerate through the known DAs.  The snapshot stays valid while */
+    /* the callback runs, whatever other threads do to the cache        */
+    snapshot = KnownDASnapshotGet();
+    if(snapshot)
     {
-        /* Check to see if there a matching entry */
-        while(1)
+        for(i = 0; i < snapshot->count; i++)
         {
-            entry = SLPDatabaseEnum(dh);
-            
-            /* is there anything left? */
-            if(entry == NULL) break;
-            
-            /* TRICKY temporary null termination of DA url */
-            tmp = entry->msg->body.daadvert.url[entry->msg->body.daadvert.urllen];
-            ((char*)(entry->msg->body.daadvert.url))[entry->msg->body.daadvert.urllen] = 0;
-
             /* Call the SrvURLCallback */
             cb_result = handle->params.findsrvs.callback((SLPHandle)handle,
-                                                         entry->msg->body.daadvert.url,
+                                                         snapshot->das[i].url,
                                                          SLP_LIFETIME_MAXIMUM,
                                                          SLP_OK,
                                                          handle->params.findsrvs.cookie);
 
-            /* TRICKY: undo temporary null termination of DA url */
-            ((char*)(entry->msg->body.daadvert.url))[entry->msg->body.daadvert.urllen] = tmp;
-            
             /* does the caller want more? */
-            if(cb_result == SLP_FALSE)
+            if(cb_result == SLP_FALSE || AsyncRqstCancelled(handle))
             {
                 break;
             }
         }
 
-        SLPDatabaseClose(dh);
+        KnownDASnapshotPut(snapshot);
     }
     
-    /* Make SLP_LAST_CALL */
-    handle->params.findsrvs.callback((SLPHandle)handle,
-                                     NULL,
-                                     0,
-                                     SLP_LAST_CALL,
-                                     handle->params.findsrvs.cookie);
+    /* Make SLP_LAST_CALL, unless SLPClose() was called from the callback */
+    if(AsyncRqstCancelled(handle) == 0)
+    {
+        handle->params.findsrvs.callback((SLPHandle)handle,
+                                         NULL,
+                                         0,
+                                         SLP_LAST_CALL,
+                                         handle->params.findsrvs.cookie);
+    }
 }
 
 
@@ -938,6 +1984,9 @@ void KnownDAFreeAll()
 {
     SLPDatabaseHandle   dh;
     SLPDatabaseEntry*   entry;
+
+    KnownDALock();
+
     dh = SLPDatabaseOpen(&G_KnownDACache);
     if(dh)
     {
@@ -951,11 +2000,23 @@ void KnownDAFreeAll()
 
         SLPDatabaseClose(dh);
     }
+    KnownDASnapshotReplace(0);
     
     
     if(G_KnownDAScopes) xfree(G_KnownDAScopes);
+    G_KnownDAScopes = 0;
     G_KnownDAScopesLen = 0;
+
+    KnownDAUnlock();
+
     G_KnownDALastCacheRefresh = 0;
 
+    KnownDAPoolRemove(0);
+
+    while(G_KnownDARtt.head)
+    {
+        xfree(SLPListUnlink(&G_KnownDARtt,G_KnownDARtt.head));
+    }
+
 }
 #endif
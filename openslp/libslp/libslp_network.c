@@ -51,9 +51,39 @@
 #include "libslp.h"
 
 
+#ifndef _WIN32
+/*-------------------------------------------------------------------------*/
+int NetworkConnectToLocalSocket()
+/* Connects to slpd through its unix domain socket                         */
+/*                                                                         */
+/* Returns          Connected socket or -1 if slpd is not listening on it  */
+/*-------------------------------------------------------------------------*/
+{
+    struct sockaddr_un  addr;
+    int                 result;
+
+    result = socket(AF_UNIX,SOCK_STREAM,0);
+    if(result >= 0)
+    {
+        memset(&addr,0,sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path,SLP_LOCAL_SOCKET);
+        if(connect(result,(struct sockaddr*)&addr,sizeof(addr)) != 0)
+        {
+            close(result);
+            result = -1;
+        }
+    }
+
+    return result;
+}
+#endif
+
+
 /*=========================================================================*/
 int NetworkConnectToSlpd(struct sockaddr_in* peeraddr)
-/* Connects to slpd and provides a peeraddr to send to                     */
+/* Connects to slpd, through its unix domain socket when it can and the    */
+/* loopback otherwise, and provides a peeraddr to send to                  */
 /*                                                                         */
 /* peeraddr         (OUT) pointer to receive the connected DA's address    */
 /*                                                                         */
@@ -67,12 +97,22 @@ int NetworkConnectToSlpd(struct sockaddr_in* peeraddr)
 #endif
     int result;
 
+    peeraddr->sin_family      = AF_INET;
+    peeraddr->sin_port        = htons(SLP_RESERVED_PORT);
+    peeraddr->sin_addr.s_addr = htonl(LOOPBACK_ADDRESS);
+
+#ifndef _WIN32
+    /* prefer the unix domain socket, it is much cheaper than TCP */
+    result = NetworkConnectToLocalSocket();
+    if(result >= 0)
+    {
+        return result;
+    }
+#endif
+
     result = socket(AF_INET,SOCK_STREAM,0);
     if(result >= 0)
     {
-        peeraddr->sin_family      = AF_INET;
-        peeraddr->sin_port        = htons(SLP_RESERVED_PORT);
-        peeraddr->sin_addr.s_addr = htonl(LOOPBACK_ADDRESS);
 
         /* TODO: the following connect() could block for a long time.  */
 
@@ -172,15 +212,8 @@ int NetworkConnectToDA(PSLPHandleInfo handle,
     }
     else
     {
-        /* close handle cause it can't support the scope */
-        if(handle->dasock >= 0)
-        {
-#ifdef _WIN32
-	        closesocket(handle->dasock);
-#else
-	        close(handle->dasock);
-#endif
-        }
+        /* pool the connection, the DA may still be the one we want */
+        KnownDAPoolPut(handle->dasock,&(handle->daaddr.sin_addr));
 
         /* Attempt to connect to DA that does support the scope */
         handle->dasock = KnownDAConnect(handle,
@@ -305,6 +338,21 @@ SLPError NetworkRqstRply(int sock,
     int                 timeouts[MAX_RETRANSMITS];
     unsigned short      flags;
 
+#if defined(ENABLE_ASYNC_API) && !defined(_WIN32)
+    if(AsyncRqstIsStarting(cookie))
+    {
+        /* let the I/O thread multiplex it with the other conversations */
+        return AsyncRqstRply(sock,
+                             destaddr,
+                             langtag,
+                             extoffset,
+                             buf,
+                             buftype,
+                             bufsize,
+                             callback,
+                             cookie);
+    }
+#endif
 
     /*----------------------------------------------------*/
     /* Save off a few things we don't want to recalculate */
@@ -623,6 +671,188 @@ SLPError NetworkRqstRply(int sock,
     return result;
 }
 
+/*=========================================================================*/
+SLPError NetworkPipelineRqstRply(int sock,
+                                 struct sockaddr_in* destaddr,
+                                 const char* langtag,
+                                 char buftype,
+                                 NetworkPipelineMsg* msgs,
+                                 int count,
+                                 NetworkPipelineCallback callback,
+                                 void* cookie)
+/* Sends a batch of messages of one type down a connected stream socket,   */
+/* keeping up to MAX_PIPELINED_RQSTS of them unanswered at a time, and     */
+/* matches the replies to them by XID                                      */
+/*                                                                         */
+/* Returns  -    SLP_OK on success, or the error that ended the batch.     */
+/*               Messages it left unanswered are reported with it through  */
+/*               the callback                                              */
+/*=========================================================================*/
+{
+    struct timeval      timeout;
+    struct sockaddr_in  peeraddr;
+    SLPBuffer           sendbuf         = 0;
+    SLPBuffer           recvbuf         = 0;
+    SLPError            result          = SLP_OK;
+    char*               curpos;
+    int                 langtaglen;
+    int                 maxwait;
+    int                 size;
+    int                 next            = 0;
+    int                 last;
+    int                 pending         = 0;
+    int                 index[MAX_PIPELINED_RQSTS];
+    unsigned short      xids[MAX_PIPELINED_RQSTS];
+    unsigned short      xid;
+    unsigned short      flags;
+    int                 i;
+
+    langtaglen = strlen(langtag);
+    maxwait = SLPPropertyAsInteger(SLPGetProperty("net.slp.unicastMaximumWait"));
+    flags = (buftype == SLP_FUNCT_SRVREG ? SLP_FLAG_FRESH : 0);
+    memcpy(&peeraddr,destaddr,sizeof(peeraddr));
+
+    while(next < count || pending)
+    {
+        /*----------------------------------------------------------*/
+        /* Top the window up with as many messages as it has room   */
+        /* for, and send them all in one go                         */
+        /*----------------------------------------------------------*/
+        size = 0;
+        for(last = next, i = pending;
+            last < count && i < MAX_PIPELINED_RQSTS;
+            last++)
+        {
+            if(msgs[last].buf)
+            {
+                size += 14 + langtaglen + msgs[last].bufsize;
+                i++;
+            }
+        }
+
+        if(size)
+        {
+            if((sendbuf = SLPBufferRealloc(sendbuf,size)) == 0)
+            {
+                result = SLP_MEMORY_ALLOC_FAILED;
+                break;
+            }
+
+            curpos = (char*)sendbuf->start;
+            for(; next < last; next++)
+            {
+                if(msgs[next].buf == 0)
+                {
+                    continue;
+                }
+
+                xid = SLPXidGenerate();
+                size = 14 + langtaglen + msgs[next].bufsize;
+                /*version*/
+                *curpos         = 2;
+                /*function id*/
+                *(curpos + 1)   = buftype;
+                /*length*/
+                ToUINT24(curpos + 2, size);
+                /*flags*/
+                ToUINT16(curpos + 5, flags);
+                /*ext offset, fixed up to count from the header as well */
+                ToUINT24(curpos + 7,
+                         msgs[next].extoffset ?
+                         msgs[next].extoffset + langtaglen + 14 : 0);
+                /*xid*/
+                ToUINT16(curpos + 10,xid);
+                /*lang tag len*/
+                ToUINT16(curpos + 12,langtaglen);
+                /*lang tag*/
+                memcpy(curpos + 14, langtag, langtaglen);
+                /*the rest of the message*/
+                memcpy(curpos + 14 + langtaglen,
+                       msgs[next].buf,
+                       msgs[next].bufsize);
+                curpos = curpos + size;
+
+                index[pending] = next;
+                xids[pending] = xid;
+                pending++;
+            }
+
+            timeout.tv_sec = maxwait / 1000;
+            timeout.tv_usec = (maxwait % 1000) * 1000;
+            if(SLPNetworkSendMessage(sock,
+                                     SOCK_STREAM,
+                                     sendbuf,
+                                     destaddr,
+                                     &timeout) != 0)
+            {
+                result = (errno == ETIMEDOUT ?
+                          SLP_NETWORK_TIMED_OUT : SLP_NETWORK_ERROR);
+                break;
+            }
+        }
+        next = last;
+
+        if(pending == 0)
+        {
+            continue;
+        }
+
+        /*-----------------------------------------------------*/
+        /* Wait for the next reply and hand it to its message  */
+        /*-----------------------------------------------------*/
+        timeout.tv_sec = maxwait / 1000;
+        timeout.tv_usec = (maxwait % 1000) * 1000;
+        if(SLPNetworkRecvMessage(sock,
+                                 SOCK_STREAM,
+                                 &recvbuf,
+                                 &peeraddr,
+                                 &timeout) != 0)
+        {
+            result = (errno == ETIMEDOUT ?
+                      SLP_NETWORK_TIMED_OUT : SLP_NETWORK_ERROR);
+            break;
+        }
+
+        xid = AsUINT16(recvbuf->start + 10);
+        for(i = 0; i < pending; i++)
+        {
+            if(xids[i] == xid)
+            {
+                callback(SLP_OK,index[i],&peeraddr,recvbuf,cookie);
+
+                pending--;
+                index[i] = index[pending];
+                xids[i] = xids[pending];
+                break;
+            }
+        }
+    }
+
+    /*---------------------------------------------------------*/
+    /* Report whatever the error kept from being answered      */
+    /*---------------------------------------------------------*/
+    if(result)
+    {
+        for(i = 0; i < pending; i++)
+        {
+            callback(result,index[i],&peeraddr,0,cookie);
+        }
+        for(; next < count; next++)
+        {
+            if(msgs[next].buf)
+            {
+                callback(result,next,&peeraddr,0,cookie);
+            }
+        }
+    }
+
+    SLPBufferFree(sendbuf);
+    SLPBufferFree(recvbuf);
+
+    return result;
+}
+
+
 /*=========================================================================*/ 
 #ifndef MI_NOT_SUPPORTED
 SLPError NetworkMcastRqstRply(PSLPHandleInfo handle,
@@ -689,6 +919,34 @@ SLPError NetworkMcastRqstRply(const char* langtag,
     }
 #endif
 
+#if defined(ENABLE_ASYNC_API) && !defined(_WIN32)
+#ifndef MI_NOT_SUPPORTED
+    if(AsyncRqstIsStarting(cookie ? cookie : (void*)handle))
+    {
+        /* let the I/O thread multiplex it with the other conversations */
+        return AsyncMcastRqstRply(handle->langtag,
+                                  handle->McastIFList,
+                                  buf,
+                                  buftype,
+                                  bufsize,
+                                  callback,
+                                  cookie ? cookie : (void*)handle);
+    }
+#else
+    if(AsyncRqstIsStarting(cookie))
+    {
+        /* let the I/O thread multiplex it with the other conversations */
+        return AsyncMcastRqstRply(langtag,
+                                  NULL,
+                                  buf,
+                                  buftype,
+                                  bufsize,
+                                  callback,
+                                  cookie);
+    }
+#endif /* MI_NOT_SUPPORTED */
+#endif
+
     /*----------------------------------------------------*/
     /* Save off a few things we don't want to recalculate */
     /*----------------------------------------------------*/
@@ -1107,6 +1365,19 @@ SLPError NetworkUcastRqstRply(PSLPHandleInfo handle,
     }
 #endif
 
+#if defined(ENABLE_ASYNC_API) && !defined(_WIN32)
+    if(AsyncRqstIsStarting(cookie))
+    {
+        /* let the I/O thread multiplex it with the other conversations */
+        return AsyncUcastRqstRply(handle,
+                                  buf,
+                                  buftype,
+                                  bufsize,
+                                  callback,
+                                  cookie);
+    }
+#endif
+
     /*----------------------------------------------------*/
     /* Save off a few things we don't want to recalculate */
     /*----------------------------------------------------*/
@@ -1318,3 +1589,1316 @@ SLPError NetworkUcastRqstRply(PSLPHandleInfo handle,
 #endif
 	
 				
+
+
+/*-------------------------------------------------------------------------*/
+/* The parallel request engine.  NetworkMultiRqstRply() asks every DA it   */
+/* needs for the scopes of a request at once, and multicasts for the       */
+/* scopes no DA supports or as soon as a DA fails, merging the replies     */
+/* into one stream of callbacks                                            */
+/*-------------------------------------------------------------------------*/
+#define MAX_PARALLEL_PEERS  (MAX_PARALLEL_DAS + 8) /* DAs and TCP retries */
+
+#define PEER_DONE           0
+#define PEER_CONNECT        1
+#define PEER_RECV           2
+
+typedef struct _NetworkPeer
+/* A DA, or an SA whose multicast reply did not fit in a datagram, that is */
+/* asked over TCP                                                          */
+{
+    int                 sock;       /* -1 while conn is racing            */
+    int                 state;
+    int                 isda;
+    NetworkConnect      conn;
+    struct sockaddr_in  peeraddr;
+    SLPBuffer           sendbuf;
+    int                 xid;
+    struct timeval      started;    /* for the DA's latency estimate      */
+    struct timeval      deadline;
+}NetworkPeer;
+
+typedef struct _NetworkParallel
+{
+    PSLPHandleInfo          handle;
+    const char*             scopelist;
+    int                     scopelistlen;
+    int                     keepda;     /* hand the DA socket to handle   */
+    char*                   buf;
+    char                    buftype;
+    int                     bufsize;
+    NetworkRplyCallback*    callback;
+    void*                   cookie;
+    int                     stopped;    /* the callback wants no more     */
+    int                     rplycount;
+    int                     succeeded;  /* conversations that completed   */
+    SLPError                result;     /* the last failure               */
+    SLPBuffer               recvbuf;
+    NetworkPeer             peers[MAX_PARALLEL_PEERS];
+    int                     peercount;
+
+    /* a second DA asked when the first is slow */
+    int                     hedge;      /* 0 none, 1 armed, 2 sent        */
+    int                     hedgepeer;  /* index of the hedge once sent   */
+    struct in_addr          hedgeaddr;
+    struct timeval          hedgedeadline;
+
+    /* multicast convergence */
+    int                     mcast;      /* 0 not started, 1 running, 2 over */
+    SLPIfaceInfo            ifaceinfo;
+    SLPXcastSockets         xcastsocks;
+    SLPBuffer               mcastbuf;
+    char*                   prlist;
+    int                     prlistlen;
+    int                     mtu;
+    int                     xid;
+    int                     usebroadcast;
+    int                     xmitcount;
+    int                     totaltimeout;
+    int                     maxwait;
+    int                     quietwait;
+    int                     mcastrplycount;
+    int                     timeouts[MAX_RETRANSMITS];
+    struct timeval          deadline;
+    struct timeval          quietdeadline;
+}NetworkParallel;
+
+
+/*-------------------------------------------------------------------------*/
+static void NetworkSetDeadline(struct timeval* deadline, int msecs)
+/*-------------------------------------------------------------------------*/
+{
+    gettimeofday(deadline,0);
+    deadline->tv_sec  += msecs / 1000;
+    deadline->tv_usec += (msecs % 1000) * 1000;
+    if(deadline->tv_usec >= 1000000)
+    {
+        deadline->tv_sec  += 1;
+        deadline->tv_usec -= 1000000;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int NetworkIsBefore(struct timeval* a, struct timeval* b)
+/*-------------------------------------------------------------------------*/
+{
+    return (a->tv_sec < b->tv_sec ||
+            (a->tv_sec == b->tv_sec && a->tv_usec < b->tv_usec));
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int NetworkConnectCanRetry(NetworkConnect* conn)
+/* The last attempt waits for as long as the caller lets it                */
+/*-------------------------------------------------------------------------*/
+{
+    return (conn->attempts < MAX_RETRANSMITS &&
+            conn->timeouts[conn->attempts - 1] > 0);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int NetworkConnectAttempt(NetworkConnect* conn)
+/* Starts one more connect and schedules the next                          */
+/*-------------------------------------------------------------------------*/
+{
+    int             sock;
+    int             rto;
+#ifdef _WIN32
+    u_long          fdflags;
+#else
+    int             fdflags;
+#endif
+
+    sock = socket(AF_INET,SOCK_STREAM,0);
+    if(sock < 0)
+    {
+        return -1;
+    }
+#ifdef _WIN32
+    fdflags = 1;
+    ioctlsocket(sock, FIONBIO, &fdflags);
+#else
+    fdflags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock,F_SETFL, fdflags | O_NONBLOCK);
+#endif
+    if(connect(sock,
+               (struct sockaddr*)&(conn->peeraddr),
+               sizeof(struct sockaddr_in)) != 0)
+    {
+#ifdef _WIN32
+        if(WSAGetLastError() != WSAEWOULDBLOCK)
+        {
+            closesocket(sock);
+            return -1;
+        }
+#else
+        if(errno != EINPROGRESS)
+        {
+            close(sock);
+            return -1;
+        }
+#endif
+    }
+    conn->socks[conn->attempts] = sock;
+    gettimeofday(&(conn->started[conn->attempts]),0);
+
+    /* back off from the estimate like TCP does, but never wait longer */
+    /* than net.slp.unicastTimeouts says                               */
+    rto = KnownDARttTimeout(&(conn->peeraddr.sin_addr)) << conn->attempts;
+    if(rto == 0 || rto > conn->timeouts[conn->attempts])
+    {
+        rto = conn->timeouts[conn->attempts];
+    }
+    conn->attempts++;
+    NetworkSetDeadline(&(conn->retry),rto);
+
+    return 0;
+}
+
+
+/*=========================================================================*/
+int NetworkConnectStart(NetworkConnect* conn, struct sockaddr_in* peeraddr)
+/* Starts the first connect attempt                                        */
+/*                                                                         */
+/* peeraddr (IN) the peer to connect to                                    */
+/*                                                                         */
+/* Returns  -    zero on success, -1 if no socket could be made            */
+/*=========================================================================*/
+{
+    memcpy(&(conn->peeraddr),peeraddr,sizeof(struct sockaddr_in));
+    conn->attempts = 0;
+    SLPPropertyAsIntegerVector(SLPGetProperty("net.slp.unicastTimeouts"),
+                               conn->timeouts,
+                               MAX_RETRANSMITS);
+
+    return NetworkConnectAttempt(conn);
+}
+
+
+/*=========================================================================*/
+int NetworkConnectFds(NetworkConnect* conn,
+                      fd_set* writefds,
+                      int highfd,
+                      struct timeval** earliest)
+/* Adds the pending attempts to the select() arguments                     */
+/*                                                                         */
+/* earliest (IN/OUT) moved to the time of the next attempt if sooner       */
+/*                                                                         */
+/* Returns  -    the new highest fd                                        */
+/*=========================================================================*/
+{
+    int i;
+
+    for(i = 0; i < conn->attempts; i++)
+    {
+        if(conn->socks[i] >= 0)
+        {
+            FD_SET(conn->socks[i],writefds);
+            if(conn->socks[i] > highfd)
+            {
+                highfd = conn->socks[i];
+            }
+        }
+    }
+    if(NetworkConnectCanRetry(conn) &&
+       (*earliest == 0 || NetworkIsBefore(&(conn->retry),*earliest)))
+    {
+        *earliest = &(conn->retry);
+    }
+
+    return highfd;
+}
+
+
+/*=========================================================================*/
+int NetworkConnectService(NetworkConnect* conn,
+                          fd_set* writefds,
+                          struct timeval* now)
+/* Takes the first attempt that completed and closes the others, or starts */
+/* another attempt when it is time to                                      */
+/*                                                                         */
+/* Returns  -    a connected, non-blocking socket that now belongs to the  */
+/*               caller, -1 while connecting or -2 if the peer refused     */
+/*=========================================================================*/
+{
+    int             sock;
+    int             error;
+    int             i;
+    int             j;
+#ifdef _WIN32
+    int             errorlen;
+#else
+    socklen_t       errorlen;
+#endif
+
+    for(i = 0; i < conn->attempts; i++)
+    {
+        sock = conn->socks[i];
+        if(sock < 0 || FD_ISSET(sock,writefds) == 0)
+        {
+            continue;
+        }
+
+        error = 0;
+        errorlen = sizeof(error);
+        getsockopt(sock,SOL_SOCKET,SO_ERROR,(char*)&error,&errorlen);
+        if(error)
+        {
+            /* the others will not fare any better */
+            NetworkConnectAbort(conn);
+            return -2;
+        }
+
+        /* a connect takes one round trip, whichever attempt it was */
+        KnownDARttSample(&(conn->peeraddr.sin_addr),
+                         (now->tv_sec - conn->started[i].tv_sec) * 1000 +
+                         (now->tv_usec - conn->started[i].tv_usec) / 1000);
+        for(j = i + 1; j < conn->attempts; j++)
+        {
+            /* the SYN of attempt i was not lost, only slow */
+            KnownDARttRetransmit(1);
+        }
+        conn->socks[i] = -1;
+        NetworkConnectAbort(conn);
+        return sock;
+    }
+
+    if(NetworkConnectCanRetry(conn) && NetworkIsBefore(&(conn->retry),now))
+    {
+        KnownDARttRetransmit(0);
+        if(NetworkConnectAttempt(conn))
+        {
+            /* out of sockets, wait for the ones we have */
+            conn->timeouts[conn->attempts - 1] = 0;
+        }
+    }
+
+    return -1;
+}
+
+
+/*=========================================================================*/
+void NetworkConnectAbort(NetworkConnect* conn)
+/* Closes the attempts of a connect that is given up                       */
+/*=========================================================================*/
+{
+    int i;
+
+    for(i = 0; i < conn->attempts; i++)
+    {
+        if(conn->socks[i] >= 0)
+        {
+#ifdef _WIN32
+            closesocket(conn->socks[i]);
+#else
+            close(conn->socks[i]);
+#endif
+            conn->socks[i] = -1;
+        }
+    }
+}
+
+
+/*=========================================================================*/
+int NetworkConnectStream(struct sockaddr_in* peeraddr,
+                         struct timeval* timeout)
+/* SLPNetworkConnectStream() with the retries above, honouring timeout     */
+/*                                                                         */
+/* Returns  -    a connected, blocking socket or -1                        */
+/*=========================================================================*/
+{
+    NetworkConnect  conn;
+    struct timeval  deadline;
+    struct timeval  now;
+    struct timeval  wait;
+    struct timeval* earliest;
+    fd_set          writefds;
+    int             highfd;
+    int             sock;
+#ifdef _WIN32
+    u_long          fdflags;
+    char            lowat;
+#else
+    int             fdflags;
+    int             lowat;
+#endif
+
+    if(NetworkConnectStart(&conn,peeraddr))
+    {
+        return -1;
+    }
+    NetworkSetDeadline(&deadline,
+                       timeout->tv_sec * 1000 + timeout->tv_usec / 1000);
+
+    while(1)
+    {
+        FD_ZERO(&writefds);
+        earliest = &deadline;
+        highfd = NetworkConnectFds(&conn,&writefds,-1,&earliest);
+
+        gettimeofday(&now,0);
+        wait.tv_sec = 0;
+        wait.tv_usec = 0;
+        if(NetworkIsBefore(&now,earliest))
+        {
+            wait.tv_sec  = earliest->tv_sec - now.tv_sec;
+            wait.tv_usec = earliest->tv_usec - now.tv_usec;
+            if(wait.tv_usec < 0)
+            {
+                wait.tv_sec  -= 1;
+                wait.tv_usec += 1000000;
+            }
+        }
+        if(select(highfd + 1,0,&writefds,0,&wait) < 0)
+        {
+            FD_ZERO(&writefds);
+        }
+
+        gettimeofday(&now,0);
+        sock = NetworkConnectService(&conn,&writefds,&now);
+        if(sock >= 0)
+        {
+            break;
+        }
+        if(sock == -2 || NetworkIsBefore(&deadline,&now))
+        {
+            NetworkConnectAbort(&conn);
+            return -1;
+        }
+    }
+
+#ifdef _WIN32
+    fdflags = 0;
+    ioctlsocket(sock, FIONBIO, &fdflags);
+#else
+    fdflags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock,F_SETFL, fdflags & ~O_NONBLOCK);
+#endif
+    /* the low water marks SLPNetworkConnectStream() sets */
+    lowat = 18;
+    setsockopt(sock,SOL_SOCKET,SO_RCVLOWAT,&lowat,sizeof(lowat));
+    setsockopt(sock,SOL_SOCKET,SO_SNDLOWAT,&lowat,sizeof(lowat));
+
+    return sock;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPBuffer NetworkBuildMessage(SLPBuffer sendbuf,
+                                     const char* langtag,
+                                     char* buf,
+                                     char buftype,
+                                     int bufsize,
+                                     int flags,
+                                     const char* prlist,
+                                     int xid)
+/* Lays out a request the way the other engines do                         */
+/*-------------------------------------------------------------------------*/
+{
+    int langtaglen  = strlen(langtag);
+    int prlistlen   = strlen(prlist);
+    int size;
+
+    size = 14 + langtaglen + 2 + prlistlen + bufsize;
+    sendbuf = SLPBufferRealloc(sendbuf,size);
+    if(sendbuf)
+    {
+        /*version*/
+        *(sendbuf->start)       = 2;
+        /*function id*/
+        *(sendbuf->start + 1)   = buftype;
+        /*length*/
+        ToUINT24(sendbuf->start + 2, size);
+        /*flags*/
+        ToUINT16(sendbuf->start + 5, flags);
+        /*ext offset*/
+        ToUINT24(sendbuf->start + 7,0);
+        /*xid*/
+        ToUINT16(sendbuf->start + 10,xid);
+        /*lang tag len*/
+        ToUINT16(sendbuf->start + 12,langtaglen);
+        /*lang tag*/
+        memcpy(sendbuf->start + 14, langtag, langtaglen);
+        sendbuf->curpos = sendbuf->start + langtaglen + 14;
+        /*prlist*/
+        ToUINT16(sendbuf->curpos,prlistlen);
+        sendbuf->curpos = sendbuf->curpos + 2;
+        memcpy(sendbuf->curpos,prlist,prlistlen);
+        sendbuf->curpos = sendbuf->curpos + prlistlen;
+        /*the rest of the message*/
+        memcpy(sendbuf->curpos,buf,bufsize);
+    }
+
+    return sendbuf;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void NetworkParallelReply(NetworkParallel* p,
+                                 struct sockaddr_in* peeraddr,
+                                 int isda)
+/* Reports a reply and adds its sender to the multicast prlist, so DAs     */
+/* that already answered are not asked again                               */
+/*-------------------------------------------------------------------------*/
+{
+    char*   peeraddrstr;
+    int     peeraddrstrlen;
+
+    p->rplycount += 1;
+    if(p->callback(SLP_OK,peeraddr,p->recvbuf,p->cookie) == SLP_FALSE)
+    {
+        /* Caller does not want any more info */
+        p->stopped = 1;
+        return;
+    }
+
+    if(isda == 0)
+    {
+        /* only replies to the multicast tell whether it has converged */
+        p->mcastrplycount += 1;
+        if(p->quietwait)
+        {
+            NetworkSetDeadline(&(p->quietdeadline),p->quietwait);
+        }
+    }
+
+    peeraddrstr = inet_ntoa(peeraddr->sin_addr);
+    peeraddrstrlen = strlen(peeraddrstr);
+    if(p->prlist && p->prlistlen + peeraddrstrlen + 1 < p->mtu)
+    {
+        if(p->prlistlen)
+        {
+            strcat(p->prlist,",");
+        }
+        strcat(p->prlist,peeraddrstr);
+        p->prlistlen = strlen(p->prlist);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void NetworkMcastEnd(NetworkParallel* p, SLPError result)
+/*-------------------------------------------------------------------------*/
+{
+    p->mcast = 2;
+    SLPXcastSocketsClose(&(p->xcastsocks));
+    if(result == SLP_OK)
+    {
+        p->succeeded += 1;
+    }
+    else
+    {
+        p->result = result;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void NetworkMcastXmit(NetworkParallel* p)
+/* Sends the next round of the multicast convergence algorithm             */
+/*-------------------------------------------------------------------------*/
+{
+    int result;
+
+    p->xmitcount++;
+    if(p->xmitcount >= MAX_RETRANSMITS)
+    {
+        NetworkMcastEnd(p,SLP_OK);
+        return;
+    }
+    p->totaltimeout += p->timeouts[p->xmitcount];
+    if(p->totaltimeout >= p->maxwait || p->timeouts[p->xmitcount] == 0)
+    {
+        NetworkMcastEnd(p,SLP_OK);
+        return;
+    }
+
+    /* the prlist may not push the datagram past the MTU */
+    if(14 + strlen(p->handle->langtag) + 2 + p->prlistlen + p->bufsize > p->mtu)
+    {
+        NetworkMcastEnd(p,p->xmitcount == 1 ? SLP_BUFFER_OVERFLOW : SLP_OK);
+        return;
+    }
+    p->mcastbuf = NetworkBuildMessage(p->mcastbuf,
+                                      p->handle->langtag,
+                                      p->buf,
+                                      p->buftype,
+                                      p->bufsize,
+                                      SLP_FLAG_MCAST,
+                                      p->prlist,
+                                      p->xid);
+    if(p->mcastbuf == 0)
+    {
+        NetworkMcastEnd(p,SLP_MEMORY_ALLOC_FAILED);
+        return;
+    }
+
+    SLPXcastSocketsClose(&(p->xcastsocks));
+    if(p->usebroadcast)
+    {
+        result = SLPBroadcastSend(&(p->ifaceinfo),p->mcastbuf,&(p->xcastsocks));
+    }
+    else
+    {
+        result = SLPMulticastSend(&(p->ifaceinfo),p->mcastbuf,&(p->xcastsocks));
+    }
+    if(result != 0)
+    {
+        NetworkMcastEnd(p,SLP_NETWORK_ERROR);
+        return;
+    }
+
+    NetworkSetDeadline(&(p->deadline),p->timeouts[p->xmitcount]);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void NetworkMcastStart(NetworkParallel* p)
+/* Starts multicast convergence unless it already ran                      */
+/*-------------------------------------------------------------------------*/
+{
+    if(p->mcast)
+    {
+        return;
+    }
+    p->mcast = 1;
+
+#ifndef MI_NOT_SUPPORTED
+    if(p->handle->McastIFList != NULL)
+    {
+        SLPIfaceGetInfo(p->handle->McastIFList,&(p->ifaceinfo));
+    }
+    else
+#endif /* MI_NOT_SUPPORTED */
+    if(SLPIfaceGetInfo(SLPGetProperty("net.slp.interfaces"),&(p->ifaceinfo)))
+    {
+        NetworkMcastEnd(p,SLP_NETWORK_ERROR);
+        return;
+    }
+    p->usebroadcast = SLPPropertyAsBoolean(SLPGetProperty("net.slp.useBroadcast"));
+    p->maxwait = SLPPropertyAsInteger(SLPGetProperty("net.slp.multicastMaximumWait"));
+    SLPPropertyAsIntegerVector(SLPGetProperty("net.slp.multicastTimeouts"),
+                               p->timeouts,
+                               MAX_RETRANSMITS);
+    p->xid = SLPXidGenerate();
+
+    NetworkMcastXmit(p);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static NetworkPeer* NetworkHedgePartner(NetworkParallel* p,
+                                        NetworkPeer* peer)
+/* Returns the other DA of a hedged pair if it is still being asked        */
+/*-------------------------------------------------------------------------*/
+{
+    NetworkPeer*    other;
+
+    if(p->hedge != 2)
+    {
+        return 0;
+    }
+    other = &(p->peers[0]);
+    if(peer == other)
+    {
+        other = &(p->peers[p->hedgepeer]);
+    }
+    else if(peer != &(p->peers[p->hedgepeer]))
+    {
+        return 0;
+    }
+
+    return other->state == PEER_DONE ? 0 : other;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void NetworkPeerEnd(NetworkParallel* p,
+                           NetworkPeer* peer,
+                           SLPError result)
+/* Closes a peer's connection.  A DA that failed is marked bad and         */
+/* multicast takes over right away                                         */
+/*-------------------------------------------------------------------------*/
+{
+    if(peer->sock >= 0 && result == SLP_OK && peer->isda && p->keepda == 0)
+    {
+        /* the reply was read, another request may use the connection */
+        KnownDAPoolPut(peer->sock,&(peer->peeraddr.sin_addr));
+        peer->sock = -1;
+    }
+    else if(peer->sock >= 0 && (result != SLP_OK || p->keepda == 0 || peer->isda == 0))
+    {
+#ifdef _WIN32
+        closesocket(peer->sock);
+#else
+        close(peer->sock);
+#endif
+        peer->sock = -1;
+    }
+    NetworkConnectAbort(&(peer->conn));
+    peer->state = PEER_DONE;
+
+    if(result == SLP_OK)
+    {
+        p->succeeded += 1;
+        return;
+    }
+
+    p->result = result;
+    if(peer->isda)
+    {
+        KnownDABadDA(&(peer->peeraddr.sin_addr));
+        if(p->hedge == 1)
+        {
+            /* the hedge was only a guard against a slow DA */
+            p->hedge = 0;
+        }
+        if(NetworkHedgePartner(p,peer) == 0)
+        {
+            NetworkMcastStart(p);
+        }
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void NetworkPeerStart(NetworkParallel* p,
+                             struct sockaddr_in* peeraddr,
+                             int isda,
+                             int flags)
+/* Starts a non-blocking connect to a peer, or borrows a connection to a   */
+/* DA from the pool                                                        */
+/*-------------------------------------------------------------------------*/
+{
+    NetworkPeer*    peer;
+#ifdef _WIN32
+    u_long          fdflags;
+#else
+    int             fdflags;
+#endif
+
+    if(p->peercount == MAX_PARALLEL_PEERS)
+    {
+        return;
+    }
+    peer = &(p->peers[p->peercount++]);
+    memset(peer,0,sizeof(NetworkPeer));
+    memcpy(&(peer->peeraddr),peeraddr,sizeof(struct sockaddr_in));
+    peer->isda = isda;
+    peer->xid = SLPXidGenerate();
+    peer->state = PEER_CONNECT;
+    gettimeofday(&(peer->started),0);
+
+    peer->sendbuf = NetworkBuildMessage(0,
+                                        p->handle->langtag,
+                                        p->buf,
+                                        p->buftype,
+                                        p->bufsize,
+                                        flags,
+                                        "",
+                                        peer->xid);
+    peer->sock = isda ? KnownDAPoolGet(&(peeraddr->sin_addr)) : -1;
+    if(peer->sendbuf == 0 ||
+       (peer->sock < 0 && NetworkConnectStart(&(peer->conn),peeraddr)))
+    {
+        NetworkPeerEnd(p,peer,SLP_NETWORK_ERROR);
+        return;
+    }
+
+    if(peer->sock >= 0)
+    {
+#ifdef _WIN32
+        fdflags = 1;
+        ioctlsocket(peer->sock, FIONBIO, &fdflags);
+#else
+        fdflags = fcntl(peer->sock, F_GETFL, 0);
+        fcntl(peer->sock,F_SETFL, fdflags | O_NONBLOCK);
+#endif
+    }
+
+    /* connect like KnownDAConnect() would, then wait like NetworkRqstRply() */
+    NetworkSetDeadline(&(peer->deadline),
+                       SLPPropertyAsInteger(SLPGetProperty("net.slp.DADiscoveryMaximumWait")));
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void NetworkPeerService(NetworkParallel* p,
+                               NetworkPeer* peer,
+                               fd_set* readfds,
+                               fd_set* writefds,
+                               struct timeval* now)
+/*-------------------------------------------------------------------------*/
+{
+    struct timeval  timeout;
+    NetworkPeer*    other;
+    int             error;
+#ifdef _WIN32
+    int             errorlen;
+#else
+    socklen_t       errorlen;
+#endif
+
+    if(peer->state == PEER_CONNECT && peer->sock < 0)
+    {
+        peer->sock = NetworkConnectService(&(peer->conn),writefds,now);
+        if(peer->sock == -2)
+        {
+            peer->sock = -1;
+            NetworkPeerEnd(p,peer,SLP_NETWORK_ERROR);
+            return;
+        }
+    }
+
+    if(peer->state == PEER_CONNECT &&
+       peer->sock >= 0 &&
+       FD_ISSET(peer->sock,writefds))
+    {
+        error = 0;
+        errorlen = sizeof(error);
+        getsockopt(peer->sock,SOL_SOCKET,SO_ERROR,(char*)&error,&errorlen);
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 0;
+        if(error ||
+           SLPNetworkSendMessage(peer->sock,
+                                 SOCK_STREAM,
+                                 peer->sendbuf,
+                                 &(peer->peeraddr),
+                                 &timeout))
+        {
+            NetworkPeerEnd(p,peer,SLP_NETWORK_ERROR);
+            return;
+        }
+        peer->state = PEER_RECV;
+        NetworkSetDeadline(&(peer->deadline),
+                           SLPPropertyAsInteger(SLPGetProperty("net.slp.unicastMaximumWait")));
+    }
+    else if(peer->state == PEER_RECV && FD_ISSET(peer->sock,readfds))
+    {
+        /* the rest of the reply follows its first bytes closely */
+        timeout.tv_sec = peer->deadline.tv_sec - now->tv_sec;
+        timeout.tv_usec = peer->deadline.tv_usec - now->tv_usec;
+        if(timeout.tv_usec < 0)
+        {
+            timeout.tv_sec  -= 1;
+            timeout.tv_usec += 1000000;
+        }
+        if(timeout.tv_sec < 0)
+        {
+            timeout.tv_sec = 0;
+            timeout.tv_usec = 0;
+        }
+        if(SLPNetworkRecvMessage(peer->sock,
+                                 SOCK_STREAM,
+                                 &(p->recvbuf),
+                                 &(peer->peeraddr),
+                                 &timeout))
+        {
+            NetworkPeerEnd(p,
+                           peer,
+                           errno == ETIMEDOUT ? SLP_NETWORK_TIMED_OUT : SLP_NETWORK_ERROR);
+            return;
+        }
+        if(AsUINT16(p->recvbuf->start + 10) != peer->xid)
+        {
+            NetworkPeerEnd(p,peer,SLP_NETWORK_ERROR);
+            return;
+        }
+        if(peer->isda)
+        {
+            KnownDARttReply(&(peer->peeraddr.sin_addr),
+                            (now->tv_sec - peer->started.tv_sec) * 1000 +
+                            (now->tv_usec - peer->started.tv_usec) / 1000);
+            other = NetworkHedgePartner(p,peer);
+            if(other)
+            {
+                /* the slower of the pair is not needed, nor is it bad, */
+                /* but it took at least this long                        */
+                KnownDARttReply(&(other->peeraddr.sin_addr),
+                                (now->tv_sec - other->started.tv_sec) * 1000 +
+                                (now->tv_usec - other->started.tv_usec) / 1000);
+                if(other->sock >= 0)
+                {
+#ifdef _WIN32
+                    closesocket(other->sock);
+#else
+                    close(other->sock);
+#endif
+                    other->sock = -1;
+                }
+                NetworkConnectAbort(&(other->conn));
+                other->state = PEER_DONE;
+            }
+        }
+        NetworkPeerEnd(p,peer,SLP_OK);
+        NetworkParallelReply(p,&(peer->peeraddr),peer->isda);
+        return;
+    }
+
+    if(peer->state != PEER_DONE && NetworkIsBefore(&(peer->deadline),now))
+    {
+        NetworkPeerEnd(p,peer,SLP_NETWORK_TIMED_OUT);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void NetworkMcastService(NetworkParallel* p,
+                                fd_set* readfds,
+                                struct timeval* now)
+/*-------------------------------------------------------------------------*/
+{
+    struct sockaddr_in  peeraddr;
+    struct timeval      timeout;
+    int                 readable    = 0;
+    int                 result;
+    int                 i;
+
+    for(i = 0; i < p->xcastsocks.sock_count; i++)
+    {
+        if(FD_ISSET(p->xcastsocks.sock[i],readfds))
+        {
+            readable = 1;
+        }
+    }
+
+    /* read every reply that is already in */
+    while(readable && p->stopped == 0)
+    {
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 0;
+        result = SLPXcastRecvMessage(&(p->xcastsocks),
+                                     &(p->recvbuf),
+                                     &peeraddr,
+                                     &timeout);
+#ifndef UNICAST_NOT_SUPPORTED
+        if(result == SLP_RETRY_UNICAST)
+        {
+            /* ask again over TCP, it does not fit in a datagram */
+            NetworkPeerStart(p,&peeraddr,0,SLP_FLAG_UCAST);
+            continue;
+        }
+#endif
+        if(result != 0)
+        {
+            break;
+        }
+
+        /* Sneek in and check the XID */
+        if(AsUINT16(p->recvbuf->start + 10) == p->xid)
+        {
+            NetworkParallelReply(p,&peeraddr,0);
+        }
+    }
+
+    if(p->stopped)
+    {
+        return;
+    }
+    if(p->quietwait &&
+       p->mcastrplycount &&
+       NetworkIsBefore(&(p->quietdeadline),now))
+    {
+        /* nothing new for a while, the answer has converged */
+        NetworkMcastEnd(p,SLP_OK);
+    }
+    else if(NetworkIsBefore(&(p->deadline),now))
+    {
+        NetworkMcastXmit(p);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void NetworkHedgeService(NetworkParallel* p, struct timeval* now)
+/* Sends the request to the second DA too once the first has been slower   */
+/* than usual, as far as net.slp.DAHedgeBudget allows                      */
+/*-------------------------------------------------------------------------*/
+{
+    struct sockaddr_in  peeraddr;
+
+    if(p->peers[0].state == PEER_DONE)
+    {
+        /* answered in time */
+        p->hedge = 0;
+        return;
+    }
+    if(NetworkIsBefore(now,&(p->hedgedeadline)))
+    {
+        return;
+    }
+    if(KnownDAHedgeSpend() == 0 || p->peercount == MAX_PARALLEL_PEERS)
+    {
+        p->hedge = 0;
+        return;
+    }
+
+    memset(&peeraddr,0,sizeof(peeraddr));
+    peeraddr.sin_family = AF_INET;
+    peeraddr.sin_port = htons(SLP_RESERVED_PORT);
+    peeraddr.sin_addr = p->hedgeaddr;
+    p->hedge = 2;
+    p->hedgepeer = p->peercount;
+    NetworkPeerStart(p,&peeraddr,1,0);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPError NetworkParallelRqstRply(NetworkParallel* p,
+                                        struct in_addr* daaddrs,
+                                        int dacount,
+                                        int uncovered)
+/* Runs the DA conversations and the multicast convergence side by side    */
+/*-------------------------------------------------------------------------*/
+{
+    struct sockaddr_in  peeraddr;
+    struct timeval*     earliest;
+    struct timeval      timeout;
+    struct timeval      now;
+    fd_set              readfds;
+    fd_set              writefds;
+    NetworkPeer*        peer;
+    int                 highfd;
+    int                 delay;
+    int                 i;
+#ifdef _WIN32
+    u_long              fdflags;
+#else
+    int                 fdflags;
+#endif
+
+    memset(&peeraddr,0,sizeof(peeraddr));
+    peeraddr.sin_family = AF_INET;
+    peeraddr.sin_port = htons(SLP_RESERVED_PORT);
+    for(i = 0; i < dacount; i++)
+    {
+        peeraddr.sin_addr = daaddrs[i];
+        NetworkPeerStart(p,&peeraddr,1,0);
+    }
+    if(uncovered)
+    {
+        NetworkMcastStart(p);
+    }
+    else if(dacount == 1 &&
+            p->peers[0].state != PEER_DONE &&
+            KnownDAFindHedge(p->handle,
+                             p->scopelistlen,
+                             p->scopelist,
+                             &daaddrs[0],
+                             &(p->hedgeaddr)))
+    {
+        delay = KnownDAHedgeDelay(&daaddrs[0]);
+        if(delay > 0)
+        {
+            p->hedge = 1;
+            NetworkSetDeadline(&(p->hedgedeadline),delay);
+        }
+    }
+
+    while(p->stopped == 0)
+    {
+        FD_ZERO(&readfds);
+        FD_ZERO(&writefds);
+        highfd = -1;
+        earliest = 0;
+
+        for(i = 0; i < p->peercount; i++)
+        {
+            peer = &(p->peers[i]);
+            if(peer->state == PEER_DONE)
+            {
+                continue;
+            }
+            if(peer->sock < 0)
+            {
+                highfd = NetworkConnectFds(&(peer->conn),&writefds,highfd,&earliest);
+            }
+            else
+            {
+                FD_SET(peer->sock,peer->state == PEER_CONNECT ? &writefds : &readfds);
+                if(peer->sock > highfd)
+                {
+                    highfd = peer->sock;
+                }
+            }
+            if(earliest == 0 || NetworkIsBefore(&(peer->deadline),earliest))
+            {
+                earliest = &(peer->deadline);
+            }
+        }
+        if(p->mcast == 1)
+        {
+            for(i = 0; i < p->xcastsocks.sock_count; i++)
+            {
+                FD_SET(p->xcastsocks.sock[i],&readfds);
+                if(p->xcastsocks.sock[i] > highfd)
+                {
+                    highfd = p->xcastsocks.sock[i];
+                }
+            }
+            if(earliest == 0 || NetworkIsBefore(&(p->deadline),earliest))
+            {
+                earliest = &(p->deadline);
+            }
+            if(p->quietwait &&
+               p->mcastrplycount &&
+               NetworkIsBefore(&(p->quietdeadline),earliest))
+            {
+                earliest = &(p->quietdeadline);
+            }
+        }
+        if(p->hedge == 1 &&
+           earliest &&
+           NetworkIsBefore(&(p->hedgedeadline),earliest))
+        {
+            earliest = &(p->hedgedeadline);
+        }
+        if(earliest == 0)
+        {
+            /* every conversation is over */
+            break;
+        }
+
+        gettimeofday(&now,0);
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 0;
+        if(NetworkIsBefore(&now,earliest))
+        {
+            timeout.tv_sec  = earliest->tv_sec - now.tv_sec;
+            timeout.tv_usec = earliest->tv_usec - now.tv_usec;
+            if(timeout.tv_usec < 0)
+            {
+                timeout.tv_sec  -= 1;
+                timeout.tv_usec += 1000000;
+            }
+        }
+        if(select(highfd + 1,&readfds,&writefds,0,&timeout) < 0)
+        {
+            /* interrupted, only look at the deadlines */
+            FD_ZERO(&readfds);
+            FD_ZERO(&writefds);
+        }
+
+        gettimeofday(&now,0);
+        for(i = 0; i < p->peercount && p->stopped == 0; i++)
+        {
+            if(p->peers[i].state != PEER_DONE)
+            {
+                NetworkPeerService(p,&(p->peers[i]),&readfds,&writefds,&now);
+            }
+        }
+        if(p->mcast == 1 && p->stopped == 0)
+        {
+            NetworkMcastService(p,&readfds,&now);
+        }
+        if(p->hedge == 1 && p->stopped == 0)
+        {
+            NetworkHedgeService(p,&now);
+        }
+    }
+
+    /* keep the connection to a DA that answered the whole request alone */
+    peer = 0;
+    for(i = 0; i < p->peercount && p->keepda; i++)
+    {
+        if(p->peers[i].isda && p->peers[i].sock >= 0)
+        {
+            peer = &(p->peers[i]);
+        }
+    }
+    if(peer && peer->state == PEER_DONE)
+    {
+#ifdef _WIN32
+        fdflags = 0;
+        ioctlsocket(peer->sock, FIONBIO, &fdflags);
+#else
+        fdflags = fcntl(peer->sock, F_GETFL, 0);
+        fcntl(peer->sock,F_SETFL, fdflags & ~O_NONBLOCK);
+#endif
+        KnownDAPoolPut(p->handle->dasock,&(p->handle->daaddr.sin_addr));
+        p->handle->dasock = peer->sock;
+        memcpy(&(p->handle->daaddr),&(peer->peeraddr),sizeof(struct sockaddr_in));
+        if(p->handle->dascope) xfree(p->handle->dascope);
+        p->handle->dascope = memdup(p->scopelist,p->scopelistlen);
+        p->handle->dascopelen = p->scopelistlen;
+        peer->sock = -1;
+    }
+
+    for(i = 0; i < p->peercount; i++)
+    {
+        if(p->peers[i].sock >= 0)
+        {
+#ifdef _WIN32
+            closesocket(p->peers[i].sock);
+#else
+            close(p->peers[i].sock);
+#endif
+        }
+        SLPBufferFree(p->peers[i].sendbuf);
+    }
+
+    if(p->stopped)
+    {
+        return SLP_OK;
+    }
+
+    /*---------------------------------------------------------------------*/
+    /* Notify the callback with SLP_LAST_CALL so that they know we're done */
+    /*---------------------------------------------------------------------*/
+    if(p->rplycount || p->succeeded || p->result == SLP_NETWORK_TIMED_OUT)
+    {
+        p->callback(SLP_LAST_CALL,NULL,NULL,p->cookie);
+        return SLP_OK;
+    }
+    p->callback(p->result,NULL,NULL,p->cookie);
+
+    return p->result;
+}
+
+
+/*=========================================================================*/ 
+SLPError NetworkMultiRqstRply(PSLPHandleInfo handle,
+                              const char* scopelist,
+                              int scopelistlen,
+                              char* buf,
+                              char buftype,
+                              int bufsize,
+                              NetworkRplyCallback callback,
+                              void* cookie)
+/* Asks the DAs that support the scopes of a request and multicasts for    */
+/* the scopes that none supports, all at the same time.  The replies       */
+/* reach the callback as one stream followed by a single SLP_LAST_CALL.    */
+/* A DA that fails is replaced by multicast at once, and the exchange      */
+/* stops as soon as the callback returns SLP_FALSE or, when                */
+/* net.slp.multicastQuietWait is set, once the replies stop coming.        */
+/*                                                                         */
+/* handle       (IN) the SLPHandle the request was made on                 */
+/*                                                                         */
+/* scopelist    (IN) the scopes of the request                             */
+/*                                                                         */
+/* scopelistlen (IN) length of scopelist                                   */
+/*                                                                         */
+/* buf          (IN) describes the message body                            */
+/*                                                                         */
+/* buftype      (IN) the function-id to use in the SLPMessage header       */
+/*                                                                         */
+/* bufsize      (IN) the size of the buffer pointed to by buf              */
+/*                                                                         */
+/* callback     (IN) the callback to use for reporting results             */
+/*                                                                         */
+/* cookie       (IN) the cookie to pass to the callback                    */
+/*                                                                         */
+/* Returns  -   SLP_OK on success. SLP_ERROR on failure                    */
+/*=========================================================================*/ 
+{
+    struct sockaddr_in  peeraddr;
+    struct in_addr      daaddrs[MAX_PARALLEL_DAS];
+    NetworkParallel*    p;
+    SLPError            result;
+    int                 dacount;
+    int                 uncovered;
+    int                 sock;
+
+    /*-------------------------------------------------------------*/
+    /* a connection kept from the last request is asked on its own */
+    /*-------------------------------------------------------------*/
+    if(handle->dasock >= 0 &&
+       SLPPropertyAsInteger(SLPGetProperty("net.slp.DAHedgeBudget")) > 0)
+    {
+        /* a request that may be hedged takes the parallel engine,   */
+        /* which borrows the connection back from the pool            */
+        KnownDAPoolPut(handle->dasock,&(handle->daaddr.sin_addr));
+        handle->dasock = -1;
+    }
+    if(handle->dasock >= 0 &&
+       handle->dascope &&
+       SLPCompareString(handle->dascopelen,
+                        handle->dascope,
+                        scopelistlen,
+                        scopelist) == 0)
+    {
+        sock = NetworkConnectToDA(handle,scopelist,scopelistlen,&peeraddr);
+        result = NetworkRqstRply(sock,
+                                 &peeraddr,
+                                 handle->langtag,
+                                 0,
+                                 buf,
+                                 buftype,
+                                 bufsize,
+                                 callback,
+                                 cookie);
+        if(result == SLP_OK)
+        {
+            return SLP_OK;
+        }
+        NetworkDisconnectDA(handle);
+    }
+
+    dacount = KnownDAFindForScopes(handle,
+                                   scopelistlen,
+                                   scopelist,
+                                   daaddrs,
+                                   MAX_PARALLEL_DAS,
+                                   &uncovered);
+    if(dacount == 0)
+    {
+        /* multicast alone, still stopping at net.slp.multicastQuietWait */
+        uncovered = 1;
+    }
+
+#if defined(ENABLE_ASYNC_API) && !defined(_WIN32)
+    if(AsyncRqstIsStarting(cookie))
+    {
+        return AsyncMultiRqstRply(handle,
+                                  scopelist,
+                                  scopelistlen,
+                                  daaddrs,
+                                  dacount,
+                                  uncovered,
+                                  buf,
+                                  buftype,
+                                  bufsize,
+                                  callback,
+                                  cookie);
+    }
+#endif
+
+    p = (NetworkParallel*)xmalloc(sizeof(NetworkParallel));
+    if(p == 0)
+    {
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+    memset(p,0,sizeof(NetworkParallel));
+    p->handle = handle;
+    p->scopelist = scopelist;
+    p->scopelistlen = scopelistlen;
+    p->keepda = (dacount == 1 && uncovered == 0);
+    p->buf = buf;
+    p->buftype = buftype;
+    p->bufsize = bufsize;
+    p->callback = callback;
+    p->cookie = cookie;
+    p->result = SLP_OK;
+    p->quietwait = SLPPropertyAsInteger(SLPGetProperty("net.slp.multicastQuietWait"));
+    p->mtu = SLPPropertyAsInteger(SLPGetProperty("net.slp.MTU"));
+    p->prlist = (char*)xmalloc(p->mtu);
+    p->recvbuf = SLPBufferAlloc(SLP_MAX_DATAGRAM_SIZE);
+    if(p->prlist == 0 || p->recvbuf == 0)
+    {
+        result = SLP_MEMORY_ALLOC_FAILED;
+    }
+    else
+    {
+        *(p->prlist) = 0;
+        result = NetworkParallelRqstRply(p,daaddrs,dacount,uncovered);
+    }
+
+    SLPBufferFree(p->mcastbuf);
+    SLPBufferFree(p->recvbuf);
+    if(p->prlist) xfree(p->prlist);
+    xfree(p);
+
+    return result;
+}
@@ -145,7 +145,8 @@ SLPError SLPAPI SLPEscape(const char* pcInbuf,
 /*              or the appropriate error code if another error occurs.     */
 /*=========================================================================*/
 {
-    char        *current_inbuf, *current_outBuf;
+    const char  *current_inbuf, *inbuf_end, *special;
+    char        *current_outBuf;
     int         amount_of_escape_characters;
     char        hex_digit;
 
@@ -156,13 +157,16 @@ SLPError SLPAPI SLPEscape(const char* pcInbuf,
     /* 
      * Loop thru the string, counting the number of reserved characters 
      * and checking for bad tags when required.  This is also used to 
-     * calculate the size of the new string to create.
+     * calculate the size of the new string to create.  SLPScanSpecial()
+     * skips over runs of ordinary characters so only the candidates have
+     * to be classified here.
      * ASSUME: that pcInbuf is a NULL terminated string. 
      */
-    current_inbuf = (char *) pcInbuf;
+    inbuf_end = pcInbuf + strlen(pcInbuf);
+    current_inbuf = SLPScanSpecial(pcInbuf, inbuf_end);
     amount_of_escape_characters = 0;
 
-    while(*current_inbuf != '\0')
+    while(current_inbuf < inbuf_end)
     {
         /* Ensure that there are no bad tags when it is a tag. */
         if((isTag) && strchr(ATTRIBUTE_BAD_TAG, *current_inbuf))
@@ -174,25 +178,32 @@ SLPError SLPAPI SLPEscape(const char* pcInbuf,
           )
             amount_of_escape_characters++;
 
-        current_inbuf++;
+        current_inbuf = SLPScanSpecial(current_inbuf + 1, inbuf_end);
     } /* End While. */
 
     /* Allocate the string. */
     *ppcOutBuf = (char *) xmalloc(
                                 sizeof(char) * 
-                                (strlen(pcInbuf) + (amount_of_escape_characters * 2) + 1));
+                                ((inbuf_end - pcInbuf) + (amount_of_escape_characters * 2) + 1));
 
-    if(ppcOutBuf == NULL)
+    if(*ppcOutBuf == NULL)
         return(SLP_MEMORY_ALLOC_FAILED);
 
     /*
-     * Go over it, again.  Replace each of the escape characters with their 
-     * \hex equivalent.
+     * Go over it, again.  Copy runs of ordinary characters as a block and
+     * replace each of the escape characters with their \hex equivalent.
      */
-    current_inbuf = (char *) pcInbuf;
+    current_inbuf = pcInbuf;
     current_outBuf = *ppcOutBuf;
-    while(*current_inbuf != '\0')
+    while(current_inbuf < inbuf_end)
     {
+        special = SLPScanSpecial(current_inbuf, inbuf_end);
+        memcpy(current_outBuf, current_inbuf, special - current_inbuf);
+        current_outBuf += special - current_inbuf;
+        current_inbuf = special;
+        if(current_inbuf == inbuf_end)
+            break;
+
         /* Check to see if it is an escape character. */
         if((strchr(ATTRIBUTE_RESERVE_STRING, *current_inbuf)) || 
            ((*current_inbuf >= 0x00) && (*current_inbuf <= 0x1F)) ||
@@ -264,7 +275,8 @@ SLPError SLPAPI SLPUnescape(const char* pcInbuf,
 /*=========================================================================*/
 {
     int     output_buffer_size;
-    char    *current_Inbuf, *current_OutBuf;
+    const char *current_Inbuf, *inbuf_end, *escape;
+    char    *current_OutBuf;
     char    escaped_digit[2];
 
     /* Ensure that the parameters are good. */
@@ -274,67 +286,86 @@ SLPError SLPAPI SLPUnescape(const char* pcInbuf,
     /* 
      * Loop thru the string, counting the number of escape characters 
      * and checking for bad tags when required.  This is also used to 
-     * calculate the size of the new string to create.
+     * calculate the size of the new string to create.  Both the escape
+     * character and the bad tag characters are found by SLPScanSpecial().
      * ASSUME: that pcInbuf is a NULL terminated string. 
      */
-    current_Inbuf = (char *) pcInbuf;
     output_buffer_size = strlen(pcInbuf);
+    inbuf_end = pcInbuf + output_buffer_size;
+    current_Inbuf = SLPScanSpecial(pcInbuf, inbuf_end);
 
-    while(*current_Inbuf != '\0')
+    while(current_Inbuf < inbuf_end)
     {
         /* Ensure that there are no bad tags when it is a tag. */
         if((isTag) && strchr(ATTRIBUTE_BAD_TAG, *current_Inbuf))
             return(SLP_PARSE_ERROR);
 
-        if(strchr(ESCAPE_CHARACTER_STRING, *current_Inbuf))
+        if(*current_Inbuf == ESCAPE_CHARACTER)
             output_buffer_size-=2;
 
-        current_Inbuf++;
+        current_Inbuf = SLPScanSpecial(current_Inbuf + 1, inbuf_end);
     } /* End While. */
 
     /* Allocate the string. */
     *ppcOutBuf = (char *) xmalloc((sizeof(char) * output_buffer_size) + 1);
 
-    if(ppcOutBuf == NULL)
+    if(*ppcOutBuf == NULL)
         return(SLP_MEMORY_ALLOC_FAILED);
 
-    current_Inbuf = (char *) pcInbuf;
+    current_Inbuf = pcInbuf;
     current_OutBuf = *ppcOutBuf;
 
-    while(*current_Inbuf != '\0')
+    while(current_Inbuf < inbuf_end)
     {
-        /* Check to see if it is an escape character. */
-        if(strchr(ESCAPE_CHARACTER_STRING, *current_Inbuf))
+        /* Copy everything up to the next escape character as a block. */
+        escape = memchr(current_Inbuf, ESCAPE_CHARACTER, inbuf_end - current_Inbuf);
+        if(escape == NULL)
+            escape = inbuf_end;
+        memcpy(current_OutBuf, current_Inbuf, escape - current_Inbuf);
+        current_OutBuf += escape - current_Inbuf;
+        current_Inbuf = escape;
+        if(current_Inbuf == inbuf_end)
+            break;
+
+        /* An escape needs two hex digits after it. */
+        if(inbuf_end - current_Inbuf < 3)
         {
-            /* Insert the real character based on the escaped character. */
-            escaped_digit[0] = *(current_Inbuf + sizeof(char));
-            escaped_digit[1] = *(current_Inbuf + (sizeof(char) * 2));
-
-            if((escaped_digit[0] >= 'A') && (escaped_digit[0] <= 'F'))
-                escaped_digit[0] = escaped_digit[0] - 'A' + 0x0A;
-            else if((escaped_digit[0] >= '0') && (escaped_digit[0] <= '9'))
-                escaped_digit[0] = escaped_digit[0] - '0';
-            else
-                return(SLP_PARSE_ERROR);
+            xfree(*ppcOutBuf);
+            *ppcOutBuf = NULL;
+            return(SLP_PARSE_ERROR);
+        }
 
-            if((escaped_digit[1] >= 'A') && (escaped_digit[1] <= 'F'))
-                escaped_digit[1] = escaped_digit[1] - 'A' + 0x0A;
-            else if((escaped_digit[1] >= '0') && (escaped_digit[1] <= '9'))
-                escaped_digit[1] = escaped_digit[1] - '0';
-            else
-                return(SLP_PARSE_ERROR);
+        /* Insert the real character based on the escaped character. */
+        escaped_digit[0] = *(current_Inbuf + sizeof(char));
+        escaped_digit[1] = *(current_Inbuf + (sizeof(char) * 2));
 
-            *current_OutBuf = escaped_digit[1] + (escaped_digit[0] * 0x10);
-            current_Inbuf = (char *) current_Inbuf + (sizeof(char) * 2);
+        if((escaped_digit[0] >= 'A') && (escaped_digit[0] <= 'F'))
+            escaped_digit[0] = escaped_digit[0] - 'A' + 0x0A;
+        else if((escaped_digit[0] >= '0') && (escaped_digit[0] <= '9'))
+            escaped_digit[0] = escaped_digit[0] - '0';
+        else
+        {
+            xfree(*ppcOutBuf);
+            *ppcOutBuf = NULL;
+            return(SLP_PARSE_ERROR);
         }
+
+        if((escaped_digit[1] >= 'A') && (escaped_digit[1] <= 'F'))
+            escaped_digit[1] = escaped_digit[1] - 'A' + 0x0A;
+        else if((escaped_digit[1] >= '0') && (escaped_digit[1] <= '9'))
+            escaped_digit[1] = escaped_digit[1] - '0';
         else
         {
-            *current_OutBuf = *current_Inbuf;
-        } /* End If, Else. */
+            xfree(*ppcOutBuf);
+            *ppcOutBuf = NULL;
+            return(SLP_PARSE_ERROR);
+        }
+
+        *current_OutBuf = escaped_digit[1] + (escaped_digit[0] * 0x10);
 
         /* Move to the next character. */
         current_OutBuf++;
-        current_Inbuf++;
+        current_Inbuf += sizeof(char) * 3;
     } /* End While. */
 
     /* Make sure we terminate the string properly. */
@@ -50,9 +50,51 @@
 #include "slp.h"
 #include "libslp.h"
 
+#ifdef LIBSLP_THREADS
 /*=========================================================================*/
-//int G_PropertyInit  = 0;
+static pthread_mutex_t G_PropertyLoadLock = PTHREAD_MUTEX_INITIALIZER;
+/* Makes sure only one thread reads the configuration file                 */
 /*=========================================================================*/
+#endif
+
+
+/*-------------------------------------------------------------------------*/
+static int PropertyLoad()
+/* Reads the configuration file the first time properties are used.  Once  */
+/* they are loaded properties are read without a lock                      */
+/*                                                                         */
+/* Returns: zero on success, non-zero if the file could not be read        */
+/*-------------------------------------------------------------------------*/
+{
+    char conffile[MAX_PATH]; 
+    int  result = 0;
+
+    if(SLPPropertyIsLoaded())
+    {
+        return 0;
+    }
+
+    memset(conffile,0,MAX_PATH);
+
+    #ifdef _WIN32
+    ExpandEnvironmentStrings(LIBSLP_CONFFILE,conffile,MAX_PATH);
+    #else
+    strncpy(conffile,LIBSLP_CONFFILE,MAX_PATH-1);
+    #endif
+
+    #ifdef LIBSLP_THREADS
+    pthread_mutex_lock(&G_PropertyLoadLock);
+    #endif
+    if(SLPPropertyIsLoaded() == 0)
+    {
+        result = SLPPropertyReadFile(conffile);
+    }
+    #ifdef LIBSLP_THREADS
+    pthread_mutex_unlock(&G_PropertyLoadLock);
+    #endif
+
+    return result;
+}
 
 
 /*=========================================================================*/
@@ -70,28 +112,12 @@ const char* SLPAPI SLPGetProperty(const char* pcName)
 /*          string MUST NOT be freed.                                      */
 /*=========================================================================*/
 {
-    char conffile[MAX_PATH]; 
-    const char* result;
-
-    memset(conffile,0,MAX_PATH);
-
-    #ifdef _WIN32
-    ExpandEnvironmentStrings(LIBSLP_CONFFILE,conffile,MAX_PATH);
-    #else
-    strncpy(conffile,LIBSLP_CONFFILE,MAX_PATH-1);
-    #endif
-
-    if(G_SLPPropertyList.head == NULL)
+    if(PropertyLoad() != 0)
     {
-        if(SLPPropertyReadFile(conffile) != 0)
-        {
-            return 0;
-        }
+        return 0;
     }
 
-    result = SLPPropertyGet(pcName);
-
-    return result;
+    return SLPPropertyGet(pcName);
 } 
 
 
@@ -109,18 +135,11 @@ void SLPAPI SLPSetProperty(const char *pcName,
 /*          character encoding.                                            */
 /*=========================================================================*/
 {
-    /* Following commented out for threading reasons 
-    
-    if(G_PropertyInit.head == NULL)
+    /* Properties are published as a whole, so setting one is safe while */
+    /* other threads read them                                           */
+    if(PropertyLoad() == 0)
     {
-        if(SLPPropertyReadFile(LIBSLP_CONFFILE) == 0)
-        {
-            G_PropertyInit = 1;
-        }
+        SLPPropertySet(pcName,pcValue);
     }
-
-    SLPPropertySet(pcName,pcValue);
-    
-    */
 }
 
@@ -0,0 +1,531 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol Version 2                                         */
+/*                                                                         */
+/* File:        libslp_refresh.c                                           */
+/*                                                                         */
+/* Abstract:    Re-registers the URLs registered through a handle before   */
+/*              their lifetime runs out, turned on by                      */
+/*              net.slp.refreshRegistrations.  Each URL is refreshed at a  */
+/*              random fraction of its lifetime, refreshes that fall due   */
+/*              together go to slpd in one SLPRegBatch(), and failed ones  */
+/*              are retried with an exponential backoff.                   */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+
+
+#include "slp.h"
+#include "libslp.h"
+
+#ifdef LIBSLP_THREADS
+
+#define REFRESH_MIN_PERCENT 60      /* refreshed between 60% and 80% of   */
+#define REFRESH_MAX_PERCENT 80      /* the way through the lifetime       */
+#define REFRESH_COALESCE    5000    /* msecs a refresh is brought forward */
+                                    /* to go out with an earlier one      */
+#define REFRESH_BACKOFF_MIN 2000    /* msecs before the first retry       */
+#define REFRESH_BACKOFF_MAX 300000  /* longest wait between retries       */
+
+/*=========================================================================*/
+typedef struct _SLPRefreshEntry
+/* A registration to keep alive.  The strings follow the entry in the same */
+/* allocation                                                              */
+/*=========================================================================*/
+{
+    SLPListItem     listitem;
+    PSLPHandleInfo  handle;     /* registered through, only compared       */
+    char*           url;
+    char*           attrs;
+    char*           langtag;
+    unsigned short  lifetime;
+    struct timeval  due;
+    struct timeval  expires;
+    int             backoff;    /* msecs, 0 unless the last try failed     */
+    int             inflight;   /* being refreshed by the refresh thread   */
+    int             removed;    /* unlinked while in flight, freed after   */
+}SLPRefreshEntry;
+
+/* G_RefreshLock guards everything below.  Registrations are added from    */
+/* the threads that make them and from the I/O thread, the refresh thread  */
+/* works through them, and exits when there are none left                  */
+static pthread_mutex_t  G_RefreshLock       = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   G_RefreshWake       = PTHREAD_COND_INITIALIZER;
+static SLPList          G_RefreshEntries    = {0, 0, 0};
+static int              G_RefreshRunning    = 0;
+static PSLPHandleInfo   G_RefreshHandle     = 0;
+
+
+/*-------------------------------------------------------------------------*/
+static void RefreshDeadline(struct timeval* deadline,
+                            struct timeval* now,
+                            int msecs)
+/*-------------------------------------------------------------------------*/
+{
+    deadline->tv_sec = now->tv_sec + msecs / 1000;
+    deadline->tv_usec = now->tv_usec + (msecs % 1000) * 1000;
+    if(deadline->tv_usec >= 1000000)
+    {
+        deadline->tv_sec += 1;
+        deadline->tv_usec -= 1000000;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int RefreshIsBefore(struct timeval* a, struct timeval* b)
+/*-------------------------------------------------------------------------*/
+{
+    return (a->tv_sec < b->tv_sec ||
+            (a->tv_sec == b->tv_sec && a->tv_usec < b->tv_usec));
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void RefreshSchedule(SLPRefreshEntry* entry,
+                            struct timeval* now,
+                            unsigned int* seed)
+/* Sets the next refresh of a registration slpd just took.  seed belongs   */
+/* to the calling thread, rand() would be shared with the application      */
+/*-------------------------------------------------------------------------*/
+{
+    int percent;
+
+    percent = REFRESH_MIN_PERCENT +
+              rand_r(seed) % (REFRESH_MAX_PERCENT - REFRESH_MIN_PERCENT + 1);
+    entry->backoff = 0;
+    RefreshDeadline(&(entry->expires),now,entry->lifetime * 1000);
+    RefreshDeadline(&(entry->due),now,entry->lifetime * percent * 10);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int RefreshBackoff(SLPRefreshEntry* entry,
+                          struct timeval* now,
+                          unsigned int* seed)
+/* Sets the retry of a refresh that failed for now.  Retries back off      */
+/* exponentially, with jitter, but come at least twice more before the     */
+/* registration expires.  Returns 0 if it has expired already, there is    */
+/* nothing left to keep alive and the caller drops it                      */
+/*-------------------------------------------------------------------------*/
+{
+    int wait;
+    int left;
+
+    left = (entry->expires.tv_sec - now->tv_sec) * 1000 +
+           (entry->expires.tv_usec - now->tv_usec) / 1000;
+    if(left <= 0)
+    {
+        return 0;
+    }
+
+    entry->backoff = entry->backoff ? entry->backoff * 2 : REFRESH_BACKOFF_MIN;
+    if(entry->backoff > REFRESH_BACKOFF_MAX)
+    {
+        entry->backoff = REFRESH_BACKOFF_MAX;
+    }
+    wait = entry->backoff / 2 + rand_r(seed) % (entry->backoff / 2 + 1);
+
+    if(left / 2 >= REFRESH_BACKOFF_MIN / 2 && wait > left / 2)
+    {
+        wait = left / 2;
+    }
+    else if(wait > left)
+    {
+        /* the last try comes as it expires */
+        wait = left;
+    }
+
+    RefreshDeadline(&(entry->due),now,wait);
+
+    return 1;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void RefreshUnlink(SLPRefreshEntry* entry)
+/* Stops refreshing a registration.  Caller holds G_RefreshLock            */
+/*-------------------------------------------------------------------------*/
+{
+    SLPListUnlink(&G_RefreshEntries,(SLPListItem*)entry);
+    /* the refresh thread may be waiting for it to fall due */
+    pthread_cond_signal(&G_RefreshWake);
+    if(entry->inflight)
+    {
+        /* the refresh thread frees it when its batch is done */
+        entry->removed = 1;
+    }
+    else
+    {
+        xfree(entry);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPRefreshEntry* RefreshFind(PSLPHandleInfo handle, const char* url)
+/* Caller holds G_RefreshLock                                              */
+/*-------------------------------------------------------------------------*/
+{
+    SLPRefreshEntry*    entry;
+
+    entry = (SLPRefreshEntry*)G_RefreshEntries.head;
+    while(entry)
+    {
+        if(entry->handle == handle && strcmp(entry->url,url) == 0)
+        {
+            break;
+        }
+        entry = (SLPRefreshEntry*)entry->listitem.next;
+    }
+
+    return entry;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void RefreshReport(SLPHandle hSLP,
+                          int iItem,
+                          SLPError errCode,
+                          void* pvCookie)
+/*-------------------------------------------------------------------------*/
+{
+    ((SLPError*)pvCookie)[iItem] = errCode;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void RefreshSend(SLPRefreshEntry** entries,
+                        int count,
+                        unsigned int* seed)
+/* Re-registers a batch of registrations that are due, and schedules their */
+/* next refresh.  Called without G_RefreshLock held, returns with it held  */
+/*-------------------------------------------------------------------------*/
+{
+    SLPHandle           hslp;
+    SLPRegItem*         items;
+    SLPError*           results;
+    struct timeval      now;
+    int                 i;
+
+    items = (SLPRegItem*)xmalloc(count * (sizeof(SLPRegItem) + sizeof(SLPError)));
+    if(items)
+    {
+        results = (SLPError*)(items + count);
+        for(i = 0; i < count; i++)
+        {
+            items[i].s_pcSrvURL = entries[i]->url;
+            items[i].s_pcSrvType = 0;
+            items[i].s_pcAttrs = entries[i]->attrs;
+            items[i].s_usLifetime = entries[i]->lifetime;
+            results[i] = SLP_NETWORK_INIT_FAILED;
+        }
+
+        /* the entries are all in the language of the first one */
+        if(SLPOpen(entries[0]->langtag,SLP_FALSE,&hslp) == SLP_OK)
+        {
+            pthread_mutex_lock(&G_RefreshLock);
+            G_RefreshHandle = (PSLPHandleInfo)hslp;
+            pthread_mutex_unlock(&G_RefreshLock);
+
+            SLPRegBatch(hslp,items,count,SLP_TRUE,RefreshReport,results);
+
+            pthread_mutex_lock(&G_RefreshLock);
+            G_RefreshHandle = 0;
+            pthread_mutex_unlock(&G_RefreshLock);
+            SLPClose(hslp);
+        }
+    }
+
+    pthread_mutex_lock(&G_RefreshLock);
+    gettimeofday(&now,0);
+    for(i = 0; i < count; i++)
+    {
+        entries[i]->inflight = 0;
+        if(entries[i]->removed)
+        {
+            xfree(entries[i]);
+            continue;
+        }
+
+        switch(items ? results[i] : SLP_MEMORY_ALLOC_FAILED)
+        {
+        case SLP_OK:
+            RefreshSchedule(entries[i],&now,seed);
+            break;
+
+        case -SLP_ERROR_DA_BUSY_NOW:
+        case SLP_NETWORK_TIMED_OUT:
+        case SLP_NETWORK_INIT_FAILED:
+        case SLP_MEMORY_ALLOC_FAILED:
+        case SLP_NETWORK_ERROR:
+        case SLP_INTERNAL_SYSTEM_ERROR:
+            if(RefreshBackoff(entries[i],&now,seed))
+            {
+                break;
+            }
+            /* expired while slpd could not be reached */
+            RefreshUnlink(entries[i]);
+            break;
+
+        default:
+            /* slpd will not take it, trying again will not help */
+            RefreshUnlink(entries[i]);
+            break;
+        }
+    }
+
+    if(items) xfree(items);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void* RefreshThread(void* arg)
+/*-------------------------------------------------------------------------*/
+{
+    SLPRefreshEntry*    entry;
+    SLPRefreshEntry*    first;
+    SLPRefreshEntry**   entries;
+    struct timeval      now;
+    struct timeval      horizon;
+    struct timespec     wakeup;
+    unsigned int        seed;
+    int                 count;
+
+    gettimeofday(&now,0);
+    seed = (unsigned int)(now.tv_sec ^ now.tv_usec);
+
+    pthread_mutex_lock(&G_RefreshLock);
+    while(G_RefreshEntries.count)
+    {
+        /*---------------------------------------------*/
+        /* Wait for the registration due to be first   */
+        /*---------------------------------------------*/
+        first = 0;
+        entry = (SLPRefreshEntry*)G_RefreshEntries.head;
+        while(entry)
+        {
+            if(first == 0 || RefreshIsBefore(&(entry->due),&(first->due)))
+            {
+                first = entry;
+            }
+            entry = (SLPRefreshEntry*)entry->listitem.next;
+        }
+
+        gettimeofday(&now,0);
+        if(RefreshIsBefore(&now,&(first->due)))
+        {
+            wakeup.tv_sec = first->due.tv_sec;
+            wakeup.tv_nsec = first->due.tv_usec * 1000;
+            pthread_cond_timedwait(&G_RefreshWake,&G_RefreshLock,&wakeup);
+            continue;
+        }
+
+        /*---------------------------------------------------------*/
+        /* Send it along with everything else in its language that */
+        /* falls due soon after                                    */
+        /*---------------------------------------------------------*/
+        RefreshDeadline(&horizon,&now,REFRESH_COALESCE);
+        entries = (SLPRefreshEntry**)xmalloc(G_RefreshEntries.count *
+                                             sizeof(SLPRefreshEntry*));
+        if(entries == 0)
+        {
+            /* try again later */
+            if(RefreshBackoff(first,&now,&seed) == 0)
+            {
+                RefreshUnlink(first);
+            }
+            continue;
+        }
+
+        count = 0;
+        entry = (SLPRefreshEntry*)G_RefreshEntries.head;
+        while(entry)
+        {
+            if(RefreshIsBefore(&(entry->due),&horizon) &&
+               strcmp(entry->langtag,first->langtag) == 0)
+            {
+                entry->inflight = 1;
+                entries[count++] = entry;
+            }
+            entry = (SLPRefreshEntry*)entry->listitem.next;
+        }
+
+        pthread_mutex_unlock(&G_RefreshLock);
+        RefreshSend(entries,count,&seed);
+        xfree(entries);
+    }
+    G_RefreshRunning = 0;
+    pthread_mutex_unlock(&G_RefreshLock);
+
+    return 0;
+}
+
+#endif /* LIBSLP_THREADS */
+
+
+/*=========================================================================*/
+void RefreshAdd(PSLPHandleInfo handle,
+                const char* url,
+                const char* attrs,
+                unsigned short lifetime)
+/* Keeps refreshing a registration slpd just took, if                      */
+/* net.slp.refreshRegistrations asks for that.  Replaces what was kept for */
+/* the URL on the same handle                                              */
+/*=========================================================================*/
+{
+#ifdef LIBSLP_THREADS
+    SLPRefreshEntry*    entry;
+    SLPRefreshEntry*    old;
+    struct timeval      now;
+    pthread_attr_t      attr;
+    pthread_t           thread;
+    unsigned int        seed;
+    int                 urllen;
+    int                 attrslen;
+
+    if(SLPPropertyAsBoolean(SLPGetProperty("net.slp.refreshRegistrations")) == 0)
+    {
+        return;
+    }
+
+    urllen = strlen(url) + 1;
+    attrslen = strlen(attrs) + 1;
+    entry = (SLPRefreshEntry*)xmalloc(sizeof(SLPRefreshEntry) +
+                                      urllen +
+                                      attrslen +
+                                      handle->langtaglen + 1);
+    if(entry == 0)
+    {
+        return;
+    }
+    memset(entry,0,sizeof(SLPRefreshEntry));
+    entry->handle = handle;
+    entry->url = (char*)(entry + 1);
+    memcpy(entry->url,url,urllen);
+    entry->attrs = entry->url + urllen;
+    memcpy(entry->attrs,attrs,attrslen);
+    entry->langtag = entry->attrs + attrslen;
+    memcpy(entry->langtag,handle->langtag,handle->langtaglen);
+    entry->langtag[handle->langtaglen] = 0;
+    entry->lifetime = lifetime;
+
+    pthread_mutex_lock(&G_RefreshLock);
+
+    if(handle == G_RefreshHandle)
+    {
+        /* one of our own refreshes */
+        pthread_mutex_unlock(&G_RefreshLock);
+        xfree(entry);
+        return;
+    }
+
+    gettimeofday(&now,0);
+    /* the calling thread has no seed of its own to keep, the clock and */
+    /* the entry differ from one call to the next                       */
+    seed = (unsigned int)(now.tv_sec ^ now.tv_usec ^ (unsigned long)entry);
+    RefreshSchedule(entry,&now,&seed);
+    old = RefreshFind(handle,url);
+    if(old)
+    {
+        RefreshUnlink(old);
+    }
+    SLPListLinkTail(&G_RefreshEntries,(SLPListItem*)entry);
+
+    if(G_RefreshRunning == 0)
+    {
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+        G_RefreshRunning = (pthread_create(&thread,&attr,RefreshThread,0) == 0);
+        pthread_attr_destroy(&attr);
+    }
+    else
+    {
+        pthread_cond_signal(&G_RefreshWake);
+    }
+
+    pthread_mutex_unlock(&G_RefreshLock);
+#endif
+}
+
+
+/*=========================================================================*/
+void RefreshRemove(PSLPHandleInfo handle, const char* url)
+/* Stops refreshing a URL registered through a handle, it is being         */
+/* deregistered                                                            */
+/*=========================================================================*/
+{
+#ifdef LIBSLP_THREADS
+    SLPRefreshEntry*    entry;
+
+    pthread_mutex_lock(&G_RefreshLock);
+    entry = RefreshFind(handle,url);
+    if(entry)
+    {
+        RefreshUnlink(entry);
+    }
+    pthread_mutex_unlock(&G_RefreshLock);
+#endif
+}
+
+
+/*=========================================================================*/
+void RefreshForget(PSLPHandleInfo handle)
+/* Stops refreshing everything registered through a handle that is being   */
+/* closed.  The registrations live out their lifetime                      */
+/*=========================================================================*/
+{
+#ifdef LIBSLP_THREADS
+    SLPRefreshEntry*    entry;
+    SLPRefreshEntry*    next;
+
+    pthread_mutex_lock(&G_RefreshLock);
+    entry = (SLPRefreshEntry*)G_RefreshEntries.head;
+    while(entry)
+    {
+        next = (SLPRefreshEntry*)entry->listitem.next;
+        if(entry->handle == handle)
+        {
+            RefreshUnlink(entry);
+        }
+        entry = next;
+    }
+    pthread_mutex_unlock(&G_RefreshLock);
+#endif
+}
@@ -89,6 +89,14 @@ SLPBoolean CallbackSrvReg(SLPError errorcode,
         }
     }
 
+    if(errorcode == 0)
+    {
+        RefreshAdd(handle,
+                   handle->params.reg.url,
+                   handle->params.reg.attrlist,
+                   handle->params.reg.lifetime);
+    }
+
     /*----------------------------*/
     /* Call the callback function */
     /*----------------------------*/
@@ -100,12 +108,14 @@ SLPBoolean CallbackSrvReg(SLPError errorcode,
 }
 
 
-/*-------------------------------------------------------------------------*/ 
-SLPError ProcessSrvReg(PSLPHandleInfo handle)
+/*-------------------------------------------------------------------------*/
+static SLPError SrvRegBuild(PSLPHandleInfo handle,
+                            char** bufp,
+                            int* bufsizep,
+                            int* extoffsetp)
+/* Builds the body of a SRVREG for the registration in handle->params.reg  */
 /*-------------------------------------------------------------------------*/
 {
-    int                 sock;
-    struct sockaddr_in  peeraddr;
     int                 bufsize     = 0;
     char*               buf         = 0;
     char*               curpos      = 0;
@@ -256,6 +266,39 @@ SLPError ProcessSrvReg(PSLPHandleInfo handle)
         curpos += 4;
     }
 
+    result = SLP_OK;
+
+    FINISHED:
+#ifdef ENABLE_SLPv2_SECURITY
+    if(urlauth) xfree(urlauth);
+    if(attrauth) xfree(attrauth);
+#endif 
+
+    *bufp = buf;
+    *bufsizep = bufsize;
+    *extoffsetp = extoffset;
+
+    return result;
+}
+
+
+/*-------------------------------------------------------------------------*/ 
+SLPError ProcessSrvReg(PSLPHandleInfo handle)
+/*-------------------------------------------------------------------------*/
+{
+    int                 sock;
+    struct sockaddr_in  peeraddr;
+    int                 bufsize     = 0;
+    char*               buf         = 0;
+    SLPError            result      = 0;
+    int                 extoffset   = 0;
+
+    result = SrvRegBuild(handle,&buf,&bufsize,&extoffset);
+    if(result)
+    {
+        return result;
+    }
+
     /*--------------------------*/
     /* Call the RqstRply engine */
     /*--------------------------*/
@@ -284,33 +327,22 @@ SLPError ProcessSrvReg(PSLPHandleInfo handle)
         result = SLP_NETWORK_INIT_FAILED;    
     }
 
-   
-    FINISHED:
-    if(buf) xfree(buf);
-    
-#ifdef ENABLE_SLPv2_SECURITY
-    if(urlauth) xfree(urlauth);
-    if(attrauth) xfree(attrauth);
-#endif 
+    xfree(buf);
 
     return result;
 }
 
 #ifdef ENABLE_ASYNC_API
 /*-------------------------------------------------------------------------*/ 
-SLPError AsyncProcessSrvReg(PSLPHandleInfo handle)
+void AsyncSrvRegDone(PSLPHandleInfo handle)
 /*-------------------------------------------------------------------------*/
 {
-    SLPError result = ProcessSrvReg(handle);
-
     xfree((void*)handle->params.reg.url);
     xfree((void*)handle->params.reg.srvtype);
     xfree((void*)handle->params.reg.scopelist);
     xfree((void*)handle->params.reg.attrlist);
 
     handle->inUse = SLP_FALSE;
-
-    return result;
 }
 #endif
 
@@ -331,6 +363,7 @@ SLPError SLPAPI SLPReg(SLPHandle   hSLP,
     PSLPHandleInfo      handle      = 0;
     SLPError            result      = SLP_OK;
     SLPSrvURL*          parsedurl   = 0;
+    int                 hold        = 0;
 
     /*------------------------------*/
     /* check for invalid parameters */
@@ -368,6 +401,9 @@ SLPError SLPAPI SLPReg(SLPHandle   hSLP,
     }
     handle->inUse = SLP_TRUE;
 
+    /* property values read from here on stay valid until we return */
+    hold = SLPPropertyHold();
+
     /*------------------*/
     /* Parse the srvurl */
     /*------------------*/
@@ -381,6 +417,7 @@ SLPError SLPAPI SLPReg(SLPHandle   hSLP,
 
         if(parsedurl) SLPFree(parsedurl);
         handle->inUse = SLP_FALSE;
+        SLPPropertyRelease(hold);
         return result;
     }
 
@@ -421,7 +458,7 @@ SLPError SLPAPI SLPReg(SLPHandle   hSLP,
            handle->params.reg.scopelist &&
            handle->params.reg.attrlist)
         {
-            result = ThreadCreate((ThreadStartProc)AsyncProcessSrvReg,handle);
+            result = AsyncRqstStart(handle,ProcessSrvReg,AsyncSrvRegDone);
         }
         else
         {
@@ -446,5 +483,241 @@ SLPError SLPAPI SLPReg(SLPHandle   hSLP,
 
     if(parsedurl) SLPFree(parsedurl);
 
+    SLPPropertyRelease(hold);
+    return result;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void CallbackSrvRegBatch(SLPError errorcode,
+                                int index,
+                                struct sockaddr_in* peerinfo,
+                                SLPBuffer replybuf,
+                                void* cookie)
+/*-------------------------------------------------------------------------*/
+{
+    SLPMessage      replymsg;
+    PSLPHandleInfo  handle      = (PSLPHandleInfo) cookie;
+
+    if(errorcode == 0)
+    {
+        replymsg = SLPMessageAlloc();
+        if(replymsg)
+        {
+            errorcode = SLPMessageParseBuffer(peerinfo,replybuf,replymsg);
+            if(errorcode == 0)
+            {
+                if(replymsg->header.functionid == SLP_FUNCT_SRVACK)
+                {
+                    errorcode = replymsg->body.srvack.errorcode * - 1;
+                }
+            }
+    
+            SLPMessageFree(replymsg);
+        }
+        else
+        {
+            errorcode = SLP_MEMORY_ALLOC_FAILED;
+        }
+    }
+
+    if(errorcode == 0)
+    {
+        RefreshAdd(handle,
+                   handle->params.reg.items[index].s_pcSrvURL,
+                   handle->params.reg.items[index].s_pcAttrs,
+                   handle->params.reg.items[index].s_usLifetime);
+    }
+
+    handle->params.reg.batchcallback((SLPHandle)handle,
+                                     index,
+                                     errorcode,
+                                     handle->params.reg.cookie);
+}
+
+
+/*=========================================================================*/
+SLPError SLPAPI SLPRegBatch(SLPHandle   hSLP,
+                     const SLPRegItem *pItems,
+                     int iCount,
+                     SLPBoolean fresh,
+                     SLPRegBatchReport callback,
+                     void *pvCookie)
+/*                                                                         */
+/* See slplib.h for detailed documentation                                 */
+/*=========================================================================*/
+{
+    PSLPHandleInfo      handle      = 0;
+    SLPError            result      = SLP_OK;
+    SLPSrvURL*          parsedurl   = 0;
+    NetworkPipelineMsg* msgs        = 0;
+    struct sockaddr_in  peeraddr;
+    int                 sock;
+    int                 i;
+    int                 hold        = 0;
+
+    /*------------------------------*/
+    /* check for invalid parameters */
+    /*------------------------------*/
+    if(hSLP        == 0 ||
+       *(unsigned int*)hSLP != SLP_HANDLE_SIG ||
+       pItems      == 0 ||
+       iCount      <= 0 ||
+       callback    == 0)
+    {
+        return SLP_PARAMETER_BAD;
+    }
+
+    /*---------------------------------------------*/
+    /* We don't handle non-fresh registrations     */
+    /*---------------------------------------------*/
+    if(fresh == SLP_FALSE)
+    {
+        return SLP_NOT_IMPLEMENTED;
+    }
+
+    handle = (PSLPHandleInfo)hSLP;
+
+    /*----------------------------------------------------*/
+    /* The pipeline needs the calling thread to drive it  */
+    /*----------------------------------------------------*/
+    if(handle->isAsync)
+    {
+        return SLP_NOT_IMPLEMENTED;
+    }
+
+    if(handle->inUse == SLP_TRUE)
+    {
+        return SLP_HANDLE_IN_USE;
+    }
+    handle->inUse = SLP_TRUE;
+
+    /* property values read from here on stay valid until we return */
+    hold = SLPPropertyHold();
+
+    msgs = (NetworkPipelineMsg*)xmalloc(iCount * sizeof(NetworkPipelineMsg));
+    if(msgs == 0)
+    {
+        handle->inUse = SLP_FALSE;
+        SLPPropertyRelease(hold);
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+    memset(msgs,0,iCount * sizeof(NetworkPipelineMsg));
+
+    handle->params.reg.fresh         = fresh;
+    handle->params.reg.scopelist     = SLPGetProperty("net.slp.useScopes");
+    handle->params.reg.scopelistlen  = 0;
+    if(handle->params.reg.scopelist)
+    {
+        handle->params.reg.scopelistlen  = strlen(handle->params.reg.scopelist);
+    }
+    handle->params.reg.callback      = 0;
+    handle->params.reg.batchcallback = callback;
+    handle->params.reg.items         = pItems;
+    handle->params.reg.cookie        = pvCookie;
+
+    /*-------------------------------------------------------------*/
+    /* Build every registration up front.  Items that are no good  */
+    /* are reported now and left out of the pipeline               */
+    /*-------------------------------------------------------------*/
+    for(i = 0; i < iCount; i++)
+    {
+        if(pItems[i].s_pcSrvURL    == 0 ||
+           *pItems[i].s_pcSrvURL   == 0 ||
+           pItems[i].s_usLifetime  == 0 ||
+           pItems[i].s_pcAttrs     == 0)
+        {
+            callback(hSLP,i,SLP_PARAMETER_BAD,pvCookie);
+            continue;
+        }
+
+        if(SLPParseSrvURL(pItems[i].s_pcSrvURL,&parsedurl))
+        {
+            if(parsedurl) SLPFree(parsedurl);
+            parsedurl = 0;
+            callback(hSLP,i,SLP_INVALID_REGISTRATION,pvCookie);
+            continue;
+        }
+
+        handle->params.reg.lifetime      = pItems[i].s_usLifetime;
+        handle->params.reg.urllen        = strlen(pItems[i].s_pcSrvURL);
+        handle->params.reg.url           = pItems[i].s_pcSrvURL;
+        handle->params.reg.srvtype       = parsedurl->s_pcSrvType;
+        handle->params.reg.srvtypelen    = strlen(handle->params.reg.srvtype);
+        handle->params.reg.attrlistlen   = strlen(pItems[i].s_pcAttrs);
+        handle->params.reg.attrlist      = pItems[i].s_pcAttrs;
+
+        result = SrvRegBuild(handle,
+                             &msgs[i].buf,
+                             &msgs[i].bufsize,
+                             &msgs[i].extoffset);
+        SLPFree(parsedurl);
+        parsedurl = 0;
+        if(result)
+        {
+            break;
+        }
+    }
+
+    if(result)
+    {
+        /* the items already built or not yet looked at are dropped */
+        for(; i < iCount; i++)
+        {
+            callback(hSLP,i,result,pvCookie);
+        }
+        for(i = 0; i < iCount; i++)
+        {
+            if(msgs[i].buf)
+            {
+                callback(hSLP,i,result,pvCookie);
+            }
+        }
+        goto FINISHED;
+    }
+
+    /*--------------------------*/
+    /* Call the pipeline engine */
+    /*--------------------------*/
+    sock = NetworkConnectToSA(handle,
+                              handle->params.reg.scopelist,
+                              handle->params.reg.scopelistlen,
+                              &peeraddr);
+    if(sock >= 0)
+    {
+        result = NetworkPipelineRqstRply(sock,
+                                         &peeraddr,
+                                         handle->langtag,
+                                         SLP_FUNCT_SRVREG,
+                                         msgs,
+                                         iCount,
+                                         CallbackSrvRegBatch,
+                                         handle);
+        if(result)
+        {
+            NetworkDisconnectSA(handle);
+        }
+    }
+    else
+    {
+        result = SLP_NETWORK_INIT_FAILED;
+        for(i = 0; i < iCount; i++)
+        {
+            if(msgs[i].buf)
+            {
+                callback(hSLP,i,result,pvCookie);
+            }
+        }
+    }
+
+    FINISHED:
+    for(i = 0; i < iCount; i++)
+    {
+        if(msgs[i].buf) xfree(msgs[i].buf);
+    }
+    xfree(msgs);
+    handle->inUse = SLP_FALSE;
+
+    SLPPropertyRelease(hold);
     return result;
 }
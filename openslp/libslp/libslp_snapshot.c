@@ -0,0 +1,673 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol                                                   */
+/*                                                                         */
+/* File:        libslp_snapshot.c                                          */
+/*                                                                         */
+/* Abstract:    Answers SrvRqsts and AttrRqsts from the read only snapshot */
+/*              of its registrations that slpd publishes in a memory       */
+/*              mapped file when slpd is a DA for the requested scopes     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+/***************************************************************************/
+
+
+
+#include "slp.h"
+#include "libslp.h"
+#include "slp_snapshot.h"
+
+#include <time.h>
+
+
+#ifndef _WIN32
+
+/* times to try for a consistent copy before asking slpd instead */
+#define SNAPSHOT_TRIES  4
+
+/* G_SnapshotLock keeps the mapping in place while a thread reads it,      */
+/* since another thread remaps it when slpd restarts or the snapshot grows */
+static pthread_mutex_t      G_SnapshotLock      = PTHREAD_MUTEX_INITIALIZER;
+static SLPSnapshotHeader*   G_SnapshotMap       = 0;
+static size_t               G_SnapshotMapSize   = 0;
+
+
+/*-------------------------------------------------------------------------*/
+static void SnapshotUnmap()
+/*-------------------------------------------------------------------------*/
+{
+    if(G_SnapshotMap)
+    {
+        munmap((void*)G_SnapshotMap, G_SnapshotMapSize);
+        G_SnapshotMap = 0;
+        G_SnapshotMapSize = 0;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotIsLive(SLPSnapshotHeader* hdr)
+/*-------------------------------------------------------------------------*/
+{
+    time_t  now = time(0);
+
+    return hdr->magic == SLP_SNAPSHOT_MAGIC &&
+           hdr->generation != SLP_SNAPSHOT_DEAD &&
+           now - (time_t)hdr->heartbeat <= SLP_SNAPSHOT_STALE;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPSnapshotHeader* SnapshotMap()
+/* Returns the snapshot of a live slpd mapped in full, or NULL if there is */
+/* none.  The mapping is kept between calls.                               */
+/*-------------------------------------------------------------------------*/
+{
+    struct stat st;
+    void*       map;
+    int         fd;
+
+    if(G_SnapshotMap)
+    {
+        if(SnapshotIsLive(G_SnapshotMap) &&
+           G_SnapshotMap->size <= G_SnapshotMapSize)
+        {
+            return G_SnapshotMap;
+        }
+
+        /* slpd went away, started over with a new file or grew this one */
+        SnapshotUnmap();
+    }
+
+    fd = open(SLP_SNAPSHOT_FILE, O_RDONLY);
+    if(fd < 0)
+    {
+        return 0;
+    }
+
+    if(fstat(fd, &st) ||
+       st.st_size < (off_t)sizeof(SLPSnapshotHeader))
+    {
+        close(fd);
+        return 0;
+    }
+
+    map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    G_SnapshotMap = (SLPSnapshotHeader*)map;
+    G_SnapshotMapSize = st.st_size;
+
+    if(SnapshotIsLive(G_SnapshotMap) == 0)
+    {
+        SnapshotUnmap();
+    }
+
+    return G_SnapshotMap;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotAppend(char** buf, int* buflen, int* bufsize,
+                          const char* data, int datalen)
+/* Appends datalen bytes and a null terminator to an xmalloc()ed buffer    */
+/*-------------------------------------------------------------------------*/
+{
+    char*   newbuf;
+    int     newsize;
+
+    if(*buflen + datalen + 1 > *bufsize)
+    {
+        newsize = (*bufsize + datalen + 1) * 2;
+        newbuf = (char*)xrealloc(*buf, newsize);
+        if(newbuf == 0)
+        {
+            return -1;
+        }
+        *buf = newbuf;
+        *bufsize = newsize;
+    }
+
+    memcpy(*buf + *buflen, data, datalen);
+    *buflen += datalen;
+    (*buf)[(*buflen)++] = 0;
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+typedef int SnapshotMatchFn(PSLPHandleInfo handle,
+                            SLPFoldedKeys* keys,
+                            SLPSnapshotEntry* entry,
+                            const char* url,
+                            const char* srvtype,
+                            const char* scopelist,
+                            const char* attrlist,
+                            unsigned short lifetime,
+                            char** buf,
+                            int* buflen,
+                            int* bufsize);
+/* Called for every live entry.  entry is a copy of the entry header whose */
+/* lengths fit the strings.  Copies what it needs from a match to buf.     */
+/* Returns zero on success, non-zero to give up                            */
+/*-------------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotCollectMapped(PSLPHandleInfo handle,
+                                 SLPFoldedKeys* keys,
+                                 int scopelistlen,
+                                 const char* scopelist,
+                                 SnapshotMatchFn* match,
+                                 char** buf,
+                                 int* buflen,
+                                 int* bufsize)
+/* Runs match over a consistent view of the snapshot.                      */
+/*                                                                         */
+/* Returns zero if the snapshot can answer the request and buf holds what  */
+/* match copied.  Non-zero if slpd has to be asked instead                 */
+/*-------------------------------------------------------------------------*/
+{
+    SLPSnapshotHeader*  hdr;
+    SLPSnapshotEntry    entry;
+    const char*         cur;
+    const char*         end;
+    const char*         strings;
+    uint32_t            generation;
+    uint32_t            used;
+    uint32_t            scopes;
+    uint32_t            count;
+    uint32_t            avail;
+    uint64_t            entrysize;
+    uint32_t            i;
+    time_t              now;
+    long                lifetime;
+    int                 usable;
+    int                 tries;
+
+    now = time(0);
+
+    for(tries = 0; tries < SNAPSHOT_TRIES; tries++)
+    {
+        hdr = SnapshotMap();
+        if(hdr == 0)
+        {
+            return -1;
+        }
+
+        generation = hdr->generation;
+        SLP_SNAPSHOT_BARRIER();
+        if(generation & 1)
+        {
+            /* slpd is writing it right now */
+            continue;
+        }
+
+        *buflen = 0;
+        usable = 0;
+
+        /* read each field once, they may change under us */
+        used = hdr->used;
+        scopes = hdr->scopelistlen;
+        count = hdr->count;
+        if(used > G_SnapshotMapSize ||
+           used < sizeof(SLPSnapshotHeader) ||
+           scopes > used - sizeof(SLPSnapshotHeader))
+        {
+            goto VERIFY;
+        }
+
+        /*-----------------------------------------------------------*/
+        /* Only a DA's snapshot is complete for the scopes it serves */
+        /*-----------------------------------------------------------*/
+        cur = (const char*)(hdr + 1);
+        if(hdr->isDA == 0 ||
+           SLPSubsetStringList(scopes,
+                               cur,
+                               scopelistlen,
+                               scopelist) == 0)
+        {
+            goto VERIFY;
+        }
+        usable = 1;
+
+        cur += SLP_SNAPSHOT_ALIGN(scopes);
+        end = (const char*)hdr + used;
+        for(i = 0; i < count; i++)
+        {
+            if(cur > end || 
+               (size_t)(end - cur) < sizeof(SLPSnapshotEntry))
+            {
+                usable = 0;
+                break;
+            }
+
+            /* slpd may rewrite the entry while we look at it.  Only use */
+            /* lengths from this copy, once they have been checked       */
+            memcpy(&entry, cur, sizeof(entry));
+            strings = cur + sizeof(SLPSnapshotEntry);
+            avail = end - cur;
+            entrysize = SLP_SNAPSHOT_ENTRY_SIZE((uint64_t)entry.urllen,
+                                                entry.srvtypelen,
+                                                entry.scopelistlen,
+                                                entry.attrlistlen);
+            if(entrysize > avail)
+            {
+                usable = 0;
+                break;
+            }
+            cur += entrysize;
+
+            if(entry.expires)
+            {
+                lifetime = (long)entry.expires - (long)now;
+                if(lifetime <= 0)
+                {
+                    /* slpd has not aged it out yet */
+                    continue;
+                }
+                if(lifetime > SLP_LIFETIME_MAXIMUM)
+                {
+                    lifetime = SLP_LIFETIME_MAXIMUM;
+                }
+            }
+            else
+            {
+                lifetime = SLP_LIFETIME_MAXIMUM;
+            }
+
+            if(match(handle,
+                     keys,
+                     &entry,
+                     strings,
+                     strings + entry.urllen,
+                     strings + entry.urllen + entry.srvtypelen,
+                     strings + entry.urllen + entry.srvtypelen + 
+                     entry.scopelistlen,
+                     (unsigned short)lifetime,
+                     buf,
+                     buflen,
+                     bufsize))
+            {
+                return -1;
+            }
+        }
+
+        VERIFY:
+        SLP_SNAPSHOT_BARRIER();
+        if(hdr->generation == generation)
+        {
+            /* what we read was consistent */
+            return usable ? 0 : -1;
+        }
+    }
+
+    return -1;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotCollect(PSLPHandleInfo handle,
+                           SLPFoldedKeys* keys,
+                           int scopelistlen,
+                           const char* scopelist,
+                           SnapshotMatchFn* match,
+                           char** buf,
+                           int* buflen,
+                           int* bufsize)
+/* SnapshotCollectMapped() with the mapping held in place                  */
+/*-------------------------------------------------------------------------*/
+{
+    int result;
+
+    pthread_mutex_lock(&G_SnapshotLock);
+    result = SnapshotCollectMapped(handle,
+                                   keys,
+                                   scopelistlen,
+                                   scopelist,
+                                   match,
+                                   buf,
+                                   buflen,
+                                   bufsize);
+    pthread_mutex_unlock(&G_SnapshotLock);
+
+    return result;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotSrvTypeHashMatches(SLPFoldedKeys* keys,
+                                      SLPSnapshotEntry* entry)
+/* The hash part of SLPFoldedCompareSrvType().  Zero if the service type   */
+/* of entry can not match the one of keys                                  */
+/*-------------------------------------------------------------------------*/
+{
+    if(keys->abstracttype.len != keys->srvtype.len)
+    {
+        return entry->srvtypehash == keys->srvtype.hash;
+    }
+
+    return entry->abstracttypehash == keys->srvtype.hash;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotMatchSrvRqst(PSLPHandleInfo handle,
+                                SLPFoldedKeys* keys,
+                                SLPSnapshotEntry* entry,
+                                const char* url,
+                                const char* srvtype,
+                                const char* scopelist,
+                                const char* attrlist,
+                                unsigned short lifetime,
+                                char** buf,
+                                int* buflen,
+                                int* bufsize)
+/* Same match as SLPDDatabaseSrvRqstStart() without the predicate.  Keeps  */
+/* the lifetime followed by the null terminated url.                       */
+/*-------------------------------------------------------------------------*/
+{
+    char    lifetimebuf[2];
+
+    if(SnapshotSrvTypeHashMatches(keys, entry) &&
+       SLPCompareSrvType(handle->params.findsrvs.srvtypelen,
+                         handle->params.findsrvs.srvtype,
+                         entry->srvtypelen,
+                         srvtype) == 0 &&
+       SLPIntersectStringList(entry->scopelistlen,
+                              scopelist,
+                              handle->params.findsrvs.scopelistlen,
+                              handle->params.findsrvs.scopelist) > 0)
+    {
+        ToUINT16(lifetimebuf, lifetime);
+        if(SnapshotAppend(buf, buflen, bufsize, lifetimebuf, 2))
+        {
+            return -1;
+        }
+        /* SnapshotAppend() terminated the lifetime, overwrite that */
+        (*buflen)--;
+        return SnapshotAppend(buf, buflen, bufsize, url, entry->urllen);
+    }
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotMatchAttrRqst(PSLPHandleInfo handle,
+                                 SLPFoldedKeys* keys,
+                                 SLPSnapshotEntry* entry,
+                                 const char* url,
+                                 const char* srvtype,
+                                 const char* scopelist,
+                                 const char* attrlist,
+                                 unsigned short lifetime,
+                                 char** buf,
+                                 int* buflen,
+                                 int* bufsize)
+/* Same match as SLPDDatabaseAttrRqstStart() for an empty taglist, where   */
+/* the last matching registration wins.  Keeps the null terminated         */
+/* attrlist.                                                               */
+/*-------------------------------------------------------------------------*/
+{
+    if(((entry->urlhash == keys->url.hash &&
+         SLPCompareString(handle->params.findattrs.urllen,
+                          handle->params.findattrs.url,
+                          entry->urllen,
+                          url) == 0) ||
+        (SnapshotSrvTypeHashMatches(keys, entry) &&
+         SLPCompareSrvType(handle->params.findattrs.urllen,
+                           handle->params.findattrs.url,
+                           entry->srvtypelen,
+                           srvtype) == 0)) &&
+       SLPIntersectStringList(handle->params.findattrs.scopelistlen,
+                              handle->params.findattrs.scopelist,
+                              entry->scopelistlen,
+                              scopelist))
+    {
+        *buflen = 0;
+        return SnapshotAppend(buf, buflen, bufsize,
+                              attrlist, entry->attrlistlen);
+    }
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotUsable(PSLPHandleInfo handle, int scopelistlen)
+/* Requests the snapshot can not answer the same way slpd would            */
+/*-------------------------------------------------------------------------*/
+{
+    if(scopelistlen == 0)
+    {
+        return 0;
+    }
+
+#ifndef UNICAST_NOT_SUPPORTED
+    if(handle->dounicast)
+    {
+        return 0;
+    }
+#endif
+
+#ifdef ENABLE_SLPv2_SECURITY
+    /* the snapshot carries no authentication blocks */
+    if(SLPPropertyAsBoolean(SLPGetProperty("net.slp.securityEnabled")))
+    {
+        return 0;
+    }
+#endif
+
+    return 1;
+}
+
+#endif /* ifndef _WIN32 */
+
+
+/*=========================================================================*/
+SLPBoolean SnapshotProcessSrvRqst(PSLPHandleInfo handle)
+/* Answers a SrvRqst from the registrations slpd publishes when slpd is a  */
+/* DA for all of the requested scopes                                      */
+/*                                                                         */
+/* handle (IN) the handle used to make the SrvRqst                         */
+/*                                                                         */
+/* returns: SLP_TRUE if the request was answered and the callback called   */
+/*          with SLP_LAST_CALL, SLP_FALSE if slpd must be asked instead    */
+/*=========================================================================*/
+{
+#ifndef _WIN32
+    SLPFoldedKeys*  keys;
+    char*           buf     = 0;
+    int             buflen  = 0;
+    int             bufsize = 0;
+    char*           cur;
+    unsigned short  lifetime;
+    int             collected;
+
+    if(SnapshotUsable(handle, handle->params.findsrvs.scopelistlen) == 0 ||
+       handle->params.findsrvs.predicatelen ||
+       strncasecmp(handle->params.findsrvs.srvtype,
+                   SLP_SA_SERVICE_TYPE,
+                   handle->params.findsrvs.srvtypelen) == 0)
+    {
+        return SLP_FALSE;
+    }
+
+    keys = SLPFoldedKeysCreate(handle->params.findsrvs.srvtypelen,
+                               handle->params.findsrvs.srvtype,
+                               0,
+                               NULL,
+                               0,
+                               NULL,
+                               0,
+                               NULL);
+    if(keys == 0)
+    {
+        return SLP_FALSE;
+    }
+
+    collected = SnapshotCollect(handle,
+                                keys,
+                                handle->params.findsrvs.scopelistlen,
+                                handle->params.findsrvs.scopelist,
+                                SnapshotMatchSrvRqst,
+                                &buf,
+                                &buflen,
+                                &bufsize);
+    SLPFoldedKeysFree(keys);
+    if(collected)
+    {
+        if(buf) xfree(buf);
+        return SLP_FALSE;
+    }
+
+    cur = buf;
+    while(cur < buf + buflen)
+    {
+        lifetime = AsUINT16(cur);
+        cur += 2;
+        if(ColateSLPSrvURLCallback((SLPHandle)handle,
+                                   cur,
+                                   lifetime,
+                                   SLP_OK,
+                                   handle->params.findsrvs.cookie) == SLP_FALSE)
+        {
+            /* the caller wants no more, not even SLP_LAST_CALL */
+            goto FINISHED;
+        }
+        cur += strlen(cur) + 1;
+    }
+
+    ColateSLPSrvURLCallback((SLPHandle)handle,
+                            0,
+                            0,
+                            SLP_LAST_CALL,
+                            handle->params.findsrvs.cookie);
+
+FINISHED:
+    if(buf) xfree(buf);
+
+    return SLP_TRUE;
+#else
+    return SLP_FALSE;
+#endif
+}
+
+
+/*=========================================================================*/
+SLPBoolean SnapshotProcessAttrRqst(PSLPHandleInfo handle)
+/* Answers an AttrRqst without tags from the registrations slpd publishes  */
+/* when slpd is a DA for all of the requested scopes                       */
+/*                                                                         */
+/* handle (IN) the handle used to make the AttrRqst                        */
+/*                                                                         */
+/* returns: SLP_TRUE if the request was answered and the callback called   */
+/*          with SLP_LAST_CALL, SLP_FALSE if slpd must be asked instead    */
+/*=========================================================================*/
+{
+#ifndef _WIN32
+    SLPFoldedKeys*  keys;
+    char*           buf     = 0;
+    int             buflen  = 0;
+    int             bufsize = 0;
+    int             collected;
+
+    if(SnapshotUsable(handle, handle->params.findattrs.scopelistlen) == 0 ||
+       handle->params.findattrs.taglistlen)
+    {
+        return SLP_FALSE;
+    }
+
+    /* the url of an AttrRqst may also be a service type */
+    keys = SLPFoldedKeysCreate(handle->params.findattrs.urllen,
+                               handle->params.findattrs.url,
+                               0,
+                               NULL,
+                               handle->params.findattrs.urllen,
+                               handle->params.findattrs.url,
+                               0,
+                               NULL);
+    if(keys == 0)
+    {
+        return SLP_FALSE;
+    }
+
+    collected = SnapshotCollect(handle,
+                                keys,
+                                handle->params.findattrs.scopelistlen,
+                                handle->params.findattrs.scopelist,
+                                SnapshotMatchAttrRqst,
+                                &buf,
+                                &buflen,
+                                &bufsize);
+    SLPFoldedKeysFree(keys);
+    if(collected)
+    {
+        if(buf) xfree(buf);
+        return SLP_FALSE;
+    }
+
+    /* slpd does not send an empty attribute list either */
+    if(buflen <= 1 ||
+       (handle->params.findattrs.callback((SLPHandle)handle,
+                                          buf,
+                                          SLP_OK,
+                                          handle->params.findattrs.cookie) &&
+        AsyncRqstCancelled(handle) == 0))
+    {
+        handle->params.findattrs.callback((SLPHandle)handle,
+                                          0,
+                                          SLP_LAST_CALL,
+                                          handle->params.findattrs.cookie);
+    }
+
+    if(buf) xfree(buf);
+
+    return SLP_TRUE;
+#else
+    return SLP_FALSE;
+#endif
+}
@@ -3,10 +3,11 @@
 /* Project:     OpenSLP - OpenSource implementation of Service Location    */
 /*              Protocol Version 2                                         */
 /*                                                                         */
-/* File:        slplib_reg.c                                               */
+/* File:        libslp_thread.c                                            */
 /*                                                                         */
-/* Abstract:    Implementation for functions register and deregister       */
-/*              services -- SLPReg() call.                                 */
+/* Abstract:    The libslp I/O thread.  A single thread per process runs   */
+/*              every call made on an async handle, multiplexing their     */
+/*              network conversations over non-blocking sockets.           */
 /*                                                                         */
 /*-------------------------------------------------------------------------*/
 /*                                                                         */
@@ -49,11 +50,13 @@
 
 #include "slp.h"
 #include "libslp.h"
+#include "slp_dhcp.h"
+
 
 #ifdef ENABLE_ASYNC_API
 /*=========================================================================*/ 
 SLPError ThreadCreate(ThreadStartProc startproc, void *arg)
-/* Creates a thread                                                        */
+/* Creates a detached thread                                               */
 /*                                                                         */
 /* startproc    (IN) Address of the thread start procedure.                */
 /*                                                                         */
@@ -62,6 +65,2583 @@ SLPError ThreadCreate(ThreadStartProc startproc, void *arg)
 /* Returns      SLPError code                                              */
 /*=========================================================================*/
 {
-    return SLP_NOT_IMPLEMENTED;
+#ifdef _WIN32
+    HANDLE          thread;
+    DWORD           threadid;
+
+    thread = CreateThread(NULL,
+                          0,
+                          (LPTHREAD_START_ROUTINE)startproc,
+                          arg,
+                          0,
+                          &threadid);
+    if(thread == NULL)
+    {
+        return SLP_INTERNAL_SYSTEM_ERROR;
+    }
+    CloseHandle(thread);
+#else
+    pthread_t       thread;
+    pthread_attr_t  attr;
+    int             result;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+    result = pthread_create(&thread,&attr,startproc,arg);
+    pthread_attr_destroy(&attr);
+    if(result)
+    {
+        return SLP_INTERNAL_SYSTEM_ERROR;
+    }
+#endif
+
+    return SLP_OK;
+}
+
+
+#ifndef _WIN32
+
+#define ASYNC_CONV_RQST      1  /* NetworkRqstRply() on a connected stream */
+#define ASYNC_CONV_UCAST     2  /* NetworkUcastRqstRply() on its own TCP   */
+#define ASYNC_CONV_MCAST     3  /* NetworkMcastRqstRply() convergence      */
+#define ASYNC_CONV_RETRY     4  /* TCP retry of an oversized mcast reply   */
+#define ASYNC_CONV_DA        5  /* one DA of NetworkMultiRqstRply()        */
+#define ASYNC_CONV_DISCOVER  6  /* DA discovery asking a DA or slpd       */
+#define ASYNC_CONV_DHCP      7  /* DA discovery asking DHCP for DAs       */
+
+#define ASYNC_STATE_CONNECT  1
+#define ASYNC_STATE_SEND     2
+#define ASYNC_STATE_RECV     3
+#define ASYNC_STATE_WAIT     4  /* mcast convergence waits on TCP retries  */
+#define ASYNC_STATE_DONE     5
+#define ASYNC_STATE_HEDGE    6  /* second DA waits for the first to be slow */
+
+#define ASYNC_DISCOVER_IPC   1  /* the steps of KnownDAFromCache(), each  */
+#define ASYNC_DISCOVER_PROPS 2  /* taken only if the ones before found no */
+#define ASYNC_DISCOVER_DHCP  3  /* DA                                     */
+#define ASYNC_DISCOVER_MCAST 4
+#define ASYNC_DISCOVER_DONE  5
+
+#define ASYNC_CLOSE_WAITING  1  /* SLPClose() from another thread waits    */
+#define ASYNC_CLOSE_DEFERRED 2  /* SLPClose() from a callback, we free it  */
+
+typedef struct _SLPAsyncRqst SLPAsyncRqst;
+typedef struct _SLPAsyncDiscovery SLPAsyncDiscovery;
+
+/*=========================================================================*/
+typedef struct _SLPAsyncConv
+/* One network conversation of an async call.  The members mirror the      */
+/* locals of the blocking engines in libslp_network.c                      */
+/*=========================================================================*/
+{
+    SLPListItem             listitem;
+    SLPAsyncRqst*           rqst;
+    struct _SLPAsyncConv*   parent;     /* mcast conv of a TCP retry      */
+    int                     children;   /* outstanding TCP retries        */
+    int                     type;
+    int                     state;
+    int                     pass;       /* last select() pass serviced    */
+    int                     sock;       /* -1 while connect is racing     */
+    NetworkConnect          connect;
+    int                     sockflags;  /* restored on handle sockets     */
+    int                     socklowat;  /* ditto, see below               */
+    SLPXcastSockets         xcastsocks;
+    SLPIfaceInfo            ifaceinfo;
+    int                     usebroadcast;
+    struct sockaddr_in      peeraddr;
+    SLPBuffer               sendbuf;
+    SLPBuffer               recvbuf;
+    char                    header[5];  /* stream version, id and length  */
+    int                     headerlen;
+    char*                   buf;
+    int                     bufsize;
+    char                    buftype;
+    char*                   langtag;
+    char*                   prlist;
+    int                     prlistlen;
+    int                     xid;
+    int                     mtu;
+    int                     xmitcount;
+    int                     rplycount;
+    int                     maxwait;
+    int                     totaltimeout;
+    int                     timeouts[MAX_RETRANSMITS];
+    struct timeval          started;    /* for the DA's latency estimate  */
+    struct timeval          deadline;
+    int                     quietwait;  /* net.slp.multicastQuietWait     */
+    struct timeval          quietdeadline;
+    int                     handover;   /* keep the socket as dasock      */
+    int                     reuse;      /* pool the DA socket when done   */
+    int                     looprecv;   /* slpd sends every DA in one go  */
+    DHCPInform*             dhcp;
+    NetworkRplyCallback*    callback;
+    void*                   cookie;
+    SLPError                result;
+}SLPAsyncConv;
+
+/*=========================================================================*/
+struct _SLPAsyncRqst
+/* An async call from the time the API function queues it until its done   */
+/* procedure has released the handle                                       */
+/*=========================================================================*/
+{
+    SLPListItem             listitem;
+    PSLPHandleInfo          handle;
+    AsyncProcessProc        process;
+    AsyncDoneProc           done;
+    SLPList                 convs;
+    SLPList                 merges;     /* of NetworkMultiRqstRply()      */
+    int                     rerun;      /* failed DA, process again       */
+    SLPAsyncDiscovery*      discovery;  /* DAs being discovered for it    */
+};
+
+/*=========================================================================*/
+struct _SLPAsyncDiscovery
+/* DA discovery of an async call, run a step at a time from the select()   */
+/* loop.  The scope list follows it in the same allocation                 */
+/*=========================================================================*/
+{
+    SLPAsyncRqst*           rqst;
+    int                     step;
+    int                     found;      /* new DAs, KnownDADiscoveryCallback */
+    int                     outstanding;/* conversations of the step      */
+    DHCPContext             dhcp;
+    int                     scopelistlen;
+    char*                   scopelist;
+};
+
+/*=========================================================================*/
+typedef struct _SLPAsyncMerge
+/* Joins the conversations of an AsyncMultiRqstRply() into one stream of   */
+/* callbacks.  It is the cookie of each of them                            */
+/*=========================================================================*/
+{
+    SLPListItem             listitem;
+    SLPAsyncRqst*           rqst;
+    SLPAsyncConv*           mcast;      /* multicast conv while it runs   */
+    int                     mcaststarted;
+    int                     outstanding;
+    int                     rplycount;
+    int                     succeeded;
+    int                     stopped;    /* the callback wants no more     */
+    int                     hedged;     /* a second DA may be asked       */
+    SLPError                result;
+    char*                   scopelist;
+    int                     scopelistlen;
+    char*                   buf;
+    int                     bufsize;
+    char                    buftype;
+    char*                   prlist;     /* DAs that replied               */
+    int                     prlistlen;
+    int                     mtu;
+    NetworkRplyCallback*    callback;
+    void*                   cookie;
+}SLPAsyncMerge;
+
+/* G_AsyncLock guards G_AsyncQueue, G_AsyncStarted and the inUse and       */
+/* asyncclose members of async handles.  Everything else is only touched   */
+/* by the I/O thread                                                       */
+static pthread_mutex_t  G_AsyncLock         = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   G_AsyncIdle         = PTHREAD_COND_INITIALIZER;
+static pthread_t        G_AsyncThread;
+static int              G_AsyncStarted      = 0;
+static int              G_AsyncWakeup[2]    = {-1, -1};
+static SLPList          G_AsyncQueue        = {0, 0, 0};
+static SLPList          G_AsyncActive       = {0, 0, 0};
+static SLPAsyncRqst*    G_AsyncStarting     = 0;
+static int              G_AsyncPass         = 0;
+
+
+/*-------------------------------------------------------------------------*/
+static int AsyncOnThread()
+/* Returns non-zero when called on the I/O thread                          */
+/*-------------------------------------------------------------------------*/
+{
+    return G_AsyncStarted && pthread_equal(pthread_self(),G_AsyncThread);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncWake()
+/* Makes the I/O thread's select() return.  Call with G_AsyncLock held     */
+/*-------------------------------------------------------------------------*/
+{
+    if(write(G_AsyncWakeup[1],"",1) < 0)
+    {
+        /* the pipe is full, so the I/O thread is already awake */
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncSetNonBlocking(int sock)
+/*-------------------------------------------------------------------------*/
+{
+    fcntl(sock,F_SETFL,fcntl(sock,F_GETFL,0) | O_NONBLOCK);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDeadline(struct timeval* deadline, int msecs)
+/* Sets deadline to msecs milliseconds from now                            */
+/*-------------------------------------------------------------------------*/
+{
+    gettimeofday(deadline,0);
+    deadline->tv_sec  += msecs / 1000;
+    deadline->tv_usec += (msecs % 1000) * 1000;
+    if(deadline->tv_usec >= 1000000)
+    {
+        deadline->tv_sec  += 1;
+        deadline->tv_usec -= 1000000;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int AsyncIsBefore(struct timeval* a, struct timeval* b)
+/*-------------------------------------------------------------------------*/
+{
+    return a->tv_sec < b->tv_sec ||
+           (a->tv_sec == b->tv_sec && a->tv_usec < b->tv_usec);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPBuffer AsyncBuildMessage(SLPBuffer sendbuf,
+                                   const char* langtag,
+                                   int extoffset,
+                                   const char* buf,
+                                   char buftype,
+                                   int bufsize,
+                                   unsigned short flags,
+                                   const char* prlist,
+                                   int xid)
+/* Lays out the message like the blocking engines do.  prlist is NULL for  */
+/* messages that do not carry a previous responder list                    */
+/*-------------------------------------------------------------------------*/
+{
+    int langtaglen  = strlen(langtag);
+    int prlistlen   = prlist ? strlen(prlist) : 0;
+    int size;
+
+    size = 14 + langtaglen + bufsize;
+    if(prlist)
+    {
+        size += 2 + prlistlen;
+    }
+    sendbuf = SLPBufferRealloc(sendbuf,size);
+    if(sendbuf == 0)
+    {
+        return 0;
+    }
+
+    /*version*/
+    *(sendbuf->start)       = 2;
+    /*function id*/
+    *(sendbuf->start + 1)   = buftype;
+    /*length*/
+    ToUINT24(sendbuf->start + 2, size);
+    /*flags*/
+    ToUINT16(sendbuf->start + 5, flags);
+    /*ext offset, passed in relative to the end of the header*/
+    ToUINT24(sendbuf->start + 7, extoffset ? extoffset + langtaglen + 14 : 0);
+    /*xid*/
+    ToUINT16(sendbuf->start + 10, xid);
+    /*lang tag len*/
+    ToUINT16(sendbuf->start + 12, langtaglen);
+    /*lang tag*/
+    memcpy(sendbuf->start + 14, langtag, langtaglen);
+    sendbuf->curpos = sendbuf->start + langtaglen + 14;
+    if(prlist)
+    {
+        ToUINT16(sendbuf->curpos,prlistlen);
+        sendbuf->curpos = sendbuf->curpos + 2;
+        memcpy(sendbuf->curpos,prlist,prlistlen);
+        sendbuf->curpos = sendbuf->curpos + prlistlen;
+    }
+    memcpy(sendbuf->curpos,buf,bufsize);
+
+    /* stream conversations send from curpos */
+    sendbuf->curpos = sendbuf->start;
+
+    return sendbuf;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPAsyncConv* AsyncConvAlloc(SLPAsyncRqst* rqst,
+                                    int type,
+                                    NetworkRplyCallback* callback,
+                                    void* cookie)
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncConv* conv;
+
+    conv = (SLPAsyncConv*)xmalloc(sizeof(SLPAsyncConv));
+    if(conv)
+    {
+        memset(conv,0,sizeof(SLPAsyncConv));
+        conv->rqst      = rqst;
+        conv->type      = type;
+        conv->sock      = -1;
+        conv->sockflags = -1;
+        conv->callback  = callback;
+        conv->cookie    = cookie;
+        /* its sockets were not part of the current select() */
+        conv->pass      = G_AsyncPass;
+        SLPListLinkTail(&(rqst->convs),(SLPListItem*)conv);
+    }
+
+    return conv;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncConvFree(SLPAsyncConv* conv)
+/* Frees a conversation that is no longer linked to its call               */
+/*-------------------------------------------------------------------------*/
+{
+    if(conv->dhcp)
+    {
+        /* the socket is the DHCPINFORM's */
+        DHCPInformClose(conv->dhcp);
+        conv->sock = -1;
+    }
+    else if(conv->type == ASYNC_CONV_RQST)
+    {
+        /* the socket is the handle's, give it back the way we got it */
+        if(conv->sockflags != -1)
+        {
+            fcntl(conv->sock,F_SETFL,conv->sockflags);
+            setsockopt(conv->sock,
+                       SOL_SOCKET,
+                       SO_RCVLOWAT,
+                       &(conv->socklowat),
+                       sizeof(conv->socklowat));
+        }
+    }
+    else if(conv->sock >= 0 && conv->reuse)
+    {
+        KnownDAPoolPut(conv->sock,&(conv->peeraddr.sin_addr));
+    }
+    else if(conv->sock >= 0)
+    {
+        close(conv->sock);
+    }
+    NetworkConnectAbort(&(conv->connect));
+    SLPXcastSocketsClose(&(conv->xcastsocks));
+    SLPBufferFree(conv->sendbuf);
+    SLPBufferFree(conv->recvbuf);
+    if(conv->buf) xfree(conv->buf);
+    if(conv->langtag) xfree(conv->langtag);
+    if(conv->prlist) xfree(conv->prlist);
+    xfree(conv);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncConvDiscard(SLPAsyncConv* conv)
+/* Drops a conversation that could not be started                          */
+/*-------------------------------------------------------------------------*/
+{
+    SLPListUnlink(&(conv->rqst->convs),(SLPListItem*)conv);
+    AsyncConvFree(conv);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncConvCancel(SLPAsyncConv* conv)
+/* Ends a conversation and its TCP retries without any more callbacks      */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncConv* child;
+
+    conv->state  = ASYNC_STATE_DONE;
+    conv->result = SLP_OK;
+    child = (SLPAsyncConv*)conv->rqst->convs.head;
+    while(child)
+    {
+        if(child->parent == conv)
+        {
+            child->state = ASYNC_STATE_DONE;
+        }
+        child = (SLPAsyncConv*)child->listitem.next;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncMcastLastCall(SLPAsyncConv* conv)
+/* Finishes convergence with the callback NetworkMcastRqstRply() ends with */
+/*-------------------------------------------------------------------------*/
+{
+    SLPError result = conv->result;
+
+    if(conv->rplycount || result == SLP_OK)
+    {
+        result = SLP_LAST_CALL;
+    }
+    conv->state  = ASYNC_STATE_DONE;
+    conv->result = (result == SLP_LAST_CALL) ? SLP_OK : result;
+    conv->callback(result,NULL,NULL,conv->cookie);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncMcastFinish(SLPAsyncConv* conv, SLPError result)
+/* Stops convergence, reporting the last call once TCP retries are in      */
+/*-------------------------------------------------------------------------*/
+{
+    conv->result = result;
+    SLPXcastSocketsClose(&(conv->xcastsocks));
+    if(conv->children)
+    {
+        conv->state = ASYNC_STATE_WAIT;
+    }
+    else
+    {
+        AsyncMcastLastCall(conv);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncPrlistAdd(char* prlist,
+                           int* prlistlen,
+                           int mtu,
+                           struct sockaddr_in* peeraddr)
+/* Adds a peer to a previous responder list if it fits                     */
+/*-------------------------------------------------------------------------*/
+{
+    char*   peeraddrstr;
+    int     peeraddrstrlen;
+
+    peeraddrstr = inet_ntoa(peeraddr->sin_addr);
+    peeraddrstrlen = strlen(peeraddrstr);
+    if(*prlistlen + peeraddrstrlen + 1 < mtu)
+    {
+        if(*prlistlen)
+        {
+            strcat(prlist,",");
+        }
+        strcat(prlist,peeraddrstr);
+        *prlistlen = strlen(prlist);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncMcastReply(SLPAsyncConv* conv,
+                            struct sockaddr_in* peeraddr,
+                            SLPBuffer recvbuf)
+/* Reports a reply with the right xid and remembers who sent it            */
+/*-------------------------------------------------------------------------*/
+{
+    conv->rplycount += 1;
+    if(conv->callback(SLP_OK,peeraddr,recvbuf,conv->cookie) == SLP_FALSE)
+    {
+        /* caller does not want any more info, not even SLP_LAST_CALL */
+        AsyncConvCancel(conv);
+        return;
+    }
+
+    AsyncPrlistAdd(conv->prlist,&(conv->prlistlen),conv->mtu,peeraddr);
+    if(conv->quietwait)
+    {
+        AsyncDeadline(&(conv->quietdeadline),conv->quietwait);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncMcastXmit(SLPAsyncConv* conv)
+/* Sends the next round of the multicast convergence algorithm.  Like      */
+/* NetworkMcastRqstRply(), timeouts[0] is not used as a round wait         */
+/*-------------------------------------------------------------------------*/
+{
+    int i;
+    int size;
+
+    conv->xmitcount++;
+    if(conv->xmitcount >= MAX_RETRANSMITS)
+    {
+        AsyncMcastFinish(conv,SLP_OK);
+        return;
+    }
+    conv->totaltimeout += conv->timeouts[conv->xmitcount];
+    if(conv->totaltimeout >= conv->maxwait ||
+       conv->timeouts[conv->xmitcount] == 0)
+    {
+        AsyncMcastFinish(conv,SLP_OK);
+        return;
+    }
+
+    /* the prlist may not push the datagram past the MTU */
+    size = 14 + strlen(conv->langtag) + conv->bufsize + 2 + conv->prlistlen;
+    if(size > conv->mtu)
+    {
+        AsyncMcastFinish(conv,SLP_OK);
+        return;
+    }
+    conv->sendbuf = AsyncBuildMessage(conv->sendbuf,
+                                      conv->langtag,
+                                      0,
+                                      conv->buf,
+                                      conv->buftype,
+                                      conv->bufsize,
+                                      SLP_FLAG_MCAST,
+                                      conv->prlist,
+                                      conv->xid);
+    if(conv->sendbuf == 0)
+    {
+        AsyncMcastFinish(conv,SLP_MEMORY_ALLOC_FAILED);
+        return;
+    }
+
+    /* every round gets fresh sockets, as with the blocking engine */
+    SLPXcastSocketsClose(&(conv->xcastsocks));
+    if(conv->usebroadcast)
+    {
+        i = SLPBroadcastSend(&(conv->ifaceinfo),conv->sendbuf,&(conv->xcastsocks));
+    }
+    else
+    {
+        i = SLPMulticastSend(&(conv->ifaceinfo),conv->sendbuf,&(conv->xcastsocks));
+    }
+    if(i != 0)
+    {
+        AsyncMcastFinish(conv,SLP_NETWORK_ERROR);
+        return;
+    }
+    for(i = 0; i < conv->xcastsocks.sock_count; i++)
+    {
+        AsyncSetNonBlocking(conv->xcastsocks.sock[i]);
+    }
+
+    conv->state = ASYNC_STATE_RECV;
+    AsyncDeadline(&(conv->deadline),conv->timeouts[conv->xmitcount]);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int AsyncStreamConnect(SLPAsyncConv* conv,
+                              struct sockaddr_in* peeraddr,
+                              int timeout)
+/* Starts a non-blocking connect to peeraddr, or borrows a connection to   */
+/* a DA from the pool.  Returns zero on success                            */
+/*-------------------------------------------------------------------------*/
+{
+    memcpy(&(conv->peeraddr),peeraddr,sizeof(struct sockaddr_in));
+    gettimeofday(&(conv->started),0);
+    if(conv->type == ASYNC_CONV_DA)
+    {
+        conv->sock = KnownDAPoolGet(&(peeraddr->sin_addr));
+        if(conv->sock >= 0)
+        {
+            AsyncSetNonBlocking(conv->sock);
+            conv->state = ASYNC_STATE_SEND;
+            AsyncDeadline(&(conv->deadline),timeout);
+            return 0;
+        }
+    }
+    if(NetworkConnectStart(&(conv->connect),peeraddr))
+    {
+        return -1;
+    }
+    conv->state = ASYNC_STATE_CONNECT;
+    AsyncDeadline(&(conv->deadline),timeout);
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDAHandover(SLPAsyncConv* conv)
+/* Keeps the connection to a DA that answered a whole request on its own   */
+/* as the handle's DA connection, as NetworkConnectToDA() would have       */
+/*-------------------------------------------------------------------------*/
+{
+    PSLPHandleInfo  handle  = conv->rqst->handle;
+    SLPAsyncMerge*  merge   = (SLPAsyncMerge*)conv->cookie;
+    char*           dascope;
+
+    dascope = (char*)memdup(merge->scopelist,merge->scopelistlen);
+    if(dascope == 0)
+    {
+        return;
+    }
+    KnownDAPoolPut(handle->dasock,&(handle->daaddr.sin_addr));
+    if(handle->dascope) xfree(handle->dascope);
+    fcntl(conv->sock,F_SETFL,fcntl(conv->sock,F_GETFL,0) & ~O_NONBLOCK);
+    handle->dasock = conv->sock;
+    handle->dascope = dascope;
+    handle->dascopelen = merge->scopelistlen;
+    memcpy(&(handle->daaddr),&(conv->peeraddr),sizeof(struct sockaddr_in));
+    conv->sock = -1;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncStreamFinish(SLPAsyncConv* conv, SLPError result)
+/* Reports the end of a stream conversation with the callbacks the         */
+/* matching blocking engine would have made                                */
+/*-------------------------------------------------------------------------*/
+{
+    struct timeval  now;
+    int             matched;
+
+    conv->state  = ASYNC_STATE_DONE;
+    conv->result = result;
+    matched = (result == SLP_OK &&
+               AsUINT16(conv->recvbuf->start + 10) == conv->xid);
+
+    if(conv->type == ASYNC_CONV_RETRY)
+    {
+        /* failed retries are dropped, convergence goes on without them */
+        if(matched && conv->parent && conv->parent->state != ASYNC_STATE_DONE)
+        {
+            AsyncMcastReply(conv->parent,&(conv->peeraddr),conv->recvbuf);
+        }
+        return;
+    }
+
+    if(matched && conv->handover)
+    {
+        AsyncDAHandover(conv);
+    }
+    else if(matched && conv->type == ASYNC_CONV_DA)
+    {
+        conv->reuse = 1;
+    }
+    if(matched && conv->type == ASYNC_CONV_DA)
+    {
+        gettimeofday(&now,0);
+        KnownDARttReply(&(conv->peeraddr.sin_addr),
+                        (now.tv_sec - conv->started.tv_sec) * 1000 +
+                        (now.tv_usec - conv->started.tv_usec) / 1000);
+    }
+
+    if(matched &&
+       conv->callback(SLP_OK,
+                      &(conv->peeraddr),
+                      conv->recvbuf,
+                      conv->cookie) == SLP_FALSE)
+    {
+        /* caller does not want any more info */
+        conv->result = SLP_OK;
+        return;
+    }
+
+    if(matched && conv->looprecv)
+    {
+        /* slpd sent the DAs it knows one after the other, read the next */
+        SLPBufferFree(conv->recvbuf);
+        conv->recvbuf = 0;
+        conv->headerlen = 0;
+        conv->state = ASYNC_STATE_RECV;
+        conv->result = SLP_OK;
+        return;
+    }
+
+    if(result == SLP_OK ||
+       (result == SLP_NETWORK_TIMED_OUT && conv->type == ASYNC_CONV_UCAST))
+    {
+        result = SLP_LAST_CALL;
+    }
+    conv->result = (result == SLP_LAST_CALL) ? SLP_OK : result;
+    if(conv->type == ASYNC_CONV_UCAST)
+    {
+        conv->callback(result,NULL,NULL,conv->cookie);
+    }
+    else
+    {
+        conv->callback(result,&(conv->peeraddr),conv->recvbuf,conv->cookie);
+    }
 }
+
+
+static void AsyncMergeRelease(SLPAsyncMerge* merge);
+
+/*-------------------------------------------------------------------------*/
+static void AsyncHedgeSend(SLPAsyncConv* conv)
+/* Asks the second DA of a hedged merge once the first has been slower     */
+/* than usual, or drops the hedge if net.slp.DAHedgeBudget is spent        */
+/*-------------------------------------------------------------------------*/
+{
+    struct sockaddr_in  peeraddr;
+
+    if(KnownDAHedgeSpend() == 0)
+    {
+        AsyncConvCancel(conv);
+        AsyncMergeRelease((SLPAsyncMerge*)conv->cookie);
+        return;
+    }
+
+    memcpy(&peeraddr,&(conv->peeraddr),sizeof(struct sockaddr_in));
+    if(AsyncStreamConnect(conv,
+                          &peeraddr,
+                          SLPPropertyAsInteger(SLPGetProperty("net.slp.DADiscoveryMaximumWait"))))
+    {
+        AsyncStreamFinish(conv,SLP_NETWORK_ERROR);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncStreamService(SLPAsyncConv* conv,
+                               fd_set* readfds,
+                               fd_set* writefds,
+                               struct timeval* now)
+/* Connects, sends the request and reads one reply without blocking        */
+/*-------------------------------------------------------------------------*/
+{
+    int     flags       = 0;
+    int     xferbytes   = 1;
+    int     size;
+
+#if defined(MSG_NOSIGNAL)
+    flags = MSG_NOSIGNAL;
+#endif
+
+    if(conv->state == ASYNC_STATE_HEDGE)
+    {
+        if(AsyncIsBefore(&(conv->deadline),now))
+        {
+            AsyncHedgeSend(conv);
+        }
+        return;
+    }
+
+    if(conv->state == ASYNC_STATE_CONNECT)
+    {
+        conv->sock = NetworkConnectService(&(conv->connect),writefds,now);
+        if(conv->sock == -2)
+        {
+            /* the blocking engines report a failed connect as a time out */
+            conv->sock = -1;
+            AsyncStreamFinish(conv,SLP_NETWORK_TIMED_OUT);
+            return;
+        }
+        if(conv->sock >= 0)
+        {
+            conv->state = ASYNC_STATE_SEND;
+            AsyncDeadline(&(conv->deadline),conv->maxwait);
+        }
+    }
+
+    if(conv->state == ASYNC_STATE_SEND && FD_ISSET(conv->sock,writefds))
+    {
+        xferbytes = send(conv->sock,
+                         conv->sendbuf->curpos,
+                         conv->sendbuf->end - conv->sendbuf->curpos,
+                         flags);
+        if(xferbytes > 0)
+        {
+            conv->sendbuf->curpos += xferbytes;
+            if(conv->sendbuf->curpos == conv->sendbuf->end)
+            {
+                conv->state = ASYNC_STATE_RECV;
+                AsyncDeadline(&(conv->deadline),conv->maxwait);
+            }
+        }
+    }
+    else if(conv->state == ASYNC_STATE_RECV && FD_ISSET(conv->sock,readfds))
+    {
+        if(conv->recvbuf == 0)
+        {
+            /* read version, function id and length to size the buffer */
+            xferbytes = recv(conv->sock,
+                             conv->header + conv->headerlen,
+                             sizeof(conv->header) - conv->headerlen,
+                             0);
+            if(xferbytes > 0)
+            {
+                conv->headerlen += xferbytes;
+                if(conv->headerlen == sizeof(conv->header))
+                {
+                    size = AsUINT24(conv->header + 2);
+                    if(*conv->header != 2 || size < 14)
+                    {
+                        AsyncStreamFinish(conv,SLP_NETWORK_ERROR);
+                        return;
+                    }
+                    conv->recvbuf = SLPBufferAlloc(size);
+                    if(conv->recvbuf == 0)
+                    {
+                        AsyncStreamFinish(conv,SLP_MEMORY_ALLOC_FAILED);
+                        return;
+                    }
+                    memcpy(conv->recvbuf->curpos,
+                           conv->header,
+                           sizeof(conv->header));
+                    conv->recvbuf->curpos += sizeof(conv->header);
+                }
+            }
+        }
+        else
+        {
+            xferbytes = recv(conv->sock,
+                             conv->recvbuf->curpos,
+                             conv->recvbuf->end - conv->recvbuf->curpos,
+                             0);
+            if(xferbytes > 0)
+            {
+                conv->recvbuf->curpos += xferbytes;
+                if(conv->recvbuf->curpos == conv->recvbuf->end)
+                {
+                    AsyncStreamFinish(conv,SLP_OK);
+                    return;
+                }
+            }
+        }
+    }
+
+    if(xferbytes == 0 ||
+       (xferbytes < 0 &&
+        errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+        AsyncStreamFinish(conv,SLP_NETWORK_ERROR);
+        return;
+    }
+
+    if(AsyncIsBefore(&(conv->deadline),now))
+    {
+        AsyncStreamFinish(conv,SLP_NETWORK_TIMED_OUT);
+    }
+}
+
+
+#ifndef UNICAST_NOT_SUPPORTED
+/*-------------------------------------------------------------------------*/
+static void AsyncRetryStart(SLPAsyncConv* parent,
+                            struct sockaddr_in* peeraddr)
+/* Asks a peer whose reply did not fit in a datagram again over TCP        */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncConv* conv;
+
+    conv = AsyncConvAlloc(parent->rqst,
+                          ASYNC_CONV_RETRY,
+                          parent->callback,
+                          parent->cookie);
+    if(conv == 0)
+    {
+        return;
+    }
+    conv->parent = parent;
+    parent->children++;
+
+    conv->maxwait = SLPPropertyAsInteger(SLPGetProperty("net.slp.unicastMaximumWait"));
+    conv->xid = SLPXidGenerate();
+    conv->sendbuf = SLPBufferDup(parent->sendbuf);
+    if(conv->sendbuf == 0 ||
+       AsyncStreamConnect(conv,peeraddr,conv->maxwait))
+    {
+        AsyncStreamFinish(conv,SLP_NETWORK_ERROR);
+        return;
+    }
+    ToUINT16(conv->sendbuf->start + 5,SLP_FLAG_UCAST);
+    ToUINT16(conv->sendbuf->start + 10,conv->xid);
+    conv->sendbuf->curpos = conv->sendbuf->start;
+}
+#endif
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncMcastService(SLPAsyncConv* conv,
+                              fd_set* readfds,
+                              struct timeval* now)
+/* Reads the replies that arrived and retransmits when the round is over   */
+/*-------------------------------------------------------------------------*/
+{
+    struct sockaddr_in  peeraddr;
+    int                 peeraddrlen;
+    char                peek[16];
+    int                 bytesread;
+    int                 size;
+    int                 sock;
+    int                 i;
+
+    for(i = 0; i < conv->xcastsocks.sock_count; i++)
+    {
+        sock = conv->xcastsocks.sock[i];
+        if(FD_ISSET(sock,readfds) == 0)
+        {
+            continue;
+        }
+
+        /* Peek at the first 16 bytes of the header */
+        peeraddrlen = sizeof(peeraddr);
+        bytesread = recvfrom(sock,
+                             peek,
+                             16,
+                             MSG_PEEK,
+                             (struct sockaddr*)&peeraddr,
+                             &peeraddrlen);
+        if(bytesread < 0)
+        {
+            continue;
+        }
+        size = (bytesread == 16) ? AsUINT24(peek + 2) : 0;
+        if(size < 16 || size > SLP_MAX_DATAGRAM_SIZE)
+        {
+            /* throw away runts and the part of big replies that fit */
+            recv(sock,peek,16,0);
+#ifndef UNICAST_NOT_SUPPORTED
+            if(size > SLP_MAX_DATAGRAM_SIZE)
+            {
+                AsyncRetryStart(conv,&peeraddr);
+            }
 #endif
+            continue;
+        }
+
+        conv->recvbuf = SLPBufferRealloc(conv->recvbuf,size);
+        if(conv->recvbuf == 0)
+        {
+            AsyncMcastFinish(conv,SLP_MEMORY_ALLOC_FAILED);
+            return;
+        }
+        bytesread = recv(sock,conv->recvbuf->curpos,size,0);
+        if(bytesread != size)
+        {
+            /* This should never happen but we'll be paranoid */
+            conv->recvbuf->end = conv->recvbuf->curpos +
+                                 (bytesread > 0 ? bytesread : 0);
+        }
+
+        /* Sneek in and check the XID */
+        if(AsUINT16(conv->recvbuf->start + 10) == conv->xid)
+        {
+            AsyncMcastReply(conv,&peeraddr,conv->recvbuf);
+            if(conv->state != ASYNC_STATE_RECV)
+            {
+                return;
+            }
+        }
+    }
+
+    if(conv->quietwait &&
+       conv->rplycount &&
+       AsyncIsBefore(&(conv->quietdeadline),now))
+    {
+        /* nothing new for a while, the answer has converged */
+        AsyncMcastFinish(conv,SLP_OK);
+    }
+    else if(AsyncIsBefore(&(conv->deadline),now))
+    {
+        AsyncMcastXmit(conv);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int AsyncConvFds(SLPAsyncConv* conv,
+                        fd_set* readfds,
+                        fd_set* writefds,
+                        int highfd,
+                        struct timeval** earliest)
+/* Adds what the conversation waits on to the select() arguments           */
+/*-------------------------------------------------------------------------*/
+{
+    int i;
+
+    switch(conv->state)
+    {
+    case ASYNC_STATE_CONNECT:
+        highfd = NetworkConnectFds(&(conv->connect),writefds,highfd,earliest);
+        break;
+
+    case ASYNC_STATE_SEND:
+        FD_SET(conv->sock,writefds);
+        break;
+
+    case ASYNC_STATE_HEDGE:
+        /* only the deadline */
+        break;
+
+    case ASYNC_STATE_RECV:
+        if(conv->type != ASYNC_CONV_MCAST)
+        {
+            FD_SET(conv->sock,readfds);
+            break;
+        }
+        for(i = 0; i < conv->xcastsocks.sock_count; i++)
+        {
+            FD_SET(conv->xcastsocks.sock[i],readfds);
+            if(conv->xcastsocks.sock[i] > highfd)
+            {
+                highfd = conv->xcastsocks.sock[i];
+            }
+        }
+        break;
+
+    default:
+        return highfd;
+    }
+
+    if(conv->sock > highfd)
+    {
+        highfd = conv->sock;
+    }
+    if(*earliest == 0 || AsyncIsBefore(&(conv->deadline),*earliest))
+    {
+        *earliest = &(conv->deadline);
+    }
+    if(conv->quietwait &&
+       conv->rplycount &&
+       AsyncIsBefore(&(conv->quietdeadline),*earliest))
+    {
+        *earliest = &(conv->quietdeadline);
+    }
+
+    return highfd;
+}
+
+
+static void AsyncDhcpService(SLPAsyncConv* conv,
+                             fd_set* readfds,
+                             fd_set* writefds,
+                             struct timeval* now);
+
+/*-------------------------------------------------------------------------*/
+static void AsyncConvService(SLPAsyncConv* conv,
+                             fd_set* readfds,
+                             fd_set* writefds,
+                             struct timeval* now)
+/*-------------------------------------------------------------------------*/
+{
+    if(conv->pass == G_AsyncPass ||
+       conv->state == ASYNC_STATE_WAIT ||
+       conv->state == ASYNC_STATE_DONE)
+    {
+        return;
+    }
+    conv->pass = G_AsyncPass;
+
+    if(conv->type == ASYNC_CONV_MCAST)
+    {
+        AsyncMcastService(conv,readfds,now);
+    }
+    else if(conv->type == ASYNC_CONV_DHCP)
+    {
+        AsyncDhcpService(conv,readfds,writefds,now);
+    }
+    else
+    {
+        AsyncStreamService(conv,readfds,writefds,now);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int AsyncRqstClosing(SLPAsyncRqst* rqst)
+/*-------------------------------------------------------------------------*/
+{
+    int result;
+
+    pthread_mutex_lock(&G_AsyncLock);
+    result = rqst->handle->asyncclose;
+    pthread_mutex_unlock(&G_AsyncLock);
+
+    return result;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncRqstRun(SLPAsyncRqst* rqst)
+/* Runs the call's Process*() function.  The engines in libslp_network.c   */
+/* hand the conversations it starts to us instead of blocking              */
+/*-------------------------------------------------------------------------*/
+{
+    if(AsyncRqstClosing(rqst) == 0)
+    {
+        G_AsyncStarting = rqst;
+        rqst->process(rqst->handle);
+        G_AsyncStarting = 0;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncRqstDone(SLPAsyncRqst* rqst)
+/* Releases the handle of a call that has no conversations left            */
+/*-------------------------------------------------------------------------*/
+{
+    PSLPHandleInfo  handle  = rqst->handle;
+    AsyncDoneProc   done    = rqst->done;
+    SLPAsyncMerge*  merge;
+    int             deferred;
+
+    SLPListUnlink(&G_AsyncActive,(SLPListItem*)rqst);
+    if(rqst->discovery)
+    {
+        /* closed before the discovery was over */
+        xfree(rqst->discovery);
+    }
+    while(rqst->merges.count)
+    {
+        merge = (SLPAsyncMerge*)SLPListUnlink(&(rqst->merges),rqst->merges.head);
+        if(merge->scopelist) xfree(merge->scopelist);
+        if(merge->buf) xfree(merge->buf);
+        if(merge->prlist) xfree(merge->prlist);
+        xfree(merge);
+    }
+    xfree(rqst);
+
+    pthread_mutex_lock(&G_AsyncLock);
+    done(handle);
+    deferred = (handle->asyncclose == ASYNC_CLOSE_DEFERRED);
+    handle->asyncclose = 0;
+    pthread_cond_broadcast(&G_AsyncIdle);
+    pthread_mutex_unlock(&G_AsyncLock);
+
+    if(deferred)
+    {
+        /* SLPClose() was called from a callback, finish it now */
+        SLPClose((SLPHandle)handle);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncRqstReap(SLPAsyncRqst* rqst)
+/* Retires finished conversations and, once none is left, the call itself  */
+/*-------------------------------------------------------------------------*/
+{
+    PSLPHandleInfo  handle  = rqst->handle;
+    SLPAsyncConv*   conv;
+    SLPAsyncConv*   next;
+    SLPAsyncConv*   child;
+    SLPError        result;
+    int             type;
+    int             sock;
+    int             reaped;
+
+    do
+    {
+        if(AsyncRqstClosing(rqst))
+        {
+            /* SLPClose() is waiting, stop without further callbacks */
+            for(conv = (SLPAsyncConv*)rqst->convs.head;
+                conv;
+                conv = (SLPAsyncConv*)conv->listitem.next)
+            {
+                conv->state = ASYNC_STATE_DONE;
+            }
+        }
+
+        reaped = 0;
+        conv = (SLPAsyncConv*)rqst->convs.head;
+        while(conv)
+        {
+            next = (SLPAsyncConv*)conv->listitem.next;
+            if(conv->state == ASYNC_STATE_DONE)
+            {
+                SLPListUnlink(&(rqst->convs),(SLPListItem*)conv);
+                for(child = (SLPAsyncConv*)rqst->convs.head;
+                    child;
+                    child = (SLPAsyncConv*)child->listitem.next)
+                {
+                    if(child->parent == conv)
+                    {
+                        child->parent = 0;
+                        child->state = ASYNC_STATE_DONE;
+                    }
+                }
+                if(conv->parent)
+                {
+                    conv->parent->children--;
+                    if(conv->parent->state == ASYNC_STATE_WAIT &&
+                       conv->parent->children == 0)
+                    {
+                        AsyncMcastLastCall(conv->parent);
+                    }
+                }
+
+                type    = conv->type;
+                sock    = conv->sock;
+                result  = conv->result;
+                AsyncConvFree(conv);
+
+                /* do what Process*() does after NetworkRqstRply() fails */
+                if(type == ASYNC_CONV_RQST && result != SLP_OK)
+                {
+                    if(sock == handle->dasock)
+                    {
+                        /* ask the other DAs, or multicast, instead */
+                        NetworkDisconnectDA(handle);
+                        rqst->rerun = 1;
+                    }
+                    else if(sock == handle->sasock)
+                    {
+                        NetworkDisconnectSA(handle);
+                    }
+                }
+
+                reaped = 1;
+            }
+            conv = next;
+        }
+
+        if(reaped == 0 && rqst->rerun && rqst->convs.count == 0)
+        {
+            rqst->rerun = 0;
+            AsyncRqstRun(rqst);
+            reaped = 1;
+        }
+    }while(reaped);
+
+    if(rqst->convs.count == 0)
+    {
+        AsyncRqstDone(rqst);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void* AsyncThread(void* arg)
+/* The I/O thread.  Starts queued calls and drives every conversation of   */
+/* every call from a single select() loop                                  */
+/*-------------------------------------------------------------------------*/
+{
+    SLPList             starting;
+    SLPAsyncRqst*       rqst;
+    SLPAsyncRqst*       nextrqst;
+    SLPAsyncConv*       conv;
+    struct timeval*     earliest;
+    struct timeval      timeout;
+    struct timeval      now;
+    fd_set              readfds;
+    fd_set              writefds;
+    int                 highfd;
+    int                 hold;
+    char                drain[64];
+
+    G_AsyncThread = pthread_self();
+
+    while(1)
+    {
+        /*-------------------------------------------*/
+        /* Start the calls queued by the API threads */
+        /*-------------------------------------------*/
+        pthread_mutex_lock(&G_AsyncLock);
+        starting = G_AsyncQueue;
+        memset(&G_AsyncQueue,0,sizeof(SLPList));
+        pthread_mutex_unlock(&G_AsyncLock);
+
+        hold = SLPPropertyHold();
+        while(starting.count)
+        {
+            rqst = (SLPAsyncRqst*)SLPListUnlink(&starting,starting.head);
+            SLPListLinkTail(&G_AsyncActive,(SLPListItem*)rqst);
+            AsyncRqstRun(rqst);
+            AsyncRqstReap(rqst);
+        }
+        SLPPropertyRelease(hold);
+
+        /*--------------------------------------------------*/
+        /* Wait for a conversation to be ready or time out  */
+        /*--------------------------------------------------*/
+        FD_ZERO(&readfds);
+        FD_ZERO(&writefds);
+        FD_SET(G_AsyncWakeup[0],&readfds);
+        highfd = G_AsyncWakeup[0];
+        earliest = 0;
+        for(rqst = (SLPAsyncRqst*)G_AsyncActive.head;
+            rqst;
+            rqst = (SLPAsyncRqst*)rqst->listitem.next)
+        {
+            for(conv = (SLPAsyncConv*)rqst->convs.head;
+                conv;
+                conv = (SLPAsyncConv*)conv->listitem.next)
+            {
+                highfd = AsyncConvFds(conv,&readfds,&writefds,highfd,&earliest);
+            }
+        }
+        if(earliest)
+        {
+            gettimeofday(&now,0);
+            timeout.tv_sec = 0;
+            timeout.tv_usec = 0;
+            if(AsyncIsBefore(&now,earliest))
+            {
+                timeout.tv_sec  = earliest->tv_sec - now.tv_sec;
+                timeout.tv_usec = earliest->tv_usec - now.tv_usec;
+                if(timeout.tv_usec < 0)
+                {
+                    timeout.tv_sec  -= 1;
+                    timeout.tv_usec += 1000000;
+                }
+            }
+        }
+        if(select(highfd + 1,
+                  &readfds,
+                  &writefds,
+                  0,
+                  earliest ? &timeout : 0) < 0)
+        {
+            /* interrupted, only look at the deadlines */
+            FD_ZERO(&readfds);
+            FD_ZERO(&writefds);
+        }
+        if(FD_ISSET(G_AsyncWakeup[0],&readfds))
+        {
+            while(read(G_AsyncWakeup[0],drain,sizeof(drain)) > 0);
+        }
+
+        /*----------------------------------*/
+        /* Move every conversation forward  */
+        /*----------------------------------*/
+        gettimeofday(&now,0);
+        G_AsyncPass++;
+        hold = SLPPropertyHold();
+        rqst = (SLPAsyncRqst*)G_AsyncActive.head;
+        while(rqst)
+        {
+            nextrqst = (SLPAsyncRqst*)rqst->listitem.next;
+            for(conv = (SLPAsyncConv*)rqst->convs.head;
+                conv;
+                conv = (SLPAsyncConv*)conv->listitem.next)
+            {
+                AsyncConvService(conv,&readfds,&writefds,&now);
+            }
+            AsyncRqstReap(rqst);
+            rqst = nextrqst;
+        }
+        SLPPropertyRelease(hold);
+    }
+
+    return 0;
+}
+
+
+/*=========================================================================*/
+SLPError AsyncRqstStart(PSLPHandleInfo handle,
+                        AsyncProcessProc process,
+                        AsyncDoneProc done)
+/* Queues an async call to the I/O thread, starting the thread if needed   */
+/*                                                                         */
+/* handle   (IN) the async handle, marked in use by the API function       */
+/*                                                                         */
+/* process  (IN) the Process*() function that runs the call                */
+/*                                                                         */
+/* done     (IN) frees the copied parameters and releases the handle       */
+/*                                                                         */
+/* Returns  SLPError code                                                  */
+/*=========================================================================*/
+{
+    SLPAsyncRqst*   rqst;
+    SLPError        result  = SLP_OK;
+
+    rqst = (SLPAsyncRqst*)xmalloc(sizeof(SLPAsyncRqst));
+    if(rqst == 0)
+    {
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+    memset(rqst,0,sizeof(SLPAsyncRqst));
+    rqst->handle    = handle;
+    rqst->process   = process;
+    rqst->done      = done;
+
+    pthread_mutex_lock(&G_AsyncLock);
+    if(G_AsyncStarted == 0)
+    {
+        if(pipe(G_AsyncWakeup) == 0)
+        {
+            AsyncSetNonBlocking(G_AsyncWakeup[0]);
+            AsyncSetNonBlocking(G_AsyncWakeup[1]);
+            result = ThreadCreate(AsyncThread,0);
+            if(result == SLP_OK)
+            {
+                G_AsyncStarted = 1;
+            }
+            else
+            {
+                close(G_AsyncWakeup[0]);
+                close(G_AsyncWakeup[1]);
+            }
+        }
+        else
+        {
+            result = SLP_INTERNAL_SYSTEM_ERROR;
+        }
+    }
+    if(result == SLP_OK)
+    {
+        SLPListLinkTail(&G_AsyncQueue,(SLPListItem*)rqst);
+        AsyncWake();
+    }
+    pthread_mutex_unlock(&G_AsyncLock);
+
+    if(result)
+    {
+        xfree(rqst);
+    }
+
+    return result;
+}
+
+
+/*=========================================================================*/
+int AsyncRqstClose(PSLPHandleInfo handle)
+/* Stops the call outstanding on an async handle before SLPClose() frees   */
+/* the handle.  Waits for the I/O thread to let go of it unless called     */
+/* from a callback, which is running on the I/O thread itself              */
+/*                                                                         */
+/* handle   (IN) the async handle being closed                             */
+/*                                                                         */
+/* Returns  non-zero if the I/O thread will finish closing the handle      */
+/*=========================================================================*/
+{
+    int result = 0;
+
+    pthread_mutex_lock(&G_AsyncLock);
+    if(G_AsyncStarted && handle->inUse)
+    {
+        if(AsyncOnThread())
+        {
+            handle->asyncclose = ASYNC_CLOSE_DEFERRED;
+            result = 1;
+        }
+        else
+        {
+            handle->asyncclose = ASYNC_CLOSE_WAITING;
+            AsyncWake();
+            while(handle->inUse)
+            {
+                pthread_cond_wait(&G_AsyncIdle,&G_AsyncLock);
+            }
+        }
+    }
+    pthread_mutex_unlock(&G_AsyncLock);
+
+    return result;
+}
+
+
+/*=========================================================================*/
+int AsyncRqstCancelled(PSLPHandleInfo handle)
+/* Tells the Process*() callbacks whether SLPClose() was called on the     */
+/* handle while its call is outstanding, from a callback or from another   */
+/* thread.  The caller's callback must not be called again once it was     */
+/*                                                                         */
+/* Returns  non-zero if the call is being cancelled                        */
+/*=========================================================================*/
+{
+    int result;
+
+    if(handle->isAsync == 0)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&G_AsyncLock);
+    result = handle->asyncclose;
+    pthread_mutex_unlock(&G_AsyncLock);
+
+    return result;
+}
+
+
+/*=========================================================================*/
+int AsyncRqstIsStarting(void* cookie)
+/* Tells the network engines whether they were reached from the Process*() */
+/* function of an async call, identified by the handle it passes as cookie */
+/*                                                                         */
+/* Returns  non-zero if the engine should hand its conversation to the I/O */
+/*          thread instead of blocking                                     */
+/*=========================================================================*/
+{
+    return G_AsyncStarting &&
+           (void*)G_AsyncStarting->handle == cookie &&
+           AsyncOnThread();
+}
+
+
+/*=========================================================================*/
+SLPError AsyncRqstRply(int sock,
+                       struct sockaddr_in* destaddr,
+                       const char* langtag,
+                       int extoffset,
+                       char* buf,
+                       char buftype,
+                       int bufsize,
+                       NetworkRplyCallback callback,
+                       void * cookie)
+/* NetworkRqstRply() for a connected stream socket, without blocking.  The */
+/* callbacks are made from the I/O thread once the reply is in             */
+/*                                                                         */
+/* Returns  SLP_OK if the conversation was started                         */
+/*=========================================================================*/
+{
+    SLPAsyncConv*   conv;
+    unsigned short  flags   = 0;
+    const char*     prlist  = 0;
+    socklen_t       size;
+    int             lowat;
+
+    conv = AsyncConvAlloc(G_AsyncStarting,ASYNC_CONV_RQST,callback,cookie);
+    if(conv == 0)
+    {
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+    conv->sockflags = fcntl(sock,F_GETFL,0);
+    conv->sock = sock;
+    AsyncSetNonBlocking(sock);
+    /* SLPNetworkConnectStream() sets a low water mark of 18 bytes, which  */
+    /* would keep select() from waking us for the rest of a short reply    */
+    /* once its header is read                                             */
+    size = sizeof(conv->socklowat);
+    conv->socklowat = 1;
+    getsockopt(sock,SOL_SOCKET,SO_RCVLOWAT,&(conv->socklowat),&size);
+    lowat = 1;
+    setsockopt(sock,SOL_SOCKET,SO_RCVLOWAT,&lowat,sizeof(lowat));
+    memcpy(&(conv->peeraddr),destaddr,sizeof(struct sockaddr_in));
+    conv->maxwait = SLPPropertyAsInteger(SLPGetProperty("net.slp.unicastMaximumWait"));
+    conv->xid = SLPXidGenerate();
+
+    if(buftype == SLP_FUNCT_SRVREG)
+    {
+        flags = SLP_FLAG_FRESH;
+    }
+    if(buftype == SLP_FUNCT_SRVRQST ||
+       buftype == SLP_FUNCT_ATTRRQST ||
+       buftype == SLP_FUNCT_SRVTYPERQST)
+    {
+        /* nobody has responded on a stream */
+        prlist = "";
+    }
+    conv->sendbuf = AsyncBuildMessage(0,
+                                      langtag,
+                                      extoffset,
+                                      buf,
+                                      buftype,
+                                      bufsize,
+                                      flags,
+                                      prlist,
+                                      conv->xid);
+    if(conv->sendbuf == 0)
+    {
+        AsyncConvDiscard(conv);
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+
+    conv->state = ASYNC_STATE_SEND;
+    AsyncDeadline(&(conv->deadline),conv->maxwait);
+
+    return SLP_OK;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPAsyncConv* AsyncMcastAlloc(SLPAsyncRqst* rqst,
+                                     const char* langtag,
+                                     char* buf,
+                                     char buftype,
+                                     int bufsize,
+                                     NetworkRplyCallback callback,
+                                     void * cookie)
+/* Sets up a multicast convergence conversation.  AsyncMcastBegin() starts */
+/* it                                                                      */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncConv*   conv;
+
+    conv = AsyncConvAlloc(rqst,ASYNC_CONV_MCAST,callback,cookie);
+    if(conv == 0)
+    {
+        return 0;
+    }
+
+    conv->mtu = SLPPropertyAsInteger(SLPGetProperty("net.slp.MTU"));
+    conv->usebroadcast = SLPPropertyAsBoolean(SLPGetProperty("net.slp.useBroadcast"));
+    conv->maxwait = SLPPropertyAsInteger(SLPGetProperty("net.slp.multicastMaximumWait"));
+    SLPPropertyAsIntegerVector(SLPGetProperty("net.slp.multicastTimeouts"),
+                               conv->timeouts,
+                               MAX_RETRANSMITS);
+
+    /* Special case for fake SLP_FUNCT_DASRVRQST */
+    if(buftype == SLP_FUNCT_DASRVRQST)
+    {
+        conv->maxwait = SLPPropertyAsInteger(SLPGetProperty("net.slp.DADiscoveryMaximumWait"));
+        SLPPropertyAsIntegerVector(SLPGetProperty("net.slp.DADiscoveryTimeouts"),
+                                   conv->timeouts,
+                                   MAX_RETRANSMITS);
+        buftype = SLP_FUNCT_SRVRQST;
+    }
+
+    conv->buftype = buftype;
+    conv->bufsize = bufsize;
+    conv->buf = (char*)memdup(buf,bufsize);
+    conv->langtag = xstrdup(langtag);
+    conv->prlist = (char*)xmalloc(conv->mtu);
+    if(conv->buf == 0 || conv->langtag == 0 || conv->prlist == 0)
+    {
+        AsyncConvDiscard(conv);
+        return 0;
+    }
+    *conv->prlist = 0;
+    conv->xid = SLPXidGenerate();
+
+    return conv;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncMcastBegin(SLPAsyncConv* conv, const char* iflist)
+/* Sends the first round of a multicast convergence conversation           */
+/*-------------------------------------------------------------------------*/
+{
+    if(SLPIfaceGetInfo(iflist ? iflist : SLPGetProperty("net.slp.interfaces"),
+                       &(conv->ifaceinfo)))
+    {
+        AsyncMcastFinish(conv,SLP_NETWORK_ERROR);
+    }
+    else
+    {
+        AsyncMcastXmit(conv);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDiscoverNext(SLPAsyncDiscovery* discovery);
+
+/*-------------------------------------------------------------------------*/
+static int AsyncDiscoverWait()
+/*-------------------------------------------------------------------------*/
+{
+    return SLPPropertyAsInteger(SLPGetProperty("net.slp.DADiscoveryMaximumWait"));
+}
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDiscoverRelease(SLPAsyncDiscovery* discovery)
+/* Counts off a conversation of the current step, or the hold on it while  */
+/* it starts.  The next step starts once the last is gone                  */
+/*-------------------------------------------------------------------------*/
+{
+    discovery->outstanding--;
+    if(discovery->outstanding == 0)
+    {
+        AsyncDiscoverNext(discovery);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPBoolean AsyncDiscoverCallback(SLPError errorcode,
+                                        struct sockaddr_in* peerinfo,
+                                        SLPBuffer replybuf,
+                                        void* cookie)
+/* Adds the DAs that answer, and counts off the conversation once it is    */
+/* over, with SLP_LAST_CALL or because KnownDADiscoveryCallback() wants no */
+/* more                                                                    */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncDiscovery* discovery = (SLPAsyncDiscovery*)cookie;
+
+    if(errorcode == SLP_OK &&
+       KnownDADiscoveryCallback(errorcode,
+                                peerinfo,
+                                replybuf,
+                                &(discovery->found)))
+    {
+        return SLP_TRUE;
+    }
+
+    AsyncDiscoverRelease(discovery);
+
+    return SLP_FALSE;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDiscoverAsk(SLPAsyncDiscovery* discovery,
+                             struct sockaddr_in* peeraddr,
+                             int scopelistlen,
+                             const char* scopelist)
+/* Asks slpd or a DA over TCP, as KnownDADiscoveryRqstRply() does with a   */
+/* socket                                                                  */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncConv*   conv;
+    char*           buf;
+    int             bufsize;
+
+    buf = KnownDADiscoveryRqst(scopelistlen,scopelist,&bufsize);
+    if(buf == 0)
+    {
+        return;
+    }
+
+    conv = AsyncConvAlloc(discovery->rqst,
+                          ASYNC_CONV_DISCOVER,
+                          AsyncDiscoverCallback,
+                          discovery);
+    if(conv)
+    {
+        discovery->outstanding++;
+        conv->looprecv = (peeraddr->sin_addr.s_addr == htonl(LOOPBACK_ADDRESS));
+        conv->maxwait = AsyncDiscoverWait();
+        conv->xid = SLPXidGenerate();
+        conv->sendbuf = AsyncBuildMessage(0,
+                                          "en",
+                                          0,
+                                          buf,
+                                          SLP_FUNCT_SRVRQST,
+                                          bufsize,
+                                          0,
+                                          "",
+                                          conv->xid);
+        if(conv->sendbuf == 0 ||
+           AsyncStreamConnect(conv,peeraddr,conv->maxwait))
+        {
+            memcpy(&(conv->peeraddr),peeraddr,sizeof(struct sockaddr_in));
+            AsyncStreamFinish(conv,SLP_NETWORK_ERROR);
+        }
+    }
+
+    xfree(buf);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDiscoverProps(SLPAsyncDiscovery* discovery)
+/* Asks the DAs in net.slp.DAAddresses, all at once                        */
+/*-------------------------------------------------------------------------*/
+{
+    char*               temp;
+    char*               slider1;
+    char*               slider2;
+    struct hostent*     he;
+    struct sockaddr_in  peeraddr;
+
+    memset(&peeraddr,0,sizeof(peeraddr));
+    peeraddr.sin_family = AF_INET;
+    peeraddr.sin_port = htons(SLP_RESERVED_PORT);
+
+    slider1 = slider2 = temp = xstrdup(SLPGetProperty("net.slp.DAAddresses"));
+    if(temp == 0)
+    {
+        return;
+    }
+    while(*slider1)
+    {
+        while(*slider2 && *slider2 != ',') slider2++;
+        if(*slider2)
+        {
+            *slider2++ = 0;
+        }
+
+        peeraddr.sin_addr.s_addr = 0;
+        if(inet_aton(slider1,&(peeraddr.sin_addr)) == 0)
+        {
+            he = gethostbyname(slider1);
+            if(he)
+            {
+                memcpy(&(peeraddr.sin_addr),he->h_addr_list[0],4);
+            }
+        }
+        if(peeraddr.sin_addr.s_addr)
+        {
+            AsyncDiscoverAsk(discovery,
+                             &peeraddr,
+                             discovery->scopelistlen,
+                             discovery->scopelist);
+        }
+
+        slider1 = slider2;
+    }
+    xfree(temp);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDiscoverDhcp(SLPAsyncDiscovery* discovery)
+/* Broadcasts a DHCPINFORM for the DAs and scopes DHCP knows about         */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncConv*   conv;
+    DHCPInform*     inform;
+    unsigned char   dhcpOpts[] = {TAG_SLP_SCOPE, TAG_SLP_DA};
+
+    *(discovery->dhcp.scopelist) = 0;
+    discovery->dhcp.addrlistlen = 0;
+
+    inform = DHCPInformOpen(dhcpOpts,sizeof(dhcpOpts));
+    if(inform == 0)
+    {
+        return;
+    }
+    conv = AsyncConvAlloc(discovery->rqst,ASYNC_CONV_DHCP,0,discovery);
+    if(conv == 0)
+    {
+        DHCPInformClose(inform);
+        return;
+    }
+    discovery->outstanding++;
+    conv->dhcp = inform;
+    conv->sock = DHCPInformSocket(inform);
+    conv->state = ASYNC_STATE_SEND;
+    AsyncDeadline(&(conv->deadline),AsyncDiscoverWait());
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDhcpFinish(SLPAsyncConv* conv, int replied)
+/* Asks the DAs DHCP named, in the scopes it named or net.slp.useScopes    */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncDiscovery*  discovery   = (SLPAsyncDiscovery*)conv->cookie;
+    DHCPContext*        ctx         = &(discovery->dhcp);
+    struct sockaddr_in  peeraddr;
+    const char*         usescopes;
+    unsigned char*      alp;
+
+    conv->state = ASYNC_STATE_DONE;
+
+    if(replied)
+    {
+        if(*(ctx->scopelist) == 0)
+        {
+            usescopes = SLPGetProperty("net.slp.useScopes");
+            if(usescopes && strlen(usescopes) < sizeof(ctx->scopelist))
+            {
+                strcpy(ctx->scopelist,usescopes);
+            }
+        }
+
+        memset(&peeraddr,0,sizeof(peeraddr));
+        peeraddr.sin_family = AF_INET;
+        peeraddr.sin_port = htons(SLP_RESERVED_PORT);
+        for(alp = ctx->addrlist; ctx->addrlistlen >= 4; alp += 4)
+        {
+            memcpy(&peeraddr.sin_addr.s_addr,alp,4);
+            if(peeraddr.sin_addr.s_addr)
+            {
+                AsyncDiscoverAsk(discovery,
+                                 &peeraddr,
+                                 strlen(ctx->scopelist),
+                                 ctx->scopelist);
+            }
+            ctx->addrlistlen -= 4;
+        }
+    }
+
+    AsyncDiscoverRelease(discovery);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDhcpService(SLPAsyncConv* conv,
+                             fd_set* readfds,
+                             fd_set* writefds,
+                             struct timeval* now)
+/* Sends the DHCPINFORM and waits for the reply, trying again as           */
+/* DHCPGetOptionInfo() does                                                */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncDiscovery*  discovery   = (SLPAsyncDiscovery*)conv->cookie;
+    int                 result      = 1;
+    int                 wait;
+
+    if(conv->state == ASYNC_STATE_SEND)
+    {
+        if(FD_ISSET(conv->sock,writefds))
+        {
+            wait = DHCPInformSend(conv->dhcp);
+            if(wait < 0)
+            {
+                AsyncDhcpFinish(conv,0);
+                return;
+            }
+            conv->state = ASYNC_STATE_RECV;
+            AsyncDeadline(&(conv->deadline),wait);
+        }
+        else if(AsyncIsBefore(&(conv->deadline),now))
+        {
+            AsyncDhcpFinish(conv,0);
+        }
+        return;
+    }
+
+    if(FD_ISSET(conv->sock,readfds))
+    {
+        result = DHCPInformRecv(conv->dhcp,DHCPParseSLPTags,&(discovery->dhcp));
+    }
+    if(result <= 0)
+    {
+        AsyncDhcpFinish(conv,result == 0);
+    }
+    else if(AsyncIsBefore(&(conv->deadline),now))
+    {
+        /* no reply to this try */
+        conv->state = ASYNC_STATE_SEND;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDiscoverMcast(SLPAsyncDiscovery* discovery)
+/* Multicasts for DAs, as KnownDADiscoverFromMulticast() does              */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncConv*   conv;
+    char*           buf;
+    int             bufsize;
+
+    if(SLPPropertyAsBoolean(SLPGetProperty("net.slp.activeDADetection")) == 0 ||
+       AsyncDiscoverWait() == 0)
+    {
+        return;
+    }
+
+    buf = KnownDADiscoveryRqst(discovery->scopelistlen,
+                               discovery->scopelist,
+                               &bufsize);
+    if(buf == 0)
+    {
+        return;
+    }
+    conv = AsyncMcastAlloc(discovery->rqst,
+#ifndef MI_NOT_SUPPORTED
+                           discovery->rqst->handle->langtag,
+#else
+                           "en",
+#endif
+                           buf,
+                           SLP_FUNCT_DASRVRQST,
+                           bufsize,
+                           AsyncDiscoverCallback,
+                           discovery);
+    xfree(buf);
+    if(conv)
+    {
+        discovery->outstanding++;
+#ifndef MI_NOT_SUPPORTED
+        AsyncMcastBegin(conv,discovery->rqst->handle->McastIFList);
+#else
+        AsyncMcastBegin(conv,NULL);
+#endif
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncDiscoverNext(SLPAsyncDiscovery* discovery)
+/* Starts the next step of the discovery while none found a DA, and lets   */
+/* the call run again once they are over                                   */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncRqst*       rqst = discovery->rqst;
+    struct sockaddr_in  peeraddr;
+
+    while(discovery->found == 0 && discovery->step < ASYNC_DISCOVER_MCAST)
+    {
+        /* hold the step until all of its conversations are started */
+        discovery->outstanding = 1;
+        discovery->step++;
+        switch(discovery->step)
+        {
+        case ASYNC_DISCOVER_IPC:
+            /* what the local slpd knows */
+            memset(&peeraddr,0,sizeof(peeraddr));
+            peeraddr.sin_family = AF_INET;
+            peeraddr.sin_port = htons(SLP_RESERVED_PORT);
+            peeraddr.sin_addr.s_addr = htonl(LOOPBACK_ADDRESS);
+            AsyncDiscoverAsk(discovery,&peeraddr,0,"");
+            break;
+
+        case ASYNC_DISCOVER_PROPS:
+            AsyncDiscoverProps(discovery);
+            break;
+
+        case ASYNC_DISCOVER_DHCP:
+            AsyncDiscoverDhcp(discovery);
+            break;
+
+        case ASYNC_DISCOVER_MCAST:
+            AsyncDiscoverMcast(discovery);
+            break;
+        }
+
+        discovery->outstanding--;
+        if(discovery->outstanding)
+        {
+            /* AsyncDiscoverRelease() comes back when they are over */
+            return;
+        }
+    }
+
+    discovery->step = ASYNC_DISCOVER_DONE;
+    rqst->discovery = 0;
+    xfree(discovery);
+    if(rqst != G_AsyncStarting)
+    {
+        /* its conversations go out now, to the DAs that were found */
+        rqst->rerun = 1;
+    }
+}
+
+
+/*=========================================================================*/
+SLPError AsyncMcastRqstRply(const char* langtag,
+                            const char* iflist,
+                            char* buf,
+                            char buftype,
+                            int bufsize,
+                            NetworkRplyCallback callback,
+                            void * cookie)
+/* NetworkMcastRqstRply() without blocking.  The convergence rounds run on */
+/* the I/O thread, interleaved with every other outstanding conversation   */
+/*                                                                         */
+/* iflist   (IN) interfaces to multicast on, NULL for net.slp.interfaces   */
+/*                                                                         */
+/* Returns  SLP_OK if the conversation was started                         */
+/*=========================================================================*/
+{
+    SLPAsyncConv*   conv;
+
+    conv = AsyncMcastAlloc(G_AsyncStarting,
+                           langtag,
+                           buf,
+                           buftype,
+                           bufsize,
+                           callback,
+                           cookie);
+    if(conv == 0)
+    {
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+    AsyncMcastBegin(conv,iflist);
+
+    return SLP_OK;
+}
+
+
+#ifndef UNICAST_NOT_SUPPORTED
+/*=========================================================================*/
+SLPError AsyncUcastRqstRply(PSLPHandleInfo handle,
+                            char* buf,
+                            char buftype,
+                            int bufsize,
+                            NetworkRplyCallback callback,
+                            void * cookie)
+/* NetworkUcastRqstRply() without blocking                                 */
+/*                                                                         */
+/* Returns  SLP_OK if the conversation was started                         */
+/*=========================================================================*/
+{
+    SLPAsyncConv*   conv;
+
+    conv = AsyncConvAlloc(G_AsyncStarting,ASYNC_CONV_UCAST,callback,cookie);
+    if(conv == 0)
+    {
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+
+    SLPPropertyAsIntegerVector(SLPGetProperty("net.slp.unicastTimeouts"),
+                               conv->timeouts,
+                               MAX_RETRANSMITS);
+    if(buftype == SLP_FUNCT_DASRVRQST)
+    {
+        SLPPropertyAsIntegerVector(SLPGetProperty("net.slp.DADiscoveryTimeouts"),
+                                   conv->timeouts,
+                                   MAX_RETRANSMITS);
+        buftype = SLP_FUNCT_SRVRQST;
+    }
+    /* the blocking engine uses the first timeout for every step */
+    conv->maxwait = conv->timeouts[0];
+    conv->xid = SLPXidGenerate();
+
+    conv->sendbuf = AsyncBuildMessage(0,
+                                      handle->langtag,
+                                      0,
+                                      buf,
+                                      buftype,
+                                      bufsize,
+                                      SLP_FLAG_UCAST,
+                                      "",
+                                      conv->xid);
+    if(conv->sendbuf == 0)
+    {
+        AsyncConvDiscard(conv);
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+
+    if(AsyncStreamConnect(conv,&(handle->unicastaddr),conv->maxwait))
+    {
+        AsyncStreamFinish(conv,SLP_NETWORK_TIMED_OUT);
+    }
+
+    return SLP_OK;
+}
+#endif
+
+static SLPBoolean AsyncMergeMcastCallback(SLPError errorcode,
+                                          struct sockaddr_in* peerinfo,
+                                          SLPBuffer replybuf,
+                                          void* cookie);
+
+/*-------------------------------------------------------------------------*/
+static void AsyncMergeStop(SLPAsyncMerge* merge)
+/* Ends every conversation of the merge without any more callbacks         */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncConv* conv;
+
+    merge->stopped = 1;
+    merge->mcast = 0;
+    for(conv = (SLPAsyncConv*)merge->rqst->convs.head;
+        conv;
+        conv = (SLPAsyncConv*)conv->listitem.next)
+    {
+        if(conv->cookie == merge)
+        {
+            AsyncConvCancel(conv);
+        }
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncMergeMcast(SLPAsyncMerge* merge)
+/* Starts multicast convergence for the merge unless it already ran        */
+/*-------------------------------------------------------------------------*/
+{
+    PSLPHandleInfo  handle  = merge->rqst->handle;
+    SLPAsyncConv*   conv;
+    const char*     iflist  = 0;
+
+    if(merge->mcaststarted)
+    {
+        return;
+    }
+    merge->mcaststarted = 1;
+
+    conv = AsyncMcastAlloc(merge->rqst,
+                           handle->langtag,
+                           merge->buf,
+                           merge->buftype,
+                           merge->bufsize,
+                           AsyncMergeMcastCallback,
+                           merge);
+    if(conv == 0)
+    {
+        merge->result = SLP_MEMORY_ALLOC_FAILED;
+        return;
+    }
+
+    /* the DAs that already replied need not answer again */
+    if(merge->prlistlen < conv->mtu)
+    {
+        strcpy(conv->prlist,merge->prlist);
+        conv->prlistlen = merge->prlistlen;
+    }
+    conv->quietwait = SLPPropertyAsInteger(SLPGetProperty("net.slp.multicastQuietWait"));
+
+#ifndef MI_NOT_SUPPORTED
+    iflist = handle->McastIFList;
+#endif /* MI_NOT_SUPPORTED */
+    merge->outstanding++;
+    AsyncMcastBegin(conv,iflist);
+    if(conv->state != ASYNC_STATE_DONE)
+    {
+        merge->mcast = conv;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void AsyncMergeRelease(SLPAsyncMerge* merge)
+/* Makes the final callback once nothing of the merge is outstanding       */
+/*-------------------------------------------------------------------------*/
+{
+    merge->outstanding--;
+    if(merge->outstanding || merge->stopped)
+    {
+        return;
+    }
+
+    if(merge->rplycount ||
+       merge->succeeded ||
+       merge->result == SLP_NETWORK_TIMED_OUT)
+    {
+        merge->callback(SLP_LAST_CALL,NULL,NULL,merge->cookie);
+    }
+    else
+    {
+        merge->callback(merge->result,NULL,NULL,merge->cookie);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int AsyncMergeHedgeEnd(SLPAsyncMerge* merge, int cancel)
+/* Drops the hedge of a merge if it still waits, and with cancel the DA    */
+/* already asked too.  Returns the number of DAs still being asked         */
+/*-------------------------------------------------------------------------*/
+{
+    SLPAsyncConv*   conv;
+    struct timeval  now;
+    int             count   = 0;
+
+    gettimeofday(&now,0);
+    for(conv = (SLPAsyncConv*)merge->rqst->convs.head;
+        conv;
+        conv = (SLPAsyncConv*)conv->listitem.next)
+    {
+        if(conv->cookie != merge ||
+           conv->type != ASYNC_CONV_DA ||
+           conv->state == ASYNC_STATE_DONE)
+        {
+            continue;
+        }
+        if(conv->state != ASYNC_STATE_HEDGE && cancel)
+        {
+            /* it took at least this long */
+            KnownDARttReply(&(conv->peeraddr.sin_addr),
+                            (now.tv_sec - conv->started.tv_sec) * 1000 +
+                            (now.tv_usec - conv->started.tv_usec) / 1000);
+        }
+        if(conv->state == ASYNC_STATE_HEDGE || cancel)
+        {
+            /* it will not call back, so release it here */
+            AsyncConvCancel(conv);
+            AsyncMergeRelease(merge);
+            continue;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPBoolean AsyncMergeReply(SLPAsyncMerge* merge,
+                                  int isda,
+                                  SLPError errorcode,
+                                  struct sockaddr_in* peerinfo,
+                                  SLPBuffer replybuf)
+/* Passes replies on, and the one final callback once every conversation   */
+/* of the merge has reported its own                                       */
+/*-------------------------------------------------------------------------*/
+{
+    if(merge->stopped)
+    {
+        return SLP_FALSE;
+    }
+
+    if(errorcode == SLP_OK)
+    {
+        merge->rplycount++;
+        if(merge->callback(SLP_OK,peerinfo,replybuf,merge->cookie) == SLP_FALSE)
+        {
+            AsyncMergeStop(merge);
+            return SLP_FALSE;
+        }
+        if(isda && merge->hedged)
+        {
+            /* the slower of the pair is not needed, nor is it bad */
+            AsyncMergeHedgeEnd(merge,1);
+        }
+        if(isda)
+        {
+            AsyncPrlistAdd(merge->prlist,&(merge->prlistlen),merge->mtu,peerinfo);
+            if(merge->mcast)
+            {
+                AsyncPrlistAdd(merge->mcast->prlist,
+                               &(merge->mcast->prlistlen),
+                               merge->mcast->mtu,
+                               peerinfo);
+            }
+        }
+        return SLP_TRUE;
+    }
+
+    if(isda == 0)
+    {
+        merge->mcast = 0;
+    }
+    if(errorcode == SLP_LAST_CALL)
+    {
+        merge->succeeded++;
+    }
+    else
+    {
+        merge->result = errorcode;
+        if(isda && peerinfo)
+        {
+            /* multicast takes over from a DA that failed right away, */
+            /* unless the other DA of a hedged pair is still asked     */
+            KnownDABadDA(&(peerinfo->sin_addr));
+            if(merge->hedged == 0 || AsyncMergeHedgeEnd(merge,0) == 0)
+            {
+                AsyncMergeMcast(merge);
+            }
+        }
+    }
+
+    AsyncMergeRelease(merge);
+
+    return SLP_TRUE;
+}
+
+/*-------------------------------------------------------------------------*/
+static SLPBoolean AsyncMergeDACallback(SLPError errorcode,
+                                       struct sockaddr_in* peerinfo,
+                                       SLPBuffer replybuf,
+                                       void* cookie)
+/*-------------------------------------------------------------------------*/
+{
+    return AsyncMergeReply((SLPAsyncMerge*)cookie,1,errorcode,peerinfo,replybuf);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPBoolean AsyncMergeMcastCallback(SLPError errorcode,
+                                          struct sockaddr_in* peerinfo,
+                                          SLPBuffer replybuf,
+                                          void* cookie)
+/*-------------------------------------------------------------------------*/
+{
+    return AsyncMergeReply((SLPAsyncMerge*)cookie,0,errorcode,peerinfo,replybuf);
+}
+
+
+/*=========================================================================*/
+int AsyncDiscoverStarting()
+/* Tells KnownDAFromCache() whether it was reached from the Process*()     */
+/* function of an async call, on the I/O thread, which must not block to   */
+/* discover DAs                                                            */
+/*                                                                         */
+/* Returns  non-zero if AsyncDiscoverStart() should discover them          */
+/*=========================================================================*/
+{
+    return G_AsyncStarting && AsyncOnThread();
+}
+
+
+/*=========================================================================*/
+SLPError AsyncDiscoverStart(int scopelistlen, const char* scopelist)
+/* Discovers DAs for the async call being started the way                  */
+/* KnownDAFromCache() does, with conversations the I/O thread multiplexes  */
+/* with every other.  The call starts none of its own meanwhile, its       */
+/* Process*() function runs again once the discovery is over               */
+/*                                                                         */
+/* Returns  SLP_OK if the discovery was started                            */
+/*=========================================================================*/
+{
+    SLPAsyncDiscovery* discovery;
+
+    discovery = (SLPAsyncDiscovery*)xmalloc(sizeof(SLPAsyncDiscovery) +
+                                            scopelistlen + 1);
+    if(discovery == 0)
+    {
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+    memset(discovery,0,sizeof(SLPAsyncDiscovery));
+    discovery->rqst = G_AsyncStarting;
+    discovery->scopelistlen = scopelistlen;
+    discovery->scopelist = (char*)(discovery + 1);
+    memcpy(discovery->scopelist,scopelist,scopelistlen);
+    discovery->scopelist[scopelistlen] = 0;
+
+    G_AsyncStarting->discovery = discovery;
+    AsyncDiscoverNext(discovery);
+
+    return SLP_OK;
+}
+
+
+/*=========================================================================*/
+SLPError AsyncMultiRqstRply(PSLPHandleInfo handle,
+                            const char* scopelist,
+                            int scopelistlen,
+                            struct in_addr* daaddrs,
+                            int dacount,
+                            int uncovered,
+                            char* buf,
+                            char buftype,
+                            int bufsize,
+                            NetworkRplyCallback callback,
+                            void * cookie)
+/* NetworkMultiRqstRply() without blocking, once the DAs are chosen        */
+/*                                                                         */
+/* daaddrs  (IN) the DAs to ask                                            */
+/*                                                                         */
+/* dacount  (IN) the number of addresses in daaddrs                        */
+/*                                                                         */
+/* uncovered (IN) non-zero to multicast for scopes no DA in daaddrs has    */
+/*                                                                         */
+/* Returns  SLP_OK if the conversation was started                         */
+/*=========================================================================*/
+{
+    SLPAsyncMerge*      merge;
+    SLPAsyncConv*       conv;
+    struct sockaddr_in  peeraddr;
+    struct in_addr      hedgeaddr;
+    int                 delay;
+    int                 i;
+
+    if(G_AsyncStarting->discovery)
+    {
+        /* asked once the DAs for the scopes are discovered */
+        return SLP_OK;
+    }
+
+    merge = (SLPAsyncMerge*)xmalloc(sizeof(SLPAsyncMerge));
+    if(merge == 0)
+    {
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+    memset(merge,0,sizeof(SLPAsyncMerge));
+    SLPListLinkTail(&(G_AsyncStarting->merges),(SLPListItem*)merge);
+    merge->rqst = G_AsyncStarting;
+    merge->result = SLP_OK;
+    merge->callback = callback;
+    merge->cookie = cookie;
+    merge->buftype = buftype;
+    merge->bufsize = bufsize;
+    merge->buf = (char*)memdup(buf,bufsize);
+    merge->scopelistlen = scopelistlen;
+    merge->scopelist = (char*)xmalloc(scopelistlen + 1);
+    merge->mtu = SLPPropertyAsInteger(SLPGetProperty("net.slp.MTU"));
+    merge->prlist = (char*)xmalloc(merge->mtu);
+    if(merge->buf == 0 || merge->scopelist == 0 || merge->prlist == 0)
+    {
+        /* AsyncRqstDone() frees the merge */
+        return SLP_MEMORY_ALLOC_FAILED;
+    }
+    memcpy(merge->scopelist,scopelist,scopelistlen);
+    merge->scopelist[scopelistlen] = 0;
+    *(merge->prlist) = 0;
+
+    /* hold the final callback until every conversation is under way */
+    merge->outstanding = 1;
+
+    memset(&peeraddr,0,sizeof(peeraddr));
+    peeraddr.sin_family = AF_INET;
+    peeraddr.sin_port = htons(SLP_RESERVED_PORT);
+    for(i = 0; i < dacount && merge->stopped == 0; i++)
+    {
+        conv = AsyncConvAlloc(merge->rqst,
+                              ASYNC_CONV_DA,
+                              AsyncMergeDACallback,
+                              merge);
+        if(conv == 0)
+        {
+            merge->result = SLP_MEMORY_ALLOC_FAILED;
+            AsyncMergeMcast(merge);
+            continue;
+        }
+        merge->outstanding++;
+        peeraddr.sin_addr = daaddrs[i];
+        conv->handover = (dacount == 1 && uncovered == 0);
+        conv->maxwait = SLPPropertyAsInteger(SLPGetProperty("net.slp.unicastMaximumWait"));
+        conv->xid = SLPXidGenerate();
+        conv->sendbuf = AsyncBuildMessage(0,
+                                          handle->langtag,
+                                          0,
+                                          buf,
+                                          buftype,
+                                          bufsize,
+                                          0,
+                                          "",
+                                          conv->xid);
+        if(conv->sendbuf == 0 ||
+           AsyncStreamConnect(conv,
+                              &peeraddr,
+                              SLPPropertyAsInteger(SLPGetProperty("net.slp.DADiscoveryMaximumWait"))))
+        {
+            memcpy(&(conv->peeraddr),&peeraddr,sizeof(struct sockaddr_in));
+            AsyncStreamFinish(conv,SLP_NETWORK_ERROR);
+        }
+    }
+    if(uncovered && merge->stopped == 0)
+    {
+        AsyncMergeMcast(merge);
+    }
+    else if(dacount == 1 &&
+            merge->mcaststarted == 0 &&
+            merge->stopped == 0 &&
+            KnownDAFindHedge(handle,
+                             scopelistlen,
+                             scopelist,
+                             &daaddrs[0],
+                             &hedgeaddr) &&
+            (delay = KnownDAHedgeDelay(&daaddrs[0])) > 0)
+    {
+        /* a second DA, asked only if the first is slow */
+        conv = AsyncConvAlloc(merge->rqst,
+                              ASYNC_CONV_DA,
+                              AsyncMergeDACallback,
+                              merge);
+        if(conv)
+        {
+            peeraddr.sin_addr = hedgeaddr;
+            memcpy(&(conv->peeraddr),&peeraddr,sizeof(struct sockaddr_in));
+            conv->handover = 1;
+            conv->maxwait = SLPPropertyAsInteger(SLPGetProperty("net.slp.unicastMaximumWait"));
+            conv->xid = SLPXidGenerate();
+            conv->sendbuf = AsyncBuildMessage(0,
+                                              handle->langtag,
+                                              0,
+                                              buf,
+                                              buftype,
+                                              bufsize,
+                                              0,
+                                              "",
+                                              conv->xid);
+            if(conv->sendbuf)
+            {
+                merge->hedged = 1;
+                merge->outstanding++;
+                conv->state = ASYNC_STATE_HEDGE;
+                AsyncDeadline(&(conv->deadline),delay);
+            }
+            else
+            {
+                AsyncConvDiscard(conv);
+            }
+        }
+    }
+
+    /* let go of the hold, which may be the last thing outstanding */
+    AsyncMergeRelease(merge);
+
+    return SLP_OK;
+}
+
+#else /* _WIN32 */
+
+/*=========================================================================*/
+SLPError AsyncRqstStart(PSLPHandleInfo handle,
+                        AsyncProcessProc process,
+                        AsyncDoneProc done)
+/* The I/O thread is not available on win32, SLPOpen() refuses isAsync     */
+/*=========================================================================*/
+{
+    return SLP_NOT_IMPLEMENTED;
+}
+
+
+/*=========================================================================*/
+int AsyncRqstClose(PSLPHandleInfo handle)
+/*=========================================================================*/
+{
+    return 0;
+}
+
+
+/*=========================================================================*/
+int AsyncRqstCancelled(PSLPHandleInfo handle)
+/*=========================================================================*/
+{
+    return 0;
+}
+
+#endif /* _WIN32 */
+#endif /* ENABLE_ASYNC_API */
@@ -274,6 +274,32 @@ typedef struct srvurl
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+typedef struct srvregitem
+/*                                                                         */
+/* One advertisement of a batch passed to SLPRegBatch() or SLPDeregBatch() */
+/*=========================================================================*/
+{
+    const char *s_pcSrvURL;
+    /* The URL to register or deregister.  Must conform to SLP Service URL */
+    /* syntax.                                                             */
+
+    const char *s_pcSrvType;
+    /* Ignored, as by SLPReg(), since the URL encapsulates the service     */
+    /* type.  May be NULL.                                                 */
+
+    const char *s_pcAttrs;
+    /* The attribute list to register, "" for none.  Ignored by            */
+    /* SLPDeregBatch().                                                    */
+
+    unsigned short s_usLifetime;
+    /* The lifetime to register, as for SLPReg().  Ignored by              */
+    /* SLPDeregBatch().                                                    */
+
+} SLPRegItem;
+/*=========================================================================*/
+
+
 #if(!defined SLPHANDLE_INTERNAL)
 
 /*=========================================================================*/
@@ -306,6 +332,28 @@ typedef void SLPCALLBACK SLPRegReport(SLPHandle hSLP,
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+typedef void SLPCALLBACK SLPRegBatchReport(SLPHandle hSLP,
+                               int iItem,
+                               SLPError errCode,
+                               void *pvCookie);
+/*                                                                         */
+/* The SLPRegBatchReport callback type is the type of the callback         */
+/* function to the SLPRegBatch() and SLPDeregBatch() functions.  It is     */
+/* called once for every item of the batch, not necessarily in order.      */
+/*                                                                         */
+/* hSLP     The SLPHandle used to initiate the operation.                  */
+/*                                                                         */
+/* iItem    The index in the batch of the item the report is about.        */
+/*                                                                         */
+/* errCode  An error code indicating if an error occurred during the       */
+/*          operation on that item.                                        */
+/*                                                                         */
+/* pvCookie Memory passed down from the client code that called the        */
+/*          original API function, starting the operation.  May be NULL.   */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 typedef SLPBoolean SLPCALLBACK SLPSrvTypeCallback(SLPHandle hSLP,
                                       const char* pcSrvTypes,
@@ -584,6 +632,43 @@ SLPEXP SLPError SLPAPI SLPReg(SLPHandle   hSLP,
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+SLPEXP SLPError SLPAPI SLPRegBatch(SLPHandle   hSLP,
+                     const SLPRegItem *pItems,
+                     int iCount,
+                     SLPBoolean fresh,
+                     SLPRegBatchReport callback,
+                     void *pvCookie); 
+/*                                                                         */
+/* Registers each of the iCount advertisements in pItems, as SLPReg()      */
+/* would.  The registrations are sent to slpd over one connection without  */
+/* waiting for each to be acknowledged, so registering thousands of URLs   */
+/* takes a fraction of the time of as many SLPReg() calls.  The handle     */
+/* must have been opened synchronously.                                    */
+/*                                                                         */
+/* hSLP         The language specific SLPHandle on which to register the   */
+/*              advertisements.                                            */
+/*                                                                         */
+/* pItems       The advertisements to register.                            */
+/*                                                                         */
+/* iCount       The number of items in pItems.                             */
+/*                                                                         */
+/* fresh        As for SLPReg(), SLP_TRUE must be passed in.               */
+/*                                                                         */
+/* callback     A SLPRegBatchReport callback, called with the status of    */
+/*              each item.                                                 */
+/*                                                                         */
+/* pvCookie     Memory passed to the callback code from the client.  May be*/
+/*              NULL.                                                      */
+/*                                                                         */
+/* Returns:     If the batch cannot be started, one of the SLPError codes  */
+/*              is returned and the callback is not called.  Otherwise     */
+/*              every item is reported through the callback, and the error */
+/*              that ended the batch early, if any, is returned.  The items*/
+/*              it kept from being registered are reported with it.        */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 SLPEXP SLPError SLPAPI SLPDereg(SLPHandle  hSLP,
                   const char *pcSrvURL,
@@ -612,6 +697,34 @@ SLPEXP SLPError SLPAPI SLPDereg(SLPHandle  hSLP,
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+SLPEXP SLPError SLPAPI SLPDeregBatch(SLPHandle   hSLP,
+                       const SLPRegItem *pItems,
+                       int iCount,
+                       SLPRegBatchReport callback,
+                       void *pvCookie); 
+/*                                                                         */
+/* Deregisters the URL of each of the iCount items in pItems, as           */
+/* SLPDereg() would, over one connection to slpd.  Only the s_pcSrvURL     */
+/* member of the items is used.  The handle must have been opened          */
+/* synchronously.                                                          */
+/*                                                                         */
+/* hSLP         The language specific SLPHandle to use for deregistering.  */
+/*                                                                         */
+/* pItems       The advertisements to deregister.                          */
+/*                                                                         */
+/* iCount       The number of items in pItems.                             */
+/*                                                                         */
+/* callback     A SLPRegBatchReport callback, called with the status of    */
+/*              each item.                                                 */
+/*                                                                         */
+/* pvCookie     Memory passed to the callback code from the client.  May be*/
+/*              NULL.                                                      */
+/*                                                                         */
+/* Returns:     As for SLPRegBatch().                                      */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 SLPEXP SLPError SLPAPI SLPDelAttrs(SLPHandle   hSLP,
                      const char  *pcSrvURL,
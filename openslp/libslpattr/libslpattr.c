@@ -81,15 +81,19 @@
  */
 char const *find_tag_end(const char *tag)
 {
-    char const *cur = tag; /* Pointer into the tag for working. */
+    char const *cur; /* Pointer into the tag for working. */
+    char const *end; /* The null terminator. */
 
-    while(*cur)
+    /* Every invalid tag character is one that SLPScanSpecial() stops at. */
+    end = tag + strlen(tag);
+    cur = SLPScanSpecial(tag, end);
+    while(cur < end)
     {
         if(IS_INVALID_TAG_CHAR(*cur))
         {
             break;
         }
-        cur++;
+        cur = SLPScanSpecial(cur + 1, end);
     }
 
     return cur;
@@ -138,6 +142,7 @@ char *unescape_into(char *dest, const char *src, int len, int
                     *unescaped_len)
 {
     char *start, *write;
+    const char *escape;
     int i;
 
     assert(dest);
@@ -147,6 +152,18 @@ char *unescape_into(char *dest, const char *src, int len, int
 
     for(i = 0; i < len; i++, write++)
     {
+        /* Copy everything up to the next escape as a block. */
+        escape = memchr(src + i, ESCAPE_CHARACTER, len - i);
+        if(escape == NULL)
+        {
+            memcpy(write, src + i, len - i);
+            write += len - i;
+            break;
+        }
+        memcpy(write, src + i, escape - (src + i));
+        write += escape - (src + i);
+        i = escape - src;
+
         if(src[i] == ESCAPE_CHARACTER)
         {
             /*** Check that the characters are legal, and that the value has
@@ -574,26 +591,32 @@ void escape(char to_escape, char **dest, SLPBoolean (test_fn)(const char))
 char *escape_into(char *dest, char *src, int len)
 {
     char *cur_dest; /* Current character in dest. */
-    cur_dest = dest;
+    const char *cur_src; /* Current character in src. */
+    const char *end_src; /* End of src. */
+    const char *special; /* Next character that might need escaping. */
+
     if(len < 0)
     {
         /* Treat as null terminated. */
-        char *cur_src; /* Current character in src. */
-
-        cur_src = src;
-        for(; *cur_src; cur_src++)
-        {
-            escape(*cur_src, &cur_dest, is_legal_slp_char);
-        }
+        len = strlen(src);
     }
-    else
-    {
-        /* known length. */
-        int i; /* Index into src. */
-        for(i = 0; i < len; i++)
+
+    /* Every character that must be escaped is one that SLPScanSpecial()
+     * stops at, so runs of other characters are copied as a block. */
+    cur_dest = dest;
+    cur_src = src;
+    end_src = src + len;
+    while(cur_src < end_src)
+    {
+        special = SLPScanSpecial(cur_src, end_src);
+        memcpy(cur_dest, cur_src, special - cur_src);
+        cur_dest += special - cur_src;
+        if(special == end_src)
         {
-            escape(src[i], &cur_dest, is_legal_slp_char);
+            break;
         }
+        escape(*special, &cur_dest, is_legal_slp_char);
+        cur_src = special + 1;
     }
     return cur_dest;
 }
@@ -88,6 +88,14 @@
                                                                     
 #define SLPD_AGE_INTERVAL           15   /* age every 15 seconds           */
 
+#define SLPD_POOL_LIMIT             64   /* freed buffers of each size and */
+                                         /* message descriptors kept for   */
+                                         /* reuse                          */
+
+#define SLPD_MAX_PIPELINE           16   /* replies queued on one stream   */
+                                         /* connection before slpd stops   */
+                                         /* reading requests from it       */
+
 
 /*=========================================================================*/
 /* Global variables representing signals */
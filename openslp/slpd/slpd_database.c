@@ -130,6 +130,7 @@ void SLPDDatabaseAge(int seconds, int ageall)
             {
                 SLPDLogRegistration("Timeout",entry);
 		SLPDatabaseRemove(dh,entry);
+		G_SlpdDatabase.changes++;
             }
         }
 
@@ -174,6 +175,23 @@ int SLPDDatabaseReg(SLPMessage msg, SLPBuffer buf)
         return SLP_ERROR_INVALID_REGISTRATION;
     }
 
+    /* fold the srvtype, url and scopes once for all later comparisons */
+    if ( reg->keys == NULL )
+    {
+        reg->keys = SLPFoldedKeysCreate(reg->srvtypelen,
+                                        reg->srvtype,
+                                        0,
+                                        NULL,
+                                        reg->urlentry.urllen,
+                                        reg->urlentry.url,
+                                        reg->scopelistlen,
+                                        reg->scopelist);
+        if ( reg->keys == NULL )
+        {
+            return SLP_ERROR_INTERNAL_ERROR;
+        }
+    }
+
     dh = SLPDatabaseOpen(&G_SlpdDatabase.database);
     if ( dh )
     {
@@ -188,15 +206,11 @@ int SLPDDatabaseReg(SLPMessage msg, SLPBuffer buf)
             /* entry reg is the SrvReg message from the database */
             entryreg = &(entry->msg->body.srvreg);
 
-            if ( SLPCompareString(entryreg->urlentry.urllen,
-                                  entryreg->urlentry.url,
-                                  reg->urlentry.urllen,
-                                  reg->urlentry.url) == 0 )
+            if ( SLPFoldedCompareString(&entryreg->keys->url,
+                                        &reg->keys->url) == 0 )
             {
-                if ( SLPIntersectStringList(entryreg->scopelistlen,
-                                            entryreg->scopelist,
-                                            reg->scopelistlen,
-                                            reg->scopelist) > 0 )
+                if ( SLPFoldedIntersectScopes(entryreg->keys,
+                                              reg->keys) > 0 )
                 {
 
                     /* Check to ensure the source addr is the same */
@@ -220,6 +234,7 @@ int SLPDDatabaseReg(SLPMessage msg, SLPBuffer buf)
 #endif  
                     /* Remove the identical entry */
                     SLPDatabaseRemove(dh,entry);
+                    G_SlpdDatabase.changes++;
                     break;
                 }
             }
@@ -246,6 +261,7 @@ int SLPDDatabaseReg(SLPMessage msg, SLPBuffer buf)
 
             /* add to database */
             SLPDatabaseAdd(dh, entry);
+            G_SlpdDatabase.changes++;
             SLPDLogRegistration("Registration",entry);
 
             /* SUCCESS! */
@@ -280,12 +296,27 @@ int SLPDDatabaseDeReg(SLPMessage msg)
     SLPDatabaseEntry*   entry;
     SLPSrvReg*          entryreg;
     SLPSrvDeReg*        dereg;
+    SLPFoldedKeys*      keys;
+
+    /* dereg is the SrvDereg being deregistered */
+    dereg = &(msg->body.srvdereg);
+
+    keys = SLPFoldedKeysCreate(0,
+                               NULL,
+                               0,
+                               NULL,
+                               dereg->urlentry.urllen,
+                               dereg->urlentry.url,
+                               dereg->scopelistlen,
+                               dereg->scopelist);
+    if ( keys == NULL )
+    {
+        return SLP_ERROR_INTERNAL_ERROR;
+    }
 
     dh = SLPDatabaseOpen(&G_SlpdDatabase.database);
     if ( dh )
     {
-        /* dereg is the SrvDereg being deregistered */
-        dereg = &(msg->body.srvdereg);
 
         /*---------------------------------------------*/
         /* Check to see if there is an identical entry */
@@ -298,15 +329,10 @@ int SLPDDatabaseDeReg(SLPMessage msg)
             /* entry reg is the SrvReg message from the database */
             entryreg = &(entry->msg->body.srvreg);
 
-            if ( SLPCompareString(entryreg->urlentry.urllen,
-                                  entryreg->urlentry.url,
-                                  dereg->urlentry.urllen,
-                                  dereg->urlentry.url) == 0 )
+            if ( SLPFoldedCompareString(&entryreg->keys->url,
+                                        &keys->url) == 0 )
             {
-                if ( SLPIntersectStringList(entryreg->scopelistlen,
-                                            entryreg->scopelist,
-                                            dereg->scopelistlen,
-                                            dereg->scopelist) > 0 )
+                if ( SLPFoldedIntersectScopes(entryreg->keys, keys) > 0 )
                 {
 
                     /* Check to ensure the source addr is the same as */
@@ -317,6 +343,7 @@ int SLPDDatabaseDeReg(SLPMessage msg)
                                 sizeof(struct in_addr)) )
                     {
                         SLPDatabaseClose(dh);
+                        SLPFoldedKeysFree(keys);
                         return SLP_ERROR_AUTHENTICATION_FAILED;
                     }
 
@@ -325,12 +352,14 @@ int SLPDDatabaseDeReg(SLPMessage msg)
                          entryreg->urlentry.authcount != dereg->urlentry.authcount )
                     {
                         SLPDatabaseClose(dh);
+                        SLPFoldedKeysFree(keys);
                         return SLP_ERROR_AUTHENTICATION_FAILED;
                     }
 #endif                    
                     /* remove the registration from the database */
                     SLPDLogRegistration("Deregistration",entry);
 		    SLPDatabaseRemove(dh,entry);
+		    G_SlpdDatabase.changes++;
                     break;
                 }
             }
@@ -340,10 +369,12 @@ int SLPDDatabaseDeReg(SLPMessage msg)
 
         if ( entry==NULL )
         {
+            SLPFoldedKeysFree(keys);
             return SLP_ERROR_INVALID_REGISTRATION;
         }
     }
 
+    SLPFoldedKeysFree(keys);
     return 0;
 }
 
@@ -365,6 +396,7 @@ int SLPDDatabaseSrvRqstStart(SLPMessage msg,
     SLPDatabaseEntry*           entry;
     SLPSrvReg*                  entryreg;
     SLPSrvRqst*                 srvrqst;
+    SLPFoldedKeys*              keys;
 #ifdef ENABLE_SLPv2_SECURITY
     int                         i;
 #endif
@@ -373,12 +405,25 @@ int SLPDDatabaseSrvRqstStart(SLPMessage msg,
     /* start with the result set to NULL just to be safe */
     *result = NULL;
 
+    /* srvrqst is the SrvRqst being made */
+    srvrqst = &(msg->body.srvrqst);
+
+    keys = SLPFoldedKeysCreate(srvrqst->srvtypelen,
+                               srvrqst->srvtype,
+                               0,
+                               NULL,
+                               0,
+                               NULL,
+                               srvrqst->scopelistlen,
+                               srvrqst->scopelist);
+    if ( keys == NULL )
+    {
+        return SLP_ERROR_INTERNAL_ERROR;
+    }
+
     dh = SLPDatabaseOpen(&G_SlpdDatabase.database);
     if ( dh )
     {
-        /* srvrqst is the SrvRqst being made */
-        srvrqst = &(msg->body.srvrqst);
-
         while ( 1 )
         {
             /*-----------------------------------------------------------*/
@@ -389,6 +434,7 @@ int SLPDDatabaseSrvRqstStart(SLPMessage msg,
             {
                 /* out of memory */
                 SLPDatabaseClose(dh);
+                SLPFoldedKeysFree(keys);
                 return SLP_ERROR_INTERNAL_ERROR;
             }
             (*result)->urlarray = (SLPUrlEntry**)((*result) + 1);
@@ -409,6 +455,7 @@ int SLPDDatabaseSrvRqstStart(SLPMessage msg,
                 if ( entry == NULL )
                 {
                     /* This is the only successful way out */
+                    SLPFoldedKeysFree(keys);
                     return 0;
                 }
 
@@ -416,14 +463,8 @@ int SLPDDatabaseSrvRqstStart(SLPMessage msg,
                 entryreg = &(entry->msg->body.srvreg);
 
                 /* check the service type */
-                if ( SLPCompareSrvType(srvrqst->srvtypelen,
-                                       srvrqst->srvtype,
-                                       entryreg->srvtypelen,
-                                       entryreg->srvtype) == 0 &&
-                     SLPIntersectStringList(entryreg->scopelistlen,
-                                            entryreg->scopelist,
-                                            srvrqst->scopelistlen,
-                                            srvrqst->scopelist) > 0 )
+                if ( SLPFoldedCompareSrvType(keys, entryreg->keys) == 0 &&
+                     SLPFoldedIntersectScopes(entryreg->keys, keys) > 0 )
                 {
 #ifdef ENABLE_PREDICATES
                     if ( SLPDPredicateTest(msg->header.version,
@@ -468,6 +509,7 @@ int SLPDDatabaseSrvRqstStart(SLPMessage msg,
         }
     }
 
+    SLPFoldedKeysFree(keys);
     return 0;
 }
 
@@ -509,13 +551,27 @@ int SLPDDatabaseSrvTypeRqstStart(SLPMessage msg,
     SLPDatabaseEntry*           entry;
     SLPSrvReg*                  entryreg;
     SLPSrvTypeRqst*             srvtyperqst;
+    SLPFoldedKeys*              keys;
+
+    /* srvtyperqst is the SrvTypeRqst being made */
+    srvtyperqst = &(msg->body.srvtyperqst);
+
+    keys = SLPFoldedKeysCreate(0,
+                               NULL,
+                               srvtyperqst->namingauthlen,
+                               srvtyperqst->namingauth,
+                               0,
+                               NULL,
+                               srvtyperqst->scopelistlen,
+                               srvtyperqst->scopelist);
+    if ( keys == NULL )
+    {
+        return SLP_ERROR_INTERNAL_ERROR;
+    }
 
     dh = SLPDatabaseOpen(&G_SlpdDatabase.database);
     if ( dh )
     {
-        /* srvtyperqst is the SrvTypeRqst being made */
-        srvtyperqst = &(msg->body.srvtyperqst);
-
         while ( 1 )
         {
             /*-----------------------------------------------------------------*/
@@ -526,6 +582,7 @@ int SLPDDatabaseSrvTypeRqstStart(SLPMessage msg,
             {
                 /* out of memory */
                 SLPDatabaseClose(dh);
+                SLPFoldedKeysFree(keys);
                 return SLP_ERROR_INTERNAL_ERROR;
             }
             (*result)->srvtypelist = (char*)((*result) + 1);
@@ -543,20 +600,15 @@ int SLPDDatabaseSrvTypeRqstStart(SLPMessage msg,
                 if ( entry == NULL )
                 {
                     /* This is the only successful way out */
+                    SLPFoldedKeysFree(keys);
                     return 0;
                 }
 
                 /* entry reg is the SrvReg message from the database */
                 entryreg = &(entry->msg->body.srvreg);
 
-                if ( SLPCompareNamingAuth(entryreg->srvtypelen,
-                                          entryreg->srvtype,
-                                          srvtyperqst->namingauthlen,
-                                          srvtyperqst->namingauth) == 0 && 
-                     SLPIntersectStringList(srvtyperqst->scopelistlen,
-                                            srvtyperqst->scopelist,
-                                            entryreg->scopelistlen,
-                                            entryreg->scopelist) &&
+                if ( SLPFoldedCompareNamingAuth(entryreg->keys, keys) == 0 && 
+                     SLPFoldedIntersectScopes(keys, entryreg->keys) &&
                      SLPContainsStringList((*result)->srvtypelistlen, 
                                            (*result)->srvtypelist,
                                            entryreg->srvtypelen,
@@ -588,6 +640,7 @@ int SLPDDatabaseSrvTypeRqstStart(SLPMessage msg,
         SLPDatabaseClose(dh);
     }
 
+    SLPFoldedKeysFree(keys);
     return 0;
 }
 
@@ -629,13 +682,32 @@ int SLPDDatabaseAttrRqstStart(SLPMessage msg,
     SLPDatabaseEntry*           entry;
     SLPSrvReg*                  entryreg;
     SLPAttrRqst*                attrrqst;
+    SLPFoldedKeys*              keys;
 #ifdef ENABLE_SLPv2_SECURITY
     int                         i;
 #endif
 
+    /* attrrqst is the AttrRqst being made */
+    attrrqst = &(msg->body.attrrqst);
+
+    /* the url of an AttrRqst may also be a service type */
+    keys = SLPFoldedKeysCreate(attrrqst->urllen,
+                               attrrqst->url,
+                               0,
+                               NULL,
+                               attrrqst->urllen,
+                               attrrqst->url,
+                               attrrqst->scopelistlen,
+                               attrrqst->scopelist);
+    if ( keys == NULL )
+    {
+        return SLP_ERROR_INTERNAL_ERROR;
+    }
+
     *result = xmalloc(sizeof(SLPDDatabaseAttrRqstResult));
     if ( *result == NULL )
     {
+        SLPFoldedKeysFree(keys);
         return SLP_ERROR_INTERNAL_ERROR;
     }
     memset(*result,0,sizeof(SLPDDatabaseAttrRqstResult));
@@ -645,14 +717,12 @@ int SLPDDatabaseAttrRqstStart(SLPMessage msg,
     {
         (*result)->reserved = dh;
 
-        /* attrrqst is the AttrRqst being made */
-        attrrqst = &(msg->body.attrrqst);
-
         while ( 1 )
         {
             entry = SLPDatabaseEnum(dh);
             if ( entry == NULL )
             {
+                SLPFoldedKeysFree(keys);
                 return 0;
             }
 
@@ -660,19 +730,11 @@ int SLPDDatabaseAttrRqstStart(SLPMessage msg,
             entryreg = &(entry->msg->body.srvreg);
 
 
-            if ( SLPCompareString(attrrqst->urllen,
-                                  attrrqst->url,
-                                  entryreg->urlentry.urllen,
-                                  entryreg->urlentry.url) == 0 ||
-                 SLPCompareSrvType(attrrqst->urllen,
-                                   attrrqst->url,
-                                   entryreg->srvtypelen,
-                                   entryreg->srvtype) == 0 )
+            if ( SLPFoldedCompareString(&keys->url,
+                                        &entryreg->keys->url) == 0 ||
+                 SLPFoldedCompareSrvType(keys, entryreg->keys) == 0 )
             {
-                if ( SLPIntersectStringList(attrrqst->scopelistlen,
-                                            attrrqst->scopelist,
-                                            entryreg->scopelistlen,
-                                            entryreg->scopelist) )
+                if ( SLPFoldedIntersectScopes(keys, entryreg->keys) )
                 {
                     if ( attrrqst->taglistlen == 0 )
                     {
@@ -722,6 +784,7 @@ int SLPDDatabaseAttrRqstStart(SLPMessage msg,
         }
     }
 
+    SLPFoldedKeysFree(keys);
     return 0;
 }
 
@@ -823,6 +886,23 @@ int SLPDDatabaseIsEmpty()
 }
 
 
+/*=========================================================================*/
+int SLPDDatabaseCount()
+/* Returns the number of registrations in the database                     */
+/*=========================================================================*/
+{
+    int result = 0;
+
+    SLPDatabaseHandle dh;
+    dh = SLPDatabaseOpen(&G_SlpdDatabase.database);
+    {
+        result = SLPDatabaseCount(dh);
+        SLPDatabaseClose(dh);
+    }
+    return result;
+}
+
+
 /*=========================================================================*/
 int SLPDDatabaseInit(const char* regfile)
 /* Initialize the database with registrations from a regfile.              */
@@ -863,6 +943,9 @@ int SLPDDatabaseReInit(const char* regfile)
     /* open the database handle and remove all the static registrations */
     /* (the registrations from the /etc/slp.reg) file.                  */
     /*------------------------------------------------------------------*/
+    /* the properties may have changed too */
+    G_SlpdDatabase.changes++;
+
     dh = SLPDatabaseOpen(&G_SlpdDatabase.database);
     if ( dh )
     {
@@ -874,6 +957,7 @@ int SLPDDatabaseReInit(const char* regfile)
             if ( entry->msg->body.srvreg.source == SLP_REG_SOURCE_STATIC )
             {
                 SLPDatabaseRemove(dh,entry);
+                G_SlpdDatabase.changes++;
             }
         }
         SLPDatabaseClose(dh);
@@ -69,9 +69,16 @@ typedef struct _SLPDDatabase
     SLPDatabase database;
     int         urlcount;
     int         srvtypelistlen;
+    unsigned    changes;    /* bumped whenever registrations come or go */
 }SLPDDatabase;
 
 
+/*=========================================================================*/
+extern SLPDDatabase G_SlpdDatabase;
+/* slpd database global                                                    */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 typedef struct _SLPDDatabaseSrvRqstResult
 /*=========================================================================*/
@@ -265,6 +272,12 @@ int SLPDDatabaseIsEmpty();
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+int SLPDDatabaseCount();
+/* Returns the number of registrations in the database                     */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 int SLPDDatabaseInit(const char* regfile);
 /* Initialize the database with registrations from a regfile.              */
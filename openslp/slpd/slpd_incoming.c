@@ -56,6 +56,7 @@
 #include "slpd_process.h"
 #include "slpd_property.h"
 #include "slpd_log.h"
+#include "slpd_stats.h"
 
 
 /*=========================================================================*/
@@ -121,144 +122,265 @@ void IncomingDatagramRead(SLPList* socklist, SLPDSocket* sock)
 
 
 /*-------------------------------------------------------------------------*/
-void IncomingStreamWrite(SLPList* socklist, SLPDSocket* sock)
+int IncomingStreamFrameLen(unsigned char* msg, int buffered)
+/* Returns the length of the message at the front of a stream's input,     */
+/* zero if not enough of it is buffered yet to tell, or -1 if it can not   */
+/* be framed at all                                                        */
 /*-------------------------------------------------------------------------*/
 {
-    int byteswritten, flags = 0;
-
-#if defined(MSG_DONTWAIT)
-    flags = MSG_DONTWAIT;
-#endif
+    int msglen;
 
-    if (sock->state == STREAM_WRITE_FIRST)
+    if (buffered < 1)
     {
-        /* make sure that the start and curpos pointers are the same */
-        sock->sendbuf->curpos = sock->sendbuf->start;
-        sock->state = STREAM_WRITE;
+        return 0;
     }
 
-    if (sock->sendbuf->end - sock->sendbuf->start != 0)
+    if (*msg == 2)
     {
-        byteswritten = send(sock->fd,
-                            sock->sendbuf->curpos,
-                            sock->sendbuf->end - sock->sendbuf->start,
-                            flags);
-        if (byteswritten > 0)
+        if (buffered < 5)
         {
-            /* reset lifetime to max because of activity */
-            sock->age = 0;
-            sock->sendbuf->curpos += byteswritten;
-            if (sock->sendbuf->curpos == sock->sendbuf->end)
-            {
-                /* message is completely sent */
-                sock->state = STREAM_READ_FIRST;
-            }
+            return 0;
         }
-        else
+        msglen = AsUINT24((char*)msg + 2);
+    }
+    else if (*msg == 1) /* SLPv1 packet */
+    {
+        if (buffered < 4)
         {
-#ifdef _WIN32
-            if (WSAEWOULDBLOCK == WSAGetLastError())
-#else
-            if (errno == EWOULDBLOCK)
-#endif
-            {
-                /* Error occured or connection was closed */
-                sock->state = SOCKET_CLOSE;
-            }
-        }    
+            return 0;
+        }
+        msglen = AsUINT16((char*)msg + 2);
+    }
+    else
+    {
+        return -1;
     }
+
+    /* a length that does not even cover itself would never advance */
+    if (msglen < 5)
+    {
+        return -1;
+    }
+
+    return msglen;
 }
 
 
 /*-------------------------------------------------------------------------*/
-void IncomingStreamRead(SLPList* socklist, SLPDSocket* sock)
+void IncomingStreamWrite(SLPList* socklist, SLPDSocket* sock);
+/*-------------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------------*/
+void IncomingStreamProcess(SLPList* socklist, SLPDSocket* sock)
+/* Processes, in order, every complete message buffered in sock->recvbuf   */
+/* and queues the replies on sock->sendlist.  sock->recvbuf is used as an  */
+/* input buffer: start is the oldest unprocessed byte, curpos the end of   */
+/* the bytes read so far and end the end of the allocated space            */
 /*-------------------------------------------------------------------------*/
 {
-    int     bytesread, recvlen = 0;
-    char    peek[16];
-    int     peeraddrlen = sizeof(struct sockaddr_in);
+    struct _SLPBuffer   frame;
+    SLPBuffer           grown;
+    unsigned char*      msg;
+    int                 buffered;
+    int                 msglen;
+
+    msg = sock->recvbuf->start;
+    buffered = sock->recvbuf->curpos - msg;
+    memset(&frame,0,sizeof(frame));
 
-    if (sock->state == STREAM_READ_FIRST)
+    while (1)
     {
-        /*---------------------------------------------------*/
-        /* take a peek at the packet to get size information */
-        /*---------------------------------------------------*/
-        bytesread = recvfrom(sock->fd,
-                             peek,
-                             16,
-                             MSG_PEEK,
-                             (struct sockaddr *)&(sock->peeraddr),
-                             &peeraddrlen);
-        if (bytesread > 0 && bytesread >= (*peek == 2 ? 5 : 4))
+        msglen = IncomingStreamFrameLen(msg, buffered);
+        if (msglen < 0)
         {
+            sock->state = SOCKET_CLOSE;
+            return;
+        }
+        if (msglen == 0 ||
+            msglen > buffered ||
+            sock->sendlist.count >= SLPD_MAX_PIPELINE)
+        {
+            break;
+        }
 
-            if (*peek == 2)
-                recvlen = AsUINT24(peek + 2);
-            else if (*peek == 1) /* SLPv1 packet */
-                recvlen = AsUINT16(peek + 2);
-            /* one byte is minimum */
-            if (recvlen <= 0)
-                recvlen = 1;
-            /* allocate the recvbuf big enough for the whole message */
-            sock->recvbuf = SLPBufferRealloc(sock->recvbuf,recvlen);
-            if (sock->recvbuf)
-            {
-                sock->state = STREAM_READ; 
-            }
-            else
+        /* process the message in place */
+        frame.start = msg;
+        frame.curpos = msg;
+        frame.end = msg + msglen;
+        frame.allocated = msglen;
+        switch (SLPDProcessMessage(&sock->peeraddr,
+                                   &frame,
+                                   &(sock->sendbuf)))
+        {
+        case SLP_ERROR_PARSE_ERROR:
+        case SLP_ERROR_VER_NOT_SUPPORTED:
+        case SLP_ERROR_MESSAGE_NOT_SUPPORTED:
+            sock->state = SOCKET_CLOSE;
+            return;
+        default:
+            if (sock->sendbuf &&
+                sock->sendbuf->end != sock->sendbuf->start)
             {
-                SLPDLog("INTERNAL_ERROR - out of memory!\n");
-                sock->state = SOCKET_CLOSE;
+                /* queue the reply behind the ones still waiting */
+                sock->sendbuf->curpos = sock->sendbuf->start;
+                SLPListLinkTail(&(sock->sendlist),
+                                (SLPListItem*)sock->sendbuf);
+                sock->sendbuf = 0;
             }
         }
-        else
+
+        msg += msglen;
+        buffered -= msglen;
+    }
+
+    /* move what is left of a partial message to the front */
+    if (msg != sock->recvbuf->start)
+    {
+        memmove(sock->recvbuf->start, msg, buffered);
+        sock->recvbuf->curpos = sock->recvbuf->start + buffered;
+    }
+
+    /* make room for all of a message bigger than the space read into */
+    if (msglen > sock->recvbuf->end - sock->recvbuf->start)
+    {
+        grown = SLPBufferAlloc(msglen);
+        if (grown == 0)
         {
+            SLPDLog("INTERNAL_ERROR - out of memory!\n");
             sock->state = SOCKET_CLOSE;
             return;
-        }        
+        }
+        memcpy(grown->start, sock->recvbuf->start, buffered);
+        grown->curpos = grown->start + buffered;
+        SLPBufferFree(sock->recvbuf);
+        sock->recvbuf = grown;
     }
 
-    if (sock->state == STREAM_READ)
+    if (sock->sendlist.count)
     {
-        /*------------------------------*/
-        /* recv the rest of the message */
-        /*------------------------------*/
-        bytesread = recv(sock->fd,
-                         sock->recvbuf->curpos,
-                         sock->recvbuf->end - sock->recvbuf->curpos,
-                         0);              
-
-        if (bytesread > 0)
+        sock->state = STREAM_WRITE;
+        IncomingStreamWrite(socklist, sock);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+void IncomingStreamWrite(SLPList* socklist, SLPDSocket* sock)
+/* Writes as much of the queued replies as the socket will take.  Once     */
+/* they are all sent, messages that were held back are processed           */
+/*-------------------------------------------------------------------------*/
+{
+    SLPBuffer       buf;
+    int             byteswritten;
+#ifdef _WIN32
+    int             flags = 0;
+#else
+    struct iovec    iov[SLPD_MAX_PIPELINE];
+    int             iovcnt;
+#endif
+
+#ifdef _WIN32
+    /* no writev(), send one reply at a time */
+    buf = (SLPBuffer)sock->sendlist.head;
+    byteswritten = send(sock->fd,
+                        buf->curpos,
+                        buf->end - buf->curpos,
+                        flags);
+#else
+    iovcnt = 0;
+    buf = (SLPBuffer)sock->sendlist.head;
+    while (buf && iovcnt < SLPD_MAX_PIPELINE)
+    {
+        iov[iovcnt].iov_base = buf->curpos;
+        iov[iovcnt].iov_len = buf->end - buf->curpos;
+        iovcnt += 1;
+        buf = (SLPBuffer)buf->listitem.next;
+    }
+    byteswritten = writev(sock->fd, iov, iovcnt);
+#endif
+
+    if (byteswritten > 0)
+    {
+        /* reset lifetime to max because of activity */
+        sock->age = 0;
+
+        /* release the replies that went out completely */
+        while (byteswritten > 0)
         {
-            /* reset age to max because of activity */
-            sock->age = 0;
-            sock->recvbuf->curpos += bytesread;
-            if (sock->recvbuf->curpos == sock->recvbuf->end)
+            buf = (SLPBuffer)sock->sendlist.head;
+            if (byteswritten < buf->end - buf->curpos)
             {
-                switch (SLPDProcessMessage(&sock->peeraddr,
-                                           sock->recvbuf,
-                                           &(sock->sendbuf)))
-                {
-                case SLP_ERROR_PARSE_ERROR:
-                case SLP_ERROR_VER_NOT_SUPPORTED:
-                case SLP_ERROR_MESSAGE_NOT_SUPPORTED:
-                    sock->state = SOCKET_CLOSE;
-                    break;                    
-                default:
-                    sock->state = STREAM_WRITE_FIRST;
-                    IncomingStreamWrite(socklist, sock);
-                }
+                buf->curpos += byteswritten;
+                break;
             }
+            byteswritten -= buf->end - buf->curpos;
+            SLPBufferFree((SLPBuffer)SLPListUnlink(&(sock->sendlist),
+                                                   (SLPListItem*)buf));
         }
-        else
+
+        if (sock->sendlist.count == 0)
         {
-            /* error in recv() or eof */
+            if (sock->state == STREAM_WRITE_CLOSE)
+            {
+                /* the whole stats report is out */
+                sock->state = SOCKET_CLOSE;
+                return;
+            }
+
+            /* all replies are sent */
+            sock->state = STREAM_READ;
+            if (sock->recvbuf->curpos != sock->recvbuf->start)
+            {
+                /* select() will not report messages already read */
+                IncomingStreamProcess(socklist, sock);
+            }
+        }
+    }
+    else
+    {
+#ifdef _WIN32
+        if (WSAEWOULDBLOCK != WSAGetLastError())
+#else
+        if (errno != EWOULDBLOCK && errno != EAGAIN)
+#endif
+        {
+            /* Error occured or connection was closed */
             sock->state = SOCKET_CLOSE;
         }
     }
 }
 
 
+/*-------------------------------------------------------------------------*/
+void IncomingStreamRead(SLPList* socklist, SLPDSocket* sock)
+/*-------------------------------------------------------------------------*/
+{
+    int     bytesread;
+
+    /*---------------------------------------------------------------*/
+    /* read whatever has arrived, it may hold several messages or a  */
+    /* part of one                                                   */
+    /*---------------------------------------------------------------*/
+    bytesread = recv(sock->fd,
+                     sock->recvbuf->curpos,
+                     sock->recvbuf->end - sock->recvbuf->curpos,
+                     0);
+    if (bytesread > 0)
+    {
+        /* reset age to max because of activity */
+        sock->age = 0;
+        sock->recvbuf->curpos += bytesread;
+        IncomingStreamProcess(socklist, sock);
+    }
+    else
+    {
+        /* error in recv() or eof */
+        sock->state = SOCKET_CLOSE;
+    }
+}
+
+
 /*-------------------------------------------------------------------------*/
 void IncomingSocketListen(SLPList* socklist, SLPDSocket* sock)
 /*-------------------------------------------------------------------------*/
@@ -266,6 +388,7 @@ void IncomingSocketListen(SLPList* socklist, SLPDSocket* sock)
     int                 fdflags;
     sockfd_t            fd;
     SLPDSocket*         connsock;
+    SLPBuffer           report;
     struct sockaddr_in  peeraddr;
     socklen_t           peeraddrlen;
 #ifdef _WIN32
@@ -285,13 +408,29 @@ void IncomingSocketListen(SLPList* socklist, SLPDSocket* sock)
                     &peeraddrlen);
         if (fd >= 0)
         {
+            if (sock->ifaddr.sin_family == AF_UNIX)
+            {
+                /* unix domain peers can only be local.  Give them the */
+                /* loopback address so ISLOCAL() treats them that way  */
+                memset(&peeraddr,0,sizeof(peeraddr));
+                peeraddr.sin_family = AF_INET;
+                peeraddr.sin_addr.s_addr = htonl(LOOPBACK_ADDRESS);
+            }
+
             connsock = SLPDSocketAlloc();
             if (connsock)
             {
                 /* setup the accepted socket */
                 connsock->fd        = fd;
                 connsock->peeraddr  = peeraddr;
-                connsock->state     = STREAM_READ_FIRST;
+                connsock->state     = STREAM_READ;
+                connsock->recvbuf   = SLPBufferAlloc(SLP_MAX_DATAGRAM_SIZE);
+                if (connsock->recvbuf == 0)
+                {
+                    /* frees fd as well */
+                    SLPDSocketFree(connsock);
+                    return;
+                }
 
                 /* Set the low water mark on the accepted socket */
                 setsockopt(connsock->fd,SOL_SOCKET,SO_RCVLOWAT,&lowat,sizeof(lowat));
@@ -304,6 +443,20 @@ void IncomingSocketListen(SLPList* socklist, SLPDSocket* sock)
                 fdflags = fcntl(connsock->fd, F_GETFL, 0);
                 fcntl(connsock->fd,F_SETFL, fdflags | O_NONBLOCK);
 #endif        
+
+                if (sock->state == STATS_LISTEN)
+                {
+                    /* nothing is read from a stats connection, it gets */
+                    /* the report and is closed                         */
+                    report = SLPDStatsReport();
+                    if (report == 0)
+                    {
+                        SLPDSocketFree(connsock);
+                        return;
+                    }
+                    SLPListLinkTail(&(connsock->sendlist),(SLPListItem*)report);
+                    connsock->state = STREAM_WRITE_CLOSE;
+                }
                 SLPListLinkHead(socklist,(SLPListItem*)connsock);
             }
         }
@@ -334,6 +487,7 @@ void SLPDIncomingHandler(int* fdcount,
             switch (sock->state)
             {
             case SOCKET_LISTEN:
+            case STATS_LISTEN:
                 IncomingSocketListen(&G_IncomingSocketList,sock);
                 break;
 
@@ -360,6 +514,7 @@ void SLPDIncomingHandler(int* fdcount,
             {
             case STREAM_WRITE:
             case STREAM_WRITE_FIRST:
+            case STREAM_WRITE_CLOSE:
                 IncomingStreamWrite(&G_IncomingSocketList,sock);
                 break;
 
@@ -389,6 +544,7 @@ void SLPDIncomingAge(time_t seconds)
         case STREAM_READ:
         case STREAM_WRITE_FIRST:
         case STREAM_WRITE:
+        case STREAM_WRITE_CLOSE:
             if (G_IncomingSocketList.count > SLPD_COMFORT_SOCKETS)
             {
                 /* Accellerate ageing cause we are low on sockets */
@@ -472,6 +628,38 @@ int SLPDIncomingInit()
         SLPDLog("INTERNAL_ERROR - No SLPLIB support will be available\n");
     }
 
+#ifndef _WIN32
+    /*--------------------------------------------------------------------*/
+    /* Create SOCKET_LISTEN socket on the unix domain socket that libslp  */
+    /* prefers to the loopback                                            */
+    /*--------------------------------------------------------------------*/
+    sock = SLPDSocketCreateLocalListen(SLP_LOCAL_SOCKET);
+    if (sock)
+    {
+        SLPListLinkTail(&G_IncomingSocketList,(SLPListItem*)sock);
+        SLPDLog("Listening on %s ...\n",SLP_LOCAL_SOCKET);
+    }
+    else
+    {
+        SLPDLog("Could not listen on %s (%s)\n",SLP_LOCAL_SOCKET,strerror(errno));
+    }
+
+    /*--------------------------------------------------------------------*/
+    /* Create STATS_LISTEN socket that hands out slpd's counters          */
+    /*--------------------------------------------------------------------*/
+    sock = SLPDSocketCreateLocalListen(SLP_STATS_SOCKET);
+    if (sock)
+    {
+        sock->state = STATS_LISTEN;
+        SLPListLinkTail(&G_IncomingSocketList,(SLPListItem*)sock);
+        SLPDLog("Listening on %s ...\n",SLP_STATS_SOCKET);
+    }
+    else
+    {
+        SLPDLog("Could not listen on %s (%s)\n",SLP_STATS_SOCKET,strerror(errno));
+    }
+#endif
+
     /*---------------------------------------------------------------------*/
     /* Create sockets for all of the interfaces in the interfaces property */
     /*---------------------------------------------------------------------*/
@@ -612,6 +800,11 @@ int SLPDIncomingDeinit()
         }
     } 
 
+#ifndef _WIN32
+    unlink(SLP_LOCAL_SOCKET);
+    unlink(SLP_STATS_SOCKET);
+#endif
+
     return 0;
 }
 
@@ -89,6 +89,314 @@ SLPDatabase G_SlpdKnownDAs;
 int G_KnownDATimeSinceLastRefresh = 0;
 /*=========================================================================*/
 
+#define KNOWNDA_BUCKETS 256 /* buckets of each index, a power of 2 */
+
+typedef struct _SLPDKnownDAIndex SLPDKnownDAIndex;
+
+/*=========================================================================*/
+typedef struct _SLPDKnownDAScope
+/* Files a known DA under one of its scopes                                */
+/*=========================================================================*/
+{
+    struct _SLPDKnownDAScope*   next;       /* in the same scope bucket   */
+    SLPDKnownDAIndex*           da;
+    SLPFoldedString*            scope;      /* in da->keys                */
+}SLPDKnownDAScope;
+
+
+/*=========================================================================*/
+struct _SLPDKnownDAIndex
+/* Files an entry of G_SlpdKnownDAs by URL, address and scope, so that     */
+/* DAAdverts, dead DA connections and registrations to forward find the    */
+/* DAs they are about without walking the whole list.  The scope links     */
+/* follow the node in the same allocation                                  */
+/*=========================================================================*/
+{
+    SLPDatabaseEntry*           entry;
+    SLPFoldedKeys*              keys;       /* folded URL and scopes      */
+    SLPDKnownDAIndex*           urlnext;    /* in the same URL bucket     */
+    SLPDKnownDAIndex*           addrnext;   /* in the same address bucket */
+    unsigned int                echoed;     /* last echo sent to the DA   */
+    SLPDKnownDAScope*           scopes;     /* keys->scopecount of them   */
+};
+
+static SLPDKnownDAIndex*    G_KnownDAByUrl[KNOWNDA_BUCKETS];
+static SLPDKnownDAIndex*    G_KnownDAByAddr[KNOWNDA_BUCKETS];
+static SLPDKnownDAScope*    G_KnownDAByScope[KNOWNDA_BUCKETS];
+static unsigned int         G_KnownDAEchoes = 0;
+
+#define KNOWNDA_ADVERTS 8 /* DAAdverts of our own kept for reuse */
+
+/*=========================================================================*/
+typedef struct _SLPDKnownDAAdvert
+/* A DAAdvert of our own as it was last built.  Signing a DAAdvert is a    */
+/* DSA operation, so later requests for the same advert get a copy with    */
+/* their XID patched in.  The advert depends on our URL, scopes, locale,   */
+/* SPI and boot timestamp besides the key below, all of which only change  */
+/* when the known DA list is initialized again                             */
+/*=========================================================================*/
+{
+    int                         version;    /* 2, 1 or 0 for an empty slot */
+    int                         errorcode;  /* the errorcode asked for     */
+    int                         variant;    /* deadda or the v1 encoding   */
+    int                         result;     /* what building it returned   */
+    SLPBuffer                   buf;
+}SLPDKnownDAAdvert;
+
+static SLPDKnownDAAdvert    G_KnownDAAdverts[KNOWNDA_ADVERTS];
+static int                  G_KnownDAAdvertNext = 0;
+
+
+/*-------------------------------------------------------------------------*/
+static unsigned int KnownDAAddrBucket(struct in_addr* addr)
+/*-------------------------------------------------------------------------*/
+{
+    return (((unsigned int)addr->s_addr * 2654435761U) >> 16) &
+           (KNOWNDA_BUCKETS - 1);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPDKnownDAIndex* KnownDAFindUrl(SLPFoldedString* url)
+/*-------------------------------------------------------------------------*/
+{
+    SLPDKnownDAIndex*   da;
+
+    da = G_KnownDAByUrl[url->hash & (KNOWNDA_BUCKETS - 1)];
+    while ( da && SLPFoldedCompareString(&(da->keys->url),url) )
+    {
+        da = da->urlnext;
+    }
+
+    return da;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPDKnownDAIndex* KnownDAFindAddr(struct in_addr* addr)
+/*-------------------------------------------------------------------------*/
+{
+    SLPDKnownDAIndex*   da;
+
+    da = G_KnownDAByAddr[KnownDAAddrBucket(addr)];
+    while ( da &&
+            memcmp(addr,&(da->entry->msg->peer.sin_addr),sizeof(*addr)) )
+    {
+        da = da->addrnext;
+    }
+
+    return da;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPDKnownDAIndex* KnownDAIndexAdd(SLPDatabaseEntry* entry,
+                                         SLPFoldedKeys* keys)
+/* Files an entry just added to G_SlpdKnownDAs.  The index takes keys,     */
+/* which must hold the folded URL and scopes of the entry's DAAdvert       */
+/*                                                                         */
+/* Returns: the index node or NULL if out of memory, keys are freed then   */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDKnownDAIndex*   da;
+    unsigned int        bucket;
+    int                 i;
+
+    da = (SLPDKnownDAIndex*)xmalloc(sizeof(SLPDKnownDAIndex) +
+                                    keys->scopecount *
+                                    sizeof(SLPDKnownDAScope));
+    if ( da == NULL )
+    {
+        SLPFoldedKeysFree(keys);
+        return NULL;
+    }
+    da->entry = entry;
+    da->keys = keys;
+    da->echoed = G_KnownDAEchoes;
+    da->scopes = (SLPDKnownDAScope*)(da + 1);
+
+    bucket = keys->url.hash & (KNOWNDA_BUCKETS - 1);
+    da->urlnext = G_KnownDAByUrl[bucket];
+    G_KnownDAByUrl[bucket] = da;
+
+    bucket = KnownDAAddrBucket(&(entry->msg->peer.sin_addr));
+    da->addrnext = G_KnownDAByAddr[bucket];
+    G_KnownDAByAddr[bucket] = da;
+
+    for ( i = 0; i < keys->scopecount; i++ )
+    {
+        bucket = keys->scopes[i].hash & (KNOWNDA_BUCKETS - 1);
+        da->scopes[i].da = da;
+        da->scopes[i].scope = &(keys->scopes[i]);
+        da->scopes[i].next = G_KnownDAByScope[bucket];
+        G_KnownDAByScope[bucket] = &(da->scopes[i]);
+    }
+
+    return da;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDAIndexRemove(SLPDKnownDAIndex* da)
+/* Unfiles an entry about to be removed from G_SlpdKnownDAs and frees the  */
+/* node                                                                    */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDKnownDAIndex**  prev;
+    SLPDKnownDAScope**  prevscope;
+    unsigned int        bucket;
+    int                 i;
+
+    prev = &(G_KnownDAByUrl[da->keys->url.hash & (KNOWNDA_BUCKETS - 1)]);
+    while ( *prev != da )
+    {
+        prev = &((*prev)->urlnext);
+    }
+    *prev = da->urlnext;
+
+    bucket = KnownDAAddrBucket(&(da->entry->msg->peer.sin_addr));
+    prev = &(G_KnownDAByAddr[bucket]);
+    while ( *prev != da )
+    {
+        prev = &((*prev)->addrnext);
+    }
+    *prev = da->addrnext;
+
+    for ( i = 0; i < da->keys->scopecount; i++ )
+    {
+        prevscope = &(G_KnownDAByScope[da->keys->scopes[i].hash &
+                                       (KNOWNDA_BUCKETS - 1)]);
+        while ( *prevscope != &(da->scopes[i]) )
+        {
+            prevscope = &((*prevscope)->next);
+        }
+        *prevscope = da->scopes[i].next;
+    }
+
+    SLPFoldedKeysFree(da->keys);
+    xfree(da);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDAIndexClear()
+/* Frees the whole index, G_SlpdKnownDAs is emptied separately             */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDKnownDAIndex*   da;
+    int                 i;
+
+    for ( i = 0; i < KNOWNDA_BUCKETS; i++ )
+    {
+        while ( G_KnownDAByUrl[i] )
+        {
+            da = G_KnownDAByUrl[i];
+            G_KnownDAByUrl[i] = da->urlnext;
+            SLPFoldedKeysFree(da->keys);
+            xfree(da);
+        }
+        G_KnownDAByAddr[i] = NULL;
+        G_KnownDAByScope[i] = NULL;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static SLPDKnownDAAdvert* KnownDAAdvertFind(int version,
+                                            int errorcode,
+                                            int variant)
+/*-------------------------------------------------------------------------*/
+{
+    int i;
+
+    for ( i = 0; i < KNOWNDA_ADVERTS; i++ )
+    {
+        if ( G_KnownDAAdverts[i].version == version &&
+             G_KnownDAAdverts[i].errorcode == errorcode &&
+             G_KnownDAAdverts[i].variant == variant )
+        {
+            return &(G_KnownDAAdverts[i]);
+        }
+    }
+
+    return NULL;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int KnownDAAdvertCopy(SLPDKnownDAAdvert* advert,
+                             unsigned int xid,
+                             SLPBuffer* sendbuf)
+/* Packs sendbuf with a copy of a kept DAAdvert carrying xid               */
+/*                                                                         */
+/* returns: what building the advert returned or SLP_ERROR_INTERNAL_ERROR  */
+/*-------------------------------------------------------------------------*/
+{
+    size_t      size;
+    SLPBuffer   result;
+
+    size = advert->buf->end - advert->buf->start;
+    result = SLPBufferRealloc(*sendbuf, size);
+    *sendbuf = result;
+    if ( result == NULL )
+    {
+        return SLP_ERROR_INTERNAL_ERROR;
+    }
+
+    memcpy(result->start,advert->buf->start,size);
+    /* v1 and v2 headers both carry the xid at offset 10 */
+    ToUINT16(result->start + 10,xid);
+    result->curpos = result->start + size;
+
+    return advert->result;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDAAdvertKeep(int version,
+                              int errorcode,
+                              int variant,
+                              int result,
+                              SLPBuffer buf)
+/* Keeps a copy of a DAAdvert just built, replacing the oldest one kept    */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDKnownDAAdvert*  advert;
+
+    advert = &(G_KnownDAAdverts[G_KnownDAAdvertNext]);
+    G_KnownDAAdvertNext = (G_KnownDAAdvertNext + 1) % KNOWNDA_ADVERTS;
+
+    if ( advert->buf )
+    {
+        SLPBufferFree(advert->buf);
+    }
+    advert->buf = SLPBufferDup(buf);
+    advert->version = advert->buf ? version : 0;
+    advert->errorcode = errorcode;
+    advert->variant = variant;
+    advert->result = result;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void KnownDAAdvertClear()
+/* Forgets the kept DAAdverts                                              */
+/*-------------------------------------------------------------------------*/
+{
+    int i;
+
+    for ( i = 0; i < KNOWNDA_ADVERTS; i++ )
+    {
+        if ( G_KnownDAAdverts[i].buf )
+        {
+            SLPBufferFree(G_KnownDAAdverts[i].buf);
+        }
+        memset(&(G_KnownDAAdverts[i]),0,sizeof(SLPDKnownDAAdvert));
+    }
+    G_KnownDAAdvertNext = 0;
+}
+
+
 /*-------------------------------------------------------------------------*/
 int MakeActiveDiscoveryRqst(int ismcast, SLPBuffer* buffer)
 /* Pack a buffer with service:directory-agent SrvRqst                      *
@@ -283,7 +591,7 @@ void SLPDKnownDARegisterAll(SLPMessage daadvert, int immortalonly)
                                         srvreg->scopelistlen,
                                         srvreg->scopelist) )
             {
-                sendbuf = SLPBufferDup(buf);
+                sendbuf = SLPBufferRef(buf);
                 if ( sendbuf )
                 {
                     /*--------------------------------------------------*/
@@ -599,6 +907,10 @@ int SLPDKnownDAInit()
     /* Set initialize the DAAdvert database */
     /*--------------------------------------*/
     SLPDatabaseInit(&G_SlpdKnownDAs);
+    KnownDAIndexClear();
+
+    /* our URL, scopes, SPI or boot timestamp may have changed */
+    KnownDAAdvertClear();
 
     /*-----------------------------------------------------------------*/
     /* Added statically configured DAs to the Known DA List by sending */
@@ -647,6 +959,8 @@ int SLPDKnownDADeinit()
     }
 
     SLPDatabaseDeinit(&G_SlpdKnownDAs);
+    KnownDAIndexClear();
+    KnownDAAdvertClear();
 
     return 0;
 } 
@@ -664,11 +978,14 @@ int SLPDKnownDAAdd(SLPMessage msg, SLPBuffer buf)
 /* returns  Zero on success, Non-zero on error                             */
 /*=========================================================================*/
 {
-    SLPDatabaseEntry*   entry;
+    SLPDatabaseEntry*   entry           = NULL;
+    SLPDKnownDAIndex*   da;
     SLPDAAdvert*        entrydaadvert;
     SLPDAAdvert*        daadvert;
     struct in_addr      daaddr;
     SLPParsedSrvUrl*    parsedurl       = NULL;
+    SLPFoldedKeys*      keys            = NULL;
+    int                 isnew;
     int                 result          = 0;
     SLPDatabaseHandle   dh              = NULL;
 
@@ -710,126 +1027,115 @@ int SLPDKnownDAAdd(SLPMessage msg, SLPBuffer buf)
      */
     msg->peer.sin_addr = daaddr;
 
+    /* the folded URL and scopes the entry will be filed under */
+    keys = SLPFoldedKeysCreate(0,NULL,0,NULL,
+                               daadvert->urllen,
+                               daadvert->url,
+                               daadvert->scopelistlen,
+                               daadvert->scopelist);
+    if ( keys == NULL )
+    {
+        result = SLP_ERROR_INTERNAL_ERROR;
+        goto CLEANUP;
+    }
 
     /*-----------------------------------------------------*/
     /* Check to see if there is already an identical entry */
     /*-----------------------------------------------------*/
-    while ( 1 )
+    /* Assume DAs are identical if their URLs match */
+    da = KnownDAFindUrl(&(keys->url));
+    isnew = (da == NULL);
+    if ( da )
     {
-        entry = SLPDatabaseEnum(dh);
-        if ( entry == NULL ) break;
+        entry = da->entry;
 
         /* entrydaadvert is the DAAdvert message from the database */
         entrydaadvert = &(entry->msg->body.daadvert);
 
-        /* Assume DAs are identical if their URLs match */
-        if ( SLPCompareString(entrydaadvert->urllen,
-                              entrydaadvert->url,
-                              daadvert->urllen,
-                              daadvert->url) == 0 )
-        {
-
 #ifdef ENABLE_SLPv2_SECURITY                
-            if ( G_SlpdProperty.checkSourceAddr &&
-                 memcmp(&(entry->msg->peer.sin_addr),
-                        &(msg->peer.sin_addr),
-                        sizeof(struct in_addr)) )
-            {
-                SLPDatabaseClose(dh);
-                result = SLP_ERROR_AUTHENTICATION_FAILED;
-                goto CLEANUP;
-            }
+        if ( G_SlpdProperty.checkSourceAddr &&
+             memcmp(&(entry->msg->peer.sin_addr),
+                    &(msg->peer.sin_addr),
+                    sizeof(struct in_addr)) )
+        {
+            result = SLP_ERROR_AUTHENTICATION_FAILED;
+            goto CLEANUP;
+        }
 
-            /* make sure an unauthenticated DAAdvert can't replace */
-            /* an authenticated one                                */
-            if ( entrydaadvert->authcount &&
-                 entrydaadvert->authcount != daadvert->authcount )
-            {
-                SLPDatabaseClose(dh);
-                result = SLP_ERROR_AUTHENTICATION_FAILED;
-                goto CLEANUP;
-            } 
-            
+        /* make sure an unauthenticated DAAdvert can't replace */
+        /* an authenticated one                                */
+        if ( entrydaadvert->authcount &&
+             entrydaadvert->authcount != daadvert->authcount )
+        {
+            result = SLP_ERROR_AUTHENTICATION_FAILED;
+            goto CLEANUP;
+        } 
+        
 #endif
-            
-            if ( daadvert->bootstamp != 0 &&
-                 daadvert->bootstamp <= entrydaadvert->bootstamp )
-            {
-                /* Advertising DA must have went down then came back up */
-                SLPDKnownDARegisterAll(msg,0);
-            }
+        
+        if ( daadvert->bootstamp != 0 &&
+             (daadvert->bootstamp < entrydaadvert->bootstamp ||
+              (G_SlpdProperty.DARestartOnStampChange &&
+               daadvert->bootstamp != entrydaadvert->bootstamp)) )
+        {
+            /* Advertising DA must have went down then came back up */
+            SLPDKnownDARegisterAll(msg,0);
+        }
 
-            /* Remove the entry that is the same as the advertised entry */
-            /* so that we can put the new advertised entry back in       */
-            SLPDatabaseRemove(dh,entry);
-            break;
+        if ( daadvert->bootstamp == 0 )
+        {
+            /* Dying DA was found in our KnownDA database. Log that it
+             * was removed.
+             */
+            SLPDLogDAAdvertisement("Removed",entry);
         }
+
+        /* Remove the entry that is the same as the advertised entry */
+        /* so that we can put the new advertised entry back in       */
+        KnownDAIndexRemove(da);
+        SLPDatabaseRemove(dh,entry);
     }
 
     /* Make sure the DA is not dying */
     if (daadvert->bootstamp != 0)
     {
-        if ( entry == 0 )
+        /* create a new database entry using the DAAdvert message */
+        entry = SLPDatabaseEntryCreate(msg,buf);
+        if ( entry == NULL )
         {
-            /* create a new database entry using the DAAdvert message */
-            entry = SLPDatabaseEntryCreate(msg,buf);
-            if (entry)
-            {
-                SLPDatabaseAdd(dh, entry);
-
-                /* register all the services we know about with this new DA */
-                SLPDKnownDARegisterAll(msg,0);
-
-                /* log the addition of a new DA */
-                SLPDLogDAAdvertisement("Addition",entry);
-            }
-            else
-            {
-                /* Could not create a new entry */
-                result = SLP_ERROR_INTERNAL_ERROR;
-                goto CLEANUP;
-            }
+            /* Could not create a new entry */
+            result = SLP_ERROR_INTERNAL_ERROR;
+            goto CLEANUP;
         }
-        else
+        if ( KnownDAIndexAdd(entry,keys) == NULL )
         {
-            /* The advertising DA is not new to us, but the old entry   */
-            /* has been deleted from our database so that the new entry */
-            /* with its up to date time stamp can be put back in.       */
-            /* create a new database entry using the DAAdvert message */
-            entry = SLPDatabaseEntryCreate(msg,buf);
-            if (entry)
-            {
-                SLPDatabaseAdd(dh, entry);
-            }
-            else
-            {
-                /* Could not create a new entry */
-                result = SLP_ERROR_INTERNAL_ERROR;
-                goto CLEANUP;
-            }
+            /* the keys went with the index node, msg and buf with entry */
+            SLPDatabaseEntryDestroy(entry);
+            SLPDatabaseClose(dh);
+            return SLP_ERROR_INTERNAL_ERROR;
+        }
+        SLPDatabaseAdd(dh, entry);
+
+        if ( isnew )
+        {
+            /* register all the services we know about with this new DA */
+            SLPDKnownDARegisterAll(msg,0);
+
+            /* log the addition of a new DA */
+            SLPDLogDAAdvertisement("Addition",entry);
         }
 
         SLPDatabaseClose(dh);
 
         return result;
     }
-    else
-    {
-        /* DA is dying */
-        if (entry)
-        {
-            /* Dying DA was found in our KnownDA database. Log that it
-             * was removed.
-             */
-            SLPDLogDAAdvertisement("Removed",entry);
-        }
-    }
 
     CLEANUP:
     /* If we are here, we need to cleanup the message descriptor and the  */
     /* message buffer because they were not added to the database and not */
     /* cleaning them up would result in a memory leak                     */
     /* We also need to make sure the Database handle is closed.           */
+    SLPFoldedKeysFree(keys);
     SLPMessageFree(msg);
     SLPBufferFree(buf);
     if (dh) SLPDatabaseClose(dh);
@@ -844,27 +1150,23 @@ void SLPDKnownDARemove(struct in_addr* addr)
 {
     SLPDatabaseHandle   dh;
     SLPDatabaseEntry*   entry;
+    SLPDKnownDAIndex*   da;
+
+    /* SLPDOutgoingAge() calls this for every stale socket, most of */
+    /* which are not DAs, so look in the address index first        */
+    da = KnownDAFindAddr(addr);
+    if ( da == NULL )
+    {
+        return;
+    }
 
     dh = SLPDatabaseOpen(&G_SlpdKnownDAs);
     if ( dh )
     {
-        /*-----------------------------------------------------*/
-        /* Check to see if there is already an identical entry */
-        /*-----------------------------------------------------*/
-        while ( 1 )
-        {
-            entry = SLPDatabaseEnum(dh);
-            if ( entry == NULL ) break;
-
-            /* Assume DAs are identical if their peer match */
-            if ( memcmp(addr,&(entry->msg->peer.sin_addr),sizeof(*addr)) == 0 )
-            {
-                SLPDatabaseRemove(dh,entry);
-                SLPDLogDAAdvertisement("Removal",entry);
-                break;            
-            }
-        }
-
+        entry = da->entry;
+        SLPDLogDAAdvertisement("Removal",entry);
+        KnownDAIndexRemove(da);
+        SLPDatabaseRemove(dh,entry);
         SLPDatabaseClose(dh);
     }
 }
@@ -949,19 +1251,30 @@ int SLPDKnownDAGenerateMyDAAdvert(int errorcode,
 /*               DAAdvert                                                  */
 /*                                                                         */
 /* returns: zero on success, non-zero on error                             */
+/*                                                                         */
+/* The advert is built and signed once.  Later calls for the same advert   */
+/* get a copy with their xid until SLPDKnownDAInit() is called again       */
 /*=========================================================================*/
 {
     int       size;
+    int       asked = errorcode;
     SLPBuffer result = *sendbuf;
+    SLPDKnownDAAdvert* advert;
 
 #ifdef ENABLE_SLPv2_SECURITY
     int                 daadvertauthlen  = 0;
     unsigned char*      daadvertauth     = 0;
     int                 spistrlen   = 0;
     char*               spistr      = 0;  
+#endif
 
-    G_SlpdProperty.DATimestamp += 1;
+    advert = KnownDAAdvertFind(2,errorcode,deadda);
+    if ( advert )
+    {
+        return KnownDAAdvertCopy(advert,xid,sendbuf);
+    }
 
+#ifdef ENABLE_SLPv2_SECURITY
     if ( G_SlpdProperty.securityEnabled )
     {
         SLPSpiGetDefaultSPI(G_SlpdSpiHandle,
@@ -972,7 +1285,7 @@ int SLPDKnownDAGenerateMyDAAdvert(int errorcode,
         SLPAuthSignDAAdvert(G_SlpdSpiHandle,
                             spistrlen,
                             spistr,
-                            G_SlpdProperty.DATimestamp,
+                            deadda ? 0 : G_SlpdProperty.DATimestamp,
                             G_SlpdProperty.myUrlLen,
                             G_SlpdProperty.myUrl,
                             0,
@@ -984,8 +1297,6 @@ int SLPDKnownDAGenerateMyDAAdvert(int errorcode,
                             &daadvertauthlen,
                             &daadvertauth);
     }
-#else
-    G_SlpdProperty.DATimestamp += 1;
 #endif
 
 
@@ -1114,6 +1425,8 @@ int SLPDKnownDAGenerateMyDAAdvert(int errorcode,
         }
     }
 
+    KnownDAAdvertKeep(2,asked,deadda,errorcode,result);
+
     FINISHED:
 #ifdef ENABLE_SLPv2_SECURITY
     if ( daadvertauth ) xfree(daadvertauth);
@@ -1143,12 +1456,23 @@ int SLPDKnownDAGenerateMyV1DAAdvert(int errorcode,
 /*               DAAdvert                                                  */
 /*                                                                         */
 /* returns: zero on success, non-zero on error                             */
+/*                                                                         */
+/* The advert is built and signed once.  Later calls for the same advert   */
+/* get a copy with their xid until SLPDKnownDAInit() is called again       */
 /*=========================================================================*/
 {
     int       size = 0;
     int       urllen = INT_MAX;
     int       scopelistlen = INT_MAX;
+    int       asked = errorcode;
     SLPBuffer result = *sendbuf;
+    SLPDKnownDAAdvert* advert;
+
+    advert = KnownDAAdvertFind(1,errorcode,encoding);
+    if ( advert )
+    {
+        return KnownDAAdvertCopy(advert,xid,sendbuf);
+    }
 
     /*-------------------------------------------------------------*/
     /* ensure the buffer is big enough to handle the whole srvrply */
@@ -1250,6 +1574,8 @@ int SLPDKnownDAGenerateMyV1DAAdvert(int errorcode,
 
     result->curpos = result->curpos + scopelistlen;
 
+    KnownDAAdvertKeep(1,asked,encoding,errorcode,result);
+
     FINISHED:
     *sendbuf = result;
 
@@ -1265,18 +1591,23 @@ void SLPDKnownDAEcho(SLPMessage msg, SLPBuffer buf)
 /*									                                       */
 /* msg (IN) the SrvReg message descriptor                                  */
 /*                                                                         */
-/* buf (IN) the SrvReg message buffer to echo                              */
+/* buf (IN) the SrvReg or SrvDeReg message buffer to echo.  A SrvReg       */
+/*          buffer is shared with the outgoing sockets (see SLPBufferRef())*/
+/*          so it must not be written to afterwards                        */
 /*                                                                         */
 /* Returns:  none                                                          */
 /*=========================================================================*/
 {
     SLPBuffer           dup;
-    SLPDatabaseHandle   dh;
     SLPDatabaseEntry*   entry;
     SLPDAAdvert*        entrydaadvert;
     SLPDSocket*         sock;
     const char*         msgscope;
     int                 msgscopelen;
+    SLPFoldedKeys*      keys;
+    int                 freekeys        = 0;
+    SLPDKnownDAScope*   scope;
+    int                 i;
 
     /* Do not echo registrations if we are a DA unless they were made  */
     /* local through the API!                                          */
@@ -1301,64 +1632,106 @@ void SLPDKnownDAEcho(SLPMessage msg, SLPBuffer buf)
         return;
     }
 
-    dh = SLPDatabaseOpen(&G_SlpdKnownDAs);
-    if ( dh )
+    /* A SrvDeReg is echoed straight from the receive buffer, which is  */
+    /* reused for the next message, so it is copied once here.  SrvReg  */
+    /* buffers are kept unchanged in the registration database and are  */
+    /* shared as they are.  Each DA gets a reference, not a copy.       */
+    if ( msg->header.functionid == SLP_FUNCT_SRVDEREG )
+    {
+        buf = SLPBufferDup(buf);
+        if ( buf == NULL )
+        {
+            return;
+        }
+    }
+    else
     {
+        buf = SLPBufferRef(buf);
+        if ( buf == NULL )
+        {
+            return;
+        }
+    }
 
-        /*-----------------------------------------------------*/
-        /* Check to see if there is already an identical entry */
-        /*-----------------------------------------------------*/
-        while ( 1 )
+    /* Fold the scopes of the message, a SrvReg from the database  */
+    /* already carries them                                         */
+    keys = NULL;
+    if ( msg->header.functionid == SLP_FUNCT_SRVREG )
+    {
+        keys = msg->body.srvreg.keys;
+    }
+    if ( keys == NULL )
+    {
+        keys = SLPFoldedKeysCreate(0,NULL,0,NULL,0,NULL,msgscopelen,msgscope);
+        if ( keys == NULL )
         {
-            entry = SLPDatabaseEnum(dh);
-            if ( entry == NULL ) break;
+            SLPBufferFree(buf);
+            return;
+        }
+        freekeys = 1;
+    }
+
+    /*------------------------------------------------------------*/
+    /* Send to all DAs that have a matching scope, each DA once   */
+    /*------------------------------------------------------------*/
+    G_KnownDAEchoes++;
+    for ( i = 0; i < keys->scopecount; i++ )
+    {
+        scope = G_KnownDAByScope[keys->scopes[i].hash & (KNOWNDA_BUCKETS - 1)];
+        for ( ; scope; scope = scope->next )
+        {
+            if ( scope->da->echoed == G_KnownDAEchoes ||
+                 SLPFoldedCompareString(scope->scope,&(keys->scopes[i])) )
+            {
+                continue;
+            }
+            scope->da->echoed = G_KnownDAEchoes;
 
             /* entrydaadvert is the DAAdvert message from the database */
+            entry = scope->da->entry;
             entrydaadvert = &(entry->msg->body.daadvert);
 
-            /* Send to all DAs that have matching scope */
-            if ( SLPIntersectStringList(msgscopelen,
-                                        msgscope,
-                                        entrydaadvert->scopelistlen,
-                                        entrydaadvert->scopelist) )
+            /* Do not echo to ourselves if we are a DA*/
+            if ( G_SlpdProperty.isDA  &&
+                 SLPCompareString(G_SlpdProperty.myUrlLen,
+                                  G_SlpdProperty.myUrl,
+                                  entrydaadvert->urllen,
+                                  entrydaadvert->url) == 0 )
             {
-                /* Do not echo to ourselves if we are a DA*/
-                if ( G_SlpdProperty.isDA  &&
-                     SLPCompareString(G_SlpdProperty.myUrlLen,
-                                      G_SlpdProperty.myUrl,
-                                      entrydaadvert->urllen,
-                                      entrydaadvert->url) == 0 )
+                /* don't do anything because it makes no sense to echo */
+                /* to myself                                           */
+                continue;
+            }
+
+            /*------------------------------------------*/
+            /* Load the socket with the message to send */
+            /*------------------------------------------*/
+            sock = SLPDOutgoingConnect(&(entry->msg->peer.sin_addr));
+            if ( sock )
+            {
+                dup = SLPBufferRef(buf);
+                if ( dup )
                 {
-                    /* don't do anything because it makes no sense to echo */
-                    /* to myself                                           */
+                    SLPListLinkTail(&(sock->sendlist),(SLPListItem*)dup);
+                    if ( sock->state == STREAM_CONNECT_IDLE )
+                    {
+                        sock->state = STREAM_WRITE_FIRST;
+                    }
                 }
                 else
                 {
-                    /*------------------------------------------*/
-                    /* Load the socket with the message to send */
-                    /*------------------------------------------*/
-                    sock = SLPDOutgoingConnect(&(entry->msg->peer.sin_addr));
-                    if ( sock )
-                    {
-                        dup = SLPBufferDup(buf);
-                        if ( dup )
-                        {
-                            SLPListLinkTail(&(sock->sendlist),(SLPListItem*)dup);
-                            if ( sock->state == STREAM_CONNECT_IDLE )
-                            {
-                                sock->state = STREAM_WRITE_FIRST;
-                            }
-                        }
-                        else
-                        {
-                            sock->state = SOCKET_CLOSE;
-                        }
-                    }
+                    sock->state = SOCKET_CLOSE;
                 }
             }
         }
-        SLPDatabaseClose(dh);
     }
+
+    if ( freekeys )
+    {
+        SLPFoldedKeysFree(keys);
+    }
+
+    SLPBufferFree(buf);
 }
 
 
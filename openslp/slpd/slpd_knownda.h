@@ -148,6 +148,9 @@ int SLPDKnownDAGenerateMyDAAdvert(int errorcode,
 /*               DAAdvert                                                  */
 /*                                                                         */
 /* returns: zero on success, non-zero on error                             */
+/*                                                                         */
+/* The advert is built and signed once.  Later calls for the same advert   */
+/* get a copy with their xid until SLPDKnownDAInit() is called again       */
 /*=========================================================================*/
 
 
@@ -169,6 +172,9 @@ int SLPDKnownDAGenerateMyV1DAAdvert(int errorcode,
 /*               DAAdvert                                                  */
 /*                                                                         */
 /* returns: zero on success, non-zero on error                             */
+/*                                                                         */
+/* The advert is built and signed once.  Later calls for the same advert   */
+/* get a copy with their xid until SLPDKnownDAInit() is called again       */
 /*=========================================================================*/
 #endif
 
@@ -179,7 +185,9 @@ void SLPDKnownDAEcho(SLPMessage msg, SLPBuffer buf);
 /*									                                       */
 /* msg (IN) the SrvReg message descriptor                                  */
 /*                                                                         */
-/* buf (IN) the SrvReg message buffer to echo                              */
+/* buf (IN) the SrvReg or SrvDeReg message buffer to echo.  A SrvReg       */
+/*          buffer is shared with the outgoing sockets (see SLPBufferRef())*/
+/*          so it must not be written to afterwards                        */
 /*                                                                         */
 /* Returns:  none                                                          */
 /*=========================================================================*/
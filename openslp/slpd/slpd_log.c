@@ -275,7 +275,15 @@ void SLPDLogSrvTypeRqstMessage(SLPSrvTypeRqst* srvtyperqst)
 /*-------------------------------------------------------------------------*/
 {
     SLPDLog("Message SRVTYPERQST:\n");
-    SLPDLogBuffer("   namingauth = ", srvtyperqst->namingauthlen, srvtyperqst->namingauth);
+    if (srvtyperqst->namingauthlen == 0xffff)
+    {
+        /* 0xffff asks for all naming authorities, there is no string */
+        SLPDLog("   namingauth = <all>\n");
+    }
+    else
+    {
+        SLPDLogBuffer("   namingauth = ", srvtyperqst->namingauthlen, srvtyperqst->namingauth);
+    }
     SLPDLogBuffer("   scope = ", srvtyperqst->scopelistlen, srvtyperqst->scopelist);
 }
 
@@ -584,3 +592,42 @@ void SLPDLogParseWarning(struct sockaddr_in* peeraddr, SLPBuffer buf)
     }    
     SLPDLog("\n");
 }
+
+
+/*=========================================================================*/
+void SLPDLogPoolStats()
+/* Logs the statistics of the SLPBuffer and SLPMessage pools               */
+/*=========================================================================*/
+{
+    SLPPoolStats    stats;
+    size_t          size;
+    int             i;
+
+    SLPDLog("Dumping Pools\n");
+    SLPDLog("%-10s %10s %10s %10s %8s %8s %8s %8s\n",
+            "pool","allocs","hits","frees","trimmed","inuse","maxinuse",
+            "pooled");
+    for (i = 0; i < SLP_BUFFER_POOL_CLASSES; i++)
+    {
+        size = SLPBufferPoolGetStats(i,&stats);
+        SLPDLog("buf %-6u %10lu %10lu %10lu %8lu %8i %8i %8i\n",
+                (unsigned int)size,
+                stats.allocs,
+                stats.hits,
+                stats.frees,
+                stats.trimmed,
+                stats.inuse,
+                stats.maxinuse,
+                stats.pooled);
+    }
+    SLPMessagePoolGetStats(&stats);
+    SLPDLog("%-10s %10lu %10lu %10lu %8lu %8i %8i %8i\n",
+            "message",
+            stats.allocs,
+            stats.hits,
+            stats.frees,
+            stats.trimmed,
+            stats.inuse,
+            stats.maxinuse,
+            stats.pooled);
+}
@@ -164,4 +164,10 @@ void SLPDLogParseWarning(struct sockaddr_in* peeraddr, SLPBuffer buf);
 /* Log a parsing error warning and dumps the invalid message.              */
 /*=========================================================================*/
 
+
+/*=========================================================================*/
+void SLPDLogPoolStats();
+/* Logs the statistics of the SLPBuffer and SLPMessage pools               */
+/*=========================================================================*/
+
 #endif
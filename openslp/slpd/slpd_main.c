@@ -59,6 +59,8 @@
 #include "slpd_cmdline.h"
 #include "slpd_knownda.h"
 #include "slpd_property.h"
+#include "slpd_snapshot.h"
+#include "slpd_stats.h"
 #ifdef ENABLE_SLPv2_SECURITY
 #include "slpd_spi.h"
 #endif
@@ -107,6 +109,7 @@ void LoadFdSets(SLPList* socklist,
             break;
 
         case SOCKET_LISTEN:
+        case STATS_LISTEN:
             if(socklist->count < SLPD_MAX_SOCKETS)
             {
                 FD_SET(sock->fd,readfds);
@@ -120,6 +123,7 @@ void LoadFdSets(SLPList* socklist,
 
         case STREAM_WRITE:
         case STREAM_WRITE_FIRST:
+        case STREAM_WRITE_CLOSE:
         case STREAM_CONNECT_BLOCK:
             FD_SET(sock->fd,writefds);
             break;
@@ -161,6 +165,9 @@ void HandleSigTerm()
     /* close all incoming sockets */
     SLPDIncomingDeinit();
 
+    /* tell libslp to stop reading our registrations */
+    SLPDSnapshotDeinit();
+
     /* unregister with all DAs */
     SLPDKnownDADeinit();
 
@@ -199,6 +206,8 @@ void HandleSigTerm()
     SLPDDatabaseDeinit();
     SLPDPropertyDeinit();
     SLPDLogFileClose();
+    SLPBufferPoolSetLimit(0);
+    SLPMessagePoolSetLimit(0);
     xmalloc_deinit();    
 #endif
 
@@ -247,6 +256,11 @@ void HandleSigAlrm()
     SLPDKnownDAPassiveDAAdvert(SLPD_AGE_INTERVAL,0);
     SLPDKnownDAActiveDiscovery(SLPD_AGE_INTERVAL);
     SLPDDatabaseAge(SLPD_AGE_INTERVAL,G_SlpdProperty.isDA);
+#ifdef ENABLE_SLPv2_SECURITY
+    SLPDSpiAge(SLPD_AGE_INTERVAL);
+#endif
+    SLPBufferPoolTrim();
+    SLPMessagePoolTrim();
 }
 
 
@@ -259,6 +273,10 @@ void HandleSigInt()
     SLPDOutgoingSocketDump();
     SLPDKnownDADump();
     SLPDDatabaseDump();
+    SLPDLogPoolStats();
+#ifdef ENABLE_SLPv2_SECURITY
+    SLPDSpiDump();
+#endif
 }
 #endif
 
@@ -531,6 +549,9 @@ int main(int argc, char* argv[])
     /*--------------------------------------------------*/
     /* Initialize for the first time                    */
     /*--------------------------------------------------*/
+    SLPBufferPoolSetLimit(SLPD_POOL_LIMIT);
+    SLPMessagePoolSetLimit(SLPD_POOL_LIMIT);
+    SLPDStatsInit();
     if(SLPDPropertyInit(G_SlpdCommandLine.cfgfile) ||
 #ifdef ENABLE_SLPv2_SECURITY
        SLPDSpiInit(G_SlpdCommandLine.spifile) ||
@@ -538,7 +559,8 @@ int main(int argc, char* argv[])
        SLPDDatabaseInit(G_SlpdCommandLine.regfile) ||
        SLPDIncomingInit() ||
        SLPDOutgoingInit() ||
-       SLPDKnownDAInit())
+       SLPDKnownDAInit() ||
+       SLPDSnapshotInit())
     {
         SLPDFatal("slpd initialization failed\n");
     }
@@ -629,6 +651,11 @@ int main(int argc, char* argv[])
 	}			
 #endif
 
+        /*-------------------------------------------*/
+        /* Publish what changed to the snapshot file */
+        /*-------------------------------------------*/
+        SLPDSnapshotUpdate();
+
     } /* End of main loop */
 
     /* Got SIGTERM */
@@ -137,6 +137,21 @@ void OutgoingStreamReconnect(SLPList* socklist, SLPDSocket* sock)
         return;
     }
 
+    /*----------------------------------------------------------------*/
+    /* Nothing in flight was acknowledged.  Put it back, in order, at */
+    /* the front of the to do list so it is all sent again, and drop  */
+    /* any partial reply                                              */
+    /*----------------------------------------------------------------*/
+    while ( sock->inflight.count )
+    {
+        SLPListLinkHead(&(sock->sendlist),
+                        SLPListUnlink(&(sock->inflight),sock->inflight.tail));
+    }
+    if ( sock->recvbuf )
+    {
+        sock->recvbuf->curpos = sock->recvbuf->start;
+    }
+
     /*----------------------------------------------------------------*/
     /* Close the existing socket to clean the stream  and open an new */
     /* socket                                                         */
@@ -187,118 +202,187 @@ void OutgoingStreamReconnect(SLPList* socklist, SLPDSocket* sock)
 
 
 /*-------------------------------------------------------------------------*/
-void OutgoingStreamRead(SLPList* socklist, SLPDSocket* sock)
+void OutgoingStreamWrite(SLPList* socklist, SLPDSocket* sock);
 /*-------------------------------------------------------------------------*/
-{
-    int     bytesread, recvlen;
-    char    peek[16];
-    int     peeraddrlen = sizeof(struct sockaddr_in);
 
-    if ( sock->state == STREAM_READ_FIRST )
+
+/*-------------------------------------------------------------------------*/
+void OutgoingStreamProcess(SLPList* socklist, SLPDSocket* sock)
+/* Processes every complete reply buffered in sock->recvbuf.  Each reply   */
+/* is matched by XID with the oldest message on sock->inflight that was    */
+/* sent with it, so a window of messages can be outstanding at once        */
+/*-------------------------------------------------------------------------*/
+{
+    struct _SLPBuffer   frame;
+    SLPBuffer           grown;
+    SLPBuffer           buf;
+    unsigned char*      msg;
+    int                 buffered;
+    int                 msglen      = 0;
+    int                 busy        = 0;
+    unsigned short      xid;
+
+    msg = sock->recvbuf->start;
+    buffered = sock->recvbuf->curpos - msg;
+    memset(&frame,0,sizeof(frame));
+
+    while ( buffered >= 5 )
     {
-        /*---------------------------------------------------*/
-        /* take a peek at the packet to get size information */
-        /*---------------------------------------------------*/
-        bytesread = recvfrom(sock->fd,
-                             peek,
-                             16,
-                             MSG_PEEK,
-                             (struct sockaddr *)&(sock->peeraddr),
-                             &peeraddrlen);
-        if ( bytesread >= 5 && *peek == 2 )
+        /* only SLPv2 replies can be framed (and matched) */
+        msglen = AsUINT24((char*)msg + 2);
+        if ( *msg != 2 || msglen < 12 )
+        {
+            sock->state = SOCKET_CLOSE;
+            return;
+        }
+        if ( msglen > buffered )
+        {
+            break;
+        }
+
+        /* find the message this is a reply to */
+        xid = AsUINT16((char*)msg + 10);
+        buf = (SLPBuffer)sock->inflight.head;
+        while ( buf )
         {
-            recvlen = AsUINT24(peek + 2);
-            /* one byte is minimum */
-            if (recvlen <= 0)
-                recvlen = 1;
-            /* allocate the recvbuf big enough for the whole message */
-            sock->recvbuf = SLPBufferRealloc(sock->recvbuf, recvlen);
-            if ( sock->recvbuf )
+            if ( buf->curpos == buf->end &&
+                 AsUINT16((char*)buf->start + 10) == xid )
             {
-                sock->state = STREAM_READ;
+                break;
             }
-            else
+            buf = (SLPBuffer)buf->listitem.next;
+        }
+
+        if ( buf )
+        {
+            frame.start = msg;
+            frame.curpos = msg;
+            frame.end = msg + msglen;
+            frame.allocated = msglen;
+            switch ( SLPDProcessMessage(&(sock->peeraddr),
+                                        &frame,
+                                        &(sock->sendbuf)) )
             {
-                SLPDLog("INTERNAL_ERROR - out of memory!\n");
+            case SLP_ERROR_DA_BUSY_NOW:
+                /* send it again, first, when the DA is not so busy */
+                SLPListUnlink(&(sock->inflight),(SLPListItem*)buf);
+                SLPListLinkHead(&(sock->sendlist),(SLPListItem*)buf);
+                busy = 1;
+                break;
+            case SLP_ERROR_PARSE_ERROR:
+            case SLP_ERROR_VER_NOT_SUPPORTED:
                 sock->state = SOCKET_CLOSE;
+                return;
+            default:
+                /* End of this message exchange */
+                SLPBufferFree((SLPBuffer)SLPListUnlink(&(sock->inflight),
+                                                       (SLPListItem*)buf));
+                /* clear the reconnection count since we actually
+                 * transmitted a successful message exchange
+                 */
+                sock->reconns = 0;
+                break;
             }
         }
-        else if ( bytesread == -1 )
+        /* else it is not a reply to anything we sent, ignore it */
+
+        msg += msglen;
+        buffered -= msglen;
+    }
+
+    /* move what is left of a partial reply to the front */
+    if ( msg != sock->recvbuf->start )
+    {
+        memmove(sock->recvbuf->start, msg, buffered);
+        sock->recvbuf->curpos = sock->recvbuf->start + buffered;
+    }
+
+    /* make room for all of a reply bigger than the space read into */
+    if ( buffered >= 5 &&
+         msglen > sock->recvbuf->end - sock->recvbuf->start )
+    {
+        grown = SLPBufferAlloc(msglen);
+        if ( grown == 0 )
         {
-#ifdef _WIN32
-            if ( WSAEWOULDBLOCK != WSAGetLastError() )
-#else
-            if ( errno != EWOULDBLOCK )
-#endif
-            {
-                /* Error occured or connection was closed. Try to reconnect */
-                /* Socket will be closed if connect times out               */
-                OutgoingStreamReconnect(socklist,sock);
-            }
-        }       
-        else
-	{
+            SLPDLog("INTERNAL_ERROR - out of memory!\n");
             sock->state = SOCKET_CLOSE;
-	}
+            return;
+        }
+        memcpy(grown->start, sock->recvbuf->start, buffered);
+        grown->curpos = grown->start + buffered;
+        SLPBufferFree(sock->recvbuf);
+        sock->recvbuf = grown;
     }
 
-    if ( sock->state == STREAM_READ )
+    if ( busy )
     {
-        /*------------------------------*/
-        /* recv the rest of the message */
-        /*------------------------------*/
-        bytesread = recv(sock->fd,
-                         sock->recvbuf->curpos,
-                         sock->recvbuf->end - sock->recvbuf->curpos,
-                         0);
-        if ( bytesread > 0 )
-        {
-            /* reset age because of activity */
-            sock->age = 0;
+        /* SLPDOutgoingAge() will start writing again */
+        sock->state = STREAM_WRITE_WAIT;
+    }
+    else if ( sock->sendlist.count &&
+              sock->inflight.count < G_SlpdProperty.DARegistrationWindow )
+    {
+        /* the window has room for more */
+        sock->state = STREAM_WRITE_FIRST;
+        OutgoingStreamWrite(socklist, sock);
+    }
+    else if ( sock->inflight.count )
+    {
+        sock->state = STREAM_READ;
+    }
+    else
+    {
+        sock->state = STREAM_CONNECT_IDLE;
+    }
+}
 
-            /* move buffer pointers */
-            sock->recvbuf->curpos += bytesread;
 
-            /* check to see if everything was read */
-            if ( sock->recvbuf->curpos == sock->recvbuf->end )
-            {
-                switch ( SLPDProcessMessage(&(sock->peeraddr),
-                                            sock->recvbuf,
-                                            &(sock->sendbuf)) )
-                {
-                case SLP_ERROR_DA_BUSY_NOW:
-                    sock->state = STREAM_WRITE_WAIT;
-                    break;
-                case SLP_ERROR_PARSE_ERROR:
-                case SLP_ERROR_VER_NOT_SUPPORTED:
-                    sock->state = SOCKET_CLOSE;
-                    break;
-                default:
-                    /* End of outgoing message exchange. Unlink   */
-                    /* send buf from to do list and free it       */
-                    SLPBufferFree(sock->sendbuf);
-                    sock->sendbuf = NULL;
-                    sock->state = STREAM_WRITE_FIRST;
-                    /* clear the reconnection count since we actually
-                     * transmitted a successful message exchange
-                     */
-                    sock->reconns = 0;
-                    break;
-                }
-            }
-        }
-        else
+/*-------------------------------------------------------------------------*/
+void OutgoingStreamRead(SLPList* socklist, SLPDSocket* sock)
+/*-------------------------------------------------------------------------*/
+{
+    int     bytesread;
+
+    if ( sock->recvbuf == 0 )
+    {
+        sock->recvbuf = SLPBufferAlloc(SLP_MAX_DATAGRAM_SIZE);
+        if ( sock->recvbuf == 0 )
         {
+            SLPDLog("INTERNAL_ERROR - out of memory!\n");
+            sock->state = SOCKET_CLOSE;
+            return;
+        }
+    }
+
+    /*-----------------------------------------------------------*/
+    /* recv whatever has arrived, it may hold several replies or */
+    /* a part of one                                             */
+    /*-----------------------------------------------------------*/
+    bytesread = recv(sock->fd,
+                     sock->recvbuf->curpos,
+                     sock->recvbuf->end - sock->recvbuf->curpos,
+                     0);
+    if ( bytesread > 0 )
+    {
+        /* reset age because of activity */
+        sock->age = 0;
+
+        /* move buffer pointers */
+        sock->recvbuf->curpos += bytesread;
+
+        OutgoingStreamProcess(socklist, sock);
+    }
+    else
+    {
 #ifdef _WIN32
-            if ( WSAEWOULDBLOCK != WSAGetLastError() )
+        if ( bytesread == 0 || WSAEWOULDBLOCK != WSAGetLastError() )
 #else
-            if ( errno != EWOULDBLOCK )
+        if ( bytesread == 0 || errno != EWOULDBLOCK )
 #endif
-            {
-                /* Error occured or connection was closed. Try to reconnect */
-                /* Socket will be closed if connect times out               */
-                OutgoingStreamReconnect(socklist,sock);
-            }
+        {
+            /* Error occured or connection was closed. Try to reconnect */
+            /* Socket will be closed if connect times out               */
+            OutgoingStreamReconnect(socklist,sock);
         }
     }
 }
@@ -306,81 +390,108 @@ void OutgoingStreamRead(SLPList* socklist, SLPDSocket* sock)
 
 /*-------------------------------------------------------------------------*/
 void OutgoingStreamWrite(SLPList* socklist, SLPDSocket* sock)
+/* Writes the messages in the window back to back, without waiting for     */
+/* replies.  Sent messages stay on sock->inflight until they are replied   */
 /*-------------------------------------------------------------------------*/
 {
-    int        byteswritten;
-    int        flags = 0;
-
-#if defined(MSG_DONTWAIT)
-    flags = MSG_DONTWAIT;
+    SLPBuffer       buf;
+    SLPBuffer       next;
+    int             byteswritten;
+#ifdef _WIN32
+    int             flags = 0;
+#else
+    struct iovec    iov[SLPD_MAX_PIPELINE];
+    int             iovcnt;
 #endif
 
     if ( sock->state == STREAM_WRITE_FIRST )
     {
-        /* set sendbuf to the first item in the send list if it is not set */
-        if(sock->sendbuf == NULL)
+        /* move as much of the to do list into the window as will fit */
+        while ( sock->sendlist.count &&
+                sock->inflight.count < G_SlpdProperty.DARegistrationWindow )
         {
-            sock->sendbuf = (SLPBuffer)sock->sendlist.head;
-            if ( sock->sendbuf == NULL )
-            {
-                /* there is nothing in the to do list */
-                sock->state = STREAM_CONNECT_IDLE;
-                return;
-            }
-            /* Unlink the send buffer we are sending from the send list */
-            SLPListUnlink(&(sock->sendlist),(SLPListItem*)(sock->sendbuf));
+            buf = (SLPBuffer)SLPListUnlink(&(sock->sendlist),
+                                           sock->sendlist.head);
+            /* make sure that the start and curpos pointers are the same */
+            buf->curpos = buf->start;
+            SLPListLinkTail(&(sock->inflight),(SLPListItem*)buf);
         }
-
-        /* make sure that the start and curpos pointers are the same */
-        sock->sendbuf->curpos = sock->sendbuf->start;
         sock->state = STREAM_WRITE;
     }
 
-    if ( sock->sendbuf->end - sock->sendbuf->start > 0 )
+    /* skip the messages that are already written */
+    buf = (SLPBuffer)sock->inflight.head;
+    while ( buf && buf->curpos == buf->end )
     {
-        byteswritten = send(sock->fd,
-                            sock->sendbuf->curpos,
-                            sock->sendbuf->end - sock->sendbuf->start,
-                            flags);
-        if ( byteswritten > 0 )
-        {
-            /* reset age because of activity */
-            sock->age = 0; 
-            
-            /* move buffer pointers */
-            sock->sendbuf->curpos += byteswritten;
+        buf = (SLPBuffer)buf->listitem.next;
+    }
+    if ( buf == 0 )
+    {
+        /* nothing to write */
+        sock->state = sock->inflight.count ? STREAM_READ : STREAM_CONNECT_IDLE;
+        return;
+    }
 
-            /* check to see if everything was written */
-            if ( sock->sendbuf->curpos == sock->sendbuf->end )
-            {
-                /* Message is completely sent. Set state to read the reply */
-                sock->state = STREAM_READ_FIRST;
-            }
-        }
-        else
-        {
 #ifdef _WIN32
-            if ( WSAEWOULDBLOCK != WSAGetLastError() )
+    /* no writev(), send one message at a time */
+    byteswritten = send(sock->fd,
+                        buf->curpos,
+                        buf->end - buf->curpos,
+                        flags);
 #else
-            if ( errno != EWOULDBLOCK )
+    iovcnt = 0;
+    for ( next = buf; next; next = (SLPBuffer)next->listitem.next )
+    {
+        iov[iovcnt].iov_base = next->curpos;
+        iov[iovcnt].iov_len = next->end - next->curpos;
+        iovcnt += 1;
+    }
+    byteswritten = writev(sock->fd, iov, iovcnt);
 #endif
+
+    if ( byteswritten > 0 )
+    {
+        /* reset age because of activity */
+        sock->age = 0; 
+
+        /* move buffer pointers */
+        while ( buf && byteswritten > 0 )
+        {
+            next = (SLPBuffer)buf->listitem.next;
+            if ( byteswritten < buf->end - buf->curpos )
             {
-                /* Error occured or connection was closed. Try to reconnect */
-                /* Socket will be closed if connect times out               */
-                OutgoingStreamReconnect(socklist,sock);
+                buf->curpos += byteswritten;
+                break;
             }
+            byteswritten -= buf->end - buf->curpos;
+            buf->curpos = buf->end;
+            buf = next;
+        }
+
+        /* check to see if everything was written */
+        if ( ((SLPBuffer)sock->inflight.tail)->curpos ==
+             ((SLPBuffer)sock->inflight.tail)->end )
+        {
+            /* Window is completely sent. Set state to read the replies */
+            sock->state = STREAM_READ;
         }
     }
     else
     {
-        /* nothing to write */
-#ifdef DEBUG
-        SLPDLog("yikes, an empty socket is being written!\n");
+#ifdef _WIN32
+        if ( WSAEWOULDBLOCK != WSAGetLastError() )
+#else
+        if ( errno != EWOULDBLOCK )
 #endif
-        sock->state = SOCKET_CLOSE;
+        {
+            /* Error occured or connection was closed. Try to reconnect */
+            /* Socket will be closed if connect times out               */
+            OutgoingStreamReconnect(socklist,sock);
+        }
     }
 }
 
+
 /*=========================================================================*/
 SLPDSocket* SLPDOutgoingConnect(struct in_addr* addr)
 /* Get a pointer to a connected socket that is associated with the         */
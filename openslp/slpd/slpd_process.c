@@ -54,6 +54,7 @@
 #include "slpd_database.h"
 #include "slpd_knownda.h"
 #include "slpd_log.h"
+#include "slpd_stats.h"
 #ifdef ENABLE_SLPv2_SECURITY
     #include "slpd_spi.h"
 #endif
@@ -1309,6 +1310,94 @@ int ProcessSAAdvert(SLPMessage message,
 }
 
 
+/*-------------------------------------------------------------------------*/
+int ProcessEarlyDrop(SLPMessage message, int* errorcode)
+/* Decides from the fields parsed by SLPMessageParseRouting() alone        */
+/* whether a request would be silently dropped anyway, so that the rest    */
+/* of it need not be parsed.  Sets errorcode to what processing the whole  */
+/* message would have returned.                                            */
+/*                                                                         */
+/* Returns  - non-zero if the request is to be dropped                     */
+/*-------------------------------------------------------------------------*/
+{
+    int             prlistlen;
+    const char*     prlist;
+    int             scopelistlen;
+    const char*     scopelist;
+    int             checkscope  = 1;
+
+    switch (message->header.functionid)
+    {
+    case SLP_FUNCT_SRVRQST:
+        prlistlen = message->body.srvrqst.prlistlen;
+        prlist = message->body.srvrqst.prlist;
+        scopelistlen = message->body.srvrqst.scopelistlen;
+        scopelist = message->body.srvrqst.scopelist;
+
+        /* DA and SA discovery have their own scope rules */
+        if (SLPCompareString(message->body.srvrqst.srvtypelen,
+                             message->body.srvrqst.srvtype,
+                             23,
+                             SLP_DA_SERVICE_TYPE) == 0 ||
+            SLPCompareString(message->body.srvrqst.srvtypelen,
+                             message->body.srvrqst.srvtype,
+                             21,
+                             SLP_SA_SERVICE_TYPE) == 0)
+        {
+            checkscope = 0;
+        }
+        break;
+
+    case SLP_FUNCT_ATTRRQST:
+        prlistlen = message->body.attrrqst.prlistlen;
+        prlist = message->body.attrrqst.prlist;
+        scopelistlen = message->body.attrrqst.scopelistlen;
+        scopelist = message->body.attrrqst.scopelist;
+        break;
+
+    case SLP_FUNCT_SRVTYPERQST:
+        prlistlen = message->body.srvtyperqst.prlistlen;
+        prlist = message->body.srvtyperqst.prlist;
+        scopelistlen = message->body.srvtyperqst.scopelistlen;
+        scopelist = message->body.srvtyperqst.scopelist;
+        break;
+
+    default:
+        return 0;
+    }
+
+    /*-------------------------------------------------*/
+    /* Check for one of our IP addresses in the prlist */
+    /*-------------------------------------------------*/
+    if (SLPIntersectStringList(prlistlen,
+                               prlist,
+                               G_SlpdProperty.interfacesLen,
+                               G_SlpdProperty.interfaces))
+    {
+        *errorcode = 0;
+        return 1;
+    }
+
+    /*---------------------------------------------------------*/
+    /* Errors are never sent in reply to multicast requests so */
+    /* an unsupported scope means the request is dropped       */
+    /*---------------------------------------------------------*/
+    if (checkscope &&
+        (message->header.flags & SLP_FLAG_MCAST ||
+         ISMCAST(message->peer.sin_addr)) &&
+        SLPIntersectStringList(scopelistlen,
+                               scopelist,
+                               G_SlpdProperty.useScopesLen,
+                               G_SlpdProperty.useScopes) == 0)
+    {
+        *errorcode = SLP_ERROR_SCOPE_NOT_SUPPORTED;
+        return 1;
+    }
+
+    return 0;
+}
+
+
 /*=========================================================================*/
 int SLPDProcessMessage(struct sockaddr_in* peerinfo,
                        SLPBuffer recvbuf,
@@ -1328,6 +1417,12 @@ int SLPDProcessMessage(struct sockaddr_in* peerinfo,
     SLPHeader   header;
     SLPMessage  message     = 0;
     int         errorcode   = 0;
+    int         dropped     = 0;
+    int         ackcode     = 0;
+    int         outcome;
+    struct timeval start;
+
+    gettimeofday(&start,0);
 
     SLPDLogMessage(SLPDLOG_TRACEMSG_IN,peerinfo,recvbuf);
 
@@ -1382,9 +1477,24 @@ int SLPDProcessMessage(struct sockaddr_in* peerinfo,
         message = SLPMessageAlloc();
         if (message)
         {
-            /* Parse the message and fill out the message descriptor */
-            errorcode = SLPMessageParseBuffer(peerinfo,recvbuf, message);
+            /* Parse just enough of the message to decide whether it */
+            /* will be answered, then the rest if it will be         */
+            errorcode = SLPMessageParseRouting(peerinfo,recvbuf, message);
             if (errorcode == 0)
+            {
+                dropped = ProcessEarlyDrop(message, &errorcode);
+                if (dropped == 0)
+                {
+                    errorcode = SLPMessageParseRemainder(recvbuf, message);
+                }
+            }
+
+            if (dropped)
+            {
+                /* silently ignore */
+                (*sendbuf)->end = (*sendbuf)->start;
+            }
+            else if (errorcode == 0)
             {
                 /* Process messages based on type */
                 switch (message->header.functionid)
@@ -1411,6 +1521,8 @@ int SLPDProcessMessage(struct sockaddr_in* peerinfo,
 
                 case SLP_FUNCT_SRVACK:
                     errorcode = ProcessSrvAck(message,sendbuf, errorcode);        
+                    /* only counted, the SrvAck is not acted on */
+                    ackcode = message->body.srvack.errorcode;
                     break;
 
                 case SLP_FUNCT_ATTRRQST:
@@ -1499,5 +1611,27 @@ int SLPDProcessMessage(struct sockaddr_in* peerinfo,
     /* Log trace message */
     SLPDLogMessage(SLPDLOG_TRACEMSG_OUT, peerinfo, *sendbuf);
 
+    /* Count the message under what became of it */
+    switch (errorcode ? errorcode : ackcode)
+    {
+    case 0:
+        outcome = dropped ? SLPD_STATS_PRLIST : SLPD_STATS_ANSWERED;
+        break;
+    case SLP_ERROR_SCOPE_NOT_SUPPORTED:
+        outcome = SLPD_STATS_SCOPE;
+        break;
+    case SLP_ERROR_PARSE_ERROR:
+    case SLP_ERROR_VER_NOT_SUPPORTED:
+        outcome = SLPD_STATS_PARSE;
+        break;
+    case SLP_ERROR_DA_BUSY_NOW:
+        outcome = SLPD_STATS_BUSY;
+        break;
+    default:
+        outcome = SLPD_STATS_ERROR;
+        break;
+    }
+    SLPDStatsMessage(header.functionid, outcome, &start);
+
     return errorcode;
 }                
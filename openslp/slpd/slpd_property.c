@@ -62,6 +62,8 @@
 #include "slp_net.h"
 #include "slp_xmalloc.h"
 
+#include <time.h>
+
 
 /*=========================================================================*/
 SLPDProperty G_SlpdProperty;
@@ -121,6 +123,16 @@ int SLPDPropertyInit(const char* conffile)
     G_SlpdProperty.securityEnabled = SLPPropertyAsBoolean(SLPPropertyGet("net.slp.securityEnabled"));
     G_SlpdProperty.checkSourceAddr = SLPPropertyAsBoolean(SLPPropertyGet("net.slp.checkSourceAddr"));
     G_SlpdProperty.DAHeartBeat = SLPPropertyAsInteger(SLPPropertyGet("net.slp.DAHeartBeat"));
+    G_SlpdProperty.DARegistrationWindow = SLPPropertyAsInteger(SLPPropertyGet("net.slp.DARegistrationWindow"));
+    if(G_SlpdProperty.DARegistrationWindow < 1)
+    {
+        G_SlpdProperty.DARegistrationWindow = 1;
+    }
+    else if(G_SlpdProperty.DARegistrationWindow > SLPD_MAX_PIPELINE)
+    {
+        G_SlpdProperty.DARegistrationWindow = SLPD_MAX_PIPELINE;
+    }
+    G_SlpdProperty.DARestartOnStampChange = SLPPropertyAsBoolean(SLPPropertyGet("net.slp.DARestartOnStampChange"));
 
 
     /*-------------------------------------*/
@@ -215,7 +227,7 @@ int SLPDPropertyInit(const char* conffile)
     /*----------------------------------*/
     /* Set other values used internally */
     /*----------------------------------*/
-    G_SlpdProperty.DATimestamp = 1;  /* DATimestamp must start at 1 */
+    G_SlpdProperty.DATimestamp = time(0); /* boot timestamp, never 0 */
     G_SlpdProperty.activeDiscoveryXmits = 3; /* ensures xmit on first 3 calls to SLPDKnownDAActiveDiscovery() */
     G_SlpdProperty.nextActiveDiscovery = 0;  /* ensures xmit on first call to SLPDKnownDAActiveDiscovery() */
     G_SlpdProperty.nextPassiveDAAdvert = 0;  /* ensures xmit on first call to SLPDKnownDAPassiveDiscovery()*/
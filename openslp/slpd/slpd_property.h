@@ -94,6 +94,8 @@ typedef struct _SLPDProperty
     int             securityEnabled;
     int             checkSourceAddr;
     int             DAHeartBeat;
+    int             DARegistrationWindow;
+    int             DARestartOnStampChange;
 }SLPDProperty;
 
 
@@ -0,0 +1,355 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol Version 2                                         */
+/*                                                                         */
+/* File:        slpd_snapshot.c                                            */
+/*                                                                         */
+/* Abstract:    Publishes a read only snapshot of the registrations        */
+/*              for libslp in a memory mapped file                         */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+/***************************************************************************/
+
+
+
+/*=========================================================================*/
+/* slpd includes                                                           */
+/*=========================================================================*/
+#include "slpd_snapshot.h"
+#include "slpd_database.h"
+#include "slpd_property.h"
+#include "slpd_log.h"
+
+
+/*=========================================================================*/
+/* common code includes                                                    */
+/*=========================================================================*/
+#include "slp_compare.h"
+#include "slp_snapshot.h"
+
+#include <time.h>
+
+
+#ifndef _WIN32
+
+#define SLPD_SNAPSHOT_INITIAL_SIZE  65536
+
+static int                  G_SnapshotFd        = -1;
+static SLPSnapshotHeader*   G_Snapshot          = 0;
+static size_t               G_SnapshotSize      = 0;
+static unsigned             G_SnapshotChanges   = 0;
+
+
+/*-------------------------------------------------------------------------*/
+static int SnapshotResize(size_t size)
+/* Grows the snapshot file to size bytes and maps it again                 */
+/*-------------------------------------------------------------------------*/
+{
+    void* map;
+
+    if ( ftruncate(G_SnapshotFd, size) )
+    {
+        return -1;
+    }
+
+    if ( G_Snapshot )
+    {
+        munmap(G_Snapshot, G_SnapshotSize);
+        G_Snapshot = 0;
+    }
+
+    map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, G_SnapshotFd, 0);
+    if ( map == MAP_FAILED )
+    {
+        return -1;
+    }
+
+    G_Snapshot = (SLPSnapshotHeader*)map;
+    G_SnapshotSize = size;
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void SnapshotClose()
+/*-------------------------------------------------------------------------*/
+{
+    if ( G_Snapshot )
+    {
+        G_Snapshot->generation = SLP_SNAPSHOT_DEAD;
+        munmap(G_Snapshot, G_SnapshotSize);
+        G_Snapshot = 0;
+    }
+
+    if ( G_SnapshotFd >= 0 )
+    {
+        close(G_SnapshotFd);
+        G_SnapshotFd = -1;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static uint32_t SnapshotNextGeneration(uint32_t generation)
+/*-------------------------------------------------------------------------*/
+{
+    generation++;
+    if ( generation == SLP_SNAPSHOT_DEAD )
+    {
+        /* wrapped around, skip the value that means dead */
+        generation = 1;
+    }
+
+    return generation;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void SnapshotPublish(time_t now)
+/* Rewrites everything behind the header.  Only a DA's registrations are   */
+/* published, an SA does not know about the services of other SAs so       */
+/* libslp has to go to the network anyway.                                 */
+/*-------------------------------------------------------------------------*/
+{
+    SLPDatabaseHandle   dh;
+    SLPDatabaseEntry*   entry;
+    SLPSrvReg*          srvreg;
+    SLPSnapshotEntry*   snapentry;
+    size_t              needed;
+    size_t              size;
+    char*               cur;
+    uint32_t            count;
+
+    dh = SLPDatabaseOpen(&G_SlpdDatabase.database);
+    if ( dh == 0 )
+    {
+        return;
+    }
+
+    /*--------------------------------------------*/
+    /* Work out how much room the snapshot needs  */
+    /*--------------------------------------------*/
+    needed = sizeof(SLPSnapshotHeader) +
+             SLP_SNAPSHOT_ALIGN(G_SlpdProperty.useScopesLen);
+    if ( G_SlpdProperty.isDA )
+    {
+        while ( (entry = SLPDatabaseEnum(dh)) != 0 )
+        {
+            srvreg = &(entry->msg->body.srvreg);
+            needed += SLP_SNAPSHOT_ENTRY_SIZE(srvreg->urlentry.urllen,
+                                              srvreg->srvtypelen,
+                                              srvreg->scopelistlen,
+                                              srvreg->attrlistlen);
+        }
+        SLPDatabaseRewind(dh);
+    }
+
+    /*-----------------------------------------------*/
+    /* Tell readers to keep out while we write to it */
+    /*-----------------------------------------------*/
+    G_Snapshot->generation = SnapshotNextGeneration(G_Snapshot->generation);
+    SLP_SNAPSHOT_BARRIER();
+
+    if ( needed > G_SnapshotSize )
+    {
+        size = G_SnapshotSize * 2;
+        while ( size < needed )
+        {
+            size *= 2;
+        }
+
+        if ( SnapshotResize(size) )
+        {
+            SLPDLog("Could not grow %s to %i bytes: %s\n",
+                    SLP_SNAPSHOT_FILE, (int)size, strerror(errno));
+            SLPDatabaseClose(dh);
+            SnapshotClose();
+            return;
+        }
+    }
+
+    /*-------------------------------------*/
+    /* Scopes and then the registrations   */
+    /*-------------------------------------*/
+    cur = (char*)(G_Snapshot + 1);
+    memcpy(cur, G_SlpdProperty.useScopes, G_SlpdProperty.useScopesLen);
+    cur += SLP_SNAPSHOT_ALIGN(G_SlpdProperty.useScopesLen);
+
+    count = 0;
+    if ( G_SlpdProperty.isDA )
+    {
+        while ( (entry = SLPDatabaseEnum(dh)) != 0 )
+        {
+            srvreg = &(entry->msg->body.srvreg);
+
+            snapentry = (SLPSnapshotEntry*)cur;
+            if ( srvreg->urlentry.lifetime == SLP_LIFETIME_MAXIMUM &&
+                 (srvreg->source == SLP_REG_SOURCE_LOCAL ||
+                  srvreg->source == SLP_REG_SOURCE_STATIC) )
+            {
+                /* never aged, see SLPDDatabaseAge() */
+                snapentry->expires = 0;
+            }
+            else
+            {
+                snapentry->expires = now + srvreg->urlentry.lifetime;
+            }
+            snapentry->srvtypehash = srvreg->keys->srvtype.hash;
+            snapentry->abstracttypehash = srvreg->keys->abstracttype.hash;
+            snapentry->urlhash = srvreg->keys->url.hash;
+            snapentry->urllen = srvreg->urlentry.urllen;
+            snapentry->srvtypelen = srvreg->srvtypelen;
+            snapentry->scopelistlen = srvreg->scopelistlen;
+            snapentry->attrlistlen = srvreg->attrlistlen;
+
+            cur = (char*)(snapentry + 1);
+            memcpy(cur, srvreg->urlentry.url, srvreg->urlentry.urllen);
+            cur += srvreg->urlentry.urllen;
+            memcpy(cur, srvreg->srvtype, srvreg->srvtypelen);
+            cur += srvreg->srvtypelen;
+            memcpy(cur, srvreg->scopelist, srvreg->scopelistlen);
+            cur += srvreg->scopelistlen;
+            memcpy(cur, srvreg->attrlist, srvreg->attrlistlen);
+
+            cur = (char*)snapentry + 
+                  SLP_SNAPSHOT_ENTRY_SIZE(srvreg->urlentry.urllen,
+                                          srvreg->srvtypelen,
+                                          srvreg->scopelistlen,
+                                          srvreg->attrlistlen);
+            count++;
+        }
+    }
+
+    SLPDatabaseClose(dh);
+
+    G_Snapshot->size = G_SnapshotSize;
+    G_Snapshot->used = cur - (char*)G_Snapshot;
+    G_Snapshot->count = count;
+    G_Snapshot->isDA = G_SlpdProperty.isDA;
+    G_Snapshot->scopelistlen = G_SlpdProperty.useScopesLen;
+
+    /*------------------------------*/
+    /* Let the readers back in      */
+    /*------------------------------*/
+    SLP_SNAPSHOT_BARRIER();
+    G_Snapshot->generation = SnapshotNextGeneration(G_Snapshot->generation);
+}
+
+#endif /* ifndef _WIN32 */
+
+
+/*=========================================================================*/
+int SLPDSnapshotInit()
+/* Creates the snapshot file (SLP_SNAPSHOT_FILE) and publishes the first   */
+/* snapshot.  Must be called before slpd gives up root.                    */
+/*                                                                         */
+/* Returns  - Zero.  Failure to create the file is only logged, libslp     */
+/*            asks slpd over the socket when there is no snapshot.         */
+/*=========================================================================*/
+{
+#ifndef _WIN32
+    SnapshotClose();
+
+    /* start a new file so that readers still mapping an old one notice */
+    unlink(SLP_SNAPSHOT_FILE);
+    G_SnapshotFd = open(SLP_SNAPSHOT_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ( G_SnapshotFd < 0 ||
+         fchmod(G_SnapshotFd, 0644) ||  /* whatever the umask, all may read */
+         SnapshotResize(SLPD_SNAPSHOT_INITIAL_SIZE) )
+    {
+        SLPDLog("Could not create %s: %s\n",
+                SLP_SNAPSHOT_FILE, strerror(errno));
+        SnapshotClose();
+        return 0;
+    }
+
+    /* an empty snapshot is not a DA's, readers ask slpd until it is full */
+    G_Snapshot->generation = 0;
+    G_Snapshot->magic = SLP_SNAPSHOT_MAGIC;
+    G_Snapshot->heartbeat = time(0);
+    G_SnapshotChanges = G_SlpdDatabase.changes;
+    SnapshotPublish(time(0));
+#endif
+
+    return 0;
+}
+
+
+/*=========================================================================*/
+void SLPDSnapshotUpdate()
+/* Republishes the snapshot if the registrations changed since the last    */
+/* time and tells readers that slpd is still alive.  Called every time     */
+/* around the main loop.                                                   */
+/*=========================================================================*/
+{
+#ifndef _WIN32
+    time_t now;
+
+    if ( G_Snapshot == 0 )
+    {
+        return;
+    }
+
+    now = time(0);
+    G_Snapshot->heartbeat = now;
+
+    if ( G_SnapshotChanges != G_SlpdDatabase.changes )
+    {
+        G_SnapshotChanges = G_SlpdDatabase.changes;
+        SnapshotPublish(now);
+    }
+#endif
+}
+
+
+/*=========================================================================*/
+void SLPDSnapshotDeinit()
+/* Marks the snapshot dead, unmaps it and removes the file                 */
+/*=========================================================================*/
+{
+#ifndef _WIN32
+    if ( G_SnapshotFd >= 0 )
+    {
+        SnapshotClose();
+        unlink(SLP_SNAPSHOT_FILE);
+    }
+#endif
+}
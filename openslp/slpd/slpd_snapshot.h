@@ -0,0 +1,81 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol Version 2                                         */
+/*                                                                         */
+/* File:        slpd_snapshot.h                                            */
+/*                                                                         */
+/* Abstract:    Publishes a read only snapshot of the registrations        */
+/*              for libslp in a memory mapped file                         */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+/***************************************************************************/
+
+
+#ifndef SLPD_SNAPSHOT_H_INCLUDED
+#define SLPD_SNAPSHOT_H_INCLUDED
+
+#include "slpd.h"
+
+
+/*=========================================================================*/
+int SLPDSnapshotInit();
+/* Creates the snapshot file (SLP_SNAPSHOT_FILE) and publishes the first   */
+/* snapshot.  Must be called before slpd gives up root.                    */
+/*                                                                         */
+/* Returns  - Zero.  Failure to create the file is only logged, libslp     */
+/*            asks slpd over the socket when there is no snapshot.         */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void SLPDSnapshotUpdate();
+/* Republishes the snapshot if the registrations changed since the last    */
+/* time and tells readers that slpd is still alive.  Called every time     */
+/* around the main loop.                                                   */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void SLPDSnapshotDeinit();
+/* Marks the snapshot dead, unmaps it and removes the file                 */
+/*=========================================================================*/
+
+
+#endif
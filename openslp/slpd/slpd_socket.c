@@ -298,6 +298,11 @@ void SLPDSocketFree(SLPDSocket* sock)
             SLPBufferFree((SLPBuffer)SLPListUnlink(&(sock->sendlist), sock->sendlist.head));
         }
     }
+
+    while(sock->inflight.count)
+    {
+        SLPBufferFree((SLPBuffer)SLPListUnlink(&(sock->inflight), sock->inflight.head));
+    }
     
     if(sock->sendbuf)
     {
@@ -513,6 +518,66 @@ SLPDSocket* SLPDSocketCreateListen(struct in_addr* peeraddr)
 }
 
 
+#ifndef _WIN32
+/*==========================================================================*/
+SLPDSocket* SLPDSocketCreateLocalListen(const char* path)
+/*                                                                          */
+/* path - (IN) the file system path of the unix domain socket to listen on  */
+/*             Any file already at path is removed                          */
+/*                                                                          */
+/* Returns: A listening socket. SLPDSocket->state will be set to            */
+/*          SOCKET_LISTEN.   Returns NULL on error                          */
+/*==========================================================================*/
+{
+    int                 fdflags;
+    struct sockaddr_un  addr;
+    SLPDSocket*         sock;
+
+    if(strlen(path) >= sizeof(addr.sun_path))
+    {
+        return 0;
+    }
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path,path);
+
+    sock = SLPDSocketAlloc();
+    if(sock)
+    {
+        sock->fd = socket(PF_UNIX, SOCK_STREAM, 0);
+        if(sock->fd >= 0)
+        {
+            /* remove the socket left behind by an earlier slpd */
+            unlink(path);
+            if(bind(sock->fd,(struct sockaddr*)&addr,sizeof(addr)) == 0)
+            {
+                /* anyone may talk to slpd, just as through the loopback */
+                chmod(path,0666);
+                if(listen(sock->fd,5) == 0)
+                {
+                    /* Set socket to non-blocking so subsequent calls to */
+                    /* accept will *never* block                         */
+                    fdflags = fcntl(sock->fd, F_GETFL, 0);
+                    fcntl(sock->fd,F_SETFL, fdflags | O_NONBLOCK);
+                    sock->ifaddr.sin_family = AF_UNIX;
+                    sock->state = SOCKET_LISTEN;
+
+                    return sock;
+                }
+            }
+        }
+    }
+
+    if(sock)
+    {
+        SLPDSocketFree(sock);
+    }
+
+    return 0;
+}
+#endif
+
+
 /*==========================================================================*/
 SLPDSocket* SLPDSocketCreateConnected(struct in_addr* addr)
 /*                                                                          */
@@ -81,6 +81,8 @@
 #define    STREAM_WRITE            10   + SOCKET_PENDING_IO
 #define    STREAM_WRITE_FIRST      11   + SOCKET_PENDING_IO
 #define    STREAM_WRITE_WAIT       12   + SOCKET_PENDING_IO
+#define    STATS_LISTEN            13
+#define    STREAM_WRITE_CLOSE      14   + SOCKET_PENDING_IO
 
 #ifdef _WIN32
 #define CloseSocket(Arg) closesocket(Arg)
@@ -107,6 +109,7 @@ typedef struct _SLPDSocket
     /* Outgoing socket stuff */
     int                 reconns;
     SLPList             sendlist;
+    SLPList             inflight;   /* sent, waiting for their replies */
 }SLPDSocket;
 
 
@@ -134,6 +137,19 @@ SLPDSocket* SLPDSocketCreateListen(struct in_addr* peeraddr);
 /*==========================================================================*/
 
 
+#ifndef _WIN32
+/*==========================================================================*/
+SLPDSocket* SLPDSocketCreateLocalListen(const char* path);
+/*                                                                          */
+/* path - (IN) the file system path of the unix domain socket to listen on  */
+/*             Any file already at path is removed                          */
+/*                                                                          */
+/* Returns: A listening socket. SLPDSocket->state will be set to            */
+/*          SOCKET_LISTEN.   Returns NULL on error                          */
+/*==========================================================================*/
+#endif
+
+
 /*==========================================================================*/
 SLPDSocket* SLPDSocketCreateDatagram(struct in_addr* peeraddr, int type); 
 /* peeraddr - (IN) the address of the peer to connect to                    */
@@ -51,12 +51,21 @@
 /* slpd includes                                                           */
 /*=========================================================================*/
 #include "slpd_spi.h"
+#include "slpd_log.h"
 
 /*=========================================================================*/
 SLPSpiHandle G_SlpdSpiHandle = 0;
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+unsigned long G_SlpdSpiKeyLookupRate = 0;
+/* Keys looked up per second over the last SLPDSpiAge() interval           */
+/*=========================================================================*/
+
+static unsigned long G_SlpdSpiKeyLookupsAged = 0;
+
+
 /*=========================================================================*/
 int SLPDSpiInit(const char* spifile)
 /*=========================================================================*/
@@ -68,9 +77,28 @@ int SLPDSpiInit(const char* spifile)
     }
    
     G_SlpdSpiHandle = SLPSpiOpen(spifile,1);
+    G_SlpdSpiKeyLookupsAged = 0;
     return (G_SlpdSpiHandle == 0);
 }
 
+
+/*=========================================================================*/
+void SLPDSpiAge(int seconds)
+/* Updates G_SlpdSpiKeyLookupRate                                          */
+/*                                                                         */
+/* seconds (IN) seconds since the last call                                */
+/*=========================================================================*/
+{
+    unsigned long   lookups;
+
+    if(G_SlpdSpiHandle && seconds > 0)
+    {
+        lookups = G_SlpdSpiHandle->keylookups;
+        G_SlpdSpiKeyLookupRate = (lookups - G_SlpdSpiKeyLookupsAged) / seconds;
+        G_SlpdSpiKeyLookupsAged = lookups;
+    }
+}
+
 #ifdef DEBUG
 /*=========================================================================*/
 void SLPDSpiDeinit()
@@ -78,6 +106,20 @@ void SLPDSpiDeinit()
 {
     SLPSpiClose(G_SlpdSpiHandle);
 }
+
+
+/*=========================================================================*/
+void SLPDSpiDump()
+/* Logs how many keys were looked up                                       */
+/*=========================================================================*/
+{
+    if(G_SlpdSpiHandle)
+    {
+        SLPDLog("Key lookups: %lu, %lu per second\n",
+                G_SlpdSpiHandle->keylookups,
+                G_SlpdSpiKeyLookupRate);
+    }
+}
 #endif
 
 
@@ -63,13 +63,33 @@ extern SLPSpiHandle G_SlpdSpiHandle;
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+extern unsigned long G_SlpdSpiKeyLookupRate;
+/* Keys looked up per second over the last SLPDSpiAge() interval           */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 int SLPDSpiInit(const char* spifile);
 /*=========================================================================*/
 
 
+/*=========================================================================*/
+void SLPDSpiAge(int seconds);
+/* Updates G_SlpdSpiKeyLookupRate                                          */
+/*                                                                         */
+/* seconds (IN) seconds since the last call                                */
+/*=========================================================================*/
+
+
 /*=========================================================================*/
 void SLPDSpiDeinit();
 /*=========================================================================*/
 
+
+/*=========================================================================*/
+void SLPDSpiDump();
+/* Logs how many keys were looked up                                       */
+/*=========================================================================*/
+
 #endif
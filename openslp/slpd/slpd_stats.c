@@ -0,0 +1,238 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol Version 2                                         */
+/*                                                                         */
+/* File:        slpd_stats.c                                               */
+/*                                                                         */
+/* Abstract:    Counts the messages slpd processes and how long each took  */
+/*              and reports them on the stats socket                       */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+/***************************************************************************/
+
+
+/*=========================================================================*/
+/* slpd includes                                                           */
+/*=========================================================================*/
+#include "slpd_stats.h"
+#include "slpd_database.h"
+#include "slpd_incoming.h"
+#include "slpd_outgoing.h"
+#include "slpd_socket.h"
+#ifdef ENABLE_SLPv2_SECURITY
+#include "slpd_spi.h"
+#endif
+
+
+/*=========================================================================*/
+/* common code includes                                                    */
+/*=========================================================================*/
+#include "slp_message.h"
+#include "slp_histogram.h"
+
+#include <time.h>
+
+
+/*=========================================================================*/
+/* Stats constants                                                         */
+/*=========================================================================*/
+#define SLPD_STATS_FUNCTIONS    (SLP_FUNCT_SAADVERT + 1)
+#define SLPD_STATS_LINE         100 /* longest line of a report */
+
+
+static SLPHistogram         G_SlpdStats[SLPD_STATS_FUNCTIONS][SLPD_STATS_OUTCOMES];
+static time_t               G_SlpdStatsStart;
+
+static const char* G_SlpdStatsFunctions[SLPD_STATS_FUNCTIONS] =
+{
+    "OTHER",
+    "SRVRQST",
+    "SRVRPLY",
+    "SRVREG",
+    "SRVDEREG",
+    "SRVACK",
+    "ATTRRQST",
+    "ATTRRPLY",
+    "DAADVERT",
+    "SRVTYPERQST",
+    "SRVTYPERPLY",
+    "SAADVERT"
+};
+
+static const char* G_SlpdStatsOutcomes[SLPD_STATS_OUTCOMES] =
+{
+    "answered",
+    "prlist",
+    "scope",
+    "parse",
+    "busy",
+    "error"
+};
+
+
+/*=========================================================================*/
+void SLPDStatsInit()
+/* Clears all of the counters                                              */
+/*=========================================================================*/
+{
+    memset(G_SlpdStats, 0, sizeof(G_SlpdStats));
+    G_SlpdStatsStart = time(0);
+}
+
+
+/*=========================================================================*/
+void SLPDStatsMessage(int functionid, int outcome, struct timeval* start)
+/* Counts a processed message and adds the time since start to the latency */
+/* histogram of its function id and outcome                                */
+/*                                                                         */
+/* functionid (IN) SLP function id of the message, anything unknown is     */
+/*                 counted together                                        */
+/*                                                                         */
+/* outcome    (IN) one of the SLPD_STATS_ values above                     */
+/*                                                                         */
+/* start      (IN) when processing of the message started                  */
+/*=========================================================================*/
+{
+    struct timeval  now;
+    unsigned long   usecs;
+
+    if ( functionid < 0 || functionid >= SLPD_STATS_FUNCTIONS )
+    {
+        functionid = 0;
+    }
+
+    gettimeofday(&now, 0);
+    if ( now.tv_sec < start->tv_sec )
+    {
+        /* the clock was set back */
+        usecs = 0;
+    }
+    else
+    {
+        usecs = (now.tv_sec - start->tv_sec) * 1000000 +
+                now.tv_usec - start->tv_usec;
+    }
+
+    SLPHistogramAdd(&(G_SlpdStats[functionid][outcome]), usecs);
+}
+
+
+/*=========================================================================*/
+SLPBuffer SLPDStatsReport()
+/* Describes the counters, the size of the database and the sockets in     */
+/* plain text.  Latencies are given as percentiles in microseconds.        */
+/*                                                                         */
+/* Returns  - a buffer holding the text between start and end, or NULL if  */
+/*            out of memory.  The caller frees it                          */
+/*=========================================================================*/
+{
+    SLPBuffer           result;
+    SLPHistogram*       hist;
+    SLPDSocket*         sock;
+    char*               cur;
+    int                 lines;
+    int                 fid;
+    int                 outcome;
+
+    /* every line fits in SLPD_STATS_LINE, so count them first */
+    lines = 8 + G_OutgoingSocketList.count +
+            SLPD_STATS_FUNCTIONS * SLPD_STATS_OUTCOMES;
+    result = SLPBufferAlloc(lines * SLPD_STATS_LINE);
+    if ( result == 0 )
+    {
+        return 0;
+    }
+    cur = (char*)result->start;
+
+    cur += sprintf(cur, "uptime: %ld seconds\n",
+                   (long)(time(0) - G_SlpdStatsStart));
+    cur += sprintf(cur, "registrations: %d\n", SLPDDatabaseCount());
+    cur += sprintf(cur, "incoming sockets: %d\n", G_IncomingSocketList.count);
+    cur += sprintf(cur, "outgoing sockets: %d\n", G_OutgoingSocketList.count);
+
+    /*-------------------------------------------------------*/
+    /* How much is waiting to go out to every DA and peer    */
+    /*-------------------------------------------------------*/
+    sock = (SLPDSocket*)G_OutgoingSocketList.head;
+    while ( sock )
+    {
+        cur += sprintf(cur, "outgoing queue %s: %d waiting, %d in flight\n",
+                       inet_ntoa(sock->peeraddr.sin_addr),
+                       sock->sendlist.count,
+                       sock->inflight.count);
+        sock = (SLPDSocket*)sock->listitem.next;
+    }
+
+#ifdef ENABLE_SLPv2_SECURITY
+    cur += sprintf(cur, "key lookups: %lu per second\n",
+                   G_SlpdSpiKeyLookupRate);
+#endif
+
+    /*-------------------------------------------------------*/
+    /* One line for every function id and outcome seen       */
+    /*-------------------------------------------------------*/
+    cur += sprintf(cur, "%-12s %-9s %10s %8s %8s %8s %8s %8s\n",
+                   "message", "outcome", "count",
+                   "mean", "p50", "p90", "p99", "max");
+    for ( fid = 0; fid < SLPD_STATS_FUNCTIONS; fid++ )
+    {
+        for ( outcome = 0; outcome < SLPD_STATS_OUTCOMES; outcome++ )
+        {
+            hist = &(G_SlpdStats[fid][outcome]);
+            if ( hist->count == 0 )
+            {
+                continue;
+            }
+            cur += sprintf(cur, "%-12s %-9s %10lu %8lu %8lu %8lu %8lu %8lu\n",
+                           G_SlpdStatsFunctions[fid],
+                           G_SlpdStatsOutcomes[outcome],
+                           hist->count,
+                           (unsigned long)(hist->total / hist->count),
+                           SLPHistogramPercentile(hist, 500),
+                           SLPHistogramPercentile(hist, 900),
+                           SLPHistogramPercentile(hist, 990),
+                           hist->max);
+        }
+    }
+
+    result->end = (unsigned char*)cur;
+
+    return result;
+}
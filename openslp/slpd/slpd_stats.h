@@ -0,0 +1,105 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP - OpenSource implementation of Service Location    */
+/*              Protocol Version 2                                         */
+/*                                                                         */
+/* File:        slpd_stats.h                                               */
+/*                                                                         */
+/* Abstract:    Counts the messages slpd processes and how long each took  */
+/*              and reports them on the stats socket                       */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to http://www.openslp.org                     */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/* Copyright (C) 2000 Caldera Systems, Inc                                 */
+/* All rights reserved.                                                    */
+/*                                                                         */
+/* Redistribution and use in source and binary forms, with or without      */
+/* modification, are permitted provided that the following conditions are  */
+/* met:                                                                    */ 
+/*                                                                         */
+/*      Redistributions of source code must retain the above copyright     */
+/*      notice, this list of conditions and the following disclaimer.      */
+/*                                                                         */
+/*      Redistributions in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the following disclaimer in    */
+/*      the documentation and/or other materials provided with the         */
+/*      distribution.                                                      */
+/*                                                                         */
+/*      Neither the name of Caldera Systems nor the names of its           */
+/*      contributors may be used to endorse or promote products derived    */
+/*      from this software without specific prior written permission.      */
+/*                                                                         */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS     */
+/* `AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT      */
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR   */
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE CALDERA      */
+/* SYSTEMS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, */
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT        */
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  */
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON       */
+/* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT */
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE   */
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.    */
+/*                                                                         */
+/***************************************************************************/
+
+
+#ifndef SLPD_STATS_H_INCLUDED
+#define SLPD_STATS_H_INCLUDED
+
+#include "slpd.h"
+
+
+/*=========================================================================*/
+/* common code includes                                                    */
+/*=========================================================================*/
+#include "slp_buffer.h"
+
+
+/*=========================================================================*/
+/* What became of a processed message                                      */
+/*=========================================================================*/
+#define SLPD_STATS_ANSWERED     0   /* processed without an error       */
+#define SLPD_STATS_PRLIST       1   /* dropped, we are in the prlist    */
+#define SLPD_STATS_SCOPE        2   /* none of our scopes               */
+#define SLPD_STATS_PARSE        3   /* could not be parsed              */
+#define SLPD_STATS_BUSY         4   /* a DA said it was busy            */
+#define SLPD_STATS_ERROR        5   /* any other error                  */
+#define SLPD_STATS_OUTCOMES     6
+
+
+/*=========================================================================*/
+void SLPDStatsInit();
+/* Clears all of the counters                                              */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void SLPDStatsMessage(int functionid, int outcome, struct timeval* start);
+/* Counts a processed message and adds the time since start to the latency */
+/* histogram of its function id and outcome                                */
+/*                                                                         */
+/* functionid (IN) SLP function id of the message, anything unknown is     */
+/*                 counted together                                        */
+/*                                                                         */
+/* outcome    (IN) one of the SLPD_STATS_ values above                     */
+/*                                                                         */
+/* start      (IN) when processing of the message started                  */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+SLPBuffer SLPDStatsReport();
+/* Describes the counters, the size of the database and the sockets in     */
+/* plain text.  Latencies are given as percentiles in microseconds.        */
+/*                                                                         */
+/* Returns  - a buffer holding the text between start and end, or NULL if  */
+/*            out of memory.  The caller frees it                          */
+/*=========================================================================*/
+
+
+#endif
@@ -60,7 +60,10 @@
 #include <sys/types.h>
 #include <sys/utsname.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <netinet/in.h>
 #include <arpa/inet.h> 
 #include <ctype.h>   
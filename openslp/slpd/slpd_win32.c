@@ -60,6 +60,7 @@
 #include "slpd_incoming.h"
 #include "slpd_outgoing.h"
 #include "slpd_knownda.h"
+#include "slpd_stats.h"
 
 
 /*=========================================================================*/
@@ -301,6 +302,9 @@ void ServiceStart (int argc, char **argv)
     /*--------------------------------------------------*/
     /* Initialize for the first time                    */
     /*--------------------------------------------------*/
+    SLPBufferPoolSetLimit(SLPD_POOL_LIMIT);
+    SLPMessagePoolSetLimit(SLPD_POOL_LIMIT);
+    SLPDStatsInit();
     if(SLPDPropertyInit(G_SlpdCommandLine.cfgfile) ||
        SLPDDatabaseInit(G_SlpdCommandLine.regfile) ||
        SLPDIncomingInit() ||
@@ -51,6 +51,10 @@ int strncasecmp(const char *s1, const char *s2, size_t len);
 # ifndef HAVE_STRCASECMP
 int strcasecmp(const char *s1, const char *s2);
 # endif
+# include <unistd.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include "slp_message.h"
 #endif 
 
 
@@ -532,6 +536,43 @@ void PrintVersion(SLPToolCommandLine* cmdline)
            SLPGetProperty("net.slp.OpenSLPConfigFile"));
 }
 
+#ifndef _WIN32
+/*=========================================================================*/
+void Stats(SLPToolCommandLine* cmdline)
+/*=========================================================================*/
+{
+    struct sockaddr_un  addr;
+    char                buf[1024];
+    int                 sock;
+    int                 bytes;
+
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path,SLP_STATS_SOCKET);
+
+    sock = socket(PF_UNIX,SOCK_STREAM,0);
+    if(sock < 0 ||
+       connect(sock,(struct sockaddr*)&addr,sizeof(addr)))
+    {
+        printf("could not connect to slpd on %s\n",
+               SLP_STATS_SOCKET);
+        if(sock >= 0)
+        {
+            close(sock);
+        }
+        return;
+    }
+
+    /* slpd closes the connection after the last of the report */
+    while((bytes = read(sock,buf,sizeof(buf))) > 0)
+    {
+        fwrite(buf,1,bytes,stdout);
+    }
+
+    close(sock);
+}
+#endif
+
 /*=========================================================================*/
 void GetProperty(SLPToolCommandLine* cmdline)
 /*=========================================================================*/  
@@ -903,6 +944,30 @@ int ParseCommandLine(int argc,char* argv[], SLPToolCommandLine* cmdline)
 	        return 1;
 	    }
 	}
+#ifndef _WIN32
+        else if(strcasecmp(argv[i],"stats") == 0)
+        {
+            cmdline->cmd = STATS;
+        }
+        else if(strcasecmp(argv[i],"bench") == 0)
+        {
+            cmdline->cmd = BENCH;
+            i++;
+            if(i < argc)
+            {
+                cmdline->cmdparam1 = argv[i];
+            }
+            else
+            {
+                return 1;
+            }
+
+            /* the rest are bench options */
+            cmdline->benchargc = argc - i - 1;
+            cmdline->benchargv = argv + i + 1;
+            break;
+        }
+#endif
         else
         {
             return 1;
@@ -948,6 +1013,12 @@ void DisplayUsage()
     printf("      register url [attrs]\n");
     printf("      deregister url\n");
     printf("      getproperty propertyname\n");
+#ifndef _WIN32
+    printf("      stats\n");
+    printf("      bench srvrqst|attrrqst|srvtyperqst [option=value ...]\n");
+    printf("         transport=udp|tcp|multicast  services=count  attrsize=bytes\n");
+    printf("         rate=per-second|concurrency=count  seconds=count  target=ip-address\n");
+#endif
     printf("Examples:\n");
     printf("   slptool register service:myserv.x://myhost.com \"(attr1=val1),(attr2=val2)\"\n");
     printf("   slptool findsrvs service:myserv.x\n");
@@ -972,6 +1043,9 @@ void DisplayUsage()
 #endif /* MI_NOT_SUPPORTED */
     printf("   slptool deregister service:myserv.x://myhost.com\n");
     printf("   slptool getproperty net.slp.useScopes\n");
+#ifndef _WIN32
+    printf("   slptool bench srvrqst transport=tcp services=1000 concurrency=8\n");
+#endif
 }
 
 
@@ -1054,6 +1128,16 @@ int main(int argc, char* argv[])
 	    PrintVersion(&cmdline);
 	    break;
 
+#ifndef _WIN32
+        case STATS:
+            Stats(&cmdline);
+            break;
+
+        case BENCH:
+            Bench(&cmdline);
+            break;
+#endif
+
 	 case DUMMY:
 	    break;
         }
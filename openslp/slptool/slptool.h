@@ -62,6 +62,10 @@ typedef enum _SLPToolCommand
     UNICASTFINDSRVS,
     UNICASTFINDATTRS,
     UNICASTFINDSRVTYPES,
+#endif
+#ifndef _WIN32
+    STATS,
+    BENCH,
 #endif
     DUMMY
 }SLPToolCommand;
@@ -78,6 +82,8 @@ typedef struct _SLPToolCommandLine
     const char*     cmdparam1;
     const char*     cmdparam2;
     const char*     cmdparam3;
+    int             benchargc;
+    char**          benchargv;  /* the options after bench and workload */
 }SLPToolCommandLine;
 
 
@@ -152,4 +158,20 @@ void Register(SLPToolCommandLine* cmdline);
 void Deregister(SLPToolCommandLine* cmdline);
 /*=========================================================================*/
 
+
+#ifndef _WIN32
+/*=========================================================================*/
+void Stats(SLPToolCommandLine* cmdline);
+/* Prints the counters slpd keeps                                          */
+/*=========================================================================*/
+
+
+/*=========================================================================*/
+void Bench(SLPToolCommandLine* cmdline);
+/* Registers synthetic services with slpd, sends it requests for them at a */
+/* rate or with a number in flight, and prints throughput and latency      */
+/* percentiles.  See slptool_bench.c                                       */
+/*=========================================================================*/
+#endif
+
 #endif
@@ -0,0 +1,928 @@
+/***************************************************************************/
+/*                                                                         */
+/* Project:     OpenSLP command line UA wrapper                            */
+/*                                                                         */
+/* File:        slptool_bench.c                                            */
+/*                                                                         */
+/* Abstract:    Load generator for slpd: registers synthetic services and  */
+/*              drives requests at them over UDP, TCP or multicast         */
+/*                                                                         */
+/* Requires:    OpenSLP installation                                       */
+/*                                                                         */
+/*                                                                         */
+/* Copyright (c) 1995, 1999  Caldera Systems, Inc.                         */
+/*                                                                         */
+/* This program is free software; you can redistribute it and/or modify it */
+/* under the terms of the GNU Lesser General Public License as published   */
+/* by the Free Software Foundation; either version 2.1 of the License, or  */
+/* (at your option) any later version.                                     */
+/*                                                                         */
+/*     This program is distributed in the hope that it will be useful,     */
+/*     but WITHOUT ANY WARRANTY; without even the implied warranty of      */
+/*     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the       */
+/*     GNU Lesser General Public License for more details.                 */
+/*                                                                         */
+/*     You should have received a copy of the GNU Lesser General Public    */
+/*     License along with this program; see the file COPYING.  If not,     */
+/*     please obtain a copy from http://www.gnu.org/copyleft/lesser.html   */
+/*                                                                         */
+/*-------------------------------------------------------------------------*/
+/*                                                                         */
+/*     Please submit patches to maintainer of http://www.openslp.org       */
+/*                                                                         */
+/***************************************************************************/
+
+#include "slptool.h"
+
+#ifndef _WIN32
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "slp_message.h"
+#include "slp_histogram.h"
+
+
+/*=========================================================================*/
+/* Bench constants                                                         */
+/*=========================================================================*/
+#define BENCH_UDP               0
+#define BENCH_TCP               1
+#define BENCH_MULTICAST         2
+#define BENCH_SRVTYPE           "service:slptool-bench"
+#define BENCH_TIMEOUT           2000000 /* usecs before a request is lost */
+#define BENCH_XIDS              65536
+#define BENCH_MAX_CONNS         256
+#define BENCH_MAX_REQUEST       512
+#define BENCH_RECVBUF           65536   /* grown for bigger TCP replies   */
+
+
+/*=========================================================================*/
+typedef struct _SLPToolBenchConn
+/* A TCP connection to slpd, or the one UDP socket                         */
+/*=========================================================================*/
+{
+    int             fd;
+    int             busy;       /* requests sent but not answered */
+    int             buffered;
+    int             allocated;
+    char*           recvbuf;
+}SLPToolBenchConn;
+
+
+/*=========================================================================*/
+typedef struct _SLPToolBench
+/*=========================================================================*/
+{
+    /* what to run */
+    int                 functionid;
+    int                 transport;
+    int                 services;
+    int                 attrsize;
+    int                 rate;       /* requests per second, 0 closed loop */
+    int                 concurrency;
+    int                 seconds;
+    struct sockaddr_in  peeraddr;
+    const char*         lang;
+    const char*         scopes;
+
+    /* connections */
+    int                 conncount;
+    int                 nextconn;   /* round robin for rate mode */
+    SLPToolBenchConn*   conns;
+
+    /* requests in flight, indexed by xid */
+    struct timeval      sent[BENCH_XIDS];
+    unsigned char       pending[BENCH_XIDS];
+    unsigned char       connof[BENCH_XIDS];
+    unsigned short      order[BENCH_XIDS];  /* xids in the order sent */
+    int                 orderhead;
+    int                 outstanding;
+    unsigned short      xid;
+    int                 next;               /* service to ask about next */
+
+    /* results */
+    unsigned long       requests;
+    unsigned long       errors;
+    unsigned long       truncated;
+    unsigned long       lost;
+    unsigned long       skipped;
+    SLPHistogram        answered;   /* latencies of the answers */
+}SLPToolBench;
+
+
+/*-------------------------------------------------------------------------*/
+static long BenchElapsed(struct timeval* from, struct timeval* to)
+/* Returns the microseconds from from to to                                */
+/*-------------------------------------------------------------------------*/
+{
+    return (to->tv_sec - from->tv_sec) * 1000000 +
+           (to->tv_usec - from->tv_usec);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static char* BenchPutString(char* cur, const char* str)
+/*-------------------------------------------------------------------------*/
+{
+    int len = strlen(str);
+
+    ToUINT16(cur,len);
+    memcpy(cur + 2,str,len);
+
+    return cur + 2 + len;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int BenchBuildRequest(SLPToolBench* bench, char* buf)
+/* Builds the next request of the workload with xid bench->xid             */
+/*                                                                         */
+/* Returns  the length of the request                                      */
+/*-------------------------------------------------------------------------*/
+{
+    char    str[80];
+    char*   cur;
+    int     langlen;
+    int     flags;
+
+    langlen = strlen(bench->lang);
+    cur = buf + 14 + langlen;
+
+    /* the prlist is always empty */
+    ToUINT16(cur,0);
+    cur += 2;
+
+    switch(bench->functionid)
+    {
+    case SLP_FUNCT_SRVRQST:
+        /* ask for one of the services, by attribute */
+        cur = BenchPutString(cur,BENCH_SRVTYPE);
+        cur = BenchPutString(cur,bench->scopes);
+        sprintf(str,"(id=%d)",bench->next);
+        cur = BenchPutString(cur,str);
+        cur = BenchPutString(cur,"");
+        break;
+
+    case SLP_FUNCT_ATTRRQST:
+        sprintf(str,"%s://bench%d.localhost",BENCH_SRVTYPE,bench->next);
+        cur = BenchPutString(cur,str);
+        cur = BenchPutString(cur,bench->scopes);
+        cur = BenchPutString(cur,"");
+        cur = BenchPutString(cur,"");
+        break;
+
+    case SLP_FUNCT_SRVTYPERQST:
+        /* 0xffff asks for the types of all naming authorities */
+        ToUINT16(cur,0xffff);
+        cur += 2;
+        cur = BenchPutString(cur,bench->scopes);
+        break;
+    }
+
+    bench->next = (bench->next + 1) % bench->services;
+
+    flags = bench->transport == BENCH_MULTICAST ? SLP_FLAG_MCAST : 0;
+    buf[0] = 2;
+    buf[1] = bench->functionid;
+    ToUINT24(buf + 2,cur - buf);
+    ToUINT16(buf + 5,flags);
+    ToUINT24(buf + 7,0);
+    ToUINT16(buf + 10,bench->xid);
+    ToUINT16(buf + 12,langlen);
+    memcpy(buf + 14,bench->lang,langlen);
+
+    return cur - buf;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int BenchConnect(SLPToolBench* bench)
+/* Opens the UDP socket or the TCP connections                             */
+/*                                                                         */
+/* Returns  Zero on success.  Non-zero on error.                           */
+/*-------------------------------------------------------------------------*/
+{
+    SLPToolBenchConn*   conn;
+    struct in_addr      ifaddr;
+    unsigned char       loop;
+    int                 i;
+
+    bench->conncount = 1;
+    if(bench->transport == BENCH_TCP)
+    {
+        bench->conncount = bench->concurrency;
+    }
+
+    bench->conns = (SLPToolBenchConn*)calloc(bench->conncount,
+                                             sizeof(SLPToolBenchConn));
+    if(bench->conns == 0)
+    {
+        return 1;
+    }
+
+    for(i = 0; i < bench->conncount; i++)
+    {
+        bench->conns[i].fd = -1;
+        bench->conns[i].allocated = BENCH_RECVBUF;
+        bench->conns[i].recvbuf = (char*)malloc(BENCH_RECVBUF);
+        if(bench->conns[i].recvbuf == 0)
+        {
+            return 1;
+        }
+    }
+
+    for(i = 0; i < bench->conncount; i++)
+    {
+        conn = &(bench->conns[i]);
+        if(bench->transport == BENCH_TCP)
+        {
+            conn->fd = socket(PF_INET,SOCK_STREAM,0);
+            if(conn->fd < 0 ||
+               connect(conn->fd,
+                       (struct sockaddr*)&(bench->peeraddr),
+                       sizeof(bench->peeraddr)))
+            {
+                return 1;
+            }
+        }
+        else
+        {
+            conn->fd = socket(PF_INET,SOCK_DGRAM,0);
+            if(conn->fd < 0)
+            {
+                return 1;
+            }
+            if(bench->transport == BENCH_MULTICAST)
+            {
+                /* stay on the loopback and hear ourselves */
+                ifaddr.s_addr = htonl(LOOPBACK_ADDRESS);
+                loop = 1;
+                setsockopt(conn->fd,IPPROTO_IP,IP_MULTICAST_IF,
+                           &ifaddr,sizeof(ifaddr));
+                setsockopt(conn->fd,IPPROTO_IP,IP_MULTICAST_LOOP,
+                           &loop,sizeof(loop));
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void BenchSend(SLPToolBench* bench, int connindex)
+/* Sends the next request on a connection                                  */
+/*-------------------------------------------------------------------------*/
+{
+    SLPToolBenchConn*   conn = &(bench->conns[connindex]);
+    char                buf[BENCH_MAX_REQUEST];
+    int                 len;
+    int                 sent;
+
+    if(bench->pending[bench->xid] || bench->outstanding == BENCH_XIDS)
+    {
+        /* 65536 requests are already being waited for */
+        bench->skipped++;
+        return;
+    }
+
+    len = BenchBuildRequest(bench,buf);
+    if(bench->transport == BENCH_TCP)
+    {
+        sent = send(conn->fd,buf,len,0);
+    }
+    else
+    {
+        sent = sendto(conn->fd,buf,len,0,
+                      (struct sockaddr*)&(bench->peeraddr),
+                      sizeof(bench->peeraddr));
+    }
+    if(sent != len)
+    {
+        bench->skipped++;
+        return;
+    }
+
+    gettimeofday(&(bench->sent[bench->xid]),0);
+    bench->pending[bench->xid] = 1;
+    bench->connof[bench->xid] = connindex;
+    bench->order[(bench->orderhead + bench->outstanding) % BENCH_XIDS] =
+        bench->xid;
+    bench->outstanding++;
+    bench->requests++;
+    conn->busy++;
+    bench->xid++;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void BenchReply(SLPToolBench* bench, char* msg, int len)
+/* Matches a reply to its request and counts it                            */
+/*-------------------------------------------------------------------------*/
+{
+    struct timeval  now;
+    unsigned short  xid;
+    unsigned long   usecs;
+    int             langtaglen;
+    int             errorcode;
+
+    if(len < 16 || msg[0] != 2)
+    {
+        return;
+    }
+
+    /* later replies to a multicast request are not counted */
+    xid = AsUINT16(msg + 10);
+    if(bench->pending[xid] == 0)
+    {
+        return;
+    }
+
+    gettimeofday(&now,0);
+    usecs = BenchElapsed(&(bench->sent[xid]),&now);
+    bench->pending[xid] = 0;
+    bench->conns[bench->connof[xid]].busy--;
+
+    if(AsUINT16(msg + 5) & SLP_FLAG_OVERFLOW)
+    {
+        bench->truncated++;
+    }
+
+    /* all of the replies start with an error code, after the lang tag */
+    langtaglen = AsUINT16(msg + 12);
+    if(16 + langtaglen > len)
+    {
+        bench->errors++;
+        return;
+    }
+    errorcode = AsUINT16(msg + 14 + langtaglen);
+    if(errorcode)
+    {
+        bench->errors++;
+        return;
+    }
+
+    SLPHistogramAdd(&(bench->answered),usecs);
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void BenchRead(SLPToolBench* bench, SLPToolBenchConn* conn)
+/* Reads what has arrived on a connection and handles the replies in it    */
+/*-------------------------------------------------------------------------*/
+{
+    char*   buf;
+    int     bytes;
+    int     msglen;
+    int     done;
+
+    if(bench->transport != BENCH_TCP)
+    {
+        bytes = recv(conn->fd,conn->recvbuf,conn->allocated,0);
+        if(bytes > 0)
+        {
+            BenchReply(bench,conn->recvbuf,bytes);
+        }
+        return;
+    }
+
+    bytes = recv(conn->fd,
+                 conn->recvbuf + conn->buffered,
+                 conn->allocated - conn->buffered,
+                 0);
+    if(bytes <= 0)
+    {
+        /* slpd closed the connection, what is on it will be lost */
+        close(conn->fd);
+        conn->fd = -1;
+        return;
+    }
+    conn->buffered += bytes;
+
+    /* a stream may hold several replies and part of the next */
+    done = 0;
+    msglen = 0;
+    while(conn->buffered - done >= 5)
+    {
+        msglen = AsUINT24(conn->recvbuf + done + 2);
+        if(msglen < 5)
+        {
+            close(conn->fd);
+            conn->fd = -1;
+            return;
+        }
+        if(msglen > conn->buffered - done)
+        {
+            break;
+        }
+        BenchReply(bench,conn->recvbuf + done,msglen);
+        done += msglen;
+    }
+    memmove(conn->recvbuf,conn->recvbuf + done,conn->buffered - done);
+    conn->buffered -= done;
+
+    /* make room for all of a reply bigger than the buffer */
+    if(msglen > conn->allocated)
+    {
+        buf = (char*)realloc(conn->recvbuf,msglen);
+        if(buf == 0)
+        {
+            close(conn->fd);
+            conn->fd = -1;
+            return;
+        }
+        conn->recvbuf = buf;
+        conn->allocated = msglen;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void BenchExpire(SLPToolBench* bench, struct timeval* now)
+/* Forgets the answered requests at the front of the send order, and the   */
+/* ones that have waited longer than BENCH_TIMEOUT                         */
+/*-------------------------------------------------------------------------*/
+{
+    unsigned short xid;
+
+    while(bench->outstanding)
+    {
+        xid = bench->order[bench->orderhead];
+        if(bench->pending[xid])
+        {
+            if(BenchElapsed(&(bench->sent[xid]),now) < BENCH_TIMEOUT)
+            {
+                break;
+            }
+            bench->pending[xid] = 0;
+            bench->conns[bench->connof[xid]].busy--;
+            bench->lost++;
+        }
+        bench->orderhead = (bench->orderhead + 1) % BENCH_XIDS;
+        bench->outstanding--;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int BenchInFlight(SLPToolBench* bench)
+/* Returns the number of requests sent but not yet answered or lost        */
+/*-------------------------------------------------------------------------*/
+{
+    int inflight = 0;
+    int i;
+
+    for(i = 0; i < bench->conncount; i++)
+    {
+        inflight += bench->conns[i].busy;
+    }
+
+    return inflight;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static void BenchRun(SLPToolBench* bench)
+/* Drives requests for bench->seconds, then waits for the last answers     */
+/*-------------------------------------------------------------------------*/
+{
+    struct timeval  start;
+    struct timeval  now;
+    struct timeval  timeout;
+    fd_set          readfds;
+    double          interval = 0;
+    double          due = 0;
+    long            elapsed;
+    long            wait;
+    int             highfd;
+    int             sending;
+    int             i;
+
+    if(bench->rate)
+    {
+        interval = 1000000.0 / bench->rate;
+    }
+
+    gettimeofday(&start,0);
+    now = start;
+    sending = 1;
+    while(1)
+    {
+        elapsed = BenchElapsed(&start,&now);
+        if(sending && elapsed >= bench->seconds * 1000000L)
+        {
+            sending = 0;
+        }
+
+        BenchExpire(bench,&now);
+        if(sending == 0 && BenchInFlight(bench) == 0)
+        {
+            break;
+        }
+
+        /*--------------------------------------------------------*/
+        /* Send what is due: at the rate asked for, or enough to  */
+        /* keep concurrency requests in flight                    */
+        /*--------------------------------------------------------*/
+        wait = 100000;
+        if(sending)
+        {
+            if(bench->rate)
+            {
+                while(due <= elapsed)
+                {
+                    BenchSend(bench,bench->nextconn);
+                    bench->nextconn = (bench->nextconn + 1) % bench->conncount;
+                    due += interval;
+                }
+                if(due - elapsed < wait)
+                {
+                    wait = (long)(due - elapsed);
+                }
+            }
+            else if(bench->transport == BENCH_TCP)
+            {
+                for(i = 0; i < bench->conncount; i++)
+                {
+                    if(bench->conns[i].busy == 0 && bench->conns[i].fd >= 0)
+                    {
+                        BenchSend(bench,i);
+                    }
+                }
+            }
+            else
+            {
+                for(i = bench->conns[0].busy; i < bench->concurrency; i++)
+                {
+                    BenchSend(bench,0);
+                }
+            }
+        }
+
+        /*------------------------*/
+        /* Wait for the answers   */
+        /*------------------------*/
+        FD_ZERO(&readfds);
+        highfd = -1;
+        for(i = 0; i < bench->conncount; i++)
+        {
+            if(bench->conns[i].fd >= 0)
+            {
+                FD_SET(bench->conns[i].fd,&readfds);
+                if(bench->conns[i].fd > highfd)
+                {
+                    highfd = bench->conns[i].fd;
+                }
+            }
+        }
+        if(highfd < 0)
+        {
+            printf("lost all connections to slpd\n");
+            break;
+        }
+
+        timeout.tv_sec = 0;
+        timeout.tv_usec = wait;
+        if(select(highfd + 1,&readfds,0,0,&timeout) > 0)
+        {
+            for(i = 0; i < bench->conncount; i++)
+            {
+                if(bench->conns[i].fd >= 0 &&
+                   FD_ISSET(bench->conns[i].fd,&readfds))
+                {
+                    BenchRead(bench,&(bench->conns[i]));
+                }
+            }
+        }
+
+        gettimeofday(&now,0);
+    }
+
+    elapsed = BenchElapsed(&start,&now);
+    if(elapsed <= 0)
+    {
+        elapsed = 1;
+    }
+
+    /*----------------*/
+    /* Report results */
+    /*----------------*/
+    printf("requests: %lu sent, %lu answered, %lu errors, %lu lost",
+           bench->requests, bench->answered.count, bench->errors,
+           bench->lost);
+    if(bench->truncated)
+    {
+        printf(", %lu truncated", bench->truncated);
+    }
+    if(bench->skipped)
+    {
+        printf(", %lu not sent", bench->skipped);
+    }
+    printf("\nthroughput: %.1f answers per second\n",
+           bench->answered.count * 1000000.0 / elapsed);
+    if(bench->answered.count)
+    {
+        printf("latency (microseconds): mean %lu, p50 %lu, p90 %lu, "
+               "p99 %lu, p99.9 %lu, max %lu\n",
+               (unsigned long)(bench->answered.total /
+                               bench->answered.count),
+               SLPHistogramPercentile(&(bench->answered),500),
+               SLPHistogramPercentile(&(bench->answered),900),
+               SLPHistogramPercentile(&(bench->answered),990),
+               SLPHistogramPercentile(&(bench->answered),999),
+               bench->answered.max);
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+void myBenchRegReport(SLPHandle hslp, int item, SLPError errcode, void* cookie)
+/*-------------------------------------------------------------------------*/
+{
+    if(errcode)
+    {
+        *(int*)cookie += 1;
+    }
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int BenchRegister(SLPToolBench* bench, SLPHandle hslp, int dereg)
+/* Registers, or deregisters, the synthetic services with slpd             */
+/*                                                                         */
+/* Returns  Zero on success.  Non-zero on error.                           */
+/*-------------------------------------------------------------------------*/
+{
+    SLPRegItem*     items;
+    char*           strings;
+    char*           url;
+    char*           attrs;
+    struct timeval  start;
+    struct timeval  end;
+    SLPError        result;
+    int             failed = 0;
+    int             size;
+    int             len;
+    int             i;
+
+    /* every service gets its own URL and attribute list */
+    size = 64 + 32 + bench->attrsize;
+    items = (SLPRegItem*)calloc(bench->services,sizeof(SLPRegItem));
+    strings = (char*)malloc(bench->services * size);
+    if(items == 0 || strings == 0)
+    {
+        free(items);
+        free(strings);
+        return 1;
+    }
+
+    for(i = 0; i < bench->services; i++)
+    {
+        url = strings + i * size;
+        attrs = url + 64;
+        sprintf(url,"%s://bench%d.localhost",BENCH_SRVTYPE,i);
+        len = sprintf(attrs,"(id=%d),(data=",i);
+        memset(attrs + len,'x',bench->attrsize);
+        strcpy(attrs + len + bench->attrsize,")");
+        items[i].s_pcSrvURL = url;
+        items[i].s_pcAttrs = attrs;
+        items[i].s_usLifetime = SLP_LIFETIME_DEFAULT;
+    }
+
+    gettimeofday(&start,0);
+    if(dereg)
+    {
+        result = SLPDeregBatch(hslp,items,bench->services,
+                               myBenchRegReport,&failed);
+    }
+    else
+    {
+        result = SLPRegBatch(hslp,items,bench->services,SLP_TRUE,
+                             myBenchRegReport,&failed);
+    }
+    gettimeofday(&end,0);
+
+    free(items);
+    free(strings);
+
+    if(result != SLP_OK && failed == 0)
+    {
+        failed = bench->services;
+    }
+    printf("%s %d services in %ld ms, %d failed\n",
+           dereg ? "deregistered" : "registered",
+           bench->services - failed,
+           BenchElapsed(&start,&end) / 1000,
+           failed);
+
+    return failed != 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+static int BenchParseOption(SLPToolBench* bench, const char* option)
+/* Returns  Zero on success.  Non-zero on error.                           */
+/*-------------------------------------------------------------------------*/
+{
+    const char* value;
+
+    value = strchr(option,'=');
+    if(value == 0)
+    {
+        return 1;
+    }
+    value++;
+
+    if(strncasecmp(option,"transport=",10) == 0)
+    {
+        if(strcasecmp(value,"udp") == 0)
+        {
+            bench->transport = BENCH_UDP;
+        }
+        else if(strcasecmp(value,"tcp") == 0)
+        {
+            bench->transport = BENCH_TCP;
+        }
+        else if(strcasecmp(value,"multicast") == 0)
+        {
+            bench->transport = BENCH_MULTICAST;
+        }
+        else
+        {
+            return 1;
+        }
+    }
+    else if(strncasecmp(option,"services=",9) == 0)
+    {
+        bench->services = atoi(value);
+    }
+    else if(strncasecmp(option,"attrsize=",9) == 0)
+    {
+        bench->attrsize = atoi(value);
+    }
+    else if(strncasecmp(option,"rate=",5) == 0)
+    {
+        bench->rate = atoi(value);
+    }
+    else if(strncasecmp(option,"concurrency=",12) == 0)
+    {
+        bench->concurrency = atoi(value);
+    }
+    else if(strncasecmp(option,"seconds=",8) == 0)
+    {
+        bench->seconds = atoi(value);
+    }
+    else if(strncasecmp(option,"target=",7) == 0)
+    {
+        if(inet_aton(value,&(bench->peeraddr.sin_addr)) == 0)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*=========================================================================*/
+void Bench(SLPToolCommandLine* cmdline)
+/*=========================================================================*/
+{
+    SLPToolBench*   bench;
+    SLPHandle       hslp;
+    int             i;
+
+    bench = (SLPToolBench*)calloc(1,sizeof(SLPToolBench));
+    if(bench == 0)
+    {
+        printf("out of memory\n");
+        return;
+    }
+
+    /*--------------------------------------*/
+    /* Defaults, then the command line      */
+    /*--------------------------------------*/
+    if(strcasecmp(cmdline->cmdparam1,"srvrqst") == 0)
+    {
+        bench->functionid = SLP_FUNCT_SRVRQST;
+    }
+    else if(strcasecmp(cmdline->cmdparam1,"attrrqst") == 0)
+    {
+        bench->functionid = SLP_FUNCT_ATTRRQST;
+    }
+    else if(strcasecmp(cmdline->cmdparam1,"srvtyperqst") == 0)
+    {
+        bench->functionid = SLP_FUNCT_SRVTYPERQST;
+    }
+    bench->transport = BENCH_UDP;
+    bench->services = 100;
+    bench->attrsize = 32;
+    bench->concurrency = 1;
+    bench->seconds = 10;
+    bench->peeraddr.sin_family = AF_INET;
+    bench->peeraddr.sin_port = htons(SLP_RESERVED_PORT);
+    bench->peeraddr.sin_addr.s_addr = htonl(LOOPBACK_ADDRESS);
+    for(i = 0; i < cmdline->benchargc; i++)
+    {
+        if(BenchParseOption(bench,cmdline->benchargv[i]))
+        {
+            printf("Invalid bench option: %s\n",cmdline->benchargv[i]);
+            free(bench);
+            return;
+        }
+    }
+    if(bench->functionid == 0 ||
+       bench->services < 1 ||
+       bench->attrsize < 0 ||
+       bench->attrsize > 65000 ||
+       bench->rate < 0 ||
+       bench->concurrency < 1 ||
+       bench->concurrency > BENCH_MAX_CONNS ||
+       bench->seconds < 1)
+    {
+        printf("Invalid bench parameters\n");
+        free(bench);
+        return;
+    }
+    if(bench->transport == BENCH_MULTICAST)
+    {
+        bench->peeraddr.sin_addr.s_addr = htonl(SLP_MCAST_ADDRESS);
+    }
+
+    if(cmdline->scopes)
+    {
+        SLPSetProperty("net.slp.useScopes",cmdline->scopes);
+    }
+    bench->scopes = SLPGetProperty("net.slp.useScopes");
+    bench->lang = cmdline->lang ? cmdline->lang : "en";
+    if(bench->scopes == 0 ||
+       strlen(bench->scopes) > BENCH_MAX_REQUEST / 2 ||
+       strlen(bench->lang) > 64)
+    {
+        printf("Invalid scopes or language\n");
+        free(bench);
+        return;
+    }
+
+    if(SLPOpen(bench->lang,SLP_FALSE,&hslp) != SLP_OK)
+    {
+        printf("Could not open an SLP handle\n");
+        free(bench);
+        return;
+    }
+
+    /*-------------------------------------------------*/
+    /* Register the services, load slpd, clean up      */
+    /*-------------------------------------------------*/
+    if(BenchRegister(bench,hslp,0) == 0)
+    {
+        if(BenchConnect(bench) == 0)
+        {
+            printf("%s over %s to %s, %s %d, %d seconds\n",
+                   cmdline->cmdparam1,
+                   bench->transport == BENCH_TCP ? "tcp" :
+                   bench->transport == BENCH_UDP ? "udp" : "multicast",
+                   inet_ntoa(bench->peeraddr.sin_addr),
+                   bench->rate ? "rate" : "concurrency",
+                   bench->rate ? bench->rate : bench->concurrency,
+                   bench->seconds);
+            BenchRun(bench);
+        }
+        else
+        {
+            printf("Could not reach slpd at %s: %s\n",
+                   inet_ntoa(bench->peeraddr.sin_addr),
+                   strerror(errno));
+        }
+    }
+    BenchRegister(bench,hslp,1);
+
+    if(bench->conns)
+    {
+        for(i = 0; i < bench->conncount; i++)
+        {
+            if(bench->conns[i].fd >= 0)
+            {
+                close(bench->conns[i].fd);
+            }
+            free(bench->conns[i].recvbuf);
+        }
+        free(bench->conns);
+    }
+    SLPClose(hslp);
+    free(bench);
+}
+
+#endif
@@ -0,0 +1,220 @@
+/****************************************************************************/
+/* Test for async handles: SLPFindSrvs() answered on the I/O thread,        */
+/* SLPClose() from inside the callback and SLPClose() from another thread   */
+/* while a call is still waiting for multicast replies.                     */
+/****************************************************************************/
+#include <slp.h>
+#include <slp_debug.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+typedef struct {
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;
+	int		print;		/* print the URLs found */
+	int		closeinside;	/* SLPClose() from the first callback */
+	int		closed;		/* SLPClose() has returned */
+	int		urls;
+	int		lastcalls;
+	int		errors;
+	int		late;		/* callbacks after SLPClose() returned */
+} AsyncState;
+
+static void state_init(AsyncState *state)
+{
+	memset(state, 0, sizeof(*state));
+	pthread_mutex_init(&state->lock, 0);
+	pthread_cond_init(&state->cond, 0);
+}
+
+/* Waits up to seconds for *count to reach want. */
+static void state_wait(AsyncState *state, int *count, int want, int seconds)
+{
+	struct timeval	now;
+	struct timespec	deadline;
+
+	gettimeofday(&now, 0);
+	deadline.tv_sec = now.tv_sec + seconds;
+	deadline.tv_nsec = now.tv_usec * 1000;
+
+	pthread_mutex_lock(&state->lock);
+	while (*count < want) {
+		if (pthread_cond_timedwait(&state->cond, &state->lock, &deadline))
+			break;
+	}
+	pthread_mutex_unlock(&state->lock);
+}
+
+SLPBoolean
+MySLPSrvURLCallback (SLPHandle hslp,
+		     const char *srvurl,
+		     unsigned short lifetime, SLPError errcode, void *cookie)
+{
+	AsyncState	*state = (AsyncState *) cookie;
+	int		closeinside;
+
+	pthread_mutex_lock(&state->lock);
+	if (state->closed)
+		state->late++;
+	switch(errcode) {
+		case SLP_OK:
+			state->urls++;
+			if (state->print)
+				printf ("Service URL     = %s\n", srvurl);
+			break;
+		case SLP_LAST_CALL:
+			state->lastcalls++;
+			break;
+		default:
+			state->errors++;
+			break;
+	} /* End switch. */
+	closeinside = state->closeinside && errcode == SLP_OK;
+	pthread_cond_broadcast(&state->cond);
+	pthread_mutex_unlock(&state->lock);
+
+	if (closeinside) {
+		/* finishes once this callback has returned */
+		SLPClose(hslp);
+		pthread_mutex_lock(&state->lock);
+		state->closed = 1;
+		pthread_mutex_unlock(&state->lock);
+	}
+
+	/* keep going, it is SLPClose() that has to stop the call */
+	return SLP_TRUE;
+}
+
+static SLPHandle open_async(void)
+{
+	SLPError	err;
+	SLPHandle	hslp;
+
+	err = SLPOpen("en", SLP_TRUE, &hslp);
+	if (err == SLP_NOT_IMPLEMENTED) {
+		printf("async API not compiled in\n");
+		exit(77);
+	}
+	check_error_state(err, "Error opening async slp handle.");
+
+	return hslp;
+}
+
+/* Finds the registered services and waits for the SLP_LAST_CALL. */
+static void test_findsrvs(void)
+{
+	AsyncState	state;
+	SLPHandle	hslp;
+	SLPError	err;
+
+	state_init(&state);
+	state.print = 1;
+	hslp = open_async();
+
+	err = SLPFindSrvs(hslp, "service:test", 0, 0,
+			  MySLPSrvURLCallback, &state);
+	check_error_state(err, "Error starting async SLPFindSrvs.");
+
+	state_wait(&state, &state.lastcalls, 1, 30);
+	printf("async SLPFindSrvs: %d URLs, %d SLP_LAST_CALL, %d errors\n",
+	       state.urls, state.lastcalls, state.errors);
+
+	SLPClose(hslp);
+}
+
+/* Closes the handle from the callback for the first URL; no more
+ * callbacks may come. */
+static void test_close_in_callback(void)
+{
+	AsyncState	state;
+	SLPHandle	hslp;
+	SLPError	err;
+
+	state_init(&state);
+	state.closeinside = 1;
+	hslp = open_async();
+
+	err = SLPFindSrvs(hslp, "service:test", 0, 0,
+			  MySLPSrvURLCallback, &state);
+	check_error_state(err, "Error starting async SLPFindSrvs.");
+
+	state_wait(&state, &state.closed, 1, 30);
+	usleep(500000);
+
+	pthread_mutex_lock(&state.lock);
+	printf("SLPClose from the callback: %d callback, %d after it\n",
+	       state.urls + state.lastcalls + state.errors, state.late);
+	pthread_mutex_unlock(&state.lock);
+}
+
+typedef struct {
+	SLPHandle	hslp;
+	AsyncState	*state;
+	int		inflight;	/* the call had not ended at SLPClose() */
+} CloseArgs;
+
+static void *close_thread(void *arg)
+{
+	CloseArgs	*args = (CloseArgs *) arg;
+
+	usleep(500000);
+
+	pthread_mutex_lock(&args->state->lock);
+	args->inflight = (args->state->lastcalls == 0);
+	pthread_mutex_unlock(&args->state->lock);
+
+	SLPClose(args->hslp);
+
+	pthread_mutex_lock(&args->state->lock);
+	args->state->closed = 1;
+	pthread_mutex_unlock(&args->state->lock);
+
+	return 0;
+}
+
+/* Closes the handle from another thread while the call waits out the
+ * multicast convergence for a scope no DA serves. */
+static void test_close_in_flight(void)
+{
+	AsyncState	state;
+	CloseArgs	args;
+	pthread_t	closer;
+	SLPError	err;
+
+	state_init(&state);
+	args.hslp = open_async();
+	args.state = &state;
+	args.inflight = 0;
+
+	err = SLPFindSrvs(args.hslp, "service:test", "nowhere", 0,
+			  MySLPSrvURLCallback, &state);
+	check_error_state(err, "Error starting async SLPFindSrvs.");
+
+	pthread_create(&closer, 0, close_thread, &args);
+	pthread_join(closer, 0);
+	usleep(500000);
+
+	pthread_mutex_lock(&state.lock);
+	printf("SLPClose from another thread: %s, %d callbacks after it\n",
+	       args.inflight ? "call in flight" : "call already done",
+	       state.late);
+	pthread_mutex_unlock(&state.lock);
+}
+
+int
+main (int argc, char *argv[])
+{
+	/* the DA is slpd on this host, multicast waits are kept short */
+	SLPSetProperty("net.slp.DAAddresses", "127.0.0.1");
+	SLPSetProperty("net.slp.multicastMaximumWait", "5000");
+
+	test_findsrvs();
+	test_close_in_callback();
+	test_close_in_flight();
+
+	return(0);
+}
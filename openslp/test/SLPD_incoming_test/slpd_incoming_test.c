@@ -0,0 +1,386 @@
+/* Checks the pipelined reader of slpd's incoming stream connections: the
+ * messages of one read are framed and answered in order, partial and
+ * oversized messages wait for the rest, replies that do not fit in the
+ * socket are queued and written with writev() later, and a connection
+ * that sends something unframeable is closed.  SLPDProcessMessage() is
+ * stubbed out to answer each request with its xid.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "slpd_incoming.h"
+#include "slpd_log.h"
+#include "slpd_process.h"
+#include "slpd_property.h"
+#include "slpd_socket.h"
+#include "slpd_stats.h"
+
+#include <slp_xmalloc.h>
+#include <slp_test.h>
+
+void IncomingStreamRead(SLPList* socklist, SLPDSocket* sock);
+void IncomingStreamWrite(SLPList* socklist, SLPDSocket* sock);
+
+SLPDProperty G_SlpdProperty;
+
+static int  G_ReplySize = 32;   /* bytes in each reply */
+static int  G_Processed = 0;    /* requests answered   */
+
+/* Answers a request with a reply of G_ReplySize bytes carrying its xid */
+int SLPDProcessMessage(struct sockaddr_in* peerinfo,
+                       SLPBuffer recvbuf,
+                       SLPBuffer* sendbuf)
+{
+    SLPBuffer reply;
+
+    if(recvbuf->start[1] != SLP_FUNCT_SRVRQST)
+    {
+        return SLP_ERROR_PARSE_ERROR;
+    }
+
+    reply = SLPBufferRealloc(*sendbuf, G_ReplySize);
+    if(reply == NULL)
+    {
+        return SLP_ERROR_INTERNAL_ERROR;
+    }
+    memset(reply->start, 0, G_ReplySize);
+    reply->start[0] = 2;
+    reply->start[1] = SLP_FUNCT_SRVRPLY;
+    ToUINT24((char*)reply->start + 2, G_ReplySize);
+    memcpy(reply->start + 10, recvbuf->start + 10, 2);
+    reply->end = reply->start + G_ReplySize;
+    *sendbuf = reply;
+
+    G_Processed ++;
+    return 0;
+}
+
+void SLPDLog(const char* msg, ...)
+{
+}
+
+SLPBuffer SLPDStatsReport()
+{
+    return NULL;
+}
+
+SLPDSocket* SLPDSocketAlloc()
+{
+    return NULL;
+}
+
+void SLPDSocketFree(SLPDSocket* sock)
+{
+}
+
+SLPDSocket* SLPDSocketCreateListen(struct in_addr* peeraddr)
+{
+    return NULL;
+}
+
+SLPDSocket* SLPDSocketCreateLocalListen(const char* path)
+{
+    return NULL;
+}
+
+SLPDSocket* SLPDSocketCreateBoundDatagram(struct in_addr* myaddr,
+                                          struct in_addr* peeraddr,
+                                          int type)
+{
+    return NULL;
+}
+
+/* Makes the slpd end of a connected pair, the test writes to peer */
+static SLPDSocket* OpenStream(int* peer)
+{
+    SLPDSocket* sock;
+    int         fds[2];
+
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+    {
+        return NULL;
+    }
+    sock = (SLPDSocket*)xmalloc(sizeof(SLPDSocket));
+    memset(sock, 0, sizeof(SLPDSocket));
+    sock->fd = fds[0];
+    sock->state = STREAM_READ;
+    sock->recvbuf = SLPBufferAlloc(SLP_MAX_DATAGRAM_SIZE);
+    fcntl(sock->fd, F_SETFL, fcntl(sock->fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL, 0) | O_NONBLOCK);
+    *peer = fds[1];
+    return sock;
+}
+
+static void CloseStream(SLPDSocket* sock, int peer)
+{
+    SLPBuffer buf;
+
+    while(sock->sendlist.count)
+    {
+        buf = (SLPBuffer)SLPListUnlink(&(sock->sendlist),
+                                       sock->sendlist.head);
+        SLPBufferFree(buf);
+    }
+    SLPBufferFree(sock->recvbuf);
+    SLPBufferFree(sock->sendbuf);
+    close(sock->fd);
+    close(peer);
+    xfree(sock);
+}
+
+/* Returns non-zero if select() would report fd readable */
+static int Readable(int fd)
+{
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    return poll(&pfd, 1, 0) > 0;
+}
+
+/* Packs a SrvRqst of size bytes with the xid into msg */
+static int PackRqst(unsigned char* msg, int size, int xid)
+{
+    memset(msg, 0, size);
+    msg[0] = 2;
+    msg[1] = SLP_FUNCT_SRVRQST;
+    ToUINT24((char*)msg + 2, size);
+    ToUINT16((char*)msg + 10, xid);
+    return size;
+}
+
+/* Reads the replies waiting on peer and checks their xids run from   */
+/* *xid on.  Returns how many were read                               */
+static int ReadReplies(int peer, int* xid)
+{
+    static unsigned char    replies[65536];
+    static int              held = 0;
+    int                     bytes;
+    int                     count = 0;
+
+    while((bytes = recv(peer, replies + held, sizeof(replies) - held, 0)) > 0)
+    {
+        held += bytes;
+        while(held >= G_ReplySize)
+        {
+            if(AsUINT24((char*)replies + 2) != G_ReplySize ||
+               AsUINT16((char*)replies + 10) != *xid)
+            {
+                return -1;
+            }
+            *xid += 1;
+            count ++;
+            held -= G_ReplySize;
+            memmove(replies, replies + G_ReplySize, held);
+        }
+    }
+    return count;
+}
+
+/* Returns 1 if the messages of one read are answered in order. */
+int check_pipeline(void)
+{
+    SLPDSocket*     sock;
+    SLPList         socklist = {0,0,0};
+    unsigned char   rqsts[40 * 50];
+    int             peer;
+    int             size = 0;
+    int             xid = 1;
+    int             i;
+
+    sock = OpenStream(&peer);
+    CHECK(sock != NULL);
+
+    /* three requests in one segment, three replies in one writev() */
+    for(i = 1; i <= 3; i++)
+    {
+        size += PackRqst(rqsts + size, 50, i);
+    }
+    CHECK(send(peer, rqsts, size, 0) == size);
+    G_Processed = 0;
+    IncomingStreamRead(&socklist, sock);
+    CHECK(G_Processed == 3 && sock->state == STREAM_READ);
+    CHECK(sock->sendlist.count == 0);
+    CHECK(ReadReplies(peer, &xid) == 3);
+
+    /* more than SLPD_MAX_PIPELINE requests are all answered once the */
+    /* replies ahead of them are written                              */
+    size = 0;
+    for(i = 0; i < 40; i++)
+    {
+        size += PackRqst(rqsts + size, 50, xid + i);
+    }
+    CHECK(send(peer, rqsts, size, 0) == size);
+    while(sock->state == STREAM_READ && Readable(sock->fd))
+    {
+        /* 1400 bytes at a time */
+        IncomingStreamRead(&socklist, sock);
+    }
+    CHECK(G_Processed == 43 && sock->state == STREAM_READ);
+    CHECK(ReadReplies(peer, &xid) == 40);
+
+    CloseStream(sock, peer);
+    return 1;
+}
+
+/* Returns 1 if partial and oversized messages wait for the rest. */
+int check_partial(void)
+{
+    SLPDSocket*     sock;
+    SLPList         socklist = {0,0,0};
+    unsigned char   rqsts[5000];
+    int             peer;
+    int             xid = 1;
+
+    sock = OpenStream(&peer);
+    CHECK(sock != NULL);
+    G_Processed = 0;
+
+    /* not even the length is there yet */
+    PackRqst(rqsts, 100, 1);
+    PackRqst(rqsts + 100, 1800, 2);
+    CHECK(send(peer, rqsts, 3, 0) == 3);
+    IncomingStreamRead(&socklist, sock);
+    CHECK(G_Processed == 0 && sock->state == STREAM_READ);
+
+    /* the first request and the head of a 1800 byte one, which does  */
+    /* not fit in the 1400 bytes recv() was given                      */
+    CHECK(send(peer, rqsts + 3, 1397, 0) == 1397);
+    IncomingStreamRead(&socklist, sock);
+    CHECK(G_Processed == 1 && sock->state == STREAM_READ);
+    CHECK(sock->recvbuf->end - sock->recvbuf->start >= 1800);
+    CHECK(send(peer, rqsts + 1400, 500, 0) == 500);
+    IncomingStreamRead(&socklist, sock);
+    CHECK(G_Processed == 2);
+    CHECK(sock->recvbuf->curpos == sock->recvbuf->start);
+    CHECK(ReadReplies(peer, &xid) == 2);
+
+    /* a message bigger than any buffer the stream had so far */
+    PackRqst(rqsts, 5000, 3);
+    CHECK(send(peer, rqsts, 5000, 0) == 5000);
+    while(sock->state == STREAM_READ && Readable(sock->fd))
+    {
+        IncomingStreamRead(&socklist, sock);
+    }
+    CHECK(G_Processed == 3 && sock->state == STREAM_READ);
+    CHECK(ReadReplies(peer, &xid) == 1);
+
+    CloseStream(sock, peer);
+    return 1;
+}
+
+/* Returns 1 if replies the socket can not take yet are kept in order. */
+int check_backlog(void)
+{
+    SLPDSocket*     sock;
+    SLPList         socklist = {0,0,0};
+    unsigned char   rqsts[40 * 50];
+    int             peer;
+    int             sndbuf = 4096;
+    int             size = 0;
+    int             xid = 1;
+    int             replies = 0;
+    int             i;
+
+    sock = OpenStream(&peer);
+    CHECK(sock != NULL);
+    setsockopt(sock->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    G_ReplySize = 8000;
+    G_Processed = 0;
+
+    for(i = 0; i < 40; i++)
+    {
+        size += PackRqst(rqsts + size, 50, i + 1);
+    }
+    CHECK(send(peer, rqsts, size, 0) == size);
+    IncomingStreamRead(&socklist, sock);
+
+    /* the socket filled up: replies wait and reading stops */
+    CHECK(sock->state == STREAM_WRITE);
+    CHECK(sock->sendlist.count > 0 &&
+          sock->sendlist.count <= SLPD_MAX_PIPELINE);
+    CHECK(G_Processed < 40);
+
+    /* each write the peer makes room for lets more requests through */
+    for(i = 0; i < 10000 && replies < 40; i++)
+    {
+        replies += ReadReplies(peer, &xid);
+        CHECK(replies >= 0);
+        if(sock->state == STREAM_WRITE)
+        {
+            IncomingStreamWrite(&socklist, sock);
+        }
+        else if(sock->state == STREAM_READ && Readable(sock->fd))
+        {
+            IncomingStreamRead(&socklist, sock);
+        }
+    }
+    CHECK(replies == 40 && G_Processed == 40);
+    CHECK(sock->state == STREAM_READ && sock->sendlist.count == 0);
+
+    G_ReplySize = 32;
+    CloseStream(sock, peer);
+    return 1;
+}
+
+/* Returns 1 if bad streams are closed. */
+int check_close(void)
+{
+    SLPDSocket*     sock;
+    SLPList         socklist = {0,0,0};
+    unsigned char   rqst[50];
+    int             peer;
+
+    /* a version that can not be framed */
+    sock = OpenStream(&peer);
+    CHECK(sock != NULL);
+    PackRqst(rqst, 50, 1);
+    rqst[0] = 3;
+    CHECK(send(peer, rqst, 50, 0) == 50);
+    IncomingStreamRead(&socklist, sock);
+    CHECK(sock->state == SOCKET_CLOSE);
+    CloseStream(sock, peer);
+
+    /* a length too short to ever move on */
+    sock = OpenStream(&peer);
+    CHECK(sock != NULL);
+    PackRqst(rqst, 4, 1);
+    CHECK(send(peer, rqst, 50, 0) == 50);
+    IncomingStreamRead(&socklist, sock);
+    CHECK(sock->state == SOCKET_CLOSE);
+    CloseStream(sock, peer);
+
+    /* a message slpd does not parse */
+    sock = OpenStream(&peer);
+    CHECK(sock != NULL);
+    PackRqst(rqst, 50, 1);
+    rqst[1] = SLP_FUNCT_SRVRPLY;
+    CHECK(send(peer, rqst, 50, 0) == 50);
+    IncomingStreamRead(&socklist, sock);
+    CHECK(sock->state == SOCKET_CLOSE);
+    CloseStream(sock, peer);
+
+    /* the peer hung up */
+    sock = OpenStream(&peer);
+    CHECK(sock != NULL);
+    shutdown(peer, SHUT_WR);
+    IncomingStreamRead(&socklist, sock);
+    CHECK(sock->state == SOCKET_CLOSE);
+    CloseStream(sock, peer);
+
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPTestReport("pipeline", check_pipeline());
+    SLPTestReport("partial", check_partial());
+    SLPTestReport("backlog", check_backlog());
+    SLPTestReport("close", check_close());
+
+    return SLPTestExit();
+}
@@ -0,0 +1,314 @@
+/* Checks the URL, address and scope indexes of slpd's known DA list:
+ * DAAdverts for a known URL replace the entry, dying DAs and
+ * SLPDKnownDARemove() drop only their own DA, SLPDKnownDAEcho() finds
+ * the DAs of a scope and SLPDKnownDADeinit() leaves nothing behind.
+ * The removals must be logged while the entry is still in the list.
+ * The rest of slpd is stubbed out below, with no registrations.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "slpd_knownda.h"
+#include "slpd_database.h"
+#include "slpd_log.h"
+#include "slpd_outgoing.h"
+#include "slpd_property.h"
+#include "slpd_socket.h"
+
+#include <slp_test.h>
+
+extern SLPDatabase G_SlpdKnownDAs;
+
+SLPDProperty G_SlpdProperty;
+#ifdef ENABLE_SLPv2_SECURITY
+SLPSpiHandle G_SlpdSpiHandle = 0;
+#endif
+
+static int              G_Logged = 0;       /* SLPDLogDAAdvertisement() */
+static int              G_LoggedListed = 0; /* ... of a listed entry    */
+static char             G_LoggedPrefix[16];
+static int              G_Connects = 0;     /* SLPDOutgoingConnect()    */
+static struct in_addr   G_Connected[8];
+
+/* Counts the log lines and whether their entry was still listed */
+void SLPDLogDAAdvertisement(const char* prefix, SLPDatabaseEntry* entry)
+{
+    SLPDatabaseEntry* listed;
+
+    for(listed = (SLPDatabaseEntry*)G_SlpdKnownDAs.head;
+        listed;
+        listed = (SLPDatabaseEntry*)listed->listitem.next)
+    {
+        if(listed == entry)
+        {
+            G_LoggedListed ++;
+            break;
+        }
+    }
+    G_Logged ++;
+    strncpy(G_LoggedPrefix, prefix, sizeof(G_LoggedPrefix) - 1);
+}
+
+/* Records where the echoes went, no socket is made */
+SLPDSocket* SLPDOutgoingConnect(struct in_addr* addr)
+{
+    if(G_Connects < 8)
+    {
+        G_Connected[G_Connects] = *addr;
+    }
+    G_Connects ++;
+    return NULL;
+}
+
+void SLPDOutgoingDatagramWrite(SLPDSocket* sock)
+{
+}
+
+SLPDSocket* SLPDSocketCreateDatagram(struct in_addr* peeraddr, int type)
+{
+    return NULL;
+}
+
+void SLPDSocketFree(SLPDSocket* sock)
+{
+}
+
+/* No registrations, so no DA is ever sent any */
+int SLPDDatabaseIsEmpty()
+{
+    return 1;
+}
+
+void* SLPDDatabaseEnumStart()
+{
+    return NULL;
+}
+
+SLPMessage SLPDDatabaseEnum(void* eh, SLPMessage* msg, SLPBuffer* buf)
+{
+    *msg = 0;
+    *buf = 0;
+    return 0;
+}
+
+void SLPDDatabaseEnumEnd(void* eh)
+{
+}
+
+/* Adds a DAAdvert for service:directory-agent://192.0.2.<host> */
+static int AddDAAdvert(int host, unsigned int bootstamp, const char* scopes)
+{
+    char        url[64];
+    int         urllen;
+    int         scopeslen;
+    int         size;
+    SLPBuffer   buf;
+    SLPMessage  msg;
+    struct sockaddr_in peer;
+
+    sprintf(url, "service:directory-agent://192.0.2.%i", host);
+    urllen = strlen(url);
+    scopeslen = strlen(scopes);
+    size = 14 + 2 + 2 + 4 + 2 + urllen + 2 + scopeslen + 2 + 2 + 1;
+
+    buf = SLPBufferAlloc(size);
+    msg = SLPMessageAlloc();
+    if(buf == NULL || msg == NULL)
+    {
+        return -1;
+    }
+    memset(buf->start, 0, size);
+    buf->start[0] = 2;
+    buf->start[1] = SLP_FUNCT_DAADVERT;
+    ToUINT24(buf->start + 2, size);
+    ToUINT16(buf->start + 12, 2);
+    memcpy(buf->start + 14, "en", 2);
+    buf->curpos = buf->start + 18;          /* errorcode 0 */
+    ToUINT32(buf->curpos, bootstamp);
+    buf->curpos += 4;
+    ToUINT16(buf->curpos, urllen);
+    memcpy(buf->curpos + 2, url, urllen);
+    buf->curpos += 2 + urllen;
+    ToUINT16(buf->curpos, scopeslen);
+    memcpy(buf->curpos + 2, scopes, scopeslen);
+    buf->curpos = buf->start;               /* attrs, spi, auths empty */
+
+    memset(&peer, 0, sizeof(peer));
+    peer.sin_family = AF_INET;
+    if(SLPMessageParseBuffer(&peer, buf, msg))
+    {
+        SLPMessageFree(msg);
+        SLPBufferFree(buf);
+        return -1;
+    }
+
+    /* msg and buf belong to the known DA list from here */
+    return SLPDKnownDAAdd(msg, buf);
+}
+
+/* Returns how many DAs are known and the bootstamp of 192.0.2.<host> */
+static int CountDAs(int host, unsigned int* bootstamp)
+{
+    char        url[64];
+    void*       eh;
+    SLPMessage  msg;
+    SLPBuffer   buf;
+    int         count = 0;
+
+    sprintf(url, "service:directory-agent://192.0.2.%i", host);
+    *bootstamp = 0;
+    eh = SLPDKnownDAEnumStart();
+    while(SLPDKnownDAEnum(eh, &msg, &buf))
+    {
+        if(msg->body.daadvert.urllen == (int)strlen(url) &&
+           memcmp(msg->body.daadvert.url, url, strlen(url)) == 0)
+        {
+            *bootstamp = msg->body.daadvert.bootstamp;
+        }
+        count ++;
+    }
+    SLPDKnownDAEnumEnd(eh);
+    return count;
+}
+
+/* Echoes a SrvDeReg for the scopes and returns how many DAs it went to */
+static int Echo(const char* scopes)
+{
+    SLPMessage  msg;
+    SLPBuffer   buf;
+
+    msg = SLPMessageAlloc();
+    buf = SLPBufferAlloc(16);
+    if(msg == NULL || buf == NULL)
+    {
+        return -1;
+    }
+    msg->header.functionid = SLP_FUNCT_SRVDEREG;
+    msg->body.srvdereg.scopelist = scopes;
+    msg->body.srvdereg.scopelistlen = strlen(scopes);
+
+    G_Connects = 0;
+    SLPDKnownDAEcho(msg, buf);
+
+    SLPMessageFree(msg);
+    SLPBufferFree(buf);
+    return G_Connects;
+}
+
+/* Returns 1 if adverts for known URLs replace their entry, 0 otherwise. */
+int check_add(void)
+{
+    unsigned int bootstamp;
+
+    G_Logged = 0;
+    CHECK(AddDAAdvert(1, 100, "default") == 0);
+    CHECK(AddDAAdvert(2, 100, "default,lab") == 0);
+    CHECK(AddDAAdvert(3, 100, "LAB") == 0);
+    CHECK(CountDAs(1, &bootstamp) == 3 && bootstamp == 100);
+    CHECK(G_Logged == 3 && G_LoggedListed == 3);
+    CHECK(strcmp(G_LoggedPrefix, "Addition") == 0);
+
+    /* a newer advert takes the place of the old one, quietly */
+    CHECK(AddDAAdvert(1, 200, "default") == 0);
+    CHECK(CountDAs(1, &bootstamp) == 3 && bootstamp == 200);
+    CHECK(G_Logged == 3);
+
+    return 1;
+}
+
+/* Returns 1 if echoes reach each DA of the scopes once, 0 otherwise. */
+int check_echo(void)
+{
+    /* scopes are matched folded, and a DA in two of them gets one copy */
+    CHECK(Echo("Default") == 2);
+    CHECK(Echo("lab") == 2);
+    CHECK(Echo("default,LAB") == 3);
+    CHECK(Echo("nowhere") == 0);
+
+    CHECK(Echo("lab") == 2);
+    CHECK((G_Connected[0].s_addr == inet_addr("192.0.2.2") &&
+           G_Connected[1].s_addr == inet_addr("192.0.2.3")) ||
+          (G_Connected[0].s_addr == inet_addr("192.0.2.3") &&
+           G_Connected[1].s_addr == inet_addr("192.0.2.2")));
+
+    return 1;
+}
+
+/* Returns 1 if removals take out only their DA, 0 otherwise. */
+int check_remove(void)
+{
+    struct in_addr addr;
+    unsigned int bootstamp;
+
+    /* a dying DA is logged while it is still in the list */
+    G_Logged = G_LoggedListed = 0;
+    CHECK(AddDAAdvert(2, 0, "default,lab") == 0);
+    CHECK(CountDAs(2, &bootstamp) == 2 && bootstamp == 0);
+    CHECK(G_Logged == 1 && G_LoggedListed == 1);
+    CHECK(strcmp(G_LoggedPrefix, "Removed") == 0);
+    CHECK(Echo("default,lab") == 2);
+
+    /* the address index finds the DA of a dead connection */
+    addr.s_addr = inet_addr("192.0.2.3");
+    SLPDKnownDARemove(&addr);
+    CHECK(CountDAs(3, &bootstamp) == 1 && bootstamp == 0);
+    CHECK(G_Logged == 2 && G_LoggedListed == 2);
+    CHECK(strcmp(G_LoggedPrefix, "Removal") == 0);
+    CHECK(Echo("lab") == 0);
+
+    /* other addresses, and DAs already gone, are left alone */
+    addr.s_addr = inet_addr("192.0.2.9");
+    SLPDKnownDARemove(&addr);
+    addr.s_addr = inet_addr("192.0.2.3");
+    SLPDKnownDARemove(&addr);
+    CHECK(AddDAAdvert(2, 0, "default,lab") == 0);
+    CHECK(CountDAs(1, &bootstamp) == 1 && bootstamp == 200);
+    CHECK(G_Logged == 2);
+
+    /* a removed DA comes back as a new one */
+    CHECK(AddDAAdvert(3, 300, "lab") == 0);
+    CHECK(CountDAs(3, &bootstamp) == 2 && bootstamp == 300);
+    CHECK(G_Logged == 3 && strcmp(G_LoggedPrefix, "Addition") == 0);
+    CHECK(Echo("lab") == 1);
+
+    return 1;
+}
+
+/* Returns 1 if SLPDKnownDADeinit() empties list and indexes, 0 otherwise. */
+int check_deinit(void)
+{
+    struct in_addr addr;
+    unsigned int bootstamp;
+
+    SLPDKnownDADeinit();
+    CHECK(CountDAs(1, &bootstamp) == 0);
+    CHECK(Echo("default,lab") == 0);
+    addr.s_addr = inet_addr("192.0.2.1");
+    SLPDKnownDARemove(&addr);
+
+    /* nothing stale is found when the same DAs come back */
+    G_Logged = 0;
+    CHECK(AddDAAdvert(1, 400, "default") == 0);
+    CHECK(AddDAAdvert(3, 400, "lab") == 0);
+    CHECK(CountDAs(1, &bootstamp) == 2 && bootstamp == 400);
+    CHECK(G_Logged == 2 && strcmp(G_LoggedPrefix, "Addition") == 0);
+    CHECK(Echo("default,lab") == 2);
+
+    SLPDKnownDADeinit();
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    memset(&G_SlpdProperty, 0, sizeof(G_SlpdProperty));
+    G_SlpdProperty.myUrl = "";
+    SLPDatabaseInit(&G_SlpdKnownDAs);
+
+    SLPTestReport("add", check_add());
+    SLPTestReport("echo", check_echo());
+    SLPTestReport("remove", check_remove());
+    SLPTestReport("deinit", check_deinit());
+
+    return SLPTestExit();
+}
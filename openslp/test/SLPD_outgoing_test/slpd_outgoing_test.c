@@ -0,0 +1,304 @@
+/* Checks the window of registrations slpd forwards on a DA connection:
+ * no more than net.slp.DARegistrationWindow messages are outstanding,
+ * each reply frees the oldest message sent with its XID and lets the
+ * next one out, a busy DA gets its message again first, and a reconnect
+ * queues everything that was not acknowledged again, in order.  The DA
+ * is the other end of a socket pair, SLPDProcessMessage() is stubbed
+ * out to return the error code of each SrvAck.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include "slpd_outgoing.h"
+#include "slpd_knownda.h"
+#include "slpd_log.h"
+#include "slpd_process.h"
+#include "slpd_property.h"
+#include "slpd_socket.h"
+
+#include <slp_xmalloc.h>
+#include <slp_test.h>
+
+void OutgoingStreamRead(SLPList* socklist, SLPDSocket* sock);
+void OutgoingStreamWrite(SLPList* socklist, SLPDSocket* sock);
+void OutgoingStreamReconnect(SLPList* socklist, SLPDSocket* sock);
+
+SLPDProperty G_SlpdProperty;
+
+static int  G_Acks = 0;     /* SrvAcks processed */
+
+#define RQST_SIZE   24      /* header, 2 byte lang tag and a number */
+#define ACK_SIZE    18      /* header, 2 byte lang tag and errorcode */
+
+/* Returns the error code of a SrvAck, as the real one does */
+int SLPDProcessMessage(struct sockaddr_in* peerinfo,
+                       SLPBuffer recvbuf,
+                       SLPBuffer* sendbuf)
+{
+    if(recvbuf->start[1] != SLP_FUNCT_SRVACK ||
+       recvbuf->end - recvbuf->start != ACK_SIZE)
+    {
+        return SLP_ERROR_PARSE_ERROR;
+    }
+    G_Acks ++;
+    return AsUINT16((char*)recvbuf->start + 16);
+}
+
+void SLPDLog(const char* msg, ...)
+{
+}
+
+void SLPDKnownDARemove(struct in_addr* addr)
+{
+}
+
+SLPDSocket* SLPDSocketCreateConnected(struct in_addr* addr)
+{
+    return NULL;
+}
+
+void SLPDSocketFree(SLPDSocket* sock)
+{
+}
+
+/* Makes a DA connection with count SrvRegs to send, numbered from 0 */
+/* and sent with xid number / xidshare                               */
+static SLPDSocket* OpenStream(int* peer, int count, int xidshare)
+{
+    SLPDSocket* sock;
+    SLPBuffer   buf;
+    int         fds[2];
+    int         i;
+
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+    {
+        return NULL;
+    }
+    sock = (SLPDSocket*)xmalloc(sizeof(SLPDSocket));
+    memset(sock, 0, sizeof(SLPDSocket));
+    sock->fd = fds[0];
+    sock->peeraddr.sin_family = AF_INET;
+    sock->peeraddr.sin_addr.s_addr = htonl(LOOPBACK_ADDRESS);
+    sock->peeraddr.sin_port = htons(1);
+    fcntl(sock->fd, F_SETFL, fcntl(sock->fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL, 0) | O_NONBLOCK);
+
+    for(i = 0; i < count; i++)
+    {
+        buf = SLPBufferAlloc(RQST_SIZE);
+        memset(buf->start, 0, RQST_SIZE);
+        buf->start[0] = 2;
+        buf->start[1] = SLP_FUNCT_SRVREG;
+        ToUINT24((char*)buf->start + 2, RQST_SIZE);
+        ToUINT16((char*)buf->start + 10, i / xidshare);
+        ToUINT32((char*)buf->start + 16, i);
+        SLPListLinkTail(&(sock->sendlist), (SLPListItem*)buf);
+    }
+    sock->state = STREAM_WRITE_FIRST;
+
+    *peer = fds[1];
+    return sock;
+}
+
+static void FreeList(SLPList* list)
+{
+    while(list->count)
+    {
+        SLPBufferFree((SLPBuffer)SLPListUnlink(list, list->head));
+    }
+}
+
+static void CloseStream(SLPDSocket* sock, int peer)
+{
+    FreeList(&(sock->sendlist));
+    FreeList(&(sock->inflight));
+    SLPBufferFree(sock->recvbuf);
+    SLPBufferFree(sock->sendbuf);
+    close(sock->fd);
+    close(peer);
+    xfree(sock);
+}
+
+/* Reads the SrvRegs that reached the DA into numbers, returns how many */
+static int ReadRqsts(int peer, int* numbers, int max)
+{
+    unsigned char   rqst[RQST_SIZE];
+    int             count = 0;
+
+    while(count < max && recv(peer, rqst, RQST_SIZE, 0) == RQST_SIZE)
+    {
+        if(AsUINT24((char*)rqst + 2) != RQST_SIZE)
+        {
+            return -1;
+        }
+        numbers[count] = AsUINT32((char*)rqst + 16);
+        count ++;
+    }
+    return count;
+}
+
+/* The DA acknowledges count messages sent with xid in one write */
+static int SendAcks(int peer, int xid, int errorcode, int count)
+{
+    unsigned char   acks[16 * ACK_SIZE];
+    unsigned char*  ack;
+    int             i;
+
+    for(i = 0; i < count; i++)
+    {
+        ack = acks + i * ACK_SIZE;
+        memset(ack, 0, ACK_SIZE);
+        ack[0] = 2;
+        ack[1] = SLP_FUNCT_SRVACK;
+        ToUINT24((char*)ack + 2, ACK_SIZE);
+        ToUINT16((char*)ack + 10, xid);
+        ToUINT16((char*)ack + 12, 2);
+        memcpy(ack + 14, "en", 2);
+        ToUINT16((char*)ack + 16, errorcode);
+    }
+    return send(peer, acks, count * ACK_SIZE, 0) == count * ACK_SIZE;
+}
+
+/* Returns 1 if the window is filled and refilled as replies come in. */
+int check_window(void)
+{
+    SLPDSocket* sock;
+    SLPList     socklist = {0,0,0};
+    int         numbers[16];
+    int         peer;
+
+    G_SlpdProperty.DARegistrationWindow = 4;
+    sock = OpenStream(&peer, 10, 1);
+    CHECK(sock != NULL);
+
+    /* the first four go out at once, one writev() */
+    OutgoingStreamWrite(&socklist, sock);
+    CHECK(sock->state == STREAM_READ);
+    CHECK(sock->inflight.count == 4 && sock->sendlist.count == 6);
+    CHECK(ReadRqsts(peer, numbers, 16) == 4);
+    CHECK(numbers[0] == 0 && numbers[3] == 3);
+
+    /* two acks in one read make room for two more */
+    G_Acks = 0;
+    CHECK(SendAcks(peer, 0, 0, 1) && SendAcks(peer, 1, 0, 1));
+    OutgoingStreamRead(&socklist, sock);
+    CHECK(G_Acks == 2 && sock->state == STREAM_READ);
+    CHECK(sock->inflight.count == 4 && sock->sendlist.count == 4);
+    CHECK(ReadRqsts(peer, numbers, 16) == 2);
+    CHECK(numbers[0] == 4 && numbers[1] == 5);
+
+    /* a reply that matches nothing sent is ignored */
+    CHECK(SendAcks(peer, 77, 0, 1));
+    OutgoingStreamRead(&socklist, sock);
+    CHECK(G_Acks == 2 && sock->inflight.count == 4);
+
+    /* replies out of order still free the right messages */
+    CHECK(SendAcks(peer, 5, 0, 1) && SendAcks(peer, 3, 0, 1));
+    OutgoingStreamRead(&socklist, sock);
+    CHECK(G_Acks == 4 && sock->inflight.count == 4);
+    CHECK(ReadRqsts(peer, numbers, 16) == 2);
+    CHECK(numbers[0] == 6 && numbers[1] == 7);
+    CHECK(AsUINT32((char*)((SLPBuffer)sock->inflight.head)->start + 16) == 2);
+
+    /* the rest drains and the connection goes idle */
+    CHECK(SendAcks(peer, 2, 0, 1) && SendAcks(peer, 4, 0, 1) &&
+          SendAcks(peer, 6, 0, 1) && SendAcks(peer, 7, 0, 1));
+    OutgoingStreamRead(&socklist, sock);
+    CHECK(ReadRqsts(peer, numbers, 16) == 2);
+    CHECK(numbers[0] == 8 && numbers[1] == 9);
+    CHECK(SendAcks(peer, 8, 0, 1) && SendAcks(peer, 9, 0, 1));
+    OutgoingStreamRead(&socklist, sock);
+    CHECK(G_Acks == 10 && sock->state == STREAM_CONNECT_IDLE);
+    CHECK(sock->inflight.count == 0 && sock->sendlist.count == 0);
+
+    CloseStream(sock, peer);
+    return 1;
+}
+
+/* Returns 1 if forwarded SrvRegs that share an XID are told apart. */
+int check_xids(void)
+{
+    SLPDSocket* sock;
+    SLPList     socklist = {0,0,0};
+    int         numbers[16];
+    int         peer;
+
+    /* 0 and 1 share xid 0, 2 and 3 share xid 1 */
+    G_SlpdProperty.DARegistrationWindow = 4;
+    sock = OpenStream(&peer, 4, 2);
+    CHECK(sock != NULL);
+    OutgoingStreamWrite(&socklist, sock);
+    CHECK(ReadRqsts(peer, numbers, 16) == 4);
+
+    /* a reply frees the oldest message sent with its XID */
+    G_Acks = 0;
+    CHECK(SendAcks(peer, 1, 0, 1));
+    OutgoingStreamRead(&socklist, sock);
+    CHECK(G_Acks == 1 && sock->inflight.count == 3);
+    CHECK(AsUINT32((char*)((SLPBuffer)sock->inflight.tail)->start + 16) == 3);
+
+    CHECK(SendAcks(peer, 0, 0, 2) && SendAcks(peer, 1, 0, 1));
+    OutgoingStreamRead(&socklist, sock);
+    CHECK(G_Acks == 4 && sock->state == STREAM_CONNECT_IDLE);
+
+    CloseStream(sock, peer);
+    return 1;
+}
+
+/* Returns 1 if busy replies and reconnects resend in order. */
+int check_resend(void)
+{
+    SLPDSocket* sock;
+    SLPList     socklist = {0,0,0};
+    SLPBuffer   buf;
+    int         numbers[16];
+    int         peer;
+    int         i;
+
+    G_SlpdProperty.DARegistrationWindow = 3;
+    sock = OpenStream(&peer, 6, 1);
+    CHECK(sock != NULL);
+    OutgoingStreamWrite(&socklist, sock);
+    CHECK(ReadRqsts(peer, numbers, 16) == 3);
+
+    /* a busy DA gets the message again first, after a pause */
+    CHECK(SendAcks(peer, 0, SLP_ERROR_DA_BUSY_NOW, 1));
+    OutgoingStreamRead(&socklist, sock);
+    CHECK(sock->state == STREAM_WRITE_WAIT);
+    CHECK(sock->inflight.count == 2 && sock->sendlist.count == 4);
+    CHECK(AsUINT32((char*)((SLPBuffer)sock->sendlist.head)->start + 16) == 0);
+
+    sock->state = STREAM_WRITE_FIRST;
+    OutgoingStreamWrite(&socklist, sock);
+    CHECK(ReadRqsts(peer, numbers, 16) == 1 && numbers[0] == 0);
+
+    /* nothing acknowledged before a reconnect is lost or reordered */
+    OutgoingStreamReconnect(&socklist, sock);
+    CHECK(sock->inflight.count == 0 && sock->sendlist.count == 6);
+    CHECK(sock->state != SOCKET_CLOSE);
+    buf = (SLPBuffer)sock->sendlist.head;
+    for(i = 0; i < 6; i++)
+    {
+        numbers[i] = AsUINT32((char*)buf->start + 16);
+        buf = (SLPBuffer)buf->listitem.next;
+    }
+    CHECK(numbers[0] == 1 && numbers[1] == 2 && numbers[2] == 0);
+    CHECK(numbers[3] == 3 && numbers[4] == 4 && numbers[5] == 5);
+
+    CloseStream(sock, peer);
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    memset(&G_SlpdProperty, 0, sizeof(G_SlpdProperty));
+
+    SLPTestReport("window", check_window());
+    SLPTestReport("xids", check_xids());
+    SLPTestReport("resend", check_resend());
+
+    return SLPTestExit();
+}
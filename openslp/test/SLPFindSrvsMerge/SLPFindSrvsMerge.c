@@ -0,0 +1,93 @@
+/****************************************************************************/
+/* Test for SLPFindSrvs asking a DA and multicast at the same time.  The DA */
+/* serves two of the three scopes asked for, nothing answers the multicast  */
+/* for the third.  Both the synchronous and the async handle must see the   */
+/* DA's URLs and one SLP_LAST_CALL.                                         */
+/****************************************************************************/
+#include <slp.h>
+#include <slp_debug.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct {
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;
+	int		urls;
+	int		lastcalls;
+	int		errors;
+} MergeState;
+
+SLPBoolean
+MySLPSrvURLCallback (SLPHandle hslp,
+		     const char *srvurl,
+		     unsigned short lifetime, SLPError errcode, void *cookie)
+{
+	MergeState	*state = (MergeState *) cookie;
+
+	pthread_mutex_lock(&state->lock);
+	switch(errcode) {
+		case SLP_OK:
+			state->urls++;
+			printf ("Service URL     = %s\n", srvurl);
+			break;
+		case SLP_LAST_CALL:
+			state->lastcalls++;
+			break;
+		default:
+			state->errors++;
+			break;
+	} /* End switch. */
+	pthread_cond_broadcast(&state->cond);
+	pthread_mutex_unlock(&state->lock);
+
+	return SLP_TRUE;
+}
+
+static void findsrvs(SLPBoolean isasync)
+{
+	MergeState	state;
+	SLPHandle	hslp;
+	SLPError	err;
+
+	memset(&state, 0, sizeof(state));
+	pthread_mutex_init(&state.lock, 0);
+	pthread_cond_init(&state.cond, 0);
+
+	err = SLPOpen("en", isasync, &hslp);
+	if (err == SLP_NOT_IMPLEMENTED) {
+		printf("async API not compiled in\n");
+		exit(77);
+	}
+	check_error_state(err, "Error opening slp handle.");
+
+	err = SLPFindSrvs(hslp, "service:test", "DEFAULT,other,third", 0,
+			  MySLPSrvURLCallback, &state);
+	check_error_state(err, "Error finding services.");
+
+	/* a synchronous call has made all of its callbacks by now */
+	pthread_mutex_lock(&state.lock);
+	while (state.lastcalls == 0)
+		pthread_cond_wait(&state.cond, &state.lock);
+	pthread_mutex_unlock(&state.lock);
+
+	SLPClose(hslp);
+
+	printf("%s SLPFindSrvs: %d URLs, %d SLP_LAST_CALL, %d errors\n",
+	       isasync ? "async" : "sync", state.urls, state.lastcalls,
+	       state.errors);
+}
+
+int
+main (int argc, char *argv[])
+{
+	/* the DA is slpd on this host, the multicast gives up quickly */
+	SLPSetProperty("net.slp.DAAddresses", "127.0.0.1");
+	SLPSetProperty("net.slp.multicastMaximumWait", "2000");
+
+	findsrvs(SLP_FALSE);
+	findsrvs(SLP_TRUE);
+
+	return(0);
+}
@@ -0,0 +1,76 @@
+/****************************************************************************/
+/* Test for net.slp.refreshRegistrations.  slpd ages its registrations by   */
+/* 15 seconds every 15 seconds, so 26 seconds after registering a URL for   */
+/* 30 seconds it has 15 seconds left unless libslp refreshed it, which it   */
+/* does 18 to 24 seconds in.  A URL deregistered right away must not be     */
+/* refreshed back.                                                          */
+/****************************************************************************/
+#include <slp.h>
+#include <slp_debug.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LIFETIME 30
+
+void MySLPRegReport(SLPHandle hslp, SLPError errcode, void* cookie) 
+{ 
+	/* return the error code in the cookie */ 
+	*(SLPError*)cookie = errcode; 
+} 
+
+SLPBoolean
+MySLPSrvURLCallback (SLPHandle hslp,
+		     const char *srvurl,
+		     unsigned short lifetime, SLPError errcode, void *cookie)
+{
+	if (errcode == SLP_OK)
+		printf("Service Found   = %s, %s\n", srvurl,
+		       lifetime > LIFETIME / 2 ? "refreshed" : "not refreshed");
+
+	return SLP_TRUE;
+}
+
+static void reg(SLPHandle hslp, const char *url)
+{
+	SLPError	err;
+	SLPError	callbackerr;
+
+	err = SLPReg(hslp, url, LIFETIME, 0, "", SLP_TRUE,
+		     MySLPRegReport, &callbackerr);
+	check_error_state(err, "Error registering service with slp.");
+	check_error_state(callbackerr, "Error registering service with slp.");
+}
+
+int
+main (int argc, char *argv[])
+{
+	SLPError	err;
+	SLPError	callbackerr;
+	SLPHandle	hslp;
+
+	SLPSetProperty("net.slp.refreshRegistrations", "true");
+	SLPSetProperty("net.slp.multicastMaximumWait", "2000");
+
+	err = SLPOpen ("en", SLP_FALSE, &hslp);
+	check_error_state(err,"Error opening slp handle.");
+
+	reg(hslp, "service:refreshtest://10.0.0.1");
+	reg(hslp, "service:refreshtest://10.0.0.2");
+
+	err = SLPDereg(hslp, "service:refreshtest://10.0.0.2",
+		       MySLPRegReport, &callbackerr);
+	check_error_state(err, "Error deregistering service with slp.");
+	check_error_state(callbackerr, "Error deregistering service with slp.");
+
+	sleep(26);
+
+	err = SLPFindSrvs(hslp, "service:refreshtest", 0, 0,
+			  MySLPSrvURLCallback, &callbackerr);
+	check_error_state(err, "Error finding services.");
+
+	/* the handle has to stay open for the refreshes to go on */
+	SLPClose (hslp);
+
+	return(0);
+}
@@ -0,0 +1,91 @@
+/****************************************************************************/
+/* Test for SLPRegBatch and SLPDeregBatch.  Registers a batch that has two  */
+/* bad items among good ones, checks the report of every item and that the  */
+/* good ones are found, then deregisters them and checks they are gone.     */
+/****************************************************************************/
+#include <slp.h>
+#include <slp_debug.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ITEMCOUNT 5
+
+static const SLPRegItem items[ITEMCOUNT] = {
+	{ "service:batchtest://10.0.0.1", 0, "(id=1)", 300 },
+	{ "service:batchtest://10.0.0.2", 0, "(id=2)", 300 },
+	{ "not a service url", 0, "", 300 },	/* bad URL */
+	{ "service:batchtest://10.0.0.4", 0, "", 0 },	/* zero lifetime */
+	{ "service:batchtest://10.0.0.5", 0, "", 300 }
+};
+
+void MySLPRegBatchReport(SLPHandle hslp, int item, SLPError errcode,
+			 void *cookie)
+{
+	/* items are not necessarily reported in order */
+	((SLPError *) cookie)[item] = errcode;
+}
+
+SLPBoolean
+MySLPSrvURLCallback (SLPHandle hslp,
+		     const char *srvurl,
+		     unsigned short lifetime, SLPError errcode, void *cookie)
+{
+	if (errcode == SLP_OK)
+		(*(int *) cookie)++;
+
+	return SLP_TRUE;
+}
+
+static void print_reports(const char *what, SLPError *reports)
+{
+	int	i;
+
+	for (i = 0; i < ITEMCOUNT; i++)
+		printf("%s item %d = %d\n", what, i, reports[i]);
+}
+
+static int count_found(SLPHandle hslp)
+{
+	SLPError	err;
+	int		found = 0;
+
+	err = SLPFindSrvs(hslp, "service:batchtest", 0, 0,
+			  MySLPSrvURLCallback, &found);
+	check_error_state(err, "Error finding services.");
+
+	return found;
+}
+
+int
+main (int argc, char *argv[])
+{
+	SLPError	err;
+	SLPError	reports[ITEMCOUNT];
+	SLPHandle	hslp;
+	int		i;
+
+	SLPSetProperty("net.slp.multicastMaximumWait", "2000");
+
+	err = SLPOpen ("en", SLP_FALSE, &hslp);
+	check_error_state(err,"Error opening slp handle.");
+
+	for (i = 0; i < ITEMCOUNT; i++)
+		reports[i] = 1;		/* not reported */
+	err = SLPRegBatch(hslp, items, ITEMCOUNT, SLP_TRUE,
+			  MySLPRegBatchReport, reports);
+	printf("SLPRegBatch = %d\n", err);
+	print_reports("SLPRegBatch", reports);
+	printf("Services found = %d\n", count_found(hslp));
+
+	for (i = 0; i < ITEMCOUNT; i++)
+		reports[i] = 1;
+	err = SLPDeregBatch(hslp, items, ITEMCOUNT,
+			    MySLPRegBatchReport, reports);
+	printf("SLPDeregBatch = %d\n", err);
+	print_reports("SLPDeregBatch", reports);
+	printf("Services found = %d\n", count_found(hslp));
+
+	SLPClose (hslp);
+
+	return(0);
+}
@@ -0,0 +1,161 @@
+/* Checks the libslp result cache: results of a request are answered again
+ * with what is left of their lifetimes, stopped requests and requests
+ * without results are not cached, and the entries used longest ago make
+ * room for new ones.  Results cached with net.slp.securityEnabled off do
+ * not answer once it is on, and only service:service-agent itself skips
+ * the cache.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <slp.h>
+#include <libslp.h>
+#include <slp_test.h>
+
+static int  G_Urls;
+static int  G_LastCalls;
+static int  G_Lifetime;
+
+static SLPBoolean SrvURLCallback(SLPHandle hSLP,
+                                 const char* pcSrvURL,
+                                 unsigned short sLifetime,
+                                 SLPError errCode,
+                                 void *pvCookie)
+{
+    if(errCode == SLP_OK)
+    {
+        G_Urls++;
+        G_Lifetime = sLifetime;
+    }
+    else if(errCode == SLP_LAST_CALL)
+    {
+        G_LastCalls++;
+    }
+    return SLP_TRUE;
+}
+
+/* Points the handle at a SrvRqst for srvtype, like SLPFindSrvs() does */
+static void SetSrvRqst(PSLPHandleInfo handle, const char* srvtype)
+{
+    handle->params.findsrvs.srvtype = srvtype;
+    handle->params.findsrvs.srvtypelen = strlen(srvtype);
+    handle->params.findsrvs.scopelist = "default";
+    handle->params.findsrvs.scopelistlen = 7;
+    handle->params.findsrvs.predicate = "";
+    handle->params.findsrvs.predicatelen = 0;
+    handle->params.findsrvs.callback = SrvURLCallback;
+    handle->params.findsrvs.cookie = 0;
+    G_Urls = 0;
+    G_LastCalls = 0;
+}
+
+/* Answers the SrvRqst the handle points at the way the network would */
+static void Reply(PSLPHandleInfo handle, int count, unsigned short lifetime)
+{
+    char    url[64];
+    int     i;
+
+    for(i = 0; i < count; i++)
+    {
+        sprintf(url, "service:test://host%d", i);
+        ColateSLPSrvURLCallback((SLPHandle)handle, url, lifetime, SLP_OK, 0);
+    }
+    ColateSLPSrvURLCallback((SLPHandle)handle, 0, 0, SLP_LAST_CALL, 0);
+}
+
+/* Returns 1 if the cache behaved, 0 otherwise. */
+int check_cache(PSLPHandleInfo handle)
+{
+    /* off unless configured */
+    SLPPropertySet("net.slp.clientCache", "false");
+    SetSrvRqst(handle, "service:test");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    CHECK(handle->cachekey == 0);
+
+    SLPPropertySet("net.slp.clientCache", "true");
+    SLPPropertySet("net.slp.clientCacheMaxEntries", "2");
+    SLPPropertySet("net.slp.clientCacheMaxLifetime", "300");
+
+    /* a miss, then the results come from the cache */
+    SetSrvRqst(handle, "service:test");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    Reply(handle, 3, 600);
+    CHECK(G_Urls == 3 && G_LastCalls == 1);
+    SetSrvRqst(handle, "service:test");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 3 && G_LastCalls == 1);
+    CHECK(G_Lifetime <= 600 && G_Lifetime >= 599);
+
+    /* not for results gathered without security */
+    SLPPropertySet("net.slp.securityEnabled", "true");
+    SetSrvRqst(handle, "service:test");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    CacheEndRqst(handle, 0);
+    SLPPropertySet("net.slp.securityEnabled", "false");
+
+    /* SAs are not cached, types it is a prefix of are */
+    SetSrvRqst(handle, SLP_SA_SERVICE_TYPE);
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    CHECK(handle->cachekey == 0);
+    SetSrvRqst(handle, "service:");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    CHECK(handle->cachekey != 0);
+    CacheEndRqst(handle, 0);
+
+    /* a different predicate is a different request */
+    SetSrvRqst(handle, "service:test");
+    handle->params.findsrvs.predicate = "(a=1)";
+    handle->params.findsrvs.predicatelen = 5;
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    CacheEndRqst(handle, 0);
+
+    /* results without a lifetime are not cached */
+    SetSrvRqst(handle, "service:zero");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    Reply(handle, 1, 0);
+    SetSrvRqst(handle, "service:zero");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    CacheEndRqst(handle, 0);
+
+    /* the third request pushes out service:test, used longest ago */
+    SetSrvRqst(handle, "service:b");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    Reply(handle, 1, 600);
+    SetSrvRqst(handle, "service:c");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    Reply(handle, 1, 600);
+    SetSrvRqst(handle, "service:test");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+
+    /* asked again without results, service:test is not cached */
+    Reply(handle, 0, 600);
+    SetSrvRqst(handle, "service:test");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_FALSE);
+    CacheEndRqst(handle, 0);
+    SetSrvRqst(handle, "service:c");
+    CHECK(CacheProcessSrvRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 1);
+
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPHandle   hslp;
+
+    /* load the configuration before overriding it */
+    SLPGetProperty("net.slp.clientCache");
+
+    if(SLPOpen("en", SLP_FALSE, &hslp) != SLP_OK)
+    {
+        printf("SLPOpen failed\n");
+        return 1;
+    }
+
+    SLPTestReport("SLP result cache", check_cache((PSLPHandleInfo)hslp));
+
+    SLPClose(hslp);
+
+    return SLPTestExit();
+}
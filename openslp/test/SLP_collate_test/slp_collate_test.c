@@ -0,0 +1,110 @@
+/* Checks the hash set libslp collates service URLs and service types in:
+ * exact and case folded duplicates, the order items are handed back in,
+ * growth of the hash set and strings longer than an arena chunk.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <slp.h>
+#include <libslp.h>
+#include <slp_test.h>
+
+/* Returns 1 if duplicates were found and order was kept, 0 otherwise. */
+int check_duplicates(void)
+{
+    SLPCollation    coll;
+    SLPCollatedItem* item;
+
+    memset(&coll, 0, sizeof(coll));
+
+    /* exact compare: case matters */
+    CHECK(SLPCollationAdd(&coll, 0, 14, "service:a://x1") != NULL);
+    CHECK(SLPCollationAdd(&coll, 0, 14, "service:a://x1") == NULL);
+    CHECK(SLPCollationAdd(&coll, 0, 14, "service:A://x1") != NULL);
+    /* only len bytes of str are looked at */
+    CHECK(SLPCollationAdd(&coll, 0, 14, "service:a://x1,") == NULL);
+    CHECK(coll.count == 2 && coll.totallen == 28);
+    SLPCollationFree(&coll);
+
+    /* folded compare: case does not */
+    CHECK(SLPCollationAdd(&coll, 1, 9, "service:a") != NULL);
+    CHECK(SLPCollationAdd(&coll, 1, 9, "SERVICE:A") == NULL);
+    CHECK(SLPCollationAdd(&coll, 1, 9, "service:b") != NULL);
+    CHECK(SLPCollationAdd(&coll, 1, 9, "Service:C") != NULL);
+    CHECK(coll.count == 3);
+
+    /* items come back in the order they were added */
+    item = coll.first;
+    CHECK(item && memcmp(item->str, "service:a", 9) == 0);
+    item = item->next;
+    CHECK(item && memcmp(item->str, "service:b", 9) == 0);
+    item = item->next;
+    CHECK(item && memcmp(item->str, "Service:C", 9) == 0);
+    CHECK(item == coll.last && item->next == NULL);
+
+    /* freeing leaves an empty collation that can be used again */
+    SLPCollationFree(&coll);
+    CHECK(coll.count == 0 && coll.first == NULL && coll.buckets == NULL);
+    CHECK(SLPCollationAdd(&coll, 1, 9, "service:a") != NULL);
+    SLPCollationFree(&coll);
+
+    return 1;
+}
+
+/* Returns 1 if a large collation grew and kept every item, 0 otherwise. */
+int check_growth(void)
+{
+    SLPCollation    coll;
+    SLPCollatedItem* item;
+    char            url[64];
+    char            big[10000];
+    int             i;
+
+    memset(&coll, 0, sizeof(coll));
+
+    CHECK(SLPCollationReserve(&coll, 100) == 0);
+    CHECK(coll.bucketcount >= 134);
+    for(i = 0; i < 5000; i++)
+    {
+        sprintf(url, "service:test://host%d", i);
+        CHECK(SLPCollationAdd(&coll, 0, strlen(url), url) != NULL);
+    }
+    for(i = 4999; i >= 0; i--)
+    {
+        sprintf(url, "service:test://host%d", i);
+        CHECK(SLPCollationAdd(&coll, 0, strlen(url), url) == NULL);
+    }
+    CHECK(coll.count == 5000 && coll.count * 4 < coll.bucketcount * 3);
+
+    i = 0;
+    for(item = coll.first; item; item = item->next)
+    {
+        sprintf(url, "service:test://host%d", i);
+        CHECK(item->len == (int)strlen(url));
+        CHECK(memcmp(item->str, url, item->len) == 0);
+        i++;
+    }
+    CHECK(i == 5000);
+
+    /* strings bigger than an arena chunk */
+    memset(big, 'x', sizeof(big));
+    memcpy(big, "service:big://", 14);
+    CHECK(SLPCollationAdd(&coll, 0, sizeof(big), big) != NULL);
+    CHECK(SLPCollationAdd(&coll, 0, sizeof(big), big) == NULL);
+    CHECK(memcmp(coll.last->str, big, sizeof(big)) == 0);
+    CHECK(SLPCollationAdd(&coll, 0, 8, "service:") != NULL);
+
+    SLPCollationFree(&coll);
+    CHECK(coll.chunks == NULL && coll.totallen == 0);
+
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPTestReport("SLPCollation duplicates", check_duplicates());
+    SLPTestReport("SLPCollation growth", check_growth());
+
+    return SLPTestExit();
+}
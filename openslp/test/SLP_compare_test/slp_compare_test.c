@@ -0,0 +1,193 @@
+/* Checks that the folded-key matching used by the slpd database gives the
+ * same answers as SLPCompareString(), SLPCompareSrvType(),
+ * SLPCompareNamingAuth() and SLPIntersectStringList().
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <slp.h>
+#include <slp_compare.h>
+#include <slp_test.h>
+
+static const char* srvtypes[] = {
+    "service:printer:lpr",
+    "SERVICE:Printer:LPR",
+    "service:printer",
+    "Printer:lpr",
+    "service:printer.acme:lpr",
+    "service:printer.ACME",
+    "service:directory-agent",
+    "service:Directory-Agent",
+    "service:printer.acme.org:lpr",
+    "ftp",
+    "FTP",
+    ""
+};
+#define SRVTYPE_COUNT (sizeof(srvtypes) / sizeof(srvtypes[0]))
+
+static const char* namingauths[] = {
+    "",
+    "acme",
+    "ACME",
+    "acme.org",
+    "other"
+};
+#define NAMINGAUTH_COUNT (sizeof(namingauths) / sizeof(namingauths[0]))
+
+static const char* scopelists[] = {
+    "default",
+    "DEFAULT",
+    "default,engineering",
+    "Engineering,finance",
+    "finance,Sales,DEFAULT",
+    "sales",
+    "eng",
+    ""
+};
+#define SCOPELIST_COUNT (sizeof(scopelists) / sizeof(scopelists[0]))
+
+/* Returns 1 if every folded comparison agreed, 0 otherwise. */
+int check_srvtypes(void)
+{
+    SLPFoldedKeys* lkeys;
+    SLPFoldedKeys* rkeys;
+    unsigned int i, j;
+    int expected, got;
+    int result = 1;
+
+    for(i = 0; i < SRVTYPE_COUNT; i++)
+    {
+        lkeys = SLPFoldedKeysCreate(strlen(srvtypes[i]), srvtypes[i],
+                                    0, NULL,
+                                    strlen(srvtypes[i]), srvtypes[i],
+                                    0, NULL);
+        for(j = 0; j < SRVTYPE_COUNT; j++)
+        {
+            rkeys = SLPFoldedKeysCreate(strlen(srvtypes[j]), srvtypes[j],
+                                        0, NULL,
+                                        strlen(srvtypes[j]), srvtypes[j],
+                                        0, NULL);
+
+            expected = SLPCompareSrvType(strlen(srvtypes[i]), srvtypes[i],
+                                         strlen(srvtypes[j]), srvtypes[j]);
+            got = SLPFoldedCompareSrvType(lkeys, rkeys);
+            if((expected == 0) != (got == 0))
+            {
+                printf("SrvType \"%s\" \"%s\": %d != %d\n",
+                       srvtypes[i], srvtypes[j], got, expected);
+                result = 0;
+            }
+
+            expected = SLPCompareString(strlen(srvtypes[i]), srvtypes[i],
+                                        strlen(srvtypes[j]), srvtypes[j]);
+            got = SLPFoldedCompareString(&lkeys->url, &rkeys->url);
+            if((expected == 0) != (got == 0))
+            {
+                printf("String \"%s\" \"%s\": %d != %d\n",
+                       srvtypes[i], srvtypes[j], got, expected);
+                result = 0;
+            }
+
+            SLPFoldedKeysFree(rkeys);
+        }
+        SLPFoldedKeysFree(lkeys);
+    }
+
+    return result;
+}
+
+/* Returns 1 if every folded comparison agreed, 0 otherwise. */
+int check_namingauths(void)
+{
+    SLPFoldedKeys* stkeys;
+    SLPFoldedKeys* nakeys;
+    unsigned int i, j;
+    int expected, got;
+    int result = 1;
+
+    for(i = 0; i < SRVTYPE_COUNT; i++)
+    {
+        stkeys = SLPFoldedKeysCreate(strlen(srvtypes[i]), srvtypes[i],
+                                     0, NULL, 0, NULL, 0, NULL);
+        for(j = 0; j <= NAMINGAUTH_COUNT; j++)
+        {
+            /* the extra round is the "all naming authorities" wildcard */
+            if(j == NAMINGAUTH_COUNT)
+            {
+                nakeys = SLPFoldedKeysCreate(0, NULL, 0xffff, NULL,
+                                             0, NULL, 0, NULL);
+                expected = SLPCompareNamingAuth(strlen(srvtypes[i]),
+                                                srvtypes[i],
+                                                0xffff, NULL);
+            }
+            else
+            {
+                nakeys = SLPFoldedKeysCreate(0, NULL,
+                                             strlen(namingauths[j]),
+                                             namingauths[j],
+                                             0, NULL, 0, NULL);
+                expected = SLPCompareNamingAuth(strlen(srvtypes[i]),
+                                                srvtypes[i],
+                                                strlen(namingauths[j]),
+                                                namingauths[j]);
+            }
+            got = SLPFoldedCompareNamingAuth(stkeys, nakeys);
+            if((expected == 0) != (got == 0))
+            {
+                printf("NamingAuth \"%s\" %u: %d != %d\n",
+                       srvtypes[i], j, got, expected);
+                result = 0;
+            }
+            SLPFoldedKeysFree(nakeys);
+        }
+        SLPFoldedKeysFree(stkeys);
+    }
+
+    return result;
+}
+
+/* Returns 1 if every folded intersection agreed, 0 otherwise. */
+int check_scopes(void)
+{
+    SLPFoldedKeys* keys1;
+    SLPFoldedKeys* keys2;
+    unsigned int i, j;
+    int expected, got;
+    int result = 1;
+
+    for(i = 0; i < SCOPELIST_COUNT; i++)
+    {
+        keys1 = SLPFoldedKeysCreate(0, NULL, 0, NULL, 0, NULL,
+                                    strlen(scopelists[i]), scopelists[i]);
+        for(j = 0; j < SCOPELIST_COUNT; j++)
+        {
+            keys2 = SLPFoldedKeysCreate(0, NULL, 0, NULL, 0, NULL,
+                                        strlen(scopelists[j]),
+                                        scopelists[j]);
+            expected = SLPIntersectStringList(strlen(scopelists[i]),
+                                              scopelists[i],
+                                              strlen(scopelists[j]),
+                                              scopelists[j]);
+            got = SLPFoldedIntersectScopes(keys1, keys2);
+            if(expected != got)
+            {
+                printf("Scopes \"%s\" \"%s\": %d != %d\n",
+                       scopelists[i], scopelists[j], got, expected);
+                result = 0;
+            }
+            SLPFoldedKeysFree(keys2);
+        }
+        SLPFoldedKeysFree(keys1);
+    }
+
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPTestReport("SLPFolded comparisons",
+                  check_srvtypes() & check_namingauths() & check_scopes());
+
+    return SLPTestExit();
+}
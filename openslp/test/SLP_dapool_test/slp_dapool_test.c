@@ -0,0 +1,179 @@
+/* Checks the process-wide pool of idle DA connections: a connection given
+ * back is borrowed again by the next caller for its DA and for no other,
+ * blocking, a connection the DA closed or wrote to is dropped instead of
+ * lent, connections idle past net.slp.DAConnectionIdleTimeout and past
+ * net.slp.DAConnectionPoolSize are closed, and a bad DA takes its idle
+ * connections with it.  The DAs are the other ends of socket pairs.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <slp.h>
+#include <libslp.h>
+#include <slp_test.h>
+
+static struct in_addr   G_DA1;
+static struct in_addr   G_DA2;
+
+/* Makes a connection whose DA end is returned in peer */
+static int Connect(int* peer)
+{
+    int fds[2];
+
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+    {
+        return -1;
+    }
+    *peer = fds[1];
+    return fds[0];
+}
+
+/* Returns 1 if the pool closed the socket */
+static int Closed(int sock)
+{
+    return fcntl(sock, F_GETFD) < 0;
+}
+
+/* Returns 1 if idle connections are lent again to their DA only. */
+int check_reuse(void)
+{
+    int sock1;
+    int sock2;
+    int peer1;
+    int peer2;
+
+    sock1 = Connect(&peer1);
+    sock2 = Connect(&peer2);
+    CHECK(sock1 >= 0 && sock2 >= 0);
+    CHECK(KnownDAPoolGet(&G_DA1) == -1);
+
+    /* an empty pool or another DA's connection lends nothing */
+    fcntl(sock1, F_SETFL, fcntl(sock1, F_GETFL, 0) | O_NONBLOCK);
+    KnownDAPoolPut(sock1, &G_DA1);
+    CHECK(KnownDAPoolGet(&G_DA2) == -1);
+
+    /* borrowed back blocking, and only once */
+    CHECK(KnownDAPoolGet(&G_DA1) == sock1);
+    CHECK((fcntl(sock1, F_GETFL, 0) & O_NONBLOCK) == 0);
+    CHECK(KnownDAPoolGet(&G_DA1) == -1);
+
+    /* the connection given back last is lent first */
+    KnownDAPoolPut(sock1, &G_DA1);
+    KnownDAPoolPut(sock2, &G_DA1);
+    CHECK(KnownDAPoolGet(&G_DA1) == sock2);
+    CHECK(KnownDAPoolGet(&G_DA1) == sock1);
+
+    /* a negative socket is not pooled */
+    KnownDAPoolPut(-1, &G_DA1);
+    CHECK(KnownDAPoolGet(&G_DA1) == -1);
+
+    close(sock1);
+    close(sock2);
+    close(peer1);
+    close(peer2);
+    return 1;
+}
+
+/* Returns 1 if connections with something to read are dropped. */
+int check_health(void)
+{
+    int sock1;
+    int sock2;
+    int sock3;
+    int peer1;
+    int peer2;
+    int peer3;
+
+    sock1 = Connect(&peer1);
+    sock2 = Connect(&peer2);
+    sock3 = Connect(&peer3);
+    CHECK(sock1 >= 0 && sock2 >= 0 && sock3 >= 0);
+
+    /* the DA closed one and sent a stray reply on another, */
+    /* the healthy one behind them is lent                  */
+    KnownDAPoolPut(sock3, &G_DA1);
+    KnownDAPoolPut(sock2, &G_DA1);
+    KnownDAPoolPut(sock1, &G_DA1);
+    close(peer1);
+    CHECK(write(peer2, "x", 1) == 1);
+
+    CHECK(KnownDAPoolGet(&G_DA1) == sock3);
+    CHECK(Closed(sock1) && Closed(sock2));
+    CHECK(KnownDAPoolGet(&G_DA1) == -1);
+
+    close(sock3);
+    close(peer2);
+    close(peer3);
+    return 1;
+}
+
+/* Returns 1 if idle timeout, pool size and bad DAs close connections. */
+int check_limits(void)
+{
+    int socks[3];
+    int peers[3];
+    int i;
+
+    for(i = 0; i < 3; i++)
+    {
+        socks[i] = Connect(&peers[i]);
+        CHECK(socks[i] >= 0);
+    }
+
+    /* the one idle the longest makes room */
+    SLPPropertySet("net.slp.DAConnectionPoolSize", "2");
+    KnownDAPoolPut(socks[0], &G_DA1);
+    KnownDAPoolPut(socks[1], &G_DA2);
+    KnownDAPoolPut(socks[2], &G_DA1);
+    CHECK(Closed(socks[0]));
+    CHECK(KnownDAPoolGet(&G_DA1) == socks[2]);
+    CHECK(KnownDAPoolGet(&G_DA1) == -1);
+
+    /* a bad DA leaves the connections to other DAs alone */
+    KnownDAPoolPut(socks[2], &G_DA1);
+    KnownDABadDA(&G_DA1);
+    CHECK(Closed(socks[2]));
+    CHECK(KnownDAPoolGet(&G_DA2) == socks[1]);
+
+    /* connections idle too long are closed, not lent */
+    socks[0] = Connect(&peers[0]);
+    SLPPropertySet("net.slp.DAConnectionIdleTimeout", "0");
+    KnownDAPoolPut(socks[1], &G_DA2);
+    CHECK(KnownDAPoolGet(&G_DA2) == -1);
+    CHECK(Closed(socks[1]));
+    SLPPropertySet("net.slp.DAConnectionIdleTimeout", "20");
+
+    /* a pool size of 0 turns the pool off */
+    SLPPropertySet("net.slp.DAConnectionPoolSize", "0");
+    KnownDAPoolPut(socks[0], &G_DA1);
+    CHECK(Closed(socks[0]));
+    CHECK(KnownDAPoolGet(&G_DA1) == -1);
+    SLPPropertySet("net.slp.DAConnectionPoolSize", "8");
+
+    for(i = 0; i < 3; i++)
+    {
+        close(peers[i]);
+    }
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    /* load the configuration before overriding it */
+    SLPGetProperty("net.slp.DAConnectionPoolSize");
+    SLPPropertySet("net.slp.DAConnectionPoolSize", "8");
+    SLPPropertySet("net.slp.DAConnectionIdleTimeout", "20");
+
+    G_DA1.s_addr = inet_addr("192.0.2.1");
+    G_DA2.s_addr = inet_addr("192.0.2.2");
+
+    SLPTestReport("reuse", check_reuse());
+    SLPTestReport("health", check_health());
+    SLPTestReport("limits", check_limits());
+
+    return SLPTestExit();
+}
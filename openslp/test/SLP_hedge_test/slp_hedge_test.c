@@ -0,0 +1,147 @@
+/* Checks when libslp hedges a request to a second DA: not before the
+ * first DA is past its usual latency, its smoothed latency plus twice
+ * the mean deviation, not at all for a DA without samples, after
+ * net.slp.DAHedgeDelay when that is set, and never for more than
+ * net.slp.DAHedgeBudget percent of the requests that could be hedged.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <slp.h>
+#include <libslp.h>
+#include <slp_test.h>
+
+static int G_Rqsts = 0;     /* KnownDAHedgeDelay() calls with a budget */
+static int G_Hedges = 0;    /* KnownDAHedgeSpend() calls that said yes */
+
+/* Counts a request that could be hedged and returns its delay */
+static int Delay(struct in_addr* daaddr)
+{
+    G_Rqsts ++;
+    return KnownDAHedgeDelay(daaddr);
+}
+
+/* Spends count hedges and returns how many were allowed */
+static int Spend(int count)
+{
+    int allowed = 0;
+
+    while(count--)
+    {
+        allowed += KnownDAHedgeSpend();
+    }
+    G_Hedges += allowed;
+    return allowed;
+}
+
+/* Returns 1 if the delay follows the DA's latency, 0 otherwise. */
+int check_delay(void)
+{
+    struct in_addr  steady;
+    struct in_addr  jittery;
+    struct in_addr  unknown;
+    int             delay;
+    int             i;
+
+    steady.s_addr = htonl(0x0a000001);
+    jittery.s_addr = htonl(0x0a000002);
+    unknown.s_addr = htonl(0x0a000003);
+
+    /* without a budget nothing is hedged, or counted */
+    SLPPropertySet("net.slp.DAHedgeBudget", "0");
+    KnownDARttReply(&steady, 40);
+    CHECK(KnownDAHedgeDelay(&steady) == 0);
+    CHECK(KnownDAHedgeSpend() == 0);
+
+    SLPPropertySet("net.slp.DAHedgeBudget", "10");
+
+    /* a DA that always takes 40ms is hedged just after that */
+    for(i = 0; i < 30; i++)
+    {
+        KnownDARttReply(&steady, 40);
+    }
+    delay = Delay(&steady);
+    CHECK(delay > 40 && delay <= 45);
+
+    /* one that takes 20 or 60ms only after its slow answers */
+    for(i = 0; i < 30; i++)
+    {
+        KnownDARttReply(&jittery, 20);
+        KnownDARttReply(&jittery, 60);
+    }
+    delay = Delay(&jittery);
+    CHECK(delay > 60 && delay <= 100);
+
+    /* a slower sample raises the delay right away */
+    KnownDARttReply(&steady, 400);
+    CHECK(Delay(&steady) > 80);
+
+    /* nothing to go by, so no hedge */
+    CHECK(Delay(&unknown) == 0);
+
+    /* the configured delay wins over the measured one */
+    SLPPropertySet("net.slp.DAHedgeDelay", "5");
+    CHECK(Delay(&jittery) == 5);
+    CHECK(Delay(&unknown) == 5);
+    SLPPropertySet("net.slp.DAHedgeDelay", "0");
+
+    return 1;
+}
+
+/* Returns 1 if hedges keep to the budget, 0 otherwise. */
+int check_budget(void)
+{
+    struct in_addr  da;
+    int             i;
+
+    da.s_addr = htonl(0x0a000001);
+
+    /* the requests so far earn one hedge, not two */
+    CHECK(G_Rqsts > 0 && G_Rqsts < 10);
+    CHECK(Spend(2) == 1);
+
+    /* the next one is earned by the eleventh request */
+    while(G_Rqsts < 10)
+    {
+        Delay(&da);
+    }
+    CHECK(Spend(1) == 0);
+    Delay(&da);
+    CHECK(Spend(1) == 1);
+
+    /* a burst of hedges never runs past 10% of the requests */
+    for(i = 0; i < 1000; i++)
+    {
+        Delay(&da);
+        Spend(5);
+        CHECK(G_Hedges * 10 <= G_Rqsts + 10);
+    }
+    CHECK(G_Hedges * 10 >= G_Rqsts);
+
+    /* unspent budget is kept for later bursts */
+    for(i = 0; i < 100; i++)
+    {
+        Delay(&da);
+    }
+    CHECK(Spend(20) == 10);
+
+    /* a budget of 0 stops hedging at once */
+    SLPPropertySet("net.slp.DAHedgeBudget", "0");
+    CHECK(Spend(1) == 0);
+    CHECK(KnownDAHedgeDelay(&da) == 0);
+
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    /* load the configuration before overriding it */
+    SLPGetProperty("net.slp.DAHedgeBudget");
+    SLPPropertySet("net.slp.DAHedgeDelay", "0");
+
+    SLPTestReport("delay", check_delay());
+    SLPTestReport("budget", check_budget());
+
+    return SLPTestExit();
+}
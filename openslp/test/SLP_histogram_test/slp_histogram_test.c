@@ -0,0 +1,107 @@
+/* Checks the log-linear latency histogram slpd and slptool keep: small
+ * latencies get a bucket each, bigger ones a bucket at most 12.5% wide,
+ * latencies past the last bucket still count, and percentiles come from
+ * the top of their bucket without ever passing the exact maximum.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <slp_histogram.h>
+#include <slp_test.h>
+
+/* Returns 1 if the totals and the bucket widths hold, 0 otherwise. */
+int check_buckets(void)
+{
+    SLPHistogram hist;
+    unsigned long usecs;
+    unsigned long top;
+    int i;
+
+    memset(&hist, 0, sizeof(hist));
+    CHECK(SLPHistogramPercentile(&hist, 500) == 0);
+
+    /* latencies below 8us are counted exactly */
+    for(i = 0; i < SLP_HISTOGRAM_SUBBUCKETS; i++)
+    {
+        SLPHistogramAdd(&hist, i);
+        CHECK(hist.buckets[i] == 1);
+    }
+    CHECK(hist.count == 8 && hist.total == 28 && hist.max == 7);
+    CHECK(SLPHistogramPercentile(&hist, 500) == 3);
+    CHECK(SLPHistogramPercentile(&hist, 0) == 0);
+    CHECK(SLPHistogramPercentile(&hist, 1000) == 7);
+
+    /* the top of the bucket of a latency is at most 12.5% above it: */
+    /* one slow outlier keeps the maximum from capping the estimate  */
+    for(usecs = 8; usecs < 40000000; usecs += usecs / 7 + 1)
+    {
+        memset(&hist, 0, sizeof(hist));
+        SLPHistogramAdd(&hist, usecs);
+        SLPHistogramAdd(&hist, usecs);
+        SLPHistogramAdd(&hist, 4000000000UL);
+        top = SLPHistogramPercentile(&hist, 500);
+        CHECK(top >= usecs && top - usecs <= usecs / 8);
+    }
+
+    /* past 2^26us everything shares the last bucket */
+    memset(&hist, 0, sizeof(hist));
+    SLPHistogramAdd(&hist, 1UL << 27);
+    SLPHistogramAdd(&hist, 4000000000UL);
+    CHECK(hist.buckets[SLP_HISTOGRAM_BUCKETS - 1] == 2);
+    CHECK(hist.max == 4000000000UL);
+
+    return 1;
+}
+
+/* Returns 1 if percentiles land where they should, 0 otherwise. */
+int check_percentiles(void)
+{
+    SLPHistogram hist;
+    unsigned long p50;
+    unsigned long p90;
+    unsigned long p99;
+    int i;
+
+    memset(&hist, 0, sizeof(hist));
+    for(i = 1000; i > 0; i--)
+    {
+        SLPHistogramAdd(&hist, i);
+    }
+    CHECK(hist.count == 1000 && hist.max == 1000);
+    CHECK(hist.total == 500500);
+
+    p50 = SLPHistogramPercentile(&hist, 500);
+    p90 = SLPHistogramPercentile(&hist, 900);
+    p99 = SLPHistogramPercentile(&hist, 990);
+    CHECK(p50 >= 500 && p50 <= 500 + 500 / 8);
+    CHECK(p90 >= 900 && p90 <= 1000);
+    CHECK(p99 >= 990 && p99 <= 1000);
+    CHECK(SLPHistogramPercentile(&hist, 1000) == 1000);
+
+    /* the maximum caps an estimate from a wide bucket */
+    memset(&hist, 0, sizeof(hist));
+    SLPHistogramAdd(&hist, 1025);
+    CHECK(SLPHistogramPercentile(&hist, 500) == 1025);
+    CHECK(SLPHistogramPercentile(&hist, 990) == 1025);
+
+    /* a rare slow answer shows in the tail only */
+    memset(&hist, 0, sizeof(hist));
+    for(i = 0; i < 99; i++)
+    {
+        SLPHistogramAdd(&hist, 100);
+    }
+    SLPHistogramAdd(&hist, 30000);
+    CHECK(SLPHistogramPercentile(&hist, 990) <= 100 + 100 / 8);
+    CHECK(SLPHistogramPercentile(&hist, 999) == 30000);
+
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPTestReport("buckets", check_buckets());
+    SLPTestReport("percentiles", check_percentiles());
+
+    return SLPTestExit();
+}
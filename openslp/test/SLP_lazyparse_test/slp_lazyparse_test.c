@@ -0,0 +1,253 @@
+/* Checks that SLPMessageParseRouting() followed by
+ * SLPMessageParseRemainder() gives the same message as
+ * SLPMessageParseBuffer(), and times the drop path.
+ *
+ * Usage:
+ *   testslp_lazyparse_test        check the lazy parse
+ *   testslp_lazyparse_test -b     also time a flood of requests that are
+ *                                 dropped after the routing fields
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <slp.h>
+#include <slp_buffer.h>
+#include <slp_message.h>
+#include <slp_test.h>
+
+#define ROUNDS 200000
+
+#define PRLIST    "10.0.0.1,10.0.0.2,10.0.0.3,10.0.0.4,192.168.1.20"
+#define SRVTYPE   "service:printer:lpr"
+#define SCOPES    "engineering,finance"
+#define PREDICATE "(&(location=building 14*)(pages-per-minute>=30)" \
+                  "(color-supported=true)(!(x-vendor-extension=none))" \
+                  "(|(paper=a4)(paper=letter)(paper=legal)))"
+#define SPISTR    "openslp-test-spi"
+#define TAGLIST   "location,pages-per-minute,color-supported"
+#define URL       "service:printer:lpr://printer.example.com:515/queue"
+
+static unsigned char* put_string(unsigned char* cur, const char* str)
+{
+    int len = strlen(str);
+
+    ToUINT16((char*)cur, len);
+    memcpy(cur + 2, str, len);
+    return cur + 2 + len;
+}
+
+/* Builds a request with an optional extension behind it.
+ *
+ * Returns the buffer or NULL on ENOMEM.
+ */
+SLPBuffer build_request(int functionid, int withext)
+{
+    SLPBuffer buf;
+    unsigned char* cur;
+    int extoffset = 0;
+
+    buf = SLPBufferAlloc(1024);
+    if(buf == NULL)
+    {
+        return NULL;
+    }
+
+    cur = buf->start + 12;
+    cur = put_string(cur, "en");
+    cur = put_string(cur, PRLIST);
+    if(functionid == SLP_FUNCT_SRVRQST)
+    {
+        cur = put_string(cur, SRVTYPE);
+        cur = put_string(cur, SCOPES);
+        cur = put_string(cur, PREDICATE);
+    }
+    else
+    {
+        cur = put_string(cur, URL);
+        cur = put_string(cur, SCOPES);
+        cur = put_string(cur, TAGLIST);
+    }
+    cur = put_string(cur, SPISTR);
+
+    if(withext)
+    {
+        /* an optional extension nobody knows about */
+        extoffset = cur - buf->start;
+        ToUINT16((char*)cur, 0x1234);
+        ToUINT24((char*)cur + 2, 0);
+        ToUINT32((char*)cur + 5, 0xdeadbeef);
+        cur += 9;
+    }
+
+    buf->start[0] = 2;
+    buf->start[1] = functionid;
+    ToUINT24((char*)buf->start + 2, cur - buf->start);
+    ToUINT16((char*)buf->start + 5, SLP_FLAG_MCAST);
+    ToUINT24((char*)buf->start + 7, extoffset);
+    ToUINT16((char*)buf->start + 10, 1234);
+    buf->end = cur;
+
+    return buf;
+}
+
+/* Returns 1 if the lazy parse of functionid matched the full parse,
+ * 0 otherwise.
+ */
+int check_request(int functionid, int withext)
+{
+    struct sockaddr_in peer;
+    SLPBuffer buf;
+    SLPMessage full;
+    SLPMessage lazy;
+    int result = 1;
+
+    memset(&peer, 0, sizeof(peer));
+    buf = build_request(functionid, withext);
+    full = SLPMessageAlloc();
+    lazy = SLPMessageAlloc();
+
+    if(SLPMessageParseBuffer(&peer, buf, full) != 0 ||
+       SLPMessageParseRouting(&peer, buf, lazy) != 0)
+    {
+        result = 0;
+    }
+    else
+    {
+        /* the routing fields are there before the rest is parsed */
+        if(functionid == SLP_FUNCT_SRVRQST)
+        {
+            if(lazy->body.srvrqst.prlistlen != full->body.srvrqst.prlistlen ||
+               lazy->body.srvrqst.srvtype != full->body.srvrqst.srvtype ||
+               lazy->body.srvrqst.scopelist != full->body.srvrqst.scopelist)
+            {
+                result = 0;
+            }
+        }
+        else
+        {
+            if(lazy->body.attrrqst.prlistlen != full->body.attrrqst.prlistlen ||
+               lazy->body.attrrqst.url != full->body.attrrqst.url ||
+               lazy->body.attrrqst.scopelist != full->body.attrrqst.scopelist)
+            {
+                result = 0;
+            }
+        }
+
+        /* move curpos away to make sure the remainder does not use it */
+        buf->curpos = buf->start;
+        if(SLPMessageParseRemainder(buf, lazy) != 0 ||
+           memcmp(&full->header, &lazy->header, sizeof(full->header)) != 0 ||
+           memcmp(&full->body, &lazy->body, sizeof(full->body)) != 0)
+        {
+            result = 0;
+        }
+
+        /* a second call has nothing left to do */
+        if(SLPMessageParseRemainder(buf, lazy) != 0)
+        {
+            result = 0;
+        }
+    }
+
+    SLPMessageFree(full);
+    SLPMessageFree(lazy);
+    SLPBufferFree(buf);
+
+    return result;
+}
+
+/* Returns 1 if a request truncated in its predicate is only rejected
+ * by SLPMessageParseRemainder(), 0 otherwise.
+ */
+int check_truncated(void)
+{
+    struct sockaddr_in peer;
+    SLPBuffer buf;
+    SLPMessage msg;
+    int result = 1;
+
+    memset(&peer, 0, sizeof(peer));
+    buf = build_request(SLP_FUNCT_SRVRQST, 0);
+    msg = SLPMessageAlloc();
+
+    /* cut the message in the middle of the predicate */
+    buf->end -= strlen(SPISTR) + 2 + 10;
+    ToUINT24((char*)buf->start + 2, buf->end - buf->start);
+
+    if(SLPMessageParseRouting(&peer, buf, msg) != 0 ||
+       SLPMessageParseRemainder(buf, msg) != SLP_ERROR_PARSE_ERROR ||
+       SLPMessageParseBuffer(&peer, buf, msg) != SLP_ERROR_PARSE_ERROR)
+    {
+        result = 0;
+    }
+
+    SLPMessageFree(msg);
+    SLPBufferFree(buf);
+
+    return result;
+}
+
+static double elapsed_ns(struct timeval* start, struct timeval* end)
+{
+    return ((end->tv_sec - start->tv_sec) * 1e6 +
+            (end->tv_usec - start->tv_usec)) * 1e3 / ROUNDS;
+}
+
+/* Times parsing a request that is dropped because of its prlist. */
+void benchmark(void)
+{
+    struct sockaddr_in peer;
+    struct timeval start, end;
+    SLPBuffer buf;
+    SLPMessage msg;
+    int i;
+    int parsed = 0;
+
+    memset(&peer, 0, sizeof(peer));
+    buf = build_request(SLP_FUNCT_SRVRQST, 1);
+    msg = SLPMessageAlloc();
+
+    gettimeofday(&start, NULL);
+    for(i = 0; i < ROUNDS; i++)
+    {
+        parsed += SLPMessageParseBuffer(&peer, buf, msg) == 0;
+    }
+    gettimeofday(&end, NULL);
+    printf("full parse:    %6.1f ns/request\n", elapsed_ns(&start, &end));
+
+    gettimeofday(&start, NULL);
+    for(i = 0; i < ROUNDS; i++)
+    {
+        parsed += SLPMessageParseRouting(&peer, buf, msg) == 0;
+    }
+    gettimeofday(&end, NULL);
+    printf("routing parse: %6.1f ns/request\n", elapsed_ns(&start, &end));
+
+    if(parsed != 2 * ROUNDS)
+    {
+        printf("parse failed\n");
+    }
+
+    SLPMessageFree(msg);
+    SLPBufferFree(buf);
+}
+
+int main(int argc, char* argv[])
+{
+    SLPTestReport("SLPMessageParseRouting/SLPMessageParseRemainder",
+                  check_request(SLP_FUNCT_SRVRQST, 0) &&
+                  check_request(SLP_FUNCT_SRVRQST, 1) &&
+                  check_request(SLP_FUNCT_ATTRRQST, 0) &&
+                  check_request(SLP_FUNCT_ATTRRQST, 1) &&
+                  check_truncated());
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0)
+    {
+        benchmark();
+    }
+
+    return SLPTestExit();
+}
@@ -0,0 +1,151 @@
+/* Checks the SLPBuffer and SLPMessage free-list pools: reuse, statistics,
+ * trimming and that SLPBufferRealloc() keeps the contents of a buffer
+ * that moves to a bigger size class.  Also checks buffers shared with
+ * SLPBufferRef().
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <slp.h>
+#include <slp_buffer.h>
+#include <slp_message.h>
+#include <slp_test.h>
+
+/* Returns 1 if the buffer pools behaved, 0 otherwise. */
+int check_buffers(void)
+{
+    SLPPoolStats stats;
+    SLPBuffer buf1;
+    SLPBuffer buf2;
+
+    SLPBufferPoolSetLimit(4);
+
+    /* 1400 bytes comes from the 2k class */
+    buf1 = SLPBufferAlloc(1400);
+    CHECK(buf1 != NULL && buf1->end - buf1->start == 1400);
+    CHECK(SLPBufferPoolGetStats(5, &stats) == 2048);
+    CHECK(stats.allocs == 1 && stats.hits == 0 && stats.inuse == 1);
+
+    /* a freed buffer is handed out again */
+    SLPBufferFree(buf1);
+    buf2 = SLPBufferAlloc(1100);
+    CHECK(buf2 == buf1);
+    SLPBufferPoolGetStats(5, &stats);
+    CHECK(stats.hits == 1 && stats.pooled == 0 && stats.maxinuse == 1);
+
+    /* growing into a bigger class keeps the contents (debug builds */
+    /* scribble over reallocated buffers)                           */
+    memcpy(buf2->start, "service:test", 12);
+    buf2 = SLPBufferRealloc(buf2, 3000);
+    CHECK(buf2 != NULL);
+#if(!defined DEBUG)
+    CHECK(memcmp(buf2->start, "service:test", 12) == 0);
+#endif
+    CHECK(buf2->end - buf2->start == 3000);
+    SLPBufferPoolGetStats(5, &stats);
+    CHECK(stats.inuse == 0 && stats.pooled == 1);
+
+    /* shrinking never reallocates */
+    CHECK(SLPBufferRealloc(buf2, 100) == buf2);
+    SLPBufferFree(buf2);
+
+    /* oversized buffers bypass the pools */
+    buf1 = SLPBufferAlloc(100000);
+    CHECK(buf1 != NULL);
+    buf1 = SLPBufferRealloc(buf1, 200000);
+    CHECK(buf1 != NULL);
+    SLPBufferFree(buf1);
+
+    /* the first trim only records what was idle, the second releases it */
+    SLPBufferPoolTrim();
+    SLPBufferPoolTrim();
+    SLPBufferPoolGetStats(5, &stats);
+    CHECK(stats.pooled == 0 && stats.trimmed == 1);
+
+    CHECK(SLPBufferPoolGetStats(SLP_BUFFER_POOL_CLASSES, &stats) == 0);
+
+    SLPBufferPoolSetLimit(0);
+    return 1;
+}
+
+/* Returns 1 if the message pool behaved, 0 otherwise. */
+int check_messages(void)
+{
+    SLPPoolStats stats;
+    SLPMessage msg1;
+    SLPMessage msg2;
+
+    SLPMessagePoolSetLimit(2);
+
+    msg1 = SLPMessageAlloc();
+    CHECK(msg1 != NULL);
+    msg1->header.xid = 42;
+    SLPMessageFree(msg1);
+
+    /* reused and cleared */
+    msg2 = SLPMessageAlloc();
+    CHECK(msg2 == msg1 && msg2->header.xid == 0);
+    SLPMessagePoolGetStats(&stats);
+    CHECK(stats.allocs == 2 && stats.hits == 1 && stats.inuse == 1);
+    SLPMessageFree(msg2);
+
+    /* turning the pool off releases it */
+    SLPMessagePoolSetLimit(0);
+    SLPMessagePoolGetStats(&stats);
+    CHECK(stats.pooled == 0 && stats.inuse == 0);
+
+    return 1;
+}
+
+/* Returns 1 if references to a shared buffer behaved, 0 otherwise. */
+int check_refs(void)
+{
+    SLPPoolStats stats;
+    SLPBuffer buf;
+    SLPBuffer ref1;
+    SLPBuffer ref2;
+
+    SLPBufferPoolSetLimit(4);
+
+    buf = SLPBufferAlloc(12);
+    memcpy(buf->start, "service:test", 12);
+
+    /* references share the data but have their own cursor */
+    ref1 = SLPBufferRef(buf);
+    ref2 = SLPBufferRef(ref1);
+    CHECK(ref1 != NULL && ref2 != NULL);
+    CHECK(ref1->start == buf->start && ref2->start == buf->start);
+    CHECK(buf->refcount == 2 && ref2->shared == buf);
+    ref1->curpos += 4;
+    CHECK(ref2->curpos == ref2->start && buf->curpos == buf->start);
+
+    /* the data outlives the buffer it was shared from */
+    SLPBufferFree(buf);
+    CHECK(memcmp(ref1->start, "service:test", 12) == 0);
+
+    /* writing needs a private copy */
+    ref1 = SLPBufferRealloc(ref1, 100);
+    CHECK(ref1 != NULL && ref1->start != ref2->start);
+    CHECK(ref1->shared == NULL && ref1->refcount == 0);
+    SLPBufferFree(ref1);
+
+    /* the last reference gives the data back to the pool */
+    SLPBufferPoolGetStats(0, &stats);
+    CHECK(stats.inuse == 1);
+    SLPBufferFree(ref2);
+    SLPBufferPoolGetStats(0, &stats);
+    CHECK(stats.inuse == 0);
+
+    SLPBufferPoolSetLimit(0);
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPTestReport("SLPBuffer/SLPMessage pools",
+                  check_buffers() && check_messages());
+    SLPTestReport("SLPBufferRef", check_refs());
+
+    return SLPTestExit();
+}
@@ -0,0 +1,174 @@
+/* Checks the per-peer round trip time estimate and the connects it times:
+ * the estimate follows the samples the way TCP's does, a connect to a
+ * listener adds a sample, and a connect whose SYNs are dropped is retried
+ * instead of waiting out the whole timeout on one attempt.  Also checks
+ * that requests go to the DA that answers fastest and are hedged to the
+ * next fastest.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <slp.h>
+#include <libslp.h>
+#include <slp_test.h>
+
+/* internal to libslp_knownda.c */
+extern int KnownDAAdd(SLPMessage msg, SLPBuffer buf);
+extern SLPBoolean KnownDAListFind(int scopelistlen,
+                                  const char* scopelist,
+                                  int spistrlen,
+                                  const char* spistr,
+                                  struct in_addr* exclude,
+                                  struct in_addr* daaddr);
+
+static int TestEstimate()
+{
+    struct in_addr  addr;
+    int             i;
+
+    addr.s_addr = htonl(0x0a000001);
+    CHECK(KnownDARttTimeout(&addr) == 0);
+
+    /* SRTT = 200, RTTVAR = 100: SRTT + 4 * RTTVAR */
+    KnownDARttSample(&addr,200);
+    CHECK(KnownDARttTimeout(&addr) == 600);
+
+    /* a steady peer converges on its RTT, never below the minimum */
+    for(i = 0; i < 50; i++)
+    {
+        KnownDARttSample(&addr,200);
+    }
+    CHECK(KnownDARttTimeout(&addr) < 210);
+    for(i = 0; i < 50; i++)
+    {
+        KnownDARttSample(&addr,1);
+    }
+    CHECK(KnownDARttTimeout(&addr) == 50);
+
+    /* one slow answer widens it again */
+    KnownDARttSample(&addr,400);
+    CHECK(KnownDARttTimeout(&addr) > 400);
+
+    return 1;
+}
+
+static int Listen(struct sockaddr_in* addr, int backlog)
+{
+    socklen_t   len = sizeof(*addr);
+    int         sock;
+
+    memset(addr,0,sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sock = socket(AF_INET,SOCK_STREAM,0);
+    if(sock < 0 ||
+       bind(sock,(struct sockaddr*)addr,sizeof(*addr)) ||
+       listen(sock,backlog) ||
+       getsockname(sock,(struct sockaddr*)addr,&len))
+    {
+        return -1;
+    }
+    return sock;
+}
+
+static int TestConnect()
+{
+    struct sockaddr_in  addr;
+    struct timeval      timeout;
+    int                 listener;
+    int                 filler;
+    int                 sock;
+    int                 retransmits;
+    int                 spurious;
+    int                 before;
+
+    timeout.tv_sec = 2;
+    timeout.tv_usec = 0;
+
+    /* an answered connect is timed */
+    listener = Listen(&addr,5);
+    CHECK(listener >= 0);
+    sock = NetworkConnectStream(&addr,&timeout);
+    CHECK(sock >= 0);
+    CHECK(KnownDARttTimeout(&addr.sin_addr) == 50);
+    close(sock);
+    close(listener);
+
+    /* nobody listening is an error right away, not a time out */
+    sock = NetworkConnectStream(&addr,&timeout);
+    CHECK(sock < 0);
+
+    /* a full accept queue drops the SYNs, so the connect is retried */
+    listener = Listen(&addr,0);
+    CHECK(listener >= 0);
+    filler = NetworkConnectStream(&addr,&timeout);
+    CHECK(filler >= 0);
+    KnownDARttCounters(&before,&spurious);
+    timeout.tv_sec = 1;
+    sock = NetworkConnectStream(&addr,&timeout);
+    if(sock >= 0)
+    {
+        /* the queue held another one after all */
+        close(sock);
+    }
+    KnownDARttCounters(&retransmits,&spurious);
+    CHECK(sock >= 0 || retransmits > before);
+    close(filler);
+    close(listener);
+
+    return 1;
+}
+
+static int AddDA(struct in_addr* addr, const char* url)
+{
+    SLPMessage  msg;
+
+    msg = SLPMessageAlloc();
+    if(msg == 0)
+    {
+        return -1;
+    }
+    msg->peer.sin_family = AF_INET;
+    msg->peer.sin_addr = *addr;
+    msg->body.daadvert.url = url;
+    msg->body.daadvert.urllen = strlen(url);
+    msg->body.daadvert.scopelist = "default";
+    msg->body.daadvert.scopelistlen = 7;
+    return KnownDAAdd(msg,SLPBufferAlloc(1));
+}
+
+static int TestSelect()
+{
+    struct in_addr  fast;
+    struct in_addr  slow;
+    struct in_addr  daaddr;
+    int             i;
+
+    fast.s_addr = htonl(0x0a000002);
+    slow.s_addr = htonl(0x0a000003);
+    CHECK(AddDA(&slow,"service:directory-agent://10.0.0.3") == 0);
+    CHECK(AddDA(&fast,"service:directory-agent://10.0.0.2") == 0);
+    for(i = 0; i < 20; i++)
+    {
+        KnownDARttReply(&slow,200);
+        KnownDARttReply(&fast,20);
+    }
+
+    /* the fastest DA is asked, the other is the hedge */
+    CHECK(KnownDAListFind(7,"default",0,0,0,&daaddr));
+    CHECK(daaddr.s_addr == fast.s_addr);
+    CHECK(KnownDAListFind(7,"default",0,0,&fast,&daaddr));
+    CHECK(daaddr.s_addr == slow.s_addr);
+
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPTestReport("estimate", TestEstimate());
+    SLPTestReport("connect", TestConnect());
+    SLPTestReport("select", TestSelect());
+
+    return SLPTestExit();
+}
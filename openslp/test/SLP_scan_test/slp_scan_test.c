@@ -0,0 +1,211 @@
+/* Tests (and times) the SLPScanSpecial() kernels used by the escape,
+ * unescape and attribute parsing code.
+ *
+ * Usage:
+ *   testslp_scan_test        check every kernel against the scalar one
+ *   testslp_scan_test -b     also run the microbenchmark
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <slp.h>
+#include <slp_compare.h>
+#include <slp_test.h>
+
+#define BUF_LEN 512
+#define ROUNDS 20000
+
+/* Typical inputs: an attribute list and a scope list. */
+#define ATTR_INPUT "(service-high-availability-group=primary-datacenter-east)," \
+                   "(description=Network attached printer on the third floor)," \
+                   "(location=building 14 room 301),(color-supported=true)," \
+                   "(pages-per-minute=45),(x-vendor-extension=abcdefghijklmnop)"
+#define SCOPE_INPUT "default,engineering-east,engineering-west,finance," \
+                    "human-resources,marketing-and-communications,operations," \
+                    "research-and-development,sales-north-america,support"
+
+static const int kernels[] = { SLP_SCAN_KERNEL_SCALAR,
+                               SLP_SCAN_KERNEL_SSE2,
+                               SLP_SCAN_KERNEL_AVX2 };
+static const char* kernel_names[] = { "best", "scalar", "sse2", "avx2" };
+
+/* Checks one kernel against the scalar kernel on random data.
+ *
+ * Returns 1 if every scan agreed, 0 otherwise.
+ */
+int check_kernel(int kernel)
+{
+    char buf[BUF_LEN];
+    const char* expected;
+    const char* got;
+    int round, start, end, i;
+
+    srand(kernel);
+    for(round = 0; round < ROUNDS; round++)
+    {
+        /* Mostly ordinary characters with the occasional special one. */
+        for(i = 0; i < BUF_LEN; i++)
+        {
+            buf[i] = (rand() % 40) ? 'a' + rand() % 26 : rand() % 256;
+        }
+        start = rand() % BUF_LEN;
+        end = start + rand() % (BUF_LEN - start + 1);
+
+        SLPScanSetKernel(SLP_SCAN_KERNEL_SCALAR);
+        expected = SLPScanSpecial(buf + start, buf + end);
+        SLPScanSetKernel(kernel);
+        got = SLPScanSpecial(buf + start, buf + end);
+        if(got != expected)
+        {
+            return 0;
+        }
+    }
+
+    /* Every byte value on its own, in every lane position. */
+    for(i = 0; i < 256; i++)
+    {
+        for(start = 0; start < 32; start++)
+        {
+            memset(buf, 'x', 64);
+            buf[start] = (char)i;
+            SLPScanSetKernel(SLP_SCAN_KERNEL_SCALAR);
+            expected = SLPScanSpecial(buf, buf + 64);
+            SLPScanSetKernel(kernel);
+            got = SLPScanSpecial(buf, buf + 64);
+            if(got != expected)
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* Checks that SLPEscape() and SLPUnescape() round trip.
+ *
+ * Returns 1 on success, 0 otherwise.
+ */
+int check_escape(const char* str)
+{
+    char* escaped;
+    char* unescaped;
+    int result;
+
+    if(SLPEscape(str, &escaped, SLP_FALSE) != SLP_OK)
+    {
+        return 0;
+    }
+    if(SLPUnescape(escaped, &unescaped, SLP_FALSE) != SLP_OK)
+    {
+        SLPFree(escaped);
+        return 0;
+    }
+    result = (strcmp(str, unescaped) == 0);
+    SLPFree(escaped);
+    SLPFree(unescaped);
+    return result;
+}
+
+double elapsed_ns(struct timeval* start, int count)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return ((now.tv_sec - start->tv_sec) * 1e9 +
+            (now.tv_usec - start->tv_usec) * 1e3) / count;
+}
+
+/* Times a full walk over str, stopping at every special character. */
+void bench_scan(const char* name, const char* str)
+{
+    struct timeval start;
+    const char* end = str + strlen(str);
+    const char* cur;
+    int i, k, installed, hits;
+
+    for(k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); k++)
+    {
+        installed = SLPScanSetKernel(kernels[k]);
+        if(installed != kernels[k])
+        {
+            continue;
+        }
+        hits = 0;
+        gettimeofday(&start, NULL);
+        for(i = 0; i < ROUNDS * 10; i++)
+        {
+            cur = SLPScanSpecial(str, end);
+            while(cur < end)
+            {
+                hits++;
+                cur = SLPScanSpecial(cur + 1, end);
+            }
+        }
+        printf("  %-6s %-7s %8.1f ns/scan (%d specials)\n",
+               kernel_names[installed], name,
+               elapsed_ns(&start, ROUNDS * 10), hits / (ROUNDS * 10));
+    }
+}
+
+/* Times SLPEscape() of an unescaped attribute value. */
+void bench_escape(const char* str)
+{
+    struct timeval start;
+    char* escaped;
+    int i, k, installed;
+
+    for(k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); k++)
+    {
+        installed = SLPScanSetKernel(kernels[k]);
+        if(installed != kernels[k])
+        {
+            continue;
+        }
+        gettimeofday(&start, NULL);
+        for(i = 0; i < ROUNDS; i++)
+        {
+            SLPEscape(str, &escaped, SLP_FALSE);
+            SLPFree(escaped);
+        }
+        printf("  %-6s %-7s %8.1f ns/call\n", kernel_names[installed],
+               "escape", elapsed_ns(&start, ROUNDS));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int k, installed;
+    int ok = 1;
+
+    for(k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); k++)
+    {
+        /* Kernels the compiler or cpu do not support fall back to one
+         * that is, which is then checked again. */
+        installed = SLPScanSetKernel(kernels[k]);
+        if(check_kernel(installed) == 0)
+        {
+            printf("SLPScanSpecial %s kernel disagrees with scalar\n",
+                   kernel_names[installed]);
+            ok = 0;
+        }
+    }
+    SLPTestReport("SLPScanSpecial kernels", ok);
+
+    SLPScanSetKernel(SLP_SCAN_KERNEL_BEST);
+    SLPTestReport("SLPEscape/SLPUnescape round trip",
+                  check_escape(ATTR_INPUT) && check_escape(SCOPE_INPUT) &&
+                  check_escape("\\back\\slash (and) <all> the ~rest!,\x01\x7f"));
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0)
+    {
+        printf("Microbenchmark:\n");
+        bench_scan("attrs", ATTR_INPUT);
+        bench_scan("scopes", SCOPE_INPUT);
+        bench_escape(ATTR_INPUT);
+    }
+
+    return SLPTestExit();
+}
@@ -0,0 +1,457 @@
+/* Checks how libslp answers from the snapshot of registrations slpd
+ * publishes: only a DA's live snapshot for all requested scopes answers,
+ * expired entries and other service types and scopes are left out, a
+ * callback that returns SLP_FALSE hears nothing more, not even
+ * SLP_LAST_CALL, and a snapshot slpd is writing is never read torn.  The
+ * test plays slpd and writes SLP_SNAPSHOT_FILE itself, it is skipped
+ * when that file can not be written or a live slpd owns it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <slp.h>
+#include <libslp.h>
+#include <slp_snapshot.h>
+#include <slp_test.h>
+
+#define SNAPSHOT_SIZE   8192
+
+static SLPSnapshotHeader*   G_Snapshot;
+static char                 G_Body[SNAPSHOT_SIZE];
+static int                  G_BodyLen;
+static int                  G_Count;
+
+static int                  G_Urls;
+static int                  G_LastCalls;
+static int                  G_Lifetime;
+static int                  G_StopAfter;
+static char                 G_Url[256];
+static char                 G_Attrs[256];
+
+static SLPBoolean SrvURLCallback(SLPHandle hSLP,
+                                 const char* pcSrvURL,
+                                 unsigned short sLifetime,
+                                 SLPError errCode,
+                                 void *pvCookie)
+{
+    if(errCode == SLP_OK)
+    {
+        G_Urls ++;
+        G_Lifetime = sLifetime;
+        strncpy(G_Url, pcSrvURL, sizeof(G_Url) - 1);
+        return G_Urls == G_StopAfter ? SLP_FALSE : SLP_TRUE;
+    }
+    if(errCode == SLP_LAST_CALL)
+    {
+        G_LastCalls ++;
+    }
+    return SLP_TRUE;
+}
+
+static SLPBoolean AttrCallback(SLPHandle hSLP,
+                               const char* pcAttrList,
+                               SLPError errCode,
+                               void *pvCookie)
+{
+    if(errCode == SLP_OK)
+    {
+        G_Urls ++;
+        strncpy(G_Attrs, pcAttrList, sizeof(G_Attrs) - 1);
+        return G_StopAfter ? SLP_FALSE : SLP_TRUE;
+    }
+    if(errCode == SLP_LAST_CALL)
+    {
+        G_LastCalls ++;
+    }
+    return SLP_TRUE;
+}
+
+/* Starts a new list of entries for Publish() */
+static void BodyStart(void)
+{
+    G_BodyLen = 0;
+    G_Count = 0;
+}
+
+/* Adds an entry the way slpd lays it out, expires is relative to now */
+static void BodyAdd(const char* srvtype, const char* url,
+                    const char* scopes, const char* attrs, long expires)
+{
+    SLPSnapshotEntry    entry;
+    SLPFoldedKeys*      keys;
+    char*               cur;
+
+    memset(&entry, 0, sizeof(entry));
+    keys = SLPFoldedKeysCreate(strlen(srvtype), srvtype, 0, NULL,
+                               strlen(url), url, 0, NULL);
+    entry.srvtypehash = keys->srvtype.hash;
+    entry.abstracttypehash = keys->abstracttype.hash;
+    entry.urlhash = keys->url.hash;
+    SLPFoldedKeysFree(keys);
+    entry.expires = expires ? (uint32_t)(time(0) + expires) : 0;
+    entry.urllen = strlen(url);
+    entry.srvtypelen = strlen(srvtype);
+    entry.scopelistlen = strlen(scopes);
+    entry.attrlistlen = strlen(attrs);
+
+    cur = G_Body + G_BodyLen;
+    memset(cur, 0, SLP_SNAPSHOT_ENTRY_SIZE(entry.urllen, entry.srvtypelen,
+                                           entry.scopelistlen,
+                                           entry.attrlistlen));
+    memcpy(cur, &entry, sizeof(entry));
+    cur += sizeof(entry);
+    memcpy(cur, url, entry.urllen);
+    cur += entry.urllen;
+    memcpy(cur, srvtype, entry.srvtypelen);
+    cur += entry.srvtypelen;
+    memcpy(cur, scopes, entry.scopelistlen);
+    cur += entry.scopelistlen;
+    memcpy(cur, attrs, entry.attrlistlen);
+
+    G_BodyLen += SLP_SNAPSHOT_ENTRY_SIZE(entry.urllen, entry.srvtypelen,
+                                         entry.scopelistlen,
+                                         entry.attrlistlen);
+    G_Count ++;
+}
+
+/* Publishes the entries like slpd: odd generation, rewrite, even again */
+static void Publish(int isDA, const char* scopes)
+{
+    char*   cur;
+    int     scopelen;
+
+    scopelen = strlen(scopes);
+    G_Snapshot->generation ++;
+    SLP_SNAPSHOT_BARRIER();
+
+    G_Snapshot->isDA = isDA;
+    G_Snapshot->scopelistlen = scopelen;
+    cur = (char*)(G_Snapshot + 1);
+    memset(cur, 0, SLP_SNAPSHOT_ALIGN(scopelen));
+    memcpy(cur, scopes, scopelen);
+    cur += SLP_SNAPSHOT_ALIGN(scopelen);
+    memcpy(cur, G_Body, G_BodyLen);
+    G_Snapshot->count = G_Count;
+    G_Snapshot->used = cur + G_BodyLen - (char*)G_Snapshot;
+    G_Snapshot->heartbeat = time(0);
+
+    SLP_SNAPSHOT_BARRIER();
+    G_Snapshot->generation ++;
+}
+
+/* Creates and maps SLP_SNAPSHOT_FILE, 0 if the test can not own it */
+static int SnapshotOpen(void)
+{
+    SLPSnapshotHeader   hdr;
+    void*               map;
+    int                 fd;
+
+    fd = open(SLP_SNAPSHOT_FILE, O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+    {
+        return 0;
+    }
+
+    /* leave the snapshot of a running slpd alone */
+    if(read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+       hdr.magic == SLP_SNAPSHOT_MAGIC &&
+       hdr.generation != SLP_SNAPSHOT_DEAD &&
+       time(0) - (time_t)hdr.heartbeat <= SLP_SNAPSHOT_STALE)
+    {
+        close(fd);
+        return 0;
+    }
+
+    if(ftruncate(fd, SNAPSHOT_SIZE))
+    {
+        close(fd);
+        return 0;
+    }
+    map = mmap(0, SNAPSHOT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    G_Snapshot = (SLPSnapshotHeader*)map;
+    memset(G_Snapshot, 0, sizeof(SLPSnapshotHeader));
+    G_Snapshot->magic = SLP_SNAPSHOT_MAGIC;
+    G_Snapshot->size = SNAPSHOT_SIZE;
+    G_Snapshot->used = sizeof(SLPSnapshotHeader);
+    G_Snapshot->heartbeat = time(0);
+    return 1;
+}
+
+/* Points the handle at a SrvRqst, like SLPFindSrvs() does */
+static void SetSrvRqst(PSLPHandleInfo handle, const char* srvtype,
+                       const char* scopes, int stopafter)
+{
+    handle->params.findsrvs.srvtype = srvtype;
+    handle->params.findsrvs.srvtypelen = strlen(srvtype);
+    handle->params.findsrvs.scopelist = scopes;
+    handle->params.findsrvs.scopelistlen = strlen(scopes);
+    handle->params.findsrvs.predicate = "";
+    handle->params.findsrvs.predicatelen = 0;
+    handle->params.findsrvs.callback = SrvURLCallback;
+    handle->params.findsrvs.cookie = 0;
+    G_Urls = 0;
+    G_LastCalls = 0;
+    G_Lifetime = 0;
+    G_StopAfter = stopafter;
+    G_Url[0] = 0;
+}
+
+/* Points the handle at an AttrRqst without tags */
+static void SetAttrRqst(PSLPHandleInfo handle, const char* url,
+                        int stopafter)
+{
+    handle->params.findattrs.url = url;
+    handle->params.findattrs.urllen = strlen(url);
+    handle->params.findattrs.scopelist = "default";
+    handle->params.findattrs.scopelistlen = 7;
+    handle->params.findattrs.taglist = "";
+    handle->params.findattrs.taglistlen = 0;
+    handle->params.findattrs.callback = AttrCallback;
+    handle->params.findattrs.cookie = 0;
+    G_Urls = 0;
+    G_LastCalls = 0;
+    G_StopAfter = stopafter;
+    G_Attrs[0] = 0;
+}
+
+/* Returns 1 if the snapshot answers what slpd would, 0 otherwise. */
+int check_answers(PSLPHandleInfo handle)
+{
+    BodyStart();
+    BodyAdd("service:test", "service:test://a", "default", "(a=1)", 0);
+    BodyAdd("service:test:x", "service:test:x://b", "default", "", 100);
+    BodyAdd("service:test", "service:test://c", "lab", "", 0);
+    BodyAdd("service:other", "service:other://d", "default", "", 0);
+    BodyAdd("service:test", "service:test://e", "default", "", -1);
+    Publish(1, "default,lab");
+
+    /* abstract types match their concrete ones, expired entries don't */
+    SetSrvRqst(handle, "service:test", "default", 0);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 2 && G_LastCalls == 1);
+    CHECK(strcmp(G_Url, "service:test:x://b") == 0);
+    CHECK(G_Lifetime > 90 && G_Lifetime <= 100);
+
+    SetSrvRqst(handle, "SERVICE:TEST", "LAB,default", 0);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 3 && G_LastCalls == 1);
+
+    /* nothing registered is an answer too */
+    SetSrvRqst(handle, "service:none", "default", 0);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 0 && G_LastCalls == 1);
+
+    /* the attributes of a URL */
+    SetAttrRqst(handle, "service:test://a", 0);
+    CHECK(SnapshotProcessAttrRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 1 && G_LastCalls == 1);
+    CHECK(strcmp(G_Attrs, "(a=1)") == 0);
+
+    /* scopes slpd is no DA for, predicates and tags go to slpd */
+    SetSrvRqst(handle, "service:test", "default,elsewhere", 0);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_FALSE);
+    SetSrvRqst(handle, "service:test", "default", 0);
+    handle->params.findsrvs.predicate = "(a=1)";
+    handle->params.findsrvs.predicatelen = 5;
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_FALSE);
+    SetAttrRqst(handle, "service:test://a", 0);
+    handle->params.findattrs.taglist = "a";
+    handle->params.findattrs.taglistlen = 1;
+    CHECK(SnapshotProcessAttrRqst(handle) == SLP_FALSE);
+    CHECK(G_Urls == 0 && G_LastCalls == 0);
+
+    /* an SA's snapshot may be missing what other SAs registered */
+    Publish(0, "default,lab");
+    SetSrvRqst(handle, "service:test", "default", 0);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_FALSE);
+    CHECK(G_Urls == 0 && G_LastCalls == 0);
+
+    return 1;
+}
+
+/* Returns 1 if SLP_FALSE from a callback ends the answer, 0 otherwise. */
+int check_stop(PSLPHandleInfo handle)
+{
+    BodyStart();
+    BodyAdd("service:test", "service:test://a", "default", "(a=1)", 0);
+    BodyAdd("service:test", "service:test://b", "default", "", 0);
+    BodyAdd("service:test", "service:test://c", "default", "", 0);
+    Publish(1, "default");
+
+    SetSrvRqst(handle, "service:test", "default", 1);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 1 && G_LastCalls == 0);
+
+    SetSrvRqst(handle, "service:test", "default", 2);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 2 && G_LastCalls == 0);
+
+    /* the handle is ready for the next request */
+    SetSrvRqst(handle, "service:test", "default", 0);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 3 && G_LastCalls == 1);
+
+    SetAttrRqst(handle, "service:test://a", 1);
+    CHECK(SnapshotProcessAttrRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 1 && G_LastCalls == 0);
+
+    return 1;
+}
+
+static volatile int G_Writing;
+
+/* Rewrites the snapshot with 1 to 8 URLs all ending in the generation */
+static void* Writer(void* arg)
+{
+    char        url[64];
+    uint32_t    generation;
+    int         count;
+    int         i;
+
+    while(G_Writing)
+    {
+        generation = G_Snapshot->generation + 2;
+        count = (generation / 2) % 8 + 1;
+        BodyStart();
+        for(i = 0; i < count; i++)
+        {
+            sprintf(url, "service:test://%i/%lu", i,
+                    (unsigned long)generation);
+            BodyAdd("service:test", url, "default", "", 0);
+        }
+        Publish(1, "default");
+    }
+    return 0;
+}
+
+static int          G_Torn;
+static unsigned long G_Version;
+
+static SLPBoolean VersionCallback(SLPHandle hSLP,
+                                  const char* pcSrvURL,
+                                  unsigned short sLifetime,
+                                  SLPError errCode,
+                                  void *pvCookie)
+{
+    const char*     version;
+
+    if(errCode == SLP_OK)
+    {
+        version = strrchr(pcSrvURL, '/');
+        if(G_Urls ++ == 0)
+        {
+            G_Version = strtoul(version + 1, 0, 10);
+        }
+        else if(strtoul(version + 1, 0, 10) != G_Version)
+        {
+            G_Torn ++;
+        }
+    }
+    else if(errCode == SLP_LAST_CALL)
+    {
+        G_LastCalls ++;
+    }
+    return SLP_TRUE;
+}
+
+/* Returns 1 if the generation keeps readers from torn copies. */
+int check_seqlock(PSLPHandleInfo handle)
+{
+    pthread_t   writer;
+    int         answered;
+    int         i;
+
+    BodyStart();
+    BodyAdd("service:test", "service:test://a", "default", "", 0);
+    Publish(1, "default");
+
+    /* not while slpd is writing it */
+    G_Snapshot->generation ++;
+    SetSrvRqst(handle, "service:test", "default", 0);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_FALSE);
+    G_Snapshot->generation ++;
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_TRUE);
+    CHECK(G_Urls == 1 && G_LastCalls == 1);
+
+    /* nor once slpd stopped looking after it */
+    G_Snapshot->heartbeat = time(0) - SLP_SNAPSHOT_STALE - 10;
+    SetSrvRqst(handle, "service:test", "default", 0);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_FALSE);
+    G_Snapshot->heartbeat = time(0);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_TRUE);
+
+    /* every answer is one version, whole, however often it changes */
+    G_Writing = 1;
+    CHECK(pthread_create(&writer, 0, Writer, 0) == 0);
+    G_Torn = 0;
+    answered = 0;
+    for(i = 0; i < 20000; i++)
+    {
+        SetSrvRqst(handle, "service:test", "default", 0);
+        handle->params.findsrvs.callback = VersionCallback;
+        if(SnapshotProcessSrvRqst(handle) == SLP_TRUE)
+        {
+            if(G_LastCalls != 1 ||
+               G_Urls != (int)((G_Version / 2) % 8 + 1))
+            {
+                G_Torn ++;
+            }
+            answered ++;
+        }
+    }
+    G_Writing = 0;
+    pthread_join(writer, 0);
+    CHECK(G_Torn == 0);
+    CHECK(answered > 0);
+
+    /* an abandoned snapshot is never used */
+    G_Snapshot->generation = SLP_SNAPSHOT_DEAD;
+    SetSrvRqst(handle, "service:test", "default", 0);
+    CHECK(SnapshotProcessSrvRqst(handle) == SLP_FALSE);
+    CHECK(G_Urls == 0 && G_LastCalls == 0);
+
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPHandle   hslp;
+
+    if(SnapshotOpen() == 0)
+    {
+        printf("can not own %s, skipped\n", SLP_SNAPSHOT_FILE);
+        return 77;
+    }
+
+    if(SLPOpen("en", SLP_FALSE, &hslp) != SLP_OK)
+    {
+        printf("SLPOpen failed\n");
+        return 1;
+    }
+
+    SLPTestReport("answers", check_answers((PSLPHandleInfo)hslp));
+    SLPTestReport("stop", check_stop((PSLPHandleInfo)hslp));
+    SLPTestReport("seqlock", check_seqlock((PSLPHandleInfo)hslp));
+
+    SLPClose(hslp);
+
+    G_Snapshot->generation = SLP_SNAPSHOT_DEAD;
+    munmap((void*)G_Snapshot, SNAPSHOT_SIZE);
+    unlink(SLP_SNAPSHOT_FILE);
+
+    return SLPTestExit();
+}
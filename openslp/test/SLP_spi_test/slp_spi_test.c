@@ -0,0 +1,256 @@
+/* Checks how an SPI handle finds its entries and keys: SPI strings are
+ * hashed with FNV-1a into buckets that spread a large SPI file, lookups
+ * find exactly the SPI and key type asked for, the last of duplicate
+ * lines wins as it always did, and the keys are read when the SPI file is
+ * opened: removing the key files afterwards only takes the private keys
+ * of a handle that does not cache them.  Skipped without
+ * ENABLE_SLPv2_SECURITY.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <slp.h>
+#include <libslp.h>
+
+#ifdef ENABLE_SLPv2_SECURITY
+
+#include <openssl/pem.h>
+#include <slp_test.h>
+
+/* internal to slp_spi.c */
+extern unsigned int SLPSpiHash(int spistrlen, const char* spistr);
+extern SLPSpiEntry* SLPSpiEntryFind(SLPSpiHandle hspi,
+                                    int keytype,
+                                    int spistrlen,
+                                    const char* spistr);
+
+#define SPI_COUNT   200
+
+static char G_Dir[] = "/tmp/slp_spi_testXXXXXX";
+static char G_SpiFile[64];
+static char G_PublicKey[64];
+static char G_PrivateKey[64];
+
+static int CanVerify(SLPSpiHandle hspi, const char* spi)
+{
+    return SLPSpiCanVerify(hspi, strlen(spi), spi);
+}
+
+static int CanSign(SLPSpiHandle hspi, const char* spi)
+{
+    return SLPSpiCanSign(hspi, strlen(spi), spi);
+}
+
+/* Writes an SPI file of SPI_COUNT public SPIs, two private ones and a */
+/* duplicate, the first public and private SPIs with real keys         */
+static int WriteSpiFile(void)
+{
+    FILE*   fp;
+    int     i;
+
+    fp = fopen(G_SpiFile, "w");
+    if(fp == 0)
+    {
+        return -1;
+    }
+    fprintf(fp, "# public keys\n\n");
+    fprintf(fp, "PUBLIC spi.0 %s\n", G_PublicKey);
+    for(i = 1; i < SPI_COUNT; i++)
+    {
+        fprintf(fp, "  public spi.%i %s.%i\n", i, G_Dir, i);
+    }
+    fprintf(fp, "PRIVATE spi.0 %s\n", G_PrivateKey);
+    fprintf(fp, "PRIVATE spi.7 %s.7\n", G_Dir);
+    fprintf(fp, "UNKNOWN spi.x %s.x\n", G_Dir);
+    fprintf(fp, "PUBLIC spi.1 %s.dup\n", G_Dir);
+    return fclose(fp);
+}
+
+/* Writes a DSA key pair, public and private key files */
+static int WriteKeys(void)
+{
+    DSA*    dsa;
+    FILE*   fp;
+    int     result = -1;
+
+    dsa = DSA_new();
+    if(dsa &&
+       DSA_generate_parameters_ex(dsa, 1024, 0, 0, 0, 0, 0) &&
+       DSA_generate_key(dsa))
+    {
+        fp = fopen(G_PublicKey, "w");
+        if(fp)
+        {
+            result = PEM_write_DSA_PUBKEY(fp, dsa) ? 0 : -1;
+            fclose(fp);
+        }
+        fp = fopen(G_PrivateKey, "w");
+        if(fp && result == 0)
+        {
+            result = PEM_write_DSAPrivateKey(fp, dsa, 0, 0, 0, 0, 0) ? 0 : -1;
+        }
+        if(fp) fclose(fp);
+    }
+    if(dsa) DSA_free(dsa);
+    return result;
+}
+
+/* Returns 1 if the hash is FNV-1a and spreads the SPIs, 0 otherwise. */
+int check_hash(SLPSpiHandle hspi)
+{
+    SLPSpiEntry*    entry;
+    int             used = 0;
+    int             longest = 0;
+    int             chain;
+    int             i;
+
+    /* the published FNV-1a test vectors */
+    CHECK(SLPSpiHash(0, "") == 0x811c9dc5U);
+    CHECK(SLPSpiHash(1, "a") == 0xe40c292cU);
+    CHECK(SLPSpiHash(6, "foobar") == 0xbf9cf968U);
+
+    /* SPI_COUNT + 3 entries fill every bucket, none of them deeply */
+    for(i = 0; i < SLPSPI_BUCKETS; i++)
+    {
+        chain = 0;
+        for(entry = hspi->buckets[i]; entry; entry = entry->hashnext)
+        {
+            CHECK((entry->hash & (SLPSPI_BUCKETS - 1)) == (unsigned)i);
+            chain ++;
+        }
+        used += chain != 0;
+        longest = chain > longest ? chain : longest;
+    }
+    CHECK(used == SLPSPI_BUCKETS);
+    CHECK(longest <= 4 * (SPI_COUNT + 3) / SLPSPI_BUCKETS);
+
+    return 1;
+}
+
+/* Returns 1 if lookups find only what was asked for, 0 otherwise. */
+int check_lookup(SLPSpiHandle hspi)
+{
+    SLPSpiEntry*    entry;
+    char            spi[32];
+    char*           spistr;
+    int             spistrlen;
+    int             i;
+
+    for(i = 0; i < SPI_COUNT; i++)
+    {
+        sprintf(spi, "spi.%i", i);
+        CHECK(CanVerify(hspi, spi));
+    }
+
+    /* SPIs are compared whole, case and all */
+    CHECK(CanVerify(hspi, "spi.200") == 0);
+    CHECK(CanVerify(hspi, "spi.") == 0);
+    CHECK(CanVerify(hspi, "SPI.1") == 0);
+    CHECK(SLPSpiCanVerify(hspi, 5, "spi.10") && CanVerify(hspi, "spi.1"));
+    CHECK(CanVerify(hspi, "spi.x") == 0);
+
+    /* the key type is part of what is looked up */
+    CHECK(CanSign(hspi, "spi.0") && CanSign(hspi, "spi.7"));
+    CHECK(CanSign(hspi, "spi.1") == 0);
+
+    /* no SPI is always verifiable */
+    CHECK(SLPSpiCanVerify(hspi, 0, 0));
+
+    /* the last line for an SPI wins */
+    entry = SLPSpiEntryFind(hspi, SLPSPI_KEY_TYPE_PUBLIC, 5, "spi.1");
+    CHECK(entry && strstr(entry->keyfilename, ".dup") != 0);
+
+    /* the default SPIs are still the last ones read */
+    CHECK(SLPSpiGetDefaultSPI(hspi, SLPSPI_KEY_TYPE_PUBLIC,
+                              &spistrlen, &spistr) != 0);
+    CHECK(spistrlen == 5 && memcmp(spistr, "spi.1", 5) == 0);
+    xfree(spistr);
+    CHECK(SLPSpiGetDefaultSPI(hspi, SLPSPI_KEY_TYPE_PRIVATE,
+                              &spistrlen, &spistr) != 0);
+    CHECK(spistrlen == 5 && memcmp(spistr, "spi.7", 5) == 0);
+    xfree(spistr);
+
+    return 1;
+}
+
+/* Returns 1 if keys come from SLPSpiOpen(), not the disk, 0 otherwise. */
+int check_keys(SLPSpiHandle hspi, int cacheprivate)
+{
+    SLPCryptoDSAKey*    key;
+    unsigned long       before;
+
+    before = hspi->keylookups;
+
+    /* the key files are gone, public keys read at open are used */
+    CHECK(SLPSpiGetDSAKey(hspi, SLPSPI_KEY_TYPE_PUBLIC,
+                          5, "spi.0", &key) != 0);
+    SLPCryptoDSAKeyDestroy(key);
+
+    /* private keys not cached are read from the disk each time */
+    SLPSpiGetDSAKey(hspi, SLPSPI_KEY_TYPE_PRIVATE, 5, "spi.0", &key);
+    CHECK((key != 0) == cacheprivate);
+    if(key) SLPCryptoDSAKeyDestroy(key);
+
+    /* SPIs without a key or without an entry give none */
+    CHECK(SLPSpiGetDSAKey(hspi, SLPSPI_KEY_TYPE_PUBLIC,
+                          5, "spi.2", &key) == 0);
+    CHECK(SLPSpiGetDSAKey(hspi, SLPSPI_KEY_TYPE_PUBLIC,
+                          7, "spi.200", &key) == 0);
+
+    CHECK(hspi->keylookups == before + 4);
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPSpiHandle    hspi;
+    SLPSpiHandle    hspicached;
+
+    if(mkdtemp(G_Dir) == 0)
+    {
+        printf("can not make %s\n", G_Dir);
+        return 1;
+    }
+    sprintf(G_SpiFile, "%s/slp.spi", G_Dir);
+    sprintf(G_PublicKey, "%s/public.pem", G_Dir);
+    sprintf(G_PrivateKey, "%s/private.pem", G_Dir);
+    if(WriteKeys() || WriteSpiFile())
+    {
+        printf("can not write the SPI file or keys in %s\n", G_Dir);
+        return 1;
+    }
+
+    /* libslp does not cache private keys, slpd does */
+    hspi = SLPSpiOpen(G_SpiFile, 0);
+    hspicached = SLPSpiOpen(G_SpiFile, 1);
+    unlink(G_SpiFile);
+    unlink(G_PublicKey);
+    unlink(G_PrivateKey);
+    rmdir(G_Dir);
+    if(hspi == 0 || hspicached == 0)
+    {
+        printf("SLPSpiOpen failed\n");
+        return 1;
+    }
+
+    SLPTestReport("hash", check_hash(hspi));
+    SLPTestReport("lookup", check_lookup(hspi));
+    SLPTestReport("keys", check_keys(hspi, 0));
+    SLPTestReport("cached keys", check_keys(hspicached, 1));
+
+    SLPSpiClose(hspi);
+    SLPSpiClose(hspicached);
+
+    return SLPTestExit();
+}
+
+#else
+
+int main(int argc, char* argv[])
+{
+    printf("built without ENABLE_SLPv2_SECURITY, skipped\n");
+    return 77;
+}
+
+#endif
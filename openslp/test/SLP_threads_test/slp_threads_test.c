@@ -0,0 +1,254 @@
+/* Calls into libslp from many threads at once: properties are set while
+ * other threads read them, DAs come and go from the known DA cache while
+ * other threads pick from it, handles are opened and closed, and XIDs are
+ * generated.  Checks that no update is lost and that readers only ever see
+ * values some writer stored.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <slp.h>
+#include <libslp.h>
+#include <slp_test.h>
+
+#define THREADS     8
+#define ROUNDS      2000
+
+/* internal to libslp_knownda.c and libslp_handle.c */
+extern int KnownDAAdd(SLPMessage msg, SLPBuffer buf);
+extern SLPBoolean KnownDAListFind(int scopelistlen,
+                                  const char* scopelist,
+                                  int spistrlen,
+                                  const char* spistr,
+                                  struct in_addr* exclude,
+                                  struct in_addr* daaddr);
+extern int G_OpenSLPHandleCount;
+
+static int              G_Failures  = 0;
+static unsigned char    G_Xids[65536];
+
+static void Fail(const char* what)
+{
+    __sync_add_and_fetch(&G_Failures,1);
+    printf("failed: %s\n", what);
+}
+
+static int RunThreads(void* (*fn)(void*))
+{
+    pthread_t   threads[THREADS];
+    long        i;
+
+    G_Failures = 0;
+    for(i = 0; i < THREADS; i++)
+    {
+        if(pthread_create(&threads[i],0,fn,(void*)i))
+        {
+            return 0;
+        }
+    }
+    for(i = 0; i < THREADS; i++)
+    {
+        pthread_join(threads[i],0);
+    }
+
+    return G_Failures == 0;
+}
+
+static void* PropertyThread(void* arg)
+{
+    long        id = (long)arg;
+    char        name[32];
+    char        value[32];
+    const char* shared;
+    int         hold;
+    int         i;
+
+    sprintf(name,"net.slp.test%ld",id);
+    for(i = 0; i < ROUNDS; i++)
+    {
+        sprintf(value,"%d",i);
+        SLPPropertySet(name,value);
+        SLPPropertySet("net.slp.testShared",id & 1 ? "odd" : "even");
+
+        /* the others set the shared one while we look at it */
+        hold = SLPPropertyHold();
+        if(strcmp(SLPGetProperty(name),value))
+        {
+            Fail("own property");
+            SLPPropertyRelease(hold);
+            break;
+        }
+        shared = SLPGetProperty("net.slp.testShared");
+        if(shared == 0 || (strcmp(shared,"odd") && strcmp(shared,"even")))
+        {
+            Fail("shared property");
+            SLPPropertyRelease(hold);
+            break;
+        }
+        if(SLPGetProperty("net.slp.useScopes") == 0)
+        {
+            Fail("default property");
+            SLPPropertyRelease(hold);
+            break;
+        }
+        SLPPropertyRelease(hold);
+    }
+
+    return 0;
+}
+
+static int TestProperties()
+{
+    char    name[32];
+    char    value[32];
+    long    i;
+
+    CHECK(SLPGetProperty("net.slp.useScopes"));
+    CHECK(RunThreads(PropertyThread));
+
+    /* every thread's last value made it */
+    sprintf(value,"%d",ROUNDS - 1);
+    for(i = 0; i < THREADS; i++)
+    {
+        sprintf(name,"net.slp.test%ld",i);
+        CHECK(strcmp(SLPGetProperty(name),value) == 0);
+    }
+
+    return 1;
+}
+
+static int AddDA(struct in_addr* addr, char* url, char* scope)
+{
+    SLPMessage  msg;
+
+    msg = SLPMessageAlloc();
+    if(msg == 0)
+    {
+        return -1;
+    }
+    msg->peer.sin_family = AF_INET;
+    msg->peer.sin_addr = *addr;
+    msg->body.daadvert.url = url;
+    msg->body.daadvert.urllen = strlen(url);
+    msg->body.daadvert.scopelist = scope;
+    msg->body.daadvert.scopelistlen = strlen(scope);
+    return KnownDAAdd(msg,SLPBufferAlloc(1));
+}
+
+static void* KnownDAThread(void* arg)
+{
+    long            id = (long)arg;
+    static char     urls[THREADS][64];
+    static char     scopes[THREADS][16];
+    struct in_addr  addr;
+    struct in_addr  found;
+    int             i;
+
+    addr.s_addr = htonl(0x0a000100 + id);
+    sprintf(urls[id],"service:directory-agent://10.0.1.%ld",id);
+    sprintf(scopes[id],"scope%ld",id);
+    for(i = 0; i < ROUNDS; i++)
+    {
+        if(AddDA(&addr,urls[id],scopes[id]))
+        {
+            Fail("add");
+            break;
+        }
+
+        /* nobody else serves this thread's scope */
+        if(KnownDAListFind(strlen(scopes[id]),scopes[id],0,0,0,&found) == 0 ||
+           found.s_addr != addr.s_addr)
+        {
+            Fail("find own DA");
+            break;
+        }
+
+        if(i + 1 < ROUNDS)
+        {
+            KnownDABadDA(&addr);
+        }
+    }
+
+    return 0;
+}
+
+static int TestKnownDA()
+{
+    char            scope[16];
+    struct in_addr  found;
+    long            i;
+
+    CHECK(RunThreads(KnownDAThread));
+
+    /* each thread left its DA in the cache */
+    for(i = 0; i < THREADS; i++)
+    {
+        sprintf(scope,"scope%ld",i);
+        CHECK(KnownDAListFind(strlen(scope),scope,0,0,0,&found));
+        CHECK(found.s_addr == htonl(0x0a000100 + i));
+    }
+
+    return 1;
+}
+
+static void* HandleThread(void* arg)
+{
+    SLPHandle   hslp;
+    int         i;
+
+    for(i = 0; i < ROUNDS; i++)
+    {
+        if(SLPOpen("en",SLP_FALSE,&hslp) != SLP_OK)
+        {
+            Fail("open");
+            break;
+        }
+        SLPClose(hslp);
+    }
+
+    return 0;
+}
+
+static int TestHandles()
+{
+    CHECK(RunThreads(HandleThread));
+    CHECK(G_OpenSLPHandleCount == 0);
+
+    return 1;
+}
+
+static void* XidThread(void* arg)
+{
+    int i;
+
+    /* THREADS * ROUNDS stays below 65536, so no XID may come twice */
+    for(i = 0; i < ROUNDS; i++)
+    {
+        if(__sync_add_and_fetch(&G_Xids[SLPXidGenerate()],1) != 1)
+        {
+            Fail("unique xid");
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static int TestXids()
+{
+    CHECK(RunThreads(XidThread));
+
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPTestReport("properties", TestProperties());
+    SLPTestReport("knownda", TestKnownDA());
+    SLPTestReport("handles", TestHandles());
+    SLPTestReport("xids", TestXids());
+
+    return SLPTestExit();
+}
@@ -0,0 +1,240 @@
+/* Checks the signatures an SPI handle remembers as verified: the same
+ * authblock over the same data is taken again without looking for a key,
+ * other signatures, other data and other SPIs are not, expired authblocks
+ * are rejected however well they verified before, a slot holds the
+ * latest signature that maps to it and a reopened handle starts over.
+ * The SPI file names no key that exists, so nothing here can pass a DSA
+ * verify: whatever verifies came from the table.  Skipped without
+ * ENABLE_SLPv2_SECURITY.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <slp.h>
+#include <libslp.h>
+
+#ifdef ENABLE_SLPv2_SECURITY
+
+#include <slp_test.h>
+
+/* internal to slp_auth.c */
+extern int SLPAuthDigestString(int spistrlen,
+                               const char* spistr,
+                               int stringlen,
+                               const char* string,
+                               unsigned long timestamp,
+                               unsigned char* digest);
+
+#define SPI         "test.spi"
+#define URL         "service:test://a"
+
+static char             G_SpiFile[] = "/tmp/slp_verified_testXXXXXX";
+static unsigned char    G_Signature[46];
+
+/* Makes an authblock for string that expires in lifetime seconds */
+static void MakeAuthBlock(SLPAuthBlock* auth, const char* spi, long lifetime)
+{
+    memset(auth, 0, sizeof(SLPAuthBlock));
+    auth->bsd = 2;
+    auth->spistr = spi;
+    auth->spistrlen = strlen(spi);
+    auth->timestamp = (unsigned int)(time(0) + lifetime);
+    auth->authstruct = G_Signature;
+    auth->length = auth->spistrlen + 10 + sizeof(G_Signature);
+}
+
+/* Remembers the authblock over string as verified */
+static int Remember(SLPSpiHandle hspi, const char* string,
+                    SLPAuthBlock* auth)
+{
+    unsigned char digest[SLPAUTH_SHA1_DIGEST_SIZE];
+
+    if(SLPAuthDigestString(auth->spistrlen, auth->spistr,
+                           strlen(string), string,
+                           auth->timestamp, digest))
+    {
+        return -1;
+    }
+    SLPSpiVerifiedAdd(hspi, digest, auth->authstruct,
+                      auth->length - (auth->spistrlen + 10));
+    return 0;
+}
+
+/* Verifies string, 0 if it passed; *looked is set if a key was looked for */
+static int Verify(SLPSpiHandle hspi, const char* string,
+                  SLPAuthBlock* auth, int* looked)
+{
+    unsigned long   before;
+    int             result;
+
+    before = hspi->keylookups;
+    result = SLPAuthVerifyString(hspi, 1, strlen(string), string, 1, auth);
+    *looked = hspi->keylookups != before;
+    return result;
+}
+
+/* Returns 1 if remembered signatures verify and nothing else, 0 otherwise. */
+int check_hits(SLPSpiHandle hspi)
+{
+    SLPAuthBlock    auth;
+    SLPAuthBlock    other;
+    int             looked;
+
+    /* not remembered yet: the key is looked for and there is none */
+    MakeAuthBlock(&auth, SPI, 300);
+    CHECK(Verify(hspi, URL, &auth, &looked) != 0 && looked);
+    CHECK(hspi->verified == 0);
+
+    /* once remembered it verifies on its own, again and again */
+    CHECK(Remember(hspi, URL, &auth) == 0);
+    CHECK(hspi->verified != 0);
+    CHECK(Verify(hspi, URL, &auth, &looked) == 0 && looked == 0);
+    CHECK(Verify(hspi, URL, &auth, &looked) == 0 && looked == 0);
+
+    /* the same signature over other data */
+    CHECK(Verify(hspi, "service:test://b", &auth, &looked) != 0 && looked);
+
+    /* another signature over the same data */
+    G_Signature[0] ^= 1;
+    CHECK(Verify(hspi, URL, &auth, &looked) != 0 && looked);
+    G_Signature[0] ^= 1;
+
+    /* a shorter signature with the same bytes */
+    auth.length --;
+    CHECK(Verify(hspi, URL, &auth, &looked) != 0 && looked);
+    auth.length ++;
+
+    /* the digest covers the SPI and the expiry too */
+    MakeAuthBlock(&other, "other.spi", 300);
+    CHECK(Verify(hspi, URL, &other, &looked) != 0);
+    MakeAuthBlock(&other, SPI, 301);
+    CHECK(Verify(hspi, URL, &other, &looked) != 0 && looked);
+
+    CHECK(Verify(hspi, URL, &auth, &looked) == 0 && looked == 0);
+    return 1;
+}
+
+/* Returns 1 if expired authblocks never pass, 0 otherwise. */
+int check_expiry(SLPSpiHandle hspi)
+{
+    SLPAuthBlock    auth;
+    int             looked;
+
+    /* remembered while it was good, rejected once it expired */
+    MakeAuthBlock(&auth, SPI, -10);
+    CHECK(Remember(hspi, URL, &auth) == 0);
+    CHECK(Verify(hspi, URL, &auth, &looked) != 0 && looked == 0);
+
+    /* the authblock that replaces it is good until it expires too */
+    MakeAuthBlock(&auth, SPI, 2);
+    CHECK(Remember(hspi, URL, &auth) == 0);
+    CHECK(Verify(hspi, URL, &auth, &looked) == 0);
+    sleep(3);
+    CHECK(Verify(hspi, URL, &auth, &looked) != 0 && looked == 0);
+
+    return 1;
+}
+
+/* Returns 1 if slots keep the latest signature, 0 otherwise. */
+int check_slots(SLPSpiHandle hspi)
+{
+    unsigned char   digest[SLPSPI_DIGEST_SIZE];
+    unsigned char   collides[SLPSPI_DIGEST_SIZE];
+    unsigned char   longsig[SLPSPI_MAX_SIGNATURE + 1];
+
+    memset(digest, 7, sizeof(digest));
+    memset(collides, 7, sizeof(collides));
+    collides[SLPSPI_DIGEST_SIZE - 1] = 8;
+
+    SLPSpiVerifiedAdd(hspi, digest, G_Signature, sizeof(G_Signature));
+    CHECK(SLPSpiVerifiedFind(hspi, digest, G_Signature,
+                             sizeof(G_Signature)));
+    CHECK(SLPSpiVerifiedFind(hspi, collides, G_Signature,
+                             sizeof(G_Signature)) == 0);
+
+    /* a digest for the same slot takes it over */
+    SLPSpiVerifiedAdd(hspi, collides, G_Signature, sizeof(G_Signature));
+    CHECK(SLPSpiVerifiedFind(hspi, collides, G_Signature,
+                             sizeof(G_Signature)));
+    CHECK(SLPSpiVerifiedFind(hspi, digest, G_Signature,
+                             sizeof(G_Signature)) == 0);
+
+    /* signatures too long for a slot are not remembered, nor empty ones */
+    memset(longsig, 1, sizeof(longsig));
+    SLPSpiVerifiedAdd(hspi, digest, longsig, sizeof(longsig));
+    CHECK(SLPSpiVerifiedFind(hspi, digest, longsig, sizeof(longsig)) == 0);
+    SLPSpiVerifiedAdd(hspi, digest, longsig, 0);
+    CHECK(SLPSpiVerifiedFind(hspi, digest, longsig, 0) == 0);
+    CHECK(SLPSpiVerifiedFind(hspi, collides, G_Signature,
+                             sizeof(G_Signature)));
+
+    CHECK(SLPSpiVerifiedFind(0, digest, G_Signature,
+                             sizeof(G_Signature)) == 0);
+    return 1;
+}
+
+/* Returns 1 if a reopened handle remembers nothing, 0 otherwise. */
+int check_reopen(SLPSpiHandle* hspi)
+{
+    SLPAuthBlock    auth;
+    int             looked;
+
+    MakeAuthBlock(&auth, SPI, 300);
+    CHECK(Remember(*hspi, URL, &auth) == 0);
+    CHECK(Verify(*hspi, URL, &auth, &looked) == 0);
+
+    /* as slpd does when SIGHUP reloads the SPI file */
+    SLPSpiClose(*hspi);
+    *hspi = SLPSpiOpen(G_SpiFile, 0);
+    CHECK(*hspi != 0);
+    CHECK(Verify(*hspi, URL, &auth, &looked) != 0 && looked);
+
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SLPSpiHandle    hspi;
+    FILE*           fp;
+    int             fd;
+
+    fd = mkstemp(G_SpiFile);
+    fp = fd < 0 ? 0 : fdopen(fd, "w");
+    if(fp == 0)
+    {
+        printf("can not write %s\n", G_SpiFile);
+        return 1;
+    }
+    fprintf(fp, "PUBLIC %s %s.nokey\n", SPI, G_SpiFile);
+    fclose(fp);
+
+    memset(G_Signature, 0x5a, sizeof(G_Signature));
+    hspi = SLPSpiOpen(G_SpiFile, 0);
+    if(hspi == 0)
+    {
+        printf("SLPSpiOpen failed\n");
+        unlink(G_SpiFile);
+        return 1;
+    }
+
+    SLPTestReport("hits", check_hits(hspi));
+    SLPTestReport("expiry", check_expiry(hspi));
+    SLPTestReport("slots", check_slots(hspi));
+    SLPTestReport("reopen", check_reopen(&hspi));
+
+    SLPSpiClose(hspi);
+    unlink(G_SpiFile);
+
+    return SLPTestExit();
+}
+
+#else
+
+int main(int argc, char* argv[])
+{
+    printf("built without ENABLE_SLPv2_SECURITY, skipped\n");
+    return 77;
+}
+
+#endif
@@ -0,0 +1,36 @@
+/****************************************************************************/
+/* slp_test                                                                 */
+/* Helpers shared by the unit tests.  A test is a function that returns 1   */
+/* when all of its CHECK()s hold.  main() passes each result to             */
+/* SLPTestReport() and returns SLPTestExit(), so make check sees a failure  */
+/* in the exit status.                                                      */
+/****************************************************************************/
+#ifndef SLP_TEST_H_INCLUDED
+#define SLP_TEST_H_INCLUDED
+
+#include <stdio.h>
+
+/* Fails the test function it is used in and says which check failed */
+#define CHECK(cond) \
+    if(!(cond)) { printf("failed: %s:%d: %s\n", __FILE__, __LINE__, #cond); return 0; }
+
+static int G_SLPTestFailures = 0;
+
+/* Prints "name: ok" or "name: FAILED" and counts the failures */
+static int SLPTestReport(const char* name, int ok)
+{
+    printf("%s: %s\n", name, ok ? "ok" : "FAILED");
+    if(ok == 0)
+    {
+        G_SLPTestFailures ++;
+    }
+    return ok;
+}
+
+/* Exit status for main(), non-zero if any test failed */
+static int SLPTestExit(void)
+{
+    return G_SLPTestFailures ? 1 : 0;
+}
+
+#endif
@@ -133,6 +133,22 @@ SOURCE=..\..\libslp\libslp_knownda.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\libslp\libslp_snapshot.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\libslp\libslp_collate.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\libslp\libslp_cache.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\libslp\libslp_refresh.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\libslp\libslp_network.c
 # End Source File
 # Begin Source File
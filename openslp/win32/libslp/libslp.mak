@@ -49,6 +49,10 @@ CLEAN :
 	-@erase "$(INTDIR)\libslp_findsrvtypes.obj"
 	-@erase "$(INTDIR)\libslp_handle.obj"
 	-@erase "$(INTDIR)\libslp_knownda.obj"
+	-@erase "$(INTDIR)\libslp_snapshot.obj"
+	-@erase "$(INTDIR)\libslp_collate.obj"
+	-@erase "$(INTDIR)\libslp_cache.obj"
+	-@erase "$(INTDIR)\libslp_refresh.obj"
 	-@erase "$(INTDIR)\libslp_network.obj"
 	-@erase "$(INTDIR)\libslp_parse.obj"
 	-@erase "$(INTDIR)\libslp_property.obj"
@@ -100,6 +104,10 @@ LINK32_OBJS= \
 	"$(INTDIR)\libslp_findsrvtypes.obj" \
 	"$(INTDIR)\libslp_handle.obj" \
 	"$(INTDIR)\libslp_knownda.obj" \
+	"$(INTDIR)\libslp_snapshot.obj" \
+	"$(INTDIR)\libslp_collate.obj" \
+	"$(INTDIR)\libslp_cache.obj" \
+	"$(INTDIR)\libslp_refresh.obj" \
 	"$(INTDIR)\libslp_network.obj" \
 	"$(INTDIR)\libslp_parse.obj" \
 	"$(INTDIR)\libslp_property.obj" \
@@ -160,6 +168,10 @@ CLEAN :
 	-@erase "$(INTDIR)\libslp_findsrvtypes.obj"
 	-@erase "$(INTDIR)\libslp_handle.obj"
 	-@erase "$(INTDIR)\libslp_knownda.obj"
+	-@erase "$(INTDIR)\libslp_snapshot.obj"
+	-@erase "$(INTDIR)\libslp_collate.obj"
+	-@erase "$(INTDIR)\libslp_cache.obj"
+	-@erase "$(INTDIR)\libslp_refresh.obj"
 	-@erase "$(INTDIR)\libslp_network.obj"
 	-@erase "$(INTDIR)\libslp_parse.obj"
 	-@erase "$(INTDIR)\libslp_property.obj"
@@ -212,6 +224,10 @@ LINK32_OBJS= \
 	"$(INTDIR)\libslp_findsrvtypes.obj" \
 	"$(INTDIR)\libslp_handle.obj" \
 	"$(INTDIR)\libslp_knownda.obj" \
+	"$(INTDIR)\libslp_snapshot.obj" \
+	"$(INTDIR)\libslp_collate.obj" \
+	"$(INTDIR)\libslp_cache.obj" \
+	"$(INTDIR)\libslp_refresh.obj" \
 	"$(INTDIR)\libslp_network.obj" \
 	"$(INTDIR)\libslp_parse.obj" \
 	"$(INTDIR)\libslp_property.obj" \
@@ -344,6 +360,30 @@ SOURCE=..\..\libslp\libslp_knownda.c
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE=..\..\libslp\libslp_snapshot.c
+
+"$(INTDIR)\libslp_snapshot.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE=..\..\libslp\libslp_collate.c
+
+"$(INTDIR)\libslp_collate.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE=..\..\libslp\libslp_cache.c
+
+"$(INTDIR)\libslp_cache.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE=..\..\libslp\libslp_refresh.c
+
+"$(INTDIR)\libslp_refresh.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=..\..\libslp\libslp_network.c
 
 "$(INTDIR)\libslp_network.obj" : $(SOURCE) "$(INTDIR)"
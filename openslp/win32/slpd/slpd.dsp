@@ -114,6 +114,10 @@ SOURCE=..\..\common\slp_dhcp.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\common\slp_histogram.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\common\slp_iface.c
 # End Source File
 # Begin Source File
@@ -202,6 +206,10 @@ SOURCE=..\..\slpd\slpd_socket.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\slpd\slpd_stats.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\\slpd\slpd_v1process.c
 # End Source File
 # Begin Source File
@@ -242,6 +250,10 @@ SOURCE=\mpeterson\cvs\openslp\common\slp_database.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\common\slp_histogram.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\common\slp_iface.h
 # End Source File
 # Begin Source File
@@ -382,6 +394,10 @@ SOURCE=..\..\slpd\slpd_socket.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\slpd\slpd_stats.h
+# End Source File
+# Begin Source File
+
 SOURCE=\mpeterson\cvs\openslp\slpd\slpd_socket.h
 # End Source File
 # Begin Source File
@@ -46,6 +46,7 @@ CLEAN :
 	-@erase "$(INTDIR)\slp_compare.obj"
 	-@erase "$(INTDIR)\slp_database.obj"
 	-@erase "$(INTDIR)\slp_dhcp.obj"
+	-@erase "$(INTDIR)\slp_histogram.obj"
 	-@erase "$(INTDIR)\slp_iface.obj"
 	-@erase "$(INTDIR)\slp_linkedlist.obj"
 	-@erase "$(INTDIR)\slp_message.obj"
@@ -69,6 +70,7 @@ CLEAN :
 	-@erase "$(INTDIR)\slpd_property.obj"
 	-@erase "$(INTDIR)\slpd_regfile.obj"
 	-@erase "$(INTDIR)\slpd_socket.obj"
+	-@erase "$(INTDIR)\slpd_stats.obj"
 	-@erase "$(INTDIR)\slpd_v1process.obj"
 	-@erase "$(INTDIR)\slpd_win32.obj"
 	-@erase "$(OUTDIR)\slpd.exe"
@@ -92,6 +94,7 @@ LINK32_OBJS= \
 	"$(INTDIR)\slp_compare.obj" \
 	"$(INTDIR)\slp_database.obj" \
 	"$(INTDIR)\slp_dhcp.obj" \
+	"$(INTDIR)\slp_histogram.obj" \
 	"$(INTDIR)\slp_iface.obj" \
 	"$(INTDIR)\slp_linkedlist.obj" \
 	"$(INTDIR)\slp_message.obj" \
@@ -114,6 +117,7 @@ LINK32_OBJS= \
 	"$(INTDIR)\slpd_property.obj" \
 	"$(INTDIR)\slpd_regfile.obj" \
 	"$(INTDIR)\slpd_socket.obj" \
+	"$(INTDIR)\slpd_stats.obj" \
 	"$(INTDIR)\slpd_v1process.obj" \
 	"$(INTDIR)\slpd_win32.obj"
 
@@ -139,6 +143,7 @@ CLEAN :
 	-@erase "$(INTDIR)\slp_compare.obj"
 	-@erase "$(INTDIR)\slp_database.obj"
 	-@erase "$(INTDIR)\slp_dhcp.obj"
+	-@erase "$(INTDIR)\slp_histogram.obj"
 	-@erase "$(INTDIR)\slp_iface.obj"
 	-@erase "$(INTDIR)\slp_linkedlist.obj"
 	-@erase "$(INTDIR)\slp_message.obj"
@@ -162,6 +167,7 @@ CLEAN :
 	-@erase "$(INTDIR)\slpd_property.obj"
 	-@erase "$(INTDIR)\slpd_regfile.obj"
 	-@erase "$(INTDIR)\slpd_socket.obj"
+	-@erase "$(INTDIR)\slpd_stats.obj"
 	-@erase "$(INTDIR)\slpd_v1process.obj"
 	-@erase "$(INTDIR)\slpd_win32.obj"
 	-@erase "$(OUTDIR)\slpd.exe"
@@ -186,6 +192,7 @@ LINK32_OBJS= \
 	"$(INTDIR)\slp_compare.obj" \
 	"$(INTDIR)\slp_database.obj" \
 	"$(INTDIR)\slp_dhcp.obj" \
+	"$(INTDIR)\slp_histogram.obj" \
 	"$(INTDIR)\slp_iface.obj" \
 	"$(INTDIR)\slp_linkedlist.obj" \
 	"$(INTDIR)\slp_message.obj" \
@@ -208,6 +215,7 @@ LINK32_OBJS= \
 	"$(INTDIR)\slpd_property.obj" \
 	"$(INTDIR)\slpd_regfile.obj" \
 	"$(INTDIR)\slpd_socket.obj" \
+	"$(INTDIR)\slpd_stats.obj" \
 	"$(INTDIR)\slpd_v1process.obj" \
 	"$(INTDIR)\slpd_win32.obj"
 
@@ -289,6 +297,12 @@ SOURCE=..\..\common\slp_dhcp.c
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE=..\..\common\slp_histogram.c
+
+"$(INTDIR)\slp_histogram.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=..\..\common\slp_iface.c
 
 "$(INTDIR)\slp_iface.obj" : $(SOURCE) "$(INTDIR)"
@@ -421,6 +435,12 @@ SOURCE=..\..\slpd\slpd_socket.c
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE=..\..\slpd\slpd_stats.c
+
+"$(INTDIR)\slpd_stats.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=..\..\\slpd\slpd_v1process.c
 
 "$(INTDIR)\slpd_v1process.obj" : $(SOURCE) "$(INTDIR)"